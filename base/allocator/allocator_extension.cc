@@ -5,6 +5,7 @@
 #include "base/allocator/allocator_extension.h"
 
 #include "base/logging.h"
+#include "base/memory/slab_allocator.h"
 
 namespace base {
 namespace allocator {
@@ -26,12 +27,22 @@ void GetStats(char* buffer, int buffer_length) {
 }
 
 void ReleaseFreeMemory() {
+  SlabAllocator::ReleaseFreeMemory();
   thunks::ReleaseFreeMemoryFunction release_free_memory_function =
       thunks::GetReleaseFreeMemoryFunction();
   if (release_free_memory_function)
     release_free_memory_function();
 }
 
+bool GetThreadAllocationCounts(unsigned int* bytes_allocated,
+                               unsigned int* allocations) {
+  thunks::GetThreadAllocationCountsFunction
+      get_thread_allocation_counts_function =
+          thunks::GetGetThreadAllocationCountsFunction();
+  return get_thread_allocation_counts_function != NULL &&
+         get_thread_allocation_counts_function(bytes_allocated, allocations);
+}
+
 void SetGetAllocatorWasteSizeFunction(
     thunks::GetAllocatorWasteSizeFunction get_allocator_waste_size_function) {
   DCHECK_EQ(thunks::GetGetAllocatorWasteSizeFunction(),
@@ -52,5 +63,14 @@ void SetReleaseFreeMemoryFunction(
   thunks::SetReleaseFreeMemoryFunction(release_free_memory_function);
 }
 
+void SetGetThreadAllocationCountsFunction(
+    thunks::GetThreadAllocationCountsFunction
+        get_thread_allocation_counts_function) {
+  DCHECK_EQ(thunks::GetGetThreadAllocationCountsFunction(),
+            reinterpret_cast<thunks::GetThreadAllocationCountsFunction>(NULL));
+  thunks::SetGetThreadAllocationCountsFunction(
+      get_thread_allocation_counts_function);
+}
+
 }  // namespace allocator
 }  // namespace base
@@ -32,9 +32,18 @@ BASE_EXPORT bool GetAllocatorWasteSize(size_t* size);
 BASE_EXPORT void GetStats(char* buffer, int buffer_length);
 
 // Request that the allocator release any free memory it knows about to the
-// system.
+// system. The large blocks cached by SlabAllocator are released first.
 BASE_EXPORT void ReleaseFreeMemory();
 
+// Request the running totals of bytes allocated and of allocations made on the
+// current thread. The totals wrap modulo 2^32, so only the difference between
+// two calls on the same thread is meaningful. This is what the task profiler
+// uses to attribute allocations to the task that made them.
+//
+// |bytes_allocated| and |allocations| must be not NULL.
+// Returns true if the values have been returned, false otherwise.
+BASE_EXPORT bool GetThreadAllocationCounts(unsigned int* bytes_allocated,
+                                           unsigned int* allocations);
 
 // These settings allow specifying a callback used to implement the allocator
 // extension functions.  These are optional, but if set they must only be set
@@ -53,6 +62,10 @@ BASE_EXPORT void SetGetStatsFunction(
 BASE_EXPORT void SetReleaseFreeMemoryFunction(
     thunks::ReleaseFreeMemoryFunction release_free_memory_function);
 
+BASE_EXPORT void SetGetThreadAllocationCountsFunction(
+    thunks::GetThreadAllocationCountsFunction
+        get_thread_allocation_counts_function);
+
 }  // namespace allocator
 }  // namespace base
 
@@ -20,6 +20,8 @@ namespace thunks {
 static GetAllocatorWasteSizeFunction g_get_allocator_waste_size_function = NULL;
 static GetStatsFunction g_get_stats_function = NULL;
 static ReleaseFreeMemoryFunction g_release_free_memory_function = NULL;
+static GetThreadAllocationCountsFunction
+    g_get_thread_allocation_counts_function = NULL;
 
 void SetGetAllocatorWasteSizeFunction(
     GetAllocatorWasteSizeFunction get_allocator_waste_size_function) {
@@ -47,6 +49,16 @@ ReleaseFreeMemoryFunction GetReleaseFreeMemoryFunction() {
   return g_release_free_memory_function;
 }
 
+void SetGetThreadAllocationCountsFunction(
+    GetThreadAllocationCountsFunction get_thread_allocation_counts_function) {
+  g_get_thread_allocation_counts_function =
+      get_thread_allocation_counts_function;
+}
+
+GetThreadAllocationCountsFunction GetGetThreadAllocationCountsFunction() {
+  return g_get_thread_allocation_counts_function;
+}
+
 }  // namespace thunks
 }  // namespace allocator
 }  // namespace base
@@ -29,6 +29,13 @@ void SetReleaseFreeMemoryFunction(
     ReleaseFreeMemoryFunction release_free_memory_function);
 ReleaseFreeMemoryFunction GetReleaseFreeMemoryFunction();
 
+typedef bool (*GetThreadAllocationCountsFunction)(
+    unsigned int* bytes_allocated,
+    unsigned int* allocations);
+void SetGetThreadAllocationCountsFunction(
+    GetThreadAllocationCountsFunction get_thread_allocation_counts_function);
+GetThreadAllocationCountsFunction GetGetThreadAllocationCountsFunction();
+
 }  // namespace thunks
 }  // namespace allocator
 }  // namespace base
@@ -0,0 +1,581 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/arena_values.h"
+
+#include <algorithm>
+
+#include "base/json/json_reader.h"
+#include "base/logging.h"
+
+namespace base {
+
+namespace {
+
+// Orders the entries of a dictionary by key, and entries with equal keys by
+// the order they were added in (nodes are numbered in that order).
+class EntryLess {
+ public:
+  explicit EntryLess(const std::string& strings) : strings_(strings) {}
+
+  template <typename Entry>
+  bool operator()(const Entry& lhs, const Entry& rhs) const {
+    int result = Key(lhs).compare(Key(rhs));
+    return result < 0 || (result == 0 && lhs.node < rhs.node);
+  }
+
+ private:
+  template <typename Entry>
+  StringPiece Key(const Entry& entry) const {
+    return StringPiece(strings_.data() + entry.key_offset, entry.key_length);
+  }
+
+  const std::string& strings_;
+};
+
+}  // namespace
+
+///////////////////// ArenaValue ////////////////////
+
+ArenaValue::ArenaValue() : tree_(NULL), node_(0) {
+}
+
+ArenaValue::ArenaValue(const ArenaValueTree* tree, uint32 node)
+    : tree_(tree),
+      node_(node) {
+  DCHECK_LT(node_, tree_->nodes_.size());
+}
+
+Value::Type ArenaValue::GetType() const {
+  return tree_ ? tree_->nodes_[node_].type : Value::TYPE_NULL;
+}
+
+bool ArenaValue::GetAsBoolean(bool* out_value) const {
+  if (!IsType(Value::TYPE_BOOLEAN))
+    return false;
+  if (out_value)
+    *out_value = tree_->nodes_[node_].bool_value;
+  return true;
+}
+
+bool ArenaValue::GetAsInteger(int* out_value) const {
+  if (!IsType(Value::TYPE_INTEGER))
+    return false;
+  if (out_value)
+    *out_value = tree_->nodes_[node_].int_value;
+  return true;
+}
+
+bool ArenaValue::GetAsDouble(double* out_value) const {
+  if (IsType(Value::TYPE_INTEGER)) {
+    if (out_value)
+      *out_value = tree_->nodes_[node_].int_value;
+    return true;
+  }
+  if (!IsType(Value::TYPE_DOUBLE))
+    return false;
+  if (out_value)
+    *out_value = tree_->nodes_[node_].double_value;
+  return true;
+}
+
+bool ArenaValue::GetAsString(StringPiece* out_value) const {
+  if (!IsType(Value::TYPE_STRING))
+    return false;
+  if (out_value) {
+    const ArenaValueTree::Node& node = tree_->nodes_[node_];
+    *out_value = tree_->GetString(node.offset, node.size);
+  }
+  return true;
+}
+
+bool ArenaValue::GetAsBinary(StringPiece* out_value) const {
+  if (!IsType(Value::TYPE_BINARY))
+    return false;
+  if (out_value) {
+    const ArenaValueTree::Node& node = tree_->nodes_[node_];
+    *out_value = tree_->GetString(node.offset, node.size);
+  }
+  return true;
+}
+
+size_t ArenaValue::size() const {
+  if (!IsType(Value::TYPE_LIST) && !IsType(Value::TYPE_DICTIONARY))
+    return 0;
+  return tree_->nodes_[node_].size;
+}
+
+bool ArenaValue::GetListItem(size_t index, ArenaValue* out_value) const {
+  if (!IsType(Value::TYPE_LIST) || index >= size())
+    return false;
+  if (out_value) {
+    const ArenaValueTree::Node& node = tree_->nodes_[node_];
+    *out_value = ArenaValue(tree_, tree_->entries_[node.offset + index].node);
+  }
+  return true;
+}
+
+bool ArenaValue::GetWithoutPathExpansion(const StringPiece& key,
+                                         ArenaValue* out_value) const {
+  if (!IsType(Value::TYPE_DICTIONARY))
+    return false;
+
+  const ArenaValueTree::Node& node = tree_->nodes_[node_];
+  size_t low = node.offset;
+  size_t high = node.offset + node.size;
+  while (low < high) {
+    size_t middle = low + (high - low) / 2;
+    const ArenaValueTree::Entry& entry = tree_->entries_[middle];
+    int result = tree_->GetKey(entry).compare(key);
+    if (result == 0) {
+      if (out_value)
+        *out_value = ArenaValue(tree_, entry.node);
+      return true;
+    }
+    if (result < 0)
+      low = middle + 1;
+    else
+      high = middle;
+  }
+  return false;
+}
+
+bool ArenaValue::Get(const StringPiece& path, ArenaValue* out_value) const {
+  ArenaValue current = *this;
+  StringPiece remaining = path;
+  for (size_t delimiter_position = remaining.find('.');
+       delimiter_position != StringPiece::npos;
+       delimiter_position = remaining.find('.')) {
+    if (!current.GetWithoutPathExpansion(
+            remaining.substr(0, delimiter_position), &current)) {
+      return false;
+    }
+    remaining = remaining.substr(delimiter_position + 1);
+  }
+  return current.GetWithoutPathExpansion(remaining, out_value);
+}
+
+bool ArenaValue::GetBoolean(const StringPiece& path, bool* out_value) const {
+  ArenaValue value;
+  return Get(path, &value) && value.GetAsBoolean(out_value);
+}
+
+bool ArenaValue::GetInteger(const StringPiece& path, int* out_value) const {
+  ArenaValue value;
+  return Get(path, &value) && value.GetAsInteger(out_value);
+}
+
+bool ArenaValue::GetDouble(const StringPiece& path, double* out_value) const {
+  ArenaValue value;
+  return Get(path, &value) && value.GetAsDouble(out_value);
+}
+
+bool ArenaValue::GetString(const StringPiece& path,
+                           std::string* out_value) const {
+  ArenaValue value;
+  StringPiece string_value;
+  if (!Get(path, &value) || !value.GetAsString(&string_value))
+    return false;
+  if (out_value)
+    string_value.CopyToString(out_value);
+  return true;
+}
+
+scoped_ptr<Value> ArenaValue::ToValue() const {
+  switch (GetType()) {
+    case Value::TYPE_NULL:
+      return make_scoped_ptr(Value::CreateNullValue());
+    case Value::TYPE_BOOLEAN: {
+      bool value = false;
+      GetAsBoolean(&value);
+      return make_scoped_ptr(new FundamentalValue(value));
+    }
+    case Value::TYPE_INTEGER: {
+      int value = 0;
+      GetAsInteger(&value);
+      return make_scoped_ptr(new FundamentalValue(value));
+    }
+    case Value::TYPE_DOUBLE: {
+      double value = 0;
+      GetAsDouble(&value);
+      return make_scoped_ptr(new FundamentalValue(value));
+    }
+    case Value::TYPE_STRING: {
+      StringPiece value;
+      GetAsString(&value);
+      return make_scoped_ptr(new StringValue(value.as_string()));
+    }
+    case Value::TYPE_BINARY: {
+      StringPiece value;
+      GetAsBinary(&value);
+      return make_scoped_ptr(
+          BinaryValue::CreateWithCopiedBuffer(value.data(), value.size()));
+    }
+    case Value::TYPE_DICTIONARY: {
+      scoped_ptr<DictionaryValue> dictionary(new DictionaryValue);
+      for (DictionaryIterator it(*this); !it.IsAtEnd(); it.Advance()) {
+        dictionary->SetWithoutPathExpansion(it.key().as_string(),
+                                            it.value().ToValue());
+      }
+      return dictionary.Pass();
+    }
+    case Value::TYPE_LIST: {
+      scoped_ptr<ListValue> list(new ListValue);
+      ArenaValue item;
+      for (size_t i = 0; GetListItem(i, &item); ++i)
+        list->Append(item.ToValue().release());
+      return list.Pass();
+    }
+  }
+  NOTREACHED();
+  return scoped_ptr<Value>();
+}
+
+bool ArenaValue::Equals(const Value& other) const {
+  if (other.GetType() != GetType())
+    return false;
+
+  switch (GetType()) {
+    case Value::TYPE_NULL:
+      return true;
+    case Value::TYPE_BOOLEAN: {
+      bool lhs, rhs;
+      return GetAsBoolean(&lhs) && other.GetAsBoolean(&rhs) && lhs == rhs;
+    }
+    case Value::TYPE_INTEGER: {
+      int lhs, rhs;
+      return GetAsInteger(&lhs) && other.GetAsInteger(&rhs) && lhs == rhs;
+    }
+    case Value::TYPE_DOUBLE: {
+      double lhs, rhs;
+      return GetAsDouble(&lhs) && other.GetAsDouble(&rhs) && lhs == rhs;
+    }
+    case Value::TYPE_STRING: {
+      StringPiece lhs;
+      std::string rhs;
+      return GetAsString(&lhs) && other.GetAsString(&rhs) && lhs == rhs;
+    }
+    case Value::TYPE_BINARY: {
+      StringPiece lhs;
+      GetAsBinary(&lhs);
+      const BinaryValue& rhs = static_cast<const BinaryValue&>(other);
+      return lhs == StringPiece(rhs.GetBuffer(), rhs.GetSize());
+    }
+    case Value::TYPE_DICTIONARY: {
+      const DictionaryValue* rhs = NULL;
+      other.GetAsDictionary(&rhs);
+      if (rhs->size() != size())
+        return false;
+      for (DictionaryValue::Iterator it(*rhs); !it.IsAtEnd(); it.Advance()) {
+        ArenaValue lhs;
+        if (!GetWithoutPathExpansion(it.key(), &lhs) ||
+            !lhs.Equals(it.value())) {
+          return false;
+        }
+      }
+      return true;
+    }
+    case Value::TYPE_LIST: {
+      const ListValue* rhs = NULL;
+      other.GetAsList(&rhs);
+      if (rhs->GetSize() != size())
+        return false;
+      ArenaValue lhs;
+      for (size_t i = 0; GetListItem(i, &lhs); ++i) {
+        const Value* rhs_item = NULL;
+        rhs->Get(i, &rhs_item);
+        if (!lhs.Equals(*rhs_item))
+          return false;
+      }
+      return true;
+    }
+  }
+  NOTREACHED();
+  return false;
+}
+
+ArenaValue::DictionaryIterator::DictionaryIterator(
+    const ArenaValue& dictionary)
+    : tree_(dictionary.tree_),
+      index_(0),
+      end_(0) {
+  DCHECK(dictionary.IsType(Value::TYPE_DICTIONARY));
+  const ArenaValueTree::Node& node = tree_->nodes_[dictionary.node_];
+  index_ = node.offset;
+  end_ = node.offset + node.size;
+}
+
+StringPiece ArenaValue::DictionaryIterator::key() const {
+  DCHECK(!IsAtEnd());
+  return tree_->GetKey(tree_->entries_[index_]);
+}
+
+ArenaValue ArenaValue::DictionaryIterator::value() const {
+  DCHECK(!IsAtEnd());
+  return ArenaValue(tree_, tree_->entries_[index_].node);
+}
+
+///////////////////// ArenaValueTree ////////////////////
+
+ArenaValueTree::ArenaValueTree() {
+}
+
+ArenaValueTree::~ArenaValueTree() {
+}
+
+// static
+scoped_ptr<ArenaValueTree> ArenaValueTree::CreateFromJSON(
+    const StringPiece& json,
+    int options) {
+  ArenaValueBuilder builder;
+  if (!JSONReader::ParseStreaming(json, options, &builder, NULL, NULL))
+    return scoped_ptr<ArenaValueTree>();
+  return builder.PassTree();
+}
+
+// static
+scoped_ptr<ArenaValueTree> ArenaValueTree::CreateFromValue(
+    const Value& value) {
+  ArenaValueBuilder builder;
+  builder.AddValue(value);
+  return builder.PassTree();
+}
+
+scoped_ptr<ArenaValueTree> ArenaValueTree::Clone() const {
+  scoped_ptr<ArenaValueTree> clone(new ArenaValueTree);
+  clone->nodes_ = nodes_;
+  clone->entries_ = entries_;
+  clone->strings_ = strings_;
+  return clone.Pass();
+}
+
+size_t ArenaValueTree::EstimateMemoryUsage() const {
+  return sizeof(*this) + nodes_.capacity() * sizeof(Node) +
+         entries_.capacity() * sizeof(Entry) + strings_.capacity();
+}
+
+///////////////////// ArenaValueBuilder ////////////////////
+
+ArenaValueBuilder::ArenaValueBuilder()
+    : tree_(new ArenaValueTree),
+      key_offset_(0),
+      key_length_(0) {
+}
+
+ArenaValueBuilder::~ArenaValueBuilder() {
+}
+
+void ArenaValueBuilder::AddValue(const Value& value) {
+  switch (value.GetType()) {
+    case Value::TYPE_NULL:
+      OnNull();
+      break;
+    case Value::TYPE_BOOLEAN: {
+      bool bool_value = false;
+      value.GetAsBoolean(&bool_value);
+      OnBoolean(bool_value);
+      break;
+    }
+    case Value::TYPE_INTEGER: {
+      int int_value = 0;
+      value.GetAsInteger(&int_value);
+      OnInteger(int_value);
+      break;
+    }
+    case Value::TYPE_DOUBLE: {
+      double double_value = 0;
+      value.GetAsDouble(&double_value);
+      OnDouble(double_value);
+      break;
+    }
+    case Value::TYPE_STRING: {
+      // Values created by JSONParser may not be StringValues.
+      const StringValue* string_value = NULL;
+      if (value.GetAsString(&string_value)) {
+        OnString(string_value->GetString());
+      } else {
+        std::string string_copy;
+        value.GetAsString(&string_copy);
+        OnString(string_copy);
+      }
+      break;
+    }
+    case Value::TYPE_BINARY: {
+      const BinaryValue& binary_value = static_cast<const BinaryValue&>(value);
+      AddStringNode(Value::TYPE_BINARY,
+                    StringPiece(binary_value.GetBuffer(),
+                                binary_value.GetSize()));
+      break;
+    }
+    case Value::TYPE_DICTIONARY: {
+      const DictionaryValue* dictionary = NULL;
+      value.GetAsDictionary(&dictionary);
+      OnDictionaryBegin();
+      for (DictionaryValue::Iterator it(*dictionary); !it.IsAtEnd();
+           it.Advance()) {
+        OnDictionaryKey(it.key());
+        AddValue(it.value());
+      }
+      OnDictionaryEnd();
+      break;
+    }
+    case Value::TYPE_LIST: {
+      const ListValue* list = NULL;
+      value.GetAsList(&list);
+      OnListBegin();
+      for (ListValue::const_iterator it = list->begin(); it != list->end();
+           ++it) {
+        AddValue(**it);
+      }
+      OnListEnd();
+      break;
+    }
+  }
+}
+
+bool ArenaValueBuilder::has_value() const {
+  return !tree_->nodes_.empty() && open_containers_.empty();
+}
+
+scoped_ptr<ArenaValueTree> ArenaValueBuilder::PassTree() {
+  scoped_ptr<ArenaValueTree> tree;
+  if (has_value())
+    tree = tree_.Pass();
+  tree_.reset(new ArenaValueTree);
+  pending_entries_.clear();
+  open_containers_.clear();
+  return tree.Pass();
+}
+
+bool ArenaValueBuilder::OnNull() {
+  AddNode(Value::TYPE_NULL);
+  return true;
+}
+
+bool ArenaValueBuilder::OnBoolean(bool value) {
+  tree_->nodes_[AddNode(Value::TYPE_BOOLEAN)].bool_value = value;
+  return true;
+}
+
+bool ArenaValueBuilder::OnInteger(int value) {
+  tree_->nodes_[AddNode(Value::TYPE_INTEGER)].int_value = value;
+  return true;
+}
+
+bool ArenaValueBuilder::OnDouble(double value) {
+  tree_->nodes_[AddNode(Value::TYPE_DOUBLE)].double_value = value;
+  return true;
+}
+
+bool ArenaValueBuilder::OnString(const StringPiece& value) {
+  AddStringNode(Value::TYPE_STRING, value);
+  return true;
+}
+
+bool ArenaValueBuilder::OnDictionaryBegin() {
+  BeginContainer(Value::TYPE_DICTIONARY);
+  return true;
+}
+
+bool ArenaValueBuilder::OnDictionaryKey(const StringPiece& key) {
+  DCHECK(!open_containers_.empty());
+  key_offset_ = AddString(key);
+  key_length_ = static_cast<uint32>(key.size());
+  return true;
+}
+
+bool ArenaValueBuilder::OnDictionaryEnd() {
+  DCHECK(tree_->nodes_[open_containers_.back().node].type ==
+         Value::TYPE_DICTIONARY);
+  EndContainer();
+  return true;
+}
+
+bool ArenaValueBuilder::OnListBegin() {
+  BeginContainer(Value::TYPE_LIST);
+  return true;
+}
+
+bool ArenaValueBuilder::OnListEnd() {
+  DCHECK(tree_->nodes_[open_containers_.back().node].type == Value::TYPE_LIST);
+  EndContainer();
+  return true;
+}
+
+uint32 ArenaValueBuilder::AddNode(Value::Type type) {
+  // Only a single root value is allowed.
+  DCHECK(tree_->nodes_.empty() || !open_containers_.empty());
+
+  ArenaValueTree::Node node;
+  node.type = type;
+  node.size = 0;
+  node.offset = 0;
+  uint32 index = static_cast<uint32>(tree_->nodes_.size());
+  tree_->nodes_.push_back(node);
+
+  if (!open_containers_.empty()) {
+    ArenaValueTree::Entry entry = { 0, 0, index };
+    if (tree_->nodes_[open_containers_.back().node].type ==
+        Value::TYPE_DICTIONARY) {
+      entry.key_offset = key_offset_;
+      entry.key_length = key_length_;
+    }
+    pending_entries_.push_back(entry);
+  }
+  return index;
+}
+
+uint32 ArenaValueBuilder::AddStringNode(Value::Type type,
+                                        const StringPiece& value) {
+  uint32 index = AddNode(type);
+  ArenaValueTree::Node& node = tree_->nodes_[index];
+  node.offset = AddString(value);
+  node.size = static_cast<uint32>(value.size());
+  return index;
+}
+
+uint32 ArenaValueBuilder::AddString(const StringPiece& data) {
+  uint32 offset = static_cast<uint32>(tree_->strings_.size());
+  tree_->strings_.append(data.data(), data.size());
+  return offset;
+}
+
+void ArenaValueBuilder::BeginContainer(Value::Type type) {
+  OpenContainer container;
+  container.node = AddNode(type);
+  container.first_entry = pending_entries_.size();
+  open_containers_.push_back(container);
+}
+
+void ArenaValueBuilder::EndContainer() {
+  const OpenContainer container = open_containers_.back();
+  open_containers_.pop_back();
+
+  std::vector<ArenaValueTree::Entry>::iterator first =
+      pending_entries_.begin() + container.first_entry;
+  std::vector<ArenaValueTree::Entry>::iterator last = pending_entries_.end();
+  ArenaValueTree::Node& node = tree_->nodes_[container.node];
+  if (node.type == Value::TYPE_DICTIONARY) {
+    // Sort the entries by key. Of entries with the same key only the last
+    // one is kept, as with DictionaryValue::Set().
+    std::sort(first, last, EntryLess(tree_->strings_));
+    std::vector<ArenaValueTree::Entry>::iterator out = first;
+    for (std::vector<ArenaValueTree::Entry>::iterator it = first; it != last;
+         ++it) {
+      if (it + 1 != last &&
+          tree_->GetKey(*it) == tree_->GetKey(*(it + 1))) {
+        continue;
+      }
+      *out++ = *it;
+    }
+    last = out;
+  }
+
+  node.offset = static_cast<uint32>(tree_->entries_.size());
+  node.size = static_cast<uint32>(last - first);
+  tree_->entries_.insert(tree_->entries_.end(), first, last);
+  pending_entries_.resize(container.first_entry);
+}
+
+}  // namespace base
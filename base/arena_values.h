@@ -0,0 +1,240 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// A compact, read-only representation of a Value tree. Where a Value tree is
+// a graph of individually allocated nodes, with a std::map and a std::string
+// per dictionary entry, an ArenaValueTree keeps all of its nodes, dictionary
+// entries and strings in three flat arrays. Building a tree therefore takes a
+// number of allocations that is logarithmic in its size (constant if the
+// arrays are reserved up front), destroying it takes three deallocations, and
+// Clone() copies three arrays of plain data.
+//
+// Dictionaries are stored as sorted arrays of entries and are searched with a
+// binary search, which for the small dictionaries that make up most JSON and
+// pref data is also faster than a std::map lookup.
+//
+// Trees are built with an ArenaValueBuilder, either from the events of a
+// JSONStreamParser or from a Value, and are immutable afterwards. Values of
+// the tree are accessed through ArenaValue handles:
+//
+//   scoped_ptr<ArenaValueTree> tree = ArenaValueTree::CreateFromJSON(json);
+//   std::string name;
+//   tree->root().GetString("user.name", &name);
+
+#ifndef BASE_ARENA_VALUES_H_
+#define BASE_ARENA_VALUES_H_
+
+#include <string>
+#include <vector>
+
+#include "base/base_export.h"
+#include "base/basictypes.h"
+#include "base/compiler_specific.h"
+#include "base/json/json_stream_parser.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/strings/string_piece.h"
+#include "base/values.h"
+
+namespace base {
+
+class ArenaValueTree;
+
+// A handle to a value of an ArenaValueTree. Handles are cheap to copy and
+// are only valid as long as their tree.
+class BASE_EXPORT ArenaValue {
+ public:
+  ArenaValue();
+
+  Value::Type GetType() const;
+  bool IsType(Value::Type type) const { return GetType() == type; }
+
+  // Like the Value methods of the same names. Values of both type
+  // TYPE_INTEGER and TYPE_DOUBLE can be obtained as doubles. Strings and
+  // binary data are returned as pieces of the tree.
+  bool GetAsBoolean(bool* out_value) const;
+  bool GetAsInteger(int* out_value) const;
+  bool GetAsDouble(double* out_value) const;
+  bool GetAsString(StringPiece* out_value) const;
+  bool GetAsBinary(StringPiece* out_value) const;
+
+  // Returns the number of entries of a list or dictionary, and 0 for other
+  // types.
+  size_t size() const;
+
+  // Gets the |index|-th element of a list.
+  bool GetListItem(size_t index, ArenaValue* out_value) const;
+
+  // Gets the value for |key| in a dictionary.
+  bool GetWithoutPathExpansion(const StringPiece& key,
+                               ArenaValue* out_value) const;
+
+  // Like DictionaryValue::Get(), "." in |path| indexes into the next
+  // dictionary down.
+  bool Get(const StringPiece& path, ArenaValue* out_value) const;
+
+  // Convenience forms of Get().
+  bool GetBoolean(const StringPiece& path, bool* out_value) const;
+  bool GetInteger(const StringPiece& path, int* out_value) const;
+  bool GetDouble(const StringPiece& path, double* out_value) const;
+  bool GetString(const StringPiece& path, std::string* out_value) const;
+
+  // Converts this value and everything below it into a Value tree.
+  scoped_ptr<Value> ToValue() const;
+
+  // Compares the contents with those of |other|.
+  bool Equals(const Value& other) const;
+
+  // Iterates over the entries of a dictionary in key order.
+  class BASE_EXPORT DictionaryIterator {
+   public:
+    explicit DictionaryIterator(const ArenaValue& dictionary);
+
+    bool IsAtEnd() const { return index_ == end_; }
+    void Advance() { ++index_; }
+
+    StringPiece key() const;
+    ArenaValue value() const;
+
+   private:
+    const ArenaValueTree* tree_;
+    // The current and the end index in the entries of |tree_|.
+    size_t index_;
+    size_t end_;
+  };
+
+ private:
+  friend class ArenaValueTree;
+
+  ArenaValue(const ArenaValueTree* tree, uint32 node);
+
+  const ArenaValueTree* tree_;
+  uint32 node_;
+};
+
+class BASE_EXPORT ArenaValueTree {
+ public:
+  ~ArenaValueTree();
+
+  // Parses |json| straight into a tree. Returns NULL if |json| is malformed.
+  static scoped_ptr<ArenaValueTree> CreateFromJSON(const StringPiece& json,
+                                                   int options);
+
+  // Copies |value| into a tree.
+  static scoped_ptr<ArenaValueTree> CreateFromValue(const Value& value);
+
+  ArenaValue root() const { return ArenaValue(this, 0); }
+
+  // Returns a copy of the tree.
+  scoped_ptr<ArenaValueTree> Clone() const;
+
+  // Returns the approximate number of bytes used by the tree.
+  size_t EstimateMemoryUsage() const;
+
+ private:
+  friend class ArenaValue;
+  friend class ArenaValueBuilder;
+
+  struct Node {
+    Value::Type type;
+    // The length of a string or binary value, or the number of entries of a
+    // list or dictionary.
+    uint32 size;
+    union {
+      bool bool_value;
+      int int_value;
+      double double_value;
+      // Offset of the data of a string or binary value in |strings_|, or of
+      // the entries of a list or dictionary in |entries_|.
+      uint32 offset;
+    };
+  };
+
+  // An element of a list or dictionary. The key of list elements is empty.
+  struct Entry {
+    uint32 key_offset;
+    uint32 key_length;
+    uint32 node;
+  };
+
+  ArenaValueTree();
+
+  StringPiece GetString(uint32 offset, uint32 length) const {
+    return StringPiece(strings_.data() + offset, length);
+  }
+  StringPiece GetKey(const Entry& entry) const {
+    return GetString(entry.key_offset, entry.key_length);
+  }
+
+  std::vector<Node> nodes_;
+  std::vector<Entry> entries_;
+  std::string strings_;
+
+  DISALLOW_COPY_AND_ASSIGN(ArenaValueTree);
+};
+
+// Builds an ArenaValueTree out of JSONParserVisitor events, e.g. by passing
+// it to JSONReader::ParseStreaming().
+class BASE_EXPORT ArenaValueBuilder : public JSONParserVisitor {
+ public:
+  ArenaValueBuilder();
+  ~ArenaValueBuilder() override;
+
+  // Adds |value| as if its events had been received.
+  void AddValue(const Value& value);
+
+  // Returns whether a complete value has been built.
+  bool has_value() const;
+
+  // Returns the tree built so far and resets the builder.
+  scoped_ptr<ArenaValueTree> PassTree();
+
+  // JSONParserVisitor:
+  bool OnNull() override;
+  bool OnBoolean(bool value) override;
+  bool OnInteger(int value) override;
+  bool OnDouble(double value) override;
+  bool OnString(const StringPiece& value) override;
+  bool OnDictionaryBegin() override;
+  bool OnDictionaryKey(const StringPiece& key) override;
+  bool OnDictionaryEnd() override;
+  bool OnListBegin() override;
+  bool OnListEnd() override;
+
+ private:
+  // A list or dictionary whose entries are still being collected.
+  struct OpenContainer {
+    uint32 node;
+    // Index of the first entry of the container in |pending_entries_|.
+    size_t first_entry;
+  };
+
+  // Appends a node of |type| and attaches it to the innermost open
+  // container. Returns its index.
+  uint32 AddNode(Value::Type type);
+  uint32 AddStringNode(Value::Type type, const StringPiece& value);
+
+  // Appends |data| to the strings of the tree and returns its offset.
+  uint32 AddString(const StringPiece& data);
+
+  void BeginContainer(Value::Type type);
+  void EndContainer();
+
+  scoped_ptr<ArenaValueTree> tree_;
+
+  // Entries of all open containers, innermost last. A container's entries
+  // are moved to the tree once it is complete, so that the entries of every
+  // container are contiguous.
+  std::vector<ArenaValueTree::Entry> pending_entries_;
+  std::vector<OpenContainer> open_containers_;
+
+  // The key of the next value added to a dictionary.
+  uint32 key_offset_;
+  uint32 key_length_;
+
+  DISALLOW_COPY_AND_ASSIGN(ArenaValueBuilder);
+};
+
+}  // namespace base
+
+#endif  // BASE_ARENA_VALUES_H_
@@ -0,0 +1,93 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/arena_values.h"
+
+#include <string>
+
+#include "base/json/json_reader.h"
+#include "base/json/json_writer.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/strings/stringprintf.h"
+#include "base/time/time.h"
+#include "base/values.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_test.h"
+
+namespace base {
+
+namespace {
+
+const int kIterations = 20;
+
+// Returns a pref-like tree of |num_entries| small dictionaries.
+scoped_ptr<Value> CreateTestValue(int num_entries) {
+  scoped_ptr<DictionaryValue> root(new DictionaryValue);
+  for (int i = 0; i < num_entries; ++i) {
+    scoped_ptr<DictionaryValue> entry(new DictionaryValue);
+    entry->SetString("name", StringPrintf("entry %d", i));
+    entry->SetInteger("id", i);
+    entry->SetDouble("weight", i / 3.0);
+    entry->SetBoolean("enabled", i % 2 == 0);
+    scoped_ptr<ListValue> tags(new ListValue);
+    tags->AppendString("a");
+    tags->AppendString("b");
+    entry->Set("tags", tags.Pass());
+    root->SetWithoutPathExpansion(StringPrintf("key%d", i), entry.Pass());
+  }
+  return root.Pass();
+}
+
+void PrintTime(const std::string& trace, TimeDelta elapsed) {
+  perf_test::PrintResult("arena_values", "", trace,
+                         elapsed.InMillisecondsF() / kIterations, "ms", true);
+}
+
+// Compares building, copying and destroying Value trees with ArenaValueTrees.
+TEST(ArenaValuesPerfTest, BuildCopyDestroy) {
+  scoped_ptr<Value> value = CreateTestValue(10000);
+  std::string json;
+  JSONWriter::Write(value.get(), &json);
+
+  TimeTicks start = TimeTicks::HighResNow();
+  for (int i = 0; i < kIterations; ++i)
+    delete JSONReader::Read(json, JSON_DETACHABLE_CHILDREN);
+  PrintTime("value_parse_and_destroy", TimeTicks::HighResNow() - start);
+
+  start = TimeTicks::HighResNow();
+  for (int i = 0; i < kIterations; ++i)
+    ArenaValueTree::CreateFromJSON(json, JSON_PARSE_RFC);
+  PrintTime("arena_parse_and_destroy", TimeTicks::HighResNow() - start);
+
+  start = TimeTicks::HighResNow();
+  for (int i = 0; i < kIterations; ++i)
+    delete value->DeepCopy();
+  PrintTime("value_deep_copy", TimeTicks::HighResNow() - start);
+
+  scoped_ptr<ArenaValueTree> tree = ArenaValueTree::CreateFromValue(*value);
+  start = TimeTicks::HighResNow();
+  for (int i = 0; i < kIterations; ++i)
+    tree->Clone();
+  PrintTime("arena_clone", TimeTicks::HighResNow() - start);
+
+  int id = 0;
+  start = TimeTicks::HighResNow();
+  for (int i = 0; i < kIterations * 1000; ++i) {
+    DictionaryValue* dictionary = static_cast<DictionaryValue*>(value.get());
+    dictionary->GetInteger(StringPrintf("key%d.id", i % 10000), &id);
+  }
+  PrintTime("value_lookup_x1000", TimeTicks::HighResNow() - start);
+
+  start = TimeTicks::HighResNow();
+  for (int i = 0; i < kIterations * 1000; ++i)
+    tree->root().GetInteger(StringPrintf("key%d.id", i % 10000), &id);
+  PrintTime("arena_lookup_x1000", TimeTicks::HighResNow() - start);
+
+  perf_test::PrintResult("arena_values", "", "arena_tree_memory",
+                         tree->EstimateMemoryUsage(), "bytes", true);
+}
+
+}  // namespace
+
+}  // namespace base
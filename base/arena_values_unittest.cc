@@ -0,0 +1,174 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/arena_values.h"
+
+#include <string>
+
+#include "base/json/json_reader.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/values.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+
+namespace {
+
+const char kJSON[] =
+    "{"
+    "  \"bool\": true,"
+    "  \"int\": 42,"
+    "  \"double\": 1.5,"
+    "  \"string\": \"hello\","
+    "  \"null\": null,"
+    "  \"list\": [1, \"two\", [3], {\"four\": 4}],"
+    "  \"dict\": {\"b\": {\"c\": \"nested\"}, \"a\": []},"
+    "  \"dup\": 1,"
+    "  \"dup\": 2"
+    "}";
+
+}  // namespace
+
+TEST(ArenaValuesTest, CreateFromJSON) {
+  scoped_ptr<ArenaValueTree> tree =
+      ArenaValueTree::CreateFromJSON(kJSON, JSON_PARSE_RFC);
+  ASSERT_TRUE(tree);
+  ArenaValue root = tree->root();
+  ASSERT_TRUE(root.IsType(Value::TYPE_DICTIONARY));
+  EXPECT_EQ(8U, root.size());
+
+  bool bool_value = false;
+  EXPECT_TRUE(root.GetBoolean("bool", &bool_value));
+  EXPECT_TRUE(bool_value);
+  int int_value = 0;
+  EXPECT_TRUE(root.GetInteger("int", &int_value));
+  EXPECT_EQ(42, int_value);
+  double double_value = 0;
+  EXPECT_TRUE(root.GetDouble("double", &double_value));
+  EXPECT_EQ(1.5, double_value);
+  EXPECT_TRUE(root.GetDouble("int", &double_value));
+  EXPECT_EQ(42, double_value);
+  EXPECT_FALSE(root.GetInteger("double", &int_value));
+  std::string string_value;
+  EXPECT_TRUE(root.GetString("string", &string_value));
+  EXPECT_EQ("hello", string_value);
+  EXPECT_TRUE(root.GetString("dict.b.c", &string_value));
+  EXPECT_EQ("nested", string_value);
+  EXPECT_FALSE(root.GetString("dict.b", &string_value));
+  EXPECT_FALSE(root.GetString("dict.b.c.d", &string_value));
+  EXPECT_FALSE(root.GetString("missing", &string_value));
+
+  ArenaValue null_value;
+  EXPECT_TRUE(root.GetWithoutPathExpansion("null", &null_value));
+  EXPECT_TRUE(null_value.IsType(Value::TYPE_NULL));
+
+  // The last of duplicate keys wins, as with DictionaryValue.
+  EXPECT_TRUE(root.GetInteger("dup", &int_value));
+  EXPECT_EQ(2, int_value);
+
+  ArenaValue list;
+  ASSERT_TRUE(root.Get("list", &list));
+  ASSERT_TRUE(list.IsType(Value::TYPE_LIST));
+  EXPECT_EQ(4U, list.size());
+  ArenaValue item;
+  EXPECT_TRUE(list.GetListItem(1, &item));
+  StringPiece string_piece;
+  EXPECT_TRUE(item.GetAsString(&string_piece));
+  EXPECT_EQ("two", string_piece);
+  EXPECT_TRUE(list.GetListItem(3, &item));
+  EXPECT_TRUE(item.GetInteger("four", &int_value));
+  EXPECT_EQ(4, int_value);
+  EXPECT_FALSE(list.GetListItem(4, &item));
+
+  // Dictionaries are iterated in key order.
+  ArenaValue dict;
+  ASSERT_TRUE(root.Get("dict", &dict));
+  ArenaValue::DictionaryIterator it(dict);
+  ASSERT_FALSE(it.IsAtEnd());
+  EXPECT_EQ("a", it.key());
+  EXPECT_TRUE(it.value().IsType(Value::TYPE_LIST));
+  it.Advance();
+  ASSERT_FALSE(it.IsAtEnd());
+  EXPECT_EQ("b", it.key());
+  it.Advance();
+  EXPECT_TRUE(it.IsAtEnd());
+
+  EXPECT_FALSE(ArenaValueTree::CreateFromJSON("{\"a\": }", JSON_PARSE_RFC));
+}
+
+TEST(ArenaValuesTest, ConvertToAndFromValue) {
+  scoped_ptr<Value> value(JSONReader::Read(kJSON));
+  ASSERT_TRUE(value);
+  scoped_ptr<ArenaValueTree> tree =
+      ArenaValueTree::CreateFromJSON(kJSON, JSON_PARSE_RFC);
+  ASSERT_TRUE(tree);
+  EXPECT_TRUE(tree->root().Equals(*value));
+  EXPECT_TRUE(value->Equals(tree->root().ToValue().get()));
+
+  DictionaryValue* dictionary = NULL;
+  ASSERT_TRUE(value->GetAsDictionary(&dictionary));
+  dictionary->Set("binary", BinaryValue::CreateWithCopiedBuffer("\0x", 2));
+  EXPECT_FALSE(tree->root().Equals(*value));
+
+  scoped_ptr<ArenaValueTree> from_value =
+      ArenaValueTree::CreateFromValue(*value);
+  ASSERT_TRUE(from_value);
+  EXPECT_TRUE(from_value->root().Equals(*value));
+  EXPECT_TRUE(value->Equals(from_value->root().ToValue().get()));
+
+  ArenaValue binary;
+  ASSERT_TRUE(from_value->root().Get("binary", &binary));
+  StringPiece binary_data;
+  EXPECT_TRUE(binary.GetAsBinary(&binary_data));
+  EXPECT_EQ(StringPiece("\0x", 2), binary_data);
+
+  // Scalar roots.
+  FundamentalValue int_value(3);
+  scoped_ptr<ArenaValueTree> int_tree =
+      ArenaValueTree::CreateFromValue(int_value);
+  EXPECT_TRUE(int_tree->root().Equals(int_value));
+  EXPECT_FALSE(int_tree->root().Equals(FundamentalValue(3.0)));
+}
+
+TEST(ArenaValuesTest, Clone) {
+  scoped_ptr<ArenaValueTree> tree =
+      ArenaValueTree::CreateFromJSON(kJSON, JSON_PARSE_RFC);
+  ASSERT_TRUE(tree);
+  scoped_ptr<Value> value = tree->root().ToValue();
+
+  scoped_ptr<ArenaValueTree> clone = tree->Clone();
+  tree.reset();
+  EXPECT_TRUE(clone->root().Equals(*value));
+}
+
+TEST(ArenaValuesTest, Builder) {
+  ArenaValueBuilder builder;
+  EXPECT_FALSE(builder.has_value());
+  builder.OnListBegin();
+  builder.OnInteger(1);
+  EXPECT_FALSE(builder.has_value());
+  EXPECT_FALSE(builder.PassTree());
+
+  // PassTree() reset the builder.
+  builder.OnListBegin();
+  builder.OnDictionaryBegin();
+  builder.OnDictionaryKey("z");
+  builder.OnString("last");
+  builder.OnDictionaryKey("y");
+  builder.OnListBegin();
+  builder.OnNull();
+  builder.OnListEnd();
+  builder.OnDictionaryEnd();
+  builder.OnDouble(2.5);
+  builder.OnListEnd();
+  EXPECT_TRUE(builder.has_value());
+  scoped_ptr<ArenaValueTree> tree = builder.PassTree();
+  ASSERT_TRUE(tree);
+
+  scoped_ptr<Value> expected(
+      JSONReader::Read("[{\"z\": \"last\", \"y\": [null]}, 2.5]"));
+  EXPECT_TRUE(tree->root().Equals(*expected));
+}
+
+}  // namespace base
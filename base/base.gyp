@@ -454,6 +454,7 @@
         'android/path_utils_unittest.cc',
         'android/scoped_java_ref_unittest.cc',
         'android/sys_utils_unittest.cc',
+        'arena_values_unittest.cc',
         'async_socket_io_handler_unittest.cc',
         'at_exit_unittest.cc',
         'atomicops_unittest.cc',
@@ -486,7 +487,9 @@
         'debug/stack_trace_unittest.cc',
         'debug/task_annotator_unittest.cc',
         'debug/trace_event_argument_unittest.cc',
+        'debug/trace_event_binary_unittest.cc',
         'debug/trace_event_memory_unittest.cc',
+        'debug/trace_event_stack_sampler_linux_unittest.cc',
         'debug/trace_event_synthetic_delay_unittest.cc',
         'debug/trace_event_system_stats_monitor_unittest.cc',
         'debug/trace_event_unittest.cc',
@@ -523,6 +526,7 @@
         'ios/weak_nsobject_unittest.mm',
         'json/json_parser_unittest.cc',
         'json/json_reader_unittest.cc',
+        'json/json_stream_parser_unittest.cc',
         'json/json_value_converter_unittest.cc',
         'json/json_value_serializer_unittest.cc',
         'json/json_writer_unittest.cc',
@@ -550,6 +554,7 @@
         'memory/scoped_vector_unittest.cc',
         'memory/shared_memory_unittest.cc',
         'memory/singleton_unittest.cc',
+        'memory/slab_allocator_unittest.cc',
         'memory/weak_ptr_unittest.cc',
         'memory/weak_ptr_unittest.nc',
         'message_loop/message_loop_proxy_impl_unittest.cc',
@@ -566,6 +571,8 @@
         'metrics/histogram_delta_serialization_unittest.cc',
         'metrics/histogram_snapshot_manager_unittest.cc',
         'metrics/histogram_unittest.cc',
+        'metrics/persistent_histogram_allocator_unittest.cc',
+        'metrics/persistent_memory_allocator_unittest.cc',
         'metrics/sparse_histogram_unittest.cc',
         'metrics/stats_table_unittest.cc',
         'metrics/statistics_recorder_unittest.cc',
@@ -620,9 +627,11 @@
         'strings/utf_string_conversions_unittest.cc',
         'supports_user_data_unittest.cc',
         'sync_socket_unittest.cc',
+        'synchronization/adaptive_lock_unittest.cc',
         'synchronization/cancellation_flag_unittest.cc',
         'synchronization/condition_variable_unittest.cc',
         'synchronization/lock_unittest.cc',
+        'synchronization/read_write_lock_unittest.cc',
         'synchronization/waitable_event_unittest.cc',
         'synchronization/waitable_event_watcher_unittest.cc',
         'sys_info_unittest.cc',
@@ -655,6 +664,7 @@
         'timer/hi_res_timer_manager_unittest.cc',
         'timer/mock_timer_unittest.cc',
         'timer/timer_unittest.cc',
+        'timer/timer_wheel_unittest.cc',
         'tools_sanity_unittest.cc',
         'tracked_objects_unittest.cc',
         'tuple_unittest.cc',
@@ -840,6 +850,12 @@
         '../testing/gtest.gyp:gtest',
       ],
       'sources': [
+        'arena_values_perftest.cc',
+        'callback_perftest.cc',
+        'debug/trace_event_perftest.cc',
+        'strings/string_split_perftest.cc',
+        'strings/utf_string_conversions_perftest.cc',
+        'threading/sequenced_worker_pool_perftest.cc',
         'threading/thread_perftest.cc',
         'message_loop/message_pump_perftest.cc',
         'test/run_all_unittests.cc',
@@ -1067,6 +1083,17 @@
             'base',
           ],
         },
+        {
+          # Converts a trace recorded with the "stream-to-file" option to JSON.
+          'target_name': 'trace_binary_to_json',
+          'type': 'executable',
+          'sources': [
+            'debug/trace_binary_to_json.cc',
+          ],
+          'dependencies': [
+            'base',
+          ],
+        },
         {
           'target_name': 'build_utf8_validator_tables',
           'type': 'executable',
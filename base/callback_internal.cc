@@ -4,14 +4,52 @@
 
 #include "base/callback_internal.h"
 
+#include <algorithm>
+
 #include "base/logging.h"
 
 namespace base {
 namespace internal {
 
+void BindStateBase::AddRef() const {
+  // A count of zero means the BindState is still private to the Callback
+  // being created, so no other thread can be touching it.
+  if (AtomicRefCountIsZero(&ref_count_)) {
+    subtle::NoBarrier_Store(&ref_count_, 1);
+    return;
+  }
+  AtomicRefCountInc(&ref_count_);
+}
+
+void BindStateBase::Release() const {
+  // The holder of the only reference can't race with another AddRef() or
+  // Release(), and AtomicRefCountIsOne() orders it after earlier releases by
+  // other threads.
+  if (AtomicRefCountIsOne(&ref_count_) || !AtomicRefCountDec(&ref_count_))
+    delete this;
+}
+
+bool BindStateBase::HasOneRef() const {
+  return AtomicRefCountIsOne(&ref_count_);
+}
+
 CallbackBase::CallbackBase(const CallbackBase& c) = default;
 CallbackBase& CallbackBase::operator=(const CallbackBase& c) = default;
 
+CallbackBase::CallbackBase(CallbackBase&& c)
+    : polymorphic_invoke_(c.polymorphic_invoke_) {
+  bind_state_.swap(c.bind_state_);
+  c.polymorphic_invoke_ = NULL;
+}
+
+CallbackBase& CallbackBase::operator=(CallbackBase&& c) {
+  bind_state_.swap(c.bind_state_);
+  std::swap(polymorphic_invoke_, c.polymorphic_invoke_);
+  // |c| now holds what |this| held before, and releases it.
+  c.Reset();
+  return *this;
+}
+
 void CallbackBase::Reset() {
   polymorphic_invoke_ = NULL;
   // NULL the bind_state_ last, since it may be holding the last ref to whatever
@@ -10,9 +10,11 @@
 
 #include <stddef.h>
 
+#include "base/atomic_ref_count.h"
 #include "base/base_export.h"
 #include "base/memory/ref_counted.h"
 #include "base/memory/scoped_ptr.h"
+#include "base/memory/slab_allocator.h"
 
 template <typename T>
 class ScopedVector;
@@ -26,10 +28,26 @@ namespace internal {
 // DoInvoke function to perform the function execution.  This allows
 // us to shield the Callback class from the types of the bound argument via
 // "type erasure."
-class BindStateBase : public RefCountedThreadSafe<BindStateBase> {
+//
+// Bound callbacks are created and destroyed for nearly every posted task, so
+// BindStates come from SlabAllocator, and are reference counted without an
+// atomic read-modify-write in the common cases: taking the first reference
+// when the Callback is created, and dropping the last one when it is
+// destroyed. Only copies shared between Callbacks pay for atomic updates.
+class BASE_EXPORT BindStateBase : public SlabAllocated<BindStateBase> {
+ public:
+  void AddRef() const;
+  void Release() const;
+  bool HasOneRef() const;
+
  protected:
-  friend class RefCountedThreadSafe<BindStateBase>;
+  BindStateBase() : ref_count_(0) {}
   virtual ~BindStateBase() {}
+
+ private:
+  mutable AtomicRefCount ref_count_;
+
+  DISALLOW_COPY_AND_ASSIGN(BindStateBase);
 };
 
 // Holds the Callback methods that don't require specialization to reduce
@@ -39,6 +57,11 @@ class BASE_EXPORT CallbackBase {
   CallbackBase(const CallbackBase& c);
   CallbackBase& operator=(const CallbackBase& c);
 
+  // Moving a callback hands over its BindState without touching the reference
+  // count, which is atomic. |c| is null afterwards.
+  CallbackBase(CallbackBase&& c);
+  CallbackBase& operator=(CallbackBase&& c);
+
   // Returns true if Callback is null (doesn't refer to anything).
   bool is_null() const { return bind_state_.get() == NULL; }
 
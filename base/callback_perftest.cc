@@ -0,0 +1,92 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <string>
+
+#include "base/bind.h"
+#include "base/callback.h"
+#include "base/location.h"
+#include "base/message_loop/message_loop.h"
+#include "base/time/time.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_test.h"
+
+namespace base {
+
+namespace {
+
+const int kIterations = 1000000;
+const int kBatchSize = 1000;
+
+class Counter {
+ public:
+  Counter() : count_(0) {}
+
+  void Increment() { ++count_; }
+
+  int count() const { return count_; }
+
+ private:
+  int count_;
+};
+
+void PrintCost(const std::string& trace, TimeTicks start) {
+  perf_test::PrintResult(
+      "callback", "", trace,
+      (TimeTicks::Now() - start).InMillisecondsF() * 1e6 / kIterations, "ns",
+      true);
+}
+
+}  // namespace
+
+// Binds a method with one pointer argument and runs it.
+TEST(CallbackPerfTest, BindAndRun) {
+  Counter counter;
+  TimeTicks start = TimeTicks::Now();
+  for (int i = 0; i < kIterations; ++i)
+    Bind(&Counter::Increment, Unretained(&counter)).Run();
+  PrintCost("bind_and_run", start);
+  EXPECT_EQ(kIterations, counter.count());
+}
+
+// Hands a callback along a chain of holders, by copy and by move.
+TEST(CallbackPerfTest, CopyAndMove) {
+  Counter counter;
+  Closure closures[2];
+  closures[0] = Bind(&Counter::Increment, Unretained(&counter));
+
+  TimeTicks start = TimeTicks::Now();
+  for (int i = 0; i < kIterations; ++i) {
+    closures[(i + 1) % 2] = closures[i % 2];
+    closures[i % 2].Reset();
+  }
+  PrintCost("copy", start);
+
+  start = TimeTicks::Now();
+  for (int i = 0; i < kIterations; ++i)
+    closures[(i + 1) % 2] = static_cast<Closure&&>(closures[i % 2]);
+  PrintCost("move", start);
+
+  closures[0].Run();
+  EXPECT_EQ(1, counter.count());
+}
+
+// Posts tasks to the current loop in batches and runs them, which covers
+// binding, queueing, handing tasks between the loop's queues and running them.
+TEST(CallbackPerfTest, PostTaskAndRun) {
+  MessageLoop loop;
+  Counter counter;
+  TimeTicks start = TimeTicks::Now();
+  for (int i = 0; i < kIterations; i += kBatchSize) {
+    for (int j = 0; j < kBatchSize; ++j) {
+      loop.PostTask(FROM_HERE,
+                    Bind(&Counter::Increment, Unretained(&counter)));
+    }
+    loop.RunUntilIdle();
+  }
+  PrintCost("post_task_and_run", start);
+  EXPECT_EQ(kIterations, counter.count());
+}
+
+}  // namespace base
@@ -127,6 +127,50 @@ TEST_F(CallbackTest, Reset) {
   EXPECT_TRUE(callback_a_.Equals(null_callback_));
 }
 
+class DeletionFlag : public RefCounted<DeletionFlag> {
+ public:
+  explicit DeletionFlag(bool* deleted) : deleted_(deleted) {}
+
+ private:
+  friend class RefCounted<DeletionFlag>;
+  ~DeletionFlag() { *deleted_ = true; }
+
+  bool* deleted_;
+};
+
+void Hold(const scoped_refptr<DeletionFlag>& flag) {
+}
+
+TEST_F(CallbackTest, Move) {
+  Callback<void(void)> copy = callback_a_;
+  Callback<void(void)> moved(
+      static_cast<Callback<void(void)>&&>(callback_a_));
+  EXPECT_TRUE(callback_a_.is_null());
+  EXPECT_TRUE(moved.Equals(copy));
+
+  // Move assignment releases what the target held before.
+  bool deleted = false;
+  Closure holder = Bind(&Hold, make_scoped_refptr(new DeletionFlag(&deleted)));
+  holder = static_cast<Closure&&>(moved);
+  EXPECT_TRUE(deleted);
+  EXPECT_TRUE(moved.is_null());
+  EXPECT_TRUE(holder.Equals(copy));
+}
+
+TEST_F(CallbackTest, CopiesShareBindState) {
+  bool deleted = false;
+  Closure callback =
+      Bind(&Hold, make_scoped_refptr(new DeletionFlag(&deleted)));
+  Closure copy = callback;
+  EXPECT_TRUE(copy.Equals(callback));
+
+  // The bound state lives until the last copy is gone.
+  callback.Reset();
+  EXPECT_FALSE(deleted);
+  copy.Reset();
+  EXPECT_TRUE(deleted);
+}
+
 struct TestForReentrancy {
   TestForReentrancy()
       : cb_already_run(false),
@@ -63,6 +63,15 @@ void TaskAnnotator::RunTask(const char* queue_function,
   pending_task.task.Run();
 
   stopwatch.Stop();
+  // Attribute the task's heap allocations to where it was posted from. These
+  // are zero unless the allocator provides per-thread counts.
+  TRACE_EVENT_INSTANT2(TRACE_DISABLED_BY_DEFAULT("toplevel.heap"),
+                       pending_task.posted_from.function_name(),
+                       TRACE_EVENT_SCOPE_THREAD,
+                       "alloc_bytes",
+                       stopwatch.AllocatedBytes(),
+                       "alloc_count",
+                       stopwatch.AllocationCount());
   tracked_objects::ThreadData::TallyRunOnNamedThreadIfTracking(
       pending_task, stopwatch);
 }
@@ -0,0 +1,54 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Converts a trace file written with the "stream-to-file" trace option into
+// the JSON format that about:tracing loads.
+//
+// Usage: trace_binary_to_json <input> <output>
+
+#include <stdio.h>
+
+#include <string>
+
+#include "base/at_exit.h"
+#include "base/command_line.h"
+#include "base/debug/trace_event_binary.h"
+#include "base/files/file_path.h"
+#include "base/files/file_util.h"
+
+int main(int argc, const char* argv[]) {
+  base::AtExitManager at_exit_manager;
+  base::CommandLine::Init(argc, argv);
+  base::CommandLine::StringVector args =
+      base::CommandLine::ForCurrentProcess()->GetArgs();
+  if (args.size() != 2) {
+    fprintf(stderr, "Usage: %s <input> <output>\n", argv[0]);
+    return 1;
+  }
+
+  std::string data;
+  if (!base::ReadFileToString(base::FilePath(args[0]), &data)) {
+    fprintf(stderr, "Could not read the input file.\n");
+    return 1;
+  }
+
+  base::debug::TraceEventBinaryReader reader(data);
+  std::string json = "[";
+  if (!reader.AppendAllEventsAsJSON(&json)) {
+    // A trace cut short by a crash is still worth looking at.
+    fprintf(stderr, "Warning: the input ends with an incomplete record.\n");
+  }
+  json += "]\n";
+  if (reader.dropped_events()) {
+    fprintf(stderr, "Warning: %d events were dropped while tracing.\n",
+            static_cast<int>(reader.dropped_events()));
+  }
+
+  int size = static_cast<int>(json.size());
+  if (base::WriteFile(base::FilePath(args[1]), json.data(), size) != size) {
+    fprintf(stderr, "Could not write the output file.\n");
+    return 1;
+  }
+  return 0;
+}
@@ -4,113 +4,234 @@
 
 #include "base/debug/trace_event_argument.h"
 
+#include <string.h>
+
+#include "base/debug/trace_event_binary.h"
 #include "base/json/json_writer.h"
 #include "base/values.h"
 
 namespace base {
 namespace debug {
 
-TracedValue::TracedValue() : root_(new DictionaryValue()) {
-  stack_.push_back(root_.get());
+namespace {
+
+// Each value in |data_| starts with one of these tags, followed by its name
+// if it is inside a dictionary, followed by its contents:
+//   kTypeInteger:     zigzag varint
+//   kTypeDouble:      8 bytes in host order
+//   kTypeBoolean:     1 byte
+//   kTypeString:      varint length, bytes
+//   kTypeValue:       varint index into |values_|
+//   kTypeDictionary,
+//   kTypeArray:       the contained values, then kTypeEnd
+// Names are stored like strings.
+const char kTypeInteger = 'i';
+const char kTypeDouble = 'd';
+const char kTypeBoolean = 'b';
+const char kTypeString = 's';
+const char kTypeValue = 'v';
+const char kTypeDictionary = '{';
+const char kTypeArray = '[';
+const char kTypeEnd = '.';
+
+bool ReadStringData(const StringPiece& data,
+                    size_t* offset,
+                    std::string* str) {
+  uint64 length;
+  if (!ReadVarint(data, offset, &length) || length > data.size() - *offset)
+    return false;
+  str->assign(data.data() + *offset, static_cast<size_t>(length));
+  *offset += static_cast<size_t>(length);
+  return true;
+}
+
+}  // namespace
+
+TracedValue::TracedValue() {
+  nesting_stack_.push_back(true);
 }
 
 TracedValue::~TracedValue() {
-  DCHECK_EQ(1u, stack_.size());
+  DCHECK_EQ(1u, nesting_stack_.size());
 }
 
 void TracedValue::SetInteger(const char* name, int value) {
-  GetCurrentDictionary()->SetInteger(name, value);
+  AppendTag(kTypeInteger, name);
+  AppendZigZagVarint(value, &data_);
 }
 
 void TracedValue::SetDouble(const char* name, double value) {
-  GetCurrentDictionary()->SetDouble(name, value);
+  AppendTag(kTypeDouble, name);
+  data_.append(reinterpret_cast<const char*>(&value), sizeof(value));
 }
 
 void TracedValue::SetBoolean(const char* name, bool value) {
-  GetCurrentDictionary()->SetBoolean(name, value);
+  AppendTag(kTypeBoolean, name);
+  data_.push_back(value);
 }
 
 void TracedValue::SetString(const char* name, const std::string& value) {
-  GetCurrentDictionary()->SetString(name, value);
+  AppendTag(kTypeString, name);
+  AppendStringData(value);
 }
 
 void TracedValue::SetValue(const char* name, Value* value) {
-  GetCurrentDictionary()->Set(name, value);
+  AppendTag(kTypeValue, name);
+  AppendVarint(values_.size(), &data_);
+  values_.push_back(value);
 }
 
 void TracedValue::BeginDictionary(const char* name) {
-  DictionaryValue* dictionary = new DictionaryValue();
-  GetCurrentDictionary()->Set(name, dictionary);
-  stack_.push_back(dictionary);
+  AppendTag(kTypeDictionary, name);
+  nesting_stack_.push_back(true);
 }
 
 void TracedValue::BeginArray(const char* name) {
-  ListValue* array = new ListValue();
-  GetCurrentDictionary()->Set(name, array);
-  stack_.push_back(array);
+  AppendTag(kTypeArray, name);
+  nesting_stack_.push_back(false);
 }
 
 void TracedValue::EndDictionary() {
-  DCHECK_GT(stack_.size(), 1u);
-  DCHECK(GetCurrentDictionary());
-  stack_.pop_back();
+  DCHECK_GT(nesting_stack_.size(), 1u);
+  DCHECK(nesting_stack_.back());
+  data_.push_back(kTypeEnd);
+  nesting_stack_.pop_back();
 }
 
 void TracedValue::AppendInteger(int value) {
-  GetCurrentArray()->AppendInteger(value);
+  AppendTag(kTypeInteger, NULL);
+  AppendZigZagVarint(value, &data_);
 }
 
 void TracedValue::AppendDouble(double value) {
-  GetCurrentArray()->AppendDouble(value);
+  AppendTag(kTypeDouble, NULL);
+  data_.append(reinterpret_cast<const char*>(&value), sizeof(value));
 }
 
 void TracedValue::AppendBoolean(bool value) {
-  GetCurrentArray()->AppendBoolean(value);
+  AppendTag(kTypeBoolean, NULL);
+  data_.push_back(value);
 }
 
 void TracedValue::AppendString(const std::string& value) {
-  GetCurrentArray()->AppendString(value);
+  AppendTag(kTypeString, NULL);
+  AppendStringData(value);
 }
 
 void TracedValue::BeginArray() {
-  ListValue* array = new ListValue();
-  GetCurrentArray()->Append(array);
-  stack_.push_back(array);
+  AppendTag(kTypeArray, NULL);
+  nesting_stack_.push_back(false);
 }
 
 void TracedValue::BeginDictionary() {
-  DictionaryValue* dictionary = new DictionaryValue();
-  GetCurrentArray()->Append(dictionary);
-  stack_.push_back(dictionary);
+  AppendTag(kTypeDictionary, NULL);
+  nesting_stack_.push_back(true);
 }
 
 void TracedValue::EndArray() {
-  DCHECK_GT(stack_.size(), 1u);
-  DCHECK(GetCurrentArray());
-  stack_.pop_back();
-}
-
-DictionaryValue* TracedValue::GetCurrentDictionary() {
-  DCHECK(!stack_.empty());
-  DictionaryValue* dictionary = NULL;
-  stack_.back()->GetAsDictionary(&dictionary);
-  DCHECK(dictionary);
-  return dictionary;
-}
-
-ListValue* TracedValue::GetCurrentArray() {
-  DCHECK(!stack_.empty());
-  ListValue* list = NULL;
-  stack_.back()->GetAsList(&list);
-  DCHECK(list);
-  return list;
+  DCHECK_GT(nesting_stack_.size(), 1u);
+  DCHECK(!nesting_stack_.back());
+  data_.push_back(kTypeEnd);
+  nesting_stack_.pop_back();
+}
+
+void TracedValue::AppendTag(char tag, const char* name) {
+  data_.push_back(tag);
+  if (nesting_stack_.back()) {
+    DCHECK(name);
+    AppendStringData(name);
+  } else {
+    DCHECK(!name);
+  }
+}
+
+void TracedValue::AppendStringData(const StringPiece& str) {
+  AppendVarint(str.size(), &data_);
+  data_.append(str.data(), str.size());
+}
+
+scoped_ptr<Value> TracedValue::ToBaseValue() const {
+  scoped_ptr<DictionaryValue> root(new DictionaryValue);
+  std::vector<Value*> stack;
+  stack.push_back(root.get());
+  size_t offset = 0;
+  std::string name;
+  while (offset < data_.size()) {
+    char tag = data_[offset++];
+    if (tag == kTypeEnd) {
+      stack.pop_back();
+      continue;
+    }
+
+    DictionaryValue* dictionary = NULL;
+    ListValue* list = NULL;
+    if (stack.back()->GetAsDictionary(&dictionary)) {
+      bool result = ReadStringData(data_, &offset, &name);
+      DCHECK(result);
+    } else {
+      stack.back()->GetAsList(&list);
+    }
+
+    Value* value = NULL;
+    switch (tag) {
+      case kTypeInteger: {
+        int64 integer = 0;
+        bool result = ReadZigZagVarint(data_, &offset, &integer);
+        DCHECK(result);
+        value = new FundamentalValue(static_cast<int>(integer));
+        break;
+      }
+      case kTypeDouble: {
+        double number;
+        memcpy(&number, data_.data() + offset, sizeof(number));
+        offset += sizeof(number);
+        value = new FundamentalValue(number);
+        break;
+      }
+      case kTypeBoolean:
+        value = new FundamentalValue(data_[offset++] != 0);
+        break;
+      case kTypeString: {
+        std::string str;
+        bool result = ReadStringData(data_, &offset, &str);
+        DCHECK(result);
+        value = new StringValue(str);
+        break;
+      }
+      case kTypeValue: {
+        uint64 index = 0;
+        bool result = ReadVarint(data_, &offset, &index);
+        DCHECK(result);
+        value = values_[static_cast<size_t>(index)]->DeepCopy();
+        break;
+      }
+      case kTypeDictionary:
+        value = new DictionaryValue;
+        break;
+      case kTypeArray:
+        value = new ListValue;
+        break;
+      default:
+        NOTREACHED();
+        return root.Pass();
+    }
+
+    if (dictionary)
+      dictionary->Set(name, value);
+    else
+      list->Append(value);
+    if (tag == kTypeDictionary || tag == kTypeArray)
+      stack.push_back(value);
+  }
+  return root.Pass();
 }
 
 void TracedValue::AppendAsTraceFormat(std::string* out) const {
+  DCHECK_EQ(1u, nesting_stack_.size());
+  scoped_ptr<Value> root = ToBaseValue();
   std::string tmp;
-  JSONWriter::Write(stack_.front(), &tmp);
+  JSONWriter::Write(root.get(), &tmp);
   *out += tmp;
-  DCHECK_EQ(1u, stack_.size()) << tmp;
 }
 
 }  // namespace debug
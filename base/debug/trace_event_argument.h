@@ -10,14 +10,17 @@
 
 #include "base/debug/trace_event.h"
 #include "base/memory/scoped_ptr.h"
+#include "base/memory/scoped_vector.h"
+#include "base/strings/string_piece.h"
 
 namespace base {
-class DictionaryValue;
-class ListValue;
 class Value;
 
 namespace debug {
 
+// A structured trace event argument. The calls made on it are recorded in a
+// compact binary form, which is only turned into JSON when the trace is
+// flushed, so building one costs little more than appending to a string.
 class BASE_EXPORT TracedValue : public ConvertableToTraceFormat {
  public:
   TracedValue();
@@ -45,11 +48,20 @@ class BASE_EXPORT TracedValue : public ConvertableToTraceFormat {
  private:
   ~TracedValue() override;
 
-  DictionaryValue* GetCurrentDictionary();
-  ListValue* GetCurrentArray();
+  // Appends the tag of a value or container and, inside a dictionary, its
+  // |name|.
+  void AppendTag(char tag, const char* name);
+  void AppendStringData(const StringPiece& str);
+
+  // Rebuilds the value that |data_| describes.
+  scoped_ptr<Value> ToBaseValue() const;
+
+  std::string data_;
+  // Values passed to SetValue(), referred to from |data_| by index.
+  ScopedVector<Value> values_;
+  // Whether each open container is a dictionary; the root one is.
+  std::vector<bool> nesting_stack_;
 
-  scoped_ptr<base::Value> root_;
-  std::vector<Value*> stack_;
   DISALLOW_COPY_AND_ASSIGN(TracedValue);
 };
 
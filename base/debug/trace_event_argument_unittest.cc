@@ -3,6 +3,7 @@
 // found in the LICENSE file.
 
 #include "base/debug/trace_event_argument.h"
+#include "base/values.h"
 #include "testing/gtest/include/gtest/gtest.h"
 
 namespace base {
@@ -49,5 +50,32 @@ TEST(TraceEventArgumentTest, Hierarchy) {
       json);
 }
 
+TEST(TraceEventArgumentTest, ValuesAndRepeatedConversion) {
+  scoped_refptr<TracedValue> value = new TracedValue();
+  value->SetInteger("negative", -1000000);
+  value->SetString("empty", "");
+  ListValue* list = new ListValue;
+  list->AppendString("item");
+  value->SetValue("list", list);
+  value->BeginArray("nested");
+  value->BeginArray();
+  value->AppendString("s");
+  value->AppendDouble(1.5);
+  value->EndArray();
+  value->EndArray();
+  // Like DictionaryValue, the last value set for a name wins.
+  value->SetInteger("empty", 1);
+  const char kExpected[] =
+      "{\"empty\":1,\"list\":[\"item\"],\"negative\":-1000000,"
+      "\"nested\":[[\"s\",1.5]]}";
+  std::string json;
+  value->AppendAsTraceFormat(&json);
+  EXPECT_EQ(kExpected, json);
+  // Converting doesn't consume the value, so it can be flushed again.
+  json.clear();
+  value->AppendAsTraceFormat(&json);
+  EXPECT_EQ(kExpected, json);
+}
+
 }  // namespace debug
 }  // namespace base
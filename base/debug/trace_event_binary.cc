@@ -0,0 +1,491 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/debug/trace_event_binary.h"
+
+#include <string.h>
+
+#include "base/debug/trace_event.h"
+#include "base/debug/trace_event_impl.h"
+#include "base/format_macros.h"
+#include "base/logging.h"
+#include "base/strings/stringprintf.h"
+
+namespace base {
+namespace debug {
+
+namespace {
+
+const char kMagic[] = "CRTRACE\n";
+const size_t kMagicLength = sizeof(kMagic) - 1;
+const uint64 kVersion = 1;
+
+// Record tags.
+const uint8 kStringRecord = 1;
+const uint8 kEventRecord = 2;
+const uint8 kDroppedEventsRecord = 3;
+
+// Bits of the optional fields mask of an event record.
+const uint8 kHasThreadTimestamp = 1 << 0;
+const uint8 kHasDuration = 1 << 1;
+const uint8 kHasThreadDuration = 1 << 2;
+
+// Longest string the reader accepts, to bound the damage of a corrupt length.
+const uint64 kMaxStringLength = 1 << 24;
+
+void AppendInlineString(const char* str, std::string* out) {
+  size_t length = strlen(str);
+  AppendVarint(length, out);
+  out->append(str, length);
+}
+
+}  // namespace
+
+void AppendVarint(uint64 value, std::string* out) {
+  while (value >= 0x80) {
+    out->push_back(static_cast<char>((value & 0x7F) | 0x80));
+    value >>= 7;
+  }
+  out->push_back(static_cast<char>(value));
+}
+
+void AppendZigZagVarint(int64 value, std::string* out) {
+  AppendVarint((static_cast<uint64>(value) << 1) ^
+                   static_cast<uint64>(value >> 63),
+               out);
+}
+
+bool ReadVarint(const StringPiece& data, size_t* offset, uint64* value) {
+  *value = 0;
+  for (int shift = 0; shift < 64; shift += 7) {
+    if (*offset >= data.size())
+      return false;
+    uint8 byte = static_cast<uint8>(data[(*offset)++]);
+    *value |= static_cast<uint64>(byte & 0x7F) << shift;
+    if (!(byte & 0x80))
+      return true;
+  }
+  return false;
+}
+
+bool ReadZigZagVarint(const StringPiece& data, size_t* offset, int64* value) {
+  uint64 raw;
+  if (!ReadVarint(data, offset, &raw))
+    return false;
+  *value = static_cast<int64>((raw >> 1) ^ (~(raw & 1) + 1));
+  return true;
+}
+
+TraceEventBinaryWriter::TraceEventBinaryWriter() : last_timestamp_(0) {
+}
+
+TraceEventBinaryWriter::~TraceEventBinaryWriter() {
+}
+
+void TraceEventBinaryWriter::AppendHeader(int process_id, std::string* out) {
+  out->append(kMagic, kMagicLength);
+  AppendVarint(kVersion, out);
+  AppendZigZagVarint(process_id, out);
+}
+
+void TraceEventBinaryWriter::AppendChunk(const TraceBufferChunk& chunk,
+                                         std::string* out) {
+  for (size_t i = 0; i < chunk.size(); ++i)
+    AppendEvent(*chunk.GetEventAt(i), out);
+}
+
+void TraceEventBinaryWriter::AppendEvent(const TraceEvent& event,
+                                         std::string* out) {
+  const bool copied = (event.flags_ & TRACE_EVENT_FLAG_COPY) != 0;
+  const char* category =
+      TraceLog::GetCategoryGroupName(event.category_group_enabled_);
+  int num_args = 0;
+  while (num_args < kTraceMaxNumArgs && event.arg_names_[num_args])
+    ++num_args;
+
+  // String records have to precede the event that refers to them.
+  InternString(category, out);
+  if (!copied) {
+    InternString(event.name_, out);
+    for (int i = 0; i < num_args; ++i)
+      InternString(event.arg_names_[i], out);
+  }
+
+  uint8 fields = 0;
+  if (!event.thread_timestamp_.is_null())
+    fields |= kHasThreadTimestamp;
+  if (event.phase_ == TRACE_EVENT_PHASE_COMPLETE) {
+    if (event.duration_.ToInternalValue() != -1)
+      fields |= kHasDuration;
+    if (!event.thread_timestamp_.is_null() &&
+        event.thread_duration_.ToInternalValue() != -1) {
+      fields |= kHasThreadDuration;
+    }
+  }
+
+  out->push_back(static_cast<char>(kEventRecord));
+  out->push_back(event.phase_);
+  out->push_back(static_cast<char>(event.flags_));
+  out->push_back(static_cast<char>(fields));
+  AppendStringRef(category, false, out);
+  AppendStringRef(event.name_, copied, out);
+  AppendZigZagVarint(event.thread_id_, out);
+  int64 timestamp = event.timestamp_.ToInternalValue();
+  AppendZigZagVarint(timestamp - last_timestamp_, out);
+  last_timestamp_ = timestamp;
+  if (fields & kHasThreadTimestamp)
+    AppendZigZagVarint(event.thread_timestamp_.ToInternalValue(), out);
+  if (fields & kHasDuration)
+    AppendZigZagVarint(event.duration_.ToInternalValue(), out);
+  if (fields & kHasThreadDuration)
+    AppendZigZagVarint(event.thread_duration_.ToInternalValue(), out);
+  if (event.flags_ & TRACE_EVENT_FLAG_HAS_ID)
+    AppendVarint(event.id_, out);
+
+  AppendVarint(num_args, out);
+  for (int i = 0; i < num_args; ++i) {
+    AppendStringRef(event.arg_names_[i], copied, out);
+    unsigned char type = event.arg_types_[i];
+    out->push_back(static_cast<char>(type));
+    const TraceEvent::TraceValue& value = event.arg_values_[i];
+    switch (type) {
+      case TRACE_VALUE_TYPE_BOOL:
+        out->push_back(value.as_bool ? 1 : 0);
+        break;
+      case TRACE_VALUE_TYPE_UINT:
+        AppendVarint(value.as_uint, out);
+        break;
+      case TRACE_VALUE_TYPE_INT:
+        AppendZigZagVarint(value.as_int, out);
+        break;
+      case TRACE_VALUE_TYPE_DOUBLE: {
+        uint64 bits;
+        memcpy(&bits, &value.as_double, sizeof(bits));
+        for (int shift = 0; shift < 64; shift += 8)
+          out->push_back(static_cast<char>(bits >> shift));
+        break;
+      }
+      case TRACE_VALUE_TYPE_POINTER:
+        AppendVarint(reinterpret_cast<uintptr_t>(value.as_pointer), out);
+        break;
+      case TRACE_VALUE_TYPE_STRING:
+      case TRACE_VALUE_TYPE_COPY_STRING:
+        // Zero stands for NULL; otherwise the length plus one.
+        if (!value.as_string) {
+          AppendVarint(0, out);
+        } else {
+          size_t length = strlen(value.as_string);
+          AppendVarint(length + 1, out);
+          out->append(value.as_string, length);
+        }
+        break;
+      case TRACE_VALUE_TYPE_CONVERTABLE: {
+        std::string formatted;
+        event.convertable_values_[i]->AppendAsTraceFormat(&formatted);
+        AppendVarint(formatted.size(), out);
+        out->append(formatted);
+        break;
+      }
+      default:
+        NOTREACHED();
+        break;
+    }
+  }
+}
+
+void TraceEventBinaryWriter::AppendDroppedEvents(size_t count,
+                                                 std::string* out) {
+  out->push_back(static_cast<char>(kDroppedEventsRecord));
+  AppendVarint(count, out);
+}
+
+void TraceEventBinaryWriter::InternString(const char* str, std::string* out) {
+  if (string_ids_.find(str) != string_ids_.end())
+    return;
+  uint32 id = static_cast<uint32>(string_ids_.size()) + 1;
+  string_ids_[str] = id;
+  out->push_back(static_cast<char>(kStringRecord));
+  AppendVarint(id, out);
+  AppendInlineString(str, out);
+}
+
+void TraceEventBinaryWriter::AppendStringRef(const char* str,
+                                             bool copied,
+                                             std::string* out) {
+  // Zero introduces an inline string; anything else is a string id.
+  if (copied) {
+    AppendVarint(0, out);
+    AppendInlineString(str, out);
+    return;
+  }
+  hash_map<const char*, uint32>::const_iterator it = string_ids_.find(str);
+  DCHECK(it != string_ids_.end());
+  AppendVarint(it->second, out);
+}
+
+TraceEventBinaryReader::TraceEventBinaryReader(const StringPiece& data)
+    : data_(data),
+      offset_(0),
+      header_read_(false),
+      has_error_(false),
+      process_id_(0),
+      last_timestamp_(0),
+      dropped_events_(0),
+      strings_(1) {
+}
+
+TraceEventBinaryReader::~TraceEventBinaryReader() {
+}
+
+bool TraceEventBinaryReader::AppendNextEventAsJSON(std::string* out) {
+  if (has_error_)
+    return false;
+  if (!header_read_) {
+    if (!ReadHeader()) {
+      has_error_ = true;
+      return false;
+    }
+    header_read_ = true;
+  }
+
+  // Every record is complete or the data is corrupt, so any break out of
+  // this loop is an error.
+  for (;;) {
+    if (offset_ == data_.size())
+      return false;
+    uint8 tag;
+    ReadByte(&tag);
+    if (tag == kStringRecord) {
+      // Ids are assigned in order, starting at 1.
+      uint64 id;
+      uint64 length;
+      std::string str;
+      if (!ReadVarint(&id) || id != strings_.size() || !ReadVarint(&length) ||
+          length > kMaxStringLength || !ReadBytes(length, &str)) {
+        break;
+      }
+      strings_.push_back(str);
+      continue;
+    }
+    if (tag == kDroppedEventsRecord) {
+      uint64 count;
+      if (!ReadVarint(&count))
+        break;
+      dropped_events_ += count;
+      continue;
+    }
+    if (tag != kEventRecord)
+      break;
+
+    uint8 phase, flags, fields;
+    std::string category, name;
+    int64 thread_id, timestamp_delta;
+    if (!ReadByte(&phase) || !ReadByte(&flags) || !ReadByte(&fields) ||
+        !ReadStringRef(&category) || !ReadStringRef(&name) ||
+        !ReadZigZag(&thread_id) || !ReadZigZag(&timestamp_delta)) {
+      break;
+    }
+    int64 thread_timestamp = 0, duration = 0, thread_duration = 0;
+    uint64 id = 0;
+    if ((fields & kHasThreadTimestamp) && !ReadZigZag(&thread_timestamp))
+      break;
+    if ((fields & kHasDuration) && !ReadZigZag(&duration))
+      break;
+    if ((fields & kHasThreadDuration) && !ReadZigZag(&thread_duration))
+      break;
+    if ((flags & TRACE_EVENT_FLAG_HAS_ID) && !ReadVarint(&id))
+      break;
+    uint64 num_args;
+    if (!ReadVarint(&num_args) ||
+        num_args > static_cast<uint64>(kTraceMaxNumArgs)) {
+      break;
+    }
+
+    std::string args;
+    bool args_ok = true;
+    for (uint64 i = 0; i < num_args && args_ok; ++i) {
+      std::string arg_name;
+      uint8 type;
+      if (!ReadStringRef(&arg_name) || !ReadByte(&type)) {
+        args_ok = false;
+        break;
+      }
+      if (i > 0)
+        args += ",";
+      args += "\"";
+      args += arg_name;
+      args += "\":";
+
+      TraceEvent::TraceValue value;
+      uint64 raw;
+      std::string str;
+      switch (type) {
+        case TRACE_VALUE_TYPE_BOOL: {
+          uint8 byte;
+          args_ok = ReadByte(&byte);
+          value.as_bool = byte != 0;
+          break;
+        }
+        case TRACE_VALUE_TYPE_UINT:
+          args_ok = ReadVarint(&raw);
+          value.as_uint = raw;
+          break;
+        case TRACE_VALUE_TYPE_INT: {
+          int64 signed_value;
+          args_ok = ReadZigZag(&signed_value);
+          value.as_int = signed_value;
+          break;
+        }
+        case TRACE_VALUE_TYPE_DOUBLE:
+          args_ok = ReadBytes(8, &str);
+          if (args_ok) {
+            uint64 bits = 0;
+            for (int b = 7; b >= 0; --b)
+              bits = (bits << 8) | static_cast<uint8>(str[b]);
+            memcpy(&value.as_double, &bits, sizeof(bits));
+          }
+          break;
+        case TRACE_VALUE_TYPE_POINTER:
+          args_ok = ReadVarint(&raw);
+          value.as_pointer =
+              reinterpret_cast<const void*>(static_cast<uintptr_t>(raw));
+          break;
+        case TRACE_VALUE_TYPE_STRING:
+        case TRACE_VALUE_TYPE_COPY_STRING:
+          args_ok = ReadVarint(&raw) && raw <= kMaxStringLength + 1 &&
+                    (raw == 0 || ReadBytes(raw - 1, &str));
+          value.as_string = raw ? str.c_str() : NULL;
+          break;
+        case TRACE_VALUE_TYPE_CONVERTABLE:
+          args_ok = ReadVarint(&raw) && raw <= kMaxStringLength &&
+                    ReadBytes(raw, &str);
+          if (args_ok)
+            args += str;
+          continue;
+        default:
+          args_ok = false;
+          continue;
+      }
+      if (args_ok)
+        TraceEvent::AppendValueAsJSON(type, value, &args);
+    }
+    if (!args_ok)
+      break;
+
+    int64 timestamp = last_timestamp_ + timestamp_delta;
+    last_timestamp_ = timestamp;
+
+    StringAppendF(out,
+        "{\"cat\":\"%s\",\"pid\":%i,\"tid\":%i,\"ts\":%" PRId64 ","
+        "\"ph\":\"%c\",\"name\":\"%s\",\"args\":{",
+        category.c_str(),
+        process_id_,
+        static_cast<int>(thread_id),
+        timestamp,
+        phase,
+        name.c_str());
+    *out += args;
+    *out += "}";
+    if (fields & kHasDuration)
+      StringAppendF(out, ",\"dur\":%" PRId64, duration);
+    if (fields & kHasThreadDuration)
+      StringAppendF(out, ",\"tdur\":%" PRId64, thread_duration);
+    if (fields & kHasThreadTimestamp)
+      StringAppendF(out, ",\"tts\":%" PRId64, thread_timestamp);
+    if (flags & TRACE_EVENT_FLAG_HAS_ID)
+      StringAppendF(out, ",\"id\":\"0x%" PRIx64 "\"", id);
+    if (phase == TRACE_EVENT_PHASE_INSTANT) {
+      char scope = '?';
+      switch (flags & TRACE_EVENT_FLAG_SCOPE_MASK) {
+        case TRACE_EVENT_SCOPE_GLOBAL:
+          scope = TRACE_EVENT_SCOPE_NAME_GLOBAL;
+          break;
+
+        case TRACE_EVENT_SCOPE_PROCESS:
+          scope = TRACE_EVENT_SCOPE_NAME_PROCESS;
+          break;
+
+        case TRACE_EVENT_SCOPE_THREAD:
+          scope = TRACE_EVENT_SCOPE_NAME_THREAD;
+          break;
+      }
+      StringAppendF(out, ",\"s\":\"%c\"", scope);
+    }
+    *out += "}";
+    return true;
+  }
+
+  has_error_ = true;
+  return false;
+}
+
+bool TraceEventBinaryReader::AppendAllEventsAsJSON(std::string* out) {
+  bool first = true;
+  std::string event;
+  while (AppendNextEventAsJSON(&event)) {
+    if (!first)
+      *out += ",";
+    first = false;
+    *out += event;
+    event.clear();
+  }
+  return !has_error_;
+}
+
+bool TraceEventBinaryReader::ReadHeader() {
+  uint64 version;
+  int64 process_id;
+  if (data_.size() < kMagicLength ||
+      memcmp(data_.data(), kMagic, kMagicLength) != 0) {
+    return false;
+  }
+  offset_ = kMagicLength;
+  if (!ReadVarint(&version) || version != kVersion ||
+      !ReadZigZag(&process_id)) {
+    return false;
+  }
+  process_id_ = static_cast<int>(process_id);
+  return true;
+}
+
+bool TraceEventBinaryReader::ReadStringRef(std::string* str) {
+  uint64 ref;
+  if (!ReadVarint(&ref))
+    return false;
+  if (ref == 0) {
+    uint64 length;
+    return ReadVarint(&length) && length <= kMaxStringLength &&
+           ReadBytes(length, str);
+  }
+  if (ref >= strings_.size())
+    return false;
+  *str = strings_[ref];
+  return true;
+}
+
+bool TraceEventBinaryReader::ReadByte(uint8* value) {
+  if (offset_ >= data_.size())
+    return false;
+  *value = static_cast<uint8>(data_[offset_++]);
+  return true;
+}
+
+bool TraceEventBinaryReader::ReadVarint(uint64* value) {
+  return debug::ReadVarint(data_, &offset_, value);
+}
+
+bool TraceEventBinaryReader::ReadZigZag(int64* value) {
+  return ReadZigZagVarint(data_, &offset_, value);
+}
+
+bool TraceEventBinaryReader::ReadBytes(size_t length, std::string* out) {
+  if (length > data_.size() - offset_)
+    return false;
+  out->assign(data_.data() + offset_, length);
+  offset_ += length;
+  return true;
+}
+
+}  // namespace debug
+}  // namespace base
@@ -0,0 +1,134 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// A compact binary encoding of trace events, used when TraceLog streams
+// events to a file (STREAM_TO_FILE) instead of keeping them in memory until
+// Flush(). TraceEventBinaryReader converts such a file back into the JSON
+// that Flush() would have produced.
+//
+// A file is a header followed by a sequence of records:
+//
+//   header:  "CRTRACE\n" varint(version) zigzag(process_id)
+//   string:  kStringRecord varint(id) varint(length) bytes
+//   event:   kEventRecord phase flags fields varint(category) varint(name)
+//            zigzag(thread_id) zigzag(timestamp delta) [optional fields]
+//            varint(num_args) args...
+//   dropped: kDroppedEventsRecord varint(count)
+//
+// Category names, and event and argument names that aren't copied, are
+// written once as string records and then referred to by id. Timestamps are
+// written relative to the previous event. Records are self-delimiting, so a
+// file cut short by a crash is readable up to its last complete record.
+
+#ifndef BASE_DEBUG_TRACE_EVENT_BINARY_H_
+#define BASE_DEBUG_TRACE_EVENT_BINARY_H_
+
+#include <string>
+#include <vector>
+
+#include "base/base_export.h"
+#include "base/basictypes.h"
+#include "base/containers/hash_tables.h"
+#include "base/strings/string_piece.h"
+
+namespace base {
+namespace debug {
+
+class TraceBufferChunk;
+class TraceEvent;
+
+// LEB128 varints, shared by the trace file format and TracedValue. The
+// ZigZag variants map small negative numbers to short encodings too.
+BASE_EXPORT void AppendVarint(uint64 value, std::string* out);
+BASE_EXPORT void AppendZigZagVarint(int64 value, std::string* out);
+
+// Read a value written by the functions above from |data| at |*offset|,
+// advancing |*offset| past it. Return false if |data| ends first or the
+// encoding is too long.
+BASE_EXPORT bool ReadVarint(const StringPiece& data,
+                            size_t* offset,
+                            uint64* value);
+BASE_EXPORT bool ReadZigZagVarint(const StringPiece& data,
+                                  size_t* offset,
+                                  int64* value);
+
+class BASE_EXPORT TraceEventBinaryWriter {
+ public:
+  TraceEventBinaryWriter();
+  ~TraceEventBinaryWriter();
+
+  // Appends the file header. Must come first.
+  void AppendHeader(int process_id, std::string* out);
+
+  // Appends the events of |chunk|, preceded by records for any strings they
+  // refer to that haven't been written yet.
+  void AppendChunk(const TraceBufferChunk& chunk, std::string* out);
+  void AppendEvent(const TraceEvent& event, std::string* out);
+
+  // Records that |count| events were lost.
+  void AppendDroppedEvents(size_t count, std::string* out);
+
+ private:
+  // Appends a string record for |str| unless it has one already. |str| must
+  // live as long as the process.
+  void InternString(const char* str, std::string* out);
+  // Appends a reference to |str|, which must have been interned unless
+  // |copied| is true, in which case it is written inline.
+  void AppendStringRef(const char* str, bool copied, std::string* out);
+
+  // Ids of the strings written so far, keyed by address. Only strings that
+  // live as long as the process are interned, so this stays small.
+  hash_map<const char*, uint32> string_ids_;
+  int64 last_timestamp_;
+
+  DISALLOW_COPY_AND_ASSIGN(TraceEventBinaryWriter);
+};
+
+class BASE_EXPORT TraceEventBinaryReader {
+ public:
+  // |data| must outlive the reader.
+  explicit TraceEventBinaryReader(const StringPiece& data);
+  ~TraceEventBinaryReader();
+
+  // Appends the next event to |out| in the JSON format of
+  // TraceEvent::AppendAsJSON(). Returns false at the end of the data, or at
+  // the first incomplete or invalid record.
+  bool AppendNextEventAsJSON(std::string* out);
+
+  // Appends all remaining events as a comma separated list, like the
+  // fragments TraceLog::Flush() produces. Returns false if the data ended
+  // with an incomplete or invalid record; the events before it are still
+  // appended.
+  bool AppendAllEventsAsJSON(std::string* out);
+
+  bool has_error() const { return has_error_; }
+  // Number of events the writer reported lost so far.
+  size_t dropped_events() const { return dropped_events_; }
+
+ private:
+  bool ReadHeader();
+  bool ReadStringRef(std::string* str);
+
+  bool ReadByte(uint8* value);
+  bool ReadVarint(uint64* value);
+  bool ReadZigZag(int64* value);
+  bool ReadBytes(size_t length, std::string* out);
+
+  StringPiece data_;
+  size_t offset_;
+  bool header_read_;
+  bool has_error_;
+  int process_id_;
+  int64 last_timestamp_;
+  size_t dropped_events_;
+  // Interned strings; index 0 is unused.
+  std::vector<std::string> strings_;
+
+  DISALLOW_COPY_AND_ASSIGN(TraceEventBinaryReader);
+};
+
+}  // namespace debug
+}  // namespace base
+
+#endif  // BASE_DEBUG_TRACE_EVENT_BINARY_H_
@@ -0,0 +1,166 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/debug/trace_event_binary.h"
+
+#include <limits>
+#include <string>
+
+#include "base/debug/trace_event.h"
+#include "base/debug/trace_event_impl.h"
+#include "base/time/time.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+namespace debug {
+
+namespace {
+
+class TestConvertable : public ConvertableToTraceFormat {
+ public:
+  void AppendAsTraceFormat(std::string* out) const override {
+    *out += "{\"nested\":[1,2]}";
+  }
+
+ private:
+  ~TestConvertable() override {}
+};
+
+unsigned long long DoubleArg(double value) {
+  TraceEvent::TraceValue trace_value;
+  trace_value.as_double = value;
+  return trace_value.as_uint;
+}
+
+unsigned long long StringArg(const char* value) {
+  TraceEvent::TraceValue trace_value;
+  trace_value.as_uint = 0;
+  trace_value.as_string = value;
+  return trace_value.as_uint;
+}
+
+class TraceEventBinaryTest : public testing::Test {
+ protected:
+  TraceEventBinaryTest() : chunk_(1) {}
+
+  TraceEvent* AddEvent(char phase,
+                       const char* name,
+                       int num_args,
+                       const char** arg_names,
+                       const unsigned char* arg_types,
+                       const unsigned long long* arg_values,
+                       unsigned char flags) {
+    size_t event_index;
+    TraceEvent* event = chunk_.AddTraceEvent(&event_index);
+    scoped_refptr<ConvertableToTraceFormat> convertables[] = {
+        new TestConvertable, new TestConvertable};
+    TimeTicks now = TimeTicks::FromInternalValue(1000000 + 37 * event_index);
+    event->Initialize(7, now,
+                      (event_index % 2) ? now : TimeTicks(), phase,
+                      TraceLog::GetCategoryGroupEnabled("binary,test"), name,
+                      0x1234 + event_index, num_args, arg_names, arg_types,
+                      arg_values, convertables, flags);
+    return event;
+  }
+
+  // Returns the JSON that Flush() would produce for the events of |chunk_|.
+  std::string ExpectedJSON() const {
+    std::string json;
+    for (size_t i = 0; i < chunk_.size(); ++i) {
+      if (i > 0)
+        json += ",";
+      chunk_.GetEventAt(i)->AppendAsJSON(&json);
+    }
+    return json;
+  }
+
+  TraceBufferChunk chunk_;
+};
+
+}  // namespace
+
+TEST_F(TraceEventBinaryTest, RoundTrip) {
+  const char* arg_names[] = {"first", "second"};
+  unsigned char int_types[] = {TRACE_VALUE_TYPE_INT, TRACE_VALUE_TYPE_UINT};
+  unsigned long long int_values[] = {static_cast<unsigned long long>(-42),
+                                     std::numeric_limits<uint64>::max()};
+  AddEvent(TRACE_EVENT_PHASE_BEGIN, "ints", 2, arg_names, int_types,
+           int_values, TRACE_EVENT_FLAG_NONE);
+  unsigned char misc_types[] = {TRACE_VALUE_TYPE_BOOL,
+                                TRACE_VALUE_TYPE_DOUBLE};
+  unsigned long long misc_values[] = {1, DoubleArg(-0.25)};
+  AddEvent(TRACE_EVENT_PHASE_END, "misc", 2, arg_names, misc_types,
+           misc_values, TRACE_EVENT_FLAG_NONE);
+  unsigned char string_types[] = {TRACE_VALUE_TYPE_STRING,
+                                  TRACE_VALUE_TYPE_COPY_STRING};
+  unsigned long long string_values[] = {StringArg(NULL),
+                                        StringArg("quote\" and \\")};
+  AddEvent(TRACE_EVENT_PHASE_ASYNC_BEGIN, "strings", 2, arg_names,
+           string_types, string_values, TRACE_EVENT_FLAG_HAS_ID);
+  unsigned char other_types[] = {TRACE_VALUE_TYPE_POINTER,
+                                 TRACE_VALUE_TYPE_CONVERTABLE};
+  unsigned long long other_values[] = {0xdeadbeef, 0};
+  AddEvent(TRACE_EVENT_PHASE_INSTANT, "other", 2, arg_names, other_types,
+           other_values, TRACE_EVENT_SCOPE_PROCESS);
+  AddEvent(TRACE_EVENT_PHASE_COUNTER, "copied name", 1, arg_names, int_types,
+           int_values, TRACE_EVENT_FLAG_COPY);
+  TraceEvent* complete = AddEvent(TRACE_EVENT_PHASE_COMPLETE, "complete", 0,
+                                  NULL, NULL, NULL, TRACE_EVENT_FLAG_NONE);
+  complete->UpdateDuration(complete->timestamp() + TimeDelta::FromSeconds(1),
+                           complete->thread_timestamp());
+  AddEvent(TRACE_EVENT_PHASE_COMPLETE, "unfinished", 0, NULL, NULL, NULL,
+           TRACE_EVENT_FLAG_NONE);
+
+  TraceEventBinaryWriter writer;
+  std::string data;
+  writer.AppendHeader(TraceLog::GetInstance()->process_id(), &data);
+  writer.AppendChunk(chunk_, &data);
+  size_t single_chunk_size = data.size();
+  // Strings are only written once.
+  writer.AppendChunk(chunk_, &data);
+  EXPECT_LT(data.size() - single_chunk_size, single_chunk_size);
+
+  TraceEventBinaryReader reader(data);
+  std::string json;
+  EXPECT_TRUE(reader.AppendAllEventsAsJSON(&json));
+  EXPECT_EQ(ExpectedJSON() + "," + ExpectedJSON(), json);
+  EXPECT_FALSE(reader.has_error());
+}
+
+TEST_F(TraceEventBinaryTest, TruncatedAndDropped) {
+  const char* arg_names[] = {"value"};
+  unsigned char types[] = {TRACE_VALUE_TYPE_INT};
+  unsigned long long values[] = {5};
+  AddEvent(TRACE_EVENT_PHASE_INSTANT, "event", 1, arg_names, types, values,
+           TRACE_EVENT_SCOPE_THREAD);
+
+  TraceEventBinaryWriter writer;
+  std::string data;
+  writer.AppendHeader(1, &data);
+  writer.AppendChunk(chunk_, &data);
+  size_t first_event_end = data.size();
+  writer.AppendDroppedEvents(10, &data);
+  writer.AppendChunk(chunk_, &data);
+
+  // Everything up to the cut is still readable.
+  TraceEventBinaryReader reader(StringPiece(data.data(), data.size() - 1));
+  std::string json;
+  EXPECT_FALSE(reader.AppendAllEventsAsJSON(&json));
+  EXPECT_TRUE(reader.has_error());
+  EXPECT_EQ(10u, reader.dropped_events());
+  std::string first_event;
+  TraceEventBinaryReader first_reader(
+      StringPiece(data.data(), first_event_end));
+  EXPECT_TRUE(first_reader.AppendAllEventsAsJSON(&first_event));
+  EXPECT_EQ(first_event, json);
+
+  TraceEventBinaryReader bad_header_reader(StringPiece(data.data() + 1,
+                                                       data.size() - 1));
+  json.clear();
+  EXPECT_FALSE(bad_header_reader.AppendAllEventsAsJSON(&json));
+  EXPECT_TRUE(json.empty());
+}
+
+}  // namespace debug
+}  // namespace base
@@ -5,13 +5,16 @@
 #include "base/debug/trace_event_impl.h"
 
 #include <algorithm>
+#include <deque>
 
 #include "base/base_switches.h"
 #include "base/bind.h"
 #include "base/command_line.h"
 #include "base/debug/leak_annotations.h"
 #include "base/debug/trace_event.h"
+#include "base/debug/trace_event_binary.h"
 #include "base/debug/trace_event_synthetic_delay.h"
+#include "base/files/file.h"
 #include "base/float_util.h"
 #include "base/format_macros.h"
 #include "base/json/string_escape.h"
@@ -38,6 +41,10 @@
 #include "base/debug/trace_event_win.h"
 #endif
 
+#if defined(OS_LINUX)
+#include "base/debug/trace_event_stack_sampler_linux.h"
+#endif
+
 class DeleteTraceLogForTesting {
  public:
   static void Delete() {
@@ -62,6 +69,7 @@ const int kOverheadReportThresholdInMicroseconds = 50;
 const char kRecordUntilFull[] = "record-until-full";
 const char kRecordContinuously[] = "record-continuously";
 const char kRecordAsMuchAsPossible[] = "record-as-much-as-possible";
+const char kStreamToFile[] = "stream-to-file";
 const char kTraceToConsole[] = "trace-to-console";
 const char kEnableSampling[] = "enable-sampling";
 const char kEnableSystrace[] = "enable-systrace";
@@ -74,6 +82,13 @@ const size_t kTraceEventVectorBigBufferChunks =
 const size_t kTraceEventVectorBufferChunks = 256000 / kTraceBufferChunkSize;
 const size_t kTraceEventRingBufferChunks = kTraceEventVectorBufferChunks / 4;
 const size_t kTraceEventBatchChunks = 1000 / kTraceBufferChunkSize;
+// Events stay in memory for a while before they are streamed, so that the
+// durations of complete events can still be filled in.
+const size_t kTraceEventStreamingBufferChunks = 8192 / kTraceBufferChunkSize;
+// Chunks waiting to be written; further chunks are dropped until the writer
+// catches up.
+const size_t kTraceEventStreamingMaxPendingChunks =
+    16384 / kTraceBufferChunkSize;
 // Can store results for 30 seconds with 1 ms sampling interval.
 const size_t kMonitorTraceEventBufferChunks = 30000 / kTraceBufferChunkSize;
 // ECHO_TO_CONSOLE needs a small buffer to hold the unfinished COMPLETE events.
@@ -96,6 +111,10 @@ const char kSyntheticDelayCategoryFilterPrefix[] = "DELAY(";
 // only with char enabled pointers from g_category_group_enabled, and we can
 // convert internally to determine the category name from the char enabled
 // pointer.
+//
+// g_category_groups is append only. New category groups take the first empty
+// slot with a compare-and-swap, so the filled slots are always a prefix of the
+// array, and neither finding nor adding a category group takes a lock.
 const char* g_category_groups[MAX_CATEGORY_GROUPS] = {
   "toplevel",
   "tracing already shutdown",
@@ -112,8 +131,30 @@ const int g_category_categories_exhausted = 2;
 const int g_category_metadata = 3;
 const int g_category_trace_event_overhead = 4;
 const int g_num_builtin_categories = 5;
-// Skip default categories.
-base::subtle::AtomicWord g_category_index = g_num_builtin_categories;
+
+base::subtle::AtomicWord* GetCategoryGroupSlot(size_t category_index) {
+  COMPILE_ASSERT(
+      sizeof(g_category_groups[0]) == sizeof(base::subtle::AtomicWord),
+      category_group_slots_must_be_atomic_words);
+  return reinterpret_cast<base::subtle::AtomicWord*>(
+      &g_category_groups[category_index]);
+}
+
+// Returns the category group in |category_index|, or NULL if the slot is
+// still empty.
+const char* LoadCategoryGroup(size_t category_index) {
+  return reinterpret_cast<const char*>(
+      base::subtle::Acquire_Load(GetCategoryGroupSlot(category_index)));
+}
+
+size_t GetCategoryGroupCount() {
+  size_t category_index = g_num_builtin_categories;
+  while (category_index < MAX_CATEGORY_GROUPS &&
+         LoadCategoryGroup(category_index)) {
+    ++category_index;
+  }
+  return category_index;
+}
 
 // The name of the current thread. This is used to decide if the current
 // thread name has changed. We combine all the seen thread names into the
@@ -367,6 +408,249 @@ class TraceBufferVector : public TraceBuffer {
   DISALLOW_COPY_AND_ASSIGN(TraceBufferVector);
 };
 
+// Serializes the writer threads, so that a new trace doesn't overwrite the
+// file while the writer of the previous one is still draining into it.
+LazyInstance<Lock>::Leaky g_trace_file_lock = LAZY_INSTANCE_INITIALIZER;
+
+// Writes chunks of trace events to a file on its own thread. The file is
+// created and the thread started when the first chunk arrives. The thread is
+// never joined: Finish() hands the writer over to it, and it deletes the
+// writer once everything has been written.
+class TraceFileWriter : public PlatformThread::Delegate {
+ public:
+  explicit TraceFileWriter(const FilePath& path);
+
+  // Queues |chunk| to be written. If the writer has fallen too far behind,
+  // the chunk is dropped instead, so that memory use stays bounded; the file
+  // records how many events were lost.
+  void AddChunk(scoped_ptr<TraceBufferChunk> chunk);
+
+  // Lets the thread write the queued chunks, close the file and run
+  // |on_finished|, which may be null, before deleting this. Returns without
+  // waiting for any of that, so it is safe to call with TraceLog's lock held.
+  // The caller must not use the writer afterwards.
+  void Finish(const Closure& on_finished);
+
+  // Implementation of PlatformThread::Delegate:
+  void ThreadMain() override;
+
+ private:
+  ~TraceFileWriter() override;
+
+  const FilePath path_;
+
+  Lock lock_;
+  ConditionVariable work_available_;
+  ScopedVector<TraceBufferChunk> pending_chunks_;
+  size_t dropped_events_;
+  bool finishing_;
+  Closure on_finished_;
+
+  bool thread_started_;
+
+  DISALLOW_COPY_AND_ASSIGN(TraceFileWriter);
+};
+
+TraceFileWriter::TraceFileWriter(const FilePath& path)
+    : path_(path),
+      work_available_(&lock_),
+      dropped_events_(0),
+      finishing_(false),
+      thread_started_(false) {
+}
+
+TraceFileWriter::~TraceFileWriter() {
+}
+
+void TraceFileWriter::AddChunk(scoped_ptr<TraceBufferChunk> chunk) {
+  if (!thread_started_) {
+    if (!PlatformThread::CreateNonJoinable(0, this)) {
+      DLOG(ERROR) << "failed to create trace file writer thread";
+      return;
+    }
+    thread_started_ = true;
+  }
+
+  AutoLock lock(lock_);
+  DCHECK(!finishing_);
+  if (pending_chunks_.size() >= kTraceEventStreamingMaxPendingChunks) {
+    dropped_events_ += chunk->size();
+    return;
+  }
+  pending_chunks_.push_back(chunk.release());
+  work_available_.Signal();
+}
+
+void TraceFileWriter::Finish(const Closure& on_finished) {
+  if (!thread_started_) {
+    if (!on_finished.is_null())
+      on_finished.Run();
+    delete this;
+    return;
+  }
+  AutoLock lock(lock_);
+  DCHECK(!finishing_);
+  finishing_ = true;
+  on_finished_ = on_finished;
+  work_available_.Signal();
+}
+
+void TraceFileWriter::ThreadMain() {
+  PlatformThread::SetName("TraceFileWriter");
+  {
+    AutoLock file_lock(g_trace_file_lock.Get());
+    File file(path_, File::FLAG_CREATE_ALWAYS | File::FLAG_WRITE);
+    if (!file.IsValid())
+      DLOG(ERROR) << "Failed to open trace file " << path_.value();
+
+    TraceEventBinaryWriter writer;
+    std::string data;
+    writer.AppendHeader(TraceLog::GetInstance()->process_id(), &data);
+    bool finishing = false;
+    while (!finishing) {
+      ScopedVector<TraceBufferChunk> chunks;
+      size_t dropped_events;
+      {
+        AutoLock lock(lock_);
+        while (pending_chunks_.empty() && !dropped_events_ && !finishing_)
+          work_available_.Wait();
+        chunks.swap(pending_chunks_);
+        dropped_events = dropped_events_;
+        dropped_events_ = 0;
+        finishing = finishing_;
+      }
+
+      for (size_t i = 0; i < chunks.size(); ++i)
+        writer.AppendChunk(*chunks[i], &data);
+      if (dropped_events)
+        writer.AppendDroppedEvents(dropped_events, &data);
+      // Keep draining even if the file couldn't be opened, so that the chunks
+      // don't pile up.
+      if (file.IsValid() && !data.empty())
+        file.WriteAtCurrentPos(data.data(), static_cast<int>(data.size()));
+      data.clear();
+    }
+  }
+
+  // Finish() is done with |this| once the loop has seen |finishing_|.
+  Closure on_finished = on_finished_;
+  delete this;
+  if (!on_finished.is_null())
+    on_finished.Run();
+}
+
+// Keeps the most recently returned chunks in memory, like a ring buffer, but
+// streams the oldest one to a file instead of discarding it when a new chunk
+// is needed.
+class TraceBufferStreaming : public TraceBuffer {
+ public:
+  TraceBufferStreaming(size_t max_chunks, const FilePath& path)
+      : max_chunks_(max_chunks),
+        current_iteration_index_(0),
+        current_chunk_seq_(1),
+        file_writer_(new TraceFileWriter(path)) {
+  }
+
+  ~TraceBufferStreaming() override {
+    // Don't lose the tail of a trace that was never flushed. This may run with
+    // TraceLog's lock held, but doesn't wait for the file to be written.
+    if (file_writer_)
+      FinishStreaming(Closure());
+  }
+
+  scoped_ptr<TraceBufferChunk> GetChunk(size_t* index) override {
+    if (retained_chunks_.size() >= max_chunks_) {
+      // Reuse the slot of the oldest chunk. Handles to its events no longer
+      // match the slot, so the chunk can be handed to the writer thread.
+      *index = retained_chunks_.front();
+      retained_chunks_.pop_front();
+      scoped_ptr<TraceBufferChunk> oldest(chunks_[*index]);
+      chunks_[*index] = NULL;
+      file_writer_->AddChunk(oldest.Pass());
+    } else if (!free_slots_.empty()) {
+      *index = free_slots_.back();
+      free_slots_.pop_back();
+    } else {
+      // More threads than chunks are holding chunks at once.
+      *index = chunks_.size();
+      chunks_.push_back(NULL);
+    }
+    DCHECK(!chunks_[*index]);  // In-flight chunks have NULL slots.
+    return scoped_ptr<TraceBufferChunk>(
+        new TraceBufferChunk(current_chunk_seq_++));
+  }
+
+  void ReturnChunk(size_t index, scoped_ptr<TraceBufferChunk> chunk) override {
+    DCHECK(chunk);
+    DCHECK_LT(index, chunks_.size());
+    DCHECK(!chunks_[index]);
+    chunks_[index] = chunk.release();
+    retained_chunks_.push_back(index);
+  }
+
+  bool IsFull() const override { return false; }
+
+  size_t Size() const override {
+    // This is approximate because not all of the chunks are full.
+    return retained_chunks_.size() * kTraceBufferChunkSize;
+  }
+
+  size_t Capacity() const override {
+    return max_chunks_ * kTraceBufferChunkSize;
+  }
+
+  TraceEvent* GetEventByHandle(TraceEventHandle handle) override {
+    if (handle.chunk_index >= chunks_.size())
+      return NULL;
+    TraceBufferChunk* chunk = chunks_[handle.chunk_index];
+    if (!chunk || chunk->seq() != handle.chunk_seq)
+      return NULL;
+    return chunk->GetEventAt(handle.event_index);
+  }
+
+  const TraceBufferChunk* NextChunk() override {
+    if (current_iteration_index_ >= retained_chunks_.size())
+      return NULL;
+    return chunks_[retained_chunks_[current_iteration_index_++]];
+  }
+
+  scoped_ptr<TraceBuffer> CloneForIteration() const override {
+    NOTIMPLEMENTED();
+    return scoped_ptr<TraceBuffer>();
+  }
+
+  void FinishStreaming(const Closure& on_finished) override {
+    DCHECK(file_writer_);
+    while (!retained_chunks_.empty()) {
+      size_t index = retained_chunks_.front();
+      retained_chunks_.pop_front();
+      file_writer_->AddChunk(make_scoped_ptr(chunks_[index]));
+      chunks_[index] = NULL;
+      free_slots_.push_back(index);
+    }
+    // |on_finished| may delete this buffer.
+    TraceFileWriter* file_writer = file_writer_;
+    file_writer_ = NULL;
+    file_writer->Finish(on_finished);
+  }
+
+ private:
+  size_t max_chunks_;
+  ScopedVector<TraceBufferChunk> chunks_;
+  // Slots of returned chunks, oldest first.
+  std::deque<size_t> retained_chunks_;
+  // Slots whose chunks have been streamed.
+  std::vector<size_t> free_slots_;
+
+  size_t current_iteration_index_;
+  uint32 current_chunk_seq_;
+
+  // Owned until FinishStreaming() hands it over to its thread.
+  TraceFileWriter* file_writer_;
+
+  DISALLOW_COPY_AND_ASSIGN(TraceBufferStreaming);
+};
+
 template <typename T>
 void InitializeMetadataEvent(TraceEvent* trace_event,
                              int thread_id,
@@ -994,6 +1278,8 @@ bool TraceOptions::SetFromString(const std::string& options_string) {
       record_mode = ECHO_TO_CONSOLE;
     } else if (*iter == kRecordAsMuchAsPossible) {
       record_mode = RECORD_AS_MUCH_AS_POSSIBLE;
+    } else if (*iter == kStreamToFile) {
+      record_mode = STREAM_TO_FILE;
     } else if (*iter == kEnableSampling) {
       enable_sampling = true;
     } else if (*iter == kEnableSystrace) {
@@ -1020,6 +1306,9 @@ std::string TraceOptions::ToString() const {
     case RECORD_AS_MUCH_AS_POSSIBLE:
       ret = kRecordAsMuchAsPossible;
       break;
+    case STREAM_TO_FILE:
+      ret = kStreamToFile;
+      break;
     default:
       NOTREACHED();
   }
@@ -1075,6 +1364,10 @@ class TraceLog::ThreadLocalEventBuffer
   int event_count_;
   TimeDelta overhead_;
   int generation_;
+#if defined(OS_LINUX)
+  // Whether the thread is registered with the stack sampler.
+  bool sampled_;
+#endif
 
   DISALLOW_COPY_AND_ASSIGN(ThreadLocalEventBuffer);
 };
@@ -1089,6 +1382,15 @@ TraceLog::ThreadLocalEventBuffer::ThreadLocalEventBuffer(TraceLog* trace_log)
   MessageLoop* message_loop = MessageLoop::current();
   message_loop->AddDestructionObserver(this);
 
+#if defined(OS_LINUX)
+  // Threads that record events while the stack sampler is on are sampled
+  // until their events are flushed. SetEnabled() created the sampler before
+  // it enabled the category.
+  sampled_ = *GetCategoryGroupEnabled(TraceEventStackSampler::kCategory) != 0;
+  if (sampled_)
+    TraceEventStackSampler::GetInstance()->RegisterCurrentThread();
+#endif
+
   AutoLock lock(trace_log->lock_);
   trace_log->thread_message_loops_.insert(message_loop);
 }
@@ -1096,6 +1398,10 @@ TraceLog::ThreadLocalEventBuffer::ThreadLocalEventBuffer(TraceLog* trace_log)
 TraceLog::ThreadLocalEventBuffer::~ThreadLocalEventBuffer() {
   CheckThisIsCurrentBuffer();
   MessageLoop::current()->RemoveDestructionObserver(this);
+#if defined(OS_LINUX)
+  if (sampled_)
+    TraceEventStackSampler::GetInstance()->UnregisterCurrentThread();
+#endif
 
   // Zero event_count_ happens in either of the following cases:
   // - no event generated for the thread;
@@ -1210,6 +1516,8 @@ TraceLog::TraceLog()
       category_filter_(CategoryFilter::kDefaultCategoryFilterString),
       event_callback_category_filter_(
           CategoryFilter::kDefaultCategoryFilterString),
+      category_group_enabled_state_(0),
+      category_group_enabled_state_readers_(0),
       thread_shared_chunk_index_(0),
       generation_(0) {
   // Trace is enabled or disabled on one thread while other threads are
@@ -1281,25 +1589,77 @@ const char* TraceLog::GetCategoryGroupName(
   return g_category_groups[category_index];
 }
 
+struct TraceLog::CategoryGroupEnabledState {
+  CategoryGroupEnabledState(Mode mode,
+                            const CategoryFilter& category_filter,
+                            bool has_event_callback,
+                            const CategoryFilter& event_callback_filter)
+      : mode(mode),
+        category_filter(category_filter),
+        has_event_callback(has_event_callback),
+        event_callback_category_filter(event_callback_filter) {}
+
+  unsigned char GetEnabledFlag(const char* category_group) const {
+    unsigned char enabled_flag = 0;
+    if (mode == RECORDING_MODE &&
+        category_filter.IsCategoryGroupEnabled(category_group))
+      enabled_flag |= ENABLED_FOR_RECORDING;
+    else if (mode == MONITORING_MODE &&
+        category_filter.IsCategoryGroupEnabled(category_group))
+      enabled_flag |= ENABLED_FOR_MONITORING;
+    if (has_event_callback &&
+        event_callback_category_filter.IsCategoryGroupEnabled(category_group))
+      enabled_flag |= ENABLED_FOR_EVENT_CALLBACK;
+    return enabled_flag;
+  }
+
+  const Mode mode;
+  const CategoryFilter category_filter;
+  const bool has_event_callback;
+  const CategoryFilter event_callback_category_filter;
+};
+
 void TraceLog::UpdateCategoryGroupEnabledFlag(size_t category_index) {
-  unsigned char enabled_flag = 0;
   const char* category_group = g_category_groups[category_index];
-  if (mode_ == RECORDING_MODE &&
-      category_filter_.IsCategoryGroupEnabled(category_group))
-    enabled_flag |= ENABLED_FOR_RECORDING;
-  else if (mode_ == MONITORING_MODE &&
-      category_filter_.IsCategoryGroupEnabled(category_group))
-    enabled_flag |= ENABLED_FOR_MONITORING;
-  if (event_callback_ &&
-      event_callback_category_filter_.IsCategoryGroupEnabled(category_group))
-    enabled_flag |= ENABLED_FOR_EVENT_CALLBACK;
-  g_category_group_enabled[category_index] = enabled_flag;
+  // UpdateCategoryGroupEnabledFlags() may run meanwhile. It publishes its
+  // state before it updates the flags of the category groups it sees, so
+  // either it sees this one and sets the flag after us, or we see the change
+  // of state and set the flag again.
+  subtle::Barrier_AtomicIncrement(&category_group_enabled_state_readers_, 1);
+  const CategoryGroupEnabledState* state;
+  do {
+    state = reinterpret_cast<const CategoryGroupEnabledState*>(
+        subtle::Acquire_Load(&category_group_enabled_state_));
+    g_category_group_enabled[category_index] =
+        state ? state->GetEnabledFlag(category_group) : 0;
+    subtle::MemoryBarrier();
+  } while (reinterpret_cast<const CategoryGroupEnabledState*>(
+               subtle::Acquire_Load(&category_group_enabled_state_)) != state);
+  subtle::Barrier_AtomicIncrement(&category_group_enabled_state_readers_, -1);
 }
 
 void TraceLog::UpdateCategoryGroupEnabledFlags() {
-  size_t category_index = base::subtle::NoBarrier_Load(&g_category_index);
+  lock_.AssertAcquired();
+  CategoryGroupEnabledState* state = new CategoryGroupEnabledState(
+      mode_, category_filter_, subtle::NoBarrier_Load(&event_callback_) != 0,
+      event_callback_category_filter_);
+  category_group_enabled_states_.push_back(state);
+  subtle::Release_Store(&category_group_enabled_state_,
+                        reinterpret_cast<subtle::AtomicWord>(state));
+  // Pairs with the barrier after a new category group takes its slot, and
+  // with the one after a reader announces itself: a reader that isn't counted
+  // below can only see |state|.
+  subtle::MemoryBarrier();
+
+  size_t category_index = GetCategoryGroupCount();
   for (size_t i = 0; i < category_index; i++)
-    UpdateCategoryGroupEnabledFlag(i);
+    g_category_group_enabled[i] = state->GetEnabledFlag(g_category_groups[i]);
+
+  if (subtle::NoBarrier_Load(&category_group_enabled_state_readers_) == 0) {
+    category_group_enabled_states_.erase(
+        category_group_enabled_states_.begin(),
+        category_group_enabled_states_.end() - 1);
+  }
 }
 
 void TraceLog::UpdateSyntheticDelaysFromCategoryFilter() {
@@ -1335,52 +1695,40 @@ const unsigned char* TraceLog::GetCategoryGroupEnabledInternal(
     const char* category_group) {
   DCHECK(!strchr(category_group, '"')) <<
       "Category groups may not contain double quote";
-  // The g_category_groups is append only, avoid using a lock for the fast path.
-  size_t current_category_index = base::subtle::Acquire_Load(&g_category_index);
-
-  // Search for pre-existing category group.
-  for (size_t i = 0; i < current_category_index; ++i) {
-    if (strcmp(g_category_groups[i], category_group) == 0) {
-      return &g_category_group_enabled[i];
+  char* new_group = NULL;
+  for (size_t i = 0; i < MAX_CATEGORY_GROUPS; ++i) {
+    const char* existing_group = LoadCategoryGroup(i);
+    if (!existing_group) {
+      // Create a new category group in the first empty slot, unless another
+      // thread fills it first. Don't hold on to the category_group pointer,
+      // so that we can create category groups with strings not known at
+      // compile time (this is required by SetWatchEvent).
+      if (!new_group)
+        new_group = strdup(category_group);
+      existing_group = reinterpret_cast<const char*>(
+          subtle::Release_CompareAndSwap(
+              GetCategoryGroupSlot(i), 0,
+              reinterpret_cast<subtle::AtomicWord>(new_group)));
+      if (!existing_group) {
+        ANNOTATE_LEAKING_OBJECT_PTR(new_group);
+        // Pairs with the barrier after a new state is published.
+        subtle::MemoryBarrier();
+        // Note that if both included and excluded patterns in the
+        // CategoryFilter are empty, we exclude nothing,
+        // thereby enabling this category group.
+        UpdateCategoryGroupEnabledFlag(i);
+        return &g_category_group_enabled[i];
+      }
     }
-  }
-
-  unsigned char* category_group_enabled = NULL;
-  // This is the slow path: the lock is not held in the case above, so more
-  // than one thread could have reached here trying to add the same category.
-  // Only hold to lock when actually appending a new category, and
-  // check the categories groups again.
-  AutoLock lock(lock_);
-  size_t category_index = base::subtle::Acquire_Load(&g_category_index);
-  for (size_t i = 0; i < category_index; ++i) {
-    if (strcmp(g_category_groups[i], category_group) == 0) {
+    if (strcmp(existing_group, category_group) == 0) {
+      free(new_group);
       return &g_category_group_enabled[i];
     }
   }
 
-  // Create a new category group.
-  DCHECK(category_index < MAX_CATEGORY_GROUPS) <<
-      "must increase MAX_CATEGORY_GROUPS";
-  if (category_index < MAX_CATEGORY_GROUPS) {
-    // Don't hold on to the category_group pointer, so that we can create
-    // category groups with strings not known at compile time (this is
-    // required by SetWatchEvent).
-    const char* new_group = strdup(category_group);
-    ANNOTATE_LEAKING_OBJECT_PTR(new_group);
-    g_category_groups[category_index] = new_group;
-    DCHECK(!g_category_group_enabled[category_index]);
-    // Note that if both included and excluded patterns in the
-    // CategoryFilter are empty, we exclude nothing,
-    // thereby enabling this category group.
-    UpdateCategoryGroupEnabledFlag(category_index);
-    category_group_enabled = &g_category_group_enabled[category_index];
-    // Update the max index now.
-    base::subtle::Release_Store(&g_category_index, category_index + 1);
-  } else {
-    category_group_enabled =
-        &g_category_group_enabled[g_category_categories_exhausted];
-  }
-  return category_group_enabled;
+  free(new_group);
+  NOTREACHED() << "must increase MAX_CATEGORY_GROUPS";
+  return &g_category_group_enabled[g_category_categories_exhausted];
 }
 
 void TraceLog::GetKnownCategoryGroups(
@@ -1388,7 +1736,7 @@ void TraceLog::GetKnownCategoryGroups(
   AutoLock lock(lock_);
   category_groups->push_back(
       g_category_groups[g_category_trace_event_overhead]);
-  size_t category_index = base::subtle::NoBarrier_Load(&g_category_index);
+  size_t category_index = GetCategoryGroupCount();
   for (size_t i = g_num_builtin_categories; i < category_index; i++)
     category_groups->push_back(g_category_groups[i]);
 }
@@ -1396,6 +1744,16 @@ void TraceLog::GetKnownCategoryGroups(
 void TraceLog::SetEnabled(const CategoryFilter& category_filter,
                           Mode mode,
                           const TraceOptions& options) {
+#if defined(OS_LINUX)
+  // The stack sampler starts observing here, on the thread that enables
+  // tracing, so that threads only ever register with an existing sampler.
+  TraceEventStackSampler* stack_sampler = NULL;
+  if (category_filter.IsCategoryGroupEnabled(
+          TraceEventStackSampler::kCategory)) {
+    stack_sampler = TraceEventStackSampler::GetInstance();
+  }
+#endif
+
   std::vector<EnabledStateObserver*> observer_list;
   {
     AutoLock lock(lock_);
@@ -1420,6 +1778,14 @@ void TraceLog::SetEnabled(const CategoryFilter& category_filter,
 
       category_filter_.Merge(category_filter);
       UpdateCategoryGroupEnabledFlags();
+#if defined(OS_LINUX)
+      // Observers are not told about merged categories, so the sampler is
+      // started here if the running trace just gained its category.
+      if (stack_sampler) {
+        AutoUnlock unlock(lock_);
+        stack_sampler->OnTraceLogEnabled();
+      }
+#endif
       return;
     }
 
@@ -1431,7 +1797,8 @@ void TraceLog::SetEnabled(const CategoryFilter& category_filter,
 
     mode_ = mode;
 
-    if (new_options != old_options) {
+    // Each streamed trace starts a new file, possibly at a different path.
+    if (new_options != old_options || (new_options & kInternalStreamToFile)) {
       subtle::NoBarrier_Store(&trace_options_, new_options);
       UseNextTraceBuffer();
     }
@@ -1488,6 +1855,8 @@ TraceLog::InternalTraceOptions TraceLog::GetInternalOptionsFromTraceOptions(
       return ret | kInternalEchoToConsole;
     case RECORD_AS_MUCH_AS_POSSIBLE:
       return ret | kInternalRecordAsMuchAsPossible;
+    case STREAM_TO_FILE:
+      return ret | kInternalStreamToFile;
   }
   NOTREACHED();
   return kInternalNone;
@@ -1510,6 +1879,8 @@ TraceOptions TraceLog::GetCurrentTraceOptions() const {
     ret.record_mode = ECHO_TO_CONSOLE;
   else if (option & kInternalRecordAsMuchAsPossible)
     ret.record_mode = RECORD_AS_MUCH_AS_POSSIBLE;
+  else if (option & kInternalStreamToFile)
+    ret.record_mode = STREAM_TO_FILE;
   else
     NOTREACHED();
   return ret;
@@ -1520,6 +1891,11 @@ void TraceLog::SetDisabled() {
   SetDisabledWhileLocked();
 }
 
+void TraceLog::SetStreamingFilePath(const FilePath& path) {
+  AutoLock lock(lock_);
+  streaming_file_path_ = path;
+}
+
 void TraceLog::SetDisabledWhileLocked() {
   lock_.AssertAcquired();
 
@@ -1572,10 +1948,12 @@ int TraceLog::GetNumTracesRecorded() {
 }
 
 void TraceLog::AddEnabledStateObserver(EnabledStateObserver* listener) {
+  AutoLock lock(lock_);
   enabled_state_observer_list_.push_back(listener);
 }
 
 void TraceLog::RemoveEnabledStateObserver(EnabledStateObserver* listener) {
+  AutoLock lock(lock_);
   std::vector<EnabledStateObserver*>::iterator it =
       std::find(enabled_state_observer_list_.begin(),
                 enabled_state_observer_list_.end(),
@@ -1585,6 +1963,7 @@ void TraceLog::RemoveEnabledStateObserver(EnabledStateObserver* listener) {
 }
 
 bool TraceLog::HasEnabledStateObserver(EnabledStateObserver* listener) const {
+  AutoLock lock(lock_);
   std::vector<EnabledStateObserver*>::const_iterator it =
       std::find(enabled_state_observer_list_.begin(),
                 enabled_state_observer_list_.end(),
@@ -1607,6 +1986,14 @@ bool TraceLog::BufferIsFull() const {
 
 TraceBuffer* TraceLog::CreateTraceBuffer() {
   InternalTraceOptions options = trace_options();
+  if (options & kInternalStreamToFile) {
+    if (!streaming_file_path_.empty()) {
+      return new TraceBufferStreaming(kTraceEventStreamingBufferChunks,
+                                      streaming_file_path_);
+    }
+    DLOG(ERROR) << "No file to stream to; recording continuously instead.";
+    return new TraceBufferRingBuffer(kTraceEventRingBufferChunks);
+  }
   if (options & kInternalRecordContinuously)
     return new TraceBufferRingBuffer(kTraceEventRingBufferChunks);
   else if ((options & kInternalEnableSampling) && mode_ == MONITORING_MODE)
@@ -1771,6 +2158,7 @@ void TraceLog::ConvertTraceEventsToTraceFormat(
 
 void TraceLog::FinishFlush(int generation) {
   scoped_ptr<TraceBuffer> previous_logged_events;
+  scoped_refptr<MessageLoopProxy> flush_message_loop_proxy;
   OutputCallback flush_output_callback;
 
   if (!CheckGeneration(generation))
@@ -1783,13 +2171,33 @@ void TraceLog::FinishFlush(int generation) {
     UseNextTraceBuffer();
     thread_message_loops_.clear();
 
-    flush_message_loop_proxy_ = NULL;
+    flush_message_loop_proxy.swap(flush_message_loop_proxy_);
     flush_output_callback = flush_output_callback_;
     flush_output_callback_.Reset();
   }
 
-  ConvertTraceEventsToTraceFormat(previous_logged_events.Pass(),
-                                  flush_output_callback);
+  // Don't block this thread on the file writer; the flush completes once it
+  // is done.
+  TraceBuffer* buffer = previous_logged_events.get();
+  buffer->FinishStreaming(Bind(&TraceLog::OnStreamingFinished, Unretained(this),
+                               Passed(&previous_logged_events),
+                               flush_message_loop_proxy,
+                               flush_output_callback));
+}
+
+void TraceLog::OnStreamingFinished(
+    scoped_ptr<TraceBuffer> logged_events,
+    const scoped_refptr<MessageLoopProxy>& flush_message_loop_proxy,
+    const TraceLog::OutputCallback& flush_output_callback) {
+  if (flush_message_loop_proxy.get() &&
+      !flush_message_loop_proxy->BelongsToCurrentThread()) {
+    flush_message_loop_proxy->PostTask(
+        FROM_HERE,
+        Bind(&TraceLog::ConvertTraceEventsToTraceFormat, Unretained(this),
+             Passed(&logged_events), flush_output_callback));
+    return;
+  }
+  ConvertTraceEventsToTraceFormat(logged_events.Pass(), flush_output_callback);
 }
 
 // Run in each thread holding a local event buffer.
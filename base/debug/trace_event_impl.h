@@ -14,6 +14,7 @@
 #include "base/base_export.h"
 #include "base/callback.h"
 #include "base/containers/hash_tables.h"
+#include "base/files/file_path.h"
 #include "base/gtest_prod_util.h"
 #include "base/memory/ref_counted_memory.h"
 #include "base/memory/scoped_vector.h"
@@ -154,6 +155,8 @@ class BASE_EXPORT TraceEvent {
 #endif
 
  private:
+  friend class TraceEventBinaryWriter;
+
   // Note: these are ordered by size (largest first) for optimal packing.
   TimeTicks timestamp_;
   TimeTicks thread_timestamp_;
@@ -228,6 +231,14 @@ class BASE_EXPORT TraceBuffer {
   virtual const TraceBufferChunk* NextChunk() = 0;
 
   virtual scoped_ptr<TraceBuffer> CloneForIteration() const = 0;
+
+  // Called by TraceLog::Flush() before iterating. Buffers that stream their
+  // events elsewhere hand off the events they still hold, leaving nothing to
+  // iterate, and run |on_finished| on another thread once they have been
+  // written. Other buffers run |on_finished| right away.
+  virtual void FinishStreaming(const Closure& on_finished) {
+    on_finished.Run();
+  }
 };
 
 // TraceResultBuffer collects and converts trace fragments returned by TraceLog
@@ -375,7 +386,15 @@ enum TraceRecordMode {
   ECHO_TO_CONSOLE,
 
   // Record until the trace buffer is full, but with a huge buffer size.
-  RECORD_AS_MUCH_AS_POSSIBLE
+  RECORD_AS_MUCH_AS_POSSIBLE,
+
+  // Record until the user ends the trace, writing events to the file set with
+  // TraceLog::SetStreamingFilePath() as the trace buffer fills. Memory use is
+  // bounded regardless of the length of the trace. Flush() completes the file
+  // instead of returning the events; see trace_event_binary.h for the format.
+  // Its callback runs once the file has been written, on the writer's thread
+  // if the flushing thread has no message loop.
+  STREAM_TO_FILE
 };
 
 struct BASE_EXPORT TraceOptions {
@@ -391,8 +410,9 @@ struct BASE_EXPORT TraceOptions {
 
   // |options_string| is a comma-delimited list of trace options.
   // Possible options are: "record-until-full", "record-continuously",
-  // "trace-to-console", "enable-sampling" and "enable-systrace".
-  // The first 3 options are trace recoding modes and hence
+  // "trace-to-console", "record-as-much-as-possible", "stream-to-file",
+  // "enable-sampling" and "enable-systrace".
+  // The first 5 options are trace recoding modes and hence
   // mutually exclusive. If more than one trace recording modes appear in the
   // options_string, the last one takes precedence. If none of the trace
   // recording mode is specified, recording mode is RECORD_UNTIL_FULL.
@@ -470,6 +490,11 @@ class BASE_EXPORT TraceLog {
   // Disables normal tracing for all categories.
   void SetDisabled();
 
+  // Sets the file that tracing enabled with STREAM_TO_FILE writes to. Takes
+  // effect the next time tracing is enabled; the file is overwritten once the
+  // first events are written to it.
+  void SetStreamingFilePath(const FilePath& path);
+
   bool IsEnabled() { return mode_ != DISABLED; }
 
   // The number of times we have begun recording traces. If tracing is off,
@@ -663,12 +688,19 @@ class BASE_EXPORT TraceLog {
   // by the Singleton class.
   friend struct DefaultSingletonTraits<TraceLog>;
 
+  // What decides whether a category group is enabled: a copy of mode_,
+  // category_filter_, event_callback_ and event_callback_category_filter_.
+  struct CategoryGroupEnabledState;
+
   // Enable/disable each category group based on the current mode_,
   // category_filter_, event_callback_ and event_callback_category_filter_.
   // Enable the category group in the enabled mode if category_filter_ matches
   // the category group, or event_callback_ is not null and
-  // event_callback_category_filter_ matches the category group.
+  // event_callback_category_filter_ matches the category group. Must be called
+  // with lock_ held, after any of them changes.
   void UpdateCategoryGroupEnabledFlags();
+
+  // Sets the flag of a category group that was just added, without lock_.
   void UpdateCategoryGroupEnabledFlag(size_t category_index);
 
   // Configure synthetic delays based on the values set in the current
@@ -713,6 +745,12 @@ class BASE_EXPORT TraceLog {
   void ConvertTraceEventsToTraceFormat(scoped_ptr<TraceBuffer> logged_events,
       const TraceLog::OutputCallback& flush_output_callback);
   void FinishFlush(int generation);
+  // Called once |logged_events| has finished streaming, possibly on another
+  // thread. Completes the flush on |flush_message_loop_proxy| if there is one.
+  void OnStreamingFinished(
+      scoped_ptr<TraceBuffer> logged_events,
+      const scoped_refptr<MessageLoopProxy>& flush_message_loop_proxy,
+      const TraceLog::OutputCallback& flush_output_callback);
   void OnFlushTimeout(int generation);
 
   int generation() const {
@@ -738,6 +776,7 @@ class BASE_EXPORT TraceLog {
   static const InternalTraceOptions kInternalEchoToConsole;
   static const InternalTraceOptions kInternalEnableSampling;
   static const InternalTraceOptions kInternalRecordAsMuchAsPossible;
+  static const InternalTraceOptions kInternalStreamToFile;
 
   // This lock protects TraceLog member accesses (except for members protected
   // by thread_info_lock_) from arbitrary threads.
@@ -779,6 +818,9 @@ class BASE_EXPORT TraceLog {
 
   subtle::AtomicWord /* Options */ trace_options_;
 
+  // Where STREAM_TO_FILE writes to.
+  FilePath streaming_file_path_;
+
   // Sampling thread handles.
   scoped_ptr<TraceSamplingThread> sampling_thread_;
   PlatformThreadHandle sampling_thread_handle_;
@@ -786,6 +828,18 @@ class BASE_EXPORT TraceLog {
   CategoryFilter category_filter_;
   CategoryFilter event_callback_category_filter_;
 
+  // The CategoryGroupEnabledState that category groups added without lock_
+  // take their flags from. UpdateCategoryGroupEnabledFlags() replaces it with
+  // a new one rather than changing it, since a thread adding a category group
+  // may still be reading the old one. The old ones stay in
+  // category_group_enabled_states_, before the current one, until no thread
+  // is reading any; category_group_enabled_state_readers_ counts the threads
+  // that may be.
+  subtle::AtomicWord /* const CategoryGroupEnabledState* */
+      category_group_enabled_state_;
+  subtle::Atomic32 category_group_enabled_state_readers_;
+  ScopedVector<CategoryGroupEnabledState> category_group_enabled_states_;
+
   ThreadLocalPointer<ThreadLocalEventBuffer> thread_local_event_buffer_;
   ThreadLocalBoolean thread_blocks_message_loop_;
   ThreadLocalBoolean thread_is_in_trace_event_;
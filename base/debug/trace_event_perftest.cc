@@ -0,0 +1,169 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <string>
+
+#include "base/bind.h"
+#include "base/debug/trace_event.h"
+#include "base/debug/trace_event_argument.h"
+#include "base/files/scoped_temp_dir.h"
+#include "base/json/json_writer.h"
+#include "base/memory/ref_counted_memory.h"
+#include "base/time/time.h"
+#include "base/values.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_test.h"
+
+namespace base {
+namespace debug {
+
+namespace {
+
+const int kNumEvents = 100000;
+
+void IgnoreFlushOutput(const scoped_refptr<RefCountedString>& events_str,
+                       bool has_more_events) {
+}
+
+void PrintCostPerEvent(const std::string& trace,
+                       const std::string& mode,
+                       TimeDelta elapsed) {
+  perf_test::PrintResult("trace_event", mode, trace,
+                         elapsed.InMillisecondsF() * 1000000 / kNumEvents,
+                         "ns/event", true);
+}
+
+scoped_refptr<TracedValue> CreateTracedValue(int i) {
+  scoped_refptr<TracedValue> value = new TracedValue;
+  value->SetInteger("id", i);
+  value->SetDouble("progress", i / 3.0);
+  value->SetString("state", "loading");
+  value->BeginArray("rect");
+  for (int j = 0; j < 4; ++j)
+    value->AppendInteger(i + j);
+  value->EndArray();
+  return value;
+}
+
+// The equivalent of CreateTracedValue() as it used to be recorded, as a Value
+// tree.
+scoped_ptr<Value> CreateValueTree(int i) {
+  scoped_ptr<DictionaryValue> value(new DictionaryValue);
+  value->SetInteger("id", i);
+  value->SetDouble("progress", i / 3.0);
+  value->SetString("state", "loading");
+  scoped_ptr<ListValue> rect(new ListValue);
+  for (int j = 0; j < 4; ++j)
+    rect->AppendInteger(i + j);
+  value->Set("rect", rect.Pass());
+  return value.Pass();
+}
+
+// Records kNumEvents of each kind of event and prints the average cost.
+void RecordEvents(const std::string& mode) {
+  TimeTicks start = TimeTicks::HighResNow();
+  for (int i = 0; i < kNumEvents; ++i) {
+    TRACE_EVENT_INSTANT0("perf", "instant", TRACE_EVENT_SCOPE_THREAD);
+  }
+  PrintCostPerEvent("instant", mode, TimeTicks::HighResNow() - start);
+
+  start = TimeTicks::HighResNow();
+  for (int i = 0; i < kNumEvents; ++i) {
+    TRACE_EVENT2("perf", "scoped", "index", i, "name", "value");
+  }
+  PrintCostPerEvent("scoped_two_args", mode, TimeTicks::HighResNow() - start);
+
+  start = TimeTicks::HighResNow();
+  for (int i = 0; i < kNumEvents; ++i) {
+    TRACE_EVENT_INSTANT1("perf", "traced_value", TRACE_EVENT_SCOPE_THREAD,
+                         "data", CreateTracedValue(i));
+  }
+  PrintCostPerEvent("traced_value", mode, TimeTicks::HighResNow() - start);
+}
+
+class TraceEventPerfTest : public testing::Test {
+ protected:
+  void SetUp() override { TraceLog::DeleteForTesting(); }
+
+  void TearDown() override {
+    if (TraceLog::GetInstance()->IsEnabled())
+      TraceLog::GetInstance()->SetDisabled();
+    TraceLog::GetInstance()->Flush(Bind(&IgnoreFlushOutput));
+    TraceLog::DeleteForTesting();
+  }
+};
+
+}  // namespace
+
+// Shows what tracing costs the code being traced, per event.
+TEST_F(TraceEventPerfTest, TracingOff) {
+  RecordEvents("_off");
+}
+
+TEST_F(TraceEventPerfTest, TracingOtherCategory) {
+  TraceLog::GetInstance()->SetEnabled(CategoryFilter("other"),
+                                      TraceLog::RECORDING_MODE,
+                                      TraceOptions(RECORD_CONTINUOUSLY));
+  RecordEvents("_other_category");
+}
+
+TEST_F(TraceEventPerfTest, TracingOn) {
+  TraceLog::GetInstance()->SetEnabled(CategoryFilter("perf"),
+                                      TraceLog::RECORDING_MODE,
+                                      TraceOptions(RECORD_CONTINUOUSLY));
+  RecordEvents("_on");
+}
+
+TEST_F(TraceEventPerfTest, StreamToFile) {
+  ScopedTempDir temp_dir;
+  ASSERT_TRUE(temp_dir.CreateUniqueTempDir());
+  TraceLog::GetInstance()->SetStreamingFilePath(
+      temp_dir.path().AppendASCII("trace.bin"));
+  TraceLog::GetInstance()->SetEnabled(CategoryFilter("perf"),
+                                      TraceLog::RECORDING_MODE,
+                                      TraceOptions(STREAM_TO_FILE));
+  RecordEvents("_stream_to_file");
+  TraceLog::GetInstance()->SetDisabled();
+  TimeTicks start = TimeTicks::HighResNow();
+  TraceLog::GetInstance()->Flush(Bind(&IgnoreFlushOutput));
+  PrintCostPerEvent("finish_file", "_stream_to_file",
+                    TimeTicks::HighResNow() - start);
+}
+
+// Compares recording a structured argument as a TracedValue with building the
+// Value tree it used to be backed by, and the cost of converting each to JSON.
+TEST_F(TraceEventPerfTest, TracedValue) {
+  TimeTicks start = TimeTicks::HighResNow();
+  for (int i = 0; i < kNumEvents; ++i)
+    CreateTracedValue(i);
+  PrintCostPerEvent("build", "_traced_value", TimeTicks::HighResNow() - start);
+
+  start = TimeTicks::HighResNow();
+  for (int i = 0; i < kNumEvents; ++i)
+    CreateValueTree(i);
+  PrintCostPerEvent("build", "_value_tree", TimeTicks::HighResNow() - start);
+
+  scoped_refptr<TracedValue> traced_value = CreateTracedValue(1);
+  std::string json;
+  start = TimeTicks::HighResNow();
+  for (int i = 0; i < kNumEvents; ++i) {
+    json.clear();
+    traced_value->AppendAsTraceFormat(&json);
+  }
+  PrintCostPerEvent("to_json", "_traced_value",
+                    TimeTicks::HighResNow() - start);
+
+  scoped_ptr<Value> value_tree = CreateValueTree(1);
+  std::string value_tree_json;
+  start = TimeTicks::HighResNow();
+  for (int i = 0; i < kNumEvents; ++i) {
+    value_tree_json.clear();
+    JSONWriter::Write(value_tree.get(), &value_tree_json);
+  }
+  PrintCostPerEvent("to_json", "_value_tree", TimeTicks::HighResNow() - start);
+  EXPECT_EQ(value_tree_json, json);
+}
+
+}  // namespace debug
+}  // namespace base
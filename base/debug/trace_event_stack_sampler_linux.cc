@@ -0,0 +1,416 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/debug/trace_event_stack_sampler_linux.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <ucontext.h>
+#include <unistd.h>
+
+#include "base/atomicops.h"
+#include "base/debug/proc_maps_linux.h"
+#include "base/debug/trace_event.h"
+#include "base/json/string_escape.h"
+#include "base/logging.h"
+#include "base/memory/singleton.h"
+#include "base/posix/eintr_wrapper.h"
+#include "base/strings/stringprintf.h"
+#include "base/synchronization/waitable_event.h"
+#include "build/build_config.h"
+
+namespace base {
+namespace debug {
+
+namespace {
+
+// How long to wait for a thread to take its sample. A thread that has
+// SIGPROF blocked, or that is stopped, is skipped.
+const int kSampleTimeoutMilliseconds = 100;
+
+// The handshake between the sampling thread and the signal handler. The
+// sampling thread moves g_sample_state from kIdle to kRequested and signals a
+// thread. The handler only captures a stack if it moves the state on from
+// kRequested, so a late signal after a timeout does nothing.
+enum SampleState {
+  kIdle,
+  kRequested,
+  kCapturing,
+  kCaptured,
+};
+
+subtle::Atomic32 g_sample_state = kIdle;
+// The stack of the thread that is signalled, set before the request.
+uintptr_t g_sample_stack_low = 0;
+uintptr_t g_sample_stack_high = 0;
+void* g_sample_frames[TraceEventStackSampler::kMaxFrames];
+int g_sample_frame_count = 0;
+sem_t g_sample_captured;
+
+// What SIGPROF did before profiling started.
+struct sigaction g_old_action;
+
+// Walks the frame pointers of the interrupted code in |context| into
+// g_sample_frames. Unlike backtrace(), this is async-signal-safe. Frame
+// pointers are only followed while they point up the thread's stack, so a
+// frame without one ends the walk instead of faulting.
+void CaptureStack(const ucontext_t* context) {
+#if defined(ARCH_CPU_X86_64)
+  uintptr_t pc = context->uc_mcontext.gregs[REG_RIP];
+  uintptr_t fp = context->uc_mcontext.gregs[REG_RBP];
+#elif defined(ARCH_CPU_X86)
+  uintptr_t pc = context->uc_mcontext.gregs[REG_EIP];
+  uintptr_t fp = context->uc_mcontext.gregs[REG_EBP];
+#elif defined(ARCH_CPU_ARM64)
+  uintptr_t pc = context->uc_mcontext.pc;
+  uintptr_t fp = context->uc_mcontext.regs[29];
+#else
+  // Frame records differ between compilers here. Only the innermost frame is
+  // known.
+  uintptr_t pc = 0;
+  uintptr_t fp = 0;
+#endif
+  int count = 0;
+  if (pc)
+    g_sample_frames[count++] = reinterpret_cast<void*>(pc);
+
+  // A frame record holds the caller's frame pointer, then the return address.
+  const uintptr_t kRecordSize = 2 * sizeof(uintptr_t);
+  while (count < TraceEventStackSampler::kMaxFrames &&
+         fp >= g_sample_stack_low && fp <= g_sample_stack_high - kRecordSize &&
+         fp % sizeof(uintptr_t) == 0) {
+    const uintptr_t* record = reinterpret_cast<const uintptr_t*>(fp);
+    if (!record[1])
+      break;
+    g_sample_frames[count++] = reinterpret_cast<void*>(record[1]);
+    // The stack grows down, so callers' frames are at higher addresses.
+    if (record[0] <= fp)
+      break;
+    fp = record[0];
+  }
+  g_sample_frame_count = count;
+}
+
+void OnProfilingSignal(int signal, siginfo_t* info, void* context) {
+  int saved_errno = errno;
+  if (subtle::Acquire_CompareAndSwap(&g_sample_state, kRequested,
+                                     kCapturing) == kRequested) {
+    CaptureStack(static_cast<const ucontext_t*>(context));
+    subtle::Release_Store(&g_sample_state, kCaptured);
+    sem_post(&g_sample_captured);
+  }
+  errno = saved_errno;
+}
+
+// Returns the bounds of the calling thread's stack.
+bool GetCurrentThreadStack(uintptr_t* low, uintptr_t* high) {
+  pthread_attr_t attr;
+  if (pthread_getattr_np(pthread_self(), &attr) != 0)
+    return false;
+  void* address = NULL;
+  size_t size = 0;
+  bool result = pthread_attr_getstack(&attr, &address, &size) == 0;
+  pthread_attr_destroy(&attr);
+  if (!result)
+    return false;
+  *low = reinterpret_cast<uintptr_t>(address);
+  *high = *low + size;
+  return true;
+}
+
+void RestoreSignalAction() {
+  // A signal that timed out may still be pending, so SIGPROF is ignored
+  // rather than given back its default action, which kills the process.
+  if (g_old_action.sa_handler == SIG_DFL)
+    g_old_action.sa_handler = SIG_IGN;
+  sigaction(SIGPROF, &g_old_action, NULL);
+}
+
+// Waits until the handler has captured a sample or the timeout passes.
+// Returns true if there is a sample.
+bool WaitForSample() {
+  struct timespec deadline;
+  clock_gettime(CLOCK_REALTIME, &deadline);
+  deadline.tv_nsec += kSampleTimeoutMilliseconds * 1000000L;
+  deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+  deadline.tv_nsec %= 1000000000L;
+  if (HANDLE_EINTR(sem_timedwait(&g_sample_captured, &deadline)) == 0)
+    return true;
+
+  if (subtle::Acquire_CompareAndSwap(&g_sample_state, kRequested, kIdle) ==
+      kRequested) {
+    return false;
+  }
+  // The handler started just in time. Let it finish.
+  HANDLE_EINTR(sem_wait(&g_sample_captured));
+  return true;
+}
+
+// The return addresses of a sample, from the innermost frame out, as a JSON
+// array of hex strings.
+class StackFrames : public ConvertableToTraceFormat {
+ public:
+  StackFrames(void* const* frames, int frame_count)
+      : frames_(frames, frames + frame_count) {}
+
+  void AppendAsTraceFormat(std::string* out) const override {
+    out->append("[");
+    for (size_t i = 0; i < frames_.size(); ++i) {
+      if (i)
+        out->append(",");
+      StringAppendF(out, "\"%p\"", frames_[i]);
+    }
+    out->append("]");
+  }
+
+ private:
+  ~StackFrames() override {}
+
+  std::vector<void*> frames_;
+
+  DISALLOW_COPY_AND_ASSIGN(StackFrames);
+};
+
+// The executable mappings of the process, which map return addresses to
+// offsets in the binaries for offline symbolization.
+class ModuleMap : public ConvertableToTraceFormat {
+ public:
+  ModuleMap() {
+    std::string proc_maps;
+    if (!ReadProcMaps(&proc_maps) || !ParseProcMaps(proc_maps, &regions_))
+      regions_.clear();
+  }
+
+  void AppendAsTraceFormat(std::string* out) const override {
+    out->append("[");
+    bool first = true;
+    for (size_t i = 0; i < regions_.size(); ++i) {
+      const MappedMemoryRegion& region = regions_[i];
+      if (!(region.permissions & MappedMemoryRegion::EXECUTE))
+        continue;
+      if (!first)
+        out->append(",");
+      first = false;
+      StringAppendF(out,
+                    "{\"start\":\"0x%lx\",\"end\":\"0x%lx\","
+                    "\"offset\":\"0x%llx\",\"path\":",
+                    static_cast<unsigned long>(region.start),
+                    static_cast<unsigned long>(region.end), region.offset);
+      EscapeJSONString(region.path, true, out);
+      out->append("}");
+    }
+    out->append("]");
+  }
+
+ private:
+  ~ModuleMap() override {}
+
+  std::vector<MappedMemoryRegion> regions_;
+
+  DISALLOW_COPY_AND_ASSIGN(ModuleMap);
+};
+
+}  // namespace
+
+class TraceEventStackSampler::SamplingThread
+    : public PlatformThread::Delegate {
+ public:
+  SamplingThread(TraceEventStackSampler* sampler, TimeDelta interval)
+      : sampler_(sampler),
+        interval_(interval),
+        stop_event_(false, false) {}
+  ~SamplingThread() override {}
+
+  // PlatformThread::Delegate:
+  void ThreadMain() override {
+    PlatformThread::SetName("StackSamplingThread");
+    TRACE_EVENT_INSTANT1(kCategory, "ModuleMap", TRACE_EVENT_SCOPE_PROCESS,
+                         "modules",
+                         scoped_refptr<ConvertableToTraceFormat>(
+                             new ModuleMap()));
+    while (!stop_event_.TimedWait(interval_))
+      sampler_->SampleThreads();
+  }
+
+  void Stop() { stop_event_.Signal(); }
+
+ private:
+  TraceEventStackSampler* sampler_;
+  const TimeDelta interval_;
+  WaitableEvent stop_event_;
+
+  DISALLOW_COPY_AND_ASSIGN(SamplingThread);
+};
+
+const char TraceEventStackSampler::kCategory[] =
+    TRACE_DISABLED_BY_DEFAULT("cpu_profiler");
+
+// static
+TraceEventStackSampler* TraceEventStackSampler::GetInstance() {
+  return Singleton<TraceEventStackSampler,
+                   LeakySingletonTraits<TraceEventStackSampler> >::get();
+}
+
+TraceEventStackSampler::TraceEventStackSampler()
+    : sampling_interval_(TimeDelta::FromMicroseconds(
+          kDefaultSamplingIntervalMicroseconds)) {
+  // Force the "cpu_profiler" category to show up in the trace viewer.
+  TraceLog::GetCategoryGroupEnabled(kCategory);
+  TraceLog::GetInstance()->AddEnabledStateObserver(this);
+  // TraceLog creates the sampler before enabling its category, but tracing
+  // may already be running with other categories.
+  if (TraceLog::GetInstance()->IsEnabled())
+    OnTraceLogEnabled();
+}
+
+TraceEventStackSampler::~TraceEventStackSampler() {
+  StopProfiling();
+  TraceLog::GetInstance()->RemoveEnabledStateObserver(this);
+}
+
+void TraceEventStackSampler::RegisterCurrentThread() {
+  PlatformThreadId thread_id = PlatformThread::CurrentId();
+  {
+    AutoLock lock(lock_);
+    for (size_t i = 0; i < threads_.size(); ++i) {
+      if (threads_[i].id == thread_id) {
+        ++threads_[i].registrations;
+        return;
+      }
+    }
+  }
+
+  SampledThread thread;
+  thread.id = thread_id;
+  thread.registrations = 1;
+  if (!GetCurrentThreadStack(&thread.stack_low, &thread.stack_high)) {
+    // Only the innermost frame is captured.
+    thread.stack_low = 0;
+    thread.stack_high = 0;
+  }
+  AutoLock lock(lock_);
+  threads_.push_back(thread);
+}
+
+void TraceEventStackSampler::UnregisterCurrentThread() {
+  PlatformThreadId thread_id = PlatformThread::CurrentId();
+  AutoLock lock(lock_);
+  for (size_t i = 0; i < threads_.size(); ++i) {
+    if (threads_[i].id == thread_id) {
+      if (--threads_[i].registrations == 0)
+        threads_.erase(threads_.begin() + i);
+      return;
+    }
+  }
+  NOTREACHED();
+}
+
+void TraceEventStackSampler::SetSamplingInterval(TimeDelta interval) {
+  DCHECK(interval > TimeDelta());
+  AutoLock lock(lock_);
+  sampling_interval_ = interval;
+}
+
+void TraceEventStackSampler::OnTraceLogEnabled() {
+  bool enabled;
+  TRACE_EVENT_CATEGORY_GROUP_ENABLED(kCategory, &enabled);
+  if (enabled)
+    StartProfiling();
+}
+
+void TraceEventStackSampler::OnTraceLogDisabled() {
+  StopProfiling();
+}
+
+void TraceEventStackSampler::StartProfiling() {
+  AutoLock lock(lock_);
+  // Watch for the tracing framework sending enabling more than once.
+  if (sampling_thread_)
+    return;
+
+  sem_init(&g_sample_captured, 0, 0);
+  struct sigaction action;
+  memset(&action, 0, sizeof(action));
+  action.sa_sigaction = &OnProfilingSignal;
+  action.sa_flags = SA_RESTART | SA_SIGINFO;
+  sigemptyset(&action.sa_mask);
+  if (sigaction(SIGPROF, &action, &g_old_action) != 0) {
+    DPLOG(ERROR) << "sigaction";
+    sem_destroy(&g_sample_captured);
+    return;
+  }
+
+  sampling_thread_.reset(new SamplingThread(this, sampling_interval_));
+  if (!PlatformThread::Create(0, sampling_thread_.get(),
+                              &sampling_thread_handle_)) {
+    DLOG(ERROR) << "failed to create thread";
+    sampling_thread_.reset();
+    RestoreSignalAction();
+    sem_destroy(&g_sample_captured);
+  }
+}
+
+void TraceEventStackSampler::StopProfiling() {
+  scoped_ptr<SamplingThread> sampling_thread;
+  PlatformThreadHandle sampling_thread_handle;
+  {
+    AutoLock lock(lock_);
+    sampling_thread.swap(sampling_thread_);
+    sampling_thread_handle = sampling_thread_handle_;
+    sampling_thread_handle_ = PlatformThreadHandle();
+  }
+  if (!sampling_thread)
+    return;
+
+  // The sampling thread takes |lock_| to read the threads.
+  sampling_thread->Stop();
+  PlatformThread::Join(sampling_thread_handle);
+
+  RestoreSignalAction();
+  sem_destroy(&g_sample_captured);
+}
+
+void TraceEventStackSampler::SampleThreads() {
+  std::vector<SampledThread> threads;
+  {
+    AutoLock lock(lock_);
+    threads = threads_;
+  }
+
+  const unsigned char* category_enabled =
+      TraceLog::GetCategoryGroupEnabled(kCategory);
+  pid_t process_id = getpid();
+  for (size_t i = 0; i < threads.size(); ++i) {
+    g_sample_stack_low = threads[i].stack_low;
+    g_sample_stack_high = threads[i].stack_high;
+    subtle::Release_Store(&g_sample_state, kRequested);
+    if (syscall(__NR_tgkill, process_id, threads[i].id, SIGPROF) != 0) {
+      // The thread has exited without unregistering.
+      subtle::Release_Store(&g_sample_state, kIdle);
+      continue;
+    }
+    if (!WaitForSample())
+      continue;
+
+    TimeTicks timestamp = TimeTicks::NowFromSystemTraceTime();
+    scoped_refptr<ConvertableToTraceFormat> frames(
+        new StackFrames(g_sample_frames, g_sample_frame_count));
+    subtle::Release_Store(&g_sample_state, kIdle);
+
+    const char* arg_name = "frames";
+    unsigned char arg_type = TRACE_VALUE_TYPE_CONVERTABLE;
+    TraceLog::GetInstance()->AddTraceEventWithThreadIdAndTimestamp(
+        TRACE_EVENT_PHASE_SAMPLE, category_enabled, "StackSample", 0,
+        static_cast<int>(threads[i].id), timestamp, 1, &arg_name, &arg_type,
+        NULL, &frames, TRACE_EVENT_FLAG_NONE);
+  }
+}
+
+}  // namespace debug
+}  // namespace base
@@ -0,0 +1,105 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BASE_DEBUG_TRACE_EVENT_STACK_SAMPLER_LINUX_H_
+#define BASE_DEBUG_TRACE_EVENT_STACK_SAMPLER_LINUX_H_
+
+#include <vector>
+
+#include "base/base_export.h"
+#include "base/debug/trace_event_impl.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/synchronization/lock.h"
+#include "base/threading/platform_thread.h"
+#include "base/time/time.h"
+
+template <typename T> struct DefaultSingletonTraits;
+
+namespace base {
+namespace debug {
+
+// A statistical profiler that records native stacks into the trace. While the
+// "disabled-by-default-cpu_profiler" category is being traced, a thread
+// interrupts each registered thread with SIGPROF at a fixed interval. The
+// signal handler walks the thread's frame pointers, and the sampler adds the
+// stack to the trace as a sample event of that thread, with the return
+// addresses in a "frames" argument. Frames of code built without frame
+// pointers are missing from the stacks.
+//
+// TraceLog registers each thread with a MessageLoop that records trace events
+// while the category is enabled, and unregisters it once its events are
+// flushed. Other threads can register themselves.
+//
+// Nothing is symbolized in the process. When profiling starts, the sampler
+// records the executable mappings of the process in a "ModuleMap" event, so
+// that tools can symbolize the addresses offline against the binaries' symbol
+// files. That way it can profile release builds without instrumentation.
+class BASE_EXPORT TraceEventStackSampler
+    : public TraceLog::EnabledStateObserver {
+ public:
+  // The default interval between two samples of a thread.
+  static const int kDefaultSamplingIntervalMicroseconds = 10000;
+
+  // The deepest stack that is recorded. Deeper stacks lose their outermost
+  // frames.
+  static const int kMaxFrames = 64;
+
+  // The category that turns profiling on.
+  static const char kCategory[];
+
+  static TraceEventStackSampler* GetInstance();
+
+  // Adds the calling thread to the threads that are sampled, or takes it out.
+  // A thread must unregister before it exits, once for each registration.
+  void RegisterCurrentThread();
+  void UnregisterCurrentThread();
+
+  // Sets how often each thread is sampled. Takes effect the next time
+  // profiling starts.
+  void SetSamplingInterval(TimeDelta interval);
+
+  // TraceLog::EnabledStateObserver overrides:
+  void OnTraceLogEnabled() override;
+  void OnTraceLogDisabled() override;
+
+ private:
+  friend struct DefaultSingletonTraits<TraceEventStackSampler>;
+
+  class SamplingThread;
+
+  struct SampledThread {
+    PlatformThreadId id;
+    // The bounds of the thread's stack, which the signal handler doesn't read
+    // outside of.
+    uintptr_t stack_low;
+    uintptr_t stack_high;
+    // How many times the thread is registered.
+    int registrations;
+  };
+
+  TraceEventStackSampler();
+  virtual ~TraceEventStackSampler();
+
+  void StartProfiling();
+  void StopProfiling();
+
+  // Captures the stack of each registered thread, and adds it to the trace.
+  void SampleThreads();
+
+  // Protects the members below.
+  Lock lock_;
+
+  std::vector<SampledThread> threads_;
+  TimeDelta sampling_interval_;
+
+  scoped_ptr<SamplingThread> sampling_thread_;
+  PlatformThreadHandle sampling_thread_handle_;
+
+  DISALLOW_COPY_AND_ASSIGN(TraceEventStackSampler);
+};
+
+}  // namespace debug
+}  // namespace base
+
+#endif  // BASE_DEBUG_TRACE_EVENT_STACK_SAMPLER_LINUX_H_
@@ -0,0 +1,186 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/debug/trace_event_stack_sampler_linux.h"
+
+#include <string>
+
+#include "base/bind.h"
+#include "base/debug/trace_event.h"
+#include "base/json/json_reader.h"
+#include "base/memory/ref_counted_memory.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/synchronization/waitable_event.h"
+#include "base/threading/thread.h"
+#include "base/values.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+namespace debug {
+
+namespace {
+
+void OnTraceDataCollected(std::string* json,
+                          WaitableEvent* flush_complete_event,
+                          const scoped_refptr<RefCountedString>& events_str,
+                          bool has_more_events) {
+  if (!events_str->data().empty()) {
+    if (!json->empty())
+      json->append(",");
+    json->append(events_str->data());
+  }
+  if (!has_more_events)
+    flush_complete_event->Signal();
+}
+
+// Returns the first event named |name| on thread |thread_id|, or on any
+// thread if |thread_id| is 0.
+const DictionaryValue* FindEvent(const ListValue& events,
+                                 const std::string& name,
+                                 int thread_id) {
+  for (size_t i = 0; i < events.GetSize(); ++i) {
+    const DictionaryValue* event;
+    std::string event_name;
+    int event_thread_id;
+    if (events.GetDictionary(i, &event) &&
+        event->GetString("name", &event_name) && event_name == name &&
+        event->GetInteger("tid", &event_thread_id) &&
+        (!thread_id || event_thread_id == thread_id)) {
+      return event;
+    }
+  }
+  return NULL;
+}
+
+void Spin(TimeDelta duration) {
+  TimeTicks end = TimeTicks::Now() + duration;
+  while (TimeTicks::Now() < end) {
+  }
+}
+
+void SpinInTraceEvent(TimeDelta duration) {
+  TRACE_EVENT0("test", "SpinInTraceEvent");
+  Spin(duration);
+}
+
+}  // namespace
+
+class TraceEventStackSamplerTest : public testing::Test {
+ public:
+  TraceEventStackSamplerTest() {}
+
+ protected:
+  TraceEventStackSampler* sampler() {
+    return TraceEventStackSampler::GetInstance();
+  }
+
+  void StartTracing(const std::string& category_filter) {
+    TraceLog::GetInstance()->SetEnabled(CategoryFilter(category_filter),
+                                        TraceLog::RECORDING_MODE,
+                                        TraceOptions());
+  }
+
+  // Traces |category_filter| for |duration| while spinning on the current
+  // thread, and returns the events.
+  scoped_ptr<ListValue> TraceWhileSpinning(const std::string& category_filter,
+                                           TimeDelta duration) {
+    StartTracing(category_filter);
+    Spin(duration);
+    return StopTracing();
+  }
+
+  // Stops tracing and returns the events.
+  scoped_ptr<ListValue> StopTracing() {
+    TraceLog::GetInstance()->SetDisabled();
+
+    std::string json;
+    WaitableEvent flush_complete_event(false, false);
+    TraceLog::GetInstance()->Flush(
+        Bind(&OnTraceDataCollected, &json, &flush_complete_event));
+    flush_complete_event.Wait();
+
+    scoped_ptr<Value> root(JSONReader::Read("[" + json + "]"));
+    ListValue* events = NULL;
+    if (!root || !root->GetAsList(&events))
+      return scoped_ptr<ListValue>();
+    ignore_result(root.release());
+    return make_scoped_ptr(events);
+  }
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(TraceEventStackSamplerTest);
+};
+
+TEST_F(TraceEventStackSamplerTest, SamplesRegisteredThreads) {
+  sampler()->SetSamplingInterval(TimeDelta::FromMilliseconds(1));
+  sampler()->RegisterCurrentThread();
+  scoped_ptr<ListValue> events =
+      TraceWhileSpinning(TRACE_DISABLED_BY_DEFAULT("cpu_profiler"),
+                         TimeDelta::FromMilliseconds(200));
+  sampler()->UnregisterCurrentThread();
+  ASSERT_TRUE(events);
+
+  const DictionaryValue* sample = FindEvent(
+      *events, "StackSample", static_cast<int>(PlatformThread::CurrentId()));
+  ASSERT_TRUE(sample);
+  std::string phase;
+  EXPECT_TRUE(sample->GetString("ph", &phase));
+  EXPECT_EQ("P", phase);
+  const ListValue* frames;
+  ASSERT_TRUE(sample->GetList("args.frames", &frames));
+  EXPECT_GT(frames->GetSize(), 0u);
+
+  const DictionaryValue* module_map = FindEvent(*events, "ModuleMap", 0);
+  ASSERT_TRUE(module_map);
+  const ListValue* modules;
+  ASSERT_TRUE(module_map->GetList("args.modules", &modules));
+  EXPECT_GT(modules->GetSize(), 0u);
+  const DictionaryValue* module;
+  ASSERT_TRUE(modules->GetDictionary(0, &module));
+  EXPECT_TRUE(module->HasKey("start"));
+  EXPECT_TRUE(module->HasKey("offset"));
+  EXPECT_TRUE(module->HasKey("path"));
+}
+
+TEST_F(TraceEventStackSamplerTest, SamplesThreadsThatTrace) {
+  sampler()->SetSamplingInterval(TimeDelta::FromMilliseconds(1));
+  Thread thread("SampledThread");
+  ASSERT_TRUE(thread.Start());
+  StartTracing("test," TRACE_DISABLED_BY_DEFAULT("cpu_profiler"));
+  thread.message_loop()->PostTask(
+      FROM_HERE, Bind(&SpinInTraceEvent, TimeDelta::FromMilliseconds(200)));
+  // Flushes the events of the thread, which unregisters it.
+  PlatformThreadId thread_id = thread.thread_id();
+  thread.Stop();
+  scoped_ptr<ListValue> events = StopTracing();
+  ASSERT_TRUE(events);
+  EXPECT_TRUE(FindEvent(*events, "StackSample", static_cast<int>(thread_id)));
+}
+
+TEST_F(TraceEventStackSamplerTest, SamplesWhenMergedIntoRunningTrace) {
+  sampler()->SetSamplingInterval(TimeDelta::FromMilliseconds(1));
+  sampler()->RegisterCurrentThread();
+  StartTracing("test");
+  StartTracing(TRACE_DISABLED_BY_DEFAULT("cpu_profiler"));
+  Spin(TimeDelta::FromMilliseconds(200));
+  scoped_ptr<ListValue> events = StopTracing();
+  sampler()->UnregisterCurrentThread();
+  ASSERT_TRUE(events);
+  EXPECT_TRUE(FindEvent(*events, "StackSample",
+                        static_cast<int>(PlatformThread::CurrentId())));
+}
+
+TEST_F(TraceEventStackSamplerTest, IdleWithoutCategory) {
+  sampler()->SetSamplingInterval(TimeDelta::FromMilliseconds(1));
+  sampler()->RegisterCurrentThread();
+  scoped_ptr<ListValue> events =
+      TraceWhileSpinning("*", TimeDelta::FromMilliseconds(50));
+  sampler()->UnregisterCurrentThread();
+  ASSERT_TRUE(events);
+  EXPECT_FALSE(FindEvent(*events, "StackSample", 0));
+  EXPECT_FALSE(FindEvent(*events, "ModuleMap", 0));
+}
+
+}  // namespace debug
+}  // namespace base
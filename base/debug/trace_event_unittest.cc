@@ -10,7 +10,10 @@
 #include "base/bind.h"
 #include "base/command_line.h"
 #include "base/debug/trace_event.h"
+#include "base/debug/trace_event_binary.h"
 #include "base/debug/trace_event_synthetic_delay.h"
+#include "base/files/file_util.h"
+#include "base/files/scoped_temp_dir.h"
 #include "base/json/json_reader.h"
 #include "base/json/json_writer.h"
 #include "base/memory/ref_counted_memory.h"
@@ -1240,6 +1243,53 @@ TEST_F(TraceEventTestFixture, Categories) {
   EXPECT_FALSE(FindMatchingValue("name", "not_inc"));
 }
 
+void GetCategoryGroupsEnabled(const char* const* category_groups,
+                              size_t num_category_groups,
+                              std::vector<const unsigned char*>* enabled,
+                              WaitableEvent* task_complete_event) {
+  for (size_t i = 0; i < num_category_groups; i++)
+    enabled->push_back(TraceLog::GetCategoryGroupEnabled(category_groups[i]));
+  task_complete_event->Signal();
+}
+
+// Threads that add the same new category groups at the same time all get the
+// same enabled flags back.
+TEST_F(TraceEventTestFixture, CategoriesAddedConcurrently) {
+  BeginSpecificTrace("concurrent_a");
+
+  const char* const category_groups[] = {
+    "concurrent_a", "concurrent_b", "concurrent_c"
+  };
+  const int num_threads = 4;
+  Thread* threads[num_threads];
+  WaitableEvent* task_complete_events[num_threads];
+  std::vector<const unsigned char*> enabled[num_threads];
+  for (int i = 0; i < num_threads; i++) {
+    threads[i] = new Thread(StringPrintf("Thread %d", i));
+    task_complete_events[i] = new WaitableEvent(false, false);
+    threads[i]->Start();
+  }
+  for (int i = 0; i < num_threads; i++) {
+    threads[i]->message_loop()->PostTask(
+        FROM_HERE, base::Bind(&GetCategoryGroupsEnabled, category_groups,
+                              arraysize(category_groups), &enabled[i],
+                              task_complete_events[i]));
+  }
+  for (int i = 0; i < num_threads; i++) {
+    task_complete_events[i]->Wait();
+    threads[i]->Stop();
+    delete threads[i];
+    delete task_complete_events[i];
+  }
+
+  for (int i = 1; i < num_threads; i++)
+    EXPECT_EQ(enabled[0], enabled[i]);
+  EXPECT_TRUE(*enabled[0][0] & TraceLog::ENABLED_FOR_RECORDING);
+  EXPECT_FALSE(*enabled[0][1] & TraceLog::ENABLED_FOR_RECORDING);
+  EXPECT_FALSE(*enabled[0][2] & TraceLog::ENABLED_FOR_RECORDING);
+  EndTraceAndFlush();
+}
+
 
 // Test EVENT_WATCH_NOTIFICATION
 TEST_F(TraceEventTestFixture, EventWatchNotification) {
@@ -2623,6 +2673,85 @@ TEST_F(TraceEventTestFixture, TraceRecordAsMuchAsPossibleMode) {
   TraceLog::GetInstance()->SetDisabled();
 }
 
+TEST_F(TraceEventTestFixture, TraceStreamToFileMode) {
+  ScopedTempDir temp_dir;
+  ASSERT_TRUE(temp_dir.CreateUniqueTempDir());
+  FilePath path = temp_dir.path().AppendASCII("trace.bin");
+  TraceLog::GetInstance()->SetStreamingFilePath(path);
+  TraceLog::GetInstance()->SetEnabled(CategoryFilter("*"),
+                                      TraceLog::RECORDING_MODE,
+                                      TraceOptions(STREAM_TO_FILE));
+  // Only a small window of events is kept in memory.
+  EXPECT_GE(8192u, TraceLog::GetInstance()->GetStatus().event_capacity);
+
+  const int kNumEvents = 100000;
+  {
+    TRACE_EVENT0("all", "outer");
+    for (int i = 0; i < kNumEvents; ++i)
+      TRACE_EVENT_INSTANT1("all", "streamed", TRACE_EVENT_SCOPE_THREAD,
+                           "index", i);
+  }
+  EndTraceAndFlush();
+
+  // The events went to the file rather than to Flush().
+  EXPECT_FALSE(FindNamePhase("streamed", "i"));
+
+  std::string data;
+  ASSERT_TRUE(ReadFileToString(path, &data));
+  TraceEventBinaryReader reader(data);
+  std::string json = "[";
+  EXPECT_TRUE(reader.AppendAllEventsAsJSON(&json));
+  json += "]";
+  scoped_ptr<Value> root(JSONReader::Read(json));
+  ListValue* events = NULL;
+  ASSERT_TRUE(root.get() && root->GetAsList(&events));
+
+  // The writer may fall behind and drop chunks, but reports how many events
+  // it lost, and what it kept is in order.
+  int num_streamed = 0;
+  int last_index = -1;
+  for (size_t i = 0; i < events->GetSize(); ++i) {
+    DictionaryValue* event = NULL;
+    std::string name;
+    int index = 0;
+    ASSERT_TRUE(events->GetDictionary(i, &event));
+    if (!event->GetString("name", &name) || name != "streamed")
+      continue;
+    EXPECT_TRUE(event->GetInteger("args.index", &index));
+    EXPECT_LT(last_index, index);
+    last_index = index;
+    ++num_streamed;
+  }
+  EXPECT_EQ(static_cast<size_t>(kNumEvents),
+            num_streamed + reader.dropped_events());
+}
+
+TEST_F(TraceEventTestFixture, TraceStreamToFileModeFlushOnMessageLoop) {
+  ScopedTempDir temp_dir;
+  ASSERT_TRUE(temp_dir.CreateUniqueTempDir());
+  FilePath path = temp_dir.path().AppendASCII("trace.bin");
+  TraceLog::GetInstance()->SetStreamingFilePath(path);
+  TraceLog::GetInstance()->SetEnabled(CategoryFilter("*"),
+                                      TraceLog::RECORDING_MODE,
+                                      TraceOptions(STREAM_TO_FILE));
+  const int kNumEvents = 100000;
+  for (int i = 0; i < kNumEvents; ++i)
+    TRACE_EVENT_INSTANT0("all", "streamed", TRACE_EVENT_SCOPE_THREAD);
+  // The flush completes on the flushing thread once the file is written.
+  EndTraceAndFlushInThreadWithMessageLoop();
+
+  std::string data;
+  ASSERT_TRUE(ReadFileToString(path, &data));
+  TraceEventBinaryReader reader(data);
+  std::string json = "[";
+  EXPECT_TRUE(reader.AppendAllEventsAsJSON(&json));
+  json += "]";
+  scoped_ptr<Value> root(JSONReader::Read(json));
+  ListValue* events = NULL;
+  ASSERT_TRUE(root.get() && root->GetAsList(&events));
+  EXPECT_LT(0u, events->GetSize());
+}
+
 // Test the category filter.
 TEST_F(TraceEventTestFixture, CategoryFilter) {
   // Using the default filter.
@@ -2769,6 +2898,10 @@ TEST_F(TraceEventTestFixture, ConvertTraceOptionsToInternalOptions) {
   EXPECT_EQ(TraceLog::kInternalEchoToConsole,
             trace_log->GetInternalOptionsFromTraceOptions(options));
 
+  options.record_mode = STREAM_TO_FILE;
+  EXPECT_EQ(TraceLog::kInternalStreamToFile,
+            trace_log->GetInternalOptionsFromTraceOptions(options));
+
   options.enable_sampling = true;
 
   options.record_mode = RECORD_UNTIL_FULL;
@@ -3032,6 +3165,11 @@ TEST(TraceOptionsTest, TraceOptionsFromString) {
   EXPECT_FALSE(options.enable_sampling);
   EXPECT_FALSE(options.enable_systrace);
 
+  EXPECT_TRUE(options.SetFromString("stream-to-file"));
+  EXPECT_EQ(STREAM_TO_FILE, options.record_mode);
+  EXPECT_FALSE(options.enable_sampling);
+  EXPECT_FALSE(options.enable_systrace);
+
   EXPECT_TRUE(options.SetFromString("record-until-full, enable-sampling"));
   EXPECT_EQ(RECORD_UNTIL_FULL, options.record_mode);
   EXPECT_TRUE(options.enable_sampling);
@@ -3068,11 +3206,12 @@ TEST(TraceOptionsTest, TraceOptionsToString) {
   TraceRecordMode modes[] = {RECORD_UNTIL_FULL,
                              RECORD_CONTINUOUSLY,
                              ECHO_TO_CONSOLE,
-                             RECORD_AS_MUCH_AS_POSSIBLE};
+                             RECORD_AS_MUCH_AS_POSSIBLE,
+                             STREAM_TO_FILE};
   bool enable_sampling_options[] = {true, false};
   bool enable_systrace_options[] = {true, false};
 
-  for (int i = 0; i < 4; ++i) {
+  for (size_t i = 0; i < arraysize(modes); ++i) {
     for (int j = 0; j < 2; ++j) {
       for (int k = 0; k < 2; ++k) {
         TraceOptions original_option = TraceOptions(modes[i]);
@@ -7,6 +7,7 @@
 
 #include "base/files/file_path_watcher.h"
 
+#include "base/bind.h"
 #include "base/logging.h"
 #include "base/message_loop/message_loop.h"
 
@@ -16,6 +17,27 @@
 
 namespace base {
 
+namespace {
+
+// The defaults for BatchOptions.
+const int kDefaultCoalescingWindowMs = 100;
+const size_t kDefaultMaxBatchSize = 1000;
+
+void RunBatchCallback(const FilePathWatcher::BatchCallback& callback,
+                      const FilePath& path,
+                      bool error) {
+  callback.Run(std::vector<FilePath>(1, path), false, error);
+}
+
+}  // namespace
+
+FilePathWatcher::BatchOptions::BatchOptions()
+    : recursive(false),
+      coalescing_window(
+          TimeDelta::FromMilliseconds(kDefaultCoalescingWindowMs)),
+      max_batch_size(kDefaultMaxBatchSize) {
+}
+
 FilePathWatcher::~FilePathWatcher() {
   impl_->Cancel();
 }
@@ -46,6 +68,13 @@ FilePathWatcher::PlatformDelegate::~PlatformDelegate() {
   DCHECK(is_cancelled());
 }
 
+bool FilePathWatcher::PlatformDelegate::WatchBatched(
+    const FilePath& path,
+    const BatchOptions& options,
+    const BatchCallback& callback) {
+  return Watch(path, options.recursive, Bind(&RunBatchCallback, callback));
+}
+
 bool FilePathWatcher::Watch(const FilePath& path,
                             bool recursive,
                             const Callback& callback) {
@@ -53,4 +82,12 @@ bool FilePathWatcher::Watch(const FilePath& path,
   return impl_->Watch(path, recursive, callback);
 }
 
+bool FilePathWatcher::WatchBatched(const FilePath& path,
+                                   const BatchOptions& options,
+                                   const BatchCallback& callback) {
+  DCHECK(path.IsAbsolute());
+  DCHECK_GT(options.max_batch_size, 0u);
+  return impl_->WatchBatched(path, options, callback);
+}
+
 }  // namespace base
@@ -7,12 +7,15 @@
 #ifndef BASE_FILES_FILE_PATH_WATCHER_H_
 #define BASE_FILES_FILE_PATH_WATCHER_H_
 
+#include <vector>
+
 #include "base/base_export.h"
 #include "base/basictypes.h"
 #include "base/callback.h"
 #include "base/files/file_path.h"
 #include "base/memory/ref_counted.h"
 #include "base/message_loop/message_loop_proxy.h"
+#include "base/time/time.h"
 
 namespace base {
 
@@ -32,6 +35,30 @@ class BASE_EXPORT FilePathWatcher {
   // that case, the callback won't be invoked again.
   typedef base::Callback<void(const FilePath& path, bool error)> Callback;
 
+  // Callback type for WatchBatched(). |changed_paths| lists each path that
+  // changed since the previous call once, in the order in which they first
+  // changed. If |rescan| is true, changes were lost, either because the
+  // system's event queue overflowed or because more than |max_batch_size|
+  // paths changed. |changed_paths| is then empty, and the client should rescan
+  // the watched path. |error| is as for Callback.
+  typedef base::Callback<void(const std::vector<FilePath>& changed_paths,
+                              bool rescan,
+                              bool error)> BatchCallback;
+
+  struct BASE_EXPORT BatchOptions {
+    BatchOptions();
+
+    // Whether to watch the children of the path too.
+    bool recursive;
+
+    // How long changes are collected before they are delivered.
+    TimeDelta coalescing_window;
+
+    // The most paths that a batch lists. Past that, the batch turns into a
+    // rescan request.
+    size_t max_batch_size;
+  };
+
   // Used internally to encapsulate different members on different platforms.
   class PlatformDelegate : public base::RefCountedThreadSafe<PlatformDelegate> {
    public:
@@ -42,6 +69,13 @@ class BASE_EXPORT FilePathWatcher {
                        bool recursive,
                        const Callback& callback) WARN_UNUSED_RESULT = 0;
 
+    // Start watching for the given |path| and notify |callback| about changes
+    // in batches. The default implementation delivers every change in a batch
+    // of its own, as soon as it is detected.
+    virtual bool WatchBatched(const FilePath& path,
+                              const BatchOptions& options,
+                              const BatchCallback& callback) WARN_UNUSED_RESULT;
+
     // Stop watching. This is called from FilePathWatcher's dtor in order to
     // allow to shut down properly while the object is still alive.
     // It can be called from any thread.
@@ -100,6 +134,18 @@ class BASE_EXPORT FilePathWatcher {
   // Watch() will return false in the case of failure.
   bool Watch(const FilePath& path, bool recursive, const Callback& callback);
 
+  // Like Watch(), but invokes |callback| with the paths that changed rather
+  // than once per change. Changes that come in within the coalescing window of
+  // |options| are delivered together, and a path that changes several times
+  // is only listed once. This suits watching large directories, where a
+  // callback per change would flood the message loop.
+  //
+  // Only Linux coalesces changes at the moment. Other platforms deliver each
+  // change on its own.
+  bool WatchBatched(const FilePath& path,
+                    const BatchOptions& options,
+                    const BatchCallback& callback);
+
  private:
   scoped_refptr<PlatformDelegate> impl_;
 
@@ -12,6 +12,7 @@
 #endif
 
 #include <set>
+#include <vector>
 
 #include "base/basictypes.h"
 #include "base/bind.h"
@@ -126,6 +127,51 @@ class TestDelegate : public TestDelegateBase {
   DISALLOW_COPY_AND_ASSIGN(TestDelegate);
 };
 
+// Records the batches of changes from a batched watch, and breaks the message
+// loop the test thread is waiting on when one comes in.
+class BatchCollector : public base::RefCountedThreadSafe<BatchCollector> {
+ public:
+  BatchCollector()
+      : loop_(base::MessageLoopProxy::current()),
+        batch_count_(0),
+        rescan_(false) {}
+
+  // Called from the file thread by the watcher.
+  void OnBatch(const std::vector<FilePath>& changed_paths,
+               bool rescan,
+               bool error) {
+    loop_->PostTask(FROM_HERE,
+                    base::Bind(&BatchCollector::RecordBatch, this,
+                               changed_paths, rescan, error));
+  }
+
+  int batch_count() const { return batch_count_; }
+
+  // The contents of the last batch.
+  const std::vector<FilePath>& changed_paths() const { return changed_paths_; }
+  bool rescan() const { return rescan_; }
+
+ private:
+  friend class base::RefCountedThreadSafe<BatchCollector>;
+  ~BatchCollector() {}
+
+  void RecordBatch(const std::vector<FilePath>& changed_paths,
+                   bool rescan,
+                   bool error) {
+    ASSERT_TRUE(loop_->BelongsToCurrentThread());
+    EXPECT_FALSE(error);
+    ++batch_count_;
+    changed_paths_ = changed_paths;
+    rescan_ = rescan;
+    loop_->PostTask(FROM_HERE, MessageLoop::QuitWhenIdleClosure());
+  }
+
+  scoped_refptr<base::MessageLoopProxy> loop_;
+  int batch_count_;
+  std::vector<FilePath> changed_paths_;
+  bool rescan_;
+};
+
 void SetupWatchCallback(const FilePath& target,
                         FilePathWatcher* watcher,
                         TestDelegateBase* delegate,
@@ -138,6 +184,17 @@ void SetupWatchCallback(const FilePath& target,
   completion->Signal();
 }
 
+void SetupBatchedWatchCallback(const FilePath& target,
+                               FilePathWatcher* watcher,
+                               const FilePathWatcher::BatchOptions& options,
+                               BatchCollector* collector,
+                               bool* result,
+                               base::WaitableEvent* completion) {
+  *result = watcher->WatchBatched(
+      target, options, base::Bind(&BatchCollector::OnBatch, collector));
+  completion->Signal();
+}
+
 class FilePathWatcherTest : public testing::Test {
  public:
   FilePathWatcherTest()
@@ -179,6 +236,19 @@ class FilePathWatcherTest : public testing::Test {
                   TestDelegateBase* delegate,
                   bool recursive_watch) WARN_UNUSED_RESULT;
 
+  bool SetupBatchedWatch(const FilePath& target,
+                         FilePathWatcher* watcher,
+                         const FilePathWatcher::BatchOptions& options,
+                         BatchCollector* collector) WARN_UNUSED_RESULT;
+
+  // Holds up the file thread until |unblock| is signaled, so that the changes
+  // made meanwhile reach the watcher together.
+  void BlockFileThread(base::WaitableEvent* unblock) {
+    file_thread_.message_loop_proxy()->PostTask(
+        FROM_HERE,
+        base::Bind(&base::WaitableEvent::Wait, base::Unretained(unblock)));
+  }
+
   bool WaitForEvents() WARN_UNUSED_RESULT {
     collector_->Reset();
     loop_.Run();
@@ -209,6 +279,21 @@ bool FilePathWatcherTest::SetupWatch(const FilePath& target,
   return result;
 }
 
+bool FilePathWatcherTest::SetupBatchedWatch(
+    const FilePath& target,
+    FilePathWatcher* watcher,
+    const FilePathWatcher::BatchOptions& options,
+    BatchCollector* collector) {
+  base::WaitableEvent completion(false, false);
+  bool result;
+  file_thread_.message_loop_proxy()->PostTask(
+      FROM_HERE,
+      base::Bind(SetupBatchedWatchCallback, target, watcher, options,
+                 make_scoped_refptr(collector), &result, &completion));
+  completion.Wait();
+  return result;
+}
+
 // Basic test: Create the file and verify that we notice.
 TEST_F(FilePathWatcherTest, NewFile) {
   FilePathWatcher watcher;
@@ -623,6 +708,59 @@ TEST_F(FilePathWatcherTest, FileAttributesChanged) {
 
 #if defined(OS_LINUX)
 
+// Verify that a batched watch delivers the changes that come in together in
+// one batch, listing each changed path once.
+TEST_F(FilePathWatcherTest, BatchedWatchCoalescesChanges) {
+  FilePath dir(temp_dir_.path().AppendASCII("dir"));
+  FilePath subdir(dir.AppendASCII("subdir"));
+  FilePath file1(dir.AppendASCII("file1"));
+  FilePath file2(subdir.AppendASCII("file2"));
+  ASSERT_TRUE(base::CreateDirectory(subdir));
+
+  FilePathWatcher watcher;
+  scoped_refptr<BatchCollector> batches(new BatchCollector);
+  FilePathWatcher::BatchOptions options;
+  options.recursive = true;
+  ASSERT_TRUE(SetupBatchedWatch(dir, &watcher, options, batches.get()));
+
+  base::WaitableEvent unblock(false, false);
+  BlockFileThread(&unblock);
+  EXPECT_TRUE(WriteFile(file1, "content"));
+  EXPECT_TRUE(WriteFile(file2, "content"));
+  EXPECT_TRUE(WriteFile(file1, "new content"));
+  unblock.Signal();
+
+  loop_.Run();
+  EXPECT_EQ(1, batches->batch_count());
+  EXPECT_FALSE(batches->rescan());
+  ASSERT_EQ(2u, batches->changed_paths().size());
+  EXPECT_EQ(file1, batches->changed_paths()[0]);
+  EXPECT_EQ(file2, batches->changed_paths()[1]);
+}
+
+// Verify that a batch with too many changes turns into a rescan request.
+TEST_F(FilePathWatcherTest, BatchedWatchRequestsRescan) {
+  FilePath dir(temp_dir_.path().AppendASCII("dir"));
+  ASSERT_TRUE(base::CreateDirectory(dir));
+
+  FilePathWatcher watcher;
+  scoped_refptr<BatchCollector> batches(new BatchCollector);
+  FilePathWatcher::BatchOptions options;
+  options.max_batch_size = 2;
+  ASSERT_TRUE(SetupBatchedWatch(dir, &watcher, options, batches.get()));
+
+  base::WaitableEvent unblock(false, false);
+  BlockFileThread(&unblock);
+  for (int i = 0; i < 3; ++i)
+    EXPECT_TRUE(WriteFile(dir.AppendASCII(StringPrintf("file%d", i)), "x"));
+  unblock.Signal();
+
+  loop_.Run();
+  EXPECT_EQ(1, batches->batch_count());
+  EXPECT_TRUE(batches->rescan());
+  EXPECT_TRUE(batches->changed_paths().empty());
+}
+
 // Verify that creating a symlink is caught.
 TEST_F(FilePathWatcherTest, CreateLink) {
   FilePathWatcher watcher;
@@ -5,9 +5,9 @@
 #include "base/files/file_path_watcher.h"
 
 #include <errno.h>
+#include <limits.h>
 #include <string.h>
 #include <sys/inotify.h>
-#include <sys/ioctl.h>
 #include <sys/select.h>
 #include <unistd.h>
 
@@ -39,6 +39,11 @@ namespace {
 
 class FilePathWatcherImpl;
 
+// The size of the buffer that inotify events are read into. It holds at least
+// one event with the longest possible name, as read() fails otherwise. Events
+// that do not fit are left in the kernel's queue for the next read.
+const size_t kReadBufferSize = 64 * (sizeof(inotify_event) + NAME_MAX + 1);
+
 // Singleton to manage all inotify watches.
 // TODO(tony): It would be nice if this wasn't a singleton.
 // http://crbug.com/38174
@@ -47,6 +52,29 @@ class InotifyReader {
   typedef int Watch;  // Watch descriptor used by AddWatch and RemoveWatch.
   static const Watch kInvalidWatch = -1;
 
+  // A change reported by inotify. |fired_watch| identifies the watch that
+  // fired, |child| indicates what has changed, and is relative to the path
+  // watched by |fired_watch|.
+  struct Event {
+    Event(Watch fired_watch,
+          const FilePath::StringType& child,
+          bool created,
+          bool deleted,
+          bool is_dir)
+        : fired_watch(fired_watch),
+          child(child),
+          created(created),
+          deleted(deleted),
+          is_dir(is_dir) {}
+
+    Watch fired_watch;
+    FilePath::StringType child;
+    bool created;
+    bool deleted;
+    bool is_dir;
+  };
+  typedef std::vector<Event> EventVector;
+
   // Watch directory |path| for changes. |watcher| will be notified on each
   // change. Returns kInvalidWatch on failure.
   Watch AddWatch(const FilePath& path, FilePathWatcherImpl* watcher);
@@ -54,8 +82,9 @@ class InotifyReader {
   // Remove |watch| if it's valid.
   void RemoveWatch(Watch watch, FilePathWatcherImpl* watcher);
 
-  // Callback for InotifyReaderTask.
-  void OnInotifyEvent(const inotify_event* event);
+  // Callback for InotifyReaderTask. |buffer| holds |size| bytes of events
+  // from a single read, which are passed on to each watcher together.
+  void OnInotifyEvents(const char* buffer, size_t size);
 
  private:
   friend struct DefaultLazyInstanceTraits<InotifyReader>;
@@ -91,18 +120,11 @@ class FilePathWatcherImpl : public FilePathWatcher::PlatformDelegate,
  public:
   FilePathWatcherImpl();
 
-  // Called for each event coming from the watch. |fired_watch| identifies the
-  // watch that fired, |child| indicates what has changed, and is relative to
-  // the currently watched path for |fired_watch|.
-  //
-  // |created| is true if the object appears.
-  // |deleted| is true if the object disappears.
-  // |is_dir| is true if the object is a directory.
-  void OnFilePathChanged(InotifyReader::Watch fired_watch,
-                         const FilePath::StringType& child,
-                         bool created,
-                         bool deleted,
-                         bool is_dir);
+  // Called with the events of the watches of this instance from one read of
+  // the inotify queue. |overflowed| is true if the queue overflowed, in which
+  // case events were lost.
+  void OnFilePathsChanged(const InotifyReader::EventVector& events,
+                          bool overflowed);
 
  protected:
   ~FilePathWatcherImpl() override {}
@@ -114,12 +136,56 @@ class FilePathWatcherImpl : public FilePathWatcher::PlatformDelegate,
              bool recursive,
              const FilePathWatcher::Callback& callback) override;
 
+  // Start watching |path| for changes and notify |callback| of the changed
+  // paths in batches.
+  bool WatchBatched(const FilePath& path,
+                    const FilePathWatcher::BatchOptions& options,
+                    const FilePathWatcher::BatchCallback& callback) override;
+
   // Cancel the watch. This unregisters the instance with InotifyReader.
   void Cancel() override;
 
   // Cleans up and stops observing the message_loop() thread.
   void CancelOnMessageLoopThread() override;
 
+  // Sets up the watches for |path| once a callback has been set.
+  void StartWatching(const FilePath& path, bool recursive);
+
+  // Whether Watch() or WatchBatched() has been called and the watch has not
+  // been cancelled.
+  bool IsWatching() const;
+
+  // Called for each event coming from the watch. |fired_watch| identifies the
+  // watch that fired, |child| indicates what has changed, and is relative to
+  // the currently watched path for |fired_watch|.
+  //
+  // |created| is true if the object appears.
+  // |deleted| is true if the object disappears.
+  // |is_dir| is true if the object is a directory.
+  void OnFilePathChanged(InotifyReader::Watch fired_watch,
+                         const FilePath::StringType& child,
+                         bool created,
+                         bool deleted,
+                         bool is_dir);
+
+  // Called when inotify dropped events. Brings all watches up to date, and
+  // reports that anything may have changed.
+  void OnEventsLost();
+
+  // Reports that |changed_path| changed, either to |callback_| straight away,
+  // or by adding it to the pending batch.
+  void NotifyChange(const FilePath& changed_path);
+
+  // Replaces the pending batch by a rescan request.
+  void RequestRescan();
+
+  // Makes sure that the pending batch gets delivered at the end of the
+  // coalescing window.
+  void ScheduleBatch();
+
+  // Runs |batch_callback_| with the pending batch.
+  void DeliverBatch();
+
   // Deletion of the FilePathWatcher will call Cancel() to dispose of this
   // object in the right thread. This also observes destruction of the required
   // cleanup thread, in case it quits before Cancel() is called.
@@ -173,9 +239,24 @@ class FilePathWatcherImpl : public FilePathWatcher::PlatformDelegate,
 
   bool HasValidWatchVector() const;
 
-  // Callback to notify upon changes.
+  // Callback to notify upon changes. Only one of |callback_| and
+  // |batch_callback_| is set.
   FilePathWatcher::Callback callback_;
 
+  // Callback to notify upon batches of changes, and how to batch them.
+  FilePathWatcher::BatchCallback batch_callback_;
+  FilePathWatcher::BatchOptions batch_options_;
+
+  // The batch to be delivered next. |pending_changes_| holds the paths in the
+  // order in which they changed, and |pending_change_set_| the same paths for
+  // finding duplicates. If |rescan_pending_| is set, both are empty.
+  std::vector<FilePath> pending_changes_;
+  std::set<FilePath> pending_change_set_;
+  bool rescan_pending_;
+
+  // Whether a task to deliver the pending batch has been posted.
+  bool batch_scheduled_;
+
   // The file or directory we're supposed to watch.
   FilePath target_;
 
@@ -202,6 +283,7 @@ void InotifyReaderCallback(InotifyReader* reader, int inotify_fd,
 
   debug::TraceLog::GetInstance()->SetCurrentThreadBlocksMessageLoop();
 
+  std::vector<char> buffer(kReadBufferSize);
   while (true) {
     fd_set rfds;
     FD_ZERO(&rfds);
@@ -220,34 +302,17 @@ void InotifyReaderCallback(InotifyReader* reader, int inotify_fd,
     if (FD_ISSET(shutdown_fd, &rfds))
       return;
 
-    // Adjust buffer size to current event queue size.
-    int buffer_size;
-    int ioctl_result = HANDLE_EINTR(ioctl(inotify_fd, FIONREAD,
-                                          &buffer_size));
-
-    if (ioctl_result != 0) {
-      DPLOG(WARNING) << "ioctl failed";
-      return;
-    }
-
-    std::vector<char> buffer(buffer_size);
-
+    // Read as many events as fit into the buffer. A busy queue is drained
+    // over several reads rather than into an ever larger buffer.
     ssize_t bytes_read = HANDLE_EINTR(read(inotify_fd, &buffer[0],
-                                           buffer_size));
+                                           buffer.size()));
 
     if (bytes_read < 0) {
       DPLOG(WARNING) << "read from inotify fd failed";
       return;
     }
 
-    ssize_t i = 0;
-    while (i < bytes_read) {
-      inotify_event* event = reinterpret_cast<inotify_event*>(&buffer[i]);
-      size_t event_size = sizeof(inotify_event) + event->len;
-      DCHECK(i + event_size <= static_cast<size_t>(bytes_read));
-      reader->OnInotifyEvent(event);
-      i += event_size;
-    }
+    reader->OnInotifyEvents(&buffer[0], bytes_read);
   }
 }
 
@@ -322,39 +387,84 @@ void InotifyReader::RemoveWatch(Watch watch, FilePathWatcherImpl* watcher) {
   }
 }
 
-void InotifyReader::OnInotifyEvent(const inotify_event* event) {
-  if (event->mask & IN_IGNORED)
-    return;
+void InotifyReader::OnInotifyEvents(const char* buffer, size_t size) {
+  typedef std::map<FilePathWatcherImpl*, EventVector> EventsByWatcher;
+  EventsByWatcher events_by_watcher;
+  bool overflowed = false;
 
-  FilePath::StringType child(event->len ? event->name : FILE_PATH_LITERAL(""));
   AutoLock auto_lock(lock_);
 
-  for (WatcherSet::iterator watcher = watchers_[event->wd].begin();
-       watcher != watchers_[event->wd].end();
-       ++watcher) {
-    (*watcher)->OnFilePathChanged(event->wd,
-                                  child,
-                                  event->mask & (IN_CREATE | IN_MOVED_TO),
-                                  event->mask & (IN_DELETE | IN_MOVED_FROM),
-                                  event->mask & IN_ISDIR);
+  size_t i = 0;
+  while (i < size) {
+    const inotify_event* event =
+        reinterpret_cast<const inotify_event*>(&buffer[i]);
+    size_t event_size = sizeof(inotify_event) + event->len;
+    DCHECK(i + event_size <= size);
+    i += event_size;
+
+    if (event->mask & IN_Q_OVERFLOW) {
+      // The event is not for any particular watch.
+      overflowed = true;
+      continue;
+    }
+    if (event->mask & IN_IGNORED)
+      continue;
+
+    hash_map<Watch, WatcherSet>::const_iterator it = watchers_.find(event->wd);
+    if (it == watchers_.end())
+      continue;
+
+    FilePath::StringType child(event->len ? event->name
+                                          : FILE_PATH_LITERAL(""));
+    Event change(event->wd,
+                 child,
+                 event->mask & (IN_CREATE | IN_MOVED_TO),
+                 event->mask & (IN_DELETE | IN_MOVED_FROM),
+                 event->mask & IN_ISDIR);
+    for (WatcherSet::const_iterator watcher = it->second.begin();
+         watcher != it->second.end();
+         ++watcher) {
+      events_by_watcher[*watcher].push_back(change);
+    }
+  }
+
+  // After an overflow, every watcher has to hear about it.
+  if (overflowed) {
+    for (hash_map<Watch, WatcherSet>::const_iterator it = watchers_.begin();
+         it != watchers_.end();
+         ++it) {
+      for (WatcherSet::const_iterator watcher = it->second.begin();
+           watcher != it->second.end();
+           ++watcher) {
+        events_by_watcher[*watcher];
+      }
+    }
+  }
+
+  for (EventsByWatcher::const_iterator it = events_by_watcher.begin();
+       it != events_by_watcher.end();
+       ++it) {
+    it->first->OnFilePathsChanged(it->second, overflowed);
   }
 }
 
 FilePathWatcherImpl::FilePathWatcherImpl()
-    : recursive_(false) {
+    : rescan_pending_(false),
+      batch_scheduled_(false),
+      recursive_(false) {
 }
 
-void FilePathWatcherImpl::OnFilePathChanged(InotifyReader::Watch fired_watch,
-                                            const FilePath::StringType& child,
-                                            bool created,
-                                            bool deleted,
-                                            bool is_dir) {
+void FilePathWatcherImpl::OnFilePathsChanged(
+    const InotifyReader::EventVector& events,
+    bool overflowed) {
   if (!message_loop()->BelongsToCurrentThread()) {
-    // Switch to message_loop() to access |watches_| safely.
+    // Switch to message_loop() to access |watches_| safely. All the events
+    // from a read go in one task, so that busy directories do not flood the
+    // message loop.
     message_loop()->PostTask(
         FROM_HERE,
-        Bind(&FilePathWatcherImpl::OnFilePathChanged, this,
-             fired_watch, child, created, deleted, is_dir));
+        Bind(&FilePathWatcherImpl::OnFilePathsChanged, this,
+             events, overflowed));
     return;
   }
 
@@ -365,6 +475,23 @@ void FilePathWatcherImpl::OnFilePathChanged(InotifyReader::Watch fired_watch,
     return;
   }
 
+  if (overflowed)
+    OnEventsLost();
+
+  // A callback may cancel the watch.
+  for (size_t i = 0; i < events.size() && !watches_.empty(); ++i) {
+    const InotifyReader::Event& event = events[i];
+    OnFilePathChanged(event.fired_watch, event.child, event.created,
+                      event.deleted, event.is_dir);
+  }
+}
+
+void FilePathWatcherImpl::OnFilePathChanged(InotifyReader::Watch fired_watch,
+                                            const FilePath::StringType& child,
+                                            bool created,
+                                            bool deleted,
+                                            bool is_dir) {
+  DCHECK(message_loop()->BelongsToCurrentThread());
   DCHECK(MessageLoopForIO::current());
   DCHECK(HasValidWatchVector());
 
@@ -434,16 +561,81 @@ void FilePathWatcherImpl::OnFilePathChanged(InotifyReader::Watch fired_watch,
         UpdateRecursiveWatches(fired_watch, is_dir);
         did_update = true;
       }
-      callback_.Run(target_, false /* error */);
+      // Only a change inside the watched directory has a path of its own.
+      bool child_of_target = watch_entry.subdir.empty() &&
+                             watch_entry.linkname.empty() && !child.empty();
+      NotifyChange(child_of_target ? target_.Append(child) : target_);
       return;
     }
   }
 
-  if (ContainsKey(recursive_paths_by_watch_, fired_watch)) {
+  hash_map<InotifyReader::Watch, FilePath>::const_iterator it =
+      recursive_paths_by_watch_.find(fired_watch);
+  if (it != recursive_paths_by_watch_.end()) {
+    // Copy the path, as updating the watches may drop |fired_watch|.
+    FilePath changed_path =
+        child.empty() ? it->second : it->second.Append(child);
     if (!did_update)
       UpdateRecursiveWatches(fired_watch, is_dir);
+    NotifyChange(changed_path);
+  }
+}
+
+void FilePathWatcherImpl::OnEventsLost() {
+  // Directories may have come and gone unnoticed, so redo all the watches.
+  UpdateWatches();
+  if (batch_callback_.is_null())
     callback_.Run(target_, false /* error */);
+  else
+    RequestRescan();
+}
+
+void FilePathWatcherImpl::NotifyChange(const FilePath& changed_path) {
+  if (batch_callback_.is_null()) {
+    callback_.Run(target_, false /* error */);
+    return;
   }
+
+  if (!rescan_pending_ && pending_change_set_.insert(changed_path).second) {
+    if (pending_changes_.size() == batch_options_.max_batch_size) {
+      // Too much has changed to list it all.
+      RequestRescan();
+      return;
+    }
+    pending_changes_.push_back(changed_path);
+  }
+  ScheduleBatch();
+}
+
+void FilePathWatcherImpl::RequestRescan() {
+  rescan_pending_ = true;
+  pending_changes_.clear();
+  pending_change_set_.clear();
+  ScheduleBatch();
+}
+
+void FilePathWatcherImpl::ScheduleBatch() {
+  if (batch_scheduled_)
+    return;
+  batch_scheduled_ = true;
+  message_loop()->PostDelayedTask(
+      FROM_HERE,
+      Bind(&FilePathWatcherImpl::DeliverBatch, this),
+      batch_options_.coalescing_window);
+}
+
+void FilePathWatcherImpl::DeliverBatch() {
+  DCHECK(message_loop()->BelongsToCurrentThread());
+  batch_scheduled_ = false;
+  if (batch_callback_.is_null())
+    return;
+
+  std::vector<FilePath> changed_paths;
+  changed_paths.swap(pending_changes_);
+  pending_change_set_.clear();
+  bool rescan = rescan_pending_;
+  rescan_pending_ = false;
+  batch_callback_.Run(changed_paths, rescan, false /* error */);
 }
 
 bool FilePathWatcherImpl::Watch(const FilePath& path,
@@ -452,8 +644,26 @@ bool FilePathWatcherImpl::Watch(const FilePath& path,
   DCHECK(target_.empty());
   DCHECK(MessageLoopForIO::current());
 
-  set_message_loop(MessageLoopProxy::current());
   callback_ = callback;
+  StartWatching(path, recursive);
+  return true;
+}
+
+bool FilePathWatcherImpl::WatchBatched(
+    const FilePath& path,
+    const FilePathWatcher::BatchOptions& options,
+    const FilePathWatcher::BatchCallback& callback) {
+  DCHECK(target_.empty());
+  DCHECK(MessageLoopForIO::current());
+
+  batch_callback_ = callback;
+  batch_options_ = options;
+  StartWatching(path, options.recursive);
+  return true;
+}
+
+void FilePathWatcherImpl::StartWatching(const FilePath& path, bool recursive) {
+  set_message_loop(MessageLoopProxy::current());
   target_ = path;
   recursive_ = recursive;
   MessageLoop::current()->AddDestructionObserver(this);
@@ -465,11 +675,14 @@ bool FilePathWatcherImpl::Watch(const FilePath& path,
     watches_.push_back(WatchEntry(comps[i]));
   watches_.push_back(WatchEntry(FilePath::StringType()));
   UpdateWatches();
-  return true;
+}
+
+bool FilePathWatcherImpl::IsWatching() const {
+  return !callback_.is_null() || !batch_callback_.is_null();
 }
 
 void FilePathWatcherImpl::Cancel() {
-  if (callback_.is_null()) {
+  if (!IsWatching()) {
     // Watch was never called, or the message_loop() thread is already gone.
     set_cancelled();
     return;
@@ -489,10 +702,14 @@ void FilePathWatcherImpl::CancelOnMessageLoopThread() {
   DCHECK(message_loop()->BelongsToCurrentThread());
   set_cancelled();
 
-  if (!callback_.is_null()) {
+  if (IsWatching()) {
     MessageLoop::current()->RemoveDestructionObserver(this);
     callback_.Reset();
+    batch_callback_.Reset();
   }
+  pending_changes_.clear();
+  pending_change_set_.clear();
+  rescan_pending_ = false;
 
   for (size_t i = 0; i < watches_.size(); ++i)
     g_inotify_reader.Get().RemoveWatch(watches_[i].watch, this);
@@ -8,13 +8,17 @@
 
 #include <string>
 
+#include "base/atomicops.h"
+#include "base/big_endian.h"
 #include "base/bind.h"
 #include "base/critical_closure.h"
 #include "base/files/file.h"
 #include "base/files/file_path.h"
 #include "base/files/file_util.h"
+#include "base/hash.h"
 #include "base/logging.h"
 #include "base/metrics/histogram.h"
+#include "base/sha1.h"
 #include "base/strings/string_number_conversions.h"
 #include "base/task_runner.h"
 #include "base/task_runner_util.h"
@@ -26,6 +30,16 @@ namespace base {
 namespace {
 
 const int kDefaultCommitIntervalMs = 10000;
+const int kDefaultJournalCommitIntervalMs = 1000;
+const size_t kDefaultJournalCompactionThreshold = 256 * 1024;
+
+// A journal starts with this magic and the SHA-1 digest of the file it
+// applies to. Each record is its length and checksum as big-endian uint32s,
+// followed by the record.
+const char kJournalMagic[] = "IFJ1";
+const size_t kJournalMagicLength = arraysize(kJournalMagic) - 1;
+const size_t kJournalHeaderLength = kJournalMagicLength + kSHA1Length;
+const size_t kRecordHeaderLength = 2 * sizeof(uint32);
 
 // This enum is used to define the buckets for an enumerated UMA histogram.
 // Hence,
@@ -49,8 +63,196 @@ void LogFailure(const FilePath& path, TempFileFailure failure_code,
                  << " : " << message;
 }
 
+FilePath GetJournalPath(const FilePath& path) {
+  return path.AddExtension(FILE_PATH_LITERAL("journal"));
+}
+
+void AppendJournalRecord(const std::string& record, std::string* journal) {
+  CHECK_LE(record.size(), static_cast<size_t>(kuint32max));
+  char header[kRecordHeaderLength];
+  WriteBigEndian(header, static_cast<uint32>(record.size()));
+  WriteBigEndian(header + sizeof(uint32), Hash(record));
+  journal->append(header, kRecordHeaderLength);
+  journal->append(record);
+}
+
+// Parses the records of |journal| into |records|, which may be NULL, if the
+// journal applies to the file with |file_digest|. Stops at the first record
+// that is cut short or corrupt. Returns the length of the valid part of the
+// journal, or 0 if it doesn't apply to the file.
+size_t ParseJournal(const std::string& journal,
+                    const std::string& file_digest,
+                    std::vector<std::string>* records) {
+  if (journal.size() < kJournalHeaderLength ||
+      journal.compare(0, kJournalMagicLength, kJournalMagic) != 0 ||
+      journal.compare(kJournalMagicLength, kSHA1Length, file_digest) != 0) {
+    return 0;
+  }
+
+  size_t offset = kJournalHeaderLength;
+  while (journal.size() - offset >= kRecordHeaderLength) {
+    uint32 length;
+    uint32 checksum;
+    ReadBigEndian(journal.data() + offset, &length);
+    ReadBigEndian(journal.data() + offset + sizeof(uint32), &checksum);
+    if (journal.size() - offset - kRecordHeaderLength < length)
+      break;
+    const char* record = journal.data() + offset + kRecordHeaderLength;
+    if (Hash(record, length) != checksum)
+      break;
+    if (records)
+      records->push_back(std::string(record, length));
+    offset += kRecordHeaderLength + length;
+  }
+  return offset;
+}
+
 }  // namespace
 
+class ImportantFileWriter::Backend
+    : public RefCountedThreadSafe<ImportantFileWriter::Backend> {
+ public:
+  explicit Backend(const FilePath& path)
+      : path_(path),
+        journal_path_(GetJournalPath(path)),
+        latest_write_(0),
+        journaled_write_(0),
+        journal_ready_(false) {
+  }
+
+  // Called on the writer's thread for each full write it posts. Returns the
+  // number that identifies the write.
+  int NextWrite() {
+    return subtle::Barrier_AtomicIncrement(&latest_write_, 1);
+  }
+
+  // Called on the writer's thread when it posts journal records. Those records
+  // apply to the file as left by the latest full write posted so far, so that
+  // write must not be skipped.
+  void JournalPosted() {
+    subtle::Release_Store(&journaled_write_,
+                          subtle::NoBarrier_Load(&latest_write_));
+  }
+
+  // The rest runs on the background sequence.
+
+  // Writes |data| unless it is superseded, in which case this one is skipped.
+  // Empties the journal once |data| is on disk.
+  bool WriteFile(const std::string& data, int write) {
+    if (IsSuperseded(write))
+      return false;
+    if (!WriteFileAtomically(path_, data))
+      return false;
+    // Without the journal, the file is complete. If we crash before the
+    // journal is gone, its digest no longer matches the file.
+    file_digest_.clear();
+    journal_ready_ = false;
+    DeleteFile(journal_path_, false);
+    return true;
+  }
+
+  bool SerializeAndWriteFile(
+      const BackgroundDataSerializer::DataProducer& producer,
+      int write) {
+    if (IsSuperseded(write))
+      return false;
+    std::string data;
+    if (!producer.Run(&data)) {
+      DLOG(WARNING) << "failed to serialize data to be saved in "
+                    << path_.value().c_str();
+      return false;
+    }
+    return WriteFile(data, write);
+  }
+
+  // Appends |records|, as encoded by AppendJournalRecord(), to the journal.
+  void AppendToJournal(const std::string& records) {
+    if (!journal_ready_ && !PrepareJournal())
+      return;
+
+    File journal(journal_path_, File::FLAG_OPEN | File::FLAG_APPEND);
+    CHECK_LE(records.size(), static_cast<size_t>(kint32max));
+    int size = static_cast<int>(records.size());
+    if (!journal.IsValid() ||
+        journal.WriteAtCurrentPos(records.data(), size) != size ||
+        !journal.Flush()) {
+      DPLOG(WARNING) << "failed to append to " << journal_path_.value().c_str();
+      // The journal may end in a partial record now. Cut it off before
+      // appending again.
+      journal_ready_ = false;
+    }
+  }
+
+ private:
+  friend class RefCountedThreadSafe<Backend>;
+
+  ~Backend() {}
+
+  // Returns true if a later full write has been posted and no journal records
+  // were posted in between. Otherwise those records would be appended on top
+  // of the wrong file, and a crash before the later write lands would lose
+  // |write| for good.
+  bool IsSuperseded(int write) {
+    if (write == subtle::Acquire_Load(&latest_write_))
+      return false;
+    return subtle::Acquire_Load(&journaled_write_) < write;
+  }
+
+  // Makes the journal ready to be appended to: keeps the valid part of an
+  // existing journal for the current file, or starts a new one.
+  bool PrepareJournal() {
+    if (file_digest_.empty()) {
+      std::string data;
+      if (!ReadFileToString(path_, &data))
+        data.clear();
+      file_digest_ = SHA1HashString(data);
+    }
+
+    std::string journal;
+    size_t valid_length = 0;
+    if (ReadFileToString(journal_path_, &journal))
+      valid_length = ParseJournal(journal, file_digest_, NULL);
+
+    File file(journal_path_, File::FLAG_OPEN_ALWAYS | File::FLAG_WRITE);
+    if (!file.IsValid())
+      return false;
+    if (valid_length == 0) {
+      std::string header = std::string(kJournalMagic) + file_digest_;
+      int size = static_cast<int>(header.size());
+      if (!file.SetLength(0) || file.Write(0, header.data(), size) != size ||
+          !file.Flush()) {
+        return false;
+      }
+    } else if (valid_length < journal.size()) {
+      if (!file.SetLength(valid_length) || !file.Flush())
+        return false;
+    }
+    journal_ready_ = true;
+    return true;
+  }
+
+  const FilePath path_;
+  const FilePath journal_path_;
+
+  // The number of the latest full write posted. Written on the writer's
+  // thread and read on the background sequence.
+  subtle::Atomic32 latest_write_;
+
+  // The number of the latest full write posted before the latest journal
+  // records. Written on the writer's thread and read on the background
+  // sequence.
+  subtle::Atomic32 journaled_write_;
+
+  // The SHA-1 digest of the file, or empty if it isn't known.
+  std::string file_digest_;
+
+  // True once the journal is known to end in a complete record and to apply
+  // to the file.
+  bool journal_ready_;
+
+  DISALLOW_COPY_AND_ASSIGN(Backend);
+};
+
 // static
 bool ImportantFileWriter::WriteFileAtomically(const FilePath& path,
                                               const std::string& data) {
@@ -99,13 +301,38 @@ bool ImportantFileWriter::WriteFileAtomically(const FilePath& path,
   return true;
 }
 
+// static
+bool ImportantFileWriter::ReadFileWithJournal(
+    const FilePath& path,
+    std::string* data,
+    std::vector<std::string>* records) {
+  records->clear();
+  bool has_file = ReadFileToString(path, data);
+  if (!has_file) {
+    // Records journaled before the first full write apply to an empty file.
+    if (PathExists(path))
+      return false;
+    data->clear();
+  }
+  std::string journal;
+  if (ReadFileToString(GetJournalPath(path), &journal))
+    ParseJournal(journal, SHA1HashString(*data), records);
+  return has_file || !records->empty();
+}
+
 ImportantFileWriter::ImportantFileWriter(
     const FilePath& path,
     const scoped_refptr<base::SequencedTaskRunner>& task_runner)
     : path_(path),
       task_runner_(task_runner),
       serializer_(NULL),
+      background_serializer_(NULL),
       commit_interval_(TimeDelta::FromMilliseconds(kDefaultCommitIntervalMs)),
+      backend_(new Backend(path)),
+      journal_size_(0),
+      journal_commit_interval_(
+          TimeDelta::FromMilliseconds(kDefaultJournalCommitIntervalMs)),
+      journal_compaction_threshold_(kDefaultJournalCompactionThreshold),
       weak_factory_(this) {
   DCHECK(CalledOnValidThread());
   DCHECK(task_runner_.get());
@@ -120,7 +347,7 @@ ImportantFileWriter::~ImportantFileWriter() {
 
 bool ImportantFileWriter::HasPendingWrite() const {
   DCHECK(CalledOnValidThread());
-  return timer_.IsRunning();
+  return timer_.IsRunning() || journal_timer_.IsRunning();
 }
 
 void ImportantFileWriter::WriteNow(const std::string& data) {
@@ -130,10 +357,10 @@ void ImportantFileWriter::WriteNow(const std::string& data) {
     return;
   }
 
-  if (HasPendingWrite())
+  if (timer_.IsRunning())
     timer_.Stop();
 
-  if (!PostWriteTask(data)) {
+  if (!PostWriteTask(Bind(&Backend::WriteFile, backend_, data))) {
     // Posting the task to background message loop is not expected
     // to fail, but if it does, avoid losing data and just hit the disk
     // on the current thread.
@@ -148,6 +375,7 @@ void ImportantFileWriter::ScheduleWrite(DataSerializer* serializer) {
 
   DCHECK(serializer);
   serializer_ = serializer;
+  background_serializer_ = NULL;
 
   if (!timer_.IsRunning()) {
     timer_.Start(FROM_HERE, commit_interval_, this,
@@ -155,8 +383,58 @@ void ImportantFileWriter::ScheduleWrite(DataSerializer* serializer) {
   }
 }
 
+void ImportantFileWriter::ScheduleWriteWithBackgroundDataSerializer(
+    BackgroundDataSerializer* serializer) {
+  DCHECK(CalledOnValidThread());
+
+  DCHECK(serializer);
+  background_serializer_ = serializer;
+  serializer_ = NULL;
+
+  if (!timer_.IsRunning()) {
+    timer_.Start(FROM_HERE, commit_interval_, this,
+                 &ImportantFileWriter::DoScheduledWrite);
+  }
+}
+
+void ImportantFileWriter::AppendToJournal(
+    const std::string& record,
+    BackgroundDataSerializer* serializer) {
+  DCHECK(CalledOnValidThread());
+
+  size_t previous_size = pending_journal_records_.size();
+  AppendJournalRecord(record, &pending_journal_records_);
+  journal_size_ += pending_journal_records_.size() - previous_size;
+  if (journal_size_ > journal_compaction_threshold_)
+    ScheduleWriteWithBackgroundDataSerializer(serializer);
+
+  if (!journal_timer_.IsRunning()) {
+    journal_timer_.Start(FROM_HERE, journal_commit_interval_, this,
+                         &ImportantFileWriter::CommitJournal);
+  }
+}
+
 void ImportantFileWriter::DoScheduledWrite() {
-  DCHECK(serializer_);
+  if (background_serializer_) {
+    if (timer_.IsRunning())
+      timer_.Stop();
+    // Only the snapshot is taken here. Serializing happens in the background.
+    BackgroundDataSerializer::DataProducer producer =
+        background_serializer_->GetSerializedDataProducerForBackgroundSequence();
+    background_serializer_ = NULL;
+    if (!PostWriteTask(
+            Bind(&Backend::SerializeAndWriteFile, backend_, producer))) {
+      NOTREACHED();
+    }
+    return;
+  }
+
+  if (!serializer_) {
+    // Only journal records are pending.
+    CommitJournal();
+    return;
+  }
+
   std::string data;
   if (serializer_->SerializeData(&data)) {
     WriteNow(data);
@@ -173,7 +451,15 @@ void ImportantFileWriter::RegisterOnNextSuccessfulWriteCallback(
   on_next_successful_write_ = on_next_successful_write;
 }
 
-bool ImportantFileWriter::PostWriteTask(const std::string& data) {
+bool ImportantFileWriter::PostWriteTask(
+    const Callback<bool(int)>& write_file) {
+  // The records must reach the journal before the write, so that they are not
+  // lost if the write fails. They apply to the writes posted so far, so they
+  // are committed before this write takes its number.
+  CommitJournal();
+  journal_size_ = 0;
+  Callback<bool()> write_task = Bind(write_file, backend_->NextWrite());
+
   // TODO(gab): This code could always use PostTaskAndReplyWithResult and let
   // ForwardSuccessfulWrite() no-op if |on_next_successful_write_| is null, but
   // PostTaskAndReply causes memory leaks in tests (crbug.com/371974) and
@@ -183,16 +469,27 @@ bool ImportantFileWriter::PostWriteTask(const std::string& data) {
     return base::PostTaskAndReplyWithResult(
         task_runner_.get(),
         FROM_HERE,
-        MakeCriticalClosure(
-            Bind(&ImportantFileWriter::WriteFileAtomically, path_, data)),
+        MakeCriticalClosure(write_task),
         Bind(&ImportantFileWriter::ForwardSuccessfulWrite,
              weak_factory_.GetWeakPtr()));
   }
   return task_runner_->PostTask(
+      FROM_HERE, MakeCriticalClosure(Bind(IgnoreResult(write_task))));
+}
+
+void ImportantFileWriter::CommitJournal() {
+  DCHECK(CalledOnValidThread());
+  if (journal_timer_.IsRunning())
+    journal_timer_.Stop();
+  if (pending_journal_records_.empty())
+    return;
+
+  std::string records;
+  records.swap(pending_journal_records_);
+  backend_->JournalPosted();
+  task_runner_->PostTask(
       FROM_HERE,
-      MakeCriticalClosure(
-          Bind(IgnoreResult(&ImportantFileWriter::WriteFileAtomically),
-               path_, data)));
+      MakeCriticalClosure(Bind(&Backend::AppendToJournal, backend_, records)));
 }
 
 void ImportantFileWriter::ForwardSuccessfulWrite(bool result) {
@@ -6,6 +6,7 @@
 #define BASE_FILES_IMPORTANT_FILE_WRITER_H_
 
 #include <string>
+#include <vector>
 
 #include "base/base_export.h"
 #include "base/basictypes.h"
@@ -37,6 +38,14 @@ class Thread;
 //
 // If you want to know more about this approach and ext3/ext4 fsync issues, see
 // http://valhenson.livejournal.com/37921.html
+//
+// For large files that change often, the writer can also serialize on the
+// background sequence and keep a journal: small changes are appended to a
+// journal file next to F, and F itself is only rewritten, compacting the
+// journal, once the journal has grown large. The journal starts with a digest
+// of the F it applies to, and every record has a checksum, so after a crash
+// ReadFileWithJournal() returns F and exactly the records that were completely
+// written since F was.
 class BASE_EXPORT ImportantFileWriter : public NonThreadSafe {
  public:
   // Used by ScheduleSave to lazily provide the data to be saved. Allows us
@@ -52,11 +61,36 @@ class BASE_EXPORT ImportantFileWriter : public NonThreadSafe {
     virtual ~DataSerializer() {}
   };
 
+  // Like DataSerializer, but the serialization itself runs on the background
+  // sequence, so that large files don't hold up the calling thread.
+  class BASE_EXPORT BackgroundDataSerializer {
+   public:
+    // Puts the serialized data in its argument and returns true on success.
+    typedef Callback<bool(std::string*)> DataProducer;
+
+    // Called on the thread ImportantFileWriter was created on. The returned
+    // callback runs on the background sequence, so it must own a snapshot of
+    // everything it needs.
+    virtual DataProducer GetSerializedDataProducerForBackgroundSequence() = 0;
+
+   protected:
+    virtual ~BackgroundDataSerializer() {}
+  };
+
   // Save |data| to |path| in an atomic manner (see the class comment above).
   // Blocks and writes data on the current thread.
   static bool WriteFileAtomically(const FilePath& path,
                                   const std::string& data);
 
+  // Reads |path| into |data| and the journal records appended since |path| was
+  // last written into |records|, in order. A journal that doesn't belong to
+  // the current |path|, and any record that was cut short, are ignored.
+  // Returns false if |path| can't be read, unless it doesn't exist yet and the
+  // journal has records, which then apply to an empty |data|.
+  static bool ReadFileWithJournal(const FilePath& path,
+                                  std::string* data,
+                                  std::vector<std::string>* records);
+
   // Initialize the writer.
   // |path| is the name of file to write.
   // |task_runner| is the SequencedTaskRunner instance where on which we will
@@ -72,12 +106,14 @@ class BASE_EXPORT ImportantFileWriter : public NonThreadSafe {
 
   const FilePath& path() const { return path_; }
 
-  // Returns true if there is a scheduled write pending which has not yet
-  // been started.
+  // Returns true if there is a scheduled write, or journal records, pending
+  // which have not yet been started.
   bool HasPendingWrite() const;
 
   // Save |data| to target filename. Does not block. If there is a pending write
-  // scheduled by ScheduleWrite, it is cancelled.
+  // scheduled by ScheduleWrite, it is cancelled. Journal records appended
+  // before are still written first, and the journal is emptied once |data| is
+  // safely on disk.
   void WriteNow(const std::string& data);
 
   // Schedule a save to target filename. Data will be serialized and saved
@@ -88,7 +124,20 @@ class BASE_EXPORT ImportantFileWriter : public NonThreadSafe {
   // ImportantFileWriter.
   void ScheduleWrite(DataSerializer* serializer);
 
-  // Serialize data pending to be saved and execute write on backend thread.
+  // Like ScheduleWrite(), but the data is serialized on the background
+  // sequence. Only a snapshot is taken on the current thread.
+  void ScheduleWriteWithBackgroundDataSerializer(
+      BackgroundDataSerializer* serializer);
+
+  // Appends |record| to the journal. Records appended within the journal
+  // commit interval are written together. Once the journal holds more than
+  // the compaction threshold, a full write is scheduled with |serializer|,
+  // whose data must reflect every record appended so far.
+  void AppendToJournal(const std::string& record,
+                       BackgroundDataSerializer* serializer);
+
+  // Serialize data pending to be saved and execute write on backend thread,
+  // after writing out any pending journal records.
   void DoScheduledWrite();
 
   // Registers |on_next_successful_write| to be called once, on the next
@@ -104,9 +153,24 @@ class BASE_EXPORT ImportantFileWriter : public NonThreadSafe {
     commit_interval_ = interval;
   }
 
+  void set_journal_commit_interval(const TimeDelta& interval) {
+    journal_commit_interval_ = interval;
+  }
+
+  void set_journal_compaction_threshold(size_t bytes) {
+    journal_compaction_threshold_ = bytes;
+  }
+
  private:
-  // Helper method for WriteNow().
-  bool PostWriteTask(const std::string& data);
+  // Keeps the journal's state on the background sequence.
+  class Backend;
+
+  // Posts |write_file| to the background sequence, after the pending journal
+  // records, with the number of the new write.
+  bool PostWriteTask(const Callback<bool(int)>& write_file);
+
+  // Posts the pending journal records to the background sequence.
+  void CommitJournal();
 
   // If |result| is true and |on_next_successful_write_| is set, invokes
   // |on_successful_write_| and then resets it; no-ops otherwise.
@@ -127,9 +191,27 @@ class BASE_EXPORT ImportantFileWriter : public NonThreadSafe {
   // Serializer which will provide the data to be saved.
   DataSerializer* serializer_;
 
+  // Serializer which will provide the data to be saved on the background
+  // sequence. At most one of |serializer_| and |background_serializer_| is set.
+  BackgroundDataSerializer* background_serializer_;
+
   // Time delta after which scheduled data will be written to disk.
   TimeDelta commit_interval_;
 
+  const scoped_refptr<Backend> backend_;
+
+  // Timer used to write out the journal records after AppendToJournal().
+  OneShotTimer<ImportantFileWriter> journal_timer_;
+
+  // Encoded journal records that haven't been posted yet.
+  std::string pending_journal_records_;
+
+  // Bytes of journal records appended since the last full write.
+  size_t journal_size_;
+
+  TimeDelta journal_commit_interval_;
+  size_t journal_compaction_threshold_;
+
   WeakPtrFactory<ImportantFileWriter> weak_factory_;
 
   DISALLOW_COPY_AND_ASSIGN(ImportantFileWriter);
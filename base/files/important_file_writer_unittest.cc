@@ -6,12 +6,14 @@
 
 #include "base/bind.h"
 #include "base/compiler_specific.h"
+#include "base/files/file.h"
 #include "base/files/file_path.h"
 #include "base/files/file_util.h"
 #include "base/files/scoped_temp_dir.h"
 #include "base/logging.h"
 #include "base/message_loop/message_loop.h"
 #include "base/run_loop.h"
+#include "base/test/test_simple_task_runner.h"
 #include "base/threading/thread.h"
 #include "base/time/time.h"
 #include "testing/gtest/include/gtest/gtest.h"
@@ -42,6 +44,27 @@ class DataSerializer : public ImportantFileWriter::DataSerializer {
   const std::string data_;
 };
 
+bool CopyData(const std::string& data, std::string* output) {
+  output->assign(data);
+  return true;
+}
+
+class BackgroundDataSerializer
+    : public ImportantFileWriter::BackgroundDataSerializer {
+ public:
+  explicit BackgroundDataSerializer(const std::string& data) : data_(data) {
+  }
+
+  void set_data(const std::string& data) { data_ = data; }
+
+  DataProducer GetSerializedDataProducerForBackgroundSequence() override {
+    return Bind(&CopyData, data_);
+  }
+
+ private:
+  std::string data_;
+};
+
 class SuccessfulWriteObserver {
  public:
   SuccessfulWriteObserver() : successful_write_observed_(false) {}
@@ -192,4 +215,203 @@ TEST_F(ImportantFileWriterTest, BatchingWrites) {
   EXPECT_EQ("baz", GetFileContent(writer.path()));
 }
 
+TEST_F(ImportantFileWriterTest, BackgroundDataSerializer) {
+  ImportantFileWriter writer(file_, MessageLoopProxy::current().get());
+  BackgroundDataSerializer serializer("foo");
+  writer.ScheduleWriteWithBackgroundDataSerializer(&serializer);
+  EXPECT_TRUE(writer.HasPendingWrite());
+  writer.DoScheduledWrite();
+  // Only the snapshot taken by DoScheduledWrite() is written.
+  serializer.set_data("bar");
+  EXPECT_FALSE(writer.HasPendingWrite());
+  RunLoop().RunUntilIdle();
+  EXPECT_EQ("foo", GetFileContent(writer.path()));
+}
+
+TEST_F(ImportantFileWriterTest, SupersededWritesAreSkipped) {
+  ImportantFileWriter writer(file_, MessageLoopProxy::current().get());
+  successful_write_observer_.ObserveNextSuccessfulWrite(&writer);
+  writer.WriteNow("foo");
+  writer.WriteNow("bar");
+  RunLoop().RunUntilIdle();
+  EXPECT_TRUE(successful_write_observer_.GetAndResetObservationState());
+  EXPECT_EQ("bar", GetFileContent(writer.path()));
+}
+
+TEST_F(ImportantFileWriterTest, WritesFollowedByJournalRecordsAreNotSkipped) {
+  scoped_refptr<TestSimpleTaskRunner> task_runner(new TestSimpleTaskRunner);
+  ImportantFileWriter writer(file_, task_runner);
+  BackgroundDataSerializer serializer("foo+one");
+  writer.WriteNow("foo");
+  writer.AppendToJournal("one", &serializer);
+  writer.WriteNow("bar");
+
+  // Run everything but the last write, as if we crashed before it landed.
+  std::deque<TestPendingTask> tasks = task_runner->GetPendingTasks();
+  task_runner->ClearPendingTasks();
+  ASSERT_EQ(3u, tasks.size());
+  tasks[0].task.Run();
+  tasks[1].task.Run();
+
+  std::string data;
+  std::vector<std::string> records;
+  ASSERT_TRUE(ImportantFileWriter::ReadFileWithJournal(file_, &data, &records));
+  EXPECT_EQ("foo", data);
+  ASSERT_EQ(1u, records.size());
+  EXPECT_EQ("one", records[0]);
+
+  tasks[2].task.Run();
+  ASSERT_TRUE(ImportantFileWriter::ReadFileWithJournal(file_, &data, &records));
+  EXPECT_EQ("bar", data);
+  EXPECT_TRUE(records.empty());
+}
+
+TEST_F(ImportantFileWriterTest, WritesAfterJournalRecordsAreCoalesced) {
+  scoped_refptr<TestSimpleTaskRunner> task_runner(new TestSimpleTaskRunner);
+  ImportantFileWriter writer(file_, task_runner);
+  BackgroundDataSerializer serializer("one");
+  writer.AppendToJournal("one", &serializer);
+  writer.WriteNow("foo");
+  writer.WriteNow("bar");
+
+  // The records apply to the file as it was before "foo", so "foo" can still
+  // be skipped in favor of "bar".
+  std::deque<TestPendingTask> tasks = task_runner->GetPendingTasks();
+  task_runner->ClearPendingTasks();
+  ASSERT_EQ(3u, tasks.size());
+  tasks[0].task.Run();
+  tasks[1].task.Run();
+  EXPECT_FALSE(PathExists(file_));
+
+  tasks[2].task.Run();
+  std::string data;
+  std::vector<std::string> records;
+  ASSERT_TRUE(ImportantFileWriter::ReadFileWithJournal(file_, &data, &records));
+  EXPECT_EQ("bar", data);
+  EXPECT_TRUE(records.empty());
+}
+
+TEST_F(ImportantFileWriterTest, Journal) {
+  ImportantFileWriter writer(file_, MessageLoopProxy::current().get());
+  writer.set_journal_commit_interval(TimeDelta());
+  BackgroundDataSerializer serializer("base");
+  writer.WriteNow("base");
+  writer.AppendToJournal("one", &serializer);
+  writer.AppendToJournal("two", &serializer);
+  EXPECT_TRUE(writer.HasPendingWrite());
+  RunLoop().RunUntilIdle();
+  EXPECT_FALSE(writer.HasPendingWrite());
+  writer.AppendToJournal(std::string(), &serializer);
+  writer.DoScheduledWrite();
+  RunLoop().RunUntilIdle();
+
+  std::string data;
+  std::vector<std::string> records;
+  ASSERT_TRUE(ImportantFileWriter::ReadFileWithJournal(file_, &data, &records));
+  EXPECT_EQ("base", data);
+  ASSERT_EQ(3u, records.size());
+  EXPECT_EQ("one", records[0]);
+  EXPECT_EQ("two", records[1]);
+  EXPECT_EQ("", records[2]);
+
+  // A full write empties the journal.
+  writer.WriteNow("base+one+two");
+  RunLoop().RunUntilIdle();
+  ASSERT_TRUE(ImportantFileWriter::ReadFileWithJournal(file_, &data, &records));
+  EXPECT_EQ("base+one+two", data);
+  EXPECT_TRUE(records.empty());
+}
+
+TEST_F(ImportantFileWriterTest, JournalWithoutFile) {
+  std::string data;
+  std::vector<std::string> records;
+  EXPECT_FALSE(
+      ImportantFileWriter::ReadFileWithJournal(file_, &data, &records));
+
+  ImportantFileWriter writer(file_, MessageLoopProxy::current().get());
+  BackgroundDataSerializer serializer("one");
+  writer.AppendToJournal("one", &serializer);
+  writer.DoScheduledWrite();
+  RunLoop().RunUntilIdle();
+  ASSERT_FALSE(PathExists(file_));
+
+  // The records apply to an empty file.
+  ASSERT_TRUE(ImportantFileWriter::ReadFileWithJournal(file_, &data, &records));
+  EXPECT_EQ("", data);
+  ASSERT_EQ(1u, records.size());
+  EXPECT_EQ("one", records[0]);
+}
+
+TEST_F(ImportantFileWriterTest, JournalCompaction) {
+  ImportantFileWriter writer(file_, MessageLoopProxy::current().get());
+  writer.set_journal_compaction_threshold(20);
+  BackgroundDataSerializer serializer("base");
+  writer.WriteNow("base");
+  writer.AppendToJournal("one", &serializer);
+  writer.DoScheduledWrite();
+  RunLoop().RunUntilIdle();
+
+  serializer.set_data("base+one+two");
+  writer.AppendToJournal("two", &serializer);
+  writer.DoScheduledWrite();
+  RunLoop().RunUntilIdle();
+
+  std::string data;
+  std::vector<std::string> records;
+  ASSERT_TRUE(ImportantFileWriter::ReadFileWithJournal(file_, &data, &records));
+  EXPECT_EQ("base+one+two", data);
+  EXPECT_TRUE(records.empty());
+  EXPECT_FALSE(PathExists(file_.AddExtension(FILE_PATH_LITERAL("journal"))));
+}
+
+TEST_F(ImportantFileWriterTest, JournalCutShort) {
+  FilePath journal_path = file_.AddExtension(FILE_PATH_LITERAL("journal"));
+  BackgroundDataSerializer serializer("base");
+  {
+    ImportantFileWriter writer(file_, MessageLoopProxy::current().get());
+    writer.WriteNow("base");
+    writer.AppendToJournal("one", &serializer);
+    writer.DoScheduledWrite();
+    RunLoop().RunUntilIdle();
+  }
+
+  // Simulate a crash in the middle of appending a record.
+  File journal(journal_path, File::FLAG_OPEN | File::FLAG_APPEND);
+  ASSERT_EQ(5, journal.WriteAtCurrentPos("\0\0\0\x10x", 5));
+  journal.Close();
+
+  std::string data;
+  std::vector<std::string> records;
+  ASSERT_TRUE(ImportantFileWriter::ReadFileWithJournal(file_, &data, &records));
+  ASSERT_EQ(1u, records.size());
+  EXPECT_EQ("one", records[0]);
+
+  // The partial record is dropped before the next one is appended.
+  ImportantFileWriter writer(file_, MessageLoopProxy::current().get());
+  writer.AppendToJournal("two", &serializer);
+  writer.DoScheduledWrite();
+  RunLoop().RunUntilIdle();
+  ASSERT_TRUE(ImportantFileWriter::ReadFileWithJournal(file_, &data, &records));
+  ASSERT_EQ(2u, records.size());
+  EXPECT_EQ("one", records[0]);
+  EXPECT_EQ("two", records[1]);
+}
+
+TEST_F(ImportantFileWriterTest, JournalOfOtherFileIsIgnored) {
+  ImportantFileWriter writer(file_, MessageLoopProxy::current().get());
+  BackgroundDataSerializer serializer("base");
+  writer.WriteNow("base");
+  writer.AppendToJournal("one", &serializer);
+  writer.DoScheduledWrite();
+  RunLoop().RunUntilIdle();
+
+  // As if a full write was interrupted after the rename.
+  ASSERT_TRUE(ImportantFileWriter::WriteFileAtomically(file_, "other"));
+  std::string data;
+  std::vector<std::string> records;
+  ASSERT_TRUE(ImportantFileWriter::ReadFileWithJournal(file_, &data, &records));
+  EXPECT_EQ("other", data);
+  EXPECT_TRUE(records.empty());
+}
+
 }  // namespace base
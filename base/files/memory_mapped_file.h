@@ -17,6 +17,7 @@
 namespace base {
 
 class FilePath;
+class TaskRunner;
 
 class BASE_EXPORT MemoryMappedFile {
  public:
@@ -24,6 +25,23 @@ class BASE_EXPORT MemoryMappedFile {
   MemoryMappedFile();
   ~MemoryMappedFile();
 
+  // Hints about how the mapped data will be accessed, for Advise().
+  enum Advice {
+    // The default.
+    ADVICE_NORMAL,
+    // Read front to back: read ahead aggressively, and drop pages soon after
+    // they have been used.
+    ADVICE_SEQUENTIAL,
+    // Read in no particular order: don't read ahead.
+    ADVICE_RANDOM,
+    // Needed soon: start reading it in now, without waiting for it.
+    ADVICE_WILLNEED,
+    // Back with huge pages where the OS supports that for file mappings,
+    // which cuts the number of page faults and TLB misses for large, hot
+    // mappings. Mappings of 2 MB or more are aligned for this on Linux.
+    ADVICE_HUGEPAGE,
+  };
+
   // Used to hold information about a region [offset + size] of a file.
   struct BASE_EXPORT Region {
     static const Region kWholeFile;
@@ -70,6 +88,26 @@ class BASE_EXPORT MemoryMappedFile {
   // Is file_ a valid file handle that points to an open, memory mapped file?
   bool IsValid() const;
 
+  // Tells the OS how [offset, offset + size) of data() will be accessed. The
+  // advice applies to the whole pages that range touches. Returns false if
+  // the OS doesn't support |advice| or rejected it.
+  bool Advise(Advice advice, size_t offset, size_t size);
+  bool Advise(Advice advice) { return Advise(advice, 0, length_); }
+
+  // Reads the mapped part of the file into the OS's page cache on
+  // |task_runner|, so that the first accesses to data() don't wait for the
+  // disk. Unlike ADVICE_WILLNEED, which the OS may cut short, this reads all
+  // of it. The MemoryMappedFile may be destroyed before the read completes.
+  // Returns false if the read couldn't be started.
+  bool Prefetch(TaskRunner* task_runner);
+
+  // Sets |*resident_bytes| to how much of [offset, offset + size) of data()
+  // is in memory, counting whole pages, so it can be larger than |size|.
+  // Returns false if the OS can't tell.
+  bool GetResidentBytes(size_t offset,
+                        size_t size,
+                        size_t* resident_bytes) const;
+
  private:
   // Given the arbitrarily aligned memory region [start, size], returns the
   // boundaries of the region aligned to the granularity specified by the OS,
@@ -93,6 +131,8 @@ class BASE_EXPORT MemoryMappedFile {
   File file_;
   uint8* data_;
   size_t length_;
+  // The offset in the file that data() starts at.
+  int64 file_offset_;
 
 #if defined(OS_WIN)
   win::ScopedHandle file_mapping_;
@@ -4,16 +4,82 @@
 
 #include "base/files/memory_mapped_file.h"
 
+#include <fcntl.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
 #include <unistd.h>
 
+#include <vector>
+
+#include "base/bind.h"
+#include "base/location.h"
 #include "base/logging.h"
+#include "base/posix/eintr_wrapper.h"
+#include "base/task_runner.h"
 #include "base/threading/thread_restrictions.h"
 
 namespace base {
 
-MemoryMappedFile::MemoryMappedFile() : data_(NULL), length_(0) {
+namespace {
+
+#if !defined(OS_NACL)
+#if defined(OS_LINUX) || defined(OS_ANDROID)
+// The size of a transparent huge page on the architectures that have them.
+const size_t kHugePageSize = 2 * 1024 * 1024;
+
+// Maps |size| bytes of |fd| at |offset| to an address that is congruent to
+// |offset| modulo kHugePageSize, so that the kernel can back the aligned
+// middle of the mapping with huge pages. Returns MAP_FAILED on failure.
+void* MapHugePageAligned(int fd, off_t offset, size_t size) {
+  // Reserve enough address space to slide the mapping into alignment.
+  size_t reserved_size = size + kHugePageSize;
+  uint8* reserved = static_cast<uint8*>(mmap(NULL, reserved_size, PROT_NONE,
+                                             MAP_PRIVATE | MAP_ANONYMOUS, -1,
+                                             0));
+  if (reserved == MAP_FAILED)
+    return MAP_FAILED;
+
+  uintptr_t reserved_address = reinterpret_cast<uintptr_t>(reserved);
+  size_t slide = (static_cast<uintptr_t>(offset) - reserved_address) &
+                 (kHugePageSize - 1);
+  uint8* address = reserved + slide;
+  void* result = mmap(address, size, PROT_READ, MAP_SHARED | MAP_FIXED, fd,
+                      offset);
+  if (result == MAP_FAILED) {
+    munmap(reserved, reserved_size);
+    return MAP_FAILED;
+  }
+
+  // Give back the parts of the reservation the mapping doesn't cover.
+  if (slide)
+    munmap(reserved, slide);
+  if (reserved_size - slide > size)
+    munmap(address + size, reserved_size - slide - size);
+  return result;
+}
+#endif  // defined(OS_LINUX) || defined(OS_ANDROID)
+
+// Reads [offset, offset + size) of |file| into the page cache.
+void PrefetchFileRegion(File file, int64 offset, int64 size) {
+#if defined(OS_LINUX) || defined(OS_ANDROID)
+  if (HANDLE_EINTR(readahead(file.GetPlatformFile(), offset, size)) == 0)
+    return;
+#endif
+  // Read the file a page at a time, which is all it takes to populate the
+  // page cache.
+  const int kPageSize = getpagesize();
+  std::vector<char> buffer(kPageSize);
+  for (int64 end = offset + size; offset < end; offset += kPageSize) {
+    if (file.Read(offset, &buffer[0], kPageSize) <= 0)
+      return;
+  }
+}
+#endif  // !defined(OS_NACL)
+
+}  // namespace
+
+MemoryMappedFile::MemoryMappedFile()
+    : data_(NULL), length_(0), file_offset_(0) {
 }
 
 #if !defined(OS_NACL)
@@ -59,33 +125,135 @@ bool MemoryMappedFile::MapFileRegionToMemory(
     map_start = static_cast<off_t>(aligned_start);
     map_size = static_cast<size_t>(aligned_size);
     length_ = static_cast<size_t>(region.size);
+    file_offset_ = region.offset;
   }
 
-  data_ = static_cast<uint8*>(mmap(NULL,
-                                   map_size,
-                                   PROT_READ,
-                                   MAP_SHARED,
-                                   file_.GetPlatformFile(),
-                                   map_start));
-  if (data_ == MAP_FAILED) {
+  void* address = MAP_FAILED;
+#if defined(OS_LINUX) || defined(OS_ANDROID)
+  if (map_size >= kHugePageSize)
+    address = MapHugePageAligned(file_.GetPlatformFile(), map_start, map_size);
+#endif
+  if (address == MAP_FAILED) {
+    address = mmap(NULL, map_size, PROT_READ, MAP_SHARED,
+                   file_.GetPlatformFile(), map_start);
+  }
+  if (address == MAP_FAILED) {
     DPLOG(ERROR) << "mmap " << file_.GetPlatformFile();
     return false;
   }
 
-  data_ += data_offset;
+  data_ = static_cast<uint8*>(address) + data_offset;
+  return true;
+}
+
+bool MemoryMappedFile::Advise(Advice advice, size_t offset, size_t size) {
+  DCHECK(IsValid());
+  DCHECK_LE(offset, length_);
+  DCHECK_LE(size, length_ - offset);
+
+  int platform_advice;
+  switch (advice) {
+    case ADVICE_NORMAL:
+      platform_advice = MADV_NORMAL;
+      break;
+    case ADVICE_SEQUENTIAL:
+      platform_advice = MADV_SEQUENTIAL;
+      break;
+    case ADVICE_RANDOM:
+      platform_advice = MADV_RANDOM;
+      break;
+    case ADVICE_WILLNEED:
+      platform_advice = MADV_WILLNEED;
+      break;
+    case ADVICE_HUGEPAGE:
+#if defined(MADV_HUGEPAGE)
+      platform_advice = MADV_HUGEPAGE;
+      break;
+#else
+      return false;
+#endif
+    default:
+      NOTREACHED();
+      return false;
+  }
+
+  // madvise() wants a page-aligned start.
+  uintptr_t page_mask = static_cast<uintptr_t>(getpagesize()) - 1;
+  uintptr_t start = reinterpret_cast<uintptr_t>(data_ + offset);
+  uintptr_t aligned_start = start & ~page_mask;
+  if (madvise(reinterpret_cast<void*>(aligned_start),
+              start + size - aligned_start, platform_advice) != 0) {
+    DPLOG(ERROR) << "madvise";
+    return false;
+  }
   return true;
 }
+
+bool MemoryMappedFile::Prefetch(TaskRunner* task_runner) {
+  DCHECK(IsValid());
+
+  // Read from a duplicate of the file, which lives as long as the task does.
+  File file(HANDLE_EINTR(dup(file_.GetPlatformFile())));
+  if (!file.IsValid())
+    return false;
+  return task_runner->PostTask(
+      FROM_HERE, Bind(&PrefetchFileRegion, Passed(&file), file_offset_,
+                      static_cast<int64>(length_)));
+}
+
+bool MemoryMappedFile::GetResidentBytes(size_t offset,
+                                        size_t size,
+                                        size_t* resident_bytes) const {
+  DCHECK(IsValid());
+  DCHECK_LE(offset, length_);
+  DCHECK_LE(size, length_ - offset);
+
+  if (!size) {
+    *resident_bytes = 0;
+    return true;
+  }
+
+  const size_t page_size = getpagesize();
+  uintptr_t start = reinterpret_cast<uintptr_t>(data_ + offset);
+  uintptr_t aligned_start = start & ~(page_size - 1);
+  size_t num_pages = (start + size - aligned_start + page_size - 1) / page_size;
+
+#if defined(OS_MACOSX) || defined(OS_BSD)
+  std::vector<char> pages(num_pages);
+#else
+  std::vector<unsigned char> pages(num_pages);
 #endif
+  if (mincore(reinterpret_cast<void*>(aligned_start), num_pages * page_size,
+              &pages[0]) != 0) {
+    DPLOG(ERROR) << "mincore";
+    return false;
+  }
+  size_t resident_pages = 0;
+  for (size_t i = 0; i < num_pages; ++i) {
+    if (pages[i] & 1)
+      ++resident_pages;
+  }
+  *resident_bytes = resident_pages * page_size;
+  return true;
+}
+#endif  // !defined(OS_NACL)
 
 void MemoryMappedFile::CloseHandles() {
   ThreadRestrictions::AssertIOAllowed();
 
-  if (data_ != NULL)
-    munmap(data_, length_);
+  if (data_ != NULL) {
+    // Unmap all of the page-aligned mapping that holds the data.
+    uintptr_t page_mask = static_cast<uintptr_t>(getpagesize()) - 1;
+    uintptr_t start = reinterpret_cast<uintptr_t>(data_);
+    uintptr_t aligned_start = start & ~page_mask;
+    munmap(reinterpret_cast<void*>(aligned_start),
+           start + length_ - aligned_start);
+  }
   file_.Close();
 
   data_ = NULL;
   length_ = 0;
+  file_offset_ = 0;
 }
 
 }  // namespace base
@@ -6,6 +6,7 @@
 
 #include "base/files/file_path.h"
 #include "base/files/file_util.h"
+#include "base/threading/thread.h"
 #include "testing/gtest/include/gtest/gtest.h"
 #include "testing/platform_test.h"
 
@@ -161,6 +162,73 @@ TEST_F(MemoryMappedFileTest, MapLargePartialRegionInTheMiddle) {
   ASSERT_TRUE(CheckBufferContents(map.data(), kPartialSize, kOffset));
 }
 
+#if defined(OS_POSIX)
+TEST_F(MemoryMappedFileTest, Advise) {
+  const size_t kFileSize = 3 * 1024 * 1024;
+  CreateTemporaryTestFile(kFileSize);
+  MemoryMappedFile map;
+
+  ASSERT_TRUE(map.Initialize(temp_file_path()));
+#if defined(OS_LINUX) || defined(OS_ANDROID)
+  // Large mappings are aligned for huge pages.
+  EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(map.data()) % (2 * 1024 * 1024));
+#endif
+  EXPECT_TRUE(map.Advise(MemoryMappedFile::ADVICE_SEQUENTIAL));
+  EXPECT_TRUE(map.Advise(MemoryMappedFile::ADVICE_RANDOM, 100, 5000));
+  EXPECT_TRUE(map.Advise(MemoryMappedFile::ADVICE_WILLNEED, 4096, 1));
+  // Whether huge pages can back file mappings depends on the kernel.
+  map.Advise(MemoryMappedFile::ADVICE_HUGEPAGE);
+  EXPECT_TRUE(map.Advise(MemoryMappedFile::ADVICE_NORMAL));
+  ASSERT_TRUE(CheckBufferContents(map.data(), kFileSize, 0));
+}
+
+TEST_F(MemoryMappedFileTest, GetResidentBytes) {
+  const size_t kFileSize = 157 * 1024;
+  const size_t kOffset = 1024 * 5 + 32;
+  const size_t kPartialSize = 16 * 1024 - 32;
+  CreateTemporaryTestFile(kFileSize);
+  MemoryMappedFile map;
+
+  File file(temp_file_path(), File::FLAG_OPEN | File::FLAG_READ);
+  ASSERT_TRUE(map.Initialize(
+      file.Pass(), MemoryMappedFile::Region(kOffset, kPartialSize)));
+  ASSERT_TRUE(CheckBufferContents(map.data(), kPartialSize, kOffset));
+
+  // All of the pages that were just read are resident.
+  size_t resident_bytes = 0;
+  ASSERT_TRUE(map.GetResidentBytes(0, kPartialSize, &resident_bytes));
+  EXPECT_GE(resident_bytes, kPartialSize);
+  EXPECT_LE(resident_bytes, kPartialSize + 2 * 4096);
+  ASSERT_TRUE(map.GetResidentBytes(10, 0, &resident_bytes));
+  EXPECT_EQ(0u, resident_bytes);
+}
+
+TEST_F(MemoryMappedFileTest, Prefetch) {
+  const size_t kFileSize = 157 * 1024;
+  const size_t kOffset = 1024 * 5 + 32;
+  const size_t kPartialSize = 16 * 1024 - 32;
+  CreateTemporaryTestFile(kFileSize);
+  Thread thread("Prefetch");
+  ASSERT_TRUE(thread.Start());
+
+  {
+    MemoryMappedFile map;
+    File file(temp_file_path(), File::FLAG_OPEN | File::FLAG_READ);
+    ASSERT_TRUE(map.Initialize(
+        file.Pass(), MemoryMappedFile::Region(kOffset, kPartialSize)));
+    EXPECT_TRUE(map.Prefetch(thread.task_runner().get()));
+    ASSERT_TRUE(CheckBufferContents(map.data(), kPartialSize, kOffset));
+  }
+
+  // The prefetch may outlive the MemoryMappedFile.
+  scoped_ptr<MemoryMappedFile> map(new MemoryMappedFile);
+  ASSERT_TRUE(map->Initialize(temp_file_path()));
+  EXPECT_TRUE(map->Prefetch(thread.task_runner().get()));
+  map.reset();
+  thread.Stop();
+}
+#endif  // defined(OS_POSIX)
+
 }  // namespace
 
 }  // namespace base
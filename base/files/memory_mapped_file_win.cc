@@ -10,7 +10,8 @@
 
 namespace base {
 
-MemoryMappedFile::MemoryMappedFile() : data_(NULL), length_(0), image_(false) {
+MemoryMappedFile::MemoryMappedFile()
+    : data_(NULL), length_(0), file_offset_(0), image_(false) {
 }
 
 bool MemoryMappedFile::InitializeAsImageSection(const FilePath& file_name) {
@@ -64,6 +65,7 @@ bool MemoryMappedFile::MapFileRegionToMemory(
     map_start.QuadPart = aligned_start;
     map_size = static_cast<SIZE_T>(size);
     length_ = static_cast<size_t>(region.size);
+    file_offset_ = region.offset;
   }
 
   data_ = static_cast<uint8*>(::MapViewOfFile(file_mapping_.Get(),
@@ -77,6 +79,21 @@ bool MemoryMappedFile::MapFileRegionToMemory(
   return true;
 }
 
+bool MemoryMappedFile::Advise(Advice advice, size_t offset, size_t size) {
+  // Windows has no equivalent of madvise() for mapped files.
+  return false;
+}
+
+bool MemoryMappedFile::Prefetch(TaskRunner* task_runner) {
+  return false;
+}
+
+bool MemoryMappedFile::GetResidentBytes(size_t offset,
+                                        size_t size,
+                                        size_t* resident_bytes) const {
+  return false;
+}
+
 void MemoryMappedFile::CloseHandles() {
   if (data_)
     ::UnmapViewOfFile(data_);
@@ -87,6 +104,7 @@ void MemoryMappedFile::CloseHandles() {
 
   data_ = NULL;
   length_ = 0;
+  file_offset_ = 0;
 }
 
 }  // namespace base
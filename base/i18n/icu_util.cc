@@ -72,6 +72,8 @@ bool InitializeICUWithFileDescriptor(
       LOG(ERROR) << "Couldn't mmap icu data file";
       return false;
     }
+    // ICU only ever touches a small part of its data, scattered all over.
+    mapped_file.Advise(base::MemoryMappedFile::ADVICE_RANDOM);
   }
   UErrorCode err = U_ZERO_ERROR;
   udata_setCommonData(const_cast<uint8*>(mapped_file.data()), &err);
@@ -152,6 +154,8 @@ bool InitializeICU() {
       LOG(ERROR) << "Couldn't mmap " << data_path.AsUTF8Unsafe();
       return false;
     }
+    // ICU only ever touches a small part of its data, scattered all over.
+    mapped_file.Advise(base::MemoryMappedFile::ADVICE_RANDOM);
   }
   UErrorCode err = U_ZERO_ERROR;
   udata_setCommonData(const_cast<uint8*>(mapped_file.data()), &err);
@@ -5,6 +5,7 @@
 #include "base/json/json_reader.h"
 
 #include "base/json/json_parser.h"
+#include "base/json/json_stream_parser.h"
 #include "base/logging.h"
 
 namespace base {
@@ -72,6 +73,25 @@ Value* JSONReader::ReadAndReturnError(const StringPiece& json,
   return NULL;
 }
 
+// static
+bool JSONReader::ParseStreaming(const StringPiece& json,
+                                int options,
+                                JSONParserVisitor* visitor,
+                                int* error_code_out,
+                                std::string* error_msg_out) {
+  JSONStreamParser parser(options, visitor);
+  if (parser.Feed(json) && parser.Finish())
+    return true;
+
+  if (parser.error_code() != JSON_NO_ERROR) {
+    if (error_code_out)
+      *error_code_out = parser.error_code();
+    if (error_msg_out)
+      *error_msg_out = parser.GetErrorMessage();
+  }
+  return false;
+}
+
 // static
 std::string JSONReader::ErrorCodeToString(JsonParseError error_code) {
   switch (error_code) {
@@ -37,6 +37,7 @@
 
 namespace base {
 
+class JSONParserVisitor;
 class Value;
 
 namespace internal {
@@ -110,6 +111,18 @@ class BASE_EXPORT JSONReader {
                                    int* error_code_out,
                                    std::string* error_msg_out);
 
+  // Parses |json| without building a Value, reporting its contents to
+  // |visitor| instead (see json_stream_parser.h). Unescaped strings are passed
+  // to |visitor| as StringPieces into |json|. Returns false if |json| is not
+  // properly formed, in which case the optional |error_code_out| and
+  // |error_msg_out| are populated like for ReadAndReturnError(), or if
+  // |visitor| stopped parsing.
+  static bool ParseStreaming(const StringPiece& json,
+                             int options,  // JSONParserOptions
+                             JSONParserVisitor* visitor,
+                             int* error_code_out,
+                             std::string* error_msg_out);
+
   // Converts a JSON parse error code into a human readable message.
   // Returns an empty string if error_code is JSON_NO_ERROR.
   static std::string ErrorCodeToString(JsonParseError error_code);
@@ -0,0 +1,769 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/json/json_stream_parser.h"
+
+#include <string.h>
+
+#include <algorithm>
+
+#include "base/float_util.h"
+#include "base/logging.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/strings/string_util.h"
+#include "base/strings/stringprintf.h"
+#include "base/strings/utf_string_conversion_utils.h"
+#include "base/third_party/icu/icu_utf.h"
+#include "base/values.h"
+
+namespace base {
+
+namespace {
+
+// Must match the limit of JSONParser.
+const size_t kStackMaxDepth = 100;
+
+const int32 kExtendedASCIIStart = 0x80;
+
+// When a token straddles two chunks, the held back part is completed with at
+// least this many bytes of the next chunk at a time.
+const size_t kMinPendingInputGrowth = 64;
+
+const char* SkipDigits(const char* pos, const char* end) {
+  while (pos < end && IsAsciiDigit(*pos))
+    ++pos;
+  return pos;
+}
+
+// Validates the UTF-8 character that starts at |pos|. Returns its length, 0
+// if it is cut off by |end|, or -1 if it is invalid.
+int ValidateMultiByteCharacter(const char* pos, const char* end) {
+  int32 length = CBU8_COUNT_TRAIL_BYTES(*pos) + 1;
+  if (end - pos < length)
+    return 0;
+  int32 index = 0;
+  int32 code_point = 0;
+  CBU8_NEXT(pos, index, length, code_point);
+  if (code_point < 0 || !IsValidCharacter(code_point))
+    return -1;
+  return index;
+}
+
+void AppendCodePoint(uint32 code_point, std::string* out) {
+  char utf8_units[CBU8_MAX_LENGTH] = { 0 };
+  int offset = 0;
+  CBU8_APPEND_UNSAFE(utf8_units, offset, code_point);
+  out->append(utf8_units, offset);
+}
+
+bool HexToCodeUnit(const char* pos, int* code_unit) {
+  return HexStringToInt(StringPiece(pos, 4), code_unit);
+}
+
+}  // namespace
+
+JSONStreamParser::JSONStreamParser(int options, JSONParserVisitor* visitor)
+    : options_(options),
+      visitor_(visitor),
+      state_(STATE_ROOT_VALUE),
+      after_number_(false),
+      buffer_start_(NULL),
+      pos_(NULL),
+      end_pos_(NULL),
+      is_final_(false),
+      buffer_index_(0),
+      checked_bom_(false),
+      line_number_(1),
+      index_last_line_(0),
+      last_char_was_cr_(false),
+      error_code_(JSONReader::JSON_NO_ERROR),
+      error_line_(0),
+      error_column_(0) {
+  DCHECK(visitor_);
+}
+
+JSONStreamParser::~JSONStreamParser() {
+}
+
+bool JSONStreamParser::Feed(const StringPiece& chunk) {
+  if (state_ == STATE_FAILED)
+    return false;
+
+  // Complete a token held back by the previous call. Only as much of |chunk|
+  // is copied as that takes, growing geometrically so that long tokens are
+  // copied a bounded number of times.
+  size_t chunk_offset = 0;
+  size_t appended = 0;
+  while (!pending_input_.empty()) {
+    if (appended == chunk.size())
+      return true;
+    size_t count = std::min(chunk.size() - appended,
+                            std::max(pending_input_.size(),
+                                     kMinPendingInputGrowth));
+    pending_input_.append(chunk.data() + appended, count);
+    appended += count;
+
+    const size_t held_back = pending_input_.size() - appended;
+    size_t consumed = 0;
+    if (!ParseBuffer(pending_input_.data(), pending_input_.size(), false,
+                     &consumed)) {
+      return false;
+    }
+    if (consumed >= held_back) {
+      // Everything that was held back has been parsed; the rest can be
+      // parsed in place.
+      chunk_offset = consumed - held_back;
+      pending_input_.clear();
+    } else {
+      pending_input_.erase(0, consumed);
+    }
+  }
+
+  size_t consumed = 0;
+  if (!ParseBuffer(chunk.data() + chunk_offset, chunk.size() - chunk_offset,
+                   false, &consumed)) {
+    return false;
+  }
+  chunk_offset += consumed;
+  pending_input_.assign(chunk.data() + chunk_offset,
+                        chunk.size() - chunk_offset);
+  return true;
+}
+
+bool JSONStreamParser::Finish() {
+  if (state_ == STATE_FAILED)
+    return false;
+
+  size_t consumed = 0;
+  bool result = ParseBuffer(pending_input_.data(), pending_input_.size(), true,
+                            &consumed);
+  pending_input_.clear();
+  DCHECK(!result || state_ == STATE_DONE);
+  return result;
+}
+
+JSONReader::JsonParseError JSONStreamParser::error_code() const {
+  return error_code_;
+}
+
+std::string JSONStreamParser::GetErrorMessage() const {
+  std::string description = JSONReader::ErrorCodeToString(error_code_);
+  if (error_line_ || error_column_) {
+    return StringPrintf("Line: %i, column: %i, %s",
+        error_line_, error_column_, description.c_str());
+  }
+  return description;
+}
+
+bool JSONStreamParser::ParseBuffer(const char* data,
+                                   size_t length,
+                                   bool is_final,
+                                   size_t* consumed) {
+  buffer_start_ = data;
+  pos_ = data;
+  end_pos_ = data + length;
+  is_final_ = is_final;
+
+  Result result = checked_bom_ ? RESULT_OK : SkipByteOrderMark();
+  while (result == RESULT_OK) {
+    result = EatWhitespaceAndComments();
+    if (result != RESULT_OK)
+      break;
+    if (pos_ == end_pos_) {
+      // At the end of the input anything but a complete root is an error,
+      // which ParseNextToken() reports.
+      if (is_final_ && state_ != STATE_DONE)
+        result = ParseNextToken();
+      break;
+    }
+    result = ParseNextToken();
+  }
+
+  *consumed = pos_ - buffer_start_;
+  buffer_index_ += static_cast<int>(*consumed);
+  buffer_start_ = pos_ = end_pos_ = NULL;
+  return result != RESULT_STOP;
+}
+
+JSONStreamParser::Result JSONStreamParser::ParseNextToken() {
+  const char c = pos_ < end_pos_ ? *pos_ : '\0';
+  if (after_number_) {
+    after_number_ = false;
+    if (c != ',' && c != ']' && c != '}')
+      return ReportError(JSONReader::JSON_SYNTAX_ERROR, 1);
+  }
+  switch (state_) {
+    case STATE_ROOT_VALUE:
+    case STATE_DICTIONARY_VALUE:
+      return ParseValue();
+    case STATE_LIST_FIRST_VALUE:
+      if (c == ']')
+        return EndContainer();
+      return ParseValue();
+    case STATE_LIST_VALUE:
+      if (c == ']') {
+        if (!(options_ & JSON_ALLOW_TRAILING_COMMAS))
+          return ReportError(JSONReader::JSON_TRAILING_COMMA, 1);
+        return EndContainer();
+      }
+      return ParseValue();
+    case STATE_LIST_SEPARATOR:
+      if (c == ',') {
+        ++pos_;
+        state_ = STATE_LIST_VALUE;
+        return RESULT_OK;
+      }
+      if (c == ']')
+        return EndContainer();
+      return ReportError(JSONReader::JSON_SYNTAX_ERROR, 1);
+    case STATE_DICTIONARY_FIRST_KEY:
+    case STATE_DICTIONARY_KEY:
+      if (c == '}') {
+        if (state_ == STATE_DICTIONARY_KEY &&
+            !(options_ & JSON_ALLOW_TRAILING_COMMAS)) {
+          return ReportError(JSONReader::JSON_TRAILING_COMMA, 1);
+        }
+        return EndContainer();
+      }
+      if (c == '"')
+        return ConsumeString(true);
+      return ReportError(JSONReader::JSON_UNQUOTED_DICTIONARY_KEY, 1);
+    case STATE_DICTIONARY_PAIR_SEPARATOR:
+      if (c == ':') {
+        ++pos_;
+        state_ = STATE_DICTIONARY_VALUE;
+        return RESULT_OK;
+      }
+      return ReportError(JSONReader::JSON_SYNTAX_ERROR, 1);
+    case STATE_DICTIONARY_SEPARATOR:
+      if (c == ',') {
+        ++pos_;
+        state_ = STATE_DICTIONARY_KEY;
+        return RESULT_OK;
+      }
+      if (c == '}')
+        return EndContainer();
+      return ReportError(JSONReader::JSON_SYNTAX_ERROR, 0);
+    case STATE_DONE:
+      return ReportError(JSONReader::JSON_UNEXPECTED_DATA_AFTER_ROOT, 1);
+    case STATE_FAILED:
+      break;
+  }
+  NOTREACHED();
+  return RESULT_STOP;
+}
+
+JSONStreamParser::Result JSONStreamParser::ParseValue() {
+  if (pos_ == end_pos_)
+    return ReportError(JSONReader::JSON_UNEXPECTED_TOKEN, 1);
+
+  switch (*pos_) {
+    case '{':
+      return BeginContainer(false);
+    case '[':
+      return BeginContainer(true);
+    case '"':
+      return ConsumeString(false);
+    case '0':
+    case '1':
+    case '2':
+    case '3':
+    case '4':
+    case '5':
+    case '6':
+    case '7':
+    case '8':
+    case '9':
+    case '-':
+      return ConsumeNumber();
+    case 't':
+    case 'f':
+    case 'n':
+      return ConsumeLiteral();
+    default:
+      return ReportError(JSONReader::JSON_UNEXPECTED_TOKEN, 1);
+  }
+}
+
+JSONStreamParser::Result JSONStreamParser::ConsumeString(bool is_key) {
+  DCHECK_EQ('"', *pos_);
+
+  // Fast path: as long as there is nothing to unescape, the string can be
+  // handed out in place.
+  const char* pos = pos_ + 1;
+  while (pos < end_pos_) {
+    const char c = *pos;
+    if (c == '"') {
+      StringPiece value(pos_ + 1, pos - pos_ - 1);
+      pos_ = pos + 1;
+      return StringCompleted(value, is_key);
+    }
+    if (c == '\\')
+      return ConsumeEscapedString(pos, is_key);
+    if (static_cast<uint8>(c) < kExtendedASCIIStart) {
+      ++pos;
+      continue;
+    }
+    int length = ValidateMultiByteCharacter(pos, end_pos_);
+    if (length == 0)
+      break;
+    if (length < 0) {
+      pos_ = pos;
+      return ReportError(JSONReader::JSON_UNSUPPORTED_ENCODING, 1);
+    }
+    pos += length;
+  }
+  return NeedMoreInputOrError(end_pos_, JSONReader::JSON_SYNTAX_ERROR);
+}
+
+JSONStreamParser::Result JSONStreamParser::ConsumeEscapedString(
+    const char* escape,
+    bool is_key) {
+  unescaped_.assign(pos_ + 1, escape);
+
+  const char* pos = escape;
+  while (pos < end_pos_) {
+    const char c = *pos;
+    if (c == '"') {
+      pos_ = pos + 1;
+      return StringCompleted(unescaped_, is_key);
+    }
+
+    if (static_cast<uint8>(c) >= kExtendedASCIIStart) {
+      int length = ValidateMultiByteCharacter(pos, end_pos_);
+      if (length == 0)
+        break;
+      if (length < 0) {
+        pos_ = pos;
+        return ReportError(JSONReader::JSON_UNSUPPORTED_ENCODING, 1);
+      }
+      unescaped_.append(pos, length);
+      pos += length;
+      continue;
+    }
+
+    if (c != '\\') {
+      unescaped_.push_back(c);
+      ++pos;
+      continue;
+    }
+
+    if (end_pos_ - pos < 2)
+      return NeedMoreInputOrError(pos + 1, JSONReader::JSON_INVALID_ESCAPE);
+    switch (pos[1]) {
+      case 'x': {  // UTF-8 sequence, for compatibility with JSONParser.
+        if (end_pos_ - pos < 4)
+          return NeedMoreInputOrError(pos + 1,
+                                      JSONReader::JSON_INVALID_ESCAPE);
+        int hex_digit = 0;
+        if (!HexStringToInt(StringPiece(pos + 2, 2), &hex_digit)) {
+          pos_ = pos + 1;
+          return ReportError(JSONReader::JSON_INVALID_ESCAPE, 1);
+        }
+        if (hex_digit < kExtendedASCIIStart)
+          unescaped_.push_back(static_cast<char>(hex_digit));
+        else
+          AppendCodePoint(hex_digit, &unescaped_);
+        pos += 4;
+        break;
+      }
+      case 'u': {  // UTF-16 sequence, possibly a surrogate pair.
+        if (end_pos_ - pos < 6)
+          return NeedMoreInputOrError(pos + 1,
+                                      JSONReader::JSON_INVALID_ESCAPE);
+        int code_unit_high = 0;
+        if (!HexToCodeUnit(pos + 2, &code_unit_high) ||
+            (CBU16_IS_SURROGATE(code_unit_high) &&
+             !CBU16_IS_SURROGATE_LEAD(code_unit_high))) {
+          pos_ = pos + 1;
+          return ReportError(JSONReader::JSON_INVALID_ESCAPE, 1);
+        }
+        if (!CBU16_IS_SURROGATE(code_unit_high)) {
+          AppendCodePoint(code_unit_high, &unescaped_);
+          pos += 6;
+          break;
+        }
+        if (end_pos_ - pos < 12)
+          return NeedMoreInputOrError(pos + 1,
+                                      JSONReader::JSON_INVALID_ESCAPE);
+        int code_unit_low = 0;
+        if (pos[6] != '\\' || pos[7] != 'u' ||
+            !HexToCodeUnit(pos + 8, &code_unit_low) ||
+            !CBU16_IS_TRAIL(code_unit_low)) {
+          pos_ = pos + 1;
+          return ReportError(JSONReader::JSON_INVALID_ESCAPE, 1);
+        }
+        AppendCodePoint(
+            CBU16_GET_SUPPLEMENTARY(code_unit_high, code_unit_low),
+            &unescaped_);
+        pos += 12;
+        break;
+      }
+      case '"':
+      case '\\':
+      case '/':
+        unescaped_.push_back(pos[1]);
+        pos += 2;
+        break;
+      case 'b':
+        unescaped_.push_back('\b');
+        pos += 2;
+        break;
+      case 'f':
+        unescaped_.push_back('\f');
+        pos += 2;
+        break;
+      case 'n':
+        unescaped_.push_back('\n');
+        pos += 2;
+        break;
+      case 'r':
+        unescaped_.push_back('\r');
+        pos += 2;
+        break;
+      case 't':
+        unescaped_.push_back('\t');
+        pos += 2;
+        break;
+      case 'v':  // Not listed as valid escape sequence in the RFC.
+        unescaped_.push_back('\v');
+        pos += 2;
+        break;
+      default:
+        pos_ = pos + 1;
+        return ReportError(JSONReader::JSON_INVALID_ESCAPE, 1);
+    }
+  }
+  return NeedMoreInputOrError(end_pos_, JSONReader::JSON_SYNTAX_ERROR);
+}
+
+JSONStreamParser::Result JSONStreamParser::StringCompleted(
+    const StringPiece& value,
+    bool is_key) {
+  if (is_key) {
+    state_ = STATE_DICTIONARY_PAIR_SEPARATOR;
+    return VisitorResult(visitor_->OnDictionaryKey(value));
+  }
+  ValueCompleted();
+  return VisitorResult(visitor_->OnString(value));
+}
+
+JSONStreamParser::Result JSONStreamParser::ConsumeNumber() {
+  // A number has no terminator of its own, so it is only complete once a
+  // byte that can't be part of it has been seen.
+  const char* pos = pos_;
+  if (*pos == '-')
+    ++pos;
+
+  const char* int_start = pos;
+  pos = SkipDigits(pos, end_pos_);
+  if (pos == end_pos_ && !is_final_)
+    return RESULT_NEED_MORE_INPUT;
+  if (pos == int_start || (pos - int_start > 1 && *int_start == '0')) {
+    pos_ = pos;
+    return ReportError(JSONReader::JSON_SYNTAX_ERROR, 1);
+  }
+
+  // The optional fraction part.
+  if (pos < end_pos_ && *pos == '.') {
+    const char* fraction_start = ++pos;
+    pos = SkipDigits(pos, end_pos_);
+    if (pos == end_pos_ && !is_final_)
+      return RESULT_NEED_MORE_INPUT;
+    if (pos == fraction_start) {
+      pos_ = pos;
+      return ReportError(JSONReader::JSON_SYNTAX_ERROR, 1);
+    }
+  }
+
+  // Optional exponent part.
+  if (pos < end_pos_ && (*pos == 'e' || *pos == 'E')) {
+    ++pos;
+    if (pos < end_pos_ && (*pos == '-' || *pos == '+'))
+      ++pos;
+    const char* exponent_start = pos;
+    pos = SkipDigits(pos, end_pos_);
+    if (pos == end_pos_ && !is_final_)
+      return RESULT_NEED_MORE_INPUT;
+    if (pos == exponent_start) {
+      pos_ = pos;
+      return ReportError(JSONReader::JSON_SYNTAX_ERROR, 1);
+    }
+  }
+
+  StringPiece num_string(pos_, pos - pos_);
+
+  int num_int;
+  if (StringToInt(num_string, &num_int)) {
+    pos_ = pos;
+    after_number_ = true;
+    ValueCompleted();
+    return VisitorResult(visitor_->OnInteger(num_int));
+  }
+
+  double num_double;
+  if (StringToDouble(num_string.as_string(), &num_double) &&
+      IsFinite(num_double)) {
+    pos_ = pos;
+    after_number_ = true;
+    ValueCompleted();
+    return VisitorResult(visitor_->OnDouble(num_double));
+  }
+
+  return ReportError(JSONReader::JSON_SYNTAX_ERROR, 1);
+}
+
+JSONStreamParser::Result JSONStreamParser::ConsumeLiteral() {
+  const char* literal = NULL;
+  switch (*pos_) {
+    case 't':
+      literal = "true";
+      break;
+    case 'f':
+      literal = "false";
+      break;
+    case 'n':
+      literal = "null";
+      break;
+    default:
+      return ReportError(JSONReader::JSON_UNEXPECTED_TOKEN, 1);
+  }
+
+  const size_t length = strlen(literal);
+  const size_t available = end_pos_ - pos_;
+  if (available < length) {
+    if (!is_final_ && strncmp(pos_, literal, available) == 0)
+      return RESULT_NEED_MORE_INPUT;
+    return ReportError(JSONReader::JSON_SYNTAX_ERROR, 1);
+  }
+  if (strncmp(pos_, literal, length) != 0)
+    return ReportError(JSONReader::JSON_SYNTAX_ERROR, 1);
+
+  const char first = *pos_;
+  pos_ += length;
+  ValueCompleted();
+  if (first == 'n')
+    return VisitorResult(visitor_->OnNull());
+  return VisitorResult(visitor_->OnBoolean(first == 't'));
+}
+
+JSONStreamParser::Result JSONStreamParser::EatWhitespaceAndComments() {
+  while (pos_ < end_pos_) {
+    switch (*pos_) {
+      case '\r':
+      case '\n':
+        // Don't increment line_number_ twice for "\r\n".
+        if (!(*pos_ == '\n' && last_char_was_cr_))
+          ++line_number_;
+        index_last_line_ = CurrentIndex();
+        last_char_was_cr_ = *pos_ == '\r';
+        ++pos_;
+        break;
+      case ' ':
+      case '\t':
+        last_char_was_cr_ = false;
+        ++pos_;
+        break;
+      case '/': {
+        if (end_pos_ - pos_ < 2)
+          return is_final_ ? RESULT_OK : RESULT_NEED_MORE_INPUT;
+
+        const char* comment_end = NULL;
+        if (pos_[1] == '/') {
+          // Single line comment, read to newline.
+          const char* newline_chars = "\r\n";
+          comment_end = std::find_first_of(pos_ + 2, end_pos_, newline_chars,
+                                           newline_chars + 2);
+        } else if (pos_[1] == '*') {
+          // Block comment, read until end marker.
+          const char* end_marker = "*/";
+          comment_end = std::search(pos_ + 2, end_pos_, end_marker,
+                                    end_marker + 2);
+          if (comment_end != end_pos_)
+            comment_end += 2;
+        } else {
+          // Not a comment; the caller reports the invalid token.
+          return RESULT_OK;
+        }
+
+        // An unterminated comment runs to the end of the input, as with
+        // JSONParser.
+        if (comment_end == end_pos_ && !is_final_)
+          return RESULT_NEED_MORE_INPUT;
+        pos_ = comment_end;
+        last_char_was_cr_ = false;
+        break;
+      }
+      default:
+        return RESULT_OK;
+    }
+  }
+  return RESULT_OK;
+}
+
+JSONStreamParser::Result JSONStreamParser::SkipByteOrderMark() {
+  static const char kByteOrderMark[] = "\xEF\xBB\xBF";
+  const size_t available = end_pos_ - pos_;
+  if (available < 3) {
+    if (!is_final_ && memcmp(pos_, kByteOrderMark, available) == 0)
+      return RESULT_NEED_MORE_INPUT;
+  } else if (memcmp(pos_, kByteOrderMark, 3) == 0) {
+    pos_ += 3;
+  }
+  checked_bom_ = true;
+  return RESULT_OK;
+}
+
+JSONStreamParser::Result JSONStreamParser::NeedMoreInputOrError(
+    const char* error_pos,
+    JSONReader::JsonParseError code) {
+  if (!is_final_)
+    return RESULT_NEED_MORE_INPUT;
+  pos_ = error_pos;
+  return ReportError(code, 1);
+}
+
+void JSONStreamParser::ValueCompleted() {
+  if (stack_.empty())
+    state_ = STATE_DONE;
+  else if (stack_.back())
+    state_ = STATE_LIST_SEPARATOR;
+  else
+    state_ = STATE_DICTIONARY_SEPARATOR;
+}
+
+JSONStreamParser::Result JSONStreamParser::BeginContainer(bool is_list) {
+  if (stack_.size() + 1 >= kStackMaxDepth)
+    return ReportError(JSONReader::JSON_TOO_MUCH_NESTING, 1);
+
+  ++pos_;
+  stack_.push_back(is_list);
+  if (is_list) {
+    state_ = STATE_LIST_FIRST_VALUE;
+    return VisitorResult(visitor_->OnListBegin());
+  }
+  state_ = STATE_DICTIONARY_FIRST_KEY;
+  return VisitorResult(visitor_->OnDictionaryBegin());
+}
+
+JSONStreamParser::Result JSONStreamParser::EndContainer() {
+  DCHECK(!stack_.empty());
+  const bool is_list = stack_.back();
+  stack_.pop_back();
+  ++pos_;
+  ValueCompleted();
+  return VisitorResult(is_list ? visitor_->OnListEnd()
+                               : visitor_->OnDictionaryEnd());
+}
+
+JSONStreamParser::Result JSONStreamParser::VisitorResult(
+    bool should_continue) {
+  if (should_continue)
+    return RESULT_OK;
+  state_ = STATE_FAILED;
+  return RESULT_STOP;
+}
+
+JSONStreamParser::Result JSONStreamParser::ReportError(
+    JSONReader::JsonParseError code,
+    int column_adjust) {
+  state_ = STATE_FAILED;
+  error_code_ = code;
+  error_line_ = line_number_;
+  error_column_ = CurrentIndex() - index_last_line_ + column_adjust;
+  return RESULT_STOP;
+}
+
+int JSONStreamParser::CurrentIndex() const {
+  return buffer_index_ + static_cast<int>(pos_ - buffer_start_);
+}
+
+// JSONValueBuilder ////////////////////////////////////////////////////////////
+
+JSONValueBuilder::JSONValueBuilder() {
+}
+
+JSONValueBuilder::~JSONValueBuilder() {
+}
+
+scoped_ptr<Value> JSONValueBuilder::PassValue() {
+  open_containers_.clear();
+  key_.clear();
+  return root_.Pass();
+}
+
+bool JSONValueBuilder::OnNull() {
+  AddValue(Value::CreateNullValue());
+  return true;
+}
+
+bool JSONValueBuilder::OnBoolean(bool value) {
+  AddValue(new FundamentalValue(value));
+  return true;
+}
+
+bool JSONValueBuilder::OnInteger(int value) {
+  AddValue(new FundamentalValue(value));
+  return true;
+}
+
+bool JSONValueBuilder::OnDouble(double value) {
+  AddValue(new FundamentalValue(value));
+  return true;
+}
+
+bool JSONValueBuilder::OnString(const StringPiece& value) {
+  AddValue(new StringValue(value.as_string()));
+  return true;
+}
+
+bool JSONValueBuilder::OnDictionaryBegin() {
+  DictionaryValue* dictionary = new DictionaryValue;
+  AddValue(dictionary);
+  open_containers_.push_back(dictionary);
+  return true;
+}
+
+bool JSONValueBuilder::OnDictionaryKey(const StringPiece& key) {
+  DCHECK(!open_containers_.empty());
+  key.CopyToString(&key_);
+  return true;
+}
+
+bool JSONValueBuilder::OnDictionaryEnd() {
+  DCHECK(open_containers_.back()->IsType(Value::TYPE_DICTIONARY));
+  open_containers_.pop_back();
+  return true;
+}
+
+bool JSONValueBuilder::OnListBegin() {
+  ListValue* list = new ListValue;
+  AddValue(list);
+  open_containers_.push_back(list);
+  return true;
+}
+
+bool JSONValueBuilder::OnListEnd() {
+  DCHECK(open_containers_.back()->IsType(Value::TYPE_LIST));
+  open_containers_.pop_back();
+  return true;
+}
+
+void JSONValueBuilder::AddValue(Value* value) {
+  if (open_containers_.empty()) {
+    DCHECK(!root_);
+    root_.reset(value);
+    return;
+  }
+
+  Value* container = open_containers_.back();
+  if (container->IsType(Value::TYPE_LIST)) {
+    static_cast<ListValue*>(container)->Append(value);
+  } else {
+    static_cast<DictionaryValue*>(container)->SetWithoutPathExpansion(key_,
+                                                                      value);
+  }
+}
+
+}  // namespace base
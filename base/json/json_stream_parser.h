@@ -0,0 +1,256 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// An event-based ("SAX-style") JSON parser. Instead of building a Value tree
+// like JSONReader::Read(), JSONStreamParser reports what it finds to a
+// JSONParserVisitor, and it can be fed its input in arbitrary chunks.
+//
+// Strings and dictionary keys are passed to the visitor as StringPieces that
+// point directly into the input whenever the string contains no escape
+// sequences. Escaped strings, and tokens that straddle two chunks, are
+// unescaped or reassembled into a buffer owned by the parser. Either way a
+// StringPiece is only valid for the duration of the visitor call.
+//
+// The accepted syntax, the options and the error codes are the same as for
+// JSONReader.
+
+#ifndef BASE_JSON_JSON_STREAM_PARSER_H_
+#define BASE_JSON_JSON_STREAM_PARSER_H_
+
+#include <string>
+#include <vector>
+
+#include "base/base_export.h"
+#include "base/basictypes.h"
+#include "base/compiler_specific.h"
+#include "base/json/json_reader.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/strings/string_piece.h"
+
+namespace base {
+
+class Value;
+
+// Receives the events of a JSONStreamParser. Each method returns whether
+// parsing should continue; returning false stops the parser without
+// reporting an error.
+class BASE_EXPORT JSONParserVisitor {
+ public:
+  virtual ~JSONParserVisitor() {}
+
+  virtual bool OnNull() = 0;
+  virtual bool OnBoolean(bool value) = 0;
+  virtual bool OnInteger(int value) = 0;
+  virtual bool OnDouble(double value) = 0;
+  virtual bool OnString(const StringPiece& value) = 0;
+
+  // A dictionary is reported as OnDictionaryBegin(), then OnDictionaryKey()
+  // followed by the events of the value for each entry, then
+  // OnDictionaryEnd().
+  virtual bool OnDictionaryBegin() = 0;
+  virtual bool OnDictionaryKey(const StringPiece& key) = 0;
+  virtual bool OnDictionaryEnd() = 0;
+
+  virtual bool OnListBegin() = 0;
+  virtual bool OnListEnd() = 0;
+};
+
+class BASE_EXPORT JSONStreamParser {
+ public:
+  // |options| is a combination of JSONParserOptions. |visitor| must outlive
+  // the parser.
+  JSONStreamParser(int options, JSONParserVisitor* visitor);
+  ~JSONStreamParser();
+
+  // Parses the next |chunk| of the input. A token that is cut off at the end
+  // of |chunk| is held back until the next call. Returns false if the input
+  // is malformed or the visitor stopped parsing; the parser must not be fed
+  // any more data after that.
+  bool Feed(const StringPiece& chunk);
+
+  // Signals the end of the input. Returns false if the input was malformed
+  // or incomplete, or if the visitor stopped parsing.
+  bool Finish();
+
+  // Returns the error code, or JSON_NO_ERROR if there was no error. This is
+  // also the case if parsing was stopped by the visitor.
+  JSONReader::JsonParseError error_code() const;
+
+  // Returns the human-friendly error message.
+  std::string GetErrorMessage() const;
+
+ private:
+  // What the parser expects next. Beginning of a value is implied for the
+  // *_VALUE states.
+  enum State {
+    STATE_ROOT_VALUE,
+    STATE_LIST_FIRST_VALUE,     // After '['.
+    STATE_LIST_VALUE,           // After ',' in a list.
+    STATE_LIST_SEPARATOR,       // After a value in a list.
+    STATE_DICTIONARY_FIRST_KEY, // After '{'.
+    STATE_DICTIONARY_KEY,       // After ',' in a dictionary.
+    STATE_DICTIONARY_PAIR_SEPARATOR,
+    STATE_DICTIONARY_VALUE,
+    STATE_DICTIONARY_SEPARATOR, // After a value in a dictionary.
+    STATE_DONE,
+    STATE_FAILED,
+  };
+
+  enum Result {
+    RESULT_OK,
+    // The token at |pos_| continues past the end of the buffer.
+    RESULT_NEED_MORE_INPUT,
+    // An error was reported or the visitor stopped parsing.
+    RESULT_STOP,
+  };
+
+  // Parses as many complete tokens of |data| as possible. If |is_final|, the
+  // end of |data| is the end of the input. Sets |consumed| to the number of
+  // bytes that don't need to be seen again. Returns false if parsing
+  // stopped.
+  bool ParseBuffer(const char* data,
+                   size_t length,
+                   bool is_final,
+                   size_t* consumed);
+
+  // Handles the token at |pos_|, or the end of the input if |pos_| is at the
+  // end of a final buffer.
+  Result ParseNextToken();
+
+  // Parses the start of a value at |pos_|.
+  Result ParseValue();
+
+  // Consumes the token with the first byte at |pos_|. On RESULT_OK |pos_| is
+  // past the token.
+  Result ConsumeString(bool is_key);
+  Result ConsumeNumber();
+  Result ConsumeLiteral();
+
+  // Slow path of ConsumeString() for strings with escape sequences. |escape|
+  // points to the first backslash.
+  Result ConsumeEscapedString(const char* escape, bool is_key);
+
+  // Reports a complete string or dictionary key to the visitor.
+  Result StringCompleted(const StringPiece& value, bool is_key);
+
+  // Skips whitespace and comments. Also counts lines for error messages.
+  Result EatWhitespaceAndComments();
+
+  // Skips a UTF-8 byte order mark at the start of the input.
+  Result SkipByteOrderMark();
+
+  // Called when the token at |pos_| is cut off by the end of the buffer.
+  // Returns RESULT_NEED_MORE_INPUT, or reports |code| at |error_pos| if the
+  // buffer is the end of the input.
+  Result NeedMoreInputOrError(const char* error_pos,
+                              JSONReader::JsonParseError code);
+
+  // Called after a complete value has been consumed.
+  void ValueCompleted();
+
+  // Starts and ends a list or dictionary.
+  Result BeginContainer(bool is_list);
+  Result EndContainer();
+
+  // Records the result of a visitor call.
+  Result VisitorResult(bool should_continue);
+
+  // Sets the error information to |code| at the column of |pos_|, adjusted by
+  // |column_adjust|.
+  Result ReportError(JSONReader::JsonParseError code, int column_adjust);
+
+  // Number of bytes of the input before |pos_|.
+  int CurrentIndex() const;
+
+  const int options_;
+  JSONParserVisitor* const visitor_;
+
+  State state_;
+
+  // Whether the last token was a number. Like JSONParser, the parser then
+  // reports any token other than a separator or the end of a container as a
+  // syntax error rather than, say, data after the root.
+  bool after_number_;
+
+  // For each open container, whether it is a list (as opposed to a
+  // dictionary).
+  std::vector<bool> stack_;
+
+  // Input that was held back by the last Feed().
+  std::string pending_input_;
+
+  // Scratch buffer for unescaped strings.
+  std::string unescaped_;
+
+  // The buffer being parsed, and the position in it.
+  const char* buffer_start_;
+  const char* pos_;
+  const char* end_pos_;
+  bool is_final_;
+
+  // Number of bytes of the input before |buffer_start_|.
+  int buffer_index_;
+
+  // Whether the byte order mark check at the start of the input is done.
+  bool checked_bom_;
+
+  // The line number that the parser is at currently, and the index of the
+  // last line break.
+  int line_number_;
+  int index_last_line_;
+  bool last_char_was_cr_;
+
+  // Error information.
+  JSONReader::JsonParseError error_code_;
+  int error_line_;
+  int error_column_;
+
+  DISALLOW_COPY_AND_ASSIGN(JSONStreamParser);
+};
+
+// A JSONParserVisitor that builds a Value out of the events it receives, the
+// same Value JSONReader::Read() would have returned. Useful for turning a part
+// of a stream into a Value.
+class BASE_EXPORT JSONValueBuilder : public JSONParserVisitor {
+ public:
+  JSONValueBuilder();
+  ~JSONValueBuilder() override;
+
+  // Returns whether a complete value has been built.
+  bool has_value() const { return root_.get() && open_containers_.empty(); }
+
+  // Returns the value built so far and resets the builder.
+  scoped_ptr<Value> PassValue();
+
+  // JSONParserVisitor:
+  bool OnNull() override;
+  bool OnBoolean(bool value) override;
+  bool OnInteger(int value) override;
+  bool OnDouble(double value) override;
+  bool OnString(const StringPiece& value) override;
+  bool OnDictionaryBegin() override;
+  bool OnDictionaryKey(const StringPiece& key) override;
+  bool OnDictionaryEnd() override;
+  bool OnListBegin() override;
+  bool OnListEnd() override;
+
+ private:
+  // Adds |value| to the innermost open container, or makes it the root.
+  // Takes ownership of |value|.
+  void AddValue(Value* value);
+
+  scoped_ptr<Value> root_;
+
+  // Containers that are not complete yet. Owned by |root_|.
+  std::vector<Value*> open_containers_;
+
+  // The key of the next value added to a dictionary.
+  std::string key_;
+
+  DISALLOW_COPY_AND_ASSIGN(JSONValueBuilder);
+};
+
+}  // namespace base
+
+#endif  // BASE_JSON_JSON_STREAM_PARSER_H_
@@ -0,0 +1,296 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/json/json_stream_parser.h"
+
+#include <string>
+#include <vector>
+
+#include "base/json/json_reader.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/strings/string_piece.h"
+#include "base/values.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+
+namespace {
+
+// Records the events as strings. Also records whether strings were passed
+// as pieces of the input.
+class RecordingVisitor : public JSONParserVisitor {
+ public:
+  explicit RecordingVisitor(const StringPiece& input)
+      : input_(input),
+        stop_after_(-1) {
+  }
+
+  const std::vector<std::string>& events() const { return events_; }
+  const std::vector<bool>& strings_in_input() const {
+    return strings_in_input_;
+  }
+  void set_stop_after(int stop_after) { stop_after_ = stop_after; }
+
+  // JSONParserVisitor:
+  bool OnNull() override { return Record("null"); }
+  bool OnBoolean(bool value) override {
+    return Record(value ? "true" : "false");
+  }
+  bool OnInteger(int value) override {
+    return Record("int:" + IntToString(value));
+  }
+  bool OnDouble(double value) override {
+    return Record("double:" + DoubleToString(value));
+  }
+  bool OnString(const StringPiece& value) override {
+    RecordStringLocation(value);
+    return Record("string:" + value.as_string());
+  }
+  bool OnDictionaryBegin() override { return Record("{"); }
+  bool OnDictionaryKey(const StringPiece& key) override {
+    RecordStringLocation(key);
+    return Record("key:" + key.as_string());
+  }
+  bool OnDictionaryEnd() override { return Record("}"); }
+  bool OnListBegin() override { return Record("["); }
+  bool OnListEnd() override { return Record("]"); }
+
+ private:
+  bool Record(const std::string& event) {
+    events_.push_back(event);
+    return stop_after_ < 0 || static_cast<int>(events_.size()) < stop_after_;
+  }
+
+  void RecordStringLocation(const StringPiece& value) {
+    strings_in_input_.push_back(value.data() >= input_.data() &&
+                                value.end() <= input_.end());
+  }
+
+  StringPiece input_;
+  int stop_after_;
+  std::vector<std::string> events_;
+  std::vector<bool> strings_in_input_;
+};
+
+// Feeds |input| to |parser| in chunks of |chunk_size| bytes. The chunks are
+// copied so that the parser can't rely on them outliving Feed().
+bool FeedInChunks(const std::string& input,
+                  size_t chunk_size,
+                  JSONStreamParser* parser) {
+  for (size_t i = 0; i < input.size(); i += chunk_size) {
+    std::string chunk = input.substr(i, chunk_size);
+    if (!parser->Feed(chunk))
+      return false;
+  }
+  return parser->Finish();
+}
+
+}  // namespace
+
+TEST(JSONStreamParserTest, Events) {
+  const std::string input =
+      "{\"a\": [1, -2.5, true, false, null], \"b\": {}, \"c\": \"str\"}";
+  RecordingVisitor visitor(input);
+  JSONStreamParser parser(JSON_PARSE_RFC, &visitor);
+  EXPECT_TRUE(parser.Feed(input));
+  EXPECT_TRUE(parser.Finish());
+  EXPECT_EQ(JSONReader::JSON_NO_ERROR, parser.error_code());
+
+  const char* const kExpected[] = {
+    "{", "key:a", "[", "int:1", "double:-2.5", "true", "false", "null", "]",
+    "key:b", "{", "}", "key:c", "string:str", "}",
+  };
+  ASSERT_EQ(arraysize(kExpected), visitor.events().size());
+  for (size_t i = 0; i < arraysize(kExpected); ++i)
+    EXPECT_EQ(kExpected[i], visitor.events()[i]);
+
+  // Strings without escapes are not copied.
+  ASSERT_EQ(4U, visitor.strings_in_input().size());
+  for (size_t i = 0; i < visitor.strings_in_input().size(); ++i)
+    EXPECT_TRUE(visitor.strings_in_input()[i]);
+}
+
+TEST(JSONStreamParserTest, EscapedStrings) {
+  const std::string input =
+      "[\"a\\\"b\\\\c\\/d\\b\\f\\n\\r\\t\\v\", \"\\x41\\u00e9\\ud83d\\ude07\","
+      " \"\xe2\x82\xac\"]";
+  RecordingVisitor visitor(input);
+  EXPECT_TRUE(JSONReader::ParseStreaming(input, JSON_PARSE_RFC, &visitor,
+                                         NULL, NULL));
+  ASSERT_EQ(5U, visitor.events().size());
+  EXPECT_EQ("string:a\"b\\c/d\b\f\n\r\t\v", visitor.events()[1]);
+  EXPECT_EQ("string:A\xc3\xa9\xf0\x9f\x98\x87", visitor.events()[2]);
+  EXPECT_EQ("string:\xe2\x82\xac", visitor.events()[3]);
+
+  ASSERT_EQ(3U, visitor.strings_in_input().size());
+  EXPECT_FALSE(visitor.strings_in_input()[0]);
+  EXPECT_FALSE(visitor.strings_in_input()[1]);
+  EXPECT_TRUE(visitor.strings_in_input()[2]);
+}
+
+TEST(JSONStreamParserTest, Chunks) {
+  const std::string input =
+      "\xEF\xBB\xBF{ // comment\r\n"
+      "  \"list\": [1, 23456, -0.5e-3, 1E+2, true, false, null, [], {}],\n"
+      "  /* block\n comment */ \"escaped\": \"\\u00e9\\ud83d\\ude07\\n\",\n"
+      "  \"utf8\": \"\xf0\x9f\x98\x87\xc3\xa9\",\n"
+      "  \"nested\": {\"a\": {\"b\": [\"c\", {\"d\": 1.5}]}}\n"
+      "}  ";
+
+  scoped_ptr<Value> expected(JSONReader::Read(input));
+  ASSERT_TRUE(expected.get());
+
+  RecordingVisitor whole_visitor(input);
+  EXPECT_TRUE(JSONReader::ParseStreaming(input, JSON_PARSE_RFC,
+                                         &whole_visitor, NULL, NULL));
+
+  for (size_t chunk_size = 1; chunk_size <= input.size(); ++chunk_size) {
+    SCOPED_TRACE(chunk_size);
+
+    JSONValueBuilder builder;
+    JSONStreamParser builder_parser(JSON_PARSE_RFC, &builder);
+    EXPECT_TRUE(FeedInChunks(input, chunk_size, &builder_parser));
+    ASSERT_TRUE(builder.has_value());
+    EXPECT_TRUE(expected->Equals(builder.PassValue().get()));
+
+    RecordingVisitor visitor(input);
+    JSONStreamParser parser(JSON_PARSE_RFC, &visitor);
+    EXPECT_TRUE(FeedInChunks(input, chunk_size, &parser));
+    EXPECT_EQ(whole_visitor.events(), visitor.events());
+  }
+}
+
+TEST(JSONStreamParserTest, IncompleteInput) {
+  const char* const kInputs[] = {
+    "", "[", "[1", "[1,", "{\"a\"", "{\"a\":", "\"abc", "tru", "-", "1.",
+    "1e", "[\"\\u12", "[\"\\ud83d", "/* comment",
+  };
+  for (size_t i = 0; i < arraysize(kInputs); ++i) {
+    SCOPED_TRACE(kInputs[i]);
+    JSONValueBuilder builder;
+    JSONStreamParser parser(JSON_PARSE_RFC, &builder);
+    EXPECT_TRUE(parser.Feed(kInputs[i]));
+    EXPECT_FALSE(parser.Finish());
+    EXPECT_NE(JSONReader::JSON_NO_ERROR, parser.error_code());
+  }
+}
+
+TEST(JSONStreamParserTest, ErrorMessages) {
+  // The errors match those of JSONReader.
+  std::string nested_json;
+  for (int i = 0; i < 101; ++i) {
+    nested_json.insert(nested_json.begin(), '[');
+    nested_json.append(1, ']');
+  }
+  const std::string kInputs[] = {
+    "[\n0,\n1,\n2,\n3,4,5,6 7,\n8,\n9\n]",
+    "[\r\n0,\r\n1,\r\n2,\r\n3,4,5,6 7,\r\n8,\r\n9\r\n]",
+    "{},{}",
+    nested_json,
+    "[1,]",
+    "{foo:\"bar\"}",
+    "{\"foo\":\"bar\",}",
+    "[nu]",
+    "[\"xxx\\xq\"]",
+    "[\"xxx\\q\"]",
+    "[\"abc",
+    "[01]",
+    "[1.]",
+    "[1e]",
+    "[.5]",
+    "1.5e3[true",
+    "1 2",
+    "{\"a\": 1 \"b\"}",
+  };
+  for (size_t i = 0; i < arraysize(kInputs); ++i) {
+    SCOPED_TRACE(kInputs[i]);
+    int expected_error_code = 0;
+    std::string expected_error_message;
+    scoped_ptr<Value> value(JSONReader::ReadAndReturnError(
+        kInputs[i], JSON_PARSE_RFC, &expected_error_code,
+        &expected_error_message));
+    ASSERT_FALSE(value.get());
+
+    JSONValueBuilder builder;
+    int error_code = 0;
+    std::string error_message;
+    EXPECT_FALSE(JSONReader::ParseStreaming(kInputs[i], JSON_PARSE_RFC,
+                                            &builder, &error_code,
+                                            &error_message));
+    EXPECT_EQ(expected_error_code, error_code);
+    EXPECT_EQ(expected_error_message, error_message);
+
+    // Feeding the input byte by byte gives the same error.
+    JSONValueBuilder chunks_builder;
+    JSONStreamParser parser(JSON_PARSE_RFC, &chunks_builder);
+    EXPECT_FALSE(FeedInChunks(kInputs[i], 1, &parser));
+    EXPECT_EQ(expected_error_code, parser.error_code());
+    EXPECT_EQ(expected_error_message, parser.GetErrorMessage());
+  }
+}
+
+TEST(JSONStreamParserTest, ErrorCodes) {
+  // For these, the reported column differs from JSONReader's.
+  const struct {
+    const char* input;
+    JSONReader::JsonParseError error_code;
+  } kCases[] = {
+    { "[\"xxx\\uq\"]", JSONReader::JSON_INVALID_ESCAPE },
+    { "[\"\\ud83d\\u0041\"]", JSONReader::JSON_INVALID_ESCAPE },
+    { "[\"\\ude07\"]", JSONReader::JSON_INVALID_ESCAPE },
+    { "[\"\xc3\x28\"]", JSONReader::JSON_UNSUPPORTED_ENCODING },
+    { "{\"\xff\": 1}", JSONReader::JSON_UNSUPPORTED_ENCODING },
+  };
+  for (size_t i = 0; i < arraysize(kCases); ++i) {
+    SCOPED_TRACE(kCases[i].input);
+    int expected_error_code = 0;
+    scoped_ptr<Value> value(JSONReader::ReadAndReturnError(
+        kCases[i].input, JSON_PARSE_RFC, &expected_error_code, NULL));
+    ASSERT_FALSE(value.get());
+    EXPECT_EQ(kCases[i].error_code, expected_error_code);
+
+    JSONValueBuilder builder;
+    int error_code = 0;
+    EXPECT_FALSE(JSONReader::ParseStreaming(kCases[i].input, JSON_PARSE_RFC,
+                                            &builder, &error_code, NULL));
+    EXPECT_EQ(kCases[i].error_code, error_code);
+  }
+}
+
+TEST(JSONStreamParserTest, AllowTrailingCommas) {
+  const std::string input = "{\"a\": [1, 2,], \"b\": 3,}";
+  JSONValueBuilder builder;
+  EXPECT_FALSE(JSONReader::ParseStreaming(input, JSON_PARSE_RFC, &builder,
+                                          NULL, NULL));
+
+  JSONValueBuilder trailing_commas_builder;
+  EXPECT_TRUE(JSONReader::ParseStreaming(input, JSON_ALLOW_TRAILING_COMMAS,
+                                         &trailing_commas_builder, NULL,
+                                         NULL));
+  scoped_ptr<Value> expected(
+      JSONReader::Read(input, JSON_ALLOW_TRAILING_COMMAS));
+  EXPECT_TRUE(expected->Equals(trailing_commas_builder.PassValue().get()));
+
+  // Commas are still required between values.
+  EXPECT_FALSE(JSONReader::ParseStreaming("[,]", JSON_ALLOW_TRAILING_COMMAS,
+                                          &builder, NULL, NULL));
+}
+
+TEST(JSONStreamParserTest, VisitorStops) {
+  const std::string input = "[1, [2, 3], 4]";
+  RecordingVisitor visitor(input);
+  visitor.set_stop_after(3);
+  JSONStreamParser parser(JSON_PARSE_RFC, &visitor);
+  EXPECT_FALSE(parser.Feed(input));
+  EXPECT_EQ(3U, visitor.events().size());
+  // Stopping is not an error.
+  EXPECT_EQ(JSONReader::JSON_NO_ERROR, parser.error_code());
+
+  EXPECT_FALSE(parser.Feed("]"));
+  EXPECT_FALSE(parser.Finish());
+  EXPECT_EQ(3U, visitor.events().size());
+}
+
+}  // namespace base
@@ -10,6 +10,7 @@
 
 #include "base/base_export.h"
 #include "base/basictypes.h"
+#include "base/json/json_stream_parser.h"
 #include "base/logging.h"
 #include "base/memory/scoped_ptr.h"
 #include "base/memory/scoped_vector.h"
@@ -47,6 +48,12 @@
 //   JSONValueConverter<Message> converter;
 //   converter.Convert(json, &message);
 //
+// JSON text can also be converted directly with ConvertJSON(), which parses
+// it with JSONStreamParser and only builds Values for the entries of the
+// root dictionary that are registered fields. Unlike with Convert(), a field
+// that occurs more than once in the text is converted once per occurrence.
+//   converter.ConvertJSON(json_text, &message);
+//
 // Convert() returns false when it fails.  Here "fail" means that the value is
 // structurally different from expected, such like a string value appears
 // for an int field.  Do not report failures for missing fields.
@@ -355,6 +362,133 @@ class RepeatedCustomValueConverter
   DISALLOW_COPY_AND_ASSIGN(RepeatedCustomValueConverter);
 };
 
+// Visitor for JSONValueConverter::ConvertJSON(). Captures the entries of the
+// root dictionary that registered fields refer to, and converts each as soon
+// as it is complete. Other entries are skipped without building Values.
+template <typename StructType>
+class StreamingFieldConverter : public JSONParserVisitor {
+ public:
+  typedef ScopedVector<FieldConverterBase<StructType> > FieldConverters;
+
+  StreamingFieldConverter(const FieldConverters& fields, StructType* output)
+      : fields_(fields),
+        output_(output),
+        depth_(0),
+        capturing_(false) {
+  }
+
+  // JSONParserVisitor:
+  bool OnNull() override {
+    return depth_ > 0 && (!capturing_ || EntryUpdated(builder_.OnNull()));
+  }
+  bool OnBoolean(bool value) override {
+    return depth_ > 0 &&
+           (!capturing_ || EntryUpdated(builder_.OnBoolean(value)));
+  }
+  bool OnInteger(int value) override {
+    return depth_ > 0 &&
+           (!capturing_ || EntryUpdated(builder_.OnInteger(value)));
+  }
+  bool OnDouble(double value) override {
+    return depth_ > 0 &&
+           (!capturing_ || EntryUpdated(builder_.OnDouble(value)));
+  }
+  bool OnString(const StringPiece& value) override {
+    return depth_ > 0 &&
+           (!capturing_ || EntryUpdated(builder_.OnString(value)));
+  }
+  bool OnDictionaryBegin() override {
+    if (depth_++ == 0)
+      return true;
+    return !capturing_ || EntryUpdated(builder_.OnDictionaryBegin());
+  }
+  bool OnDictionaryKey(const StringPiece& key) override {
+    if (depth_ > 1)
+      return !capturing_ || EntryUpdated(builder_.OnDictionaryKey(key));
+
+    key.CopyToString(&key_);
+    capturing_ = false;
+    for (size_t i = 0; i < fields_.size() && !capturing_; ++i)
+      capturing_ = MatchesKey(fields_[i]->field_path(), NULL);
+    return true;
+  }
+  bool OnDictionaryEnd() override {
+    if (--depth_ == 0)
+      return true;
+    return !capturing_ || EntryUpdated(builder_.OnDictionaryEnd());
+  }
+  bool OnListBegin() override {
+    // The root must be a dictionary.
+    if (depth_++ == 0)
+      return false;
+    return !capturing_ || EntryUpdated(builder_.OnListBegin());
+  }
+  bool OnListEnd() override {
+    --depth_;
+    return !capturing_ || EntryUpdated(builder_.OnListEnd());
+  }
+
+ private:
+  // Returns whether |path| refers to the entry with key |key_|. If so, sets
+  // the optional |rest| to the remainder of |path| after the key.
+  bool MatchesKey(const std::string& path, std::string* rest) const {
+    if (path.compare(0, key_.size(), key_) != 0)
+      return false;
+    if (path.size() == key_.size()) {
+      if (rest)
+        rest->clear();
+      return true;
+    }
+    if (path[key_.size()] != '.')
+      return false;
+    if (rest)
+      rest->assign(path, key_.size() + 1, std::string::npos);
+    return true;
+  }
+
+  // Called after an event of the captured entry was passed to |builder_|.
+  // Converts the entry once it is complete.
+  bool EntryUpdated(bool result) {
+    if (!builder_.has_value())
+      return result;
+    capturing_ = false;
+    scoped_ptr<Value> value = builder_.PassValue();
+
+    std::string rest;
+    for (size_t i = 0; i < fields_.size(); ++i) {
+      const FieldConverterBase<StructType>* field_converter = fields_[i];
+      if (!MatchesKey(field_converter->field_path(), &rest))
+        continue;
+      const Value* field = value.get();
+      if (!rest.empty()) {
+        const DictionaryValue* dictionary_value = NULL;
+        if (!value->GetAsDictionary(&dictionary_value) ||
+            !dictionary_value->Get(rest, &field)) {
+          continue;
+        }
+      }
+      if (!field_converter->ConvertField(*field, output_)) {
+        DVLOG(1) << "failure at field " << field_converter->field_path();
+        return false;
+      }
+    }
+    return true;
+  }
+
+  const FieldConverters& fields_;
+  StructType* output_;
+
+  // Number of open containers.
+  int depth_;
+
+  // Key of the current entry of the root dictionary, and whether the entry is
+  // being captured into |builder_|.
+  std::string key_;
+  bool capturing_;
+  JSONValueBuilder builder_;
+
+  DISALLOW_COPY_AND_ASSIGN(StreamingFieldConverter);
+};
 
 }  // namespace internal
 
@@ -507,6 +641,14 @@ class JSONValueConverter {
     return true;
   }
 
+  // Like Convert(), but parses the JSON text |json| without building a Value
+  // for all of it. Returns false if |json| is malformed as well.
+  bool ConvertJSON(const StringPiece& json, StructType* output) const {
+    internal::StreamingFieldConverter<StructType> visitor(fields_, output);
+    return JSONReader::ParseStreaming(json, JSON_PARSE_RFC, &visitor, NULL,
+                                      NULL);
+  }
+
  private:
   ScopedVector<internal::FieldConverterBase<StructType> > fields_;
 
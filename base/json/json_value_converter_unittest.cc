@@ -253,4 +253,45 @@ TEST(JSONValueConverterTest, RepeatedValueErrorInTheMiddle) {
   // No check the values as mentioned above.
 }
 
+TEST(JSONValueConverterTest, ConvertJSON) {
+  const char normal_data[] =
+      "{\n"
+      "  \"foo\": 1.0,\n"
+      "  \"unknown\": {\"foo\": [1, {\"bar\": null}]},\n"
+      "  \"child\": {\n"
+      "    \"foo\": 1,\n"
+      "    \"bar\": \"b\\u0061r\",\n"
+      "    \"ints\": [1, 2],\n"
+      "    \"baz\": true\n"
+      "  },\n"
+      "  \"children\": [{\"foo\": 2}, {\"foo\": 3}]\n"
+      "}\n";
+
+  NestedMessage message;
+  base::JSONValueConverter<NestedMessage> converter;
+  EXPECT_TRUE(converter.ConvertJSON(normal_data, &message));
+
+  EXPECT_EQ(1.0, message.foo);
+  EXPECT_EQ(1, message.child.foo);
+  EXPECT_EQ("bar", message.child.bar);
+  EXPECT_TRUE(message.child.baz);
+  EXPECT_FALSE(message.child.bstruct);
+  ASSERT_EQ(2U, message.child.ints.size());
+  EXPECT_EQ(2, *message.child.ints[1]);
+  ASSERT_EQ(2U, message.children.size());
+  EXPECT_EQ(2, message.children[0]->foo);
+  EXPECT_EQ(3, message.children[1]->foo);
+
+  // Conversion failures, malformed JSON and a root that is not a dictionary
+  // all fail.
+  SimpleMessage simple_message;
+  base::JSONValueConverter<SimpleMessage> simple_converter;
+  EXPECT_FALSE(simple_converter.ConvertJSON("{\"foo\": 1, \"bar\": 2}",
+                                            &simple_message));
+  EXPECT_FALSE(simple_converter.ConvertJSON("{\"foo\": 1,", &simple_message));
+  EXPECT_FALSE(simple_converter.ConvertJSON("[{\"foo\": 1}]",
+                                            &simple_message));
+  EXPECT_FALSE(simple_converter.ConvertJSON("1", &simple_message));
+}
+
 }  // namespace base
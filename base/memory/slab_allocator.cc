@@ -0,0 +1,309 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/memory/slab_allocator.h"
+
+#include <algorithm>
+#include <new>
+
+#include "base/bits.h"
+#include "base/lazy_instance.h"
+#include "base/logging.h"
+#include "base/synchronization/lock.h"
+#include "base/threading/thread_local.h"
+#include "base/threading/thread_local_storage.h"
+
+namespace base {
+
+namespace {
+
+// Size classes: 16 classes 16 bytes apart up to 256 bytes, then powers of two
+// from 512 bytes up to kMaxBlockSize.
+const size_t kSmallClassSpacing = 16;
+const size_t kMaxSmallBlockSize = 256;
+const int kNumSmallClasses = kMaxSmallBlockSize / kSmallClassSpacing;
+const int kFirstLargeClassLog2 = 9;
+const int kNumSizeClasses = kNumSmallClasses + 8;
+
+// Blocks move between a thread and the shared free list in batches of about
+// this many bytes, and a thread keeps at most two batches of each class.
+const size_t kBatchBytes = 32 * 1024;
+const size_t kMinBatchLength = 2;
+const size_t kMaxBatchLength = 64;
+
+const size_t kMinSlabSize = 64 * 1024;
+
+// The shared free list of a large class keeps at most this many batches.
+const size_t kMaxSharedBatches = 4;
+
+int SizeClass(size_t size) {
+  if (size <= kMaxSmallBlockSize)
+    return size ? static_cast<int>((size - 1) / kSmallClassSpacing) : 0;
+  return kNumSmallClasses +
+      bits::Log2Ceiling(static_cast<uint32>(size)) - kFirstLargeClassLog2;
+}
+
+size_t BlockSize(int size_class) {
+  if (size_class < kNumSmallClasses)
+    return (size_class + 1) * kSmallClassSpacing;
+  return static_cast<size_t>(1)
+      << (size_class - kNumSmallClasses + kFirstLargeClassLog2);
+}
+
+bool IsLargeClass(int size_class) {
+  return size_class >= kNumSmallClasses;
+}
+
+size_t BatchLength(int size_class) {
+  return std::min(std::max(kBatchBytes / BlockSize(size_class),
+                           kMinBatchLength),
+                  kMaxBatchLength);
+}
+
+// A free block holds the link to the next one.
+struct FreeBlock {
+  FreeBlock* next;
+};
+
+struct FreeList {
+  void Push(void* block) {
+    FreeBlock* free_block = static_cast<FreeBlock*>(block);
+    free_block->next = head;
+    head = free_block;
+    ++length;
+  }
+
+  void* Pop() {
+    FreeBlock* block = head;
+    head = block->next;
+    --length;
+    return block;
+  }
+
+  // Moves up to |count| blocks from this list to |list|.
+  void MoveTo(FreeList* list, size_t count) {
+    for (; count && head; --count)
+      list->Push(Pop());
+  }
+
+  FreeBlock* head;
+  size_t length;
+};
+
+struct ThreadCache {
+  FreeList free_lists[kNumSizeClasses];
+  SlabAllocator::Stats stats;
+};
+
+class SlabAllocatorState {
+ public:
+  SlabAllocatorState() : thread_cache_(&OnThreadExit) {
+    std::fill(free_lists_, free_lists_ + kNumSizeClasses, FreeList());
+  }
+
+  // Returns the current thread's cache, creating it if needed. Returns NULL
+  // once the thread has started to exit.
+  ThreadCache* GetThreadCache() {
+    ThreadCache* cache = static_cast<ThreadCache*>(thread_cache_.Get());
+    if (cache || thread_exited_.Get())
+      return cache;
+    cache = new ThreadCache();
+    thread_cache_.Set(cache);
+    return cache;
+  }
+
+  // Moves a batch of blocks of |size_class| from the shared free list to
+  // |list|, allocating more from the heap if needed. Returns the number of
+  // heap allocations made.
+  size_t Refill(int size_class, FreeList* list) {
+    size_t batch_length = BatchLength(size_class);
+    {
+      AutoLock lock(locks_[size_class]);
+      FreeList* shared_list = &free_lists_[size_class];
+      if (shared_list->head) {
+        shared_list->MoveTo(list, batch_length);
+        return 0;
+      }
+      if (!IsLargeClass(size_class)) {
+        MakeSlab(size_class, shared_list);
+        shared_list->MoveTo(list, batch_length);
+        return 1;
+      }
+    }
+    for (size_t i = 0; i < batch_length; ++i)
+      list->Push(::operator new(BlockSize(size_class)));
+    return batch_length;
+  }
+
+  // Moves |count| blocks of |size_class| from |list| to the shared free list.
+  // Large blocks beyond what the shared list keeps go back to the heap.
+  void Release(int size_class, FreeList* list, size_t count) {
+    FreeList excess = FreeList();
+    {
+      AutoLock lock(locks_[size_class]);
+      FreeList* shared_list = &free_lists_[size_class];
+      list->MoveTo(shared_list, count);
+      if (IsLargeClass(size_class)) {
+        size_t max_length = kMaxSharedBatches * BatchLength(size_class);
+        if (shared_list->length > max_length)
+          shared_list->MoveTo(&excess, shared_list->length - max_length);
+      }
+    }
+    DeleteBlocks(&excess);
+  }
+
+  // Gives every block in the shared free lists of the large classes back to
+  // the heap.
+  void ReleaseLargeBlocks() {
+    for (int size_class = kNumSmallClasses; size_class < kNumSizeClasses;
+         ++size_class) {
+      FreeList blocks = FreeList();
+      {
+        AutoLock lock(locks_[size_class]);
+        std::swap(blocks, free_lists_[size_class]);
+      }
+      DeleteBlocks(&blocks);
+    }
+  }
+
+ private:
+  static void DeleteBlocks(FreeList* list) {
+    while (list->head)
+      ::operator delete(list->Pop());
+  }
+
+  // Carves up a new slab into blocks of |size_class| and adds them to |list|.
+  static void MakeSlab(int size_class, FreeList* list) {
+    size_t block_size = BlockSize(size_class);
+    size_t slab_size = std::max(kMinSlabSize,
+                                2 * BatchLength(size_class) * block_size);
+    char* slab = static_cast<char*>(::operator new(slab_size));
+    for (size_t offset = slab_size; offset >= block_size;
+         offset -= block_size) {
+      list->Push(slab + offset - block_size);
+    }
+  }
+
+  static void OnThreadExit(void* value);
+
+  ThreadLocalStorage::Slot thread_cache_;
+
+  // Set once a thread's cache is gone, so that what the thread frees from
+  // other thread exit handlers goes to the shared free lists.
+  ThreadLocalBoolean thread_exited_;
+
+  Lock locks_[kNumSizeClasses];
+  FreeList free_lists_[kNumSizeClasses];
+
+  DISALLOW_COPY_AND_ASSIGN(SlabAllocatorState);
+};
+
+LazyInstance<SlabAllocatorState>::Leaky g_state = LAZY_INSTANCE_INITIALIZER;
+
+// static
+void SlabAllocatorState::OnThreadExit(void* value) {
+  SlabAllocatorState* state = g_state.Pointer();
+  state->thread_exited_.Set(true);
+  ThreadCache* cache = static_cast<ThreadCache*>(value);
+  for (int size_class = 0; size_class < kNumSizeClasses; ++size_class) {
+    FreeList* list = &cache->free_lists[size_class];
+    state->Release(size_class, list, list->length);
+  }
+  delete cache;
+}
+
+}  // namespace
+
+// static
+void* SlabAllocator::Allocate(size_t size) {
+#if defined(ADDRESS_SANITIZER)
+  return ::operator new(size);
+#else
+  SlabAllocatorState* state = g_state.Pointer();
+  ThreadCache* cache = state->GetThreadCache();
+  if (cache)
+    ++cache->stats.allocations;
+  if (size > kMaxBlockSize) {
+    if (cache)
+      ++cache->stats.heap_allocations;
+    return ::operator new(size);
+  }
+
+  int size_class = SizeClass(size);
+  if (!cache) {
+    // The thread is exiting. Take a block straight from the shared list.
+    FreeList list = FreeList();
+    state->Refill(size_class, &list);
+    void* block = list.Pop();
+    state->Release(size_class, &list, list.length);
+    return block;
+  }
+
+  FreeList* list = &cache->free_lists[size_class];
+  if (!list->head)
+    cache->stats.heap_allocations += state->Refill(size_class, list);
+  return list->Pop();
+#endif
+}
+
+// static
+void SlabAllocator::Free(void* block, size_t size) {
+  if (!block)
+    return;
+#if defined(ADDRESS_SANITIZER)
+  ::operator delete(block);
+#else
+  if (size > kMaxBlockSize) {
+    ::operator delete(block);
+    return;
+  }
+
+  int size_class = SizeClass(size);
+  SlabAllocatorState* state = g_state.Pointer();
+  ThreadCache* cache = state->GetThreadCache();
+  if (!cache) {
+    FreeList list = FreeList();
+    list.Push(block);
+    state->Release(size_class, &list, 1);
+    return;
+  }
+
+  FreeList* list = &cache->free_lists[size_class];
+  list->Push(block);
+  size_t batch_length = BatchLength(size_class);
+  if (list->length > 2 * batch_length)
+    state->Release(size_class, list, batch_length);
+#endif
+}
+
+// static
+bool SlabAllocator::FillsSizeClass(size_t size) {
+  if (size <= kMaxSmallBlockSize)
+    return true;
+  return size <= kMaxBlockSize && (size & (size - 1)) == 0;
+}
+
+// static
+void SlabAllocator::GetThreadStats(Stats* stats) {
+  ThreadCache* cache = g_state.Pointer()->GetThreadCache();
+  *stats = cache ? cache->stats : Stats();
+}
+
+// static
+void SlabAllocator::ReleaseFreeMemory() {
+#if !defined(ADDRESS_SANITIZER)
+  SlabAllocatorState* state = g_state.Pointer();
+  ThreadCache* cache = state->GetThreadCache();
+  if (cache) {
+    for (int size_class = kNumSmallClasses; size_class < kNumSizeClasses;
+         ++size_class) {
+      FreeList* list = &cache->free_lists[size_class];
+      state->Release(size_class, list, list->length);
+    }
+  }
+  state->ReleaseLargeBlocks();
+#endif
+}
+
+}  // namespace base
@@ -0,0 +1,103 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// SlabAllocator is a thread-caching allocator for small objects that are
+// created and destroyed at high rates, such as IO buffers and bound callbacks.
+//
+// Sizes are rounded up to one of a few size classes: multiples of 16 bytes up
+// to 256 bytes, then powers of two up to kMaxBlockSize. Each thread keeps a
+// short free list of blocks for each class, so most allocations and frees are
+// a couple of pointer moves. Threads trade blocks in batches with a shared
+// free list per class.
+//
+// Small blocks are carved from slabs of at least 64 KB, which are kept for
+// reuse. Blocks larger than 256 bytes are allocated from the heap one at a
+// time; the shared lists keep only a few batches of them and give the rest
+// back to the heap, as does ReleaseFreeMemory(). Since rounding up to a power
+// of two can waste almost half of a large block, callers with sizes that vary
+// should check FillsSizeClass() and pool only the sizes that fit.
+//
+// Blocks may be freed on any thread. When built with AddressSanitizer, every
+// block comes from the heap so that misuse is still caught.
+//
+// Most code should use SlabAllocated<T> rather than SlabAllocator itself:
+//
+//   class Packet : public base::RefCountedThreadSafe<Packet>,
+//                  public base::SlabAllocated<Packet> {
+//     ...
+//   };
+//
+// Then |new Packet| allocates from the slabs, and the delete that
+// RefCountedThreadSafe, scoped_ptr or anything else does gives the memory
+// back, for Packet and for every class derived from it.
+
+#ifndef BASE_MEMORY_SLAB_ALLOCATOR_H_
+#define BASE_MEMORY_SLAB_ALLOCATOR_H_
+
+#include <stddef.h>
+
+#include "base/base_export.h"
+#include "base/basictypes.h"
+
+namespace base {
+
+class BASE_EXPORT SlabAllocator {
+ public:
+  // The largest size served from slabs. Larger blocks come from the heap.
+  static const size_t kMaxBlockSize = 64 * 1024;
+
+  // Counts of what the current thread has allocated.
+  struct Stats {
+    Stats() : allocations(0), heap_allocations(0) {}
+
+    // Calls to Allocate().
+    size_t allocations;
+
+    // Allocations from the heap, for new slabs, for large blocks that were
+    // not cached or for blocks larger than kMaxBlockSize.
+    size_t heap_allocations;
+  };
+
+  // Returns true if |size| is served from a size class that it fills, that is
+  // if it is at most 256 bytes or a power of two up to kMaxBlockSize.
+  static bool FillsSizeClass(size_t size);
+
+  // Returns a block of at least |size| bytes, aligned like operator new.
+  static void* Allocate(size_t size);
+
+  // Gives back |block|, which Allocate() returned for the same |size|. |block|
+  // may be NULL.
+  static void Free(void* block, size_t size);
+
+  static void GetThreadStats(Stats* stats);
+
+  // Gives the large blocks cached by the shared free lists and by the current
+  // thread back to the heap. Small slabs and other threads' caches are kept.
+  static void ReleaseFreeMemory();
+
+ private:
+  DISALLOW_IMPLICIT_CONSTRUCTORS(SlabAllocator);
+};
+
+// Gives T, and the classes derived from it, an operator new and delete that
+// use SlabAllocator. Classes that derive from T and are deleted through a T*
+// must have a virtual destructor, as usual, so that the right size is freed.
+template <typename T>
+class SlabAllocated {
+ public:
+  static void* operator new(size_t size) {
+    return SlabAllocator::Allocate(size);
+  }
+  static void operator delete(void* block, size_t size) {
+    SlabAllocator::Free(block, size);
+  }
+
+ protected:
+  SlabAllocated() {}
+  ~SlabAllocated() {}
+};
+
+}  // namespace base
+
+#endif  // BASE_MEMORY_SLAB_ALLOCATOR_H_
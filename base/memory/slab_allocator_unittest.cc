@@ -0,0 +1,247 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/memory/slab_allocator.h"
+
+#include <string.h>
+
+#include <set>
+#include <vector>
+
+#include "base/bind.h"
+#include "base/location.h"
+#include "base/memory/ref_counted.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/single_thread_task_runner.h"
+#include "base/synchronization/waitable_event.h"
+#include "base/threading/thread.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+
+namespace {
+
+class Packet : public RefCountedThreadSafe<Packet>,
+               public SlabAllocated<Packet> {
+ public:
+  explicit Packet(int id) : id_(id) {}
+
+  int id() const { return id_; }
+
+ private:
+  friend class RefCountedThreadSafe<Packet>;
+  ~Packet() {}
+
+  int id_;
+};
+
+class Base : public SlabAllocated<Base> {
+ public:
+  explicit Base(int* destroyed) : destroyed_(destroyed) {}
+  virtual ~Base() { ++*destroyed_; }
+
+ private:
+  int* destroyed_;
+};
+
+class Derived : public Base {
+ public:
+  explicit Derived(int* destroyed) : Base(destroyed) {
+    memset(payload_, 0xAB, sizeof(payload_));
+  }
+
+ private:
+  char payload_[1000];
+};
+
+void FreeBlocks(std::vector<void*>* blocks, size_t size) {
+  for (size_t i = 0; i < blocks->size(); ++i)
+    SlabAllocator::Free((*blocks)[i], size);
+}
+
+void ReleasePacket(scoped_refptr<Packet>* packet, WaitableEvent* done) {
+  *packet = NULL;
+  done->Signal();
+}
+
+}  // namespace
+
+TEST(SlabAllocatorTest, DistinctBlocks) {
+  const size_t kSizes[] = {0, 1, 16, 17, 255, 256, 257, 4000, 4096, 4097,
+                           SlabAllocator::kMaxBlockSize};
+  for (size_t i = 0; i < arraysize(kSizes); ++i) {
+    std::vector<void*> blocks;
+    std::set<void*> distinct;
+    for (int j = 0; j < 200; ++j) {
+      void* block = SlabAllocator::Allocate(kSizes[i]);
+      memset(block, j, kSizes[i]);
+      blocks.push_back(block);
+      distinct.insert(block);
+    }
+    EXPECT_EQ(blocks.size(), distinct.size()) << kSizes[i];
+    for (size_t j = 0; j < blocks.size(); ++j) {
+      if (kSizes[i])
+        EXPECT_EQ(static_cast<char>(j), *static_cast<char*>(blocks[j]));
+      EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(blocks[j]) % sizeof(void*));
+    }
+    FreeBlocks(&blocks, kSizes[i]);
+  }
+}
+
+TEST(SlabAllocatorTest, LargeBlocks) {
+  const size_t kSize = SlabAllocator::kMaxBlockSize + 1;
+  SlabAllocator::Stats before;
+  SlabAllocator::GetThreadStats(&before);
+  void* block = SlabAllocator::Allocate(kSize);
+  memset(block, 0, kSize);
+  SlabAllocator::Free(block, kSize);
+
+  SlabAllocator::Stats after;
+  SlabAllocator::GetThreadStats(&after);
+  EXPECT_EQ(before.allocations + 1, after.allocations);
+  EXPECT_EQ(before.heap_allocations + 1, after.heap_allocations);
+}
+
+TEST(SlabAllocatorTest, FillsSizeClass) {
+  EXPECT_TRUE(SlabAllocator::FillsSizeClass(0));
+  EXPECT_TRUE(SlabAllocator::FillsSizeClass(100));
+  EXPECT_TRUE(SlabAllocator::FillsSizeClass(256));
+  EXPECT_FALSE(SlabAllocator::FillsSizeClass(257));
+  EXPECT_TRUE(SlabAllocator::FillsSizeClass(4096));
+  EXPECT_FALSE(SlabAllocator::FillsSizeClass(4097));
+  EXPECT_FALSE(SlabAllocator::FillsSizeClass(6000));
+  EXPECT_TRUE(SlabAllocator::FillsSizeClass(SlabAllocator::kMaxBlockSize));
+  EXPECT_FALSE(
+      SlabAllocator::FillsSizeClass(2 * SlabAllocator::kMaxBlockSize));
+}
+
+#if !defined(ADDRESS_SANITIZER)
+// Under AddressSanitizer blocks come straight from the heap.
+TEST(SlabAllocatorTest, ReusesFreedBlocks) {
+  void* block = SlabAllocator::Allocate(40);
+  ASSERT_TRUE(block);
+  memset(block, 0, 40);
+  SlabAllocator::Free(block, 40);
+
+  // Sizes in the same class share blocks.
+  EXPECT_EQ(block, SlabAllocator::Allocate(48));
+  SlabAllocator::Free(block, 48);
+  SlabAllocator::Free(NULL, 48);
+}
+
+TEST(SlabAllocatorTest, Stats) {
+  // Warm up the thread's free list for the class.
+  std::vector<void*> blocks;
+  for (int i = 0; i < 10; ++i)
+    blocks.push_back(SlabAllocator::Allocate(100));
+  FreeBlocks(&blocks, 100);
+
+  SlabAllocator::Stats before;
+  SlabAllocator::GetThreadStats(&before);
+  for (int i = 0; i < 1000; ++i)
+    SlabAllocator::Free(SlabAllocator::Allocate(100), 100);
+  SlabAllocator::Stats after;
+  SlabAllocator::GetThreadStats(&after);
+  EXPECT_EQ(before.allocations + 1000, after.allocations);
+  EXPECT_EQ(before.heap_allocations, after.heap_allocations);
+}
+
+TEST(SlabAllocatorTest, LargeBlocksGoBackToTheHeap) {
+  const size_t kSize = 4096;
+  const size_t kCount = 1000;
+  std::vector<void*> blocks;
+  for (size_t i = 0; i < kCount; ++i)
+    blocks.push_back(SlabAllocator::Allocate(kSize));
+  FreeBlocks(&blocks, kSize);
+  blocks.clear();
+
+  // Only a few batches were kept, so most blocks come from the heap again.
+  SlabAllocator::Stats before;
+  SlabAllocator::GetThreadStats(&before);
+  for (size_t i = 0; i < kCount; ++i)
+    blocks.push_back(SlabAllocator::Allocate(kSize));
+  SlabAllocator::Stats after;
+  SlabAllocator::GetThreadStats(&after);
+  EXPECT_GT(after.heap_allocations - before.heap_allocations, kCount * 9 / 10);
+  FreeBlocks(&blocks, kSize);
+}
+
+TEST(SlabAllocatorTest, ReleaseFreeMemory) {
+  const size_t kSize = 1024;
+  SlabAllocator::Free(SlabAllocator::Allocate(kSize), kSize);
+  SlabAllocator::Stats before;
+  SlabAllocator::GetThreadStats(&before);
+  SlabAllocator::Free(SlabAllocator::Allocate(kSize), kSize);
+  SlabAllocator::Stats after;
+  SlabAllocator::GetThreadStats(&after);
+  EXPECT_EQ(before.heap_allocations, after.heap_allocations);
+
+  SlabAllocator::ReleaseFreeMemory();
+  SlabAllocator::GetThreadStats(&before);
+  SlabAllocator::Free(SlabAllocator::Allocate(kSize), kSize);
+  SlabAllocator::GetThreadStats(&after);
+  EXPECT_LT(before.heap_allocations, after.heap_allocations);
+}
+
+TEST(SlabAllocatorTest, DerivedClassesFreeTheirOwnSize) {
+  int destroyed = 0;
+  scoped_ptr<Base> derived(new Derived(&destroyed));
+  void* derived_block = derived.get();
+  derived.reset();
+
+  void* block = SlabAllocator::Allocate(sizeof(Derived));
+  EXPECT_EQ(derived_block, block);
+  SlabAllocator::Free(block, sizeof(Derived));
+}
+#endif  // !defined(ADDRESS_SANITIZER)
+
+TEST(SlabAllocatorTest, FreeOnOtherThread) {
+  Thread thread("SlabAllocatorTest");
+  ASSERT_TRUE(thread.Start());
+
+  for (int i = 0; i < 100; ++i) {
+    std::vector<void*> blocks;
+    for (int j = 0; j < 100; ++j)
+      blocks.push_back(SlabAllocator::Allocate(64));
+    thread.task_runner()->PostTask(
+        FROM_HERE, Bind(&FreeBlocks, Owned(new std::vector<void*>(blocks)),
+                        64));
+  }
+
+  scoped_refptr<Packet> packet(new Packet(7));
+  WaitableEvent done(false, false);
+  thread.task_runner()->PostTask(
+      FROM_HERE, Bind(&ReleasePacket, Unretained(&packet), &done));
+  done.Wait();
+  EXPECT_FALSE(packet.get());
+
+  // The thread gives back what it cached when it exits.
+  thread.Stop();
+}
+
+TEST(SlabAllocatorTest, RefCounted) {
+  scoped_refptr<Packet> first(new Packet(1));
+  scoped_refptr<Packet> second(new Packet(2));
+  EXPECT_NE(first.get(), second.get());
+  EXPECT_EQ(1, first->id());
+  EXPECT_EQ(2, second->id());
+
+#if !defined(ADDRESS_SANITIZER)
+  Packet* freed = first.get();
+  first = NULL;
+  scoped_refptr<Packet> third(new Packet(3));
+  EXPECT_EQ(freed, third.get());
+#endif
+}
+
+TEST(SlabAllocatorTest, DerivedClasses) {
+  int destroyed = 0;
+  scoped_ptr<Base> base(new Base(&destroyed));
+  scoped_ptr<Base> derived(new Derived(&destroyed));
+  base.reset();
+  derived.reset();
+  EXPECT_EQ(2, destroyed);
+}
+
+}  // namespace base
@@ -8,6 +8,7 @@
 #include "base/message_loop/message_loop.h"
 #include "base/metrics/histogram.h"
 #include "base/synchronization/waitable_event.h"
+#include "base/threading/platform_thread.h"
 #include "base/time/time.h"
 
 namespace base {
@@ -28,14 +29,31 @@ bool AlwaysNotifyPump(MessageLoop::Type type) {
 #endif
 }
 
+// |posting_state_| layout: bit 0 is set once the message loop is going away,
+// and every in-flight post adds kPostInProgress.
+const subtle::Atomic32 kMessageLoopGone = 1;
+const subtle::Atomic32 kPostInProgress = 2;
+
 }  // namespace
 
-IncomingTaskQueue::IncomingTaskQueue(MessageLoop* message_loop)
-    : high_res_task_count_(0),
+IncomingTaskQueue::LinkNode::LinkNode() : next(0) {
+}
+
+IncomingTaskQueue::TaskNode::TaskNode(PendingTask* pending_task)
+    : pending_task(static_cast<PendingTask&&>(*pending_task)) {
+}
+
+IncomingTaskQueue::IncomingTaskQueue(MessageLoop* message_loop, QueueMode mode)
+    : mode_(mode),
+      high_res_task_count_(0),
       message_loop_(message_loop),
       next_sequence_num_(0),
       message_loop_scheduled_(false),
-      always_schedule_work_(AlwaysNotifyPump(message_loop_->type())) {
+      always_schedule_work_(AlwaysNotifyPump(message_loop_->type())),
+      head_(reinterpret_cast<subtle::AtomicWord>(&stub_)),
+      tail_(&stub_),
+      lock_free_scheduled_(0),
+      posting_state_(0) {
 }
 
 bool IncomingTaskQueue::AddToIncomingQueue(
@@ -43,6 +61,19 @@ bool IncomingTaskQueue::AddToIncomingQueue(
     const Closure& task,
     TimeDelta delay,
     bool nestable) {
+  if (mode_ == LOCK_FREE_QUEUE) {
+    PendingTask pending_task(
+        from_here, task, CalculateDelayedRuntime(delay), nestable);
+#if defined(OS_WIN)
+    if (delay > TimeDelta() &&
+        delay.InMilliseconds() < (2 * Time::kMinLowResolutionThresholdMs)) {
+      subtle::NoBarrier_AtomicIncrement(&high_res_task_count_, 1);
+      pending_task.is_high_res = true;
+    }
+#endif
+    return PostPendingTaskLockFree(&pending_task);
+  }
+
   AutoLock locked(incoming_queue_lock_);
   PendingTask pending_task(
       from_here, task, CalculateDelayedRuntime(delay), nestable);
@@ -61,11 +92,18 @@ bool IncomingTaskQueue::AddToIncomingQueue(
 }
 
 bool IncomingTaskQueue::HasHighResolutionTasks() {
+  if (mode_ == LOCK_FREE_QUEUE)
+    return subtle::NoBarrier_Load(&high_res_task_count_) > 0;
   AutoLock lock(incoming_queue_lock_);
   return high_res_task_count_ > 0;
 }
 
 bool IncomingTaskQueue::IsIdleForTesting() {
+  if (mode_ == LOCK_FREE_QUEUE) {
+    // Only the consumer looks at |tail_|, and this is called on the loop
+    // thread.
+    return tail_ == &stub_ && !subtle::Acquire_Load(&stub_.next);
+  }
   AutoLock lock(incoming_queue_lock_);
   return incoming_queue_.empty();
 }
@@ -74,6 +112,12 @@ int IncomingTaskQueue::ReloadWorkQueue(TaskQueue* work_queue) {
   // Make sure no tasks are lost.
   DCHECK(work_queue->empty());
 
+  if (mode_ == LOCK_FREE_QUEUE) {
+    ReloadWorkQueueLockFree(work_queue);
+    // Reset the count of high resolution tasks since our queue is now empty.
+    return subtle::NoBarrier_AtomicExchange(&high_res_task_count_, 0);
+  }
+
   // Acquire all we can from the inter-thread queue with one lock acquisition.
   AutoLock lock(incoming_queue_lock_);
   if (incoming_queue_.empty()) {
@@ -91,6 +135,22 @@ int IncomingTaskQueue::ReloadWorkQueue(TaskQueue* work_queue) {
 }
 
 void IncomingTaskQueue::WillDestroyCurrentMessageLoop() {
+  if (mode_ == LOCK_FREE_QUEUE) {
+    // Refuse new posts, then wait for the ones that already observed a live
+    // |message_loop_| to finish with it. Posts only touch the loop for a
+    // bounded amount of time (annotation and ScheduleWork()), so yielding is
+    // sufficient here.
+    subtle::Atomic32 state = subtle::NoBarrier_Load(&posting_state_);
+    for (;;) {
+      subtle::Atomic32 previous = subtle::Acquire_CompareAndSwap(
+          &posting_state_, state, state | kMessageLoopGone);
+      if (previous == state)
+        break;
+      state = previous;
+    }
+    while (subtle::Acquire_Load(&posting_state_) != kMessageLoopGone)
+      PlatformThread::YieldCurrentThread();
+  }
   AutoLock lock(incoming_queue_lock_);
   message_loop_ = NULL;
 }
@@ -98,6 +158,11 @@ void IncomingTaskQueue::WillDestroyCurrentMessageLoop() {
 IncomingTaskQueue::~IncomingTaskQueue() {
   // Verify that WillDestroyCurrentMessageLoop() has been called.
   DCHECK(!message_loop_);
+
+  // Tasks that raced with the destruction of the message loop are deleted
+  // along with the queue, as they would be with |incoming_queue_|.
+  while (TaskNode* node = PopLockFree())
+    delete node;
 }
 
 TimeTicks IncomingTaskQueue::CalculateDelayedRuntime(TimeDelta delay) {
@@ -131,8 +196,7 @@ bool IncomingTaskQueue::PostPendingTask(PendingTask* pending_task) {
                                                 *pending_task);
 
   bool was_empty = incoming_queue_.empty();
-  incoming_queue_.push(*pending_task);
-  pending_task->task.Reset();
+  incoming_queue_.Push(pending_task);
 
   if (always_schedule_work_ || (!message_loop_scheduled_ && was_empty)) {
     // Wake up the message loop.
@@ -148,5 +212,108 @@ bool IncomingTaskQueue::PostPendingTask(PendingTask* pending_task) {
   return true;
 }
 
+bool IncomingTaskQueue::PostPendingTaskLockFree(PendingTask* pending_task) {
+  DCHECK_EQ(LOCK_FREE_QUEUE, mode_);
+
+  // Register as an in-flight post. This keeps |message_loop_| alive until we
+  // leave, see WillDestroyCurrentMessageLoop().
+  if (subtle::Barrier_AtomicIncrement(&posting_state_, kPostInProgress) &
+      kMessageLoopGone) {
+    subtle::Barrier_AtomicIncrement(&posting_state_, -kPostInProgress);
+    pending_task->task.Reset();
+    return false;
+  }
+
+  // Within one posting thread sequence numbers still increase in posting
+  // order, which is all the delayed work queue relies on for FIFO ordering.
+  pending_task->sequence_num =
+      subtle::NoBarrier_AtomicIncrement(&next_sequence_num_, 1) - 1;
+
+  message_loop_->task_annotator()->DidQueueTask("MessageLoop::PostTask",
+                                                *pending_task);
+
+  PushLockFree(new TaskNode(pending_task));
+
+  // The flag is cleared by the loop before it re-checks the queue and goes to
+  // sleep, so exactly one poster after that point wakes it up.
+  if (always_schedule_work_ ||
+      subtle::Acquire_CompareAndSwap(&lock_free_scheduled_, 0, 1) == 0) {
+    message_loop_->ScheduleWork();
+  }
+
+  subtle::Barrier_AtomicIncrement(&posting_state_, -kPostInProgress);
+  return true;
+}
+
+void IncomingTaskQueue::ReloadWorkQueueLockFree(TaskQueue* work_queue) {
+  while (TaskNode* node = PopLockFree()) {
+    work_queue->Push(&node->pending_task);
+    delete node;
+  }
+  if (!work_queue->empty())
+    return;
+
+  // The loop is about to go idle. Publish that before looking at the queue one
+  // last time: a producer that pushed after our final check is then
+  // guaranteed to see the cleared flag and call ScheduleWork().
+  subtle::Release_Store(&lock_free_scheduled_, 0);
+  subtle::MemoryBarrier();
+  while (TaskNode* node = PopLockFree()) {
+    work_queue->Push(&node->pending_task);
+    delete node;
+  }
+  // We found work after all, so nobody needs to wake us up for it.
+  if (!work_queue->empty())
+    subtle::NoBarrier_CompareAndSwap(&lock_free_scheduled_, 0, 1);
+}
+
+void IncomingTaskQueue::PushLockFree(LinkNode* node) {
+  subtle::NoBarrier_Store(&node->next, 0);
+  // atomicops has no exchange with barriers, so fence on both sides: the
+  // producer that links behind |node| must observe the store above, and we
+  // must observe the |next| store of the producer that linked |previous|.
+  subtle::MemoryBarrier();
+  LinkNode* previous =
+      reinterpret_cast<LinkNode*>(subtle::NoBarrier_AtomicExchange(
+          &head_, reinterpret_cast<subtle::AtomicWord>(node)));
+  subtle::MemoryBarrier();
+  // Between the exchange and this store the list is temporarily disconnected;
+  // PopLockFree() treats that as empty.
+  subtle::Release_Store(&previous->next,
+                        reinterpret_cast<subtle::AtomicWord>(node));
+}
+
+IncomingTaskQueue::TaskNode* IncomingTaskQueue::PopLockFree() {
+  LinkNode* tail = tail_;
+  LinkNode* next =
+      reinterpret_cast<LinkNode*>(subtle::Acquire_Load(&tail->next));
+  if (tail == &stub_) {
+    if (!next)
+      return NULL;
+    tail_ = next;
+    tail = next;
+    next = reinterpret_cast<LinkNode*>(subtle::Acquire_Load(&tail->next));
+  }
+  if (next) {
+    tail_ = next;
+    return static_cast<TaskNode*>(tail);
+  }
+
+  // |tail| is the last linked node. If it is not also the head, a producer
+  // has swapped |head_| but not yet linked its node; it will wake us up.
+  LinkNode* head = reinterpret_cast<LinkNode*>(subtle::Acquire_Load(&head_));
+  if (tail != head)
+    return NULL;
+
+  // Re-insert the stub so that |tail| can be detached.
+  PushLockFree(&stub_);
+  next = reinterpret_cast<LinkNode*>(subtle::Acquire_Load(&tail->next));
+  if (next) {
+    tail_ = next;
+    return static_cast<TaskNode*>(tail);
+  }
+  return NULL;
+}
+
 }  // namespace internal
 }  // namespace base
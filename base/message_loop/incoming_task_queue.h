@@ -5,6 +5,7 @@
 #ifndef BASE_MESSAGE_LOOP_INCOMING_TASK_QUEUE_H_
 #define BASE_MESSAGE_LOOP_INCOMING_TASK_QUEUE_H_
 
+#include "base/atomicops.h"
 #include "base/base_export.h"
 #include "base/memory/ref_counted.h"
 #include "base/pending_task.h"
@@ -21,10 +22,21 @@ namespace internal {
 // Implements a queue of tasks posted to the message loop running on the current
 // thread. This class takes care of synchronizing posting tasks from different
 // threads and together with MessageLoop ensures clean shutdown.
+//
+// The queue can run in one of two modes. LOCKED_QUEUE guards a std::queue
+// with |incoming_queue_lock_|. LOCK_FREE_QUEUE uses an intrusive
+// multi-producer/single-consumer linked list (after Dmitry Vyukov's design),
+// so posting threads never block on each other or on the loop thread; the
+// lock is only taken when the loop is being torn down.
 class BASE_EXPORT IncomingTaskQueue
     : public RefCountedThreadSafe<IncomingTaskQueue> {
  public:
-  explicit IncomingTaskQueue(MessageLoop* message_loop);
+  enum QueueMode {
+    LOCKED_QUEUE,
+    LOCK_FREE_QUEUE,
+  };
+
+  IncomingTaskQueue(MessageLoop* message_loop, QueueMode mode);
 
   // Appends a task to the incoming queue. Posting of all tasks is routed though
   // AddToIncomingQueue() or TryAddToIncomingQueue() to make sure that posting
@@ -50,11 +62,31 @@ class BASE_EXPORT IncomingTaskQueue
   // require high resolution timers.
   int ReloadWorkQueue(TaskQueue* work_queue);
 
-  // Disconnects |this| from the parent message loop.
+  // Disconnects |this| from the parent message loop. In LOCK_FREE_QUEUE mode
+  // this waits for posts that are already in flight on other threads.
   void WillDestroyCurrentMessageLoop();
 
+  QueueMode mode() const { return mode_; }
+
  private:
   friend class RefCountedThreadSafe<IncomingTaskQueue>;
+
+  // Link of the lock-free queue. |next| holds a LinkNode* and is published
+  // with release semantics by the producer that appended the following node.
+  struct LinkNode {
+    LinkNode();
+
+    subtle::AtomicWord next;
+  };
+
+  // A posted task as stored in the lock-free queue.
+  struct TaskNode : public LinkNode {
+    // Takes over |pending_task->task|.
+    explicit TaskNode(PendingTask* pending_task);
+
+    PendingTask pending_task;
+  };
+
   virtual ~IncomingTaskQueue();
 
   // Calculates the time at which a PendingTask should run.
@@ -66,9 +98,27 @@ class BASE_EXPORT IncomingTaskQueue
   // does not retain |pending_task->task| beyond this function call.
   bool PostPendingTask(PendingTask* pending_task);
 
+  // LOCK_FREE_QUEUE counterpart of PostPendingTask(). Must be called without
+  // |incoming_queue_lock_| held.
+  bool PostPendingTaskLockFree(PendingTask* pending_task);
+
+  // LOCK_FREE_QUEUE counterpart of ReloadWorkQueue().
+  void ReloadWorkQueueLockFree(TaskQueue* work_queue);
+
+  // Appends |node| to the lock-free queue. Safe to call from any thread.
+  void PushLockFree(LinkNode* node);
+
+  // Removes the oldest task from the lock-free queue and returns it, or NULL if
+  // the queue is empty or a producer is still in the middle of appending. The
+  // caller owns the returned node. Must only be called by the consumer.
+  TaskNode* PopLockFree();
+
+  const QueueMode mode_;
+
   // Number of tasks that require high resolution timing. This value is kept
-  // so that ReloadWorkQueue() completes in constant time.
-  int high_res_task_count_;
+  // so that ReloadWorkQueue() completes in constant time. Only accessed
+  // atomically in LOCK_FREE_QUEUE mode.
+  subtle::Atomic32 high_res_task_count_;
 
   // The lock that protects access to the members of this class.
   base::Lock incoming_queue_lock_;
@@ -81,8 +131,9 @@ class BASE_EXPORT IncomingTaskQueue
   // Points to the message loop that owns |this|.
   MessageLoop* message_loop_;
 
-  // The next sequence number to use for delayed tasks.
-  int next_sequence_num_;
+  // The next sequence number to use for delayed tasks. Incremented under
+  // |incoming_queue_lock_| in LOCKED_QUEUE mode and atomically otherwise.
+  subtle::Atomic32 next_sequence_num_;
 
   // True if our message loop has already been scheduled and does not need to be
   // scheduled again until an empty reload occurs.
@@ -92,6 +143,22 @@ class BASE_EXPORT IncomingTaskQueue
   // if the incoming queue was not empty.
   const bool always_schedule_work_;
 
+  // State of the lock-free queue. |head_| is the most recently pushed
+  // LinkNode* and is contended by producers; |tail_| is the oldest node and is
+  // only touched by the consumer. |stub_| keeps the list non-empty so that
+  // producers never need to update |tail_|.
+  subtle::AtomicWord head_;
+  LinkNode* tail_;
+  LinkNode stub_;
+
+  // Lock-free equivalent of |message_loop_scheduled_|.
+  subtle::Atomic32 lock_free_scheduled_;
+
+  // Rundown protection for |message_loop_| in LOCK_FREE_QUEUE mode. The low
+  // bit is set once the loop is being destroyed; the remaining bits count
+  // posts currently in progress.
+  subtle::Atomic32 posting_state_;
+
   DISALLOW_COPY_AND_ASSIGN(IncomingTaskQueue);
 };
 
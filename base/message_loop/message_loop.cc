@@ -84,6 +84,8 @@ const LinearHistogram::DescriptionPair event_descriptions_[] = {
 
 bool enable_histogrammer_ = false;
 
+bool enable_lock_free_incoming_queue_ = false;
+
 MessageLoop::MessagePumpFactory* message_pump_for_ui_factory_ = NULL;
 
 #if defined(OS_IOS)
@@ -198,6 +200,11 @@ void MessageLoop::EnableHistogrammer(bool enable) {
   enable_histogrammer_ = enable;
 }
 
+// static
+void MessageLoop::EnableLockFreeIncomingQueue(bool enable) {
+  enable_lock_free_incoming_queue_ = enable;
+}
+
 // static
 bool MessageLoop::InitMessagePumpForUIFactory(MessagePumpFactory* factory) {
   if (message_pump_for_ui_factory_)
@@ -382,7 +389,11 @@ void MessageLoop::Init() {
   DCHECK(!current()) << "should only have one message loop per thread";
   lazy_tls_ptr.Pointer()->Set(this);
 
-  incoming_task_queue_ = new internal::IncomingTaskQueue(this);
+  incoming_task_queue_ = new internal::IncomingTaskQueue(
+      this,
+      enable_lock_free_incoming_queue_
+          ? internal::IncomingTaskQueue::LOCK_FREE_QUEUE
+          : internal::IncomingTaskQueue::LOCKED_QUEUE);
   message_loop_proxy_ =
       new internal::MessageLoopProxyImpl(incoming_task_queue_);
   thread_task_runner_handle_.reset(
@@ -412,8 +423,7 @@ bool MessageLoop::ProcessNextDelayedNonNestableTask() {
   if (deferred_non_nestable_work_queue_.empty())
     return false;
 
-  PendingTask pending_task = deferred_non_nestable_work_queue_.front();
-  deferred_non_nestable_work_queue_.pop();
+  PendingTask pending_task = deferred_non_nestable_work_queue_.TakeFront();
 
   RunTask(pending_task);
   return true;
@@ -463,8 +473,7 @@ void MessageLoop::AddToDelayedWorkQueue(const PendingTask& pending_task) {
 bool MessageLoop::DeletePendingTasks() {
   bool did_work = !work_queue_.empty();
   while (!work_queue_.empty()) {
-    PendingTask pending_task = work_queue_.front();
-    work_queue_.pop();
+    PendingTask pending_task = work_queue_.TakeFront();
     if (!pending_task.delayed_run_time.is_null()) {
       // We want to delete delayed tasks in the same order in which they would
       // normally be deleted in case of any funny dependencies between delayed
@@ -543,8 +552,7 @@ bool MessageLoop::DoWork() {
 
     // Execute oldest task.
     do {
-      PendingTask pending_task = work_queue_.front();
-      work_queue_.pop();
+      PendingTask pending_task = work_queue_.TakeFront();
       if (!pending_task.delayed_run_time.is_null()) {
         AddToDelayedWorkQueue(pending_task);
         // If we changed the topmost task, then it is time to reschedule.
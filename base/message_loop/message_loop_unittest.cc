@@ -9,6 +9,7 @@
 #include "base/compiler_specific.h"
 #include "base/logging.h"
 #include "base/memory/ref_counted.h"
+#include "base/memory/scoped_vector.h"
 #include "base/message_loop/message_loop.h"
 #include "base/message_loop/message_loop_proxy_impl.h"
 #include "base/message_loop/message_loop_test.h"
@@ -923,6 +924,72 @@ TEST(MessageLoopTest, IsType) {
   EXPECT_FALSE(loop.IsType(MessageLoop::TYPE_DEFAULT));
 }
 
+namespace {
+
+// Switches MessageLoops created in its scope to the lock-free incoming queue.
+class ScopedLockFreeIncomingQueue {
+ public:
+  ScopedLockFreeIncomingQueue() {
+    MessageLoop::EnableLockFreeIncomingQueue(true);
+  }
+  ~ScopedLockFreeIncomingQueue() {
+    MessageLoop::EnableLockFreeIncomingQueue(false);
+  }
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(ScopedLockFreeIncomingQueue);
+};
+
+void RecordPostOrder(std::vector<int>* order, int index) {
+  order->push_back(index);
+}
+
+void PostOrderedTasks(MessageLoop* target, std::vector<int>* order,
+                      int num_tasks) {
+  for (int i = 0; i < num_tasks; ++i)
+    target->PostTask(FROM_HERE, Bind(&RecordPostOrder, order, i));
+}
+
+}  // namespace
+
+TEST(MessageLoopTest, LockFreeIncomingQueue) {
+  ScopedLockFreeIncomingQueue lock_free;
+  test::RunTest_PostTask(&TypeDefaultMessagePumpFactory);
+  test::RunTest_PostDelayedTask_InPostOrder(&TypeDefaultMessagePumpFactory);
+  test::RunTest_PostDelayedTask_InPostOrder_2(&TypeIOMessagePumpFactory);
+  test::RunTest_EnsureDeletion(&TypeIOMessagePumpFactory);
+  test::RunTest_NonNestableInNestedLoop(&TypeUIMessagePumpFactory, true);
+}
+
+// Every posting thread must see its own tasks run in the order it posted
+// them, however the posts from different threads interleave.
+TEST(MessageLoopTest, LockFreeIncomingQueueManyProducers) {
+  ScopedLockFreeIncomingQueue lock_free;
+  MessageLoop loop;
+
+  const int kNumThreads = 8;
+  const int kTasksPerThread = 1000;
+  std::vector<int> orders[kNumThreads];
+  ScopedVector<Thread> threads;
+  for (int i = 0; i < kNumThreads; ++i) {
+    threads.push_back(new Thread("producer"));
+    ASSERT_TRUE(threads[i]->Start());
+    threads[i]->message_loop()->PostTask(
+        FROM_HERE,
+        Bind(&PostOrderedTasks, &loop, &orders[i], kTasksPerThread));
+  }
+  for (int i = 0; i < kNumThreads; ++i)
+    threads[i]->Stop();
+
+  RunLoop().RunUntilIdle();
+
+  for (int i = 0; i < kNumThreads; ++i) {
+    ASSERT_EQ(static_cast<size_t>(kTasksPerThread), orders[i].size());
+    for (int j = 0; j < kTasksPerThread; ++j)
+      EXPECT_EQ(j, orders[i][j]);
+  }
+}
+
 #if defined(OS_WIN)
 void EmptyFunction() {}
 
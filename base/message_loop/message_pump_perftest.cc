@@ -241,12 +241,14 @@ class FakeMessagePump : public MessagePump {
 
 class PostTaskTest : public testing::Test {
  public:
-  void Run(int batch_size, int tasks_per_reload) {
+  void Run(int batch_size,
+           int tasks_per_reload,
+           internal::IncomingTaskQueue::QueueMode mode) {
     base::TimeTicks start = base::TimeTicks::HighResNow();
     base::TimeTicks now;
     MessageLoop loop(scoped_ptr<MessagePump>(new FakeMessagePump));
     scoped_refptr<internal::IncomingTaskQueue> queue(
-        new internal::IncomingTaskQueue(&loop));
+        new internal::IncomingTaskQueue(&loop, mode));
     uint32_t num_posted = 0;
     do {
       for (int i = 0; i < batch_size; ++i) {
@@ -266,7 +268,11 @@ class PostTaskTest : public testing::Test {
 
       now = base::TimeTicks::HighResNow();
     } while (now - start < base::TimeDelta::FromSeconds(5));
-    std::string trace = StringPrintf("%d_tasks_per_reload", tasks_per_reload);
+    std::string trace = StringPrintf(
+        "%d_tasks_per_reload%s",
+        tasks_per_reload,
+        mode == internal::IncomingTaskQueue::LOCK_FREE_QUEUE ? "_lock_free"
+                                                             : "");
     perf_test::PrintResult(
         "task",
         "",
@@ -278,15 +284,144 @@ class PostTaskTest : public testing::Test {
 };
 
 TEST_F(PostTaskTest, OneTaskPerReload) {
-  Run(10000, 1);
+  Run(10000, 1, internal::IncomingTaskQueue::LOCKED_QUEUE);
 }
 
 TEST_F(PostTaskTest, TenTasksPerReload) {
-  Run(10000, 10);
+  Run(10000, 10, internal::IncomingTaskQueue::LOCKED_QUEUE);
 }
 
 TEST_F(PostTaskTest, OneHundredTasksPerReload) {
-  Run(1000, 100);
+  Run(1000, 100, internal::IncomingTaskQueue::LOCKED_QUEUE);
+}
+
+TEST_F(PostTaskTest, OneTaskPerReloadLockFree) {
+  Run(10000, 1, internal::IncomingTaskQueue::LOCK_FREE_QUEUE);
+}
+
+TEST_F(PostTaskTest, TenTasksPerReloadLockFree) {
+  Run(10000, 10, internal::IncomingTaskQueue::LOCK_FREE_QUEUE);
+}
+
+TEST_F(PostTaskTest, OneHundredTasksPerReloadLockFree) {
+  Run(1000, 100, internal::IncomingTaskQueue::LOCK_FREE_QUEUE);
+}
+
+// Measures how fast several threads can post to a single queue while the
+// owning thread keeps draining it, i.e. the contention on the posting path.
+class ConcurrentPostTaskTest : public testing::Test {
+ public:
+  void PostTasks(internal::IncomingTaskQueue* queue,
+                 WaitableEvent* start_posting) {
+    start_posting->Wait();
+    for (int i = 0; i < kTasksPerThread; ++i) {
+      queue->AddToIncomingQueue(
+          FROM_HERE, base::Bind(&DoNothing), base::TimeDelta(), false);
+    }
+  }
+
+  void Run(int num_posting_threads,
+           internal::IncomingTaskQueue::QueueMode mode) {
+    MessageLoop loop(scoped_ptr<MessagePump>(new FakeMessagePump));
+    scoped_refptr<internal::IncomingTaskQueue> queue(
+        new internal::IncomingTaskQueue(&loop, mode));
+    WaitableEvent start_posting(true, false);
+
+    ScopedVector<Thread> posting_threads;
+    for (int i = 0; i < num_posting_threads; ++i) {
+      posting_threads.push_back(new Thread("posting thread"));
+      posting_threads[i]->Start();
+      posting_threads[i]->message_loop()->PostTask(
+          FROM_HERE,
+          base::Bind(&ConcurrentPostTaskTest::PostTasks,
+                     base::Unretained(this),
+                     queue,
+                     &start_posting));
+    }
+
+    const uint64_t num_tasks =
+        static_cast<uint64_t>(num_posting_threads) * kTasksPerThread;
+    uint64_t num_run = 0;
+    base::TimeTicks start = base::TimeTicks::HighResNow();
+    start_posting.Signal();
+    while (num_run < num_tasks) {
+      TaskQueue loop_local_queue;
+      queue->ReloadWorkQueue(&loop_local_queue);
+      while (!loop_local_queue.empty()) {
+        loop.RunTask(loop_local_queue.front());
+        loop_local_queue.pop();
+        num_run++;
+      }
+    }
+    base::TimeDelta elapsed = base::TimeTicks::HighResNow() - start;
+
+    for (int i = 0; i < num_posting_threads; ++i)
+      posting_threads[i]->Stop();
+    queue->WillDestroyCurrentMessageLoop();
+
+    std::string trace = StringPrintf(
+        "%d_posting_threads%s",
+        num_posting_threads,
+        mode == internal::IncomingTaskQueue::LOCK_FREE_QUEUE ? "_lock_free"
+                                                             : "");
+    perf_test::PrintResult("post_task",
+                           "",
+                           trace,
+                           num_tasks / elapsed.InSecondsF(),
+                           "tasks/s",
+                           true);
+  }
+
+ private:
+  static const int kTasksPerThread = 200000;
+};
+
+TEST_F(ConcurrentPostTaskTest, OneThread) {
+  Run(1, internal::IncomingTaskQueue::LOCKED_QUEUE);
+}
+
+TEST_F(ConcurrentPostTaskTest, TwoThreads) {
+  Run(2, internal::IncomingTaskQueue::LOCKED_QUEUE);
+}
+
+TEST_F(ConcurrentPostTaskTest, FourThreads) {
+  Run(4, internal::IncomingTaskQueue::LOCKED_QUEUE);
+}
+
+TEST_F(ConcurrentPostTaskTest, EightThreads) {
+  Run(8, internal::IncomingTaskQueue::LOCKED_QUEUE);
+}
+
+TEST_F(ConcurrentPostTaskTest, SixteenThreads) {
+  Run(16, internal::IncomingTaskQueue::LOCKED_QUEUE);
+}
+
+TEST_F(ConcurrentPostTaskTest, ThirtyTwoThreads) {
+  Run(32, internal::IncomingTaskQueue::LOCKED_QUEUE);
+}
+
+TEST_F(ConcurrentPostTaskTest, OneThreadLockFree) {
+  Run(1, internal::IncomingTaskQueue::LOCK_FREE_QUEUE);
+}
+
+TEST_F(ConcurrentPostTaskTest, TwoThreadsLockFree) {
+  Run(2, internal::IncomingTaskQueue::LOCK_FREE_QUEUE);
+}
+
+TEST_F(ConcurrentPostTaskTest, FourThreadsLockFree) {
+  Run(4, internal::IncomingTaskQueue::LOCK_FREE_QUEUE);
+}
+
+TEST_F(ConcurrentPostTaskTest, EightThreadsLockFree) {
+  Run(8, internal::IncomingTaskQueue::LOCK_FREE_QUEUE);
+}
+
+TEST_F(ConcurrentPostTaskTest, SixteenThreadsLockFree) {
+  Run(16, internal::IncomingTaskQueue::LOCK_FREE_QUEUE);
+}
+
+TEST_F(ConcurrentPostTaskTest, ThirtyTwoThreadsLockFree) {
+  Run(32, internal::IncomingTaskQueue::LOCK_FREE_QUEUE);
 }
 
 }  // namespace
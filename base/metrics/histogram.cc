@@ -17,8 +17,10 @@
 #include "base/compiler_specific.h"
 #include "base/debug/alias.h"
 #include "base/logging.h"
+#include "base/metrics/persistent_histogram_allocator.h"
 #include "base/metrics/sample_vector.h"
 #include "base/metrics/statistics_recorder.h"
+#include "base/metrics/thread_sharded_samples.h"
 #include "base/pickle.h"
 #include "base/strings/string_util.h"
 #include "base/strings/stringprintf.h"
@@ -76,6 +78,34 @@ bool ValidateRangeChecksum(const HistogramBase& histogram,
   return casted_histogram.bucket_ranges()->checksum() == range_checksum;
 }
 
+// Returns a histogram of |type| allocated by the global persistent histogram
+// allocator, or NULL if there is none or it is out of space. On success,
+// |ref| must be passed to FinalizePersistentHistogram() once the histogram
+// has been registered.
+HistogramBase* AllocatePersistentHistogram(
+    HistogramType type,
+    const string& name,
+    HistogramBase::Sample minimum,
+    HistogramBase::Sample maximum,
+    const BucketRanges* ranges,
+    int32 flags,
+    PersistentHistogramAllocator::Reference* ref) {
+  PersistentHistogramAllocator* allocator =
+      PersistentHistogramAllocator::GetGlobalAllocator();
+  if (!allocator)
+    return NULL;
+  return allocator->AllocateHistogram(type, name, minimum, maximum, ranges,
+                                      flags, ref).release();
+}
+
+void FinalizePersistentHistogram(PersistentHistogramAllocator::Reference ref,
+                                 bool registered) {
+  if (!ref)
+    return;
+  PersistentHistogramAllocator::GetGlobalAllocator()->FinalizeHistogram(
+      ref, registered);
+}
+
 }  // namespace
 
 typedef HistogramBase::Count Count;
@@ -101,12 +131,20 @@ HistogramBase* Histogram::FactoryGet(const string& name,
     const BucketRanges* registered_ranges =
         StatisticsRecorder::RegisterOrDeleteDuplicateRanges(ranges);
 
-    Histogram* tentative_histogram =
-        new Histogram(name, minimum, maximum, registered_ranges);
+    PersistentHistogramAllocator::Reference histogram_ref = 0;
+    HistogramBase* tentative_histogram = AllocatePersistentHistogram(
+        HISTOGRAM, name, minimum, maximum, registered_ranges, flags,
+        &histogram_ref);
+    if (!tentative_histogram) {
+      tentative_histogram =
+          new Histogram(name, minimum, maximum, registered_ranges);
+      tentative_histogram->SetFlags(flags);
+    }
 
-    tentative_histogram->SetFlags(flags);
     histogram =
         StatisticsRecorder::RegisterOrDeleteDuplicate(tentative_histogram);
+    FinalizePersistentHistogram(histogram_ref,
+                                histogram == tentative_histogram);
   }
 
   DCHECK_EQ(HISTOGRAM, histogram->GetHistogramType());
@@ -133,6 +171,18 @@ HistogramBase* Histogram::FactoryTimeGet(const string& name,
                     flags);
 }
 
+// static
+HistogramBase* Histogram::PersistentCreate(const string& name,
+                                           Sample minimum,
+                                           Sample maximum,
+                                           const BucketRanges* ranges,
+                                           HistogramBase::AtomicCount* counts,
+                                           size_t counts_size,
+                                           HistogramSamples::Metadata* meta) {
+  return new Histogram(name, minimum, maximum, ranges, counts, counts_size,
+                       meta);
+}
+
 // Calculate what range of values are held in each bucket.
 // We have to be careful that we don't pick a ratio between starting points in
 // consecutive buckets that is sooo small, that the integer bounds are the same
@@ -264,7 +314,10 @@ void Histogram::Add(int value) {
     value = kSampleType_MAX - 1;
   if (value < 0)
     value = 0;
-  samples_->Accumulate(value, 1);
+  if (flags() & kThreadShardedSamplesFlag)
+    GetShardedSamples()->Accumulate(value, 1);
+  else
+    samples_->Accumulate(value, 1);
 }
 
 scoped_ptr<HistogramSamples> Histogram::SnapshotSamples() const {
@@ -308,12 +361,30 @@ Histogram::Histogram(const string& name,
   : HistogramBase(name),
     bucket_ranges_(ranges),
     declared_min_(minimum),
-    declared_max_(maximum) {
+    declared_max_(maximum),
+    sharded_samples_(0) {
   if (ranges)
     samples_.reset(new SampleVector(ranges));
 }
 
+Histogram::Histogram(const string& name,
+                     Sample minimum,
+                     Sample maximum,
+                     const BucketRanges* ranges,
+                     HistogramBase::AtomicCount* counts,
+                     size_t counts_size,
+                     HistogramSamples::Metadata* meta)
+  : HistogramBase(name),
+    bucket_ranges_(ranges),
+    declared_min_(minimum),
+    declared_max_(maximum),
+    sharded_samples_(0) {
+  if (ranges)
+    samples_.reset(new SampleVector(ranges, counts, counts_size, meta));
+}
+
 Histogram::~Histogram() {
+  delete reinterpret_cast<ThreadShardedSamples*>(sharded_samples_);
 }
 
 bool Histogram::PrintEmptyBucket(size_t index) const {
@@ -369,9 +440,32 @@ HistogramBase* Histogram::DeserializeInfoImpl(PickleIterator* iter) {
 scoped_ptr<SampleVector> Histogram::SnapshotSampleVector() const {
   scoped_ptr<SampleVector> samples(new SampleVector(bucket_ranges()));
   samples->Add(*samples_);
+  const ThreadShardedSamples* sharded_samples =
+      reinterpret_cast<const ThreadShardedSamples*>(
+          subtle::Acquire_Load(&sharded_samples_));
+  if (sharded_samples)
+    sharded_samples->AddTo(samples.get());
   return samples;
 }
 
+ThreadShardedSamples* Histogram::GetShardedSamples() {
+  ThreadShardedSamples* sharded_samples =
+      reinterpret_cast<ThreadShardedSamples*>(
+          subtle::Acquire_Load(&sharded_samples_));
+  if (sharded_samples)
+    return sharded_samples;
+
+  sharded_samples = new ThreadShardedSamples(bucket_ranges());
+  subtle::AtomicWord previous = subtle::Release_CompareAndSwap(
+      &sharded_samples_, 0,
+      reinterpret_cast<subtle::AtomicWord>(sharded_samples));
+  if (previous) {
+    delete sharded_samples;
+    return reinterpret_cast<ThreadShardedSamples*>(previous);
+  }
+  return sharded_samples;
+}
+
 void Histogram::WriteAsciiImpl(bool graph_it,
                                const string& newline,
                                string* output) const {
@@ -553,8 +647,15 @@ HistogramBase* LinearHistogram::FactoryGetWithRangeDescription(
     const BucketRanges* registered_ranges =
         StatisticsRecorder::RegisterOrDeleteDuplicateRanges(ranges);
 
-    LinearHistogram* tentative_histogram =
-        new LinearHistogram(name, minimum, maximum, registered_ranges);
+    PersistentHistogramAllocator::Reference histogram_ref = 0;
+    LinearHistogram* tentative_histogram = static_cast<LinearHistogram*>(
+        AllocatePersistentHistogram(LINEAR_HISTOGRAM, name, minimum, maximum,
+                                    registered_ranges, flags, &histogram_ref));
+    if (!tentative_histogram) {
+      tentative_histogram =
+          new LinearHistogram(name, minimum, maximum, registered_ranges);
+      tentative_histogram->SetFlags(flags);
+    }
 
     // Set range descriptions.
     if (descriptions) {
@@ -564,9 +665,10 @@ HistogramBase* LinearHistogram::FactoryGetWithRangeDescription(
       }
     }
 
-    tentative_histogram->SetFlags(flags);
     histogram =
         StatisticsRecorder::RegisterOrDeleteDuplicate(tentative_histogram);
+    FinalizePersistentHistogram(histogram_ref,
+                                histogram == tentative_histogram);
   }
 
   DCHECK_EQ(LINEAR_HISTOGRAM, histogram->GetHistogramType());
@@ -583,6 +685,19 @@ HistogramBase* LinearHistogram::FactoryGetWithRangeDescription(
   return histogram;
 }
 
+// static
+HistogramBase* LinearHistogram::PersistentCreate(
+    const string& name,
+    Sample minimum,
+    Sample maximum,
+    const BucketRanges* ranges,
+    HistogramBase::AtomicCount* counts,
+    size_t counts_size,
+    HistogramSamples::Metadata* meta) {
+  return new LinearHistogram(name, minimum, maximum, ranges, counts,
+                             counts_size, meta);
+}
+
 HistogramType LinearHistogram::GetHistogramType() const {
   return LINEAR_HISTOGRAM;
 }
@@ -594,6 +709,16 @@ LinearHistogram::LinearHistogram(const string& name,
     : Histogram(name, minimum, maximum, ranges) {
 }
 
+LinearHistogram::LinearHistogram(const string& name,
+                                 Sample minimum,
+                                 Sample maximum,
+                                 const BucketRanges* ranges,
+                                 HistogramBase::AtomicCount* counts,
+                                 size_t counts_size,
+                                 HistogramSamples::Metadata* meta)
+    : Histogram(name, minimum, maximum, ranges, counts, counts_size, meta) {
+}
+
 double LinearHistogram::GetBucketSize(Count current, size_t i) const {
   DCHECK_GT(ranges(i + 1), ranges(i));
   // Adjacent buckets with different widths would have "surprisingly" many (few)
@@ -666,18 +791,35 @@ HistogramBase* BooleanHistogram::FactoryGet(const string& name, int32 flags) {
     const BucketRanges* registered_ranges =
         StatisticsRecorder::RegisterOrDeleteDuplicateRanges(ranges);
 
-    BooleanHistogram* tentative_histogram =
-        new BooleanHistogram(name, registered_ranges);
+    PersistentHistogramAllocator::Reference histogram_ref = 0;
+    HistogramBase* tentative_histogram = AllocatePersistentHistogram(
+        BOOLEAN_HISTOGRAM, name, 1, 2, registered_ranges, flags,
+        &histogram_ref);
+    if (!tentative_histogram) {
+      tentative_histogram = new BooleanHistogram(name, registered_ranges);
+      tentative_histogram->SetFlags(flags);
+    }
 
-    tentative_histogram->SetFlags(flags);
     histogram =
         StatisticsRecorder::RegisterOrDeleteDuplicate(tentative_histogram);
+    FinalizePersistentHistogram(histogram_ref,
+                                histogram == tentative_histogram);
   }
 
   DCHECK_EQ(BOOLEAN_HISTOGRAM, histogram->GetHistogramType());
   return histogram;
 }
 
+// static
+HistogramBase* BooleanHistogram::PersistentCreate(
+    const string& name,
+    const BucketRanges* ranges,
+    HistogramBase::AtomicCount* counts,
+    size_t counts_size,
+    HistogramSamples::Metadata* meta) {
+  return new BooleanHistogram(name, ranges, counts, counts_size, meta);
+}
+
 HistogramType BooleanHistogram::GetHistogramType() const {
   return BOOLEAN_HISTOGRAM;
 }
@@ -686,6 +828,13 @@ BooleanHistogram::BooleanHistogram(const string& name,
                                    const BucketRanges* ranges)
     : LinearHistogram(name, 1, 2, ranges) {}
 
+BooleanHistogram::BooleanHistogram(const string& name,
+                                   const BucketRanges* ranges,
+                                   HistogramBase::AtomicCount* counts,
+                                   size_t counts_size,
+                                   HistogramSamples::Metadata* meta)
+    : LinearHistogram(name, 1, 2, ranges, counts, counts_size, meta) {}
+
 HistogramBase* BooleanHistogram::DeserializeInfoImpl(PickleIterator* iter) {
   string histogram_name;
   int flags;
@@ -724,19 +873,36 @@ HistogramBase* CustomHistogram::FactoryGet(const string& name,
         StatisticsRecorder::RegisterOrDeleteDuplicateRanges(ranges);
 
     // To avoid racy destruction at shutdown, the following will be leaked.
-    CustomHistogram* tentative_histogram =
-        new CustomHistogram(name, registered_ranges);
-
-    tentative_histogram->SetFlags(flags);
+    PersistentHistogramAllocator::Reference histogram_ref = 0;
+    HistogramBase* tentative_histogram = AllocatePersistentHistogram(
+        CUSTOM_HISTOGRAM, name, registered_ranges->range(1),
+        registered_ranges->range(registered_ranges->bucket_count() - 1),
+        registered_ranges, flags, &histogram_ref);
+    if (!tentative_histogram) {
+      tentative_histogram = new CustomHistogram(name, registered_ranges);
+      tentative_histogram->SetFlags(flags);
+    }
 
     histogram =
         StatisticsRecorder::RegisterOrDeleteDuplicate(tentative_histogram);
+    FinalizePersistentHistogram(histogram_ref,
+                                histogram == tentative_histogram);
   }
 
   DCHECK_EQ(histogram->GetHistogramType(), CUSTOM_HISTOGRAM);
   return histogram;
 }
 
+// static
+HistogramBase* CustomHistogram::PersistentCreate(
+    const string& name,
+    const BucketRanges* ranges,
+    HistogramBase::AtomicCount* counts,
+    size_t counts_size,
+    HistogramSamples::Metadata* meta) {
+  return new CustomHistogram(name, ranges, counts, counts_size, meta);
+}
+
 HistogramType CustomHistogram::GetHistogramType() const {
   return CUSTOM_HISTOGRAM;
 }
@@ -763,6 +929,19 @@ CustomHistogram::CustomHistogram(const string& name,
                 ranges->range(ranges->bucket_count() - 1),
                 ranges) {}
 
+CustomHistogram::CustomHistogram(const string& name,
+                                 const BucketRanges* ranges,
+                                 HistogramBase::AtomicCount* counts,
+                                 size_t counts_size,
+                                 HistogramSamples::Metadata* meta)
+    : Histogram(name,
+                ranges->range(1),
+                ranges->range(ranges->bucket_count() - 1),
+                ranges,
+                counts,
+                counts_size,
+                meta) {}
+
 bool CustomHistogram::SerializeInfoImpl(Pickle* pickle) const {
   if (!Histogram::SerializeInfoImpl(pickle))
     return false;
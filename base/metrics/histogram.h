@@ -70,6 +70,7 @@
 #include <string>
 #include <vector>
 
+#include "base/atomicops.h"
 #include "base/base_export.h"
 #include "base/basictypes.h"
 #include "base/compiler_specific.h"
@@ -93,6 +94,7 @@ class CustomHistogram;
 class Histogram;
 class LinearHistogram;
 class SampleVector;
+class ThreadShardedSamples;
 
 class BASE_EXPORT Histogram : public HistogramBase {
  public:
@@ -122,6 +124,18 @@ class BASE_EXPORT Histogram : public HistogramBase {
                                        size_t bucket_count,
                                        int32 flags);
 
+  // Creates a histogram that keeps its samples in |counts|, which has one
+  // element per bucket, and |meta|, both of which are in persistent memory
+  // and must outlive the histogram. The histogram is not registered with the
+  // StatisticsRecorder. Used by PersistentHistogramAllocator.
+  static HistogramBase* PersistentCreate(const std::string& name,
+                                         Sample minimum,
+                                         Sample maximum,
+                                         const BucketRanges* ranges,
+                                         HistogramBase::AtomicCount* counts,
+                                         size_t counts_size,
+                                         HistogramSamples::Metadata* meta);
+
   static void InitializeBucketRanges(Sample minimum,
                                      Sample maximum,
                                      BucketRanges* ranges);
@@ -182,6 +196,15 @@ class BASE_EXPORT Histogram : public HistogramBase {
             Sample maximum,
             const BucketRanges* ranges);
 
+  // Keeps the samples in |counts| and |meta|; see PersistentCreate().
+  Histogram(const std::string& name,
+            Sample minimum,
+            Sample maximum,
+            const BucketRanges* ranges,
+            HistogramBase::AtomicCount* counts,
+            size_t counts_size,
+            HistogramSamples::Metadata* meta);
+
   ~Histogram() override;
 
   // HistogramBase implementation:
@@ -216,6 +239,9 @@ class BASE_EXPORT Histogram : public HistogramBase {
   // Implementation of SnapshotSamples function.
   scoped_ptr<SampleVector> SnapshotSampleVector() const;
 
+  // Returns |sharded_samples_|, creating it if necessary.
+  ThreadShardedSamples* GetShardedSamples();
+
   //----------------------------------------------------------------------------
   // Helpers for emitting Ascii graphic.  Each method appends data to output.
 
@@ -254,6 +280,10 @@ class BASE_EXPORT Histogram : public HistogramBase {
   // sample.
   scoped_ptr<SampleVector> samples_;
 
+  // With kThreadShardedSamplesFlag, the samples recorded by Add(), as a
+  // ThreadShardedSamples pointer. Created on first use.
+  subtle::AtomicWord sharded_samples_;
+
   DISALLOW_COPY_AND_ASSIGN(Histogram);
 };
 
@@ -300,6 +330,15 @@ class BASE_EXPORT LinearHistogram : public Histogram {
                                      Sample maximum,
                                      BucketRanges* ranges);
 
+  // See Histogram::PersistentCreate().
+  static HistogramBase* PersistentCreate(const std::string& name,
+                                         Sample minimum,
+                                         Sample maximum,
+                                         const BucketRanges* ranges,
+                                         HistogramBase::AtomicCount* counts,
+                                         size_t counts_size,
+                                         HistogramSamples::Metadata* meta);
+
   // Overridden from Histogram:
   HistogramType GetHistogramType() const override;
 
@@ -309,6 +348,14 @@ class BASE_EXPORT LinearHistogram : public Histogram {
                   Sample maximum,
                   const BucketRanges* ranges);
 
+  LinearHistogram(const std::string& name,
+                  Sample minimum,
+                  Sample maximum,
+                  const BucketRanges* ranges,
+                  HistogramBase::AtomicCount* counts,
+                  size_t counts_size,
+                  HistogramSamples::Metadata* meta);
+
   double GetBucketSize(Count current, size_t i) const override;
 
   // If we have a description for a bucket, then return that.  Otherwise
@@ -340,10 +387,22 @@ class BASE_EXPORT BooleanHistogram : public LinearHistogram {
  public:
   static HistogramBase* FactoryGet(const std::string& name, int32 flags);
 
+  // See Histogram::PersistentCreate().
+  static HistogramBase* PersistentCreate(const std::string& name,
+                                         const BucketRanges* ranges,
+                                         HistogramBase::AtomicCount* counts,
+                                         size_t counts_size,
+                                         HistogramSamples::Metadata* meta);
+
   HistogramType GetHistogramType() const override;
 
  private:
   BooleanHistogram(const std::string& name, const BucketRanges* ranges);
+  BooleanHistogram(const std::string& name,
+                   const BucketRanges* ranges,
+                   HistogramBase::AtomicCount* counts,
+                   size_t counts_size,
+                   HistogramSamples::Metadata* meta);
 
   friend BASE_EXPORT_PRIVATE HistogramBase* DeserializeHistogramInfo(
       PickleIterator* iter);
@@ -365,6 +424,13 @@ class BASE_EXPORT CustomHistogram : public Histogram {
                                    const std::vector<Sample>& custom_ranges,
                                    int32 flags);
 
+  // See Histogram::PersistentCreate().
+  static HistogramBase* PersistentCreate(const std::string& name,
+                                         const BucketRanges* ranges,
+                                         HistogramBase::AtomicCount* counts,
+                                         size_t counts_size,
+                                         HistogramSamples::Metadata* meta);
+
   // Overridden from Histogram:
   HistogramType GetHistogramType() const override;
 
@@ -380,6 +446,12 @@ class BASE_EXPORT CustomHistogram : public Histogram {
   CustomHistogram(const std::string& name,
                   const BucketRanges* ranges);
 
+  CustomHistogram(const std::string& name,
+                  const BucketRanges* ranges,
+                  HistogramBase::AtomicCount* counts,
+                  size_t counts_size,
+                  HistogramSamples::Metadata* meta);
+
   // HistogramBase implementation:
   bool SerializeInfoImpl(Pickle* pickle) const override;
 
@@ -75,6 +75,20 @@ class BASE_EXPORT HistogramBase {
     // the source histogram!).
     kIPCSerializationSourceFlag = 0x10,
 
+    // Only for Histogram and its sub classes: samples are accumulated in
+    // per-thread shards that are merged when the histogram is snapshotted.
+    // This avoids cache-line contention for histograms that are recorded into
+    // from several threads at high rates, at the cost of memory for up to
+    // ThreadShardedSamples::kNumShards copies of the buckets. Must be set
+    // before the first sample is recorded.
+    kThreadShardedSamplesFlag = 0x20,
+
+    // Indicates that the samples of the histogram are kept in persistent
+    // memory, such as memory shared with the browser process, by a
+    // PersistentHistogramAllocator. Such histograms are read in place rather
+    // than serialized over IPC. Set by the allocator, not by callers.
+    kIsPersistent = 0x40,
+
     // Only for Histogram and its sub classes: fancy bucket-naming support.
     kHexRangePrintingFlag = 0x8000,
   };
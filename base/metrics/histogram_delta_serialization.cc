@@ -86,6 +86,10 @@ void HistogramDeltaSerialization::RecordDelta(
     const HistogramSamples& snapshot) {
   DCHECK_NE(0, snapshot.TotalCount());
 
+  // Persistent histograms are read directly by the receiving process.
+  if (histogram.flags() & HistogramBase::kIsPersistent)
+    return;
+
   Pickle pickle;
   histogram.SerializeInfo(&pickle);
   snapshot.Serialize(&pickle);
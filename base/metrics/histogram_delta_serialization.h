@@ -28,7 +28,8 @@ class BASE_EXPORT HistogramDeltaSerialization : public HistogramFlattener {
   // Computes deltas in histogram bucket counts relative to the previous call to
   // this method. Stores the deltas in serialized form into |serialized_deltas|.
   // If |serialized_deltas| is NULL, no data is serialized, though the next call
-  // will compute the deltas relative to this one.
+  // will compute the deltas relative to this one. Histograms with the
+  // kIsPersistent flag are skipped, as they are read in place.
   void PrepareAndSerializeDeltas(std::vector<std::string>* serialized_deltas);
 
   // Deserialize deltas and add samples to corresponding histograms, creating
@@ -10,11 +10,14 @@
 
 #include "base/logging.h"
 #include "base/memory/scoped_ptr.h"
+#include "base/memory/scoped_vector.h"
 #include "base/metrics/bucket_ranges.h"
 #include "base/metrics/histogram.h"
 #include "base/metrics/sample_vector.h"
 #include "base/metrics/statistics_recorder.h"
+#include "base/metrics/thread_sharded_samples.h"
 #include "base/pickle.h"
+#include "base/threading/simple_thread.h"
 #include "base/time/time.h"
 #include "testing/gtest/include/gtest/gtest.h"
 
@@ -301,6 +304,52 @@ TEST_F(HistogramTest, BucketPlacementTest) {
     EXPECT_EQ(i + 1, samples->GetCountAtIndex(i));
 }
 
+namespace {
+
+class HistogramAddThread : public SimpleThread {
+ public:
+  HistogramAddThread(HistogramBase* histogram, int num_samples)
+      : SimpleThread("HistogramAddThread"),
+        histogram_(histogram),
+        num_samples_(num_samples) {}
+
+  void Run() override {
+    for (int i = 0; i < num_samples_; ++i)
+      histogram_->Add(i % 64);
+  }
+
+ private:
+  HistogramBase* histogram_;
+  const int num_samples_;
+
+  DISALLOW_COPY_AND_ASSIGN(HistogramAddThread);
+};
+
+}  // namespace
+
+// Samples recorded from more threads than there are shards all show up in
+// the snapshot.
+TEST_F(HistogramTest, ThreadShardedSamples) {
+  HistogramBase* histogram = LinearHistogram::FactoryGet(
+      "ShardedHistogram", 1, 64, 65, HistogramBase::kThreadShardedSamplesFlag);
+  histogram->Add(1);
+
+  const int kNumThreads = static_cast<int>(ThreadShardedSamples::kNumShards);
+  const int kNumSamples = 64 * 100;
+  ScopedVector<HistogramAddThread> threads;
+  for (int i = 0; i < kNumThreads; ++i) {
+    threads.push_back(new HistogramAddThread(histogram, kNumSamples));
+    threads.back()->Start();
+  }
+  for (int i = 0; i < kNumThreads; ++i)
+    threads[i]->Join();
+
+  scoped_ptr<HistogramSamples> samples = histogram->SnapshotSamples();
+  EXPECT_EQ(kNumThreads * kNumSamples + 1, samples->TotalCount());
+  EXPECT_EQ(kNumThreads * 100 + 1, samples->GetCount(1));
+  EXPECT_EQ(kNumThreads * 100, samples->GetCount(63));
+}
+
 TEST_F(HistogramTest, CorruptSampleCounts) {
   Histogram* histogram = static_cast<Histogram*>(
       Histogram::FactoryGet("Histogram", 1, 64, 8, HistogramBase::kNoFlags));
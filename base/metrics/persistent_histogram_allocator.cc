@@ -0,0 +1,373 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/metrics/persistent_histogram_allocator.h"
+
+#include <stddef.h>
+#include <string.h>
+
+#include <vector>
+
+#include "base/atomicops.h"
+#include "base/logging.h"
+#include "base/memory/shared_memory.h"
+#include "base/metrics/bucket_ranges.h"
+#include "base/metrics/histogram.h"
+#include "base/metrics/sample_vector.h"
+#include "base/metrics/statistics_recorder.h"
+
+namespace base {
+
+namespace {
+
+// Type ids of the persistent allocations. The version in the low bits must
+// be changed whenever the layout of the data changes.
+const uint32 kTypeIdHistogram = 0xF1645390 + 1;
+const uint32 kTypeIdRangesArray = 0xBCEA225A + 1;
+const uint32 kTypeIdCountsArray = 0x53215530 + 1;
+
+// The global allocator, as a PersistentHistogramAllocator pointer.
+subtle::AtomicWord g_allocator = 0;
+
+// Flags that only make sense in the recording process.
+const int32 kLocalOnlyFlags = HistogramBase::kIsPersistent |
+                              HistogramBase::kIPCSerializationSourceFlag |
+                              HistogramBase::kThreadShardedSamplesFlag;
+
+HistogramBase* CreateHistogram(HistogramType type,
+                               const std::string& name,
+                               HistogramBase::Sample minimum,
+                               HistogramBase::Sample maximum,
+                               const BucketRanges* ranges,
+                               HistogramBase::AtomicCount* counts,
+                               HistogramSamples::Metadata* meta) {
+  size_t counts_size = ranges->bucket_count();
+  switch (type) {
+    case HISTOGRAM:
+      return Histogram::PersistentCreate(name, minimum, maximum, ranges,
+                                         counts, counts_size, meta);
+    case LINEAR_HISTOGRAM:
+      return LinearHistogram::PersistentCreate(name, minimum, maximum, ranges,
+                                               counts, counts_size, meta);
+    case BOOLEAN_HISTOGRAM:
+      return BooleanHistogram::PersistentCreate(name, ranges, counts,
+                                                counts_size, meta);
+    case CUSTOM_HISTOGRAM:
+      return CustomHistogram::PersistentCreate(name, ranges, counts,
+                                               counts_size, meta);
+    default:
+      return NULL;
+  }
+}
+
+// Returns the StatisticsRecorder histogram matching |histogram|, creating it
+// if necessary, or NULL if an incompatible histogram of the same name exists.
+HistogramBase* GetOrCreateStatisticsRecorderHistogram(
+    const Histogram& histogram) {
+  const std::string& name = histogram.histogram_name();
+  int32 flags = histogram.flags() & ~kLocalOnlyFlags;
+  HistogramBase* recorder_histogram = NULL;
+  switch (histogram.GetHistogramType()) {
+    case HISTOGRAM:
+      recorder_histogram = Histogram::FactoryGet(
+          name, histogram.declared_min(), histogram.declared_max(),
+          histogram.bucket_count(), flags);
+      break;
+    case LINEAR_HISTOGRAM:
+      recorder_histogram = LinearHistogram::FactoryGet(
+          name, histogram.declared_min(), histogram.declared_max(),
+          histogram.bucket_count(), flags);
+      break;
+    case BOOLEAN_HISTOGRAM:
+      recorder_histogram = BooleanHistogram::FactoryGet(name, flags);
+      break;
+    case CUSTOM_HISTOGRAM: {
+      // The first and last ranges are always 0 and kSampleType_MAX.
+      std::vector<HistogramBase::Sample> custom_ranges;
+      for (size_t i = 1; i < histogram.bucket_count(); ++i)
+        custom_ranges.push_back(histogram.ranges(i));
+      recorder_histogram =
+          CustomHistogram::FactoryGet(name, custom_ranges, flags);
+      break;
+    }
+    default:
+      NOTREACHED();
+      return NULL;
+  }
+
+  if (!recorder_histogram ||
+      recorder_histogram->GetHistogramType() !=
+          histogram.GetHistogramType() ||
+      static_cast<Histogram*>(recorder_histogram)->bucket_ranges()->checksum() !=
+          histogram.bucket_ranges()->checksum()) {
+    return NULL;
+  }
+  return recorder_histogram;
+}
+
+}  // namespace
+
+// The persistent record of a histogram. The layout must not change without
+// changing |kTypeIdHistogram|, and must be the same for 32 and 64 bit builds.
+struct PersistentHistogramAllocator::PersistentHistogramData {
+  int32 histogram_type;
+  int32 flags;
+  int32 minimum;
+  int32 maximum;
+  uint32 bucket_count;
+  Reference ranges_ref;
+  uint32 ranges_checksum;
+  // Twice |bucket_count| counts: the samples, followed by the samples that a
+  // reader has already merged.
+  Reference counts_ref;
+  HistogramSamples::Metadata samples_metadata;
+  HistogramSamples::Metadata logged_metadata;
+
+  // The name, which is stored in the rest of the allocation. This must be
+  // the last field.
+  char name[1];
+};
+
+// A histogram found by MergeHistogramDeltasToStatisticsRecorder().
+struct PersistentHistogramAllocator::MergeEntry {
+  scoped_ptr<HistogramBase> histogram;
+  scoped_ptr<HistogramSamples> logged_samples;
+  // The StatisticsRecorder histogram that the samples are merged into, or
+  // NULL if there is none.
+  HistogramBase* recorder_histogram;
+};
+
+PersistentHistogramAllocator::PersistentHistogramAllocator(
+    scoped_ptr<PersistentMemoryAllocator> memory)
+    : memory_(memory.Pass()) {
+  memory_->CreateIterator(&merge_iter_);
+}
+
+PersistentHistogramAllocator::~PersistentHistogramAllocator() {
+}
+
+scoped_ptr<HistogramBase> PersistentHistogramAllocator::AllocateHistogram(
+    HistogramType type,
+    const std::string& name,
+    HistogramBase::Sample minimum,
+    HistogramBase::Sample maximum,
+    const BucketRanges* bucket_ranges,
+    int32 flags,
+    Reference* ref) {
+  DCHECK(type == HISTOGRAM || type == LINEAR_HISTOGRAM ||
+         type == BOOLEAN_HISTOGRAM || type == CUSTOM_HISTOGRAM);
+  size_t bucket_count = bucket_ranges->bucket_count();
+
+  Reference ranges_ref = memory_->Allocate(
+      (bucket_count + 1) * sizeof(HistogramBase::Sample), kTypeIdRangesArray);
+  Reference counts_ref = memory_->Allocate(
+      2 * bucket_count * sizeof(HistogramBase::AtomicCount),
+      kTypeIdCountsArray);
+  Reference histogram_ref = memory_->Allocate(
+      offsetof(PersistentHistogramData, name) + name.length() + 1,
+      kTypeIdHistogram);
+  HistogramBase::Sample* ranges_data =
+      memory_->GetAsObject<HistogramBase::Sample>(ranges_ref,
+                                                  kTypeIdRangesArray);
+  HistogramBase::AtomicCount* counts_data =
+      memory_->GetAsObject<HistogramBase::AtomicCount>(counts_ref,
+                                                       kTypeIdCountsArray);
+  PersistentHistogramData* data =
+      memory_->GetAsObject<PersistentHistogramData>(histogram_ref,
+                                                    kTypeIdHistogram);
+  // Whatever was allocated before running out of space is lost, but the
+  // memory is full anyway.
+  if (!ranges_data || !counts_data || !data)
+    return scoped_ptr<HistogramBase>();
+
+  for (size_t i = 0; i <= bucket_count; ++i)
+    ranges_data[i] = bucket_ranges->range(i);
+
+  // Sharded samples would live on the heap.
+  flags = (flags | HistogramBase::kIsPersistent) &
+          ~HistogramBase::kThreadShardedSamplesFlag;
+
+  data->histogram_type = type;
+  data->flags = flags;
+  data->minimum = minimum;
+  data->maximum = maximum;
+  data->bucket_count = static_cast<uint32>(bucket_count);
+  data->ranges_ref = ranges_ref;
+  data->ranges_checksum = bucket_ranges->checksum();
+  data->counts_ref = counts_ref;
+  memcpy(data->name, name.data(), name.length());
+
+  scoped_ptr<HistogramBase> histogram(CreateHistogram(
+      type, name, minimum, maximum, bucket_ranges, counts_data,
+      &data->samples_metadata));
+  histogram->SetFlags(flags);
+  *ref = histogram_ref;
+  return histogram.Pass();
+}
+
+void PersistentHistogramAllocator::FinalizeHistogram(Reference ref,
+                                                     bool registered) {
+  if (registered)
+    memory_->MakeIterable(ref);
+}
+
+void PersistentHistogramAllocator::CreateIterator(Iterator* iter) const {
+  memory_->CreateIterator(iter);
+}
+
+scoped_ptr<HistogramBase> PersistentHistogramAllocator::GetNextHistogram(
+    Iterator* iter) {
+  uint32 type_id;
+  Reference ref;
+  while ((ref = memory_->GetNextIterable(iter, &type_id)) != 0) {
+    if (type_id == kTypeIdHistogram)
+      return GetHistogram(ref, NULL);
+  }
+  return scoped_ptr<HistogramBase>();
+}
+
+void PersistentHistogramAllocator::MergeHistogramDeltasToStatisticsRecorder() {
+  uint32 type_id;
+  Reference ref;
+  while ((ref = memory_->GetNextIterable(&merge_iter_, &type_id)) != 0) {
+    if (type_id != kTypeIdHistogram)
+      continue;
+    scoped_ptr<HistogramSamples> logged_samples;
+    scoped_ptr<HistogramBase> histogram = GetHistogram(ref, &logged_samples);
+    if (!histogram)
+      continue;
+    MergeEntry* entry = new MergeEntry;
+    entry->recorder_histogram = GetOrCreateStatisticsRecorderHistogram(
+        *static_cast<Histogram*>(histogram.get()));
+    entry->histogram = histogram.Pass();
+    entry->logged_samples = logged_samples.Pass();
+    merge_entries_.push_back(entry);
+  }
+
+  for (size_t i = 0; i < merge_entries_.size(); ++i) {
+    MergeEntry* entry = merge_entries_[i];
+    if (!entry->recorder_histogram)
+      continue;
+    scoped_ptr<HistogramSamples> delta = entry->histogram->SnapshotSamples();
+    delta->Subtract(*entry->logged_samples);
+    if (delta->redundant_count() == 0)
+      continue;
+    entry->logged_samples->Add(*delta);
+    entry->recorder_histogram->AddSamples(*delta);
+  }
+}
+
+// static
+void PersistentHistogramAllocator::CreateGlobalAllocatorOnSharedMemory(
+    scoped_ptr<SharedMemory> memory,
+    const std::string& name) {
+  if (!SharedPersistentMemoryAllocator::IsSharedMemoryAcceptable(*memory)) {
+    NOTREACHED();
+    return;
+  }
+  SetGlobalAllocator(make_scoped_ptr(new PersistentHistogramAllocator(
+      make_scoped_ptr(new SharedPersistentMemoryAllocator(
+          memory.Pass(), 0, name, false)))));
+}
+
+// static
+void PersistentHistogramAllocator::SetGlobalAllocator(
+    scoped_ptr<PersistentHistogramAllocator> allocator) {
+  CHECK(!subtle::NoBarrier_Load(&g_allocator));
+  subtle::Release_Store(&g_allocator,
+                        reinterpret_cast<subtle::AtomicWord>(
+                            allocator.release()));
+}
+
+// static
+PersistentHistogramAllocator*
+PersistentHistogramAllocator::GetGlobalAllocator() {
+  return reinterpret_cast<PersistentHistogramAllocator*>(
+      subtle::Acquire_Load(&g_allocator));
+}
+
+// static
+scoped_ptr<PersistentHistogramAllocator>
+PersistentHistogramAllocator::ReleaseGlobalAllocatorForTesting() {
+  PersistentHistogramAllocator* allocator = GetGlobalAllocator();
+  subtle::Release_Store(&g_allocator, 0);
+  return make_scoped_ptr(allocator);
+}
+
+scoped_ptr<HistogramBase> PersistentHistogramAllocator::GetHistogram(
+    Reference ref,
+    scoped_ptr<HistogramSamples>* logged_samples) {
+  // The memory may be written by another, possibly compromised, process, so
+  // everything is validated and copied before it is used.
+  PersistentHistogramData* data =
+      memory_->GetAsObject<PersistentHistogramData>(ref, kTypeIdHistogram);
+  if (!data)
+    return scoped_ptr<HistogramBase>();
+  size_t name_space =
+      memory_->GetAllocSize(ref) - offsetof(PersistentHistogramData, name);
+  // The name is read only once, bounded by the allocation, since the writer
+  // may remove its terminator at any time.
+  const char* name_end =
+      static_cast<const char*>(memchr(data->name, '\0', name_space));
+  if (!name_end)
+    return scoped_ptr<HistogramBase>();
+  const std::string name(data->name, name_end - data->name);
+  HistogramType type = static_cast<HistogramType>(data->histogram_type);
+  int32 flags = data->flags;
+  HistogramBase::Sample minimum = data->minimum;
+  HistogramBase::Sample maximum = data->maximum;
+  size_t bucket_count = data->bucket_count;
+  uint32 ranges_checksum = data->ranges_checksum;
+  Reference ranges_ref = data->ranges_ref;
+  Reference counts_ref = data->counts_ref;
+
+  if (bucket_count < 2 || bucket_count >= Histogram::kBucketCount_MAX)
+    return scoped_ptr<HistogramBase>();
+  const HistogramBase::Sample* ranges_data =
+      memory_->GetAsObject<HistogramBase::Sample>(ranges_ref,
+                                                  kTypeIdRangesArray);
+  HistogramBase::AtomicCount* counts_data =
+      memory_->GetAsObject<HistogramBase::AtomicCount>(counts_ref,
+                                                       kTypeIdCountsArray);
+  if (!ranges_data || !counts_data ||
+      memory_->GetAllocSize(ranges_ref) <
+          (bucket_count + 1) * sizeof(HistogramBase::Sample) ||
+      memory_->GetAllocSize(counts_ref) <
+          2 * bucket_count * sizeof(HistogramBase::AtomicCount)) {
+    return scoped_ptr<HistogramBase>();
+  }
+
+  scoped_ptr<BucketRanges> ranges(new BucketRanges(bucket_count + 1));
+  for (size_t i = 0; i <= bucket_count; ++i)
+    ranges->set_range(i, ranges_data[i]);
+  ranges->ResetChecksum();
+  if (ranges->checksum() != ranges_checksum ||
+      ranges->range(0) != 0 ||
+      ranges->range(bucket_count) != HistogramBase::kSampleType_MAX) {
+    return scoped_ptr<HistogramBase>();
+  }
+  for (size_t i = 1; i <= bucket_count; ++i) {
+    if (ranges->range(i - 1) >= ranges->range(i))
+      return scoped_ptr<HistogramBase>();
+  }
+  const BucketRanges* registered_ranges =
+      StatisticsRecorder::RegisterOrDeleteDuplicateRanges(ranges.release());
+
+  scoped_ptr<HistogramBase> histogram(CreateHistogram(
+      type, name, minimum, maximum, registered_ranges, counts_data,
+      &data->samples_metadata));
+  if (!histogram)
+    return scoped_ptr<HistogramBase>();
+  histogram->SetFlags(flags);
+
+  if (logged_samples) {
+    logged_samples->reset(new SampleVector(registered_ranges,
+                                           counts_data + bucket_count,
+                                           bucket_count,
+                                           &data->logged_metadata));
+  }
+  return histogram.Pass();
+}
+
+}  // namespace base
@@ -0,0 +1,108 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// PersistentHistogramAllocator creates histograms whose samples live in a
+// PersistentMemoryAllocator, typically one over memory shared with another
+// process. That process can then read the histograms in place, instead of
+// having their deltas serialized and sent to it, and still has their samples
+// if the recording process crashes.
+//
+// A process records into persistent histograms by installing a global
+// allocator with SetGlobalAllocator(); the Histogram factories then allocate
+// new histograms from it until it runs out of space. The reading process
+// creates its own PersistentHistogramAllocator over the same memory and calls
+// MergeHistogramDeltasToStatisticsRecorder() to fold what was recorded since
+// the last call into its own histograms.
+
+#ifndef BASE_METRICS_PERSISTENT_HISTOGRAM_ALLOCATOR_H_
+#define BASE_METRICS_PERSISTENT_HISTOGRAM_ALLOCATOR_H_
+
+#include <string>
+
+#include "base/base_export.h"
+#include "base/basictypes.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/memory/scoped_vector.h"
+#include "base/metrics/histogram_base.h"
+#include "base/metrics/persistent_memory_allocator.h"
+
+namespace base {
+
+class BucketRanges;
+class HistogramSamples;
+class SharedMemory;
+
+class BASE_EXPORT PersistentHistogramAllocator {
+ public:
+  typedef PersistentMemoryAllocator::Reference Reference;
+  typedef PersistentMemoryAllocator::Iterator Iterator;
+
+  explicit PersistentHistogramAllocator(
+      scoped_ptr<PersistentMemoryAllocator> memory);
+  ~PersistentHistogramAllocator();
+
+  PersistentMemoryAllocator* memory_allocator() { return memory_.get(); }
+
+  // Creates a histogram of |type|, which must be one of the Histogram based
+  // types, with its ranges and samples in persistent memory. Returns NULL if
+  // there isn't enough space. The histogram isn't visible to readers until
+  // FinalizeHistogram() is called with |ref|.
+  scoped_ptr<HistogramBase> AllocateHistogram(HistogramType type,
+                                              const std::string& name,
+                                              HistogramBase::Sample minimum,
+                                              HistogramBase::Sample maximum,
+                                              const BucketRanges* bucket_ranges,
+                                              int32 flags,
+                                              Reference* ref);
+
+  // Makes the histogram at |ref| visible to readers if it was |registered|
+  // with the StatisticsRecorder. A histogram that lost the registration race
+  // to a duplicate is left unreachable; its memory isn't reused.
+  void FinalizeHistogram(Reference ref, bool registered);
+
+  // Iterates over the histograms in the memory. The returned histograms use
+  // the samples in persistent memory and aren't registered with the
+  // StatisticsRecorder.
+  void CreateIterator(Iterator* iter) const;
+  scoped_ptr<HistogramBase> GetNextHistogram(Iterator* iter);
+
+  // Adds the samples recorded in the memory since the previous call to the
+  // StatisticsRecorder histograms of the same names, creating them if
+  // necessary. What has been merged is tracked in the persistent memory
+  // itself, so the memory must be writable.
+  void MergeHistogramDeltasToStatisticsRecorder();
+
+  // Creates a global allocator over |memory|, which must be mapped.
+  static void CreateGlobalAllocatorOnSharedMemory(
+      scoped_ptr<SharedMemory> memory,
+      const std::string& name);
+
+  // Sets the allocator that the Histogram factories allocate from. It can
+  // only be set once and is never destroyed.
+  static void SetGlobalAllocator(
+      scoped_ptr<PersistentHistogramAllocator> allocator);
+  static PersistentHistogramAllocator* GetGlobalAllocator();
+  static scoped_ptr<PersistentHistogramAllocator>
+  ReleaseGlobalAllocatorForTesting();
+
+ private:
+  struct PersistentHistogramData;
+  struct MergeEntry;
+
+  // Returns a histogram for the validated data at |ref|, or NULL.
+  scoped_ptr<HistogramBase> GetHistogram(Reference ref,
+                                         scoped_ptr<HistogramSamples>* logged);
+
+  scoped_ptr<PersistentMemoryAllocator> memory_;
+
+  // State of MergeHistogramDeltasToStatisticsRecorder().
+  Iterator merge_iter_;
+  ScopedVector<MergeEntry> merge_entries_;
+
+  DISALLOW_COPY_AND_ASSIGN(PersistentHistogramAllocator);
+};
+
+}  // namespace base
+
+#endif  // BASE_METRICS_PERSISTENT_HISTOGRAM_ALLOCATOR_H_
@@ -0,0 +1,204 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/metrics/persistent_histogram_allocator.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "base/memory/scoped_ptr.h"
+#include "base/metrics/histogram.h"
+#include "base/metrics/histogram_delta_serialization.h"
+#include "base/metrics/histogram_samples.h"
+#include "base/metrics/persistent_memory_allocator.h"
+#include "base/metrics/statistics_recorder.h"
+#include "base/strings/stringprintf.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+
+class PersistentHistogramAllocatorTest : public testing::Test {
+ protected:
+  static const size_t kMemorySize = 1 << 16;
+
+  PersistentHistogramAllocatorTest()
+      : memory_(new uint64[kMemorySize / sizeof(uint64)]()),
+        statistics_recorder_(NULL) {}
+
+  void SetUp() override {
+    statistics_recorder_ = new StatisticsRecorder();
+    PersistentHistogramAllocator::SetGlobalAllocator(
+        CreateAllocator(kMemorySize));
+  }
+
+  void TearDown() override {
+    PersistentHistogramAllocator::ReleaseGlobalAllocatorForTesting();
+    delete statistics_recorder_;
+  }
+
+  scoped_ptr<PersistentHistogramAllocator> CreateAllocator(size_t size) {
+    return make_scoped_ptr(new PersistentHistogramAllocator(
+        make_scoped_ptr(new PersistentMemoryAllocator(
+            memory_.get(), size, 0, 0, "HistogramTest", false))));
+  }
+
+  // Stops recording into the persistent memory and starts over with an empty
+  // StatisticsRecorder, as if in another process.
+  void SwitchToReaderProcess() {
+    PersistentHistogramAllocator::ReleaseGlobalAllocatorForTesting();
+    delete statistics_recorder_;
+    statistics_recorder_ = new StatisticsRecorder();
+  }
+
+  scoped_ptr<uint64[]> memory_;
+  StatisticsRecorder* statistics_recorder_;
+};
+
+TEST_F(PersistentHistogramAllocatorTest, CreateAndIterate) {
+  HistogramBase* histogram = Histogram::FactoryGet(
+      "TestHistogram", 1, 1000, 10, HistogramBase::kUmaTargetedHistogramFlag);
+  HistogramBase* linear_histogram = LinearHistogram::FactoryGet(
+      "TestLinearHistogram", 1, 100, 20, HistogramBase::kNoFlags);
+  HistogramBase* boolean_histogram =
+      BooleanHistogram::FactoryGet("TestBooleanHistogram",
+                                   HistogramBase::kNoFlags);
+  std::vector<HistogramBase::Sample> custom_ranges;
+  custom_ranges.push_back(1);
+  custom_ranges.push_back(5);
+  HistogramBase* custom_histogram = CustomHistogram::FactoryGet(
+      "TestCustomHistogram", custom_ranges, HistogramBase::kNoFlags);
+  ASSERT_TRUE(histogram && linear_histogram && boolean_histogram &&
+              custom_histogram);
+  EXPECT_TRUE(histogram->flags() & HistogramBase::kIsPersistent);
+  EXPECT_TRUE(histogram->flags() & HistogramBase::kUmaTargetedHistogramFlag);
+  EXPECT_TRUE(custom_histogram->flags() & HistogramBase::kIsPersistent);
+
+  // The factories still return the registered histograms.
+  EXPECT_EQ(histogram, Histogram::FactoryGet("TestHistogram", 1, 1000, 10,
+                                             HistogramBase::kNoFlags));
+
+  histogram->Add(5);
+  histogram->Add(500);
+  linear_histogram->Add(50);
+  boolean_histogram->AddBoolean(true);
+  custom_histogram->Add(3);
+
+  const char* const kNames[] = {"TestHistogram", "TestLinearHistogram",
+                                "TestBooleanHistogram", "TestCustomHistogram"};
+  PersistentHistogramAllocator* allocator =
+      PersistentHistogramAllocator::GetGlobalAllocator();
+  PersistentHistogramAllocator::Iterator iter;
+  allocator->CreateIterator(&iter);
+  for (size_t i = 0; i < arraysize(kNames); ++i) {
+    scoped_ptr<HistogramBase> found = allocator->GetNextHistogram(&iter);
+    ASSERT_TRUE(found);
+    EXPECT_EQ(kNames[i], found->histogram_name());
+    HistogramBase* registered = StatisticsRecorder::FindHistogram(kNames[i]);
+    EXPECT_EQ(registered->GetHistogramType(), found->GetHistogramType());
+    scoped_ptr<HistogramSamples> found_samples = found->SnapshotSamples();
+    scoped_ptr<HistogramSamples> registered_samples =
+        registered->SnapshotSamples();
+    EXPECT_EQ(registered_samples->TotalCount(), found_samples->TotalCount());
+    EXPECT_EQ(registered_samples->sum(), found_samples->sum());
+  }
+  EXPECT_FALSE(allocator->GetNextHistogram(&iter));
+}
+
+TEST_F(PersistentHistogramAllocatorTest, UnterminatedName) {
+  ASSERT_TRUE(Histogram::FactoryGet("TestHistogram", 1, 1000, 10,
+                                    HistogramBase::kNoFlags));
+  PersistentHistogramAllocator* allocator =
+      PersistentHistogramAllocator::GetGlobalAllocator();
+  PersistentMemoryAllocator* memory = allocator->memory_allocator();
+
+  // Overwrite the name and its terminator with the rest of the allocation.
+  PersistentMemoryAllocator::Iterator memory_iter;
+  memory->CreateIterator(&memory_iter);
+  uint32 type_id;
+  PersistentMemoryAllocator::Reference ref =
+      memory->GetNextIterable(&memory_iter, &type_id);
+  ASSERT_TRUE(ref);
+  char* data = memory->GetAsObject<char>(ref, type_id);
+  ASSERT_TRUE(data);
+  size_t size = memory->GetAllocSize(ref);
+  const std::string kName = "TestHistogram";
+  char* name = std::search(data, data + size, kName.begin(), kName.end());
+  ASSERT_NE(data + size, name);
+  memset(name, 'x', data + size - name);
+
+  PersistentHistogramAllocator::Iterator iter;
+  allocator->CreateIterator(&iter);
+  EXPECT_FALSE(allocator->GetNextHistogram(&iter));
+}
+
+TEST_F(PersistentHistogramAllocatorTest, MergeDeltas) {
+  HistogramBase* histogram =
+      Histogram::FactoryGet("TestHistogram", 1, 1000, 10,
+                            HistogramBase::kUmaTargetedHistogramFlag);
+  histogram->Add(5);
+  histogram->Add(500);
+
+  SwitchToReaderProcess();
+  scoped_ptr<PersistentHistogramAllocator> reader =
+      CreateAllocator(kMemorySize);
+  reader->MergeHistogramDeltasToStatisticsRecorder();
+
+  HistogramBase* merged = StatisticsRecorder::FindHistogram("TestHistogram");
+  ASSERT_TRUE(merged);
+  EXPECT_NE(histogram, merged);
+  EXPECT_FALSE(merged->flags() & HistogramBase::kIsPersistent);
+  EXPECT_TRUE(merged->flags() & HistogramBase::kUmaTargetedHistogramFlag);
+  scoped_ptr<HistogramSamples> samples = merged->SnapshotSamples();
+  EXPECT_EQ(2, samples->TotalCount());
+  EXPECT_EQ(505, samples->sum());
+
+  // Only what was recorded since the last merge is added.
+  histogram->Add(7);
+  reader->MergeHistogramDeltasToStatisticsRecorder();
+  reader->MergeHistogramDeltasToStatisticsRecorder();
+  samples = merged->SnapshotSamples();
+  EXPECT_EQ(3, samples->TotalCount());
+  EXPECT_EQ(512, samples->sum());
+}
+
+TEST_F(PersistentHistogramAllocatorTest, FallBackToHeapWhenFull) {
+  PersistentHistogramAllocator::ReleaseGlobalAllocatorForTesting();
+  memset(memory_.get(), 0, kMemorySize);
+  PersistentHistogramAllocator::SetGlobalAllocator(CreateAllocator(1 << 12));
+
+  HistogramBase* histogram = NULL;
+  for (int i = 0; i < 100; ++i) {
+    histogram = Histogram::FactoryGet(StringPrintf("TestHistogram%d", i), 1,
+                                      1000, 50, HistogramBase::kNoFlags);
+    ASSERT_TRUE(histogram);
+    histogram->Add(i);
+  }
+  EXPECT_TRUE(PersistentHistogramAllocator::GetGlobalAllocator()
+                  ->memory_allocator()
+                  ->IsFull());
+  EXPECT_FALSE(histogram->flags() & HistogramBase::kIsPersistent);
+  EXPECT_TRUE(StatisticsRecorder::FindHistogram("TestHistogram0")->flags() &
+              HistogramBase::kIsPersistent);
+  EXPECT_EQ(1, histogram->SnapshotSamples()->TotalCount());
+}
+
+TEST_F(PersistentHistogramAllocatorTest, DeltaSerializationSkipsPersistent) {
+  HistogramBase* persistent_histogram = Histogram::FactoryGet(
+      "PersistentHistogram", 1, 1000, 10, HistogramBase::kNoFlags);
+  PersistentHistogramAllocator::ReleaseGlobalAllocatorForTesting();
+  HistogramBase* heap_histogram = Histogram::FactoryGet(
+      "HeapHistogram", 1, 1000, 10, HistogramBase::kNoFlags);
+  persistent_histogram->Add(1);
+  heap_histogram->Add(1);
+
+  HistogramDeltaSerialization serializer("PersistentTest");
+  std::vector<std::string> deltas;
+  serializer.PrepareAndSerializeDeltas(&deltas);
+  EXPECT_EQ(1u, deltas.size());
+}
+
+}  // namespace base
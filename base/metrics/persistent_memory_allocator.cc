@@ -0,0 +1,440 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/metrics/persistent_memory_allocator.h"
+
+#include <string.h>
+
+#include <algorithm>
+
+#include "base/logging.h"
+#include "base/memory/shared_memory.h"
+
+namespace {
+
+// Version of the layout of the memory block; a different version is treated
+// as corruption.
+const uint32 kGlobalVersion = 1;
+
+// Marks an initialized memory block.
+const uint32 kGlobalCookie = 0x408305DC;
+
+// Marks the head of the iteration queue and completed allocations.
+const uint32 kBlockCookieQueue = 1;
+const uint32 kBlockCookieAllocated = 0xC8799269;
+
+// Type id of the block holding the name of the allocator.
+const uint32 kTypeIdName = 0x4E414D45;
+
+// All allocations and the segment itself are aligned to this.
+const uint32 kAllocAlignment = 8;
+
+// Limits of the size of the memory block.
+const uint32 kSegmentMinSize = 1 << 10;
+const uint32 kSegmentMaxSize = 1 << 30;
+
+// Bits of SharedMetadata::flags.
+const uint32 kFlagCorrupt = 1 << 0;
+const uint32 kFlagFull = 1 << 1;
+
+}  // namespace
+
+namespace base {
+
+// The header of every allocation. |next| is 0 until the block is made
+// iterable; the last block of the iteration queue links back to the queue
+// head.
+struct PersistentMemoryAllocator::BlockHeader {
+  uint32 size;
+  uint32 cookie;
+  uint32 type_id;
+  subtle::Atomic32 next;
+};
+
+// The header of the memory block. The layout must not change without
+// changing |kGlobalVersion|, and must be the same for 32 and 64 bit builds.
+struct PersistentMemoryAllocator::SharedMetadata {
+  uint32 cookie;
+  uint32 size;
+  uint32 page_size;
+  uint32 version;
+  uint64 id;
+  Reference name;
+  uint32 padding1;
+  subtle::Atomic32 freeptr;  // Offset of the first unallocated byte.
+  subtle::Atomic32 flags;
+  subtle::Atomic32 tailptr;  // Last block of the iteration queue.
+  uint32 padding2;
+  BlockHeader queue;  // Head of the iteration queue; not a real allocation.
+};
+
+// static
+const PersistentMemoryAllocator::Reference
+    PersistentMemoryAllocator::kReferenceQueue =
+        offsetof(SharedMetadata, queue);
+
+PersistentMemoryAllocator::PersistentMemoryAllocator(void* base,
+                                                     size_t size,
+                                                     size_t page_size,
+                                                     uint64 id,
+                                                     const std::string& name,
+                                                     bool readonly)
+    : mem_base_(static_cast<char*>(base)),
+      mem_size_(static_cast<uint32>(size)),
+      mem_page_(static_cast<uint32>(page_size ? page_size : size)),
+      readonly_(readonly),
+      corrupt_(false) {
+  COMPILE_ASSERT(sizeof(BlockHeader) % kAllocAlignment == 0,
+                 block_header_must_be_aligned);
+  COMPILE_ASSERT(sizeof(SharedMetadata) % kAllocAlignment == 0,
+                 shared_metadata_must_be_aligned);
+  CHECK(IsMemoryAcceptable(base, size, page_size, readonly));
+
+  SharedMetadata* meta = shared_meta();
+  if (meta->cookie != kGlobalCookie) {
+    if (readonly) {
+      corrupt_ = true;
+      return;
+    }
+
+    // A new block of memory must be all zeros, at least where the header
+    // goes.
+    const char* header = reinterpret_cast<const char*>(meta);
+    if (std::count(header, header + sizeof(SharedMetadata), 0) !=
+        static_cast<ptrdiff_t>(sizeof(SharedMetadata))) {
+      SetCorrupt();
+      return;
+    }
+
+    meta->size = mem_size_;
+    meta->page_size = mem_page_;
+    meta->version = kGlobalVersion;
+    meta->id = id;
+    meta->freeptr = sizeof(SharedMetadata);
+    meta->tailptr = kReferenceQueue;
+    meta->queue.size = sizeof(BlockHeader);
+    meta->queue.cookie = kBlockCookieQueue;
+    meta->queue.next = kReferenceQueue;
+    meta->cookie = kGlobalCookie;
+
+    if (!name.empty()) {
+      Reference name_ref = Allocate(name.length() + 1, kTypeIdName);
+      char* name_data = GetAsObject<char>(name_ref, kTypeIdName);
+      if (name_data) {
+        memcpy(name_data, name.data(), name.length());
+        meta->name = name_ref;
+      }
+    }
+  } else if (meta->size != mem_size_ || meta->page_size != mem_page_ ||
+             meta->version != kGlobalVersion ||
+             meta->queue.cookie != kBlockCookieQueue ||
+             meta->queue.size != sizeof(BlockHeader)) {
+    SetCorrupt();
+  }
+}
+
+PersistentMemoryAllocator::~PersistentMemoryAllocator() {
+}
+
+// static
+bool PersistentMemoryAllocator::IsMemoryAcceptable(const void* base,
+                                                   size_t size,
+                                                   size_t page_size,
+                                                   bool readonly) {
+  if (reinterpret_cast<uintptr_t>(base) % kAllocAlignment != 0)
+    return false;
+  if (size < kSegmentMinSize || size > kSegmentMaxSize ||
+      size % kAllocAlignment != 0) {
+    return false;
+  }
+  if (page_size != 0 &&
+      (page_size < kSegmentMinSize || page_size % kAllocAlignment != 0 ||
+       size % page_size != 0)) {
+    return false;
+  }
+  return true;
+}
+
+uint64 PersistentMemoryAllocator::Id() const {
+  return shared_meta()->id;
+}
+
+const char* PersistentMemoryAllocator::Name() const {
+  Reference name_ref = shared_meta()->name;
+  const char* name = GetAsObject<char>(name_ref, kTypeIdName);
+  if (!name)
+    return "";
+  // The name block comes from shared memory, so it may not be terminated.
+  size_t length = GetAllocSize(name_ref);
+  if (!memchr(name, '\0', length))
+    return "";
+  return name;
+}
+
+bool PersistentMemoryAllocator::IsCorrupt() const {
+  return corrupt_ || CheckFlag(kFlagCorrupt);
+}
+
+bool PersistentMemoryAllocator::IsFull() const {
+  return CheckFlag(kFlagFull);
+}
+
+size_t PersistentMemoryAllocator::used() const {
+  return std::min(static_cast<uint32>(subtle::Acquire_Load(
+                      &shared_meta()->freeptr)),
+                  mem_size_);
+}
+
+uint32 PersistentMemoryAllocator::GetType(Reference ref) const {
+  const BlockHeader* block = GetBlock(ref, 0, 0, false);
+  if (!block)
+    return 0;
+  return block->type_id;
+}
+
+size_t PersistentMemoryAllocator::GetAllocSize(Reference ref) const {
+  const BlockHeader* block = GetBlock(ref, 0, 0, false);
+  if (!block)
+    return 0;
+  return block->size - sizeof(BlockHeader);
+}
+
+PersistentMemoryAllocator::Reference PersistentMemoryAllocator::Allocate(
+    size_t req_size,
+    uint32 type_id) {
+  DCHECK_NE(0u, type_id);
+  DCHECK(!readonly_);
+  if (readonly_ || IsCorrupt())
+    return 0;
+  if (req_size > mem_page_ - sizeof(BlockHeader))
+    return 0;
+
+  uint32 size = static_cast<uint32>(req_size + sizeof(BlockHeader));
+  size = (size + kAllocAlignment - 1) & ~(kAllocAlignment - 1);
+  if (size > mem_page_)
+    return 0;
+
+  SharedMetadata* meta = shared_meta();
+  uint32 freeptr = subtle::Acquire_Load(&meta->freeptr);
+  while (true) {
+    if (freeptr < sizeof(SharedMetadata) || freeptr > mem_size_ ||
+        freeptr % kAllocAlignment != 0) {
+      SetCorrupt();
+      return 0;
+    }
+
+    // Blocks don't straddle pages, so that a page-aligned read of a block
+    // never touches the page after it. The rest of a page that is too small
+    // for the block is skipped.
+    uint32 page_free = mem_page_ - freeptr % mem_page_;
+    uint32 new_freeptr = size <= page_free ? freeptr + size
+                                           : freeptr + page_free;
+    if (new_freeptr > mem_size_ ||
+        (size > page_free && new_freeptr == mem_size_)) {
+      SetFlag(kFlagFull);
+      return 0;
+    }
+
+    uint32 existing = subtle::NoBarrier_CompareAndSwap(
+        &meta->freeptr, freeptr, new_freeptr);
+    if (existing != freeptr) {
+      // Another thread allocated first; try again after its block.
+      freeptr = existing;
+      continue;
+    }
+    if (size > page_free) {
+      freeptr = new_freeptr;
+      continue;
+    }
+
+    // The block is now owned by this thread. Memory is never reused, so it
+    // must still be zero.
+    BlockHeader* block = reinterpret_cast<BlockHeader*>(mem_base_ + freeptr);
+    if (block->size != 0 || block->cookie != 0 || block->type_id != 0 ||
+        subtle::NoBarrier_Load(&block->next) != 0) {
+      SetCorrupt();
+      return 0;
+    }
+    block->size = size;
+    block->type_id = type_id;
+    block->cookie = kBlockCookieAllocated;
+    return freeptr;
+  }
+}
+
+void PersistentMemoryAllocator::MakeIterable(Reference ref) {
+  DCHECK(!readonly_);
+  if (readonly_ || IsCorrupt())
+    return;
+  BlockHeader* block = GetBlock(ref, 0, 0, false);
+  if (!block)
+    return;
+  if (subtle::NoBarrier_Load(&block->next) != 0) {
+    NOTREACHED() << "Block is already iterable";
+    return;
+  }
+  subtle::NoBarrier_Store(&block->next, kReferenceQueue);
+
+  // Lock-free append to the queue: link the block after the last one, then
+  // advance the tail. A thread that finds the tail already linked helps by
+  // advancing the tail before trying again. The number of attempts is bounded
+  // in case the memory has been tampered with.
+  SharedMetadata* meta = shared_meta();
+  for (uint32 attempts = mem_size_ / sizeof(BlockHeader); attempts > 0;
+       --attempts) {
+    Reference tail = subtle::Acquire_Load(&meta->tailptr);
+    BlockHeader* tail_block = GetBlock(tail, 0, 0, true);
+    if (!tail_block)
+      break;
+
+    Reference next = subtle::Release_CompareAndSwap(&tail_block->next,
+                                                    kReferenceQueue, ref);
+    if (next == kReferenceQueue) {
+      subtle::Release_CompareAndSwap(&meta->tailptr, tail, ref);
+      return;
+    }
+    subtle::Release_CompareAndSwap(&meta->tailptr, tail, next);
+  }
+  SetCorrupt();
+}
+
+void PersistentMemoryAllocator::CreateIterator(Iterator* state) const {
+  state->last = kReferenceQueue;
+  state->niter = 0;
+}
+
+PersistentMemoryAllocator::Reference PersistentMemoryAllocator::GetNextIterable(
+    Iterator* state,
+    uint32* type_id) const {
+  if (IsCorrupt())
+    return 0;
+  const BlockHeader* block = GetBlock(state->last, 0, 0, true);
+  if (!block) {
+    SetCorrupt();
+    return 0;
+  }
+
+  Reference next = subtle::Acquire_Load(&block->next);
+  if (next == kReferenceQueue)
+    return 0;
+  block = GetBlock(next, 0, 0, false);
+  // There can't be more iterable blocks than fit in the memory, so visiting
+  // more means the queue has a loop.
+  if (!block || ++state->niter > mem_size_ / sizeof(BlockHeader)) {
+    SetCorrupt();
+    return 0;
+  }
+
+  state->last = next;
+  *type_id = block->type_id;
+  return next;
+}
+
+const PersistentMemoryAllocator::SharedMetadata*
+PersistentMemoryAllocator::shared_meta() const {
+  return reinterpret_cast<const SharedMetadata*>(mem_base_);
+}
+
+PersistentMemoryAllocator::SharedMetadata*
+PersistentMemoryAllocator::shared_meta() {
+  return reinterpret_cast<SharedMetadata*>(mem_base_);
+}
+
+const PersistentMemoryAllocator::BlockHeader*
+PersistentMemoryAllocator::GetBlock(Reference ref,
+                                    uint32 type_id,
+                                    uint32 size,
+                                    bool queue_ok) const {
+  if (ref % kAllocAlignment != 0)
+    return NULL;
+  if (ref < (queue_ok ? kReferenceQueue : sizeof(SharedMetadata)))
+    return NULL;
+  if (ref > mem_size_ || size > mem_size_ - ref ||
+      sizeof(BlockHeader) > mem_size_ - ref - size) {
+    return NULL;
+  }
+
+  const BlockHeader* block =
+      reinterpret_cast<const BlockHeader*>(mem_base_ + ref);
+  if (block->size < size + sizeof(BlockHeader) ||
+      block->size > mem_size_ - ref) {
+    return NULL;
+  }
+  if (block->cookie !=
+      (ref == kReferenceQueue ? kBlockCookieQueue : kBlockCookieAllocated)) {
+    return NULL;
+  }
+  if (type_id != 0 && block->type_id != type_id)
+    return NULL;
+  return block;
+}
+
+PersistentMemoryAllocator::BlockHeader* PersistentMemoryAllocator::GetBlock(
+    Reference ref,
+    uint32 type_id,
+    uint32 size,
+    bool queue_ok) {
+  return const_cast<BlockHeader*>(
+      static_cast<const PersistentMemoryAllocator*>(this)->GetBlock(
+          ref, type_id, size, queue_ok));
+}
+
+void* PersistentMemoryAllocator::GetBlockData(Reference ref,
+                                              uint32 type_id,
+                                              uint32 size) const {
+  const BlockHeader* block = GetBlock(ref, type_id, size, false);
+  if (!block)
+    return NULL;
+  return const_cast<char*>(reinterpret_cast<const char*>(block) +
+                           sizeof(BlockHeader));
+}
+
+void PersistentMemoryAllocator::SetCorrupt() const {
+  LOG(ERROR) << "Corruption detected in persistent memory";
+  corrupt_ = true;
+  if (!readonly_)
+    SetFlag(kFlagCorrupt);
+}
+
+bool PersistentMemoryAllocator::CheckFlag(uint32 flag) const {
+  return (subtle::Acquire_Load(&shared_meta()->flags) & flag) != 0;
+}
+
+void PersistentMemoryAllocator::SetFlag(uint32 flag) const {
+  subtle::Atomic32* flags = const_cast<subtle::Atomic32*>(&shared_meta()->flags);
+  subtle::Atomic32 old_flags = subtle::NoBarrier_Load(flags);
+  while (true) {
+    subtle::Atomic32 existing =
+        subtle::Release_CompareAndSwap(flags, old_flags, old_flags | flag);
+    if (existing == old_flags)
+      return;
+    old_flags = existing;
+  }
+}
+
+SharedPersistentMemoryAllocator::SharedPersistentMemoryAllocator(
+    scoped_ptr<SharedMemory> memory,
+    uint64 id,
+    const std::string& name,
+    bool readonly)
+    : PersistentMemoryAllocator(memory->memory(),
+                                memory->mapped_size(),
+                                0,
+                                id,
+                                name,
+                                readonly),
+      shared_memory_(memory.Pass()) {
+}
+
+SharedPersistentMemoryAllocator::~SharedPersistentMemoryAllocator() {
+}
+
+// static
+bool SharedPersistentMemoryAllocator::IsSharedMemoryAcceptable(
+    const SharedMemory& memory) {
+  return memory.memory() &&
+         IsMemoryAcceptable(memory.memory(), memory.mapped_size(), 0, false);
+}
+
+}  // namespace base
@@ -0,0 +1,174 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BASE_METRICS_PERSISTENT_MEMORY_ALLOCATOR_H_
+#define BASE_METRICS_PERSISTENT_MEMORY_ALLOCATOR_H_
+
+#include <string>
+
+#include "base/atomicops.h"
+#include "base/base_export.h"
+#include "base/basictypes.h"
+#include "base/memory/scoped_ptr.h"
+
+namespace base {
+
+class SharedMemory;
+
+// PersistentMemoryAllocator carves objects out of a fixed block of memory,
+// such as a segment of shared memory, in a way that lets another process that
+// maps the same block find them again. Allocation is lock-free, and objects
+// are never freed, so the layout of the block only ever grows.
+//
+// Objects are referred to by a Reference, the offset of the object from the
+// start of the block, because the block may be mapped at different addresses
+// in different processes. Each allocation carries a caller-chosen type id so
+// that readers can check what they are looking at. An allocation becomes
+// visible to iteration once it is passed to MakeIterable(), which publishes
+// it with release semantics: everything written to the object before that is
+// visible to a reader that finds it through GetNextIterable().
+//
+// All of the accessors validate the references and headers they are given,
+// because the memory may be written by another (possibly compromised)
+// process. Detected corruption is recorded and makes the allocator refuse any
+// further work.
+class BASE_EXPORT PersistentMemoryAllocator {
+ public:
+  typedef uint32 Reference;
+
+  // Iteration state; see CreateIterator().
+  struct Iterator {
+    Reference last;
+    uint32 niter;
+  };
+
+  // The memory block is used as-is when it already contains an allocator
+  // created with the same |page_size|, and initialized when it is all zeros,
+  // which is how new shared memory comes back from the system. |page_size| is
+  // the size of the pages that objects must not straddle, or 0 if that does
+  // not matter. |id| and |name| are stored in a new block for identification.
+  // A |readonly| allocator never writes to the block.
+  PersistentMemoryAllocator(void* base,
+                            size_t size,
+                            size_t page_size,
+                            uint64 id,
+                            const std::string& name,
+                            bool readonly);
+  virtual ~PersistentMemoryAllocator();
+
+  // Returns true if a block of memory at |base| of |size| bytes can be used
+  // by an allocator.
+  static bool IsMemoryAcceptable(const void* base,
+                                 size_t size,
+                                 size_t page_size,
+                                 bool readonly);
+
+  uint64 Id() const;
+  const char* Name() const;
+  bool IsReadonly() const { return readonly_; }
+
+  // Returns true once corruption has been detected. A corrupt allocator
+  // neither allocates nor returns objects.
+  bool IsCorrupt() const;
+
+  // Returns true if an allocation has failed for lack of space.
+  bool IsFull() const;
+
+  // The size of the memory block and how much of it is in use.
+  size_t size() const { return mem_size_; }
+  size_t used() const;
+
+  // Returns the object at |ref| if it is a valid allocation of |type_id|
+  // that is large enough for a T, or NULL otherwise.
+  template <typename T>
+  T* GetAsObject(Reference ref, uint32 type_id) const {
+    return static_cast<T*>(GetBlockData(ref, type_id, sizeof(T)));
+  }
+
+  // Returns the type id of the allocation at |ref|, or 0 if it is invalid.
+  uint32 GetType(Reference ref) const;
+
+  // Returns the usable size of the allocation at |ref|, or 0 if it is
+  // invalid. This may be larger than the size that was requested.
+  size_t GetAllocSize(Reference ref) const;
+
+  // Allocates |size| bytes of zeroed memory tagged with |type_id|, which
+  // must not be 0. Returns 0 if there isn't enough space left.
+  Reference Allocate(size_t size, uint32 type_id);
+
+  // Makes the allocation at |ref| visible to iteration. This can be called
+  // at most once per allocation.
+  void MakeIterable(Reference ref);
+
+  // Iteration visits the iterable allocations in the order they were made
+  // iterable. New allocations made iterable after an iteration returned its
+  // last object are returned by later calls with the same |state|.
+  void CreateIterator(Iterator* state) const;
+  // Returns the next iterable allocation and stores its type in |type_id|,
+  // or returns 0 if there are no more.
+  Reference GetNextIterable(Iterator* state, uint32* type_id) const;
+
+ protected:
+  char* const mem_base_;
+  const uint32 mem_size_;
+  const uint32 mem_page_;
+
+ private:
+  struct SharedMetadata;
+  struct BlockHeader;
+
+  static const Reference kReferenceQueue;
+
+  const SharedMetadata* shared_meta() const;
+  SharedMetadata* shared_meta();
+
+  // Returns the header of the block at |ref| if it passes validation.
+  // |queue_ok| allows the iteration queue head, which isn't a real block.
+  const BlockHeader* GetBlock(Reference ref,
+                              uint32 type_id,
+                              uint32 size,
+                              bool queue_ok) const;
+  BlockHeader* GetBlock(Reference ref,
+                        uint32 type_id,
+                        uint32 size,
+                        bool queue_ok);
+
+  // Returns the data of the block at |ref|, which must be |type_id| and at
+  // least |size| bytes, or NULL.
+  void* GetBlockData(Reference ref, uint32 type_id, uint32 size) const;
+
+  void SetCorrupt() const;
+  bool CheckFlag(uint32 flag) const;
+  void SetFlag(uint32 flag) const;
+
+  const bool readonly_;
+  mutable bool corrupt_;
+
+  DISALLOW_COPY_AND_ASSIGN(PersistentMemoryAllocator);
+};
+
+// A PersistentMemoryAllocator that owns a mapped SharedMemory segment.
+class BASE_EXPORT SharedPersistentMemoryAllocator
+    : public PersistentMemoryAllocator {
+ public:
+  SharedPersistentMemoryAllocator(scoped_ptr<SharedMemory> memory,
+                                  uint64 id,
+                                  const std::string& name,
+                                  bool readonly);
+  ~SharedPersistentMemoryAllocator() override;
+
+  // Returns true if |memory| is mapped and can be used by an allocator.
+  static bool IsSharedMemoryAcceptable(const SharedMemory& memory);
+
+  SharedMemory* shared_memory() { return shared_memory_.get(); }
+
+ private:
+  scoped_ptr<SharedMemory> shared_memory_;
+
+  DISALLOW_COPY_AND_ASSIGN(SharedPersistentMemoryAllocator);
+};
+
+}  // namespace base
+
+#endif  // BASE_METRICS_PERSISTENT_MEMORY_ALLOCATOR_H_
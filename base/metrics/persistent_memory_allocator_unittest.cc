@@ -0,0 +1,243 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/metrics/persistent_memory_allocator.h"
+
+#include <string.h>
+
+#include "base/memory/scoped_ptr.h"
+#include "base/memory/scoped_vector.h"
+#include "base/memory/shared_memory.h"
+#include "base/process/process_handle.h"
+#include "base/threading/simple_thread.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+
+namespace {
+
+const size_t kTestMemorySize = 1 << 16;
+const size_t kPageSize = 1 << 12;
+const uint32 kTestTypeId = 1;
+const uint32 kOtherTypeId = 2;
+
+struct TestObject {
+  int32 value;
+  int32 other;
+};
+
+}  // namespace
+
+class PersistentMemoryAllocatorTest : public testing::Test {
+ protected:
+  PersistentMemoryAllocatorTest()
+      : memory_(new uint64[kTestMemorySize / sizeof(uint64)]()) {}
+
+  scoped_ptr<PersistentMemoryAllocator> CreateAllocator(size_t page_size,
+                                                        bool readonly) {
+    return make_scoped_ptr(new PersistentMemoryAllocator(
+        memory_.get(), kTestMemorySize, page_size, 42, "TestAllocator",
+        readonly));
+  }
+
+  scoped_ptr<uint64[]> memory_;
+};
+
+TEST_F(PersistentMemoryAllocatorTest, AllocateAndIterate) {
+  scoped_ptr<PersistentMemoryAllocator> allocator = CreateAllocator(0, false);
+  EXPECT_FALSE(allocator->IsCorrupt());
+  EXPECT_FALSE(allocator->IsFull());
+  EXPECT_EQ(42u, allocator->Id());
+  EXPECT_STREQ("TestAllocator", allocator->Name());
+
+  PersistentMemoryAllocator::Reference ref1 =
+      allocator->Allocate(sizeof(TestObject), kTestTypeId);
+  ASSERT_NE(0u, ref1);
+  TestObject* object1 = allocator->GetAsObject<TestObject>(ref1, kTestTypeId);
+  ASSERT_TRUE(object1);
+  EXPECT_EQ(0, object1->value);
+  object1->value = 1;
+  EXPECT_EQ(kTestTypeId, allocator->GetType(ref1));
+  EXPECT_LE(sizeof(TestObject), allocator->GetAllocSize(ref1));
+  EXPECT_FALSE(allocator->GetAsObject<TestObject>(ref1, kOtherTypeId));
+
+  PersistentMemoryAllocator::Reference ref2 =
+      allocator->Allocate(100, kOtherTypeId);
+  ASSERT_NE(0u, ref2);
+  EXPECT_NE(ref1, ref2);
+  EXPECT_LE(100u, allocator->GetAllocSize(ref2));
+
+  // Nothing is iterable yet.
+  PersistentMemoryAllocator::Iterator iter;
+  uint32 type_id;
+  allocator->CreateIterator(&iter);
+  EXPECT_EQ(0u, allocator->GetNextIterable(&iter, &type_id));
+
+  // Iteration returns objects in the order they were made iterable, and picks
+  // up objects made iterable after it reached the end.
+  allocator->MakeIterable(ref2);
+  EXPECT_EQ(ref2, allocator->GetNextIterable(&iter, &type_id));
+  EXPECT_EQ(kOtherTypeId, type_id);
+  EXPECT_EQ(0u, allocator->GetNextIterable(&iter, &type_id));
+  allocator->MakeIterable(ref1);
+  EXPECT_EQ(ref1, allocator->GetNextIterable(&iter, &type_id));
+  EXPECT_EQ(kTestTypeId, type_id);
+  EXPECT_EQ(0u, allocator->GetNextIterable(&iter, &type_id));
+
+  // A second allocator over the same memory sees the same objects.
+  scoped_ptr<PersistentMemoryAllocator> reader = CreateAllocator(0, true);
+  EXPECT_FALSE(reader->IsCorrupt());
+  EXPECT_EQ(42u, reader->Id());
+  EXPECT_STREQ("TestAllocator", reader->Name());
+  EXPECT_EQ(allocator->used(), reader->used());
+  reader->CreateIterator(&iter);
+  EXPECT_EQ(ref2, reader->GetNextIterable(&iter, &type_id));
+  EXPECT_EQ(ref1, reader->GetNextIterable(&iter, &type_id));
+  EXPECT_EQ(0u, reader->GetNextIterable(&iter, &type_id));
+  EXPECT_EQ(1, reader->GetAsObject<TestObject>(ref1, kTestTypeId)->value);
+
+  // Invalid references are rejected.
+  EXPECT_FALSE(reader->GetAsObject<TestObject>(0, kTestTypeId));
+  EXPECT_FALSE(reader->GetAsObject<TestObject>(ref1 + 1, kTestTypeId));
+  EXPECT_FALSE(reader->GetAsObject<TestObject>(kTestMemorySize, kTestTypeId));
+  EXPECT_EQ(0u, reader->GetType(ref1 + 8));
+  EXPECT_FALSE(reader->IsCorrupt());
+}
+
+TEST_F(PersistentMemoryAllocatorTest, Full) {
+  scoped_ptr<PersistentMemoryAllocator> allocator =
+      CreateAllocator(kPageSize, false);
+  size_t allocations = 0;
+  while (allocator->Allocate(1000, kTestTypeId))
+    ++allocations;
+  EXPECT_TRUE(allocator->IsFull());
+  EXPECT_FALSE(allocator->IsCorrupt());
+  // Four 1000 byte allocations fit in a page, but the first page also holds
+  // the allocator's header and name.
+  EXPECT_EQ(kTestMemorySize / kPageSize * 4 - 1, allocations);
+
+  // Allocations can't be larger than a page.
+  EXPECT_EQ(0u, CreateAllocator(kPageSize, false)->Allocate(kPageSize,
+                                                             kTestTypeId));
+}
+
+TEST_F(PersistentMemoryAllocatorTest, PageBoundaries) {
+  scoped_ptr<PersistentMemoryAllocator> allocator =
+      CreateAllocator(kPageSize, false);
+  for (int i = 0; i < 100; ++i) {
+    PersistentMemoryAllocator::Reference ref =
+        allocator->Allocate(300, kTestTypeId);
+    ASSERT_NE(0u, ref);
+    size_t size = allocator->GetAllocSize(ref);
+    EXPECT_EQ(ref / kPageSize, (ref + size - 1) / kPageSize);
+  }
+}
+
+TEST_F(PersistentMemoryAllocatorTest, Corruption) {
+  // Memory that is neither zero nor an allocator.
+  memset(memory_.get(), 0x5A, 64);
+  EXPECT_TRUE(CreateAllocator(0, false)->IsCorrupt());
+
+  memset(memory_.get(), 0, kTestMemorySize);
+  scoped_ptr<PersistentMemoryAllocator> allocator = CreateAllocator(0, false);
+  PersistentMemoryAllocator::Reference ref =
+      allocator->Allocate(sizeof(TestObject), kTestTypeId);
+  allocator->MakeIterable(ref);
+
+  // Link the object to itself, making a loop. Iteration must still end.
+  reinterpret_cast<uint32*>(reinterpret_cast<char*>(memory_.get()) + ref)[3] =
+      ref;
+  scoped_ptr<PersistentMemoryAllocator> reader = CreateAllocator(0, true);
+  PersistentMemoryAllocator::Iterator iter;
+  uint32 type_id;
+  reader->CreateIterator(&iter);
+  int found = 0;
+  while (reader->GetNextIterable(&iter, &type_id))
+    ++found;
+  EXPECT_LT(0, found);
+  EXPECT_TRUE(reader->IsCorrupt());
+
+  // A different page size is detected.
+  EXPECT_TRUE(CreateAllocator(kPageSize, true)->IsCorrupt());
+}
+
+namespace {
+
+class AllocatorThread : public SimpleThread {
+ public:
+  AllocatorThread(PersistentMemoryAllocator* allocator, int count)
+      : SimpleThread("AllocatorThread"),
+        allocator_(allocator),
+        count_(count) {}
+
+  void Run() override {
+    for (int i = 0; i < count_; ++i) {
+      PersistentMemoryAllocator::Reference ref =
+          allocator_->Allocate(sizeof(TestObject), kTestTypeId);
+      ASSERT_NE(0u, ref);
+      allocator_->GetAsObject<TestObject>(ref, kTestTypeId)->value = i;
+      allocator_->MakeIterable(ref);
+    }
+  }
+
+ private:
+  PersistentMemoryAllocator* allocator_;
+  const int count_;
+
+  DISALLOW_COPY_AND_ASSIGN(AllocatorThread);
+};
+
+}  // namespace
+
+TEST_F(PersistentMemoryAllocatorTest, ParallelAllocateAndMakeIterable) {
+  scoped_ptr<PersistentMemoryAllocator> allocator = CreateAllocator(0, false);
+  const int kNumThreads = 4;
+  const int kCount = 500;
+  ScopedVector<AllocatorThread> threads;
+  for (int i = 0; i < kNumThreads; ++i) {
+    threads.push_back(new AllocatorThread(allocator.get(), kCount));
+    threads.back()->Start();
+  }
+  for (int i = 0; i < kNumThreads; ++i)
+    threads[i]->Join();
+
+  PersistentMemoryAllocator::Iterator iter;
+  uint32 type_id;
+  allocator->CreateIterator(&iter);
+  int found = 0;
+  while (allocator->GetNextIterable(&iter, &type_id)) {
+    EXPECT_EQ(kTestTypeId, type_id);
+    ++found;
+  }
+  EXPECT_EQ(kNumThreads * kCount, found);
+  EXPECT_FALSE(allocator->IsCorrupt());
+}
+
+TEST(SharedPersistentMemoryAllocatorTest, ShareBetweenMappings) {
+  scoped_ptr<SharedMemory> memory(new SharedMemory);
+  ASSERT_TRUE(memory->CreateAndMapAnonymous(kTestMemorySize));
+  SharedMemoryHandle handle;
+  ASSERT_TRUE(memory->ShareToProcess(GetCurrentProcessHandle(), &handle));
+  ASSERT_TRUE(
+      SharedPersistentMemoryAllocator::IsSharedMemoryAcceptable(*memory));
+  SharedPersistentMemoryAllocator writer(memory.Pass(), 1, "Shared", false);
+
+  PersistentMemoryAllocator::Reference ref =
+      writer.Allocate(sizeof(TestObject), kTestTypeId);
+  writer.GetAsObject<TestObject>(ref, kTestTypeId)->value = 7;
+  writer.MakeIterable(ref);
+
+  scoped_ptr<SharedMemory> memory2(new SharedMemory(handle, true));
+  ASSERT_TRUE(memory2->Map(kTestMemorySize));
+  SharedPersistentMemoryAllocator reader(memory2.Pass(), 0, "", true);
+  EXPECT_FALSE(reader.IsCorrupt());
+  EXPECT_STREQ("Shared", reader.Name());
+  PersistentMemoryAllocator::Iterator iter;
+  uint32 type_id;
+  reader.CreateIterator(&iter);
+  EXPECT_EQ(ref, reader.GetNextIterable(&iter, &type_id));
+  EXPECT_EQ(7, reader.GetAsObject<TestObject>(ref, kTestTypeId)->value);
+}
+
+}  // namespace base
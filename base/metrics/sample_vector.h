@@ -23,6 +23,14 @@ class BucketRanges;
 class BASE_EXPORT_PRIVATE SampleVector : public HistogramSamples {
  public:
   explicit SampleVector(const BucketRanges* bucket_ranges);
+  // Keeps the bucket counts in |counts|, which has |counts_size| elements,
+  // and the sum and redundant count in |meta|, instead of in memory owned by
+  // the SampleVector. This is used to place samples in persistent memory.
+  // Both must outlive the SampleVector.
+  SampleVector(const BucketRanges* bucket_ranges,
+               HistogramBase::AtomicCount* counts,
+               size_t counts_size,
+               Metadata* meta);
   ~SampleVector() override;
 
   // HistogramSamples implementation:
@@ -45,7 +53,12 @@ class BASE_EXPORT_PRIVATE SampleVector : public HistogramSamples {
  private:
   FRIEND_TEST_ALL_PREFIXES(HistogramTest, CorruptSampleCounts);
 
-  std::vector<HistogramBase::AtomicCount> counts_;
+  // Used when no external counts are given.
+  std::vector<HistogramBase::AtomicCount> local_counts_;
+
+  // Points to the storage of |local_counts_| or to the external counts.
+  HistogramBase::AtomicCount* const counts_;
+  const size_t counts_size_;
 
   // Shares the same BucketRanges with Histogram object.
   const BucketRanges* const bucket_ranges_;
@@ -57,6 +70,9 @@ class BASE_EXPORT_PRIVATE SampleVectorIterator : public SampleCountIterator {
  public:
   SampleVectorIterator(const std::vector<HistogramBase::AtomicCount>* counts,
                        const BucketRanges* bucket_ranges);
+  SampleVectorIterator(const HistogramBase::AtomicCount* counts,
+                       size_t counts_size,
+                       const BucketRanges* bucket_ranges);
   ~SampleVectorIterator() override;
 
   // SampleCountIterator implementation:
@@ -72,7 +88,8 @@ class BASE_EXPORT_PRIVATE SampleVectorIterator : public SampleCountIterator {
  private:
   void SkipEmptyBuckets();
 
-  const std::vector<HistogramBase::AtomicCount>* counts_;
+  const HistogramBase::AtomicCount* counts_;
+  size_t counts_size_;
   const BucketRanges* bucket_ranges_;
 
   size_t index_;
@@ -86,6 +86,32 @@ TEST(SampleVectorTest, AddSubtractTest) {
   EXPECT_EQ(samples1.redundant_count(), samples1.TotalCount());
 }
 
+TEST(SampleVectorTest, ExternalStorageTest) {
+  // Custom buckets: [1, 5) [5, 10)
+  BucketRanges ranges(3);
+  ranges.set_range(0, 1);
+  ranges.set_range(1, 5);
+  ranges.set_range(2, 10);
+
+  HistogramBase::AtomicCount counts[2] = {0, 0};
+  HistogramSamples::Metadata meta = {0, 0, 0};
+  SampleVector samples(&ranges, counts, arraysize(counts), &meta);
+
+  samples.Accumulate(1, 200);
+  samples.Accumulate(5, 100);
+  EXPECT_EQ(200, counts[0]);
+  EXPECT_EQ(100, counts[1]);
+  EXPECT_EQ(700, meta.sum);
+  EXPECT_EQ(300, meta.redundant_count);
+
+  // A second SampleVector over the same storage sees the same samples.
+  SampleVector samples2(&ranges, counts, arraysize(counts), &meta);
+  EXPECT_EQ(200, samples2.GetCountAtIndex(0));
+  EXPECT_EQ(100, samples2.GetCountAtIndex(1));
+  EXPECT_EQ(700, samples2.sum());
+  EXPECT_EQ(300, samples2.redundant_count());
+}
+
 #if (!defined(NDEBUG) || defined(DCHECK_ALWAYS_ON)) && GTEST_HAS_DEATH_TEST
 TEST(SampleVectorDeathTest, BucketIndexTest) {
   // 8 buckets with exponential layout:
@@ -6,12 +6,13 @@
 
 #include "base/at_exit.h"
 #include "base/debug/leak_annotations.h"
+#include "base/hash.h"
 #include "base/json/string_escape.h"
 #include "base/logging.h"
 #include "base/memory/scoped_ptr.h"
 #include "base/metrics/histogram.h"
 #include "base/strings/stringprintf.h"
-#include "base/synchronization/lock.h"
+#include "base/synchronization/read_write_lock.h"
 #include "base/values.h"
 
 using std::list;
@@ -21,10 +22,66 @@ namespace {
 // Initialize histogram statistics gathering system.
 base::LazyInstance<base::StatisticsRecorder>::Leaky g_statistics_recorder_ =
     LAZY_INSTANCE_INITIALIZER;
+
+// Initial number of slots of the lookup table.
+const size_t kInitialLookupTableCapacity = 256;
 }  // namespace
 
 namespace base {
 
+// An open-addressing hash table from histogram names to histograms that can
+// be read concurrently with a single writer. Slots are only ever filled, never
+// cleared, and a histogram is fully constructed before it is published with a
+// release store. When the table gets half full it is replaced by one of twice
+// the capacity; the replaced table may still be in use by readers, so it is
+// kept alive by its replacement.
+class HistogramLookupTable {
+ public:
+  HistogramLookupTable(size_t capacity, HistogramLookupTable* previous)
+      : capacity_(capacity),
+        size_(0),
+        slots_(new subtle::AtomicWord[capacity]),
+        previous_(previous) {
+    DCHECK_EQ(0u, capacity_ & (capacity_ - 1));
+    for (size_t i = 0; i < capacity_; ++i)
+      slots_[i] = 0;
+  }
+
+  size_t capacity() const { return capacity_; }
+  bool IsFull() const { return (size_ + 1) * 2 > capacity_; }
+
+  HistogramBase* Find(const std::string& name) const {
+    const size_t mask = capacity_ - 1;
+    for (size_t i = Hash(name) & mask;; i = (i + 1) & mask) {
+      HistogramBase* histogram = reinterpret_cast<HistogramBase*>(
+          subtle::Acquire_Load(&slots_[i]));
+      if (!histogram)
+        return NULL;
+      if (histogram->histogram_name() == name)
+        return histogram;
+    }
+  }
+
+  void Insert(HistogramBase* histogram) {
+    DCHECK(!IsFull());
+    const size_t mask = capacity_ - 1;
+    size_t i = Hash(histogram->histogram_name()) & mask;
+    while (subtle::NoBarrier_Load(&slots_[i]))
+      i = (i + 1) & mask;
+    subtle::Release_Store(&slots_[i],
+                          reinterpret_cast<subtle::AtomicWord>(histogram));
+    ++size_;
+  }
+
+ private:
+  const size_t capacity_;
+  size_t size_;
+  scoped_ptr<subtle::AtomicWord[]> slots_;
+  scoped_ptr<HistogramLookupTable> previous_;
+
+  DISALLOW_COPY_AND_ASSIGN(HistogramLookupTable);
+};
+
 // static
 void StatisticsRecorder::Initialize() {
   // Ensure that an instance of the StatisticsRecorder object is created.
@@ -36,7 +93,7 @@ void StatisticsRecorder::Initialize() {
 bool StatisticsRecorder::IsActive() {
   if (lock_ == NULL)
     return false;
-  base::AutoLock auto_lock(*lock_);
+  base::AutoReadLock auto_lock(*lock_);
   return NULL != histograms_;
 }
 
@@ -56,7 +113,7 @@ HistogramBase* StatisticsRecorder::RegisterOrDeleteDuplicate(
   HistogramBase* histogram_to_delete = NULL;
   HistogramBase* histogram_to_return = NULL;
   {
-    base::AutoLock auto_lock(*lock_);
+    base::AutoWriteLock auto_lock(*lock_);
     if (histograms_ == NULL) {
       histogram_to_return = histogram;
     } else {
@@ -64,6 +121,7 @@ HistogramBase* StatisticsRecorder::RegisterOrDeleteDuplicate(
       HistogramMap::iterator it = histograms_->find(name);
       if (histograms_->end() == it) {
         (*histograms_)[name] = histogram;
+        AddToLookupTable(histogram);
         ANNOTATE_LEAKING_OBJECT_PTR(histogram);  // see crbug.com/79322
         histogram_to_return = histogram;
       } else if (histogram == it->second) {
@@ -91,7 +149,7 @@ const BucketRanges* StatisticsRecorder::RegisterOrDeleteDuplicateRanges(
     return ranges;
   }
 
-  base::AutoLock auto_lock(*lock_);
+  base::AutoWriteLock auto_lock(*lock_);
   if (ranges_ == NULL) {
     ANNOTATE_LEAKING_OBJECT_PTR(ranges);
     return ranges;
@@ -198,7 +256,7 @@ std::string StatisticsRecorder::ToJSON(const std::string& query) {
 void StatisticsRecorder::GetHistograms(Histograms* output) {
   if (lock_ == NULL)
     return;
-  base::AutoLock auto_lock(*lock_);
+  base::AutoReadLock auto_lock(*lock_);
   if (histograms_ == NULL)
     return;
 
@@ -215,7 +273,7 @@ void StatisticsRecorder::GetBucketRanges(
     std::vector<const BucketRanges*>* output) {
   if (lock_ == NULL)
     return;
-  base::AutoLock auto_lock(*lock_);
+  base::AutoReadLock auto_lock(*lock_);
   if (ranges_ == NULL)
     return;
 
@@ -234,16 +292,12 @@ void StatisticsRecorder::GetBucketRanges(
 
 // static
 HistogramBase* StatisticsRecorder::FindHistogram(const std::string& name) {
-  if (lock_ == NULL)
-    return NULL;
-  base::AutoLock auto_lock(*lock_);
-  if (histograms_ == NULL)
+  const HistogramLookupTable* table =
+      reinterpret_cast<const HistogramLookupTable*>(
+          subtle::Acquire_Load(&lookup_table_));
+  if (table == NULL)
     return NULL;
-
-  HistogramMap::iterator it = histograms_->find(name);
-  if (histograms_->end() == it)
-    return NULL;
-  return it->second;
+  return table->Find(name);
 }
 
 // private static
@@ -251,7 +305,7 @@ void StatisticsRecorder::GetSnapshot(const std::string& query,
                                      Histograms* snapshot) {
   if (lock_ == NULL)
     return;
-  base::AutoLock auto_lock(*lock_);
+  base::AutoReadLock auto_lock(*lock_);
   if (histograms_ == NULL)
     return;
 
@@ -263,6 +317,27 @@ void StatisticsRecorder::GetSnapshot(const std::string& query,
   }
 }
 
+// static
+void StatisticsRecorder::AddToLookupTable(HistogramBase* histogram) {
+  HistogramLookupTable* table = reinterpret_cast<HistogramLookupTable*>(
+      subtle::NoBarrier_Load(&lookup_table_));
+  if (!table->IsFull()) {
+    table->Insert(histogram);
+    return;
+  }
+
+  // |histogram| is already in |histograms_|.
+  HistogramLookupTable* new_table =
+      new HistogramLookupTable(table->capacity() * 2, table);
+  for (HistogramMap::iterator it = histograms_->begin();
+       histograms_->end() != it;
+       ++it) {
+    new_table->Insert(it->second);
+  }
+  subtle::Release_Store(&lookup_table_,
+                        reinterpret_cast<subtle::AtomicWord>(new_table));
+}
+
 // This singleton instance should be started during the single threaded portion
 // of main(), and hence it is not thread safe.  It initializes globals to
 // provide support for all future calls.
@@ -275,11 +350,15 @@ StatisticsRecorder::StatisticsRecorder() {
     // during the termination phase. Since it's a static data member, we will
     // leak one per process, which would be similar to the instance allocated
     // during static initialization and released only on  process termination.
-    lock_ = new base::Lock;
+    lock_ = new base::ReadWriteLock;
   }
-  base::AutoLock auto_lock(*lock_);
+  base::AutoWriteLock auto_lock(*lock_);
   histograms_ = new HistogramMap;
   ranges_ = new RangesMap;
+  subtle::Release_Store(
+      &lookup_table_,
+      reinterpret_cast<subtle::AtomicWord>(
+          new HistogramLookupTable(kInitialLookupTableCapacity, NULL)));
 
   if (VLOG_IS_ON(1))
     AtExitManager::RegisterCallback(&DumpHistogramsToVlog, this);
@@ -300,14 +379,20 @@ StatisticsRecorder::~StatisticsRecorder() {
   // Clean up.
   scoped_ptr<HistogramMap> histograms_deleter;
   scoped_ptr<RangesMap> ranges_deleter;
+  // The recorder is only destroyed in tests, where no other thread may be in
+  // FindHistogram() at this point.
+  scoped_ptr<HistogramLookupTable> lookup_table_deleter;
   // We don't delete lock_ on purpose to avoid having to properly protect
   // against it going away after we checked for NULL in the static methods.
   {
-    base::AutoLock auto_lock(*lock_);
+    base::AutoWriteLock auto_lock(*lock_);
     histograms_deleter.reset(histograms_);
     ranges_deleter.reset(ranges_);
+    lookup_table_deleter.reset(reinterpret_cast<HistogramLookupTable*>(
+        subtle::NoBarrier_Load(&lookup_table_)));
     histograms_ = NULL;
     ranges_ = NULL;
+    subtle::Release_Store(&lookup_table_, 0);
   }
   // We are going to leak the histograms and the ranges.
 }
@@ -318,6 +403,8 @@ StatisticsRecorder::HistogramMap* StatisticsRecorder::histograms_ = NULL;
 // static
 StatisticsRecorder::RangesMap* StatisticsRecorder::ranges_ = NULL;
 // static
-base::Lock* StatisticsRecorder::lock_ = NULL;
+base::ReadWriteLock* StatisticsRecorder::lock_ = NULL;
+// static
+subtle::AtomicWord StatisticsRecorder::lookup_table_ = 0;
 
 }  // namespace base
@@ -15,6 +15,7 @@
 #include <string>
 #include <vector>
 
+#include "base/atomicops.h"
 #include "base/base_export.h"
 #include "base/basictypes.h"
 #include "base/gtest_prod_util.h"
@@ -24,7 +25,7 @@ namespace base {
 
 class BucketRanges;
 class HistogramBase;
-class Lock;
+class ReadWriteLock;
 
 class BASE_EXPORT StatisticsRecorder {
  public:
@@ -66,7 +67,8 @@ class BASE_EXPORT StatisticsRecorder {
   static void GetBucketRanges(std::vector<const BucketRanges*>* output);
 
   // Find a histogram by name. It matches the exact name. This method is thread
-  // safe.  It returns NULL if a matching histogram is not found.
+  // safe and doesn't take a lock.  It returns NULL if a matching histogram is
+  // not found.
   static HistogramBase* FindHistogram(const std::string& name);
 
   // GetSnapshot copies some of the pointers to registered histograms into the
@@ -88,6 +90,7 @@ class BASE_EXPORT StatisticsRecorder {
   friend class HistogramBaseTest;
   friend class HistogramSnapshotManagerTest;
   friend class HistogramTest;
+  friend class PersistentHistogramAllocatorTest;
   friend class SparseHistogramTest;
   friend class StatisticsRecorderTest;
   FRIEND_TEST_ALL_PREFIXES(HistogramDeltaSerializationTest,
@@ -101,11 +104,21 @@ class BASE_EXPORT StatisticsRecorder {
 
   static void DumpHistogramsToVlog(void* instance);
 
+  // Adds |histogram| to |lookup_table_|. Must be called with |lock_| held for
+  // writing.
+  static void AddToLookupTable(HistogramBase* histogram);
+
   static HistogramMap* histograms_;
   static RangesMap* ranges_;
 
-  // Lock protects access to above maps.
-  static base::Lock* lock_;
+  // Protects access to above maps. Lookups and snapshots only read them, so
+  // they share the lock.
+  static base::ReadWriteLock* lock_;
+
+  // An insert-only hash table of the histograms in |histograms_| that
+  // FindHistogram() reads without taking |lock_|, as a pointer to a
+  // HistogramLookupTable. It is only modified with |lock_| held for writing.
+  static subtle::AtomicWord lookup_table_;
 
   DISALLOW_COPY_AND_ASSIGN(StatisticsRecorder);
 };
@@ -8,6 +8,7 @@
 #include "base/memory/scoped_ptr.h"
 #include "base/metrics/histogram.h"
 #include "base/metrics/statistics_recorder.h"
+#include "base/strings/stringprintf.h"
 #include "base/values.h"
 #include "testing/gtest/include/gtest/gtest.h"
 
@@ -149,6 +150,25 @@ TEST_F(StatisticsRecorderTest, FindHistogram) {
   EXPECT_TRUE(StatisticsRecorder::FindHistogram("TestHistogram") == NULL);
 }
 
+// Registers enough histograms to make the lookup table grow several times.
+TEST_F(StatisticsRecorderTest, FindHistogramManyHistograms) {
+  const int kNumHistograms = 2000;
+  std::vector<HistogramBase*> histograms;
+  for (int i = 0; i < kNumHistograms; ++i) {
+    histograms.push_back(Histogram::FactoryGet(
+        StringPrintf("TestHistogram%d", i), 1, 1000, 10,
+        HistogramBase::kNoFlags));
+  }
+
+  for (int i = 0; i < kNumHistograms; ++i) {
+    EXPECT_EQ(histograms[i], StatisticsRecorder::FindHistogram(
+                                 StringPrintf("TestHistogram%d", i)));
+  }
+  EXPECT_TRUE(StatisticsRecorder::FindHistogram("TestHistogram") == NULL);
+  EXPECT_TRUE(StatisticsRecorder::FindHistogram(
+                  StringPrintf("TestHistogram%d", kNumHistograms)) == NULL);
+}
+
 TEST_F(StatisticsRecorderTest, GetSnapshot) {
   Histogram::FactoryGet("TestHistogram1", 1, 1000, 10, Histogram::kNoFlags);
   Histogram::FactoryGet("TestHistogram2", 1, 1000, 10, Histogram::kNoFlags);
@@ -0,0 +1,79 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/metrics/thread_sharded_samples.h"
+
+#include "base/lazy_instance.h"
+#include "base/logging.h"
+#include "base/metrics/sample_vector.h"
+#include "base/threading/thread_local.h"
+
+namespace base {
+
+namespace {
+
+// The shard index of each thread, plus one so that 0 means "not assigned".
+LazyInstance<ThreadLocalPointer<void> >::Leaky g_shard_index_plus_one =
+    LAZY_INSTANCE_INITIALIZER;
+
+// Source of shard indices; threads are assigned shards round-robin.
+subtle::Atomic32 g_next_shard_index = 0;
+
+}  // namespace
+
+// static
+const size_t ThreadShardedSamples::kNumShards;
+
+ThreadShardedSamples::ThreadShardedSamples(const BucketRanges* bucket_ranges)
+    : bucket_ranges_(bucket_ranges) {
+  for (size_t i = 0; i < kNumShards; ++i)
+    shards_[i] = 0;
+}
+
+ThreadShardedSamples::~ThreadShardedSamples() {
+  for (size_t i = 0; i < kNumShards; ++i)
+    delete reinterpret_cast<SampleVector*>(shards_[i]);
+}
+
+void ThreadShardedSamples::Accumulate(HistogramBase::Sample value,
+                                      HistogramBase::Count count) {
+  subtle::AtomicWord* slot = &shards_[GetShardIndexForCurrentThread()];
+  SampleVector* shard =
+      reinterpret_cast<SampleVector*>(subtle::Acquire_Load(slot));
+  if (!shard) {
+    shard = new SampleVector(bucket_ranges_);
+    subtle::AtomicWord previous = subtle::Release_CompareAndSwap(
+        slot, 0, reinterpret_cast<subtle::AtomicWord>(shard));
+    if (previous) {
+      // Another thread sharing the shard index created it first.
+      delete shard;
+      shard = reinterpret_cast<SampleVector*>(previous);
+    }
+  }
+  shard->Accumulate(value, count);
+}
+
+void ThreadShardedSamples::AddTo(HistogramSamples* samples) const {
+  for (size_t i = 0; i < kNumShards; ++i) {
+    const SampleVector* shard = reinterpret_cast<const SampleVector*>(
+        subtle::Acquire_Load(&shards_[i]));
+    if (shard)
+      samples->Add(*shard);
+  }
+}
+
+// static
+size_t ThreadShardedSamples::GetShardIndexForCurrentThread() {
+  ThreadLocalPointer<void>& tls = g_shard_index_plus_one.Get();
+  size_t index_plus_one = reinterpret_cast<size_t>(tls.Get());
+  if (!index_plus_one) {
+    uint32 index = static_cast<uint32>(
+        subtle::NoBarrier_AtomicIncrement(&g_next_shard_index, 1));
+    index_plus_one = index % kNumShards + 1;
+    tls.Set(reinterpret_cast<void*>(index_plus_one));
+  }
+  return index_plus_one - 1;
+}
+
+}  // namespace base
@@ -0,0 +1,57 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// ThreadShardedSamples spreads the samples of a histogram over several
+// SampleVectors ("shards"), so that threads that record into the same
+// histogram at high rates don't contend for the same cache lines. Every
+// thread is assigned one shard index for all histograms. The shards are
+// merged when the histogram is snapshotted.
+//
+// With more threads than shards, some threads share a shard. Concurrent
+// accumulation into a shared shard has the same (accepted) races as
+// accumulation into a plain SampleVector.
+
+#ifndef BASE_METRICS_THREAD_SHARDED_SAMPLES_H_
+#define BASE_METRICS_THREAD_SHARDED_SAMPLES_H_
+
+#include "base/atomicops.h"
+#include "base/base_export.h"
+#include "base/basictypes.h"
+#include "base/metrics/histogram_base.h"
+
+namespace base {
+
+class BucketRanges;
+class HistogramSamples;
+class SampleVector;
+
+class BASE_EXPORT_PRIVATE ThreadShardedSamples {
+ public:
+  static const size_t kNumShards = 8;
+
+  explicit ThreadShardedSamples(const BucketRanges* bucket_ranges);
+  ~ThreadShardedSamples();
+
+  // Adds |count| samples of |value| to the shard of the current thread. The
+  // shard is created on first use.
+  void Accumulate(HistogramBase::Sample value, HistogramBase::Count count);
+
+  // Adds the samples of all shards to |samples|.
+  void AddTo(HistogramSamples* samples) const;
+
+  // Returns the shard index of the current thread.
+  static size_t GetShardIndexForCurrentThread();
+
+ private:
+  const BucketRanges* const bucket_ranges_;
+
+  // The shards, as SampleVector pointers. NULL until first used.
+  subtle::AtomicWord shards_[kNumShards];
+
+  DISALLOW_COPY_AND_ASSIGN(ThreadShardedSamples);
+};
+
+}  // namespace base
+
+#endif  // BASE_METRICS_THREAD_SHARDED_SAMPLES_H_
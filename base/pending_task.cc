@@ -30,9 +30,32 @@ PendingTask::PendingTask(const tracked_objects::Location& posted_from,
       is_high_res(false) {
 }
 
+PendingTask::PendingTask(const PendingTask& other) = default;
+
+PendingTask::PendingTask(PendingTask&& other)
+    : base::TrackingInfo(other),
+      task(static_cast<Closure&&>(other.task)),
+      posted_from(other.posted_from),
+      sequence_num(other.sequence_num),
+      nestable(other.nestable),
+      is_high_res(other.is_high_res) {
+}
+
 PendingTask::~PendingTask() {
 }
 
+PendingTask& PendingTask::operator=(const PendingTask& other) = default;
+
+PendingTask& PendingTask::operator=(PendingTask&& other) {
+  TrackingInfo::operator=(other);
+  task = static_cast<Closure&&>(other.task);
+  posted_from = other.posted_from;
+  sequence_num = other.sequence_num;
+  nestable = other.nestable;
+  is_high_res = other.is_high_res;
+  return *this;
+}
+
 bool PendingTask::operator<(const PendingTask& other) const {
   // Since the top of a priority queue is defined as the "greatest" element, we
   // need to invert the comparison here.  We want the smaller time to be at the
@@ -53,4 +76,14 @@ void TaskQueue::Swap(TaskQueue* queue) {
   c.swap(queue->c);  // Calls std::deque::swap.
 }
 
+void TaskQueue::Push(PendingTask* pending_task) {
+  push(static_cast<PendingTask&&>(*pending_task));
+}
+
+PendingTask TaskQueue::TakeFront() {
+  PendingTask pending_task(static_cast<PendingTask&&>(front()));
+  pop();
+  return pending_task;
+}
+
 }  // namespace base
@@ -24,8 +24,15 @@ struct BASE_EXPORT PendingTask : public TrackingInfo {
               const Closure& task,
               TimeTicks delayed_run_time,
               bool nestable);
+  PendingTask(const PendingTask& other);
+  // Moves |other|'s task rather than copying it. |other.task| is null
+  // afterwards.
+  PendingTask(PendingTask&& other);
   ~PendingTask();
 
+  PendingTask& operator=(const PendingTask& other);
+  PendingTask& operator=(PendingTask&& other);
+
   // Used to support sorting.
   bool operator<(const PendingTask& other) const;
 
@@ -45,11 +52,18 @@ struct BASE_EXPORT PendingTask : public TrackingInfo {
   bool is_high_res;
 };
 
-// Wrapper around std::queue specialized for PendingTask which adds a Swap
-// helper method.
+// Wrapper around std::queue specialized for PendingTask which adds helper
+// methods to swap queues and to move tasks in and out without copying their
+// closures.
 class BASE_EXPORT TaskQueue : public std::queue<PendingTask> {
  public:
   void Swap(TaskQueue* queue);
+
+  // Appends |pending_task|, leaving |pending_task->task| null.
+  void Push(PendingTask* pending_task);
+
+  // Removes the task at the front of the queue and returns it.
+  PendingTask TakeFront();
 };
 
 // PendingTasks are sorted by their |delayed_run_time| property.
@@ -5,6 +5,7 @@
 #include "base/pickle.h"
 
 #include <stdlib.h>
+#include <string.h>
 
 #include <algorithm>  // for max()
 
@@ -16,12 +17,17 @@ using base::string16;
 // static
 const int Pickle::kPayloadUnit = 64;
 
+// static
+const size_t Pickle::kMinDataSizeByReference = 4096;
+
 static const size_t kCapacityReadOnly = static_cast<size_t>(-1);
 
+// Only the part of the payload before the first attachment is in the buffer.
 PickleIterator::PickleIterator(const Pickle& pickle)
     : payload_(pickle.payload()),
       read_index_(0),
-      end_index_(pickle.payload_size()) {
+      end_index_(pickle.attachments_.empty() ? pickle.payload_size()
+                                             : pickle.attachments_[0].offset) {
 }
 
 template <typename Type>
@@ -194,13 +200,22 @@ bool PickleIterator::ReadBytes(const char** data, int length) {
   return true;
 }
 
+Pickle::Attachment::Attachment() : offset(0) {
+}
+
+Pickle::Attachment::~Attachment() {
+}
+
 // Payload is uint32 aligned.
 
 Pickle::Pickle()
     : header_(NULL),
       header_size_(sizeof(Header)),
       capacity_after_header_(0),
-      write_offset_(0) {
+      write_offset_(0),
+      allocator_(NULL),
+      owns_buffer_(true),
+      attached_size_(0) {
   Resize(kPayloadUnit);
   header_->payload_size = 0;
 }
@@ -209,18 +224,55 @@ Pickle::Pickle(int header_size)
     : header_(NULL),
       header_size_(AlignInt(header_size, sizeof(uint32))),
       capacity_after_header_(0),
-      write_offset_(0) {
+      write_offset_(0),
+      allocator_(NULL),
+      owns_buffer_(true),
+      attached_size_(0) {
+  DCHECK_GE(static_cast<size_t>(header_size), sizeof(Header));
+  DCHECK_LE(header_size, kPayloadUnit);
+  Resize(kPayloadUnit);
+  header_->payload_size = 0;
+}
+
+Pickle::Pickle(int header_size, Allocator* allocator)
+    : header_(NULL),
+      header_size_(AlignInt(header_size, sizeof(uint32))),
+      capacity_after_header_(0),
+      write_offset_(0),
+      allocator_(allocator),
+      owns_buffer_(true),
+      attached_size_(0) {
   DCHECK_GE(static_cast<size_t>(header_size), sizeof(Header));
   DCHECK_LE(header_size, kPayloadUnit);
+  DCHECK(allocator);
   Resize(kPayloadUnit);
   header_->payload_size = 0;
 }
 
+Pickle::Pickle(int header_size, void* buffer, size_t buffer_size)
+    : header_(reinterpret_cast<Header*>(buffer)),
+      header_size_(AlignInt(header_size, sizeof(uint32))),
+      capacity_after_header_(0),
+      write_offset_(0),
+      allocator_(NULL),
+      owns_buffer_(false),
+      attached_size_(0) {
+  DCHECK_GE(static_cast<size_t>(header_size), sizeof(Header));
+  DCHECK_LE(header_size, kPayloadUnit);
+  DCHECK_EQ(0u, reinterpret_cast<uintptr_t>(buffer) % sizeof(uint32));
+  CHECK_GE(buffer_size, header_size_);
+  capacity_after_header_ = buffer_size - header_size_;
+  header_->payload_size = 0;
+}
+
 Pickle::Pickle(const char* data, int data_len)
     : header_(reinterpret_cast<Header*>(const_cast<char*>(data))),
       header_size_(0),
       capacity_after_header_(kCapacityReadOnly),
-      write_offset_(0) {
+      write_offset_(0),
+      allocator_(NULL),
+      owns_buffer_(false),
+      attached_size_(0) {
   if (data_len >= static_cast<int>(sizeof(Header)))
     header_size_ = data_len - header_->payload_size;
 
@@ -239,15 +291,18 @@ Pickle::Pickle(const Pickle& other)
     : header_(NULL),
       header_size_(other.header_size_),
       capacity_after_header_(0),
-      write_offset_(other.write_offset_) {
-  size_t payload_size = header_size_ + other.header_->payload_size;
+      write_offset_(other.write_offset_),
+      allocator_(NULL),
+      owns_buffer_(true),
+      attached_size_(0) {
+  size_t payload_size = header_size_ + other.buffer_payload_size();
   Resize(payload_size);
   memcpy(header_, other.header_, payload_size);
+  CopyAttachmentsFrom(other);
 }
 
 Pickle::~Pickle() {
-  if (capacity_after_header_ != kCapacityReadOnly)
-    free(header_);
+  FreeBuffer();
 }
 
 Pickle& Pickle::operator=(const Pickle& other) {
@@ -255,19 +310,26 @@ Pickle& Pickle::operator=(const Pickle& other) {
     NOTREACHED();
     return *this;
   }
-  if (capacity_after_header_ == kCapacityReadOnly) {
+  if (!owns_buffer_) {
+    // Don't write into a buffer we were given; the copy lives on the heap.
     header_ = NULL;
     capacity_after_header_ = 0;
+    owns_buffer_ = true;
   }
   if (header_size_ != other.header_size_) {
-    free(header_);
+    FreeBuffer();
     header_ = NULL;
+    capacity_after_header_ = 0;
     header_size_ = other.header_size_;
   }
-  Resize(other.header_->payload_size);
+  attachments_.clear();
+  attached_size_ = 0;
+  write_offset_ = 0;
+  Resize(other.buffer_payload_size());
   memcpy(header_, other.header_,
-         other.header_size_ + other.header_->payload_size);
+         other.header_size_ + other.buffer_payload_size());
   write_offset_ = other.write_offset_;
+  CopyAttachmentsFrom(other);
   return *this;
 }
 
@@ -303,6 +365,88 @@ bool Pickle::WriteBytes(const void* data, int length) {
   return true;
 }
 
+bool Pickle::WriteDataByReference(
+    const scoped_refptr<base::RefCountedMemory>& data) {
+  size_t length = data->size();
+  if (length < kMinDataSizeByReference ||
+      length > static_cast<size_t>(kint32max)) {
+    return WriteData(reinterpret_cast<const char*>(data->front()),
+                     static_cast<int>(length));
+  }
+  DCHECK_NE(kCapacityReadOnly, capacity_after_header_)
+      << "oops: pickle is readonly";
+  if (!WriteInt(static_cast<int>(length)))
+    return false;
+
+  Attachment attachment;
+  attachment.offset = write_offset_;
+  attachment.data = data;
+  attachments_.push_back(attachment);
+  attached_size_ += length;
+
+  // Pad like WriteBytes() would. The padding follows the data, so it goes in
+  // the buffer, which leaves the buffer itself unaligned.
+  size_t padding = AlignInt(length, sizeof(uint32)) - length;
+  if (write_offset_ + padding > capacity_after_header_)
+    Resize(std::max(capacity_after_header_ * 2, write_offset_ + padding));
+  memset(mutable_payload() + write_offset_, 0, padding);
+  write_offset_ += padding;
+  DCHECK_LE(write_offset_, kuint32max - attached_size_);
+  header_->payload_size = static_cast<uint32>(write_offset_ + attached_size_);
+  return true;
+}
+
+void Pickle::GetSegments(std::vector<Segment>* segments) const {
+  const char* buffer = reinterpret_cast<const char*>(header_);
+  size_t start = 0;
+  for (size_t i = 0; i < attachments_.size(); ++i) {
+    size_t end = header_size_ + attachments_[i].offset;
+    if (end > start) {
+      Segment segment = {buffer + start, end - start};
+      segments->push_back(segment);
+    }
+    Segment attached = {
+        reinterpret_cast<const char*>(attachments_[i].data->front()),
+        attachments_[i].data->size()};
+    segments->push_back(attached);
+    start = end;
+  }
+  size_t end = header_size_ + buffer_payload_size();
+  if (end > start) {
+    Segment segment = {buffer + start, end - start};
+    segments->push_back(segment);
+  }
+}
+
+void Pickle::Flatten() {
+  if (attachments_.empty())
+    return;
+  size_t buffer_size = write_offset_;
+  size_t total_size = write_offset_ + attached_size_;
+  if (total_size > capacity_after_header_)
+    Resize(total_size);
+
+  // Working backwards, move each run of the buffer that follows an
+  // attachment to its final place, and copy the attachment in front of it.
+  char* payload = mutable_payload();
+  size_t from_end = buffer_size;
+  size_t to_end = total_size;
+  for (size_t i = attachments_.size(); i-- > 0;) {
+    const Attachment& attachment = attachments_[i];
+    size_t run = from_end - attachment.offset;
+    memmove(payload + to_end - run, payload + attachment.offset, run);
+    to_end -= run + attachment.data->size();
+    memcpy(payload + to_end, attachment.data->front(),
+           attachment.data->size());
+    from_end = attachment.offset;
+  }
+  DCHECK_EQ(from_end, to_end);
+
+  attachments_.clear();
+  attached_size_ = 0;
+  write_offset_ = total_size;
+}
+
 void Pickle::Reserve(size_t length) {
   size_t data_len = AlignInt(length, sizeof(uint32));
   DCHECK_GE(data_len, length);
@@ -319,12 +463,40 @@ void Pickle::Resize(size_t new_capacity) {
   new_capacity = AlignInt(new_capacity, kPayloadUnit);
 
   CHECK_NE(capacity_after_header_, kCapacityReadOnly);
-  void* p = realloc(header_, header_size_ + new_capacity);
+  void* p;
+  if (owns_buffer_ && !allocator_) {
+    p = realloc(header_, header_size_ + new_capacity);
+  } else {
+    p = allocator_ ? allocator_->Allocate(header_size_ + new_capacity)
+                   : malloc(header_size_ + new_capacity);
+    if (p && header_)
+      memcpy(p, header_, header_size_ + write_offset_);
+    FreeBuffer();
+    owns_buffer_ = true;
+  }
   CHECK(p);
   header_ = reinterpret_cast<Header*>(p);
   capacity_after_header_ = new_capacity;
 }
 
+void Pickle::FreeBuffer() {
+  if (!owns_buffer_ || !header_)
+    return;
+  if (allocator_)
+    allocator_->Free(header_);
+  else
+    free(header_);
+}
+
+void Pickle::CopyAttachmentsFrom(const Pickle& other) {
+  if (other.attachments_.empty())
+    return;
+  attachments_ = other.attachments_;
+  attached_size_ = other.attached_size_;
+  header_->payload_size = other.header_->payload_size;
+  Flatten();
+}
+
 // static
 const char* Pickle::FindNext(size_t header_size,
                              const char* start,
@@ -367,6 +539,41 @@ inline void Pickle::WriteBytesCommon(const void* data, size_t length) {
   char* write = mutable_payload() + write_offset_;
   memcpy(write, data, length);
   memset(write + length, 0, data_len - length);
-  header_->payload_size = static_cast<uint32>(new_size);
+  header_->payload_size = static_cast<uint32>(new_size + attached_size_);
   write_offset_ = new_size;
 }
+
+PickleArena::PickleArena(size_t block_size)
+    : block_size_(block_size), next_(NULL), remaining_(0) {
+}
+
+PickleArena::~PickleArena() {
+  for (size_t i = 0; i < blocks_.size(); ++i)
+    free(blocks_[i]);
+}
+
+void* PickleArena::Allocate(size_t size) {
+  // Keep every allocation aligned like malloc().
+  const size_t kAlignment = 16;
+  size = (size + kAlignment - 1) & ~(kAlignment - 1);
+  if (size > remaining_) {
+    size_t block_size = std::max(size, block_size_);
+    char* block = static_cast<char*>(malloc(block_size));
+    CHECK(block);
+    blocks_.push_back(block);
+    // Keep using the old block if a large allocation got a block of its own
+    // and the old one has more room left.
+    if (block_size - size < remaining_)
+      return block;
+    next_ = block;
+    remaining_ = block_size;
+  }
+  void* result = next_;
+  next_ += size;
+  remaining_ -= size;
+  return result;
+}
+
+void PickleArena::Free(void* block) {
+  // Blocks are freed with the arena.
+}
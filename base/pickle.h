@@ -6,12 +6,15 @@
 #define BASE_PICKLE_H__
 
 #include <string>
+#include <vector>
 
 #include "base/base_export.h"
 #include "base/basictypes.h"
 #include "base/compiler_specific.h"
 #include "base/gtest_prod_util.h"
 #include "base/logging.h"
+#include "base/memory/ref_counted.h"
+#include "base/memory/ref_counted_memory.h"
 #include "base/strings/string16.h"
 
 class Pickle;
@@ -118,8 +121,36 @@ class BASE_EXPORT PickleIterator {
 // space is controlled by the header_size parameter passed to the Pickle
 // constructor.
 //
+// By default the buffer lives on the heap. It can instead start out in a
+// buffer provided by the caller, or come from an Allocator such as a
+// PickleArena. Large blobs can be attached by reference with
+// WriteDataByReference(), in which case the data is made up of several
+// segments (see GetSegments()) until Flatten() is called.
+//
 class BASE_EXPORT Pickle {
  public:
+  // Supplies the memory for a Pickle's buffer instead of the heap.
+  class BASE_EXPORT Allocator {
+   public:
+    virtual ~Allocator() {}
+
+    // Returns a block of at least |size| bytes, aligned like malloc().
+    virtual void* Allocate(size_t size) = 0;
+
+    // Releases a block returned by Allocate().
+    virtual void Free(void* block) = 0;
+  };
+
+  // A contiguous piece of a Pickle's data.
+  struct Segment {
+    const char* data;
+    size_t size;
+  };
+
+  // Data passed to WriteDataByReference() that is smaller than this is copied
+  // anyway.
+  static const size_t kMinDataSizeByReference;
+
   // Initialize a Pickle object using the default header size.
   Pickle();
 
@@ -128,13 +159,23 @@ class BASE_EXPORT Pickle {
   // will be rounded up to ensure that the header size is 32bit-aligned.
   explicit Pickle(int header_size);
 
+  // Initializes a Pickle that gets its buffer from |allocator|, which must
+  // outlive the Pickle.
+  Pickle(int header_size, Allocator* allocator);
+
+  // Initializes a Pickle that writes into |buffer|, which must be 32bit-aligned
+  // and outlive the Pickle, and is at least |header_size| bytes long. If the
+  // data outgrows |buffer_size|, it is moved to the heap.
+  Pickle(int header_size, void* buffer, size_t buffer_size);
+
   // Initializes a Pickle from a const block of data.  The data is not copied;
   // instead the data is merely referenced by this Pickle.  Only const methods
   // should be used on the Pickle when initialized this way.  The header
   // padding size is deduced from the data length.
   Pickle(const char* data, int data_len);
 
-  // Initializes a Pickle as a deep copy of another Pickle.
+  // Initializes a Pickle as a deep copy of another Pickle. The copy lives on
+  // the heap, and holds a copy of any data |other| refers to.
   Pickle(const Pickle& other);
 
   // Note: There are no virtual methods in this class.  This destructor is
@@ -150,8 +191,25 @@ class BASE_EXPORT Pickle {
   // Returns the size of the Pickle's data.
   size_t size() const { return header_size_ + header_->payload_size; }
 
-  // Returns the data for this Pickle.
-  const void* data() const { return header_; }
+  // Returns the data for this Pickle. Must not be called while the Pickle
+  // refers to external data.
+  const void* data() const {
+    DCHECK(attachments_.empty()) << "Flatten() first";
+    return header_;
+  }
+
+  // Appends the pieces that make up the data of this Pickle to |segments|, in
+  // order. Unless the Pickle refers to external data, that is the one piece
+  // data() points to. The pieces are valid until the Pickle is modified.
+  void GetSegments(std::vector<Segment>* segments) const;
+
+  // Returns whether WriteDataByReference() attached data that isn't in the
+  // Pickle's own buffer.
+  bool has_external_data() const { return !attachments_.empty(); }
+
+  // Copies the data the Pickle refers to into its own buffer, so that data()
+  // covers all of it.
+  void Flatten();
 
   // Methods for adding to the payload of the Pickle.  These values are
   // appended to the end of the Pickle's payload.  When reading values from a
@@ -205,6 +263,11 @@ class BASE_EXPORT Pickle {
   // when reading and writing. It is normally used to serialize PoD types of a
   // known size. See also WriteData.
   bool WriteBytes(const void* data, int length);
+  // Like WriteData(), but holds a reference to |data| instead of copying it
+  // into the Pickle's buffer. Reads from a PickleIterator on this side stop
+  // where the first such data starts; the Pickle reads normally once it has
+  // been flattened, or sent and received.
+  bool WriteDataByReference(const scoped_refptr<base::RefCountedMemory>& data);
 
   // Reserves space for upcoming writes when multiple writes will be made and
   // their sizes are computed in advance. It can be significantly faster to call
@@ -240,8 +303,10 @@ class BASE_EXPORT Pickle {
   }
 
   // Returns the address of the byte immediately following the currently valid
-  // header + payload.
+  // header + payload. Must not be called while the Pickle refers to external
+  // data.
   const char* end_of_payload() const {
+    DCHECK(attachments_.empty());
     // This object may be invalid.
     return header_ ? payload() + payload_size() : NULL;
   }
@@ -276,14 +341,43 @@ class BASE_EXPORT Pickle {
  private:
   friend class PickleIterator;
 
+  // Data written by WriteDataByReference().
+  struct Attachment {
+    Attachment();
+    ~Attachment();
+
+    // The offset in the buffer, after the header, that the data goes at.
+    size_t offset;
+    scoped_refptr<base::RefCountedMemory> data;
+  };
+
+  // Releases |header_| if the Pickle owns it.
+  void FreeBuffer();
+
+  // Copies the attachments of |other|, then flattens them into the buffer.
+  void CopyAttachmentsFrom(const Pickle& other);
+
+  // The size of the payload held in the buffer.
+  size_t buffer_payload_size() const {
+    return header_ ? header_->payload_size - attached_size_ : 0;
+  }
+
   Header* header_;
   size_t header_size_;  // Supports extra data between header and payload.
   // Allocation size of payload (or -1 if allocation is const). Note: this
   // doesn't count the header.
   size_t capacity_after_header_;
   // The offset at which we will write the next field. Note: this doesn't count
-  // the header.
+  // the header or attachments.
   size_t write_offset_;
+  // Where the buffer comes from; NULL for the heap.
+  Allocator* allocator_;
+  // False if |header_| is const or was provided by the caller.
+  bool owns_buffer_;
+  // Data referred to rather than held in the buffer, ordered by offset, and
+  // its total size.
+  std::vector<Attachment> attachments_;
+  size_t attached_size_;
 
   // Just like WriteBytes, but with a compile-time size, for performance.
   template<size_t length> void BASE_EXPORT WriteBytesStatic(const void* data);
@@ -301,4 +395,28 @@ class BASE_EXPORT Pickle {
   FRIEND_TEST_ALL_PREFIXES(PickleTest, FindNextOverflow);
 };
 
+// A Pickle::Allocator that carves buffers out of large blocks, which are only
+// freed when the arena is destroyed. For batches of short-lived Pickles, such
+// as messages that are built and sent together, this replaces a malloc() and
+// free() per Pickle, and per time a Pickle grows, with a pointer bump. Not
+// thread safe.
+class BASE_EXPORT PickleArena : public Pickle::Allocator {
+ public:
+  explicit PickleArena(size_t block_size);
+  ~PickleArena() override;
+
+  // Pickle::Allocator:
+  void* Allocate(size_t size) override;
+  void Free(void* block) override;
+
+ private:
+  const size_t block_size_;
+  std::vector<char*> blocks_;
+  // The unused part of the last block.
+  char* next_;
+  size_t remaining_;
+
+  DISALLOW_COPY_AND_ASSIGN(PickleArena);
+};
+
 #endif  // BASE_PICKLE_H__
@@ -2,9 +2,13 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 
+#include <string.h>
+
 #include <string>
+#include <vector>
 
 #include "base/basictypes.h"
+#include "base/memory/ref_counted_memory.h"
 #include "base/memory/scoped_ptr.h"
 #include "base/pickle.h"
 #include "base/strings/string16.h"
@@ -427,3 +431,119 @@ TEST(PickleTest, ReadBytes) {
   memcpy(&outdata, outdata_char, sizeof(outdata));
   EXPECT_EQ(data, outdata);
 }
+
+TEST(PickleTest, CallerProvidedBuffer) {
+  uint32 buffer[32];
+  Pickle pickle(sizeof(Pickle::Header), buffer, sizeof(buffer));
+  EXPECT_TRUE(pickle.WriteInt(1));
+  EXPECT_TRUE(pickle.WriteString("in the caller's buffer"));
+  EXPECT_EQ(static_cast<const void*>(buffer), pickle.data());
+
+  // Outgrowing the buffer moves the data to the heap.
+  std::string long_string(1000, 'x');
+  EXPECT_TRUE(pickle.WriteString(long_string));
+  EXPECT_NE(static_cast<const void*>(buffer), pickle.data());
+
+  PickleIterator iter(pickle);
+  int value;
+  std::string str;
+  EXPECT_TRUE(iter.ReadInt(&value));
+  EXPECT_EQ(1, value);
+  EXPECT_TRUE(iter.ReadString(&str));
+  EXPECT_EQ("in the caller's buffer", str);
+  EXPECT_TRUE(iter.ReadString(&str));
+  EXPECT_EQ(long_string, str);
+}
+
+TEST(PickleTest, Arena) {
+  PickleArena arena(4096);
+  Pickle small(sizeof(Pickle::Header), &arena);
+  Pickle large(sizeof(Pickle::Header), &arena);
+  for (int i = 0; i < 1000; ++i) {
+    EXPECT_TRUE(small.WriteInt(i));
+    EXPECT_TRUE(large.WriteInt(i));
+    EXPECT_TRUE(large.WriteString("grows"));
+  }
+  PickleIterator small_iter(small);
+  PickleIterator large_iter(large);
+  for (int i = 0; i < 1000; ++i) {
+    int value;
+    std::string str;
+    EXPECT_TRUE(small_iter.ReadInt(&value));
+    EXPECT_EQ(i, value);
+    EXPECT_TRUE(large_iter.ReadInt(&value));
+    EXPECT_EQ(i, value);
+    EXPECT_TRUE(large_iter.ReadString(&str));
+  }
+
+  // Copies live on the heap.
+  Pickle copy(large);
+  EXPECT_EQ(large.size(), copy.size());
+  EXPECT_EQ(0, memcmp(large.data(), copy.data(), large.size()));
+}
+
+TEST(PickleTest, WriteDataByReference) {
+  scoped_refptr<base::RefCountedString> first(new base::RefCountedString);
+  first->data().assign(Pickle::kMinDataSizeByReference + 1, 'a');
+  scoped_refptr<base::RefCountedString> small(new base::RefCountedString);
+  small->data().assign(10, 'b');
+  scoped_refptr<base::RefCountedString> second(new base::RefCountedString);
+  second->data().assign(Pickle::kMinDataSizeByReference, 'c');
+
+  Pickle pickle;
+  Pickle expected;
+  EXPECT_TRUE(pickle.WriteInt(1));
+  EXPECT_TRUE(expected.WriteInt(1));
+  for (int i = 0; i < 2; ++i) {
+    EXPECT_TRUE(pickle.WriteDataByReference(first));
+    EXPECT_TRUE(expected.WriteData(first->data().data(), first->size()));
+    EXPECT_TRUE(pickle.WriteString("between"));
+    EXPECT_TRUE(expected.WriteString("between"));
+    EXPECT_TRUE(pickle.WriteDataByReference(small));
+    EXPECT_TRUE(expected.WriteData(small->data().data(), small->size()));
+    EXPECT_TRUE(pickle.WriteDataByReference(second));
+    EXPECT_TRUE(expected.WriteData(second->data().data(), second->size()));
+  }
+  EXPECT_TRUE(pickle.WriteInt(2));
+  EXPECT_TRUE(expected.WriteInt(2));
+  EXPECT_TRUE(pickle.has_external_data());
+  ASSERT_EQ(expected.size(), pickle.size());
+
+  // The small data was copied, and the rest is referred to.
+  std::vector<Pickle::Segment> segments;
+  pickle.GetSegments(&segments);
+  ASSERT_EQ(9u, segments.size());
+  EXPECT_EQ(first->front_as<char>(), segments[1].data);
+  EXPECT_EQ(second->front_as<char>(), segments[3].data);
+  std::string data;
+  for (size_t i = 0; i < segments.size(); ++i)
+    data.append(segments[i].data, segments[i].size);
+  EXPECT_EQ(std::string(static_cast<const char*>(expected.data()),
+                        expected.size()),
+            data);
+
+  // Reading stops at the first reference.
+  PickleIterator iter(pickle);
+  int value;
+  const char* read_data;
+  int read_length;
+  EXPECT_TRUE(iter.ReadInt(&value));
+  EXPECT_FALSE(iter.ReadData(&read_data, &read_length));
+
+  // Copies hold all the data.
+  Pickle copy(pickle);
+  EXPECT_FALSE(copy.has_external_data());
+  EXPECT_EQ(data, std::string(static_cast<const char*>(copy.data()),
+                              copy.size()));
+
+  // As does a flattened Pickle, which can be read and written as usual.
+  pickle.Flatten();
+  EXPECT_FALSE(pickle.has_external_data());
+  EXPECT_EQ(data, std::string(static_cast<const char*>(pickle.data()),
+                              pickle.size()));
+  EXPECT_TRUE(pickle.WriteInt(3));
+  iter = PickleIterator(pickle);
+  EXPECT_TRUE(iter.ReadInt(&value));
+  EXPECT_TRUE(iter.ReadData(&read_data, &read_length));
+  EXPECT_EQ(first->data(), std::string(read_data, read_length));
+}
@@ -25,12 +25,12 @@ namespace base {
 
 namespace {
 
-void TrimKeyValuePairs(StringPairs* pairs) {
+void TrimKeyValuePairs(StringPiecePairs* pairs) {
   DCHECK(pairs);
-  StringPairs& p_ref = *pairs;
+  StringPiecePairs& p_ref = *pairs;
   for (size_t i = 0; i < p_ref.size(); ++i) {
-    TrimWhitespaceASCII(p_ref[i].first, TRIM_ALL, &p_ref[i].first);
-    TrimWhitespaceASCII(p_ref[i].second, TRIM_ALL, &p_ref[i].second);
+    p_ref[i].first = TrimWhitespaceASCII(p_ref[i].first, TRIM_ALL);
+    p_ref[i].second = TrimWhitespaceASCII(p_ref[i].second, TRIM_ALL);
   }
 }
 
@@ -60,15 +60,15 @@ size_t ReadProcStatusAndGetFieldAsSizeT(pid_t pid, const std::string& field) {
       return 0;
   }
 
-  StringPairs pairs;
-  SplitStringIntoKeyValuePairs(status, ':', '\n', &pairs);
+  StringPiecePairs pairs;
+  SplitStringPieceIntoKeyValuePairs(status, ':', '\n', &pairs);
   TrimKeyValuePairs(&pairs);
   for (size_t i = 0; i < pairs.size(); ++i) {
-    const std::string& key = pairs[i].first;
-    const std::string& value_str = pairs[i].second;
+    const StringPiece& key = pairs[i].first;
+    const StringPiece& value_str = pairs[i].second;
     if (key == field) {
-      std::vector<std::string> split_value_str;
-      SplitString(value_str, ' ', &split_value_str);
+      std::vector<StringPiece> split_value_str;
+      SplitStringPiece(value_str, " ", TRIM_WHITESPACE, &split_value_str);
       if (split_value_str.size() != 2 || split_value_str[1] != "kB") {
         NOTREACHED();
         return 0;
@@ -101,12 +101,12 @@ bool ReadProcSchedAndGetFieldAsUint64(pid_t pid,
       return false;
   }
 
-  StringPairs pairs;
-  SplitStringIntoKeyValuePairs(sched_data, ':', '\n', &pairs);
+  StringPiecePairs pairs;
+  SplitStringPieceIntoKeyValuePairs(sched_data, ':', '\n', &pairs);
   TrimKeyValuePairs(&pairs);
   for (size_t i = 0; i < pairs.size(); ++i) {
-    const std::string& key = pairs[i].first;
-    const std::string& value_str = pairs[i].second;
+    const StringPiece& key = pairs[i].first;
+    const StringPiece& value_str = pairs[i].second;
     if (key == field) {
       uint64 value;
       if (!StringToUint64(value_str, &value))
@@ -251,12 +251,12 @@ bool ProcessMetrics::GetIOCounters(IoCounters* io_counters) const {
   io_counters->OtherOperationCount = 0;
   io_counters->OtherTransferCount = 0;
 
-  StringPairs pairs;
-  SplitStringIntoKeyValuePairs(proc_io_contents, ':', '\n', &pairs);
+  StringPiecePairs pairs;
+  SplitStringPieceIntoKeyValuePairs(proc_io_contents, ':', '\n', &pairs);
   TrimKeyValuePairs(&pairs);
   for (size_t i = 0; i < pairs.size(); ++i) {
-    const std::string& key = pairs[i].first;
-    const std::string& value_str = pairs[i].second;
+    const StringPiece& key = pairs[i].first;
+    const StringPiece& value_str = pairs[i].second;
     uint64* target_counter = NULL;
     if (key == "syscr")
       target_counter = &io_counters->ReadOperationCount;
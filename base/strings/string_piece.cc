@@ -5,12 +5,29 @@
 
 #include "base/strings/string_piece.h"
 
+#include <string.h>
+
 #include <algorithm>
 #include <ostream>
 
+#include "base/logging.h"
+#include "build/build_config.h"
+
+#if defined(ARCH_CPU_X86_FAMILY) && !defined(OS_NACL)
+#define STRING_PIECE_USE_SSE2
+#include <emmintrin.h>
+#if defined(COMPILER_MSVC)
+#include <intrin.h>
+#endif
+#endif
+
 namespace base {
 namespace {
 
+// find_first_of() compares up to this many characters directly, and builds a
+// lookup table for more.
+const size_t kMaxDirectSearchCharacters = 4;
+
 // For each character in characters_wanted, sets the index corresponding
 // to the ASCII code of that character to 1 in table.  This is used by
 // the find_.*_of methods below to tell whether or not a character is in
@@ -28,6 +45,51 @@ inline void BuildLookupTable(const StringPiece& characters_wanted,
   }
 }
 
+#if defined(STRING_PIECE_USE_SSE2)
+inline int IndexOfLowestSetBit(int mask) {
+#if defined(COMPILER_MSVC)
+  unsigned long index;
+  _BitScanForward(&index, static_cast<unsigned long>(mask));
+  return static_cast<int>(index);
+#else
+  return __builtin_ctz(mask);
+#endif
+}
+#endif
+
+// Returns the index of the first character of |data| that is one of the
+// (at most kMaxDirectSearchCharacters) |characters_wanted|, or |length| if
+// there is none.
+size_t FindFirstOfFew(const char* data,
+                      size_t length,
+                      const StringPiece& characters_wanted) {
+  const size_t num_wanted = characters_wanted.length();
+  DCHECK_LE(num_wanted, kMaxDirectSearchCharacters);
+  size_t i = 0;
+#if defined(STRING_PIECE_USE_SSE2)
+  // Compare 16 characters against each wanted character at once.
+  __m128i wanted[kMaxDirectSearchCharacters];
+  for (size_t j = 0; j < num_wanted; ++j)
+    wanted[j] = _mm_set1_epi8(characters_wanted[j]);
+  for (; i + 16 <= length; i += 16) {
+    __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+    __m128i matches = _mm_cmpeq_epi8(block, wanted[0]);
+    for (size_t j = 1; j < num_wanted; ++j)
+      matches = _mm_or_si128(matches, _mm_cmpeq_epi8(block, wanted[j]));
+    int mask = _mm_movemask_epi8(matches);
+    if (mask)
+      return i + IndexOfLowestSetBit(mask);
+  }
+#endif
+  for (; i < length; ++i) {
+    for (size_t j = 0; j < num_wanted; ++j) {
+      if (data[i] == characters_wanted[j])
+        return i;
+    }
+  }
+  return length;
+}
+
 }  // namespace
 
 // MSVC doesn't like complex extern templates and DLLs.
@@ -112,8 +174,25 @@ size_t findT(const BasicStringPiece<STR>& self,
   return xpos + s.size() <= self.size() ? xpos : BasicStringPiece<STR>::npos;
 }
 
+// 8-bit version using memchr() to find candidates.
 size_t find(const StringPiece& self, const StringPiece& s, size_t pos) {
-  return findT(self, s, pos);
+  if (pos > self.size())
+    return StringPiece::npos;
+  if (s.empty())
+    return pos;
+
+  const char* start = self.data() + pos;
+  const char* end = self.data() + self.size();
+  while (static_cast<size_t>(end - start) >= s.size()) {
+    start = static_cast<const char*>(
+        memchr(start, s[0], (end - start) - s.size() + 1));
+    if (!start)
+      break;
+    if (memcmp(start + 1, s.data() + 1, s.size() - 1) == 0)
+      return static_cast<size_t>(start - self.data());
+    ++start;
+  }
+  return StringPiece::npos;
 }
 
 size_t find(const StringPiece16& self, const StringPiece16& s, size_t pos) {
@@ -134,7 +213,13 @@ size_t findT(const BasicStringPiece<STR>& self,
 }
 
 size_t find(const StringPiece& self, char c, size_t pos) {
-  return findT(self, c, pos);
+  if (pos >= self.size())
+    return StringPiece::npos;
+
+  const void* result = memchr(self.data() + pos, c, self.size() - pos);
+  return result ? static_cast<size_t>(static_cast<const char*>(result) -
+                                      self.data())
+                : StringPiece::npos;
 }
 
 size_t find(const StringPiece16& self, char16 c, size_t pos) {
@@ -203,6 +288,15 @@ size_t find_first_of(const StringPiece& self,
   if (s.size() == 1)
     return find(self, s.data()[0], pos);
 
+  if (pos >= self.size())
+    return StringPiece::npos;
+
+  if (s.size() <= kMaxDirectSearchCharacters) {
+    size_t i =
+        pos + FindFirstOfFew(self.data() + pos, self.size() - pos, s);
+    return i < self.size() ? i : StringPiece::npos;
+  }
+
   bool lookup[UCHAR_MAX + 1] = { false };
   BuildLookupTable(s, lookup);
   for (size_t i = pos; i < self.size(); ++i) {
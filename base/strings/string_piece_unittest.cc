@@ -518,6 +518,32 @@ TYPED_TEST(CommonStringPieceTest, CheckCustom) {
   ASSERT_TRUE(s4.empty());
 }
 
+// find() and find_first_of() look at several characters at a time, so check
+// matches at every position.
+TEST(StringPieceTest, FindAtEveryPosition) {
+  for (size_t length = 0; length < 40; ++length) {
+    for (size_t match = 0; match < length; ++match) {
+      std::string str(length, 'a');
+      str[match] = ':';
+      StringPiece piece(str);
+      EXPECT_EQ(match, piece.find(':'));
+      EXPECT_EQ(match, piece.find_first_of(",:"));
+      EXPECT_EQ(match, piece.find_first_of(",;=:"));
+      EXPECT_EQ(match, piece.find_first_of(",;=!?:"));
+      EXPECT_EQ(StringPiece::npos, piece.find_first_of(",:", match + 1));
+      if (match + 1 < length) {
+        str[match + 1] = 'b';
+        EXPECT_EQ(match, piece.find(":b"));
+        EXPECT_EQ(StringPiece::npos, piece.find(":b", match + 1));
+      }
+      EXPECT_EQ(StringPiece::npos, piece.find(":c"));
+    }
+    std::string str(length, 'a');
+    EXPECT_EQ(StringPiece::npos, StringPiece(str).find_first_of(",;"));
+    EXPECT_EQ(StringPiece::npos, StringPiece(str).find(':'));
+  }
+}
+
 TEST(StringPieceTest, CheckCustom) {
   StringPiece a("foobar");
   std::string s1("123");
@@ -35,32 +35,77 @@ void SplitStringT(const STR& str,
   }
 }
 
-bool SplitStringIntoKeyValue(const std::string& line,
+bool SplitStringIntoKeyValue(const StringPiece& line,
                              char key_value_delimiter,
-                             std::string* key,
-                             std::string* value) {
+                             StringPiece* key,
+                             StringPiece* value) {
   key->clear();
   value->clear();
 
   // Find the delimiter.
-  size_t end_key_pos = line.find_first_of(key_value_delimiter);
-  if (end_key_pos == std::string::npos) {
+  size_t end_key_pos = line.find(key_value_delimiter);
+  if (end_key_pos == StringPiece::npos) {
     DVLOG(1) << "cannot find delimiter in: " << line;
     return false;    // no delimiter
   }
-  key->assign(line, 0, end_key_pos);
+  *key = line.substr(0, end_key_pos);
 
   // Find the value string.
-  std::string remains(line, end_key_pos, line.size() - end_key_pos);
-  size_t begin_value_pos = remains.find_first_not_of(key_value_delimiter);
-  if (begin_value_pos == std::string::npos) {
+  size_t begin_value_pos =
+      line.find_first_not_of(key_value_delimiter, end_key_pos);
+  if (begin_value_pos == StringPiece::npos) {
     DVLOG(1) << "cannot parse value from line: " << line;
     return false;   // no value
   }
-  value->assign(remains, begin_value_pos, remains.size() - begin_value_pos);
+  *value = line.substr(begin_value_pos);
   return true;
 }
 
+// Calls |callback| with each of the non-empty, trimmed pairs of |line|, split
+// into a key and a value, and whether that succeeded.
+template <typename CALLBACK>
+bool SplitStringIntoKeyValuePairsT(const StringPiece& line,
+                                   char key_value_delimiter,
+                                   char key_value_pair_delimiter,
+                                   CALLBACK callback) {
+  std::vector<StringPiece> pairs;
+  SplitStringPiece(line, StringPiece(&key_value_pair_delimiter, 1),
+                   TRIM_WHITESPACE, &pairs);
+
+  bool success = true;
+  for (size_t i = 0; i < pairs.size(); ++i) {
+    // Don't add empty pairs into the result.
+    if (pairs[i].empty())
+      continue;
+
+    StringPiece key;
+    StringPiece value;
+    if (!SplitStringIntoKeyValue(pairs[i], key_value_delimiter, &key, &value)) {
+      // Don't return here, to allow for pairs without associated
+      // value or key; just record that the split failed.
+      success = false;
+    }
+    callback(key, value);
+  }
+  return success;
+}
+
+struct AppendStringPair {
+  explicit AppendStringPair(StringPairs* pairs) : pairs(pairs) {}
+  void operator()(const StringPiece& key, const StringPiece& value) {
+    pairs->push_back(std::make_pair(key.as_string(), value.as_string()));
+  }
+  StringPairs* pairs;
+};
+
+struct AppendStringPiecePair {
+  explicit AppendStringPiecePair(StringPiecePairs* pairs) : pairs(pairs) {}
+  void operator()(const StringPiece& key, const StringPiece& value) {
+    pairs->push_back(std::make_pair(key, value));
+  }
+  StringPiecePairs* pairs;
+};
+
 template <typename STR>
 void SplitStringUsingSubstrT(const STR& str,
                                     const STR& s,
@@ -144,31 +189,48 @@ void SplitString(const std::string& str,
   SplitStringT(str, c, true, r);
 }
 
+void SplitStringPiece(const StringPiece& str,
+                      const StringPiece& delimiters,
+                      WhitespaceHandling whitespace,
+                      std::vector<StringPiece>* r) {
+  r->clear();
+  size_t last = 0;
+  while (true) {
+    size_t end = str.find_first_of(delimiters, last);
+    bool is_last = end == StringPiece::npos;
+    if (is_last)
+      end = str.size();
+    StringPiece piece = str.substr(last, end - last);
+    if (whitespace == TRIM_WHITESPACE)
+      piece = TrimWhitespaceASCII(piece, TRIM_ALL);
+    // Like SplitString(), don't turn an empty or all-whitespace string into a
+    // vector of one empty piece.
+    if (!is_last || !r->empty() || !piece.empty())
+      r->push_back(piece);
+    if (is_last)
+      return;
+    last = end + 1;
+  }
+}
+
 bool SplitStringIntoKeyValuePairs(const std::string& line,
                                   char key_value_delimiter,
                                   char key_value_pair_delimiter,
                                   StringPairs* key_value_pairs) {
   key_value_pairs->clear();
+  return SplitStringIntoKeyValuePairsT(line, key_value_delimiter,
+                                       key_value_pair_delimiter,
+                                       AppendStringPair(key_value_pairs));
+}
 
-  std::vector<std::string> pairs;
-  SplitString(line, key_value_pair_delimiter, &pairs);
-
-  bool success = true;
-  for (size_t i = 0; i < pairs.size(); ++i) {
-    // Don't add empty pairs into the result.
-    if (pairs[i].empty())
-      continue;
-
-    std::string key;
-    std::string value;
-    if (!SplitStringIntoKeyValue(pairs[i], key_value_delimiter, &key, &value)) {
-      // Don't return here, to allow for pairs without associated
-      // value or key; just record that the split failed.
-      success = false;
-    }
-    key_value_pairs->push_back(make_pair(key, value));
-  }
-  return success;
+bool SplitStringPieceIntoKeyValuePairs(const StringPiece& line,
+                                       char key_value_delimiter,
+                                       char key_value_pair_delimiter,
+                                       StringPiecePairs* key_value_pairs) {
+  key_value_pairs->clear();
+  return SplitStringIntoKeyValuePairsT(line, key_value_delimiter,
+                                       key_value_pair_delimiter,
+                                       AppendStringPiecePair(key_value_pairs));
 }
 
 void SplitStringUsingSubstr(const string16& str,
@@ -11,6 +11,7 @@
 
 #include "base/base_export.h"
 #include "base/strings/string16.h"
+#include "base/strings/string_piece.h"
 
 namespace base {
 
@@ -43,6 +44,32 @@ BASE_EXPORT bool SplitStringIntoKeyValuePairs(const std::string& line,
                                               char key_value_pair_delimiter,
                                               StringPairs* key_value_pairs);
 
+// The same as SplitString, but splits at any of the characters in
+// |delimiters|, and puts pieces of |str| in |r| instead of copies. The pieces
+// are only valid as long as the data |str| points to. Whitespace is trimmed
+// from each piece when |whitespace| is TRIM_WHITESPACE.
+//
+// This doesn't allocate beyond growing |r|, so it suits hot parsing code that
+// only looks at each piece, or copies a few of them.
+enum WhitespaceHandling {
+  KEEP_WHITESPACE,
+  TRIM_WHITESPACE,
+};
+BASE_EXPORT void SplitStringPiece(const StringPiece& str,
+                                  const StringPiece& delimiters,
+                                  WhitespaceHandling whitespace,
+                                  std::vector<StringPiece>* r);
+
+typedef std::vector<std::pair<StringPiece, StringPiece> > StringPiecePairs;
+
+// The same as SplitStringIntoKeyValuePairs, but puts pieces of |line| in
+// |key_value_pairs| instead of copies.
+BASE_EXPORT bool SplitStringPieceIntoKeyValuePairs(
+    const StringPiece& line,
+    char key_value_delimiter,
+    char key_value_pair_delimiter,
+    StringPiecePairs* key_value_pairs);
+
 // The same as SplitString, but use a substring delimiter instead of a char.
 BASE_EXPORT void SplitStringUsingSubstr(const string16& str,
                                         const string16& s,
@@ -0,0 +1,101 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <string>
+#include <vector>
+
+#include "base/strings/string_piece.h"
+#include "base/strings/string_split.h"
+#include "base/time/time.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_test.h"
+
+namespace base {
+
+namespace {
+
+const size_t kTextSize = 1024 * 1024;
+const int kIterations = 20;
+
+// Repeats |sample| to make about kTextSize bytes of text.
+std::string MakeText(const std::string& sample) {
+  std::string text;
+  while (text.size() < kTextSize)
+    text += sample;
+  return text;
+}
+
+void PrintThroughput(const std::string& trace,
+                     const std::string& text_kind,
+                     size_t bytes,
+                     TimeDelta elapsed) {
+  perf_test::PrintResult(
+      trace, "_" + text_kind, "",
+      bytes * kIterations / (elapsed.InSecondsF() * 1024 * 1024), "MB/s",
+      true);
+}
+
+}  // namespace
+
+// Compares splitting a header-like list into strings and into pieces.
+TEST(StringSplitPerfTest, SplitString) {
+  std::string text = MakeText("text/html, application/xhtml+xml, image/webp, ");
+
+  std::vector<std::string> strings;
+  TimeTicks start = TimeTicks::HighResNow();
+  for (int i = 0; i < kIterations; ++i)
+    SplitString(text, ',', &strings);
+  PrintThroughput("split", "string", text.size(),
+                  TimeTicks::HighResNow() - start);
+
+  std::vector<StringPiece> pieces;
+  start = TimeTicks::HighResNow();
+  for (int i = 0; i < kIterations; ++i)
+    SplitStringPiece(text, ",", TRIM_WHITESPACE, &pieces);
+  PrintThroughput("split", "string_piece", text.size(),
+                  TimeTicks::HighResNow() - start);
+  EXPECT_EQ(strings.size(), pieces.size());
+}
+
+// Splits a cookie-like line on two delimiters, which searches for both at
+// once.
+TEST(StringSplitPerfTest, SplitStringPieceIntoKeyValuePairs) {
+  std::string text =
+      MakeText("SID=31d4d96e407aad42; lang=en-US; theme=dark-high-contrast;");
+
+  StringPairs string_pairs;
+  TimeTicks start = TimeTicks::HighResNow();
+  for (int i = 0; i < kIterations; ++i)
+    SplitStringIntoKeyValuePairs(text, '=', ';', &string_pairs);
+  PrintThroughput("key_value_pairs", "string", text.size(),
+                  TimeTicks::HighResNow() - start);
+
+  StringPiecePairs piece_pairs;
+  start = TimeTicks::HighResNow();
+  for (int i = 0; i < kIterations; ++i)
+    SplitStringPieceIntoKeyValuePairs(text, '=', ';', &piece_pairs);
+  PrintThroughput("key_value_pairs", "string_piece", text.size(),
+                  TimeTicks::HighResNow() - start);
+  EXPECT_EQ(string_pairs.size(), piece_pairs.size());
+}
+
+TEST(StringSplitPerfTest, FindFirstOf) {
+  // Long runs without a delimiter, as in a quoted cookie value.
+  std::string text = MakeText(std::string(200, 'x') + ";");
+
+  size_t found = 0;
+  TimeTicks start = TimeTicks::HighResNow();
+  for (int i = 0; i < kIterations; ++i) {
+    StringPiece piece(text);
+    for (size_t pos = piece.find_first_of(",;="); pos != StringPiece::npos;
+         pos = piece.find_first_of(",;=", pos + 1)) {
+      ++found;
+    }
+  }
+  PrintThroughput("find_first_of", "three_chars", text.size(),
+                  TimeTicks::HighResNow() - start);
+  EXPECT_EQ(text.size() / 201 * kIterations, found);
+}
+
+}  // namespace base
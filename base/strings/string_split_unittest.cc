@@ -291,6 +291,77 @@ TEST(StringSplitTest, StringSplitDontTrim) {
   EXPECT_EQ(r[1], "b\tcc");
 }
 
+TEST(StringSplitTest, SplitStringPiece) {
+  std::vector<StringPiece> r;
+
+  SplitStringPiece(std::string(), ",", TRIM_WHITESPACE, &r);
+  EXPECT_TRUE(r.empty());
+
+  SplitStringPiece("   ", ",", TRIM_WHITESPACE, &r);
+  EXPECT_TRUE(r.empty());
+
+  SplitStringPiece("   ", ",", KEEP_WHITESPACE, &r);
+  EXPECT_THAT(r, ElementsAre("   "));
+
+  SplitStringPiece(" a , b;c,, ;d ", ",;", TRIM_WHITESPACE, &r);
+  EXPECT_THAT(r, ElementsAre("a", "b", "c", "", "", "d"));
+
+  SplitStringPiece(" a , b;c,", ",;", KEEP_WHITESPACE, &r);
+  EXPECT_THAT(r, ElementsAre(" a ", " b", "c", ""));
+
+  // Long enough to be searched in blocks, with delimiters in every position.
+  std::string input;
+  for (int i = 0; i < 40; ++i)
+    input += std::string(i % 7, 'x') + ",;:="[i % 4];
+  SplitStringPiece(input, ",;:=", KEEP_WHITESPACE, &r);
+  ASSERT_EQ(41u, r.size());
+  for (int i = 0; i < 40; ++i)
+    EXPECT_EQ(std::string(i % 7, 'x'), r[i]);
+  EXPECT_TRUE(r[40].empty());
+}
+
+TEST(StringSplitTest, SplitStringPieceMatchesSplitString) {
+  const char* const kInputs[] = {
+    "", " ", "a", ",a,", "a,b,c", " a , b , c ", "\ta,,\t,b\n", ",,,",
+  };
+  for (size_t i = 0; i < arraysize(kInputs); ++i) {
+    std::vector<std::string> expected;
+    SplitString(kInputs[i], ',', &expected);
+    std::vector<StringPiece> pieces;
+    SplitStringPiece(kInputs[i], ",", TRIM_WHITESPACE, &pieces);
+    ASSERT_EQ(expected.size(), pieces.size()) << kInputs[i];
+    for (size_t j = 0; j < expected.size(); ++j)
+      EXPECT_EQ(expected[j], pieces[j]);
+
+    SplitStringDontTrim(kInputs[i], ',', &expected);
+    SplitStringPiece(kInputs[i], ",", KEEP_WHITESPACE, &pieces);
+    ASSERT_EQ(expected.size(), pieces.size()) << kInputs[i];
+    for (size_t j = 0; j < expected.size(); ++j)
+      EXPECT_EQ(expected[j], pieces[j]);
+  }
+}
+
+TEST(StringSplitTest, SplitStringPieceIntoKeyValuePairs) {
+  std::string line = " key1 : value1 ,key2,, key3::value3:x";
+  StringPiecePairs pairs;
+  EXPECT_FALSE(SplitStringPieceIntoKeyValuePairs(line, ':', ',', &pairs));
+  ASSERT_EQ(3u, pairs.size());
+  EXPECT_EQ("key1 ", pairs[0].first);
+  EXPECT_EQ(" value1", pairs[0].second);
+  EXPECT_TRUE(pairs[1].first.empty());
+  EXPECT_TRUE(pairs[1].second.empty());
+  EXPECT_EQ("key3", pairs[2].first);
+  EXPECT_EQ("value3:x", pairs[2].second);
+
+  StringPairs string_pairs;
+  EXPECT_FALSE(SplitStringIntoKeyValuePairs(line, ':', ',', &string_pairs));
+  ASSERT_EQ(pairs.size(), string_pairs.size());
+  for (size_t i = 0; i < pairs.size(); ++i) {
+    EXPECT_EQ(string_pairs[i].first, pairs[i].first);
+    EXPECT_EQ(string_pairs[i].second, pairs[i].second);
+  }
+}
+
 TEST(StringSplitTest, SplitStringAlongWhitespace) {
   struct TestData {
     const char* input;
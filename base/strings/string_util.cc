@@ -288,6 +288,13 @@ TrimPositions TrimWhitespaceASCII(const std::string& input,
   return TrimStringT(input, std::string(kWhitespaceASCII), positions, output);
 }
 
+StringPiece TrimWhitespaceASCII(const StringPiece& input,
+                                TrimPositions positions) {
+  StringPiece output;
+  TrimStringT(input, StringPiece(kWhitespaceASCII), positions, &output);
+  return output;
+}
+
 // This function is only for backward-compatibility.
 // To be removed when all callers are updated.
 TrimPositions TrimWhitespace(const std::string& input,
@@ -442,6 +449,17 @@ bool LowerCaseEqualsASCII(const string16& a, const char* b) {
   return DoLowerCaseEqualsASCII(a.begin(), a.end(), b);
 }
 
+bool LowerCaseEqualsASCII(const base::StringPiece& a,
+                          const base::StringPiece& b) {
+  if (a.size() != b.size())
+    return false;
+  for (size_t i = 0; i < a.size(); ++i) {
+    if (base::ToLowerASCII(a[i]) != b[i])
+      return false;
+  }
+  return true;
+}
+
 bool LowerCaseEqualsASCII(std::string::const_iterator a_begin,
                           std::string::const_iterator a_end,
                           const char* b) {
@@ -476,13 +494,15 @@ bool EqualsASCII(const string16& a, const base::StringPiece& b) {
   return std::equal(b.begin(), b.end(), a.begin());
 }
 
-bool StartsWithASCII(const std::string& str,
-                     const std::string& search,
+bool StartsWithASCII(const base::StringPiece& str,
+                     const base::StringPiece& search,
                      bool case_sensitive) {
+  if (search.size() > str.size())
+    return false;
   if (case_sensitive)
-    return str.compare(0, search.length(), search) == 0;
-  else
-    return base::strncasecmp(str.c_str(), search.c_str(), search.length()) == 0;
+    return memcmp(str.data(), search.data(), search.size()) == 0;
+  return std::equal(search.begin(), search.end(), str.begin(),
+                    base::CaseInsensitiveCompareASCII<char>());
 }
 
 template <typename STR>
@@ -515,9 +535,16 @@ bool EndsWithT(const STR& str, const STR& search, bool case_sensitive) {
                     base::CaseInsensitiveCompare<typename STR::value_type>());
 }
 
-bool EndsWith(const std::string& str, const std::string& search,
+bool EndsWith(const base::StringPiece& str,
+              const base::StringPiece& search,
               bool case_sensitive) {
-  return EndsWithT(str, search, case_sensitive);
+  if (search.size() > str.size())
+    return false;
+  const char* tail = str.data() + str.size() - search.size();
+  if (case_sensitive)
+    return memcmp(tail, search.data(), search.size()) == 0;
+  return std::equal(search.begin(), search.end(), tail,
+                    base::CaseInsensitiveCompare<char>());
 }
 
 bool EndsWith(const string16& str, const string16& search,
@@ -602,10 +629,42 @@ void ReplaceSubstringsAfterOffset(string16* str,
 
 void ReplaceSubstringsAfterOffset(std::string* str,
                                   size_t start_offset,
-                                  const std::string& find_this,
-                                  const std::string& replace_with) {
-  DoReplaceSubstringsAfterOffset(str, start_offset, find_this, replace_with,
-                                 true);  // replace all instances
+                                  const base::StringPiece& find_this,
+                                  const base::StringPiece& replace_with) {
+  if (start_offset == std::string::npos || start_offset >= str->length())
+    return;
+
+  DCHECK(!find_this.empty());
+  base::StringPiece input(*str);
+  size_t offset = input.find(find_this, start_offset);
+  if (offset == base::StringPiece::npos)
+    return;
+
+  if (find_this.size() == replace_with.size()) {
+    // Nothing moves, so replace in place.
+    char* data = &(*str)[0];
+    base::StringPiece contents(data, str->size());
+    do {
+      memmove(data + offset, replace_with.data(), replace_with.size());
+      offset = contents.find(find_this, offset + find_this.size());
+    } while (offset != base::StringPiece::npos);
+    return;
+  }
+
+  // Build the result in one pass rather than shifting the rest of |str| for
+  // each match. |find_this| and |replace_with| may point into |str|, which
+  // stays unchanged until the end.
+  std::string result;
+  result.reserve(str->size());
+  size_t copied = 0;
+  do {
+    result.append(*str, copied, offset - copied);
+    result.append(replace_with.data(), replace_with.size());
+    copied = offset + find_this.size();
+    offset = input.find(find_this, copied);
+  } while (offset != base::StringPiece::npos);
+  result.append(*str, copied, std::string::npos);
+  str->swap(result);
 }
 
 
@@ -205,6 +205,9 @@ BASE_EXPORT TrimPositions TrimWhitespace(const string16& input,
 BASE_EXPORT TrimPositions TrimWhitespaceASCII(const std::string& input,
                                               TrimPositions positions,
                                               std::string* output);
+// Returns the part of |input| left after trimming, without copying it.
+BASE_EXPORT StringPiece TrimWhitespaceASCII(const StringPiece& input,
+                                            TrimPositions positions);
 
 // Deprecated. This function is only for backward compatibility and calls
 // TrimWhitespaceASCII().
@@ -302,6 +305,8 @@ template <class str> inline str StringToUpperASCII(const str& s) {
 // borrowed from the equivalent APIs in Mozilla.
 BASE_EXPORT bool LowerCaseEqualsASCII(const std::string& a, const char* b);
 BASE_EXPORT bool LowerCaseEqualsASCII(const base::string16& a, const char* b);
+BASE_EXPORT bool LowerCaseEqualsASCII(const base::StringPiece& a,
+                                      const base::StringPiece& b);
 
 // Same thing, but with string iterators instead.
 BASE_EXPORT bool LowerCaseEqualsASCII(std::string::const_iterator a_begin,
@@ -322,16 +327,16 @@ BASE_EXPORT bool LowerCaseEqualsASCII(const base::char16* a_begin,
 BASE_EXPORT bool EqualsASCII(const base::string16& a, const base::StringPiece& b);
 
 // Returns true if str starts with search, or false otherwise.
-BASE_EXPORT bool StartsWithASCII(const std::string& str,
-                                 const std::string& search,
+BASE_EXPORT bool StartsWithASCII(const base::StringPiece& str,
+                                 const base::StringPiece& search,
                                  bool case_sensitive);
 BASE_EXPORT bool StartsWith(const base::string16& str,
                             const base::string16& search,
                             bool case_sensitive);
 
 // Returns true if str ends with search, or false otherwise.
-BASE_EXPORT bool EndsWith(const std::string& str,
-                          const std::string& search,
+BASE_EXPORT bool EndsWith(const base::StringPiece& str,
+                          const base::StringPiece& search,
                           bool case_sensitive);
 BASE_EXPORT bool EndsWith(const base::string16& str,
                           const base::string16& search,
@@ -407,10 +412,11 @@ BASE_EXPORT void ReplaceSubstringsAfterOffset(
     size_t start_offset,
     const base::string16& find_this,
     const base::string16& replace_with);
-BASE_EXPORT void ReplaceSubstringsAfterOffset(std::string* str,
-                                              size_t start_offset,
-                                              const std::string& find_this,
-                                              const std::string& replace_with);
+BASE_EXPORT void ReplaceSubstringsAfterOffset(
+    std::string* str,
+    size_t start_offset,
+    const base::StringPiece& find_this,
+    const base::StringPiece& replace_with);
 
 // Reserves enough memory in |str| to accommodate |length_with_null| characters,
 // sets the size of |str| to |length_with_null - 1| characters, and returns a
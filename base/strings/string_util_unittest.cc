@@ -544,7 +544,11 @@ TEST(StringUtilTest, LowerCaseEqualsASCII) {
                                      lowercase_cases[i].dst));
     EXPECT_TRUE(LowerCaseEqualsASCII(lowercase_cases[i].src_a,
                                      lowercase_cases[i].dst));
+    EXPECT_TRUE(LowerCaseEqualsASCII(StringPiece(lowercase_cases[i].src_a),
+                                     StringPiece(lowercase_cases[i].dst)));
   }
+  EXPECT_FALSE(LowerCaseEqualsASCII(StringPiece("foo"), StringPiece("fo")));
+  EXPECT_FALSE(LowerCaseEqualsASCII(StringPiece("foo"), StringPiece("bar")));
 }
 
 TEST(StringUtilTest, FormatBytesUnlocalized) {
@@ -612,6 +616,42 @@ TEST(StringUtilTest, ReplaceSubstringsAfterOffset) {
   }
 }
 
+TEST(StringUtilTest, ReplaceSubstringsAfterOffset8Bit) {
+  static const struct {
+    const char* str;
+    size_t start_offset;
+    const char* find_this;
+    const char* replace_with;
+    const char* expected;
+  } cases[] = {
+    {"aaa", 0, "a", "b", "bbb"},
+    {"abb", 0, "ab", "a", "ab"},
+    {"Removing some substrings inging", 0, "ing", "", "Remov some substrs "},
+    {"Not found", 0, "x", "0", "Not found"},
+    {" Making it longer ", 0, " ", "--", "--Making--it--longer--"},
+    {"Invalid offset", 9999, "t", "foobar", "Invalid offset"},
+    {"abababab", 2, "ab", "c", "abccc"},
+    {"abababab", 2, "ab", "cd", "abcdcdcd"},
+  };
+
+  for (size_t i = 0; i < arraysize(cases); i++) {
+    std::string str = cases[i].str;
+    ReplaceSubstringsAfterOffset(&str, cases[i].start_offset,
+                                 cases[i].find_this, cases[i].replace_with);
+    EXPECT_EQ(cases[i].expected, str);
+  }
+}
+
+TEST(StringUtilTest, TrimWhitespaceASCIIStringPiece) {
+  EXPECT_EQ("a b", TrimWhitespaceASCII(StringPiece(" \ta b\n"), TRIM_ALL));
+  EXPECT_EQ("a b\n",
+            TrimWhitespaceASCII(StringPiece(" \ta b\n"), TRIM_LEADING));
+  EXPECT_EQ(" \ta b",
+            TrimWhitespaceASCII(StringPiece(" \ta b\n"), TRIM_TRAILING));
+  EXPECT_EQ("", TrimWhitespaceASCII(StringPiece(" \t\n"), TRIM_ALL));
+  EXPECT_EQ("", TrimWhitespaceASCII(StringPiece(), TRIM_ALL));
+}
+
 TEST(StringUtilTest, ReplaceFirstSubstringAfterOffset) {
   static const struct {
     const char* str;
@@ -4,9 +4,13 @@
 
 #include "base/strings/utf_string_conversions.h"
 
+#include <algorithm>
+
 #include "base/strings/string_piece.h"
 #include "base/strings/string_util.h"
 #include "base/strings/utf_string_conversion_utils.h"
+#include "base/strings/utf_string_conversions_simd.h"
+#include "base/third_party/icu/icu_utf.h"
 
 namespace base {
 
@@ -141,46 +145,154 @@ std::wstring UTF16ToWide(const string16& utf16) {
 
 // UTF16 <-> UTF8 --------------------------------------------------------------
 
-#if defined(WCHAR_T_IS_UTF32)
+namespace {
+
+inline bool IsASCII(char c) {
+  return !(c & 0x80);
+}
+
+// Converts |src|, which must be well-formed UTF-8, to UTF-16 in |dest|, which
+// must have room for |src_len| characters. Returns the number written.
+size_t ConvertWellFormedUTF8ToUTF16(const char* src,
+                                    size_t src_len,
+                                    char16* dest) {
+  const uint8* bytes = reinterpret_cast<const uint8*>(src);
+  size_t i = 0;
+  size_t dest_len = 0;
+  while (i < src_len) {
+    size_t ascii_len =
+        internal::ConvertASCIIPrefix(src + i, src_len - i, dest + dest_len);
+    i += ascii_len;
+    dest_len += ascii_len;
+
+    // Decode up to the next ASCII character. The string has been validated,
+    // so every lead byte has all of its continuation bytes.
+    while (i < src_len && !IsASCII(src[i])) {
+      uint32 code_point;
+      if (bytes[i] < 0xE0) {
+        code_point = ((bytes[i] & 0x1F) << 6) | (bytes[i + 1] & 0x3F);
+        i += 2;
+      } else if (bytes[i] < 0xF0) {
+        code_point = ((bytes[i] & 0x0F) << 12) |
+                     ((bytes[i + 1] & 0x3F) << 6) | (bytes[i + 2] & 0x3F);
+        i += 3;
+      } else {
+        code_point = ((bytes[i] & 0x07) << 18) |
+                     ((bytes[i + 1] & 0x3F) << 12) |
+                     ((bytes[i + 2] & 0x3F) << 6) | (bytes[i + 3] & 0x3F);
+        i += 4;
+      }
+      CBU16_APPEND_UNSAFE(dest, dest_len, code_point);
+    }
+  }
+  return dest_len;
+}
+
+// Converts |src| to UTF-16 in |dest|, which must have room for |src_len|
+// characters, replacing invalid sequences with U+FFFD. Sets |*dest_len| to the
+// number of characters written, and returns false if there were any invalid
+// sequences.
+bool ConvertUTF8ToUTF16(const char* src,
+                        size_t src_len,
+                        char16* dest,
+                        size_t* dest_len) {
+  bool success = true;
+  int32 src_len32 = static_cast<int32>(src_len);
+  size_t i = 0;
+  *dest_len = 0;
+  while (i < src_len) {
+    size_t ascii_len =
+        internal::ConvertASCIIPrefix(src + i, src_len - i, dest + *dest_len);
+    i += ascii_len;
+    *dest_len += ascii_len;
+
+    while (i < src_len && !IsASCII(src[i])) {
+      int32 char_index = static_cast<int32>(i);
+      uint32 code_point;
+      if (!ReadUnicodeCharacter(src, src_len32, &char_index, &code_point)) {
+        code_point = 0xFFFD;
+        success = false;
+      }
+      i = char_index + 1;
+      CBU16_APPEND_UNSAFE(dest, *dest_len, code_point);
+    }
+  }
+  return success;
+}
+
+// Makes room in |output| for at least four more bytes after |output_len|,
+// guessing that the |remaining| characters of input after the current one
+// will mostly be ASCII.
+void GrowUTF8Output(size_t output_len, size_t remaining, std::string* output) {
+  output->resize(std::max(output_len + remaining + 4,
+                          output->size() + output->size() / 2));
+}
+
+}  // namespace
 
 bool UTF8ToUTF16(const char* src, size_t src_len, string16* output) {
-  if (IsStringASCII(StringPiece(src, src_len))) {
-    output->assign(src, src + src_len);
+  // Each byte of UTF-8 produces at most one UTF-16 character.
+  output->resize(src_len);
+  if (!src_len)
     return true;
+
+  // Checking the whole string up front is cheaper than checking each
+  // character as it is converted, and the common case is valid input.
+  char16* dest = &(*output)[0];
+  size_t dest_len;
+  bool success = true;
+  if (internal::CanValidateUTF8InBulk() &&
+      internal::IsWellFormedUTF8(src, src_len)) {
+    dest_len = ConvertWellFormedUTF8ToUTF16(src, src_len, dest);
   } else {
-    PrepareForUTF16Or32Output(src, src_len, output);
-    return ConvertUnicode(src, src_len, output);
+    success = ConvertUTF8ToUTF16(src, src_len, dest, &dest_len);
   }
+  output->resize(dest_len);
+  return success;
 }
 
 string16 UTF8ToUTF16(const StringPiece& utf8) {
-  if (IsStringASCII(utf8)) {
-    return string16(utf8.begin(), utf8.end());
-  }
-
   string16 ret;
-  PrepareForUTF16Or32Output(utf8.data(), utf8.length(), &ret);
   // Ignore the success flag of this call, it will do the best it can for
   // invalid input, which is what we want here.
-  ConvertUnicode(utf8.data(), utf8.length(), &ret);
+  UTF8ToUTF16(utf8.data(), utf8.length(), &ret);
   return ret;
 }
 
 bool UTF16ToUTF8(const char16* src, size_t src_len, std::string* output) {
-  if (IsStringASCII(StringPiece16(src, src_len))) {
-    output->assign(src, src + src_len);
-    return true;
-  } else {
-    PrepareForUTF8Output(src, src_len, output);
-    return ConvertUnicode(src, src_len, output);
+  // Start with enough room for ASCII, and grow as other characters turn up.
+  output->resize(src_len);
+  bool success = true;
+  int32 src_len32 = static_cast<int32>(src_len);
+  size_t i = 0;
+  size_t output_len = 0;
+  while (i < src_len) {
+    if (output->size() - output_len < 4)
+      GrowUTF8Output(output_len, src_len - i, output);
+    size_t ascii_len = internal::ConvertASCIIPrefix(
+        src + i, std::min(src_len - i, output->size() - output_len),
+        &(*output)[output_len]);
+    i += ascii_len;
+    output_len += ascii_len;
+
+    while (i < src_len && src[i] >= 0x80) {
+      if (output->size() - output_len < 4)
+        GrowUTF8Output(output_len, src_len - i, output);
+      int32 char_index = static_cast<int32>(i);
+      uint32 code_point;
+      if (!ReadUnicodeCharacter(src, src_len32, &char_index, &code_point)) {
+        code_point = 0xFFFD;
+        success = false;
+      }
+      i = char_index + 1;
+      CBU8_APPEND_UNSAFE(&(*output)[0], output_len, code_point);
+    }
   }
+  output->resize(output_len);
+  return success;
 }
 
 std::string UTF16ToUTF8(const string16& utf16) {
-  if (IsStringASCII(utf16)) {
-    return std::string(utf16.begin(), utf16.end());
-  }
-
   std::string ret;
   // Ignore the success flag of this call, it will do the best it can for
   // invalid input, which is what we want here.
@@ -188,27 +300,6 @@ std::string UTF16ToUTF8(const string16& utf16) {
   return ret;
 }
 
-#elif defined(WCHAR_T_IS_UTF16)
-// Easy case since we can use the "wide" versions we already wrote above.
-
-bool UTF8ToUTF16(const char* src, size_t src_len, string16* output) {
-  return UTF8ToWide(src, src_len, output);
-}
-
-string16 UTF8ToUTF16(const StringPiece& utf8) {
-  return UTF8ToWide(utf8);
-}
-
-bool UTF16ToUTF8(const char16* src, size_t src_len, std::string* output) {
-  return WideToUTF8(src, src_len, output);
-}
-
-std::string UTF16ToUTF8(const string16& utf16) {
-  return WideToUTF8(utf16);
-}
-
-#endif
-
 string16 ASCIIToUTF16(const StringPiece& ascii) {
   DCHECK(IsStringASCII(ascii)) << ascii;
   return string16(ascii.begin(), ascii.end());
@@ -0,0 +1,91 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <string>
+
+#include "base/strings/utf_string_conversions.h"
+#include "base/time/time.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_test.h"
+
+namespace base {
+
+namespace {
+
+const size_t kTextSize = 1024 * 1024;
+const int kIterations = 20;
+
+// Repeats |sample| to make about kTextSize bytes of text.
+std::string MakeText(const std::string& sample) {
+  std::string text;
+  while (text.size() < kTextSize)
+    text += sample;
+  return text;
+}
+
+void PrintThroughput(const std::string& trace,
+                     const std::string& text_kind,
+                     size_t bytes,
+                     TimeDelta elapsed) {
+  perf_test::PrintResult(
+      trace, "_" + text_kind, "",
+      bytes * kIterations / (elapsed.InSecondsF() * 1024 * 1024), "MB/s",
+      true);
+}
+
+// Converts |utf8| to UTF-16 and back kIterations times each, and prints the
+// throughput of each direction in terms of UTF-8 bytes.
+void MeasureConversions(const std::string& text_kind,
+                        const std::string& utf8) {
+  string16 utf16;
+  TimeTicks start = TimeTicks::HighResNow();
+  for (int i = 0; i < kIterations; ++i)
+    UTF8ToUTF16(utf8.data(), utf8.size(), &utf16);
+  PrintThroughput("utf8_to_utf16", text_kind, utf8.size(),
+                  TimeTicks::HighResNow() - start);
+
+  std::string round_trip;
+  start = TimeTicks::HighResNow();
+  for (int i = 0; i < kIterations; ++i)
+    UTF16ToUTF8(utf16.data(), utf16.size(), &round_trip);
+  PrintThroughput("utf16_to_utf8", text_kind, utf8.size(),
+                  TimeTicks::HighResNow() - start);
+}
+
+}  // namespace
+
+TEST(UTFStringConversionsPerfTest, ASCII) {
+  MeasureConversions(
+      "ascii",
+      MakeText("The quick brown fox jumps over the lazy dog. 0123456789\n"));
+}
+
+TEST(UTFStringConversionsPerfTest, Latin1) {
+  // "Le cœur déçu mais l'âme plutôt naïve, Louÿs rêva de crapaüter en canoë
+  // au delà des îles."
+  MeasureConversions(
+      "latin1",
+      MakeText("Le c\xc5\x93ur d\xc3\xa9\xc3\xa7u mais l'\xc3\xa2me "
+               "plut\xc3\xb4t na\xc3\xafve, Lou\xc3\xbfs r\xc3\xaava de "
+               "crapa\xc3\xbcter en cano\xc3\xab au del\xc3\xa0 des "
+               "\xc3\xaeles. "));
+}
+
+TEST(UTFStringConversionsPerfTest, CJK) {
+  // "网页 图片 资讯更多 »"
+  MeasureConversions(
+      "cjk",
+      MakeText("\xe7\xbd\x91\xe9\xa1\xb5 \xe5\x9b\xbe\xe7\x89\x87 "
+               "\xe8\xb5\x84\xe8\xae\xaf\xe6\x9b\xb4\xe5\xa4\x9a "
+               "\xc2\xbb "));
+}
+
+TEST(UTFStringConversionsPerfTest, Invalid) {
+  // Latin-1 text mistaken for UTF-8.
+  MeasureConversions(
+      "invalid",
+      MakeText("Le c\x9cur d\xe9\xe7u mais l'\xe2me plut\xf4t na\xefve. "));
+}
+
+}  // namespace base
@@ -0,0 +1,342 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/strings/utf_string_conversions_simd.h"
+
+#include <string.h>
+
+#include "base/cpu.h"
+#include "base/lazy_instance.h"
+#include "base/strings/utf_string_conversion_utils.h"
+#include "build/build_config.h"
+
+#if defined(ARCH_CPU_X86_FAMILY) && !defined(OS_NACL)
+#define UTF_CONVERSIONS_USE_SSE
+#include <emmintrin.h>
+#include <tmmintrin.h>
+#elif defined(ARCH_CPU_ARM_FAMILY) && \
+    (defined(__ARM_NEON__) || defined(__ARM_NEON))
+#define UTF_CONVERSIONS_USE_NEON
+#include <arm_neon.h>
+#endif
+
+#if defined(UTF_CONVERSIONS_USE_SSE) && defined(COMPILER_GCC)
+// Lets SSSE3 instructions be used in one function without building the whole
+// file for SSSE3. The function may only run once base::CPU has said the CPU
+// supports them.
+#define TARGET_SSSE3 __attribute__((target("ssse3")))
+#else
+#define TARGET_SSSE3
+#endif
+
+namespace base {
+namespace internal {
+
+namespace {
+
+inline bool IsASCII(char c) {
+  return !(c & 0x80);
+}
+
+inline bool IsASCII(char16 c) {
+  return c < 0x80;
+}
+
+template <typename SRC_CHAR, typename DEST_CHAR>
+size_t ConvertASCIIPrefixScalar(const SRC_CHAR* src,
+                                size_t length,
+                                DEST_CHAR* dest) {
+  size_t i = 0;
+  for (; i < length && IsASCII(src[i]); ++i)
+    dest[i] = static_cast<DEST_CHAR>(src[i]);
+  return i;
+}
+
+bool IsWellFormedUTF8Scalar(const char* src, size_t length) {
+  int32 src_len = static_cast<int32>(length);
+  for (int32 i = 0; i < src_len; ++i) {
+    uint32 code_point;
+    if (!ReadUnicodeCharacter(src, src_len, &i, &code_point))
+      return false;
+  }
+  return true;
+}
+
+#if defined(UTF_CONVERSIONS_USE_SSE)
+
+size_t ConvertASCIIPrefixSSE2(const char* src, size_t length, char16* dest) {
+  const __m128i zero = _mm_setzero_si128();
+  size_t i = 0;
+  for (; i + 16 <= length; i += 16) {
+    __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    if (_mm_movemask_epi8(bytes))
+      break;
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i),
+                     _mm_unpacklo_epi8(bytes, zero));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i + 8),
+                     _mm_unpackhi_epi8(bytes, zero));
+  }
+  return i + ConvertASCIIPrefixScalar(src + i, length - i, dest + i);
+}
+
+size_t ConvertASCIIPrefixSSE2(const char16* src, size_t length, char* dest) {
+  const __m128i non_ascii_bits = _mm_set1_epi16(static_cast<short>(0xFF80));
+  const __m128i zero = _mm_setzero_si128();
+  size_t i = 0;
+  for (; i + 16 <= length; i += 16) {
+    __m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    __m128i high =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 8));
+    __m128i non_ascii =
+        _mm_and_si128(_mm_or_si128(low, high), non_ascii_bits);
+    if (_mm_movemask_epi8(_mm_cmpeq_epi16(non_ascii, zero)) != 0xFFFF)
+      break;
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i),
+                     _mm_packus_epi16(low, high));
+  }
+  return i + ConvertASCIIPrefixScalar(src + i, length - i, dest + i);
+}
+
+// The validator below classifies each pair of adjacent bytes by looking up
+// the high nibble of the first, the low nibble of the first and the high
+// nibble of the second in three tables, and ANDing the results: any bit left
+// set is an error. Sequences of three and four bytes are then checked by
+// requiring continuation bytes exactly where a lead byte two or three bytes
+// earlier says there must be one. See "Validating UTF-8 In Less Than One
+// Instruction Per Byte" by John Keiser and Daniel Lemire.
+const uint8 kTooShort = 1 << 0;    // 11______ 0_______, 11______ 11______
+const uint8 kTooLong = 1 << 1;     // 0_______ 10______
+const uint8 kOverlong3 = 1 << 2;   // 11100000 100_____
+const uint8 kTooLarge = 1 << 3;    // 11110100 1001____ and larger
+const uint8 kSurrogate = 1 << 4;   // 11101101 101_____
+const uint8 kOverlong2 = 1 << 5;   // 1100000_ 10______
+const uint8 kTooLarge1000 = 1 << 6;  // 11110101 1000____ and larger
+const uint8 kOverlong4 = 1 << 6;   // 11110000 1000____
+const uint8 kTwoConts = 1 << 7;    // 10______ 10______
+const uint8 kCarry = kTooShort | kTooLong | kTwoConts;
+
+inline __m128i Shuffle(const uint8* table, __m128i indices) TARGET_SSSE3;
+inline __m128i Shuffle(const uint8* table, __m128i indices) {
+  return _mm_shuffle_epi8(
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(table)), indices);
+}
+
+inline __m128i HighNibbles(__m128i bytes) {
+  return _mm_and_si128(_mm_srli_epi16(bytes, 4), _mm_set1_epi8(0x0F));
+}
+
+// Returns a mask of the errors in the 16 bytes of |input|, given the 16 bytes
+// that came before.
+inline __m128i CheckUTF8Block(__m128i input, __m128i previous) TARGET_SSSE3;
+inline __m128i CheckUTF8Block(__m128i input, __m128i previous) {
+  static const uint8 kByte1High[16] = {
+      // 0_______ ________: ASCII.
+      kTooLong, kTooLong, kTooLong, kTooLong,
+      kTooLong, kTooLong, kTooLong, kTooLong,
+      // 10______ ________: continuation.
+      kTwoConts, kTwoConts, kTwoConts, kTwoConts,
+      // 1100____ ________: two byte lead.
+      kTooShort | kOverlong2,
+      // 1101____ ________: two byte lead.
+      kTooShort,
+      // 1110____ ________: three byte lead.
+      kTooShort | kOverlong3 | kSurrogate,
+      // 1111____ ________: four or more byte lead.
+      kTooShort | kTooLarge | kTooLarge1000 | kOverlong4,
+  };
+  static const uint8 kByte1Low[16] = {
+      // ____0000 ________
+      kCarry | kOverlong3 | kOverlong2 | kOverlong4,
+      // ____0001 ________
+      kCarry | kOverlong2,
+      // ____001_ ________
+      kCarry,
+      kCarry,
+      // ____0100 ________
+      kCarry | kTooLarge,
+      // ____0101 ________ and up.
+      kCarry | kTooLarge | kTooLarge1000,
+      kCarry | kTooLarge | kTooLarge1000,
+      kCarry | kTooLarge | kTooLarge1000,
+      kCarry | kTooLarge | kTooLarge1000,
+      kCarry | kTooLarge | kTooLarge1000,
+      kCarry | kTooLarge | kTooLarge1000,
+      kCarry | kTooLarge | kTooLarge1000,
+      kCarry | kTooLarge | kTooLarge1000,
+      // ____1101 ________
+      kCarry | kTooLarge | kTooLarge1000 | kSurrogate,
+      kCarry | kTooLarge | kTooLarge1000,
+      kCarry | kTooLarge | kTooLarge1000,
+  };
+  static const uint8 kByte2High[16] = {
+      // ________ 0_______: ASCII.
+      kTooShort, kTooShort, kTooShort, kTooShort,
+      kTooShort, kTooShort, kTooShort, kTooShort,
+      // ________ 1000____
+      kTooLong | kOverlong2 | kTwoConts | kOverlong3 | kTooLarge1000 |
+          kOverlong4,
+      // ________ 1001____
+      kTooLong | kOverlong2 | kTwoConts | kOverlong3 | kTooLarge,
+      // ________ 101_____
+      kTooLong | kOverlong2 | kTwoConts | kSurrogate | kTooLarge,
+      kTooLong | kOverlong2 | kTwoConts | kSurrogate | kTooLarge,
+      // ________ 11______: lead.
+      kTooShort, kTooShort, kTooShort, kTooShort,
+  };
+
+  __m128i previous1 = _mm_alignr_epi8(input, previous, 15);
+  __m128i special_cases = _mm_and_si128(
+      _mm_and_si128(Shuffle(kByte1High, HighNibbles(previous1)),
+                    Shuffle(kByte1Low,
+                            _mm_and_si128(previous1, _mm_set1_epi8(0x0F)))),
+      Shuffle(kByte2High, HighNibbles(input)));
+
+  // The top bit is set where the byte must be the second or third
+  // continuation byte of a sequence.
+  __m128i previous2 = _mm_alignr_epi8(input, previous, 14);
+  __m128i previous3 = _mm_alignr_epi8(input, previous, 13);
+  __m128i third_byte = _mm_subs_epu8(previous2, _mm_set1_epi8(0xE0 - 0x80));
+  __m128i fourth_byte = _mm_subs_epu8(previous3, _mm_set1_epi8(0xF0 - 0x80));
+  __m128i must_be_continuation = _mm_and_si128(
+      _mm_or_si128(third_byte, fourth_byte),
+      _mm_set1_epi8(static_cast<char>(0x80)));
+  return _mm_xor_si128(must_be_continuation, special_cases);
+}
+
+bool IsWellFormedUTF8SSSE3(const char* src, size_t length) TARGET_SSSE3;
+bool IsWellFormedUTF8SSSE3(const char* src, size_t length) {
+  // Non-zero where the last bytes of a block start a sequence that the block
+  // doesn't finish.
+  const __m128i incomplete_threshold = _mm_setr_epi8(
+      -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+      static_cast<char>(0xF0 - 1), static_cast<char>(0xE0 - 1),
+      static_cast<char>(0xC0 - 1));
+
+  __m128i error = _mm_setzero_si128();
+  __m128i previous = _mm_setzero_si128();
+  __m128i previous_incomplete = _mm_setzero_si128();
+  size_t i = 0;
+  while (i < length) {
+    __m128i input;
+    if (i + 16 <= length) {
+      input = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    } else {
+      // Pad the last block with ASCII, which can't hide an error.
+      char last_block[16] = {0};
+      memcpy(last_block, src + i, length - i);
+      input = _mm_loadu_si128(reinterpret_cast<const __m128i*>(last_block));
+    }
+    i += 16;
+
+    if (!_mm_movemask_epi8(input)) {
+      // All ASCII: only an unfinished sequence from before can be wrong.
+      error = _mm_or_si128(error, previous_incomplete);
+      previous_incomplete = _mm_setzero_si128();
+    } else {
+      error = _mm_or_si128(error, CheckUTF8Block(input, previous));
+      previous_incomplete = _mm_subs_epu8(input, incomplete_threshold);
+    }
+    previous = input;
+
+    // Bail out early on long invalid strings.
+    if ((i & 1023) == 0 &&
+        _mm_movemask_epi8(_mm_cmpeq_epi8(error, _mm_setzero_si128())) !=
+            0xFFFF) {
+      return false;
+    }
+  }
+  error = _mm_or_si128(error, previous_incomplete);
+  return _mm_movemask_epi8(_mm_cmpeq_epi8(error, _mm_setzero_si128())) ==
+         0xFFFF;
+}
+
+#elif defined(UTF_CONVERSIONS_USE_NEON)
+
+size_t ConvertASCIIPrefixNEON(const char* src, size_t length, char16* dest) {
+  size_t i = 0;
+  for (; i + 16 <= length; i += 16) {
+    uint8x16_t bytes = vld1q_u8(reinterpret_cast<const uint8*>(src + i));
+    uint8x8_t folded = vorr_u8(vget_low_u8(bytes), vget_high_u8(bytes));
+    if (vget_lane_u64(vreinterpret_u64_u8(folded), 0) &
+        0x8080808080808080ULL) {
+      break;
+    }
+    vst1q_u16(reinterpret_cast<uint16*>(dest + i),
+              vmovl_u8(vget_low_u8(bytes)));
+    vst1q_u16(reinterpret_cast<uint16*>(dest + i + 8),
+              vmovl_u8(vget_high_u8(bytes)));
+  }
+  return i + ConvertASCIIPrefixScalar(src + i, length - i, dest + i);
+}
+
+size_t ConvertASCIIPrefixNEON(const char16* src, size_t length, char* dest) {
+  size_t i = 0;
+  for (; i + 16 <= length; i += 16) {
+    uint16x8_t low = vld1q_u16(reinterpret_cast<const uint16*>(src + i));
+    uint16x8_t high = vld1q_u16(reinterpret_cast<const uint16*>(src + i + 8));
+    uint16x8_t both = vorrq_u16(low, high);
+    uint16x4_t folded = vorr_u16(vget_low_u16(both), vget_high_u16(both));
+    if (vget_lane_u64(vreinterpret_u64_u16(folded), 0) &
+        0xFF80FF80FF80FF80ULL) {
+      break;
+    }
+    vst1q_u8(reinterpret_cast<uint8*>(dest + i),
+             vcombine_u8(vmovn_u16(low), vmovn_u16(high)));
+  }
+  return i + ConvertASCIIPrefixScalar(src + i, length - i, dest + i);
+}
+
+#endif
+
+// The implementations for this CPU.
+struct Kernels {
+  Kernels()
+      : widen_ascii(&ConvertASCIIPrefixScalar<char, char16>),
+        narrow_ascii(&ConvertASCIIPrefixScalar<char16, char>),
+        is_well_formed_utf8(NULL) {
+#if defined(UTF_CONVERSIONS_USE_SSE)
+    CPU cpu;
+    if (cpu.has_sse2()) {
+      widen_ascii = &ConvertASCIIPrefixSSE2;
+      narrow_ascii = &ConvertASCIIPrefixSSE2;
+    }
+    if (cpu.has_ssse3())
+      is_well_formed_utf8 = &IsWellFormedUTF8SSSE3;
+#elif defined(UTF_CONVERSIONS_USE_NEON)
+    widen_ascii = &ConvertASCIIPrefixNEON;
+    narrow_ascii = &ConvertASCIIPrefixNEON;
+#endif
+  }
+
+  size_t (*widen_ascii)(const char*, size_t, char16*);
+  size_t (*narrow_ascii)(const char16*, size_t, char*);
+  // NULL if there is nothing faster than decoding the string.
+  bool (*is_well_formed_utf8)(const char*, size_t);
+};
+
+LazyInstance<Kernels>::Leaky g_kernels = LAZY_INSTANCE_INITIALIZER;
+
+}  // namespace
+
+size_t ConvertASCIIPrefix(const char* src, size_t length, char16* dest) {
+  return g_kernels.Get().widen_ascii(src, length, dest);
+}
+
+size_t ConvertASCIIPrefix(const char16* src, size_t length, char* dest) {
+  return g_kernels.Get().narrow_ascii(src, length, dest);
+}
+
+bool CanValidateUTF8InBulk() {
+  return g_kernels.Get().is_well_formed_utf8 != NULL;
+}
+
+bool IsWellFormedUTF8(const char* src, size_t length) {
+  const Kernels& kernels = g_kernels.Get();
+  if (kernels.is_well_formed_utf8)
+    return kernels.is_well_formed_utf8(src, length);
+  return IsWellFormedUTF8Scalar(src, length);
+}
+
+}  // namespace internal
+}  // namespace base
@@ -0,0 +1,44 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BASE_STRINGS_UTF_STRING_CONVERSIONS_SIMD_H_
+#define BASE_STRINGS_UTF_STRING_CONVERSIONS_SIMD_H_
+
+// This should only be used by the various UTF string conversion files.
+//
+// Vectorized building blocks for the UTF conversions. Each function picks
+// the fastest implementation the CPU supports the first time it is called.
+
+#include <stddef.h>
+
+#include "base/base_export.h"
+#include "base/strings/string16.h"
+
+namespace base {
+namespace internal {
+
+// Copies the longest prefix of |src|, of at most |length| characters, that is
+// entirely ASCII to |dest|, widening or narrowing each character. Returns the
+// number of characters copied.
+BASE_EXPORT size_t ConvertASCIIPrefix(const char* src,
+                                      size_t length,
+                                      char16* dest);
+BASE_EXPORT size_t ConvertASCIIPrefix(const char16* src,
+                                      size_t length,
+                                      char* dest);
+
+// Returns true if IsWellFormedUTF8() is faster than decoding the string with
+// ReadUnicodeCharacter(), so that it is worth checking a string up front.
+BASE_EXPORT bool CanValidateUTF8InBulk();
+
+// Returns true if ReadUnicodeCharacter() would succeed on every character of
+// |src|: there are no overlong forms, surrogates, code points above 0x10FFFF,
+// stray continuation bytes or truncated sequences. Unlike IsStringUTF8(),
+// non-characters are allowed.
+BASE_EXPORT bool IsWellFormedUTF8(const char* src, size_t length);
+
+}  // namespace internal
+}  // namespace base
+
+#endif  // BASE_STRINGS_UTF_STRING_CONVERSIONS_SIMD_H_
@@ -7,6 +7,7 @@
 #include "base/strings/string_piece.h"
 #include "base/strings/string_util.h"
 #include "base/strings/utf_string_conversions.h"
+#include "base/strings/utf_string_conversions_simd.h"
 #include "testing/gtest/include/gtest/gtest.h"
 
 namespace base {
@@ -208,4 +209,69 @@ TEST(UTFStringConversionsTest, ConvertMultiString) {
   EXPECT_EQ(expected, converted);
 }
 
+// The conversions work on blocks of 16 characters at a time where they can, so
+// check that characters are handled the same at every position in a block.
+TEST(UTFStringConversionsTest, ConvertAtEveryOffset) {
+  static const struct {
+    const char* utf8;
+    const wchar_t* utf16;
+    bool success;
+  } kCases[] = {
+    {"\xc3\xa9", L"\x00e9", true},
+    {"\xe4\xb8\xad", L"\x4e2d", true},
+    {"\xf0\x9f\x98\x80", L"\xd83d\xde00", true},
+    {"\xef\xbf\xbf", L"\xffff", true},
+    {"\xc3", L"\xfffd", false},
+    {"\xe4\xb8", L"\xfffd", false},
+    {"\xed\xa0\x80", L"\xfffd", false},
+    {"\xc0\xaf", L"\xfffd", false},
+    {"\xf4\x90\x80\x80", L"\xfffd", false},
+    {"\xff", L"\xfffd", false},
+  };
+
+  for (size_t i = 0; i < arraysize(kCases); ++i) {
+    string16 utf16 = WideToUTF16(kCases[i].utf16);
+#if defined(WCHAR_T_IS_UTF32)
+    // WideToUTF16() doesn't pass surrogates through, so build them directly.
+    utf16.clear();
+    for (const wchar_t* c = kCases[i].utf16; *c; ++c)
+      utf16.push_back(static_cast<char16>(*c));
+#endif
+    for (size_t before = 0; before < 40; ++before) {
+      for (size_t after = 0; after < 20; after += 3) {
+        std::string utf8 = std::string(before, 'a') + kCases[i].utf8 +
+                           std::string(after, 'b');
+        string16 expected = string16(before, 'a') + utf16 +
+                            string16(after, 'b');
+        string16 converted;
+        EXPECT_EQ(kCases[i].success,
+                  UTF8ToUTF16(utf8.data(), utf8.length(), &converted));
+        EXPECT_EQ(expected, converted) << i << " " << before << " " << after;
+        EXPECT_EQ(kCases[i].success,
+                  internal::IsWellFormedUTF8(utf8.data(), utf8.length()));
+        if (kCases[i].success) {
+          std::string back;
+          EXPECT_TRUE(UTF16ToUTF8(expected.data(), expected.length(), &back));
+          EXPECT_EQ(utf8, back);
+        }
+      }
+    }
+  }
+}
+
+TEST(UTFStringConversionsTest, ConvertUnpairedSurrogatesToUTF8) {
+  for (size_t before = 0; before < 40; ++before) {
+    string16 utf16 = string16(before, 'a');
+    utf16.push_back(0xd800);
+    utf16.append(17, 'b');
+    utf16.push_back(0xdc00);
+    std::string expected =
+        std::string(before, 'a') + "\xef\xbf\xbd" + std::string(17, 'b') +
+        "\xef\xbf\xbd";
+    std::string converted;
+    EXPECT_FALSE(UTF16ToUTF8(utf16.data(), utf16.length(), &converted));
+    EXPECT_EQ(expected, converted);
+  }
+}
+
 }  // base
@@ -0,0 +1,79 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/synchronization/adaptive_lock.h"
+
+#include <algorithm>
+
+#include "base/debug/trace_event.h"
+#include "build/build_config.h"
+
+#if defined(OS_WIN)
+#include <windows.h>
+#endif
+
+namespace base {
+
+namespace {
+
+// Bounds on how many times Acquire() tries the lock before it parks. It spins
+// at least kMinSpins times, and at most twice the average that it took before.
+const int kMinSpins = 10;
+const int kMaxSpins = 200;
+
+// Tells the CPU that this is a spin loop, which saves power and lets a
+// hyperthreaded sibling run.
+inline void SpinPause() {
+#if defined(ARCH_CPU_X86_FAMILY) && defined(COMPILER_GCC)
+  __asm__ __volatile__("pause");
+#elif defined(OS_WIN)
+  YieldProcessor();
+#endif
+}
+
+}  // namespace
+
+AdaptiveLock::AdaptiveLock(const char* name)
+    : name_(name),
+      average_spins_(0) {
+}
+
+AdaptiveLock::~AdaptiveLock() {
+}
+
+void AdaptiveLock::GetContentionStats(ContentionStats* stats) {
+  AutoLock auto_lock(lock_);
+  *stats = stats_;
+}
+
+void AdaptiveLock::AcquireContended() {
+  TimeTicks start = TimeTicks::Now();
+  int average = subtle::NoBarrier_Load(&average_spins_);
+  int max_spins = std::min(kMaxSpins, 2 * average + kMinSpins);
+  int spins = 0;
+  TRACE_EVENT_BEGIN0(TRACE_DISABLED_BY_DEFAULT("lock_contention"), name_);
+  bool acquired = false;
+  while (!acquired && spins < max_spins) {
+    SpinPause();
+    ++spins;
+    acquired = lock_.Try();
+  }
+
+  if (acquired) {
+    average += (spins - average) / 8;
+  } else {
+    // The holder kept the lock for longer than spinning is worth. Spin less
+    // next time, and park until the lock is free.
+    average -= average / 8;
+    lock_.Acquire();
+  }
+  subtle::NoBarrier_Store(&average_spins_, average);
+  TRACE_EVENT_END1(TRACE_DISABLED_BY_DEFAULT("lock_contention"), name_,
+                   "spins", spins);
+
+  ++stats_.contended_acquires;
+  stats_.wait_time += TimeTicks::Now() - start;
+}
+
+}  // namespace base
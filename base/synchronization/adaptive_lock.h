@@ -0,0 +1,90 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BASE_SYNCHRONIZATION_ADAPTIVE_LOCK_H_
+#define BASE_SYNCHRONIZATION_ADAPTIVE_LOCK_H_
+
+#include "base/atomicops.h"
+#include "base/base_export.h"
+#include "base/basictypes.h"
+#include "base/synchronization/lock.h"
+#include "base/time/time.h"
+
+namespace base {
+
+// A lock for short critical sections that are sometimes contended. When the
+// lock is busy, Acquire() spins for a while, on the bet that the holder is
+// about to let go, before it parks the thread in the kernel like Lock does.
+// How long it spins adapts to how long it took to get the lock by spinning in
+// the past, so a lock whose holders keep it for long stops spinning.
+//
+// Every contended acquire is counted, and is reported to tracing with how long
+// the thread waited, under the "disabled-by-default-lock_contention" category,
+// so that contention shows up in chrome://tracing. Uncontended acquires cost
+// the same as Lock's. Because of the reporting, an AdaptiveLock must not be
+// used by the tracing code itself.
+class BASE_EXPORT AdaptiveLock {
+ public:
+  // Counts of the contended acquires of a lock.
+  struct ContentionStats {
+    ContentionStats() : contended_acquires(0) {}
+
+    int contended_acquires;
+    TimeDelta wait_time;
+  };
+
+  // |name| names the lock in traces. It must be a string literal.
+  explicit AdaptiveLock(const char* name);
+  ~AdaptiveLock();
+
+  void Acquire() {
+    if (!lock_.Try())
+      AcquireContended();
+  }
+  void Release() { lock_.Release(); }
+
+  // Like Lock::Try(). A failed Try() does not count as contention.
+  bool Try() { return lock_.Try(); }
+
+  void AssertAcquired() const { lock_.AssertAcquired(); }
+
+  // Takes the lock to read the stats, so must not be called with it held.
+  void GetContentionStats(ContentionStats* stats);
+
+ private:
+  void AcquireContended();
+
+  const char* const name_;
+
+  // The number of spins it took to get the lock, averaged over the contended
+  // acquires that got it by spinning. Read without holding |lock_|.
+  subtle::Atomic32 average_spins_;
+
+  Lock lock_;
+
+  // Protected by |lock_|.
+  ContentionStats stats_;
+
+  DISALLOW_COPY_AND_ASSIGN(AdaptiveLock);
+};
+
+// Holds an AdaptiveLock while in scope.
+class AutoAdaptiveLock {
+ public:
+  explicit AutoAdaptiveLock(AdaptiveLock& lock) : lock_(lock) {
+    lock_.Acquire();
+  }
+  ~AutoAdaptiveLock() {
+    lock_.AssertAcquired();
+    lock_.Release();
+  }
+
+ private:
+  AdaptiveLock& lock_;
+  DISALLOW_COPY_AND_ASSIGN(AutoAdaptiveLock);
+};
+
+}  // namespace base
+
+#endif  // BASE_SYNCHRONIZATION_ADAPTIVE_LOCK_H_
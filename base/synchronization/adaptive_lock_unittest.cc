@@ -0,0 +1,146 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/synchronization/adaptive_lock.h"
+
+#include "base/memory/scoped_ptr.h"
+#include "base/synchronization/waitable_event.h"
+#include "base/threading/platform_thread.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+
+namespace {
+
+// Adds to a counter kIncrements times with the lock held.
+class IncrementThread : public PlatformThread::Delegate {
+ public:
+  static const int kIncrements = 100000;
+
+  IncrementThread(AdaptiveLock* lock, int* counter)
+      : lock_(lock), counter_(counter) {}
+
+  void ThreadMain() override {
+    for (int i = 0; i < kIncrements; ++i) {
+      AutoAdaptiveLock auto_lock(*lock_);
+      ++*counter_;
+    }
+  }
+
+ private:
+  AdaptiveLock* lock_;
+  int* counter_;
+
+  DISALLOW_COPY_AND_ASSIGN(IncrementThread);
+};
+
+// Signals |started| and then takes the lock.
+class AcquireThread : public PlatformThread::Delegate {
+ public:
+  AcquireThread(AdaptiveLock* lock, WaitableEvent* started)
+      : lock_(lock), started_(started) {}
+
+  void ThreadMain() override {
+    started_->Signal();
+    AutoAdaptiveLock auto_lock(*lock_);
+  }
+
+ private:
+  AdaptiveLock* lock_;
+  WaitableEvent* started_;
+
+  DISALLOW_COPY_AND_ASSIGN(AcquireThread);
+};
+
+// Records whether Try() gets the lock.
+class TryThread : public PlatformThread::Delegate {
+ public:
+  explicit TryThread(AdaptiveLock* lock) : lock_(lock), acquired_(true) {}
+
+  void ThreadMain() override { acquired_ = lock_->Try(); }
+
+  bool acquired() const { return acquired_; }
+
+ private:
+  AdaptiveLock* lock_;
+  bool acquired_;
+
+  DISALLOW_COPY_AND_ASSIGN(TryThread);
+};
+
+}  // namespace
+
+TEST(AdaptiveLockTest, Uncontended) {
+  AdaptiveLock lock("AdaptiveLockTest");
+  for (int i = 0; i < 10; ++i) {
+    lock.Acquire();
+    lock.AssertAcquired();
+    lock.Release();
+  }
+  EXPECT_TRUE(lock.Try());
+  lock.Release();
+
+  AdaptiveLock::ContentionStats stats;
+  lock.GetContentionStats(&stats);
+  EXPECT_EQ(0, stats.contended_acquires);
+  EXPECT_EQ(TimeDelta(), stats.wait_time);
+}
+
+TEST(AdaptiveLockTest, TryFailsWhenHeld) {
+  AdaptiveLock lock("AdaptiveLockTest");
+  lock.Acquire();
+
+  // Try() from another thread fails and is not counted as contention.
+  TryThread thread(&lock);
+  PlatformThreadHandle handle;
+  ASSERT_TRUE(PlatformThread::Create(0, &thread, &handle));
+  PlatformThread::Join(handle);
+  EXPECT_FALSE(thread.acquired());
+  lock.Release();
+
+  AdaptiveLock::ContentionStats stats;
+  lock.GetContentionStats(&stats);
+  EXPECT_EQ(0, stats.contended_acquires);
+}
+
+TEST(AdaptiveLockTest, CountsContendedAcquires) {
+  AdaptiveLock lock("AdaptiveLockTest");
+  lock.Acquire();
+
+  WaitableEvent started(false, false);
+  AcquireThread thread(&lock, &started);
+  PlatformThreadHandle handle;
+  ASSERT_TRUE(PlatformThread::Create(0, &thread, &handle));
+  started.Wait();
+
+  // Hold the lock for long enough that the thread parks.
+  const TimeDelta kHoldTime = TimeDelta::FromMilliseconds(50);
+  PlatformThread::Sleep(kHoldTime);
+  lock.Release();
+  PlatformThread::Join(handle);
+
+  AdaptiveLock::ContentionStats stats;
+  lock.GetContentionStats(&stats);
+  EXPECT_EQ(1, stats.contended_acquires);
+  EXPECT_GT(stats.wait_time, TimeDelta());
+}
+
+TEST(AdaptiveLockTest, MutualExclusion) {
+  const int kNumThreads = 4;
+  AdaptiveLock lock("AdaptiveLockTest");
+  int counter = 0;
+  scoped_ptr<IncrementThread> threads[kNumThreads];
+  PlatformThreadHandle handles[kNumThreads];
+  for (int i = 0; i < kNumThreads; ++i) {
+    threads[i].reset(new IncrementThread(&lock, &counter));
+    ASSERT_TRUE(PlatformThread::Create(0, threads[i].get(), &handles[i]));
+  }
+  for (int i = 0; i < kNumThreads; ++i)
+    PlatformThread::Join(handles[i]);
+
+  AutoAdaptiveLock auto_lock(lock);
+  EXPECT_EQ(kNumThreads * IncrementThread::kIncrements, counter);
+}
+
+}  // namespace base
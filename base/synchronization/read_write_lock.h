@@ -0,0 +1,87 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BASE_SYNCHRONIZATION_READ_WRITE_LOCK_H_
+#define BASE_SYNCHRONIZATION_READ_WRITE_LOCK_H_
+
+#include "base/base_export.h"
+#include "base/basictypes.h"
+#include "build/build_config.h"
+
+#if defined(OS_POSIX)
+#include <pthread.h>
+#elif defined(OS_WIN)
+#include "base/synchronization/condition_variable.h"
+#include "base/synchronization/lock.h"
+#endif
+
+namespace base {
+
+// A lock that many readers may hold at once, or one writer alone. Use it for
+// data that is read far more often than it is written; for anything else a
+// plain Lock is cheaper. The lock is not recursive: a thread must not take it
+// again, for reading or writing, while it holds it.
+//
+// On POSIX this is a pthread_rwlock_t. On Windows it is built on Lock and
+// ConditionVariable, since slim reader/writer locks need Vista. Waiting
+// writers hold off new readers there, so that writers are not starved.
+class BASE_EXPORT ReadWriteLock {
+ public:
+  ReadWriteLock();
+  ~ReadWriteLock();
+
+  void ReadAcquire();
+  void ReadRelease();
+
+  void WriteAcquire();
+  void WriteRelease();
+
+ private:
+#if defined(OS_POSIX)
+  pthread_rwlock_t native_handle_;
+#elif defined(OS_WIN)
+  Lock lock_;
+  ConditionVariable readers_done_;
+  ConditionVariable writer_done_;
+  int readers_;
+  int waiting_writers_;
+  bool writer_;
+#endif
+
+  DISALLOW_COPY_AND_ASSIGN(ReadWriteLock);
+};
+
+// Holds |lock| for reading while in scope.
+class AutoReadLock {
+ public:
+  explicit AutoReadLock(ReadWriteLock& lock) : lock_(lock) {
+    lock_.ReadAcquire();
+  }
+  ~AutoReadLock() {
+    lock_.ReadRelease();
+  }
+
+ private:
+  ReadWriteLock& lock_;
+  DISALLOW_COPY_AND_ASSIGN(AutoReadLock);
+};
+
+// Holds |lock| for writing while in scope.
+class AutoWriteLock {
+ public:
+  explicit AutoWriteLock(ReadWriteLock& lock) : lock_(lock) {
+    lock_.WriteAcquire();
+  }
+  ~AutoWriteLock() {
+    lock_.WriteRelease();
+  }
+
+ private:
+  ReadWriteLock& lock_;
+  DISALLOW_COPY_AND_ASSIGN(AutoWriteLock);
+};
+
+}  // namespace base
+
+#endif  // BASE_SYNCHRONIZATION_READ_WRITE_LOCK_H_
@@ -0,0 +1,44 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/synchronization/read_write_lock.h"
+
+#include <errno.h>
+#include <string.h>
+
+#include "base/logging.h"
+
+namespace base {
+
+ReadWriteLock::ReadWriteLock() {
+  int rv = pthread_rwlock_init(&native_handle_, NULL);
+  DCHECK_EQ(rv, 0) << ". " << strerror(rv);
+}
+
+ReadWriteLock::~ReadWriteLock() {
+  int rv = pthread_rwlock_destroy(&native_handle_);
+  DCHECK_EQ(rv, 0) << ". " << strerror(rv);
+}
+
+void ReadWriteLock::ReadAcquire() {
+  int rv = pthread_rwlock_rdlock(&native_handle_);
+  DCHECK_EQ(rv, 0) << ". " << strerror(rv);
+}
+
+void ReadWriteLock::ReadRelease() {
+  int rv = pthread_rwlock_unlock(&native_handle_);
+  DCHECK_EQ(rv, 0) << ". " << strerror(rv);
+}
+
+void ReadWriteLock::WriteAcquire() {
+  int rv = pthread_rwlock_wrlock(&native_handle_);
+  DCHECK_EQ(rv, 0) << ". " << strerror(rv);
+}
+
+void ReadWriteLock::WriteRelease() {
+  int rv = pthread_rwlock_unlock(&native_handle_);
+  DCHECK_EQ(rv, 0) << ". " << strerror(rv);
+}
+
+}  // namespace base
@@ -0,0 +1,142 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/synchronization/read_write_lock.h"
+
+#include "base/atomicops.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/synchronization/waitable_event.h"
+#include "base/threading/platform_thread.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+
+namespace {
+
+// Takes the lock for reading, signals |acquired| and holds the lock until
+// |release| is signaled.
+class ReaderThread : public PlatformThread::Delegate {
+ public:
+  ReaderThread(ReadWriteLock* lock,
+               WaitableEvent* acquired,
+               WaitableEvent* release)
+      : lock_(lock), acquired_(acquired), release_(release) {}
+
+  void ThreadMain() override {
+    AutoReadLock auto_lock(*lock_);
+    acquired_->Signal();
+    release_->Wait();
+  }
+
+ private:
+  ReadWriteLock* lock_;
+  WaitableEvent* acquired_;
+  WaitableEvent* release_;
+
+  DISALLOW_COPY_AND_ASSIGN(ReaderThread);
+};
+
+// Adds to a counter kIncrements times with the lock held for writing, checking
+// on the way that no other writer gets in.
+class WriterThread : public PlatformThread::Delegate {
+ public:
+  static const int kIncrements = 10000;
+
+  WriterThread(ReadWriteLock* lock, int* counter)
+      : lock_(lock), counter_(counter) {}
+
+  void ThreadMain() override {
+    for (int i = 0; i < kIncrements; ++i) {
+      AutoWriteLock auto_lock(*lock_);
+      int value = *counter_;
+      PlatformThread::YieldCurrentThread();
+      *counter_ = value + 1;
+    }
+  }
+
+ private:
+  ReadWriteLock* lock_;
+  int* counter_;
+
+  DISALLOW_COPY_AND_ASSIGN(WriterThread);
+};
+
+// Takes the lock for writing and records that it has it.
+class WaitingWriterThread : public PlatformThread::Delegate {
+ public:
+  explicit WaitingWriterThread(ReadWriteLock* lock)
+      : lock_(lock), acquired_(0) {}
+
+  void ThreadMain() override {
+    AutoWriteLock auto_lock(*lock_);
+    subtle::Release_Store(&acquired_, 1);
+  }
+
+  bool acquired() const { return subtle::Acquire_Load(&acquired_) != 0; }
+
+ private:
+  ReadWriteLock* lock_;
+  subtle::Atomic32 acquired_;
+
+  DISALLOW_COPY_AND_ASSIGN(WaitingWriterThread);
+};
+
+}  // namespace
+
+TEST(ReadWriteLockTest, ReadersShare) {
+  const int kNumReaders = 4;
+  ReadWriteLock lock;
+  WaitableEvent release(true, false);
+  scoped_ptr<WaitableEvent> acquired[kNumReaders];
+  scoped_ptr<ReaderThread> readers[kNumReaders];
+  PlatformThreadHandle handles[kNumReaders];
+  for (int i = 0; i < kNumReaders; ++i) {
+    acquired[i].reset(new WaitableEvent(false, false));
+    readers[i].reset(new ReaderThread(&lock, acquired[i].get(), &release));
+    ASSERT_TRUE(PlatformThread::Create(0, readers[i].get(), &handles[i]));
+  }
+
+  // Every reader holds the lock at once.
+  for (int i = 0; i < kNumReaders; ++i)
+    acquired[i]->Wait();
+
+  release.Signal();
+  for (int i = 0; i < kNumReaders; ++i)
+    PlatformThread::Join(handles[i]);
+}
+
+TEST(ReadWriteLockTest, WriterWaitsForReaders) {
+  ReadWriteLock lock;
+  lock.ReadAcquire();
+
+  WaitingWriterThread writer(&lock);
+  PlatformThreadHandle handle;
+  ASSERT_TRUE(PlatformThread::Create(0, &writer, &handle));
+
+  PlatformThread::Sleep(TimeDelta::FromMilliseconds(50));
+  EXPECT_FALSE(writer.acquired());
+  lock.ReadRelease();
+
+  PlatformThread::Join(handle);
+  EXPECT_TRUE(writer.acquired());
+}
+
+TEST(ReadWriteLockTest, WritersExclude) {
+  const int kNumWriters = 4;
+  ReadWriteLock lock;
+  int counter = 0;
+  scoped_ptr<WriterThread> writers[kNumWriters];
+  PlatformThreadHandle handles[kNumWriters];
+  for (int i = 0; i < kNumWriters; ++i) {
+    writers[i].reset(new WriterThread(&lock, &counter));
+    ASSERT_TRUE(PlatformThread::Create(0, writers[i].get(), &handles[i]));
+  }
+  for (int i = 0; i < kNumWriters; ++i)
+    PlatformThread::Join(handles[i]);
+
+  AutoReadLock auto_lock(lock);
+  EXPECT_EQ(kNumWriters * WriterThread::kIncrements, counter);
+}
+
+}  // namespace base
@@ -0,0 +1,57 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/synchronization/read_write_lock.h"
+
+#include "base/logging.h"
+
+namespace base {
+
+ReadWriteLock::ReadWriteLock()
+    : readers_done_(&lock_),
+      writer_done_(&lock_),
+      readers_(0),
+      waiting_writers_(0),
+      writer_(false) {
+}
+
+ReadWriteLock::~ReadWriteLock() {
+  DCHECK_EQ(0, readers_);
+  DCHECK(!writer_);
+}
+
+void ReadWriteLock::ReadAcquire() {
+  AutoLock auto_lock(lock_);
+  while (writer_ || waiting_writers_)
+    writer_done_.Wait();
+  ++readers_;
+}
+
+void ReadWriteLock::ReadRelease() {
+  AutoLock auto_lock(lock_);
+  DCHECK_GT(readers_, 0);
+  if (--readers_ == 0 && waiting_writers_)
+    readers_done_.Signal();
+}
+
+void ReadWriteLock::WriteAcquire() {
+  AutoLock auto_lock(lock_);
+  ++waiting_writers_;
+  while (writer_ || readers_)
+    readers_done_.Wait();
+  --waiting_writers_;
+  writer_ = true;
+}
+
+void ReadWriteLock::WriteRelease() {
+  AutoLock auto_lock(lock_);
+  DCHECK(writer_);
+  writer_ = false;
+  if (waiting_writers_)
+    readers_done_.Signal();
+  else
+    writer_done_.Broadcast();
+}
+
+}  // namespace base
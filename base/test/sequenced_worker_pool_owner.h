@@ -30,6 +30,11 @@ class SequencedWorkerPoolOwner : public SequencedWorkerPool::TestingObserver {
   SequencedWorkerPoolOwner(size_t max_threads,
                            const std::string& thread_name_prefix);
 
+  // Same as above, but the pool uses the given scheduling |backend|.
+  SequencedWorkerPoolOwner(size_t max_threads,
+                           const std::string& thread_name_prefix,
+                           SequencedWorkerPool::SchedulingBackend backend);
+
   ~SequencedWorkerPoolOwner() override;
 
   // Don't change the returned pool's testing observer.
@@ -4,13 +4,16 @@
 
 #include "base/threading/sequenced_worker_pool.h"
 
+#include <deque>
 #include <list>
 #include <map>
+#include <queue>
 #include <set>
 #include <utility>
 #include <vector>
 
 #include "base/atomic_sequence_num.h"
+#include "base/atomicops.h"
 #include "base/callback.h"
 #include "base/compiler_specific.h"
 #include "base/critical_closure.h"
@@ -253,8 +256,23 @@ class SequencedWorkerPool::Worker : public SimpleThread {
     return running_shutdown_behavior_;
   }
 
+  int thread_number() const { return thread_number_; }
+
+  // Returns the pool this worker belongs to. Only meant for identity checks;
+  // unlike |worker_pool_| this is still set while the worker drops its
+  // reference, which may be the last one.
+  SequencedWorkerPool* worker_pool() const { return owning_pool_; }
+
+  // Returns the Worker running on the current thread, or NULL if the current
+  // thread is not a worker of any SequencedWorkerPool.
+  static Worker* GetForCurrentThread();
+
  private:
+  static LazyInstance<ThreadLocalPointer<Worker> >::Leaky lazy_tls_ptr_;
+
   scoped_refptr<SequencedWorkerPool> worker_pool_;
+  SequencedWorkerPool* const owning_pool_;
+  const int thread_number_;
   SequenceToken running_sequence_;
   WorkerShutdown running_shutdown_behavior_;
 
@@ -263,46 +281,79 @@ class SequencedWorkerPool::Worker : public SimpleThread {
 
 // Inner ----------------------------------------------------------------------
 
+// Interface implemented by the scheduling backends. Everything the
+// SequencedWorkerPool forwards to its backend goes through here.
 class SequencedWorkerPool::Inner {
  public:
-  // Take a raw pointer to |worker| to avoid cycles (since we're owned
-  // by it).
-  Inner(SequencedWorkerPool* worker_pool, size_t max_threads,
-        const std::string& thread_name_prefix,
-        TestingObserver* observer);
-
-  ~Inner();
+  virtual ~Inner() {}
 
   SequenceToken GetSequenceToken();
 
-  SequenceToken GetNamedSequenceToken(const std::string& name);
+  virtual SequenceToken GetNamedSequenceToken(const std::string& name) = 0;
 
   // This function accepts a name and an ID. If the name is null, the
   // token ID is used. This allows us to implement the optional name lookup
   // from a single function without having to enter the lock a separate time.
-  bool PostTask(const std::string* optional_token_name,
-                SequenceToken sequence_token,
-                WorkerShutdown shutdown_behavior,
-                const tracked_objects::Location& from_here,
-                const Closure& task,
-                TimeDelta delay);
-
-  bool RunsTasksOnCurrentThread() const;
+  virtual bool PostTask(const std::string* optional_token_name,
+                        SequenceToken sequence_token,
+                        WorkerShutdown shutdown_behavior,
+                        const tracked_objects::Location& from_here,
+                        const Closure& task,
+                        TimeDelta delay) = 0;
 
-  bool IsRunningSequenceOnCurrentThread(SequenceToken sequence_token) const;
+  virtual bool RunsTasksOnCurrentThread() const = 0;
 
-  void CleanupForTesting();
+  virtual bool IsRunningSequenceOnCurrentThread(
+      SequenceToken sequence_token) const = 0;
 
-  void SignalHasWorkForTesting();
+  virtual void CleanupForTesting() = 0;
 
-  int GetWorkSignalCountForTesting() const;
+  virtual void SignalHasWorkForTesting() = 0;
 
-  void Shutdown(int max_blocking_tasks_after_shutdown);
+  virtual void Shutdown(int max_blocking_tasks_after_shutdown) = 0;
 
-  bool IsShutdownInProgress();
+  virtual bool IsShutdownInProgress() = 0;
 
   // Runs the worker loop on the background thread.
-  void ThreadLoop(Worker* this_worker);
+  virtual void ThreadLoop(Worker* this_worker) = 0;
+
+ private:
+  // The last sequence number used. Managed by GetSequenceToken, since this
+  // only does threadsafe increment operations, you do not need to hold the
+  // lock. This is class-static to make SequenceTokens issued by
+  // GetSequenceToken unique across SequencedWorkerPool instances.
+  static base::StaticAtomicSequenceNumber g_last_sequence_number_;
+};
+
+// GlobalQueueInner -----------------------------------------------------------
+
+class SequencedWorkerPool::GlobalQueueInner
+    : public SequencedWorkerPool::Inner {
+ public:
+  // Take a raw pointer to |worker| to avoid cycles (since we're owned
+  // by it).
+  GlobalQueueInner(SequencedWorkerPool* worker_pool, size_t max_threads,
+                   const std::string& thread_name_prefix,
+                   TestingObserver* observer);
+
+  ~GlobalQueueInner() override;
+
+  // SequencedWorkerPool::Inner implementation.
+  SequenceToken GetNamedSequenceToken(const std::string& name) override;
+  bool PostTask(const std::string* optional_token_name,
+                SequenceToken sequence_token,
+                WorkerShutdown shutdown_behavior,
+                const tracked_objects::Location& from_here,
+                const Closure& task,
+                TimeDelta delay) override;
+  bool RunsTasksOnCurrentThread() const override;
+  bool IsRunningSequenceOnCurrentThread(
+      SequenceToken sequence_token) const override;
+  void CleanupForTesting() override;
+  void SignalHasWorkForTesting() override;
+  void Shutdown(int max_blocking_tasks_after_shutdown) override;
+  bool IsShutdownInProgress() override;
+  void ThreadLoop(Worker* this_worker) override;
 
  private:
   enum GetWorkStatus {
@@ -392,12 +443,6 @@ class SequencedWorkerPool::Inner {
 
   SequencedWorkerPool* const worker_pool_;
 
-  // The last sequence number used. Managed by GetSequenceToken, since this
-  // only does threadsafe increment operations, you do not need to hold the
-  // lock. This is class-static to make SequenceTokens issued by
-  // GetSequenceToken unique across SequencedWorkerPool instances.
-  static base::StaticAtomicSequenceNumber g_last_sequence_number_;
-
   // This lock protects |everything in this class|. Do not read or modify
   // anything without holding this lock. Do not block while holding this
   // lock.
@@ -472,7 +517,227 @@ class SequencedWorkerPool::Inner {
 
   TestingObserver* const testing_observer_;
 
-  DISALLOW_COPY_AND_ASSIGN(Inner);
+  DISALLOW_COPY_AND_ASSIGN(GlobalQueueInner);
+};
+
+// WorkStealingInner ----------------------------------------------------------
+
+// Backend that avoids a pool-wide lock when posting and running tasks.
+//
+// Runnable work is spread over one queue per worker. A worker takes work from
+// its own queue first and steals from the other queues when that is empty. A
+// work item is either an unsequenced task or the ID of a sequence. The tasks
+// of a sequence wait in a per-sequence queue, and the sequence is put on a
+// worker queue only when that queue goes from empty to non-empty. The worker
+// that takes the sequence has claimed it until the sequence runs dry, so the
+// tasks of a sequence never run concurrently or out of order.
+//
+// Delayed tasks wait in a separate time-ordered set until they are due.
+// Shutdown bookkeeping uses atomic counters; the only lock shared by all
+// threads is |idle_lock_|, which is taken to park and wake up idle workers.
+class SequencedWorkerPool::WorkStealingInner
+    : public SequencedWorkerPool::Inner {
+ public:
+  // Take a raw pointer to |worker| to avoid cycles (since we're owned
+  // by it).
+  WorkStealingInner(SequencedWorkerPool* worker_pool, size_t max_threads,
+                    const std::string& thread_name_prefix,
+                    TestingObserver* observer);
+
+  ~WorkStealingInner() override;
+
+  // SequencedWorkerPool::Inner implementation.
+  SequenceToken GetNamedSequenceToken(const std::string& name) override;
+  bool PostTask(const std::string* optional_token_name,
+                SequenceToken sequence_token,
+                WorkerShutdown shutdown_behavior,
+                const tracked_objects::Location& from_here,
+                const Closure& task,
+                TimeDelta delay) override;
+  bool RunsTasksOnCurrentThread() const override;
+  bool IsRunningSequenceOnCurrentThread(
+      SequenceToken sequence_token) const override;
+  void CleanupForTesting() override;
+  void SignalHasWorkForTesting() override;
+  void Shutdown(int max_blocking_tasks_after_shutdown) override;
+  bool IsShutdownInProgress() override;
+  void ThreadLoop(Worker* this_worker) override;
+
+ private:
+  // An unsequenced task, or the ID of a sequence whose next task should run.
+  struct WorkItem {
+    WorkItem() : sequence_token_id(0) {}
+
+    int sequence_token_id;
+
+    // Only used when |sequence_token_id| is 0.
+    SequencedTask task;
+  };
+
+  // The queue of runnable work owned by one worker.
+  struct WorkerQueue {
+    WorkerQueue() : size(0) {}
+
+    Lock lock;
+    std::deque<WorkItem> items;
+
+    // Mirrors items.size() so that stealing workers can skip empty queues
+    // without taking |lock|. Written under |lock|.
+    subtle::Atomic32 size;
+  };
+
+  // Pending tasks of the sequences whose IDs hash to this shard. A sequence
+  // has an entry here exactly as long as it has a queued or running task.
+  // The front task of a sequence stays in the queue while it runs.
+  struct SequenceShard {
+    Lock lock;
+    std::map<int, std::queue<SequencedTask> > sequences;
+  };
+
+  typedef std::set<SequencedTask, SequencedTaskLessThan> DelayedTaskSet;
+
+  enum { kNumSequenceShards = 16 };
+
+  // Converts the given token name into a token ID, creating a new one if
+  // necessary.
+  int GetNamedTokenID(const std::string& name);
+
+  // Returns the worker of this pool running on the current thread, or NULL.
+  Worker* CurrentWorker() const;
+
+  // Returns the shutdown behavior of the task running on the current thread,
+  // or CONTINUE_ON_SHUTDOWN if this is not one of our workers.
+  WorkerShutdown CurrentThreadShutdownBehavior() const;
+
+  // Called when a BLOCK_SHUTDOWN task is posted after Shutdown(). Consumes
+  // one of the |max_blocking_tasks_after_shutdown_| slots if the task is
+  // allowed.
+  bool AllowBlockingTaskAfterShutdown();
+
+  // Returns the queue that work posted from the current thread goes to.
+  size_t QueueIndexForCurrentThread();
+
+  // Queues |task|, which must already be due and counted in
+  // |pending_task_count_|. If it makes a new work item runnable, the item is
+  // pushed on the queue at |queue_index|.
+  void EnqueueTask(const SequencedTask& task, size_t queue_index);
+
+  void PushWorkItem(const WorkItem& item, size_t queue_index);
+
+  // Takes a work item from the queue at |queue_index|, or failing that from
+  // any other queue. Returns false if all queues are empty.
+  bool TakeWorkItem(size_t queue_index, WorkItem* item);
+
+  // Returns true if any worker queue has work in it.
+  bool HasQueuedWork() const;
+
+  // Runs, or deletes during shutdown, the next task of |item|. Reschedules the
+  // sequence on the queue at |queue_index| if it has more tasks.
+  void RunWorkItem(Worker* worker, size_t queue_index, WorkItem* item);
+
+  // Moves the delayed tasks that are due to the worker queues, or deletes all
+  // delayed tasks once shutdown has started.
+  void PromoteDueDelayedTasks(size_t queue_index);
+
+  // Returns when the next delayed task is due, or a null TimeTicks.
+  TimeTicks NextDelayedRunTime();
+
+  // Blocks the calling worker until there may be new work for it.
+  void WaitForWork();
+
+  // Wakes up an idle worker. If there is none, starts a new one if the pool
+  // may still grow.
+  void WakeUpWorker();
+
+  // Signal |has_work_cv_| and notify the testing observer.
+  void SignalHasWork();
+
+  void StartAdditionalThreadIfHelpful();
+
+  bool IsShutdownCalled() const;
+
+  // Returns true if a worker with nothing left to run can exit.
+  bool ShouldWorkerExit() const;
+
+  // Checks whether there is work left that's blocking shutdown.
+  bool CanShutdown() const;
+
+  // Wakes up Shutdown() so that it re-evaluates CanShutdown().
+  void SignalCanShutdown();
+
+  SequencedWorkerPool* const worker_pool_;
+
+  // The maximum number of worker threads we'll create, which is also the
+  // number of entries in |queues_|.
+  const size_t max_threads_;
+
+  const std::string thread_name_prefix_;
+
+  scoped_ptr<WorkerQueue[]> queues_;
+
+  SequenceShard sequence_shards_[kNumSequenceShards];
+
+  // Round-robin cursor for work posted from threads that are not workers.
+  subtle::Atomic32 next_queue_index_;
+
+  // Associates all known sequence token names with their IDs.
+  Lock named_sequence_tokens_lock_;
+  std::map<std::string, int> named_sequence_tokens_;
+
+  // Delayed tasks that are not due yet, in time-to-run order.
+  Lock delayed_tasks_lock_;
+  DelayedTaskSet delayed_tasks_;
+  subtle::Atomic32 delayed_task_count_;
+
+  // Idle workers wait on |has_work_cv_|; FlushForTesting() waits on
+  // |flush_cv_|, which is signaled whenever a worker goes idle.
+  Lock idle_lock_;
+  ConditionVariable has_work_cv_;
+  ConditionVariable flush_cv_;
+  subtle::Atomic32 idle_thread_count_;
+
+  // Owning pointers to all threads we've created so far.
+  Lock threads_lock_;
+  std::vector<linked_ptr<Worker> > threads_;
+
+  // Number of threads started so far, and whether one is being started right
+  // now. Threads are started one at a time, as with the global queue.
+  subtle::Atomic32 started_thread_count_;
+  subtle::Atomic32 thread_being_created_;
+
+  // Number of due tasks that have not started running yet, and number of
+  // tasks that are running.
+  subtle::Atomic32 pending_task_count_;
+  subtle::Atomic32 running_task_count_;
+
+  // Number of pending tasks that are marked as BLOCK_SHUTDOWN.
+  subtle::Atomic32 blocking_shutdown_pending_task_count_;
+
+  // Number of threads currently running tasks that have the BLOCK_SHUTDOWN
+  // or SKIP_ON_SHUTDOWN flag set.
+  subtle::Atomic32 blocking_shutdown_thread_count_;
+
+  // Sources of the task IDs used in traces and of the tie-breakers for
+  // delayed tasks due at the same time.
+  subtle::Atomic32 next_trace_id_;
+  subtle::AtomicWord next_sequence_task_number_;
+
+  // Set when Shutdown is called and no further tasks should be allowed,
+  // though we may still be running existing tasks. Written under
+  // |shutdown_lock_|.
+  subtle::Atomic32 shutdown_called_;
+
+  // The number of new BLOCK_SHUTDOWN tasks that may be posted after Shudown()
+  // has been called.
+  subtle::Atomic32 max_blocking_tasks_after_shutdown_;
+
+  // Shutdown() waits on |can_shutdown_cv_| until CanShutdown() goes to true.
+  Lock shutdown_lock_;
+  ConditionVariable can_shutdown_cv_;
+
+  TestingObserver* const testing_observer_;
+
+  DISALLOW_COPY_AND_ASSIGN(WorkStealingInner);
 };
 
 // Worker definitions ---------------------------------------------------------
@@ -483,6 +748,8 @@ SequencedWorkerPool::Worker::Worker(
     const std::string& prefix)
     : SimpleThread(prefix + StringPrintf("Worker%d", thread_number)),
       worker_pool_(worker_pool),
+      owning_pool_(worker_pool.get()),
+      thread_number_(thread_number),
       running_shutdown_behavior_(CONTINUE_ON_SHUTDOWN) {
   Start();
 }
@@ -498,6 +765,7 @@ void SequencedWorkerPool::Worker::Run() {
   // Store a pointer to the running sequence in thread local storage for
   // static function access.
   g_lazy_tls_ptr.Get().Set(&running_sequence_);
+  lazy_tls_ptr_.Get().Set(this);
 
   // Just jump back to the Inner object to run the thread, since it has all the
   // tracking information and queues. It might be more natural to implement
@@ -505,13 +773,41 @@ void SequencedWorkerPool::Worker::Run() {
   // having these worker objects at all, but that method lacks the ability to
   // send thread-specific information easily to the thread loop.
   worker_pool_->inner_->ThreadLoop(this);
-  // Release our cyclic reference once we're done.
+  // Release our cyclic reference once we're done. This thread still counts as
+  // a worker of the pool meanwhile, so that SequencedWorkerPool::OnDestruct()
+  // doesn't delete the pool here if this was the last reference.
   worker_pool_ = NULL;
+  lazy_tls_ptr_.Get().Set(NULL);
+}
+
+// static
+SequencedWorkerPool::Worker*
+SequencedWorkerPool::Worker::GetForCurrentThread() {
+  // Don't construct lazy instance on check.
+  if (lazy_tls_ptr_ == NULL)
+    return NULL;
+  return lazy_tls_ptr_.Get().Get();
 }
 
+// static
+LazyInstance<ThreadLocalPointer<SequencedWorkerPool::Worker> >::Leaky
+    SequencedWorkerPool::Worker::lazy_tls_ptr_ = LAZY_INSTANCE_INITIALIZER;
+
 // Inner definitions ---------------------------------------------------------
 
-SequencedWorkerPool::Inner::Inner(
+SequencedWorkerPool::SequenceToken
+SequencedWorkerPool::Inner::GetSequenceToken() {
+  // Need to add one because StaticAtomicSequenceNumber starts at zero, which
+  // is used as a sentinel value in SequenceTokens.
+  return SequenceToken(g_last_sequence_number_.GetNext() + 1);
+}
+
+base::StaticAtomicSequenceNumber
+SequencedWorkerPool::Inner::g_last_sequence_number_;
+
+// GlobalQueueInner definitions ----------------------------------------------
+
+SequencedWorkerPool::GlobalQueueInner::GlobalQueueInner(
     SequencedWorkerPool* worker_pool,
     size_t max_threads,
     const std::string& thread_name_prefix,
@@ -535,7 +831,7 @@ SequencedWorkerPool::Inner::Inner(
       cleanup_cv_(&lock_),
       testing_observer_(observer) {}
 
-SequencedWorkerPool::Inner::~Inner() {
+SequencedWorkerPool::GlobalQueueInner::~GlobalQueueInner() {
   // You must call Shutdown() before destroying the pool.
   DCHECK(shutdown_called_);
 
@@ -550,19 +846,13 @@ SequencedWorkerPool::Inner::~Inner() {
 }
 
 SequencedWorkerPool::SequenceToken
-SequencedWorkerPool::Inner::GetSequenceToken() {
-  // Need to add one because StaticAtomicSequenceNumber starts at zero, which
-  // is used as a sentinel value in SequenceTokens.
-  return SequenceToken(g_last_sequence_number_.GetNext() + 1);
-}
-
-SequencedWorkerPool::SequenceToken
-SequencedWorkerPool::Inner::GetNamedSequenceToken(const std::string& name) {
+SequencedWorkerPool::GlobalQueueInner::GetNamedSequenceToken(
+    const std::string& name) {
   AutoLock lock(lock_);
   return SequenceToken(LockedGetNamedTokenID(name));
 }
 
-bool SequencedWorkerPool::Inner::PostTask(
+bool SequencedWorkerPool::GlobalQueueInner::PostTask(
     const std::string* optional_token_name,
     SequenceToken sequence_token,
     WorkerShutdown shutdown_behavior,
@@ -624,12 +914,12 @@ bool SequencedWorkerPool::Inner::PostTask(
   return true;
 }
 
-bool SequencedWorkerPool::Inner::RunsTasksOnCurrentThread() const {
+bool SequencedWorkerPool::GlobalQueueInner::RunsTasksOnCurrentThread() const {
   AutoLock lock(lock_);
   return ContainsKey(threads_, PlatformThread::CurrentId());
 }
 
-bool SequencedWorkerPool::Inner::IsRunningSequenceOnCurrentThread(
+bool SequencedWorkerPool::GlobalQueueInner::IsRunningSequenceOnCurrentThread(
     SequenceToken sequence_token) const {
   AutoLock lock(lock_);
   ThreadMap::const_iterator found = threads_.find(PlatformThread::CurrentId());
@@ -639,7 +929,7 @@ bool SequencedWorkerPool::Inner::IsRunningSequenceOnCurrentThread(
 }
 
 // See https://code.google.com/p/chromium/issues/detail?id=168415
-void SequencedWorkerPool::Inner::CleanupForTesting() {
+void SequencedWorkerPool::GlobalQueueInner::CleanupForTesting() {
   DCHECK(!RunsTasksOnCurrentThread());
   base::ThreadRestrictions::ScopedAllowWait allow_wait;
   AutoLock lock(lock_);
@@ -655,11 +945,11 @@ void SequencedWorkerPool::Inner::CleanupForTesting() {
     cleanup_cv_.Wait();
 }
 
-void SequencedWorkerPool::Inner::SignalHasWorkForTesting() {
+void SequencedWorkerPool::GlobalQueueInner::SignalHasWorkForTesting() {
   SignalHasWork();
 }
 
-void SequencedWorkerPool::Inner::Shutdown(
+void SequencedWorkerPool::GlobalQueueInner::Shutdown(
     int max_new_blocking_tasks_after_shutdown) {
   DCHECK_GE(max_new_blocking_tasks_after_shutdown, 0);
   {
@@ -702,12 +992,12 @@ void SequencedWorkerPool::Inner::Shutdown(
 #endif
 }
 
-bool SequencedWorkerPool::Inner::IsShutdownInProgress() {
+bool SequencedWorkerPool::GlobalQueueInner::IsShutdownInProgress() {
     AutoLock lock(lock_);
     return shutdown_called_;
 }
 
-void SequencedWorkerPool::Inner::ThreadLoop(Worker* this_worker) {
+void SequencedWorkerPool::GlobalQueueInner::ThreadLoop(Worker* this_worker) {
   {
     AutoLock lock(lock_);
     DCHECK(thread_being_created_);
@@ -826,7 +1116,7 @@ void SequencedWorkerPool::Inner::ThreadLoop(Worker* this_worker) {
   can_shutdown_cv_.Signal();
 }
 
-void SequencedWorkerPool::Inner::HandleCleanup() {
+void SequencedWorkerPool::GlobalQueueInner::HandleCleanup() {
   lock_.AssertAcquired();
   if (cleanup_state_ == CLEANUP_DONE)
     return;
@@ -866,7 +1156,7 @@ void SequencedWorkerPool::Inner::HandleCleanup() {
   }
 }
 
-int SequencedWorkerPool::Inner::LockedGetNamedTokenID(
+int SequencedWorkerPool::GlobalQueueInner::LockedGetNamedTokenID(
     const std::string& name) {
   lock_.AssertAcquired();
   DCHECK(!name.empty());
@@ -882,14 +1172,15 @@ int SequencedWorkerPool::Inner::LockedGetNamedTokenID(
   return result.id_;
 }
 
-int64 SequencedWorkerPool::Inner::LockedGetNextSequenceTaskNumber() {
+int64 SequencedWorkerPool::GlobalQueueInner::LockedGetNextSequenceTaskNumber() {
   lock_.AssertAcquired();
   // We assume that we never create enough tasks to wrap around.
   return next_sequence_task_number_++;
 }
 
 SequencedWorkerPool::WorkerShutdown
-SequencedWorkerPool::Inner::LockedCurrentThreadShutdownBehavior() const {
+SequencedWorkerPool::GlobalQueueInner::LockedCurrentThreadShutdownBehavior()
+    const {
   lock_.AssertAcquired();
   ThreadMap::const_iterator found = threads_.find(PlatformThread::CurrentId());
   if (found == threads_.end())
@@ -897,7 +1188,8 @@ SequencedWorkerPool::Inner::LockedCurrentThreadShutdownBehavior() const {
   return found->second->running_shutdown_behavior();
 }
 
-SequencedWorkerPool::Inner::GetWorkStatus SequencedWorkerPool::Inner::GetWork(
+SequencedWorkerPool::GlobalQueueInner::GetWorkStatus
+SequencedWorkerPool::GlobalQueueInner::GetWork(
     SequencedTask* task,
     TimeDelta* wait_time,
     std::vector<Closure>* delete_these_outside_lock) {
@@ -986,7 +1278,8 @@ SequencedWorkerPool::Inner::GetWorkStatus SequencedWorkerPool::Inner::GetWork(
   return status;
 }
 
-int SequencedWorkerPool::Inner::WillRunWorkerTask(const SequencedTask& task) {
+int SequencedWorkerPool::GlobalQueueInner::WillRunWorkerTask(
+    const SequencedTask& task) {
   lock_.AssertAcquired();
 
   // Mark the task's sequence number as in use.
@@ -1017,7 +1310,8 @@ int SequencedWorkerPool::Inner::WillRunWorkerTask(const SequencedTask& task) {
   return PrepareToStartAdditionalThreadIfHelpful();
 }
 
-void SequencedWorkerPool::Inner::DidRunWorkerTask(const SequencedTask& task) {
+void SequencedWorkerPool::GlobalQueueInner::DidRunWorkerTask(
+    const SequencedTask& task) {
   lock_.AssertAcquired();
 
   if (task.shutdown_behavior != CONTINUE_ON_SHUTDOWN) {
@@ -1029,7 +1323,7 @@ void SequencedWorkerPool::Inner::DidRunWorkerTask(const SequencedTask& task) {
     current_sequences_.erase(task.sequence_token_id);
 }
 
-bool SequencedWorkerPool::Inner::IsSequenceTokenRunnable(
+bool SequencedWorkerPool::GlobalQueueInner::IsSequenceTokenRunnable(
     int sequence_token_id) const {
   lock_.AssertAcquired();
   return !sequence_token_id ||
@@ -1037,7 +1331,8 @@ bool SequencedWorkerPool::Inner::IsSequenceTokenRunnable(
           current_sequences_.end();
 }
 
-int SequencedWorkerPool::Inner::PrepareToStartAdditionalThreadIfHelpful() {
+int SequencedWorkerPool::GlobalQueueInner::
+    PrepareToStartAdditionalThreadIfHelpful() {
   lock_.AssertAcquired();
   // How thread creation works:
   //
@@ -1086,7 +1381,7 @@ int SequencedWorkerPool::Inner::PrepareToStartAdditionalThreadIfHelpful() {
   return 0;
 }
 
-void SequencedWorkerPool::Inner::FinishStartingAdditionalThread(
+void SequencedWorkerPool::GlobalQueueInner::FinishStartingAdditionalThread(
     int thread_number) {
   // Called outside of the lock.
   DCHECK(thread_number > 0);
@@ -1096,14 +1391,14 @@ void SequencedWorkerPool::Inner::FinishStartingAdditionalThread(
   new Worker(worker_pool_, thread_number, thread_name_prefix_);
 }
 
-void SequencedWorkerPool::Inner::SignalHasWork() {
+void SequencedWorkerPool::GlobalQueueInner::SignalHasWork() {
   has_work_cv_.Signal();
   if (testing_observer_) {
     testing_observer_->OnHasWork();
   }
 }
 
-bool SequencedWorkerPool::Inner::CanShutdown() const {
+bool SequencedWorkerPool::GlobalQueueInner::CanShutdown() const {
   lock_.AssertAcquired();
   // See PrepareToStartAdditionalThreadIfHelpful for how thread creation works.
   return !thread_being_created_ &&
@@ -1111,8 +1406,611 @@ bool SequencedWorkerPool::Inner::CanShutdown() const {
          blocking_shutdown_pending_task_count_ == 0;
 }
 
-base::StaticAtomicSequenceNumber
-SequencedWorkerPool::Inner::g_last_sequence_number_;
+
+// WorkStealingInner definitions ---------------------------------------------
+
+SequencedWorkerPool::WorkStealingInner::WorkStealingInner(
+    SequencedWorkerPool* worker_pool,
+    size_t max_threads,
+    const std::string& thread_name_prefix,
+    TestingObserver* observer)
+    : worker_pool_(worker_pool),
+      max_threads_(max_threads),
+      thread_name_prefix_(thread_name_prefix),
+      queues_(new WorkerQueue[max_threads]),
+      next_queue_index_(0),
+      delayed_task_count_(0),
+      has_work_cv_(&idle_lock_),
+      flush_cv_(&idle_lock_),
+      idle_thread_count_(0),
+      started_thread_count_(0),
+      thread_being_created_(0),
+      pending_task_count_(0),
+      running_task_count_(0),
+      blocking_shutdown_pending_task_count_(0),
+      blocking_shutdown_thread_count_(0),
+      next_trace_id_(0),
+      next_sequence_task_number_(0),
+      shutdown_called_(0),
+      max_blocking_tasks_after_shutdown_(0),
+      can_shutdown_cv_(&shutdown_lock_),
+      testing_observer_(observer) {
+  DCHECK_GT(max_threads, 0u);
+}
+
+SequencedWorkerPool::WorkStealingInner::~WorkStealingInner() {
+  // You must call Shutdown() before destroying the pool.
+  DCHECK(IsShutdownCalled());
+
+  // Need to explicitly join with the threads before they're destroyed or else
+  // they will be running when our object is half torn down.
+  std::vector<linked_ptr<Worker> > threads;
+  {
+    AutoLock lock(threads_lock_);
+    threads.swap(threads_);
+  }
+  for (size_t i = 0; i < threads.size(); ++i)
+    threads[i]->Join();
+  threads.clear();
+
+  if (testing_observer_)
+    testing_observer_->OnDestruct();
+}
+
+SequencedWorkerPool::SequenceToken
+SequencedWorkerPool::WorkStealingInner::GetNamedSequenceToken(
+    const std::string& name) {
+  return SequenceToken(GetNamedTokenID(name));
+}
+
+bool SequencedWorkerPool::WorkStealingInner::PostTask(
+    const std::string* optional_token_name,
+    SequenceToken sequence_token,
+    WorkerShutdown shutdown_behavior,
+    const tracked_objects::Location& from_here,
+    const Closure& task,
+    TimeDelta delay) {
+  DCHECK(delay == TimeDelta() || shutdown_behavior == SKIP_ON_SHUTDOWN);
+
+  if (shutdown_behavior == BLOCK_SHUTDOWN) {
+    // Count the task before looking at |shutdown_called_|. Shutdown() sets
+    // the flag before looking at the count, so either it waits for this task
+    // or we see the flag.
+    subtle::Barrier_AtomicIncrement(&blocking_shutdown_pending_task_count_, 1);
+    if (IsShutdownCalled() && !AllowBlockingTaskAfterShutdown()) {
+      subtle::Barrier_AtomicIncrement(&blocking_shutdown_pending_task_count_,
+                                      -1);
+      SignalCanShutdown();
+      return false;
+    }
+  } else if (IsShutdownCalled()) {
+    return false;
+  }
+
+  SequencedTask sequenced(from_here);
+  sequenced.sequence_token_id = optional_token_name ?
+      GetNamedTokenID(*optional_token_name) : sequence_token.id_;
+  sequenced.shutdown_behavior = shutdown_behavior;
+  sequenced.posted_from = from_here;
+  sequenced.task =
+      shutdown_behavior == BLOCK_SHUTDOWN ?
+      base::MakeCriticalClosure(task) : task;
+  sequenced.time_to_run = TimeTicks::Now() + delay;
+
+  // The trace_id is used for identifying the task in about:tracing.
+  sequenced.trace_id =
+      subtle::NoBarrier_AtomicIncrement(&next_trace_id_, 1) - 1;
+
+  TRACE_EVENT_FLOW_BEGIN0(TRACE_DISABLED_BY_DEFAULT("toplevel.flow"),
+      "SequencedWorkerPool::PostTask",
+      TRACE_ID_MANGLE(GetTaskTraceID(sequenced, static_cast<void*>(this))));
+
+  sequenced.sequence_task_number =
+      subtle::NoBarrier_AtomicIncrement(&next_sequence_task_number_, 1) - 1;
+
+  if (delay > TimeDelta()) {
+    {
+      AutoLock lock(delayed_tasks_lock_);
+      delayed_tasks_.insert(sequenced);
+      subtle::NoBarrier_Store(&delayed_task_count_,
+                              static_cast<subtle::Atomic32>(
+                                  delayed_tasks_.size()));
+    }
+    // A sleeping worker may have to wake up earlier than it planned to.
+    WakeUpWorker();
+    return true;
+  }
+
+  subtle::Barrier_AtomicIncrement(&pending_task_count_, 1);
+  EnqueueTask(sequenced, QueueIndexForCurrentThread());
+  return true;
+}
+
+bool SequencedWorkerPool::WorkStealingInner::RunsTasksOnCurrentThread() const {
+  return CurrentWorker() != NULL;
+}
+
+bool SequencedWorkerPool::WorkStealingInner::IsRunningSequenceOnCurrentThread(
+    SequenceToken sequence_token) const {
+  Worker* worker = CurrentWorker();
+  return worker && sequence_token.Equals(worker->running_sequence());
+}
+
+void SequencedWorkerPool::WorkStealingInner::CleanupForTesting() {
+  DCHECK(!RunsTasksOnCurrentThread());
+  base::ThreadRestrictions::ScopedAllowWait allow_wait;
+  if (IsShutdownCalled())
+    return;
+
+  // Delayed tasks are deleted rather than waited for.
+  DelayedTaskSet delayed_tasks;
+  {
+    AutoLock lock(delayed_tasks_lock_);
+    delayed_tasks.swap(delayed_tasks_);
+    subtle::NoBarrier_Store(&delayed_task_count_, 0);
+  }
+  delayed_tasks.clear();
+
+  AutoLock lock(idle_lock_);
+  while (subtle::Acquire_Load(&pending_task_count_) > 0 ||
+         subtle::Acquire_Load(&running_task_count_) > 0) {
+    flush_cv_.Wait();
+  }
+}
+
+void SequencedWorkerPool::WorkStealingInner::SignalHasWorkForTesting() {
+  SignalHasWork();
+}
+
+void SequencedWorkerPool::WorkStealingInner::Shutdown(
+    int max_new_blocking_tasks_after_shutdown) {
+  DCHECK_GE(max_new_blocking_tasks_after_shutdown, 0);
+  {
+    AutoLock lock(shutdown_lock_);
+    if (IsShutdownCalled())
+      return;
+    subtle::NoBarrier_Store(&max_blocking_tasks_after_shutdown_,
+                            max_new_blocking_tasks_after_shutdown);
+    subtle::Release_Store(&shutdown_called_, 1);
+  }
+  // Pairs with the barriers on the posting and running paths, see PostTask().
+  subtle::MemoryBarrier();
+
+  // Wake up all idle workers so that they delete the work that no longer
+  // needs to run and exit once nothing blocks shutdown anymore.
+  {
+    AutoLock lock(idle_lock_);
+    has_work_cv_.Broadcast();
+  }
+  if (testing_observer_)
+    testing_observer_->OnHasWork();
+
+  // There are no pending or running tasks blocking shutdown, we're done.
+  if (CanShutdown())
+    return;
+
+  // If we're here, then something is blocking shutdown.  So wait for
+  // CanShutdown() to go to true.
+
+  if (testing_observer_)
+    testing_observer_->WillWaitForShutdown();
+
+#if !defined(OS_NACL)
+  TimeTicks shutdown_wait_begin = TimeTicks::Now();
+#endif
+
+  {
+    base::ThreadRestrictions::ScopedAllowWait allow_wait;
+    AutoLock lock(shutdown_lock_);
+    while (!CanShutdown())
+      can_shutdown_cv_.Wait();
+  }
+#if !defined(OS_NACL)
+  UMA_HISTOGRAM_TIMES("SequencedWorkerPool.ShutdownDelayTime",
+                      TimeTicks::Now() - shutdown_wait_begin);
+#endif
+}
+
+bool SequencedWorkerPool::WorkStealingInner::IsShutdownInProgress() {
+  return IsShutdownCalled();
+}
+
+void SequencedWorkerPool::WorkStealingInner::ThreadLoop(Worker* this_worker) {
+  {
+    AutoLock lock(threads_lock_);
+    threads_.push_back(make_linked_ptr(this_worker));
+  }
+  DCHECK_EQ(1, subtle::NoBarrier_Load(&thread_being_created_));
+  subtle::Barrier_AtomicIncrement(&thread_being_created_, -1);
+  SignalCanShutdown();
+
+  const size_t queue_index = this_worker->thread_number() - 1;
+  DCHECK_LT(queue_index, max_threads_);
+
+  while (true) {
+#if defined(OS_MACOSX)
+    base::mac::ScopedNSAutoreleasePool autorelease_pool;
+#endif
+
+    PromoteDueDelayedTasks(queue_index);
+
+    WorkItem item;
+    if (TakeWorkItem(queue_index, &item)) {
+      RunWorkItem(this_worker, queue_index, &item);
+      continue;
+    }
+
+    // When we're terminating and there's no more work, we can shut down;
+    // see GlobalQueueInner::ThreadLoop for why this is safe.
+    if (ShouldWorkerExit())
+      break;
+
+    WaitForWork();
+  }
+
+  // We noticed we should exit. Wake up the other workers so they know they
+  // should exit as well.
+  {
+    AutoLock lock(idle_lock_);
+    has_work_cv_.Broadcast();
+  }
+
+  // Possibly unblock shutdown.
+  SignalCanShutdown();
+}
+
+int SequencedWorkerPool::WorkStealingInner::GetNamedTokenID(
+    const std::string& name) {
+  DCHECK(!name.empty());
+  AutoLock lock(named_sequence_tokens_lock_);
+
+  std::map<std::string, int>::const_iterator found =
+      named_sequence_tokens_.find(name);
+  if (found != named_sequence_tokens_.end())
+    return found->second;  // Got an existing one.
+
+  // Create a new one for this name.
+  SequenceToken result = GetSequenceToken();
+  named_sequence_tokens_.insert(std::make_pair(name, result.id_));
+  return result.id_;
+}
+
+SequencedWorkerPool::Worker*
+SequencedWorkerPool::WorkStealingInner::CurrentWorker() const {
+  Worker* worker = Worker::GetForCurrentThread();
+  if (!worker || worker->worker_pool() != worker_pool_)
+    return NULL;
+  return worker;
+}
+
+SequencedWorkerPool::WorkerShutdown
+SequencedWorkerPool::WorkStealingInner::CurrentThreadShutdownBehavior() const {
+  Worker* worker = CurrentWorker();
+  return worker ? worker->running_shutdown_behavior() : CONTINUE_ON_SHUTDOWN;
+}
+
+bool SequencedWorkerPool::WorkStealingInner::AllowBlockingTaskAfterShutdown() {
+  if (CurrentThreadShutdownBehavior() == CONTINUE_ON_SHUTDOWN)
+    return false;
+
+  subtle::Atomic32 remaining =
+      subtle::Acquire_Load(&max_blocking_tasks_after_shutdown_);
+  while (remaining > 0) {
+    subtle::Atomic32 previous = subtle::NoBarrier_CompareAndSwap(
+        &max_blocking_tasks_after_shutdown_, remaining, remaining - 1);
+    if (previous == remaining)
+      return true;
+    remaining = previous;
+  }
+  DLOG(WARNING) << "BLOCK_SHUTDOWN task disallowed";
+  return false;
+}
+
+size_t SequencedWorkerPool::WorkStealingInner::QueueIndexForCurrentThread() {
+  Worker* worker = CurrentWorker();
+  if (worker)
+    return worker->thread_number() - 1;
+
+  // Spread work from other threads over the queues of the running workers.
+  // Queues of workers that don't exist yet are drained by stealing.
+  size_t num_queues = std::max(
+      static_cast<size_t>(subtle::NoBarrier_Load(&started_thread_count_)),
+      static_cast<size_t>(1));
+  size_t index = static_cast<size_t>(
+      subtle::NoBarrier_AtomicIncrement(&next_queue_index_, 1));
+  return index % num_queues;
+}
+
+void SequencedWorkerPool::WorkStealingInner::EnqueueTask(
+    const SequencedTask& task,
+    size_t queue_index) {
+  WorkItem item;
+  if (!task.sequence_token_id) {
+    item.task = task;
+    PushWorkItem(item, queue_index);
+    return;
+  }
+
+  // Only the post that makes the sequence non-empty schedules it; until the
+  // sequence is empty again, the worker that takes it keeps it scheduled.
+  SequenceShard* shard =
+      &sequence_shards_[task.sequence_token_id % kNumSequenceShards];
+  bool schedule_sequence;
+  {
+    AutoLock lock(shard->lock);
+    std::queue<SequencedTask>& sequence =
+        shard->sequences[task.sequence_token_id];
+    schedule_sequence = sequence.empty();
+    sequence.push(task);
+  }
+  if (schedule_sequence) {
+    item.sequence_token_id = task.sequence_token_id;
+    PushWorkItem(item, queue_index);
+  }
+}
+
+void SequencedWorkerPool::WorkStealingInner::PushWorkItem(
+    const WorkItem& item,
+    size_t queue_index) {
+  WorkerQueue* queue = &queues_[queue_index];
+  {
+    AutoLock lock(queue->lock);
+    queue->items.push_back(item);
+    subtle::NoBarrier_Store(&queue->size,
+                            static_cast<subtle::Atomic32>(queue->items.size()));
+  }
+  WakeUpWorker();
+}
+
+bool SequencedWorkerPool::WorkStealingInner::TakeWorkItem(size_t queue_index,
+                                                          WorkItem* item) {
+  for (size_t i = 0; i < max_threads_; ++i) {
+    WorkerQueue* queue = &queues_[(queue_index + i) % max_threads_];
+    if (!subtle::NoBarrier_Load(&queue->size))
+      continue;
+    AutoLock lock(queue->lock);
+    if (queue->items.empty())
+      continue;
+    // |item| shares the closure with the queued copy, so popping does not
+    // destroy anything under the lock.
+    *item = queue->items.front();
+    queue->items.pop_front();
+    subtle::NoBarrier_Store(&queue->size,
+                            static_cast<subtle::Atomic32>(queue->items.size()));
+    return true;
+  }
+  return false;
+}
+
+bool SequencedWorkerPool::WorkStealingInner::HasQueuedWork() const {
+  for (size_t i = 0; i < max_threads_; ++i) {
+    if (subtle::Acquire_Load(&queues_[i].size))
+      return true;
+  }
+  return false;
+}
+
+void SequencedWorkerPool::WorkStealingInner::RunWorkItem(Worker* worker,
+                                                         size_t queue_index,
+                                                         WorkItem* item) {
+  SequencedTask task;
+  SequenceShard* shard = NULL;
+  if (item->sequence_token_id) {
+    shard = &sequence_shards_[item->sequence_token_id % kNumSequenceShards];
+    AutoLock lock(shard->lock);
+    std::queue<SequencedTask>& sequence =
+        shard->sequences[item->sequence_token_id];
+    DCHECK(!sequence.empty());
+    task = sequence.front();
+    // Drop the queue's reference so that the closure is destroyed by this
+    // thread outside the lock.
+    sequence.front().task.Reset();
+  } else {
+    task = item->task;
+    item->task.task.Reset();
+  }
+
+  // Count the task as running before it stops counting as pending, so that
+  // neither Shutdown() nor FlushForTesting() can miss it in between.
+  if (task.shutdown_behavior != CONTINUE_ON_SHUTDOWN)
+    subtle::Barrier_AtomicIncrement(&blocking_shutdown_thread_count_, 1);
+  subtle::Barrier_AtomicIncrement(&running_task_count_, 1);
+  subtle::Barrier_AtomicIncrement(&pending_task_count_, -1);
+  if (task.shutdown_behavior == BLOCK_SHUTDOWN)
+    subtle::Barrier_AtomicIncrement(&blocking_shutdown_pending_task_count_, -1);
+
+  // There may be more work available, so wake up another worker thread, or
+  // start one if they are all busy. This has to happen before running the
+  // task, which could take arbitrarily long.
+  if (subtle::NoBarrier_Load(&pending_task_count_) > 0)
+    WakeUpWorker();
+
+  if (IsShutdownCalled() && task.shutdown_behavior != BLOCK_SHUTDOWN) {
+    // We're shutting down and this task isn't blocking shutdown, so delete it
+    // instead of running it. This worker owns the task's sequence, so no
+    // earlier task of the sequence can still be running.
+    task.task.Reset();
+  } else {
+    TRACE_EVENT_FLOW_END0(TRACE_DISABLED_BY_DEFAULT("toplevel.flow"),
+        "SequencedWorkerPool::PostTask",
+        TRACE_ID_MANGLE(GetTaskTraceID(task, static_cast<void*>(this))));
+    TRACE_EVENT2("toplevel", "SequencedWorkerPool::ThreadLoop",
+                 "src_file", task.posted_from.file_name(),
+                 "src_func", task.posted_from.function_name());
+
+    worker->set_running_task_info(
+        SequenceToken(task.sequence_token_id), task.shutdown_behavior);
+
+    tracked_objects::ThreadData::PrepareForStartOfRun(task.birth_tally);
+    tracked_objects::TaskStopwatch stopwatch;
+    stopwatch.Start();
+    task.task.Run();
+    stopwatch.Stop();
+
+    tracked_objects::ThreadData::TallyRunOnNamedThreadIfTracking(
+        task, stopwatch);
+
+    // Destroy the closure before calling set_running_task_info() so that
+    // sequence-checking from within the task's destructor still works.
+    task.task = Closure();
+
+    worker->set_running_task_info(SequenceToken(), CONTINUE_ON_SHUTDOWN);
+  }
+
+  if (shard) {
+    bool sequence_has_more_tasks;
+    {
+      AutoLock lock(shard->lock);
+      std::map<int, std::queue<SequencedTask> >::iterator it =
+          shard->sequences.find(item->sequence_token_id);
+      DCHECK(it != shard->sequences.end());
+      it->second.pop();
+      sequence_has_more_tasks = !it->second.empty();
+      if (!sequence_has_more_tasks)
+        shard->sequences.erase(it);
+    }
+    // The sequence stays claimed. Put it at the back of our own queue so that
+    // other work gets a turn first; idle workers may steal it from there.
+    if (sequence_has_more_tasks)
+      PushWorkItem(*item, queue_index);
+  }
+
+  subtle::Barrier_AtomicIncrement(&running_task_count_, -1);
+  if (task.shutdown_behavior != CONTINUE_ON_SHUTDOWN)
+    subtle::Barrier_AtomicIncrement(&blocking_shutdown_thread_count_, -1);
+  SignalCanShutdown();
+}
+
+void SequencedWorkerPool::WorkStealingInner::PromoteDueDelayedTasks(
+    size_t queue_index) {
+  if (!subtle::NoBarrier_Load(&delayed_task_count_))
+    return;
+
+  // Delayed tasks are SKIP_ON_SHUTDOWN, so once shutdown has started they are
+  // all deleted. Closures are only destroyed outside the lock.
+  DelayedTaskSet due_tasks;
+  {
+    AutoLock lock(delayed_tasks_lock_);
+    if (IsShutdownCalled()) {
+      due_tasks.swap(delayed_tasks_);
+    } else {
+      DelayedTaskSet::iterator end = delayed_tasks_.begin();
+      const TimeTicks current_time = TimeTicks::Now();
+      while (end != delayed_tasks_.end() && end->time_to_run <= current_time)
+        ++end;
+      due_tasks.insert(delayed_tasks_.begin(), end);
+      delayed_tasks_.erase(delayed_tasks_.begin(), end);
+    }
+    subtle::NoBarrier_Store(&delayed_task_count_,
+                            static_cast<subtle::Atomic32>(
+                                delayed_tasks_.size()));
+  }
+
+  if (IsShutdownCalled())
+    return;
+  for (DelayedTaskSet::const_iterator it = due_tasks.begin();
+       it != due_tasks.end(); ++it) {
+    subtle::Barrier_AtomicIncrement(&pending_task_count_, 1);
+    EnqueueTask(*it, queue_index);
+  }
+}
+
+TimeTicks SequencedWorkerPool::WorkStealingInner::NextDelayedRunTime() {
+  AutoLock lock(delayed_tasks_lock_);
+  if (delayed_tasks_.empty())
+    return TimeTicks();
+  return delayed_tasks_.begin()->time_to_run;
+}
+
+void SequencedWorkerPool::WorkStealingInner::WaitForWork() {
+  AutoLock lock(idle_lock_);
+  // Announce that we're idle before checking for work one last time. Posters
+  // publish work before looking at |idle_thread_count_|, so either we see
+  // their work or they see us and signal |has_work_cv_|, which they can only
+  // do once we're waiting since they need |idle_lock_|.
+  subtle::Barrier_AtomicIncrement(&idle_thread_count_, 1);
+  if (!HasQueuedWork() && !ShouldWorkerExit()) {
+    flush_cv_.Broadcast();
+    TimeTicks next_delayed_run_time = NextDelayedRunTime();
+    if (next_delayed_run_time.is_null()) {
+      has_work_cv_.Wait();
+    } else {
+      TimeDelta wait_time = next_delayed_run_time - TimeTicks::Now();
+      if (wait_time > TimeDelta())
+        has_work_cv_.TimedWait(wait_time);
+    }
+  }
+  subtle::Barrier_AtomicIncrement(&idle_thread_count_, -1);
+}
+
+void SequencedWorkerPool::WorkStealingInner::WakeUpWorker() {
+  // Order the publication of the work before the load below.
+  subtle::MemoryBarrier();
+  if (subtle::NoBarrier_Load(&idle_thread_count_) > 0)
+    SignalHasWork();
+  else
+    StartAdditionalThreadIfHelpful();
+}
+
+void SequencedWorkerPool::WorkStealingInner::SignalHasWork() {
+  {
+    AutoLock lock(idle_lock_);
+    has_work_cv_.Signal();
+  }
+  if (testing_observer_) {
+    testing_observer_->OnHasWork();
+  }
+}
+
+void SequencedWorkerPool::WorkStealingInner::StartAdditionalThreadIfHelpful() {
+  if (IsShutdownCalled() ||
+      static_cast<size_t>(subtle::NoBarrier_Load(&started_thread_count_)) >=
+          max_threads_) {
+    return;
+  }
+
+  // Only one thread is started at a time, see
+  // GlobalQueueInner::PrepareToStartAdditionalThreadIfHelpful. The flag is
+  // set before checking |shutdown_called_| again so that Shutdown() cannot
+  // miss a thread that is about to start.
+  if (subtle::Acquire_CompareAndSwap(&thread_being_created_, 0, 1) != 0)
+    return;
+  subtle::MemoryBarrier();
+  subtle::Atomic32 thread_count =
+      subtle::NoBarrier_Load(&started_thread_count_);
+  if (IsShutdownCalled() || static_cast<size_t>(thread_count) >= max_threads_) {
+    subtle::Barrier_AtomicIncrement(&thread_being_created_, -1);
+    SignalCanShutdown();
+    return;
+  }
+  subtle::NoBarrier_Store(&started_thread_count_, thread_count + 1);
+
+  // The worker is assigned to the list when the thread actually starts, which
+  // will manage the memory of the pointer.
+  new Worker(worker_pool_, thread_count + 1, thread_name_prefix_);
+}
+
+bool SequencedWorkerPool::WorkStealingInner::IsShutdownCalled() const {
+  return subtle::Acquire_Load(&shutdown_called_) != 0;
+}
+
+bool SequencedWorkerPool::WorkStealingInner::ShouldWorkerExit() const {
+  return IsShutdownCalled() &&
+         subtle::Acquire_Load(&blocking_shutdown_pending_task_count_) == 0;
+}
+
+bool SequencedWorkerPool::WorkStealingInner::CanShutdown() const {
+  return subtle::Acquire_Load(&thread_being_created_) == 0 &&
+         subtle::Acquire_Load(&blocking_shutdown_thread_count_) == 0 &&
+         subtle::Acquire_Load(&blocking_shutdown_pending_task_count_) == 0;
+}
+
+void SequencedWorkerPool::WorkStealingInner::SignalCanShutdown() {
+  if (!IsShutdownCalled())
+    return;
+  AutoLock lock(shutdown_lock_);
+  can_shutdown_cv_.Broadcast();
+}
 
 // SequencedWorkerPool --------------------------------------------------------
 
@@ -1133,15 +2031,30 @@ SequencedWorkerPool::SequencedWorkerPool(
     size_t max_threads,
     const std::string& thread_name_prefix)
     : constructor_message_loop_(MessageLoopProxy::current()),
-      inner_(new Inner(this, max_threads, thread_name_prefix, NULL)) {
+      inner_(new GlobalQueueInner(this, max_threads, thread_name_prefix,
+                                  NULL)) {
+}
+
+SequencedWorkerPool::SequencedWorkerPool(
+    size_t max_threads,
+    const std::string& thread_name_prefix,
+    TestingObserver* observer)
+    : constructor_message_loop_(MessageLoopProxy::current()),
+      inner_(new GlobalQueueInner(this, max_threads, thread_name_prefix,
+                                  observer)) {
 }
 
 SequencedWorkerPool::SequencedWorkerPool(
     size_t max_threads,
     const std::string& thread_name_prefix,
+    SchedulingBackend backend,
     TestingObserver* observer)
     : constructor_message_loop_(MessageLoopProxy::current()),
-      inner_(new Inner(this, max_threads, thread_name_prefix, observer)) {
+      inner_(backend == WORK_STEALING_BACKEND ?
+          static_cast<Inner*>(new WorkStealingInner(
+              this, max_threads, thread_name_prefix, observer)) :
+          new GlobalQueueInner(this, max_threads, thread_name_prefix,
+                               observer)) {
 }
 
 SequencedWorkerPool::~SequencedWorkerPool() {}
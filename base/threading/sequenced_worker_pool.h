@@ -118,6 +118,20 @@ class BASE_EXPORT SequencedWorkerPool : public TaskRunner {
     BLOCK_SHUTDOWN,
   };
 
+  // Selects how pending tasks are handed out to the worker threads. Both
+  // backends implement the same sequencing and shutdown semantics.
+  enum SchedulingBackend {
+    // All pending tasks live in one time-ordered set guarded by a single lock.
+    GLOBAL_QUEUE_BACKEND,
+
+    // Every worker owns a queue of runnable work and steals from the queues of
+    // the other workers when its own is empty. Tasks of a sequence are kept in
+    // a per-sequence queue that is claimed by one worker at a time. There is
+    // no pool-wide lock on the posting and running paths, which helps when
+    // many threads post and run short tasks.
+    WORK_STEALING_BACKEND,
+  };
+
   // Opaque identifier that defines sequencing of tasks posted to the worker
   // pool.
   class SequenceToken {
@@ -171,6 +185,13 @@ class BASE_EXPORT SequencedWorkerPool : public TaskRunner {
                       const std::string& thread_name_prefix,
                       TestingObserver* observer);
 
+  // Like above, but with an explicit scheduling |backend|. The other
+  // constructors use GLOBAL_QUEUE_BACKEND. |observer| may be NULL.
+  SequencedWorkerPool(size_t max_threads,
+                      const std::string& thread_name_prefix,
+                      SchedulingBackend backend,
+                      TestingObserver* observer);
+
   // Returns a unique token that can be used to sequence tasks posted to
   // PostSequencedWorkerTask(). Valid tokens are always nonzero.
   SequenceToken GetSequenceToken();
@@ -345,6 +366,8 @@ class BASE_EXPORT SequencedWorkerPool : public TaskRunner {
   friend class DeleteHelper<SequencedWorkerPool>;
 
   class Inner;
+  class GlobalQueueInner;
+  class WorkStealingInner;
   class Worker;
 
   const scoped_refptr<MessageLoopProxy> constructor_message_loop_;
@@ -0,0 +1,154 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/atomicops.h"
+#include "base/base_switches.h"
+#include "base/bind.h"
+#include "base/command_line.h"
+#include "base/memory/ref_counted.h"
+#include "base/memory/scoped_vector.h"
+#include "base/message_loop/message_loop.h"
+#include "base/strings/stringprintf.h"
+#include "base/synchronization/waitable_event.h"
+#include "base/threading/sequenced_worker_pool.h"
+#include "base/threading/thread.h"
+#include "base/time/time.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_test.h"
+
+namespace base {
+
+namespace {
+
+const int kTasksPerPostingThread = 20000;
+const int kNumSequences = 16;
+
+// Compares the throughput of the SequencedWorkerPool scheduling backends.
+// Tasks are trivial so that the cost of scheduling dominates.
+class SequencedWorkerPoolPerfTest : public testing::Test {
+ public:
+  SequencedWorkerPoolPerfTest()
+      : all_tasks_done_(false, false),
+        remaining_tasks_(0) {
+    // Disable the task profiler as it adds significant cost!
+    CommandLine::Init(0, NULL);
+    CommandLine::ForCurrentProcess()->AppendSwitchASCII(
+        switches::kProfilerTiming,
+        switches::kProfilerTimingDisabledValue);
+  }
+
+  // Posts |kTasksPerPostingThread| tasks from each of |num_posting_threads|
+  // threads to a pool of |num_workers| threads. If |sequenced| is true, the
+  // tasks are spread over |kNumSequences| sequences.
+  void Run(SequencedWorkerPool::SchedulingBackend backend,
+           size_t num_workers,
+           int num_posting_threads,
+           bool sequenced) {
+    MessageLoop message_loop;
+    scoped_refptr<SequencedWorkerPool> pool(new SequencedWorkerPool(
+        num_workers, "PerfTestWorker", backend, NULL));
+    std::vector<SequencedWorkerPool::SequenceToken> tokens;
+    for (int i = 0; sequenced && i < kNumSequences; ++i)
+      tokens.push_back(pool->GetSequenceToken());
+
+    subtle::NoBarrier_Store(&remaining_tasks_,
+                            num_posting_threads * kTasksPerPostingThread);
+    WaitableEvent start_posting(true, false);
+    ScopedVector<Thread> posting_threads;
+    for (int i = 0; i < num_posting_threads; ++i) {
+      posting_threads.push_back(new Thread("PerfTestPoster"));
+      posting_threads.back()->Start();
+      posting_threads.back()->message_loop()->PostTask(
+          FROM_HERE,
+          base::Bind(&SequencedWorkerPoolPerfTest::PostTasks,
+                     base::Unretained(this), pool, tokens, &start_posting));
+    }
+
+    TimeTicks start = TimeTicks::HighResNow();
+    start_posting.Signal();
+    all_tasks_done_.Wait();
+    TimeDelta elapsed = TimeTicks::HighResNow() - start;
+
+    posting_threads.clear();
+    pool->Shutdown();
+
+    std::string trace = StringPrintf(
+        "%s_%dworkers_%dposters%s",
+        backend == SequencedWorkerPool::WORK_STEALING_BACKEND ?
+            "work_stealing" : "global_queue",
+        static_cast<int>(num_workers),
+        num_posting_threads,
+        sequenced ? "_sequenced" : "");
+    perf_test::PrintResult(
+        "task",
+        "",
+        trace,
+        num_posting_threads * kTasksPerPostingThread / elapsed.InSecondsF(),
+        "tasks/s",
+        true);
+  }
+
+ private:
+  void PostTasks(scoped_refptr<SequencedWorkerPool> pool,
+                 const std::vector<SequencedWorkerPool::SequenceToken>& tokens,
+                 WaitableEvent* start_posting) {
+    start_posting->Wait();
+    Closure task =
+        base::Bind(&SequencedWorkerPoolPerfTest::RunTask,
+                   base::Unretained(this));
+    for (int i = 0; i < kTasksPerPostingThread; ++i) {
+      if (tokens.empty()) {
+        pool->PostWorkerTask(FROM_HERE, task);
+      } else {
+        pool->PostSequencedWorkerTask(tokens[i % tokens.size()], FROM_HERE,
+                                      task);
+      }
+    }
+  }
+
+  void RunTask() {
+    if (subtle::Barrier_AtomicIncrement(&remaining_tasks_, -1) == 0)
+      all_tasks_done_.Signal();
+  }
+
+  WaitableEvent all_tasks_done_;
+  subtle::Atomic32 remaining_tasks_;
+};
+
+TEST_F(SequencedWorkerPoolPerfTest, GlobalQueue_4Workers_1Poster) {
+  Run(SequencedWorkerPool::GLOBAL_QUEUE_BACKEND, 4, 1, false);
+}
+
+TEST_F(SequencedWorkerPoolPerfTest, WorkStealing_4Workers_1Poster) {
+  Run(SequencedWorkerPool::WORK_STEALING_BACKEND, 4, 1, false);
+}
+
+TEST_F(SequencedWorkerPoolPerfTest, GlobalQueue_16Workers_8Posters) {
+  Run(SequencedWorkerPool::GLOBAL_QUEUE_BACKEND, 16, 8, false);
+}
+
+TEST_F(SequencedWorkerPoolPerfTest, WorkStealing_16Workers_8Posters) {
+  Run(SequencedWorkerPool::WORK_STEALING_BACKEND, 16, 8, false);
+}
+
+TEST_F(SequencedWorkerPoolPerfTest, GlobalQueue_16Workers_8Posters_Sequenced) {
+  Run(SequencedWorkerPool::GLOBAL_QUEUE_BACKEND, 16, 8, true);
+}
+
+TEST_F(SequencedWorkerPoolPerfTest,
+       WorkStealing_16Workers_8Posters_Sequenced) {
+  Run(SequencedWorkerPool::WORK_STEALING_BACKEND, 16, 8, true);
+}
+
+TEST_F(SequencedWorkerPoolPerfTest, GlobalQueue_32Workers_16Posters) {
+  Run(SequencedWorkerPool::GLOBAL_QUEUE_BACKEND, 32, 16, false);
+}
+
+TEST_F(SequencedWorkerPoolPerfTest, WorkStealing_32Workers_16Posters) {
+  Run(SequencedWorkerPool::WORK_STEALING_BACKEND, 32, 16, false);
+}
+
+}  // namespace
+
+}  // namespace base
@@ -176,10 +176,12 @@ class TestTracker : public base::RefCountedThreadSafe<TestTracker> {
   size_t started_events_;
 };
 
-class SequencedWorkerPoolTest : public testing::Test {
+// Runs each test against a pool using the scheduling backend it is
+// instantiated with.
+class SequencedWorkerPoolTest
+    : public testing::TestWithParam<SequencedWorkerPool::SchedulingBackend> {
  public:
-  SequencedWorkerPoolTest()
-      : tracker_(new TestTracker) {
+  SequencedWorkerPoolTest() : tracker_(new TestTracker) {
     ResetPool();
   }
 
@@ -193,7 +195,8 @@ class SequencedWorkerPoolTest : public testing::Test {
   // Destroys the SequencedWorkerPool instance, blocking until it is fully shut
   // down, and creates a new instance.
   void ResetPool() {
-    pool_owner_.reset(new SequencedWorkerPoolOwner(kNumWorkerThreads, "test"));
+    pool_owner_.reset(
+        new SequencedWorkerPoolOwner(kNumWorkerThreads, "test", GetParam()));
   }
 
   void SetWillWaitForShutdownCallback(const Closure& callback) {
@@ -279,7 +282,7 @@ void HoldPoolReference(const scoped_refptr<base::SequencedWorkerPool>& pool,
 }
 
 // Tests that delayed tasks are deleted upon shutdown of the pool.
-TEST_F(SequencedWorkerPoolTest, DelayedTaskDuringShutdown) {
+TEST_P(SequencedWorkerPoolTest, DelayedTaskDuringShutdown) {
   // Post something to verify the pool is started up.
   EXPECT_TRUE(pool()->PostTask(
       FROM_HERE, base::Bind(&TestTracker::FastTask, tracker(), 1)));
@@ -314,7 +317,7 @@ TEST_F(SequencedWorkerPoolTest, DelayedTaskDuringShutdown) {
 }
 
 // Tests that same-named tokens have the same ID.
-TEST_F(SequencedWorkerPoolTest, NamedTokens) {
+TEST_P(SequencedWorkerPoolTest, NamedTokens) {
   const std::string name1("hello");
   SequencedWorkerPool::SequenceToken token1 =
       pool()->GetNamedSequenceToken(name1);
@@ -342,7 +345,7 @@ TEST_F(SequencedWorkerPoolTest, NamedTokens) {
 
 // Tests that posting a bunch of tasks (many more than the number of worker
 // threads) runs them all.
-TEST_F(SequencedWorkerPoolTest, LotsOfTasks) {
+TEST_P(SequencedWorkerPoolTest, LotsOfTasks) {
   pool()->PostWorkerTask(FROM_HERE,
                          base::Bind(&TestTracker::SlowTask, tracker(), 0));
 
@@ -360,9 +363,9 @@ TEST_F(SequencedWorkerPoolTest, LotsOfTasks) {
 // worker threads) to two pools simultaneously runs them all twice.
 // This test is meant to shake out any concurrency issues between
 // pools (like histograms).
-TEST_F(SequencedWorkerPoolTest, LotsOfTasksTwoPools) {
-  SequencedWorkerPoolOwner pool1(kNumWorkerThreads, "test1");
-  SequencedWorkerPoolOwner pool2(kNumWorkerThreads, "test2");
+TEST_P(SequencedWorkerPoolTest, LotsOfTasksTwoPools) {
+  SequencedWorkerPoolOwner pool1(kNumWorkerThreads, "test1", GetParam());
+  SequencedWorkerPoolOwner pool2(kNumWorkerThreads, "test2", GetParam());
 
   base::Closure slow_task = base::Bind(&TestTracker::SlowTask, tracker(), 0);
   pool1.pool()->PostWorkerTask(FROM_HERE, slow_task);
@@ -386,7 +389,7 @@ TEST_F(SequencedWorkerPoolTest, LotsOfTasksTwoPools) {
 
 // Test that tasks with the same sequence token are executed in order but don't
 // affect other tasks.
-TEST_F(SequencedWorkerPoolTest, Sequence) {
+TEST_P(SequencedWorkerPoolTest, Sequence) {
   // Fill all the worker threads except one.
   const size_t kNumBackgroundTasks = kNumWorkerThreads - 1;
   ThreadBlocker background_blocker;
@@ -409,6 +412,9 @@ TEST_F(SequencedWorkerPoolTest, Sequence) {
   pool()->PostSequencedWorkerTask(
       token1, FROM_HERE,
       base::Bind(&TestTracker::FastTask, tracker(), 101));
+  // Only the global queue backend runs sequences in posting order, so wait for
+  // the first task to block before posting to another sequence.
+  tracker()->WaitUntilTasksBlocked(kNumBackgroundTasks + 1);
   EXPECT_EQ(0u, tracker()->WaitUntilTasksComplete(0).size());
 
   // Create another two tasks as above with a different token. These will be
@@ -447,7 +453,7 @@ TEST_F(SequencedWorkerPoolTest, Sequence) {
 
 // Tests that any tasks posted after Shutdown are ignored.
 // Disabled for flakiness.  See http://crbug.com/166451.
-TEST_F(SequencedWorkerPoolTest, DISABLED_IgnoresAfterShutdown) {
+TEST_P(SequencedWorkerPoolTest, DISABLED_IgnoresAfterShutdown) {
   // Start tasks to take all the threads and block them.
   EnsureAllWorkersCreated();
   ThreadBlocker blocker;
@@ -496,7 +502,7 @@ TEST_F(SequencedWorkerPoolTest, DISABLED_IgnoresAfterShutdown) {
   ASSERT_EQ(old_has_work_call_count, has_work_call_count());
 }
 
-TEST_F(SequencedWorkerPoolTest, AllowsAfterShutdown) {
+TEST_P(SequencedWorkerPoolTest, AllowsAfterShutdown) {
   // Test that <n> new blocking tasks are allowed provided they're posted
   // by a running tasks.
   EnsureAllWorkersCreated();
@@ -543,7 +549,7 @@ TEST_F(SequencedWorkerPoolTest, AllowsAfterShutdown) {
 
 // Tests that unrun tasks are discarded properly according to their shutdown
 // mode.
-TEST_F(SequencedWorkerPoolTest, DiscardOnShutdown) {
+TEST_P(SequencedWorkerPoolTest, DiscardOnShutdown) {
   // Start tasks to take all the threads and block them.
   EnsureAllWorkersCreated();
   ThreadBlocker blocker;
@@ -589,7 +595,7 @@ TEST_F(SequencedWorkerPoolTest, DiscardOnShutdown) {
 }
 
 // Tests that CONTINUE_ON_SHUTDOWN tasks don't block shutdown.
-TEST_F(SequencedWorkerPoolTest, ContinueOnShutdown) {
+TEST_P(SequencedWorkerPoolTest, ContinueOnShutdown) {
   scoped_refptr<TaskRunner> runner(pool()->GetTaskRunnerWithShutdownBehavior(
       SequencedWorkerPool::CONTINUE_ON_SHUTDOWN));
   scoped_refptr<SequencedTaskRunner> sequenced_runner(
@@ -637,7 +643,7 @@ TEST_F(SequencedWorkerPoolTest, ContinueOnShutdown) {
 
 // Tests that SKIP_ON_SHUTDOWN tasks that have been started block Shutdown
 // until they stop, but tasks not yet started do not.
-TEST_F(SequencedWorkerPoolTest, SkipOnShutdown) {
+TEST_P(SequencedWorkerPoolTest, SkipOnShutdown) {
   // Start tasks to take all the threads and block them.
   EnsureAllWorkersCreated();
   ThreadBlocker blocker;
@@ -690,7 +696,7 @@ TEST_F(SequencedWorkerPoolTest, SkipOnShutdown) {
 // Ensure all worker threads are created, and then trigger a spurious
 // work signal. This shouldn't cause any other work signals to be
 // triggered. This is a regression test for http://crbug.com/117469.
-TEST_F(SequencedWorkerPoolTest, SpuriousWorkSignal) {
+TEST_P(SequencedWorkerPoolTest, SpuriousWorkSignal) {
   EnsureAllWorkersCreated();
   int old_has_work_call_count = has_work_call_count();
   pool()->SignalHasWorkForTesting();
@@ -715,13 +721,13 @@ void IsRunningOnCurrentThreadTask(
 }
 
 // Verify correctness of the IsRunningSequenceOnCurrentThread method.
-TEST_F(SequencedWorkerPoolTest, IsRunningOnCurrentThread) {
+TEST_P(SequencedWorkerPoolTest, IsRunningOnCurrentThread) {
   SequencedWorkerPool::SequenceToken token1 = pool()->GetSequenceToken();
   SequencedWorkerPool::SequenceToken token2 = pool()->GetSequenceToken();
   SequencedWorkerPool::SequenceToken unsequenced_token;
 
   scoped_refptr<SequencedWorkerPool> unused_pool =
-      new SequencedWorkerPool(2, "unused_pool");
+      new SequencedWorkerPool(2, "unused_pool", GetParam(), NULL);
 
   EXPECT_FALSE(pool()->RunsTasksOnCurrentThread());
   EXPECT_FALSE(pool()->IsRunningSequenceOnCurrentThread(token1));
@@ -750,7 +756,7 @@ TEST_F(SequencedWorkerPoolTest, IsRunningOnCurrentThread) {
 }
 
 // Verify that FlushForTesting works as intended.
-TEST_F(SequencedWorkerPoolTest, FlushForTesting) {
+TEST_P(SequencedWorkerPoolTest, FlushForTesting) {
   // Should be fine to call on a new instance.
   pool()->FlushForTesting();
 
@@ -790,6 +796,76 @@ TEST_F(SequencedWorkerPoolTest, FlushForTesting) {
   pool()->FlushForTesting();
 }
 
+void PostFastTasks(scoped_refptr<TestTracker> tracker,
+                   SequencedWorkerPool* pool,
+                   int first_id,
+                   int count) {
+  for (int i = 0; i < count; ++i) {
+    pool->PostWorkerTask(FROM_HERE,
+                         base::Bind(&TestTracker::FastTask, tracker,
+                                    first_id + i));
+  }
+}
+
+// Tests that tasks posted from workers all run. With the work-stealing backend
+// they land on the posting worker's queue, and may be run by that worker or
+// stolen by another.
+TEST_P(SequencedWorkerPoolTest, TasksPostedFromWorkers) {
+  const int kNumPostingTasks = 6;
+  const int kTasksPerPost = 20;
+  for (int i = 0; i < kNumPostingTasks; ++i) {
+    pool()->PostWorkerTask(
+        FROM_HERE,
+        base::Bind(&PostFastTasks, scoped_refptr<TestTracker>(tracker()),
+                   pool(), i * kTasksPerPost, kTasksPerPost));
+  }
+
+  std::vector<int> result =
+      tracker()->WaitUntilTasksComplete(kNumPostingTasks * kTasksPerPost);
+  EXPECT_EQ(static_cast<size_t>(kNumPostingTasks * kTasksPerPost),
+            result.size());
+}
+
+// Tests that a sequence keeps its order even if it migrates between workers,
+// and that a blocked sequence doesn't hold up other sequences.
+TEST_P(SequencedWorkerPoolTest, SequencesRunIndependently) {
+  ThreadBlocker blocker;
+  SequencedWorkerPool::SequenceToken token1 = pool()->GetSequenceToken();
+  pool()->PostSequencedWorkerTask(
+      token1, FROM_HERE,
+      base::Bind(&TestTracker::BlockTask, tracker(), 100, &blocker));
+  pool()->PostSequencedWorkerTask(
+      token1, FROM_HERE,
+      base::Bind(&TestTracker::FastTask, tracker(), 101));
+  tracker()->WaitUntilTasksBlocked(1);
+
+  const int kNumSequencedTasks = 50;
+  SequencedWorkerPool::SequenceToken token2 = pool()->GetSequenceToken();
+  for (int i = 0; i < kNumSequencedTasks; ++i) {
+    pool()->PostSequencedWorkerTask(
+        token2, FROM_HERE,
+        base::Bind(&TestTracker::FastTask, tracker(), 200 + i));
+  }
+
+  std::vector<int> result =
+      tracker()->WaitUntilTasksComplete(kNumSequencedTasks);
+  ASSERT_EQ(static_cast<size_t>(kNumSequencedTasks), result.size());
+  for (int i = 0; i < kNumSequencedTasks; ++i)
+    EXPECT_EQ(200 + i, result[i]);
+
+  blocker.Unblock(1);
+  result = tracker()->WaitUntilTasksComplete(kNumSequencedTasks + 2);
+  ASSERT_EQ(static_cast<size_t>(kNumSequencedTasks + 2), result.size());
+  EXPECT_EQ(100, result[kNumSequencedTasks]);
+  EXPECT_EQ(101, result[kNumSequencedTasks + 1]);
+}
+
+INSTANTIATE_TEST_CASE_P(
+    SequencedWorkerPoolBackends,
+    SequencedWorkerPoolTest,
+    ::testing::Values(SequencedWorkerPool::GLOBAL_QUEUE_BACKEND,
+                      SequencedWorkerPool::WORK_STEALING_BACKEND));
+
 TEST(SequencedWorkerPoolRefPtrTest, ShutsDownCleanWithContinueOnShutdown) {
   MessageLoop loop;
   scoped_refptr<SequencedWorkerPool> pool(new SequencedWorkerPool(3, "Pool"));
@@ -913,6 +989,73 @@ INSTANTIATE_TYPED_TEST_CASE_P(
     SequencedWorkerPoolSequencedTaskRunner, SequencedTaskRunnerTest,
     SequencedWorkerPoolSequencedTaskRunnerTestDelegate);
 
+class SequencedWorkerPoolWorkStealingTaskRunnerTestDelegate {
+ public:
+  SequencedWorkerPoolWorkStealingTaskRunnerTestDelegate() {}
+
+  ~SequencedWorkerPoolWorkStealingTaskRunnerTestDelegate() {}
+
+  void StartTaskRunner() {
+    pool_owner_.reset(new SequencedWorkerPoolOwner(
+        10, "SequencedWorkerPoolWorkStealingTaskRunnerTest",
+        SequencedWorkerPool::WORK_STEALING_BACKEND));
+  }
+
+  scoped_refptr<SequencedWorkerPool> GetTaskRunner() {
+    return pool_owner_->pool();
+  }
+
+  void StopTaskRunner() {
+    pool_owner_->pool()->FlushForTesting();
+    pool_owner_->pool()->Shutdown();
+  }
+
+ private:
+  MessageLoop message_loop_;
+  scoped_ptr<SequencedWorkerPoolOwner> pool_owner_;
+};
+
+INSTANTIATE_TYPED_TEST_CASE_P(
+    SequencedWorkerPoolWorkStealing, TaskRunnerTest,
+    SequencedWorkerPoolWorkStealingTaskRunnerTestDelegate);
+
+class SequencedWorkerPoolWorkStealingSequencedTaskRunnerTestDelegate {
+ public:
+  SequencedWorkerPoolWorkStealingSequencedTaskRunnerTestDelegate() {}
+
+  ~SequencedWorkerPoolWorkStealingSequencedTaskRunnerTestDelegate() {}
+
+  void StartTaskRunner() {
+    pool_owner_.reset(new SequencedWorkerPoolOwner(
+        10, "SequencedWorkerPoolWorkStealingSequencedTaskRunnerTest",
+        SequencedWorkerPool::WORK_STEALING_BACKEND));
+    task_runner_ = pool_owner_->pool()->GetSequencedTaskRunner(
+        pool_owner_->pool()->GetSequenceToken());
+  }
+
+  scoped_refptr<SequencedTaskRunner> GetTaskRunner() {
+    return task_runner_;
+  }
+
+  void StopTaskRunner() {
+    pool_owner_->pool()->FlushForTesting();
+    pool_owner_->pool()->Shutdown();
+  }
+
+ private:
+  MessageLoop message_loop_;
+  scoped_ptr<SequencedWorkerPoolOwner> pool_owner_;
+  scoped_refptr<SequencedTaskRunner> task_runner_;
+};
+
+INSTANTIATE_TYPED_TEST_CASE_P(
+    SequencedWorkerPoolWorkStealingSequencedTaskRunner, TaskRunnerTest,
+    SequencedWorkerPoolWorkStealingSequencedTaskRunnerTestDelegate);
+
+INSTANTIATE_TYPED_TEST_CASE_P(
+    SequencedWorkerPoolWorkStealingSequencedTaskRunner, SequencedTaskRunnerTest,
+    SequencedWorkerPoolWorkStealingSequencedTaskRunnerTestDelegate);
+
 }  // namespace
 
 }  // namespace base
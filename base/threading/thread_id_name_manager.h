@@ -10,7 +10,7 @@
 
 #include "base/base_export.h"
 #include "base/basictypes.h"
-#include "base/synchronization/lock.h"
+#include "base/synchronization/read_write_lock.h"
 #include "base/threading/platform_thread.h"
 
 template <typename T> struct DefaultSingletonTraits;
@@ -48,8 +48,9 @@ class BASE_EXPORT ThreadIdNameManager {
   ~ThreadIdNameManager();
 
   // lock_ protects the name_to_interned_name_, thread_id_to_handle_ and
-  // thread_handle_to_interned_name_ maps.
-  Lock lock_;
+  // thread_handle_to_interned_name_ maps. GetName() only reads them, and is
+  // called far more often than the rest, so it holds the lock for reading.
+  ReadWriteLock lock_;
 
   NameToInternedNameMap name_to_interned_name_;
   ThreadIdToHandleMap thread_id_to_handle_;
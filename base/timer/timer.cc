@@ -6,11 +6,20 @@
 
 #include <stddef.h>
 
+#include <algorithm>
+#include <map>
+
+#include "base/lazy_instance.h"
 #include "base/logging.h"
+#include "base/memory/linked_ptr.h"
 #include "base/memory/ref_counted.h"
+#include "base/memory/weak_ptr.h"
+#include "base/message_loop/message_loop.h"
 #include "base/single_thread_task_runner.h"
 #include "base/thread_task_runner_handle.h"
 #include "base/threading/platform_thread.h"
+#include "base/threading/thread_local.h"
+#include "base/timer/timer_wheel.h"
 
 namespace base {
 
@@ -59,6 +68,172 @@ class BaseTimerTaskInternal {
   Timer* timer_;
 };
 
+// BaseTimerWheelEntry is the place of a Timer with slack on its thread's timer
+// wheel.
+class BaseTimerWheelEntry : public TimerWheel::Entry {
+ public:
+  explicit BaseTimerWheelEntry(Timer* timer) : timer_(timer) {}
+
+  Timer* timer() const { return timer_; }
+
+ protected:
+  void OnExpired() override;
+
+ private:
+  Timer* const timer_;
+
+  DISALLOW_COPY_AND_ASSIGN(BaseTimerWheelEntry);
+};
+
+namespace {
+
+// TimerWheelHost runs the timer wheels of a thread's timers with slack. There
+// is a wheel for each amount of slack, with a granularity of that slack, and
+// a single delayed task posted for its next wakeup at a time.
+class TimerWheelHost : public MessageLoop::DestructionObserver {
+ public:
+  // Returns the host for the current thread, creating it if needed, or NULL if
+  // the thread has no MessageLoop.
+  static TimerWheelHost* GetForCurrentThread();
+
+  // Schedules |entry| to expire at |run_time|, up to |slack| late.
+  void Schedule(BaseTimerWheelEntry* entry,
+                TimeDelta slack,
+                TimeTicks run_time);
+
+  // Called before the task of a timer that has expired runs. The task may run
+  // a nested loop, so the wheel being advanced needs its next wakeup posted
+  // already.
+  void WillRunTimer();
+
+  // MessageLoop::DestructionObserver:
+  void WillDestroyCurrentMessageLoop() override;
+
+ private:
+  struct Wheel {
+    Wheel(TimeDelta slack, TimeTicks origin) : wheel(slack, origin) {}
+
+    TimerWheel wheel;
+
+    // The earliest wakeup task posted for |wheel| that hasn't run yet.
+    TimeTicks posted_wakeup;
+  };
+
+  explicit TimerWheelHost(scoped_refptr<SingleThreadTaskRunner> task_runner);
+  ~TimerWheelHost() override;
+
+  // Posts a task for the next wakeup of |wheel|, unless one is already posted
+  // for that time or earlier.
+  void PostWakeupIfNeeded(Wheel* wheel);
+
+  // Runs the timers of |wheel| that are due. |wakeup| is the time the task was
+  // posted for.
+  void OnWakeup(Wheel* wheel, TimeTicks wakeup);
+
+  scoped_refptr<SingleThreadTaskRunner> task_runner_;
+
+  // The wheels by their slack in microseconds.
+  std::map<int64, linked_ptr<Wheel> > wheels_;
+
+  // The wheel OnWakeup() is advancing, if any.
+  Wheel* advancing_wheel_;
+
+  WeakPtrFactory<TimerWheelHost> weak_factory_;
+
+  DISALLOW_COPY_AND_ASSIGN(TimerWheelHost);
+};
+
+LazyInstance<ThreadLocalPointer<TimerWheelHost> >::Leaky lazy_tls_host =
+    LAZY_INSTANCE_INITIALIZER;
+
+// static
+TimerWheelHost* TimerWheelHost::GetForCurrentThread() {
+  TimerWheelHost* host = lazy_tls_host.Pointer()->Get();
+  if (host)
+    return host;
+  MessageLoop* loop = MessageLoop::current();
+  if (!loop)
+    return NULL;
+  host = new TimerWheelHost(loop->task_runner());
+  loop->AddDestructionObserver(host);
+  lazy_tls_host.Pointer()->Set(host);
+  return host;
+}
+
+TimerWheelHost::TimerWheelHost(
+    scoped_refptr<SingleThreadTaskRunner> task_runner)
+    : task_runner_(task_runner),
+      advancing_wheel_(NULL),
+      weak_factory_(this) {
+}
+
+TimerWheelHost::~TimerWheelHost() {
+}
+
+void TimerWheelHost::Schedule(BaseTimerWheelEntry* entry,
+                              TimeDelta slack,
+                              TimeTicks run_time) {
+  linked_ptr<Wheel>& wheel = wheels_[slack.InMicroseconds()];
+  if (!wheel.get())
+    wheel.reset(new Wheel(slack, TimeTicks::Now()));
+  wheel->wheel.Schedule(entry, run_time);
+  PostWakeupIfNeeded(wheel.get());
+}
+
+void TimerWheelHost::WillRunTimer() {
+  if (advancing_wheel_)
+    PostWakeupIfNeeded(advancing_wheel_);
+}
+
+void TimerWheelHost::WillDestroyCurrentMessageLoop() {
+  // As with the tasks of other timers, which get deleted with the MessageLoop,
+  // the timers stop.
+  for (std::map<int64, linked_ptr<Wheel> >::iterator it = wheels_.begin();
+       it != wheels_.end(); ++it) {
+    std::vector<TimerWheel::Entry*> entries;
+    it->second->wheel.CancelAll(&entries);
+    for (size_t i = 0; i < entries.size(); ++i)
+      static_cast<BaseTimerWheelEntry*>(entries[i])->timer()->Stop();
+  }
+  lazy_tls_host.Pointer()->Set(NULL);
+  delete this;
+}
+
+void TimerWheelHost::PostWakeupIfNeeded(Wheel* wheel) {
+  TimeTicks wakeup = wheel->wheel.NextWakeup();
+  if (wakeup.is_null())
+    return;
+  if (!wheel->posted_wakeup.is_null() && wheel->posted_wakeup <= wakeup)
+    return;
+  wheel->posted_wakeup = wakeup;
+  task_runner_->PostDelayedTask(
+      FROM_HERE,
+      Bind(&TimerWheelHost::OnWakeup, weak_factory_.GetWeakPtr(), wheel,
+           wakeup),
+      std::max(TimeDelta(), wakeup - TimeTicks::Now()));
+}
+
+void TimerWheelHost::OnWakeup(Wheel* wheel, TimeTicks wakeup) {
+  // A task posted for a later wakeup may still be pending, and will find
+  // nothing to do, or less.
+  if (wakeup == wheel->posted_wakeup)
+    wheel->posted_wakeup = TimeTicks();
+  // A nested loop run by a timer's task may wake up another wheel, or this
+  // one again, in which case Advance() is reentered.
+  Wheel* outer_wheel = advancing_wheel_;
+  advancing_wheel_ = wheel;
+  wheel->wheel.Advance(TimeTicks::Now());
+  advancing_wheel_ = outer_wheel;
+  PostWakeupIfNeeded(wheel);
+}
+
+}  // namespace
+
+void BaseTimerWheelEntry::OnExpired() {
+  TimerWheelHost::GetForCurrentThread()->WillRunTimer();
+  timer_->RunScheduledTask();
+}
+
 Timer::Timer(bool retain_user_task, bool is_repeating)
     : scheduled_task_(NULL),
       thread_id_(0),
@@ -99,6 +274,14 @@ void Timer::SetTaskRunner(scoped_refptr<SingleThreadTaskRunner> task_runner) {
   task_runner_.swap(task_runner);
 }
 
+void Timer::SetSlack(TimeDelta slack) {
+  DCHECK(!is_running_);
+  // Abandon a task left behind by Stop(), since the timer may now be
+  // scheduled on a timer wheel instead.
+  AbandonScheduledTask();
+  slack_ = slack;
+}
+
 void Timer::Start(const tracked_objects::Location& posted_from,
                   TimeDelta delay,
                   const base::Closure& user_task) {
@@ -108,6 +291,8 @@ void Timer::Start(const tracked_objects::Location& posted_from,
 
 void Timer::Stop() {
   is_running_ = false;
+  if (wheel_entry_)
+    wheel_entry_->Cancel();
   if (!retain_user_task_)
     user_task_.Reset();
 }
@@ -115,6 +300,10 @@ void Timer::Stop() {
 void Timer::Reset() {
   DCHECK(!user_task_.is_null());
 
+  // Moving a timer on a timer wheel is cheap, so it never needs a new task.
+  if (ScheduleOnTimerWheel(delay_))
+    return;
+
   // If there's no pending task, start one up and return.
   if (!scheduled_task_) {
     PostNewScheduledTask(delay_);
@@ -167,6 +356,30 @@ void Timer::PostNewScheduledTask(TimeDelta delay) {
     thread_id_ = static_cast<int>(PlatformThread::CurrentId());
 }
 
+bool Timer::ScheduleOnTimerWheel(TimeDelta delay) {
+  if (slack_ <= TimeDelta() || task_runner_.get())
+    return false;
+  TimerWheelHost* host = TimerWheelHost::GetForCurrentThread();
+  if (!host)
+    return false;
+
+  AbandonScheduledTask();
+  if (!wheel_entry_)
+    wheel_entry_.reset(new BaseTimerWheelEntry(this));
+  is_running_ = true;
+  TimeTicks now = TimeTicks::Now();
+  if (delay > TimeDelta::FromMicroseconds(0))
+    scheduled_run_time_ = desired_run_time_ = now + delay;
+  else
+    scheduled_run_time_ = desired_run_time_ = TimeTicks();
+  host->Schedule(wheel_entry_.get(), slack_, now + delay);
+
+  if (!thread_id_)
+    thread_id_ = static_cast<int>(PlatformThread::CurrentId());
+  DCHECK_EQ(thread_id_, static_cast<int>(PlatformThread::CurrentId()));
+  return true;
+}
+
 scoped_refptr<SingleThreadTaskRunner> Timer::GetTaskRunner() {
   return task_runner_.get() ? task_runner_ : ThreadTaskRunnerHandle::Get();
 }
@@ -203,10 +416,12 @@ void Timer::RunScheduledTask() {
   // user_task_ member if retain_user_task_ is false.
   base::Closure task = user_task_;
 
-  if (is_repeating_)
-    PostNewScheduledTask(delay_);
-  else
+  if (is_repeating_) {
+    if (!ScheduleOnTimerWheel(delay_))
+      PostNewScheduledTask(delay_);
+  } else {
     Stop();
+  }
 
   task.Run();
 
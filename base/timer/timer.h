@@ -55,11 +55,13 @@
 #include "base/bind_helpers.h"
 #include "base/callback.h"
 #include "base/location.h"
+#include "base/memory/scoped_ptr.h"
 #include "base/time/time.h"
 
 namespace base {
 
 class BaseTimerTaskInternal;
+class BaseTimerWheelEntry;
 class SingleThreadTaskRunner;
 
 //-----------------------------------------------------------------------------
@@ -92,6 +94,16 @@ class BASE_EXPORT Timer {
   // only be called before any tasks have been scheduled.
   virtual void SetTaskRunner(scoped_refptr<SingleThreadTaskRunner> task_runner);
 
+  // Lets the timer run up to |slack| late, so that it can be run together with
+  // other timers on this thread that allow the same slack. Such timers are kept
+  // on a TimerWheel shared by the thread, where Start, Reset and Stop are O(1)
+  // and never post a task; the wheel keeps a single task posted for the next
+  // timer that is due. This suits timeouts that are reset often and seldom
+  // fire. It has no effect on timers with a task runner set by SetTaskRunner,
+  // or on threads without a MessageLoop. It can only be called while the timer
+  // is not running.
+  void SetSlack(TimeDelta slack);
+
   // Start the timer to run at the given |delay| from now. If the timer is
   // already running, it will be replaced to call the given |user_task|.
   virtual void Start(const tracked_objects::Location& posted_from,
@@ -127,6 +139,7 @@ class BASE_EXPORT Timer {
 
  private:
   friend class BaseTimerTaskInternal;
+  friend class BaseTimerWheelEntry;
 
   // Allocates a new scheduled_task_ and posts it on the current MessageLoop
   // with the given |delay|. scheduled_task_ must be NULL. scheduled_run_time_
@@ -142,7 +155,12 @@ class BASE_EXPORT Timer {
   // this object.
   void AbandonScheduledTask();
 
-  // Called by BaseTimerTaskInternal when the MessageLoop runs it.
+  // Schedules user_task_ to run after |delay| on the thread's timer wheel, if
+  // the timer has slack and can use one. Returns false if it can't.
+  bool ScheduleOnTimerWheel(TimeDelta delay);
+
+  // Called by BaseTimerTaskInternal when the MessageLoop runs it, and by
+  // BaseTimerWheelEntry when the timer wheel expires it.
   void RunScheduledTask();
 
   // Stop running task (if any) and abandon scheduled task (if any).
@@ -180,6 +198,12 @@ class BASE_EXPORT Timer {
   // if the task must be run immediately.
   TimeTicks desired_run_time_;
 
+  // How late the timer may run. See SetSlack().
+  TimeDelta slack_;
+
+  // The timer's place on the thread's timer wheel, if it has slack.
+  scoped_ptr<BaseTimerWheelEntry> wheel_entry_;
+
   // Thread ID of current MessageLoop for verifying single-threaded usage.
   int thread_id_;
 
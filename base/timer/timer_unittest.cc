@@ -4,6 +4,7 @@
 
 #include "base/memory/scoped_ptr.h"
 #include "base/message_loop/message_loop.h"
+#include "base/run_loop.h"
 #include "base/test/test_simple_task_runner.h"
 #include "base/timer/timer.h"
 #include "testing/gtest/include/gtest/gtest.h"
@@ -538,4 +539,125 @@ TEST(TimerTest, ContinuationReset) {
   }
 }
 
+void CountAndQuitAfterThree(int* count, base::Timer* timer) {
+  if (++*count == 3) {
+    timer->Stop();
+    base::MessageLoop::current()->QuitWhenIdle();
+  }
+}
+
+TEST(TimerTest, SlackOneShotTimer) {
+  ClearAllCallbackHappened();
+  base::MessageLoop loop;
+  base::Timer timer1(false, false);
+  base::Timer timer2(false, false);
+  timer1.SetSlack(TimeDelta::FromMilliseconds(5));
+  timer2.SetSlack(TimeDelta::FromMilliseconds(5));
+  base::TimeTicks start = base::TimeTicks::Now();
+  timer1.Start(FROM_HERE, TimeDelta::FromMilliseconds(10),
+               base::Bind(&SetCallbackHappened1));
+  timer2.Start(FROM_HERE, TimeDelta::FromMilliseconds(5),
+               base::Bind(&SetCallbackHappened2));
+  EXPECT_TRUE(timer2.IsRunning());
+  timer2.Stop();
+  EXPECT_FALSE(timer2.IsRunning());
+  base::MessageLoop::current()->Run();
+  EXPECT_TRUE(g_callback_happened1);
+  EXPECT_FALSE(g_callback_happened2);
+  EXPECT_FALSE(timer1.IsRunning());
+  EXPECT_GE(base::TimeTicks::Now() - start, TimeDelta::FromMilliseconds(10));
+}
+
+TEST(TimerTest, SlackTimerReset) {
+  ClearAllCallbackHappened();
+  base::MessageLoop loop;
+  base::Timer timer(true, false);
+  timer.SetSlack(TimeDelta::FromMilliseconds(5));
+  timer.Start(FROM_HERE, TimeDelta::FromMilliseconds(10),
+              base::Bind(&SetCallbackHappened1));
+  base::TimeTicks last_reset;
+  for (int i = 0; i < 100; ++i) {
+    last_reset = base::TimeTicks::Now();
+    timer.Reset();
+  }
+  base::MessageLoop::current()->Run();
+  EXPECT_TRUE(g_callback_happened1);
+  EXPECT_GE(base::TimeTicks::Now() - last_reset,
+            TimeDelta::FromMilliseconds(10));
+}
+
+TEST(TimerTest, SlackRepeatingTimer) {
+  base::MessageLoop loop;
+  base::Timer timer(true, true);
+  timer.SetSlack(TimeDelta::FromMilliseconds(5));
+  int count = 0;
+  timer.Start(FROM_HERE, TimeDelta::FromMilliseconds(5),
+              base::Bind(&CountAndQuitAfterThree, &count, &timer));
+  base::MessageLoop::current()->Run();
+  EXPECT_EQ(3, count);
+  EXPECT_FALSE(timer.IsRunning());
+}
+
+// The first call runs a nested loop until there have been three calls.
+void RunNestedLoopUntilThree(int* count, base::RunLoop** nested_loop) {
+  if (++*count == 1) {
+    base::MessageLoop::ScopedNestableTaskAllower allow(
+        base::MessageLoop::current());
+    base::RunLoop loop;
+    *nested_loop = &loop;
+    loop.Run();
+    *nested_loop = NULL;
+    base::MessageLoop::current()->QuitWhenIdle();
+  } else if (*count == 3) {
+    (*nested_loop)->Quit();
+  }
+}
+
+TEST(TimerTest, SlackTimerRunsNestedLoop) {
+  base::MessageLoop loop;
+  base::Timer timer1(false, false);
+  base::Timer timer2(false, false);
+  base::Timer timer3(false, false);
+  timer1.SetSlack(TimeDelta::FromMilliseconds(5));
+  timer2.SetSlack(TimeDelta::FromMilliseconds(5));
+  timer3.SetSlack(TimeDelta::FromMilliseconds(5));
+  int count = 0;
+  base::RunLoop* nested_loop = NULL;
+  // The first two timers most likely expire together. Whichever runs first
+  // waits in a nested loop for the other one, which is left to run in the
+  // same tick, and for the third, which is due in a later tick.
+  timer1.Start(FROM_HERE, TimeDelta::FromMilliseconds(10),
+               base::Bind(&RunNestedLoopUntilThree, &count, &nested_loop));
+  timer2.Start(FROM_HERE, TimeDelta::FromMilliseconds(10),
+               base::Bind(&RunNestedLoopUntilThree, &count, &nested_loop));
+  timer3.Start(FROM_HERE, TimeDelta::FromMilliseconds(30),
+               base::Bind(&RunNestedLoopUntilThree, &count, &nested_loop));
+  base::MessageLoop::current()->Run();
+  EXPECT_EQ(3, count);
+  EXPECT_FALSE(timer1.IsRunning());
+  EXPECT_FALSE(timer2.IsRunning());
+  EXPECT_FALSE(timer3.IsRunning());
+}
+
+TEST(TimerTest, SlackTimerMessageLoopDeath) {
+  base::Timer timer(false, false);
+  timer.SetSlack(TimeDelta::FromMilliseconds(5));
+  {
+    base::MessageLoop loop;
+    timer.Start(FROM_HERE, TimeDelta::FromDays(1),
+                base::Bind(&TimerTestCallback));
+    EXPECT_TRUE(timer.IsRunning());
+  }
+  EXPECT_FALSE(timer.IsRunning());
+  EXPECT_TRUE(timer.user_task().is_null());
+
+  // A new MessageLoop on the thread gets new timer wheels.
+  ClearAllCallbackHappened();
+  base::MessageLoop loop;
+  timer.Start(FROM_HERE, TimeDelta::FromMilliseconds(1),
+              base::Bind(&SetCallbackHappened1));
+  base::MessageLoop::current()->Run();
+  EXPECT_TRUE(g_callback_happened1);
+}
+
 }  // namespace
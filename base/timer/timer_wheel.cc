@@ -0,0 +1,273 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/timer/timer_wheel.h"
+
+#include <algorithm>
+
+#include "base/bits.h"
+#include "base/logging.h"
+
+namespace base {
+
+namespace {
+
+// Returns the index of the lowest set bit of |bits|, which must not be 0.
+int LowestSetBit(uint64 bits) {
+  DCHECK(bits);
+  uint32 low = static_cast<uint32>(bits);
+  if (low)
+    return bits::Log2Floor(low & (~low + 1));
+  uint32 high = static_cast<uint32>(bits >> 32);
+  return 32 + bits::Log2Floor(high & (~high + 1));
+}
+
+}  // namespace
+
+TimerWheel::Entry::Entry()
+    : wheel_(NULL),
+      previous_(NULL),
+      next_(NULL),
+      slot_(0),
+      tick_(0) {
+}
+
+TimerWheel::Entry::~Entry() {
+  Cancel();
+}
+
+void TimerWheel::Entry::Cancel() {
+  if (!wheel_)
+    return;
+  wheel_->Unlink(this);
+  wheel_->Release(this);
+}
+
+TimerWheel::TimerWheel(TimeDelta granularity, TimeTicks origin)
+    : granularity_(granularity),
+      origin_(origin),
+      current_tick_(0),
+      advance_limit_(-1),
+      expiring_(NULL),
+      size_(0) {
+  DCHECK_GT(granularity_.InMicroseconds(), 0);
+  std::fill(slots_, slots_ + kNumSlots, static_cast<Entry*>(NULL));
+  std::fill(occupied_, occupied_ + kNumLevels, 0);
+}
+
+TimerWheel::~TimerWheel() {
+  DCHECK_EQ(-1, advance_limit_);
+  std::vector<Entry*> entries;
+  CancelAll(&entries);
+}
+
+void TimerWheel::Schedule(Entry* entry, TimeTicks deadline) {
+  entry->Cancel();
+
+  // Round up, so that entries never expire early.
+  int64 delta = (deadline - origin_).InMicroseconds();
+  int64 granularity = granularity_.InMicroseconds();
+  int64 tick = 0;
+  if (delta > 0)
+    tick = delta / granularity + (delta % granularity ? 1 : 0);
+
+  entry->wheel_ = this;
+  entry->tick_ = tick;
+  entry->deadline_ = deadline;
+  ++size_;
+  Insert(entry, advance_limit_ >= 0 ? advance_limit_ : current_tick_);
+}
+
+size_t TimerWheel::Advance(TimeTicks now) {
+  // Advance() may be reentered from OnExpired(), e.g. by a nested run loop.
+  // The inner call first runs what is left of the tick the outer one is in.
+  bool nested = advance_limit_ >= 0;
+  size_t expired = RunExpiring();
+
+  int64 target_tick = TicksUntil(now);
+  if (target_tick < current_tick_)
+    return expired;
+
+  advance_limit_ = std::max(advance_limit_, target_tick + 1);
+  for (;;) {
+    int64 tick = NextTick();
+    if (tick < 0 || tick > target_tick)
+      break;
+
+    // Bring down the entries of every level that starts a new slot here,
+    // coarsest first, so that they end up in this tick's slot if they are
+    // due now.
+    current_tick_ = tick;
+    for (int level = kNumLevels - 1; level > 0; --level) {
+      int64 level_mask = (static_cast<int64>(1) << (kBitsPerLevel * level)) - 1;
+      if ((tick & level_mask) == 0)
+        Cascade(level);
+    }
+
+    int slot = static_cast<int>(tick & kSlotMask);
+    expiring_ = slots_[slot];
+    slots_[slot] = NULL;
+    occupied_[0] &= ~(static_cast<uint64>(1) << slot);
+    for (Entry* entry = expiring_; entry; entry = entry->next_)
+      entry->slot_ = kExpiringSlot;
+    current_tick_ = tick + 1;
+
+    expired += RunExpiring();
+  }
+
+  // Nothing starts before the next tick after |target_tick|, so there is no
+  // need to visit the ticks in between. A nested call may have gone further.
+  current_tick_ = std::max(current_tick_, target_tick + 1);
+  if (!nested)
+    advance_limit_ = -1;
+  return expired;
+}
+
+TimeTicks TimerWheel::NextWakeup() const {
+  if (expiring_)
+    return origin_ + TimeDelta::FromMicroseconds(
+        current_tick_ * granularity_.InMicroseconds());
+  int64 tick = NextTick();
+  if (tick < 0)
+    return TimeTicks();
+  return origin_ + TimeDelta::FromMicroseconds(
+      tick * granularity_.InMicroseconds());
+}
+
+void TimerWheel::CancelAll(std::vector<Entry*>* entries) {
+  for (int slot = kExpiringSlot; slot < kNumSlots; ++slot) {
+    Entry*& head = slot == kExpiringSlot ? expiring_ : slots_[slot];
+    while (head) {
+      Entry* entry = head;
+      head = entry->next_;
+      entry->previous_ = NULL;
+      entry->next_ = NULL;
+      Release(entry);
+      entries->push_back(entry);
+    }
+  }
+  std::fill(occupied_, occupied_ + kNumLevels, 0);
+  DCHECK_EQ(0u, size_);
+}
+
+size_t TimerWheel::RunExpiring() {
+  size_t expired = 0;
+  while (expiring_) {
+    Entry* entry = expiring_;
+    Unlink(entry);
+    Release(entry);
+    ++expired;
+    entry->OnExpired();
+  }
+  return expired;
+}
+
+void TimerWheel::Insert(Entry* entry, int64 min_tick) {
+  int64 tick = std::max(entry->tick_, min_tick);
+  int64 delta = tick - current_tick_;
+  DCHECK_GE(delta, 0);
+
+  int level = 0;
+  while (level < kNumLevels - 1 &&
+         (delta >> (kBitsPerLevel * (level + 1))) != 0) {
+    ++level;
+  }
+  // Entries beyond the last level wait in its furthest slot, and are placed
+  // again each time that slot comes round.
+  const int64 kWheelTicks = static_cast<int64>(1) << (kBitsPerLevel *
+                                                      kNumLevels);
+  if (delta >= kWheelTicks)
+    tick = current_tick_ + kWheelTicks - 1;
+
+  int index = static_cast<int>(tick >> (kBitsPerLevel * level)) & kSlotMask;
+  Link(entry, level * kSlotsPerLevel + index);
+}
+
+void TimerWheel::Link(Entry* entry, int slot) {
+  entry->slot_ = slot;
+  entry->previous_ = NULL;
+  entry->next_ = slots_[slot];
+  if (entry->next_)
+    entry->next_->previous_ = entry;
+  slots_[slot] = entry;
+  occupied_[slot / kSlotsPerLevel] |=
+      static_cast<uint64>(1) << (slot & kSlotMask);
+}
+
+void TimerWheel::Unlink(Entry* entry) {
+  DCHECK_EQ(this, entry->wheel_);
+  Entry** head =
+      entry->slot_ == kExpiringSlot ? &expiring_ : &slots_[entry->slot_];
+  if (entry->previous_)
+    entry->previous_->next_ = entry->next_;
+  else
+    *head = entry->next_;
+  if (entry->next_)
+    entry->next_->previous_ = entry->previous_;
+  entry->previous_ = NULL;
+  entry->next_ = NULL;
+
+  if (!*head && entry->slot_ != kExpiringSlot) {
+    occupied_[entry->slot_ / kSlotsPerLevel] &=
+        ~(static_cast<uint64>(1) << (entry->slot_ & kSlotMask));
+  }
+}
+
+void TimerWheel::Release(Entry* entry) {
+  entry->wheel_ = NULL;
+  --size_;
+}
+
+void TimerWheel::Cascade(int level) {
+  int slot = level * kSlotsPerLevel +
+      (static_cast<int>(current_tick_ >> (kBitsPerLevel * level)) & kSlotMask);
+  Entry* entry = slots_[slot];
+  slots_[slot] = NULL;
+  occupied_[level] &= ~(static_cast<uint64>(1) << (slot & kSlotMask));
+  while (entry) {
+    Entry* next = entry->next_;
+    Insert(entry, current_tick_);
+    entry = next;
+  }
+}
+
+int64 TimerWheel::NextTick() const {
+  int64 next_tick = -1;
+  for (int level = 0; level < kNumLevels; ++level) {
+    uint64 occupied = occupied_[level];
+    if (!occupied)
+      continue;
+
+    // Find the first slot with entries, counting from the current one.
+    int shift = kBitsPerLevel * level;
+    int64 current_slot = current_tick_ >> shift;
+    int index = static_cast<int>(current_slot) & kSlotMask;
+    uint64 rotated =
+        index ? (occupied >> index) | (occupied << (kSlotsPerLevel - index))
+              : occupied;
+    int offset;
+    if ((current_slot << shift) < current_tick_) {
+      // The current slot has already been brought down, so anything in it
+      // belongs to its next round.
+      rotated &= ~static_cast<uint64>(1);
+      offset = rotated ? LowestSetBit(rotated) : kSlotsPerLevel;
+    } else {
+      offset = LowestSetBit(rotated);
+    }
+
+    int64 tick = (current_slot + offset) << shift;
+    if (next_tick < 0 || tick < next_tick)
+      next_tick = tick;
+  }
+  return next_tick;
+}
+
+int64 TimerWheel::TicksUntil(TimeTicks time) const {
+  int64 delta = (time - origin_).InMicroseconds();
+  if (delta < 0)
+    return -1;
+  return delta / granularity_.InMicroseconds();
+}
+
+}  // namespace base
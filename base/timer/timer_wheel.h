@@ -0,0 +1,180 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// TimerWheel keeps a large number of deadlines that are frequently scheduled,
+// moved and cancelled, such as idle-socket timeouts and protocol alarms.
+// Scheduling and cancelling an entry are O(1), and deadlines are rounded up to
+// a multiple of the wheel's granularity so that entries that fall due within
+// one granularity of each other expire together.
+//
+// The wheel is hierarchical: the first level has one slot per tick of
+// |granularity|, and each further level has slots that are 64 times longer.
+// Entries move to finer levels as their deadline approaches.
+//
+// The wheel doesn't run anything by itself. Its owner calls Advance() with the
+// current time, and arranges to be called back at NextWakeup(). See
+// base::Timer::SetSlack() for timers that are driven by a wheel.
+//
+// NOTE: TimerWheel is not thread safe. Always use it from the same thread.
+
+#ifndef BASE_TIMER_TIMER_WHEEL_H_
+#define BASE_TIMER_TIMER_WHEEL_H_
+
+#include <vector>
+
+#include "base/base_export.h"
+#include "base/basictypes.h"
+#include "base/time/time.h"
+
+namespace base {
+
+class BASE_EXPORT TimerWheel {
+ public:
+  // Something with a deadline. Entries are linked into the wheel directly, so
+  // the wheel never allocates.
+  class BASE_EXPORT Entry {
+   public:
+    Entry();
+    // Cancels the entry if it is scheduled.
+    virtual ~Entry();
+
+    bool IsScheduled() const { return wheel_ != NULL; }
+
+    // The deadline the entry was last scheduled for.
+    TimeTicks deadline() const { return deadline_; }
+
+    // Removes the entry from its wheel. It is a no-op if the entry is not
+    // scheduled.
+    void Cancel();
+
+   protected:
+    // Called by TimerWheel::Advance() once the deadline has passed. The entry
+    // is no longer scheduled, so it may schedule itself again. It may also
+    // schedule, cancel or delete other entries, or delete itself.
+    virtual void OnExpired() = 0;
+
+   private:
+    friend class TimerWheel;
+
+    // The wheel the entry is scheduled in, or NULL.
+    TimerWheel* wheel_;
+
+    // Links in the list of the slot the entry is in.
+    Entry* previous_;
+    Entry* next_;
+
+    // The index of that slot in TimerWheel::slots_, or kExpiringSlot.
+    int slot_;
+
+    // The tick at which the entry expires.
+    int64 tick_;
+
+    TimeTicks deadline_;
+
+    DISALLOW_COPY_AND_ASSIGN(Entry);
+  };
+
+  // Deadlines are rounded up to the next multiple of |granularity| after
+  // |origin|, so entries expire no earlier than their deadline and at most
+  // |granularity| after it.
+  TimerWheel(TimeDelta granularity, TimeTicks origin);
+
+  // Entries still in the wheel are unscheduled without being run.
+  ~TimerWheel();
+
+  // Schedules |entry| to expire at |deadline|, moving it if it is already
+  // scheduled, possibly in another wheel. Ticks that Advance() has been past
+  // don't come again, so a deadline in one of them expires at the next tick.
+  void Schedule(Entry* entry, TimeTicks deadline);
+
+  // Runs OnExpired() for every entry whose deadline, rounded up to the
+  // granularity, is at or before |now|. Entries scheduled from OnExpired()
+  // don't run before the next call, even if they are already due. Returns the
+  // number of entries that expired. OnExpired() may call Advance() again, for
+  // instance from a nested run loop; the inner call picks up where the outer
+  // one is, and the outer one then has nothing left to run up to the later of
+  // the two times.
+  size_t Advance(TimeTicks now);
+
+  // Returns when Advance() next has work to do, or a null TimeTicks if the
+  // wheel is empty. This is the next expiry for entries that are due within
+  // 64 ticks. For later entries it can be earlier than the next expiry, when
+  // entries have to move to a finer level.
+  TimeTicks NextWakeup() const;
+
+  // Unschedules every entry without running it, and appends it to |entries|.
+  void CancelAll(std::vector<Entry*>* entries);
+
+  TimeDelta granularity() const { return granularity_; }
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+ private:
+  enum {
+    kBitsPerLevel = 6,
+    kSlotsPerLevel = 1 << kBitsPerLevel,
+    kSlotMask = kSlotsPerLevel - 1,
+    kNumLevels = 4,
+    kNumSlots = kSlotsPerLevel * kNumLevels,
+
+    // The slot of entries that Advance() is about to run.
+    kExpiringSlot = -1,
+  };
+
+  // Runs OnExpired() for the entries of the tick being processed. Returns how
+  // many there were.
+  size_t RunExpiring();
+
+  // Links |entry| into the slot for its tick, which is no earlier than
+  // |min_tick|.
+  void Insert(Entry* entry, int64 min_tick);
+
+  // Links |entry| at the head of the list in |slot|.
+  void Link(Entry* entry, int slot);
+
+  // Unlinks |entry| from the list it is in, leaving it scheduled.
+  void Unlink(Entry* entry);
+
+  // Marks |entry| as no longer scheduled after it has been unlinked.
+  void Release(Entry* entry);
+
+  // Moves the entries of the |level| slot that starts at current_tick_ down to
+  // finer levels.
+  void Cascade(int level);
+
+  // Returns the first tick, no earlier than current_tick_, at which a slot
+  // with entries starts, or -1 if the wheel is empty.
+  int64 NextTick() const;
+
+  // The granularity_ ticks since origin_ up to |time|, rounded down.
+  int64 TicksUntil(TimeTicks time) const;
+
+  const TimeDelta granularity_;
+  const TimeTicks origin_;
+
+  // The first tick that hasn't been processed by Advance().
+  int64 current_tick_;
+
+  // While Advance() runs, the tick after the last one it or any nested call
+  // processes, which is the earliest tick that entries scheduled from
+  // OnExpired() can get. -1 otherwise.
+  int64 advance_limit_;
+
+  // The head of each slot's list of entries, level by level.
+  Entry* slots_[kNumSlots];
+
+  // For each level, which of its slots have entries.
+  uint64 occupied_[kNumLevels];
+
+  // The entries that Advance() is running.
+  Entry* expiring_;
+
+  size_t size_;
+
+  DISALLOW_COPY_AND_ASSIGN(TimerWheel);
+};
+
+}  // namespace base
+
+#endif  // BASE_TIMER_TIMER_WHEEL_H_
@@ -0,0 +1,264 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/timer/timer_wheel.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "base/bind.h"
+#include "base/callback.h"
+#include "base/memory/scoped_vector.h"
+#include "base/rand_util.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+
+namespace {
+
+const TimeDelta kGranularity = TimeDelta::FromMilliseconds(1);
+
+class TestEntry : public TimerWheel::Entry {
+ public:
+  TestEntry() : expired_count_(0) {}
+
+  int expired_count() const { return expired_count_; }
+
+  void set_on_expired(const Closure& on_expired) { on_expired_ = on_expired; }
+
+ protected:
+  void OnExpired() override {
+    ++expired_count_;
+    if (!on_expired_.is_null())
+      on_expired_.Run();
+  }
+
+ private:
+  int expired_count_;
+  Closure on_expired_;
+};
+
+void Reschedule(TimerWheel* wheel, TestEntry* entry, TimeTicks deadline) {
+  wheel->Schedule(entry, deadline);
+}
+
+void CancelEntry(TestEntry* entry) {
+  entry->Cancel();
+}
+
+void AdvanceWheel(TimerWheel* wheel, TimeTicks now, size_t* expired) {
+  *expired = wheel->Advance(now);
+}
+
+// Returns |time| rounded up to kGranularity after |origin|.
+TimeTicks RoundedDeadline(TimeTicks origin, TimeTicks time) {
+  int64 delay_us = (time - origin).InMicroseconds();
+  int64 granularity_us = kGranularity.InMicroseconds();
+  return origin + TimeDelta::FromMicroseconds(
+      (delay_us + granularity_us - 1) / granularity_us * granularity_us);
+}
+
+}  // namespace
+
+TEST(TimerWheelTest, ExpiresAfterDeadline) {
+  TimeTicks origin = TimeTicks::Now();
+  TimerWheel wheel(kGranularity, origin);
+  EXPECT_TRUE(wheel.NextWakeup().is_null());
+
+  TestEntry entry;
+  wheel.Schedule(&entry, origin + TimeDelta::FromMicroseconds(2500));
+  EXPECT_TRUE(entry.IsScheduled());
+  EXPECT_EQ(1u, wheel.size());
+  EXPECT_EQ(origin + TimeDelta::FromMilliseconds(3), wheel.NextWakeup());
+
+  EXPECT_EQ(0u, wheel.Advance(origin + TimeDelta::FromMicroseconds(2999)));
+  EXPECT_EQ(0, entry.expired_count());
+  EXPECT_EQ(1u, wheel.Advance(origin + TimeDelta::FromMilliseconds(3)));
+  EXPECT_EQ(1, entry.expired_count());
+  EXPECT_FALSE(entry.IsScheduled());
+  EXPECT_TRUE(wheel.empty());
+  EXPECT_TRUE(wheel.NextWakeup().is_null());
+}
+
+TEST(TimerWheelTest, PastDeadlineExpiresAtNextTick) {
+  TimeTicks origin = TimeTicks::Now();
+  TimerWheel wheel(kGranularity, origin);
+  wheel.Advance(origin + TimeDelta::FromSeconds(1));
+
+  TestEntry entry;
+  wheel.Schedule(&entry, origin);
+  EXPECT_EQ(origin + TimeDelta::FromMilliseconds(1001), wheel.NextWakeup());
+  EXPECT_EQ(0u, wheel.Advance(origin + TimeDelta::FromSeconds(1)));
+  EXPECT_EQ(1u, wheel.Advance(origin + TimeDelta::FromMilliseconds(1001)));
+  EXPECT_EQ(1, entry.expired_count());
+}
+
+TEST(TimerWheelTest, CoalescesWithinGranularity) {
+  TimeTicks origin = TimeTicks::Now();
+  TimerWheel wheel(TimeDelta::FromMilliseconds(10), origin);
+
+  TestEntry entries[3];
+  wheel.Schedule(&entries[0], origin + TimeDelta::FromMilliseconds(21));
+  wheel.Schedule(&entries[1], origin + TimeDelta::FromMilliseconds(25));
+  wheel.Schedule(&entries[2], origin + TimeDelta::FromMilliseconds(30));
+  EXPECT_EQ(origin + TimeDelta::FromMilliseconds(30), wheel.NextWakeup());
+  EXPECT_EQ(3u, wheel.Advance(origin + TimeDelta::FromMilliseconds(30)));
+}
+
+TEST(TimerWheelTest, CancelAndReschedule) {
+  TimeTicks origin = TimeTicks::Now();
+  TimerWheel wheel(kGranularity, origin);
+
+  TestEntry cancelled;
+  TestEntry moved;
+  scoped_ptr<TestEntry> deleted(new TestEntry);
+  wheel.Schedule(&cancelled, origin + TimeDelta::FromMilliseconds(5));
+  wheel.Schedule(&moved, origin + TimeDelta::FromMilliseconds(5));
+  wheel.Schedule(deleted.get(), origin + TimeDelta::FromMilliseconds(5));
+  EXPECT_EQ(3u, wheel.size());
+
+  cancelled.Cancel();
+  EXPECT_FALSE(cancelled.IsScheduled());
+  wheel.Schedule(&moved, origin + TimeDelta::FromSeconds(100));
+  deleted.reset();
+  EXPECT_EQ(1u, wheel.size());
+
+  EXPECT_EQ(0u, wheel.Advance(origin + TimeDelta::FromSeconds(99)));
+  EXPECT_EQ(1u, wheel.Advance(origin + TimeDelta::FromSeconds(100)));
+  EXPECT_EQ(0, cancelled.expired_count());
+  EXPECT_EQ(1, moved.expired_count());
+}
+
+TEST(TimerWheelTest, ScheduleFromOnExpired) {
+  TimeTicks origin = TimeTicks::Now();
+  TimerWheel wheel(kGranularity, origin);
+
+  // An entry that is due again straight away waits for the next tick.
+  TestEntry repeating;
+  repeating.set_on_expired(
+      Bind(&Reschedule, Unretained(&wheel), Unretained(&repeating), origin));
+  wheel.Schedule(&repeating, origin);
+  EXPECT_EQ(1u, wheel.Advance(origin + TimeDelta::FromMilliseconds(10)));
+  EXPECT_EQ(1u, wheel.Advance(origin + TimeDelta::FromMilliseconds(11)));
+  EXPECT_TRUE(repeating.IsScheduled());
+  repeating.Cancel();
+
+  // Entries can cancel others that expire at the same time.
+  TestEntry first;
+  TestEntry second;
+  first.set_on_expired(Bind(&CancelEntry, Unretained(&second)));
+  second.set_on_expired(Bind(&CancelEntry, Unretained(&first)));
+  wheel.Schedule(&first, origin + TimeDelta::FromMilliseconds(20));
+  wheel.Schedule(&second, origin + TimeDelta::FromMilliseconds(20));
+  EXPECT_EQ(1u, wheel.Advance(origin + TimeDelta::FromMilliseconds(20)));
+  EXPECT_EQ(1, first.expired_count() + second.expired_count());
+  EXPECT_TRUE(wheel.empty());
+}
+
+TEST(TimerWheelTest, AdvanceFromOnExpired) {
+  TimeTicks origin = TimeTicks::Now();
+  TimerWheel wheel(kGranularity, origin);
+
+  // The nested call runs the rest of the outer call's tick and goes on to
+  // later ticks, leaving nothing for the outer call.
+  TestEntry outer;
+  TestEntry same_tick;
+  TestEntry later;
+  size_t nested_expired = 0;
+  outer.set_on_expired(Bind(&AdvanceWheel, Unretained(&wheel),
+                            origin + TimeDelta::FromMilliseconds(30),
+                            Unretained(&nested_expired)));
+  wheel.Schedule(&same_tick, origin + TimeDelta::FromMilliseconds(10));
+  wheel.Schedule(&later, origin + TimeDelta::FromMilliseconds(20));
+  wheel.Schedule(&outer, origin + TimeDelta::FromMilliseconds(10));
+  // |outer| was scheduled last, so it is the first to run in its tick.
+  EXPECT_EQ(1u, wheel.Advance(origin + TimeDelta::FromMilliseconds(10)));
+  EXPECT_EQ(2u, nested_expired);
+  EXPECT_EQ(1, same_tick.expired_count());
+  EXPECT_EQ(1, later.expired_count());
+  EXPECT_TRUE(wheel.empty());
+
+  // Ticks the nested call went past don't come again.
+  wheel.Schedule(&later, origin + TimeDelta::FromMilliseconds(25));
+  EXPECT_EQ(1u, wheel.Advance(origin + TimeDelta::FromMilliseconds(31)));
+  EXPECT_EQ(2, later.expired_count());
+}
+
+TEST(TimerWheelTest, CancelAll) {
+  TimeTicks origin = TimeTicks::Now();
+  TestEntry near_entry;
+  TestEntry far_entry;
+  {
+    TimerWheel wheel(kGranularity, origin);
+    wheel.Schedule(&near_entry, origin + TimeDelta::FromMilliseconds(1));
+    wheel.Schedule(&far_entry, origin + TimeDelta::FromDays(1));
+    std::vector<TimerWheel::Entry*> entries;
+    wheel.CancelAll(&entries);
+    EXPECT_EQ(2u, entries.size());
+    EXPECT_TRUE(wheel.empty());
+    EXPECT_FALSE(near_entry.IsScheduled());
+
+    // Entries left in a wheel are unscheduled when it goes away.
+    wheel.Schedule(&far_entry, origin + TimeDelta::FromDays(1));
+  }
+  EXPECT_FALSE(far_entry.IsScheduled());
+  EXPECT_EQ(0, far_entry.expired_count());
+}
+
+// Schedules, cancels and advances at random, with deadlines at every level of
+// the wheel and beyond, and checks each entry expires at the first Advance()
+// at or after its rounded up deadline.
+TEST(TimerWheelTest, Random) {
+  TimeTicks origin = TimeTicks::Now();
+  TimerWheel wheel(kGranularity, origin);
+  ScopedVector<TestEntry> entries;
+  for (int i = 0; i < 200; ++i)
+    entries.push_back(new TestEntry);
+
+  const int64 kMaxDelayMs[] = {10, 100, 5000, 300000, 30000000};
+  TimeTicks now = origin;
+  // Deadlines in ticks that have been advanced past move to this one.
+  TimeTicks next_tick = origin;
+  for (int step = 0; step < 20000; ++step) {
+    TestEntry* entry = entries[RandInt(0, entries.size() - 1)];
+    if (RandInt(0, 9) == 0) {
+      entry->Cancel();
+    } else if (!entry->IsScheduled()) {
+      int64 max_delay_ms = kMaxDelayMs[RandInt(0, arraysize(kMaxDelayMs) - 1)];
+      wheel.Schedule(entry, now + TimeDelta::FromMicroseconds(
+          RandGenerator(max_delay_ms * 1000)));
+    }
+
+    int64 max_advance_ms = kMaxDelayMs[RandInt(0, arraysize(kMaxDelayMs) - 1)];
+    now += TimeDelta::FromMicroseconds(RandGenerator(max_advance_ms * 100));
+    std::vector<int> expected_counts;
+    for (size_t i = 0; i < entries.size(); ++i) {
+      TimeTicks expiry =
+          std::max(RoundedDeadline(origin, entries[i]->deadline()), next_tick);
+      bool due = entries[i]->IsScheduled() && expiry <= now;
+      expected_counts.push_back(entries[i]->expired_count() + (due ? 1 : 0));
+    }
+
+    wheel.Advance(now);
+    next_tick = RoundedDeadline(origin, now + TimeDelta::FromMicroseconds(1));
+    TimeTicks next_expiry;
+    for (size_t i = 0; i < entries.size(); ++i) {
+      ASSERT_EQ(expected_counts[i], entries[i]->expired_count())
+          << "step " << step;
+      if (entries[i]->IsScheduled()) {
+        TimeTicks expiry = std::max(
+            RoundedDeadline(origin, entries[i]->deadline()), next_tick);
+        ASSERT_GT(expiry, now);
+        if (next_expiry.is_null() || expiry < next_expiry)
+          next_expiry = expiry;
+      }
+    }
+    if (!wheel.empty()) {
+      ASSERT_GT(wheel.NextWakeup(), now);
+      ASSERT_LE(wheel.NextWakeup(), next_expiry);
+    }
+  }
+}
+
+}  // namespace base
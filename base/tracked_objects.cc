@@ -7,6 +7,7 @@
 #include <limits.h>
 #include <stdlib.h>
 
+#include "base/allocator/allocator_extension.h"
 #include "base/atomicops.h"
 #include "base/base_switches.h"
 #include "base/command_line.h"
@@ -90,6 +91,20 @@ inline bool IsProfilerTimingEnabled() {
   return current_timing_enabled == ENABLED_TIMING;
 }
 
+// Reads the allocator's running totals for the current thread. They read as
+// zero when the allocator does not provide them, so that no allocations are
+// ever attributed to tasks.
+void GetAllocationCounts(uint32* alloc_bytes, uint32* alloc_count) {
+  unsigned int bytes;
+  unsigned int count;
+  if (!base::allocator::GetThreadAllocationCounts(&bytes, &count)) {
+    bytes = 0;
+    count = 0;
+  }
+  *alloc_bytes = bytes;
+  *alloc_count = count;
+}
+
 }  // namespace
 
 //------------------------------------------------------------------------------
@@ -116,17 +131,23 @@ DeathData::DeathData(int count) {
 
 void DeathData::RecordDeath(const int32 queue_duration,
                             const int32 run_duration,
+                            const int32 alloc_bytes,
+                            const int32 alloc_count,
                             const uint32 random_number) {
   // We'll just clamp at INT_MAX, but we should note this in the UI as such.
   if (count_ < INT_MAX)
     ++count_;
   queue_duration_sum_ += queue_duration;
   run_duration_sum_ += run_duration;
+  alloc_bytes_sum_ += alloc_bytes;
+  alloc_count_sum_ += alloc_count;
 
   if (queue_duration_max_ < queue_duration)
     queue_duration_max_ = queue_duration;
   if (run_duration_max_ < run_duration)
     run_duration_max_ = run_duration;
+  if (alloc_bytes_max_ < alloc_bytes)
+    alloc_bytes_max_ = alloc_bytes;
 
   // Take a uniformly distributed sample over all durations ever supplied.
   // The probability that we (instead) use this new sample is 1/count_.  This
@@ -163,9 +184,22 @@ int32 DeathData::queue_duration_sample() const {
   return queue_duration_sample_;
 }
 
+int64 DeathData::alloc_bytes_sum() const {
+  return alloc_bytes_sum_;
+}
+
+int32 DeathData::alloc_bytes_max() const {
+  return alloc_bytes_max_;
+}
+
+int64 DeathData::alloc_count_sum() const {
+  return alloc_count_sum_;
+}
+
 void DeathData::ResetMax() {
   run_duration_max_ = 0;
   queue_duration_max_ = 0;
+  alloc_bytes_max_ = 0;
 }
 
 void DeathData::Clear() {
@@ -176,6 +210,9 @@ void DeathData::Clear() {
   queue_duration_sum_ = 0;
   queue_duration_max_ = 0;
   queue_duration_sample_ = 0;
+  alloc_bytes_sum_ = 0;
+  alloc_bytes_max_ = 0;
+  alloc_count_sum_ = 0;
 }
 
 //------------------------------------------------------------------------------
@@ -186,7 +223,10 @@ DeathDataSnapshot::DeathDataSnapshot()
       run_duration_sample(-1),
       queue_duration_sum(-1),
       queue_duration_max(-1),
-      queue_duration_sample(-1) {
+      queue_duration_sample(-1),
+      alloc_bytes_sum(-1),
+      alloc_bytes_max(-1),
+      alloc_count_sum(-1) {
 }
 
 DeathDataSnapshot::DeathDataSnapshot(
@@ -197,7 +237,10 @@ DeathDataSnapshot::DeathDataSnapshot(
       run_duration_sample(death_data.run_duration_sample()),
       queue_duration_sum(death_data.queue_duration_sum()),
       queue_duration_max(death_data.queue_duration_max()),
-      queue_duration_sample(death_data.queue_duration_sample()) {
+      queue_duration_sample(death_data.queue_duration_sample()),
+      alloc_bytes_sum(death_data.alloc_bytes_sum()),
+      alloc_bytes_max(death_data.alloc_bytes_max()),
+      alloc_count_sum(death_data.alloc_count_sum()) {
 }
 
 DeathDataSnapshot::~DeathDataSnapshot() {
@@ -476,7 +519,9 @@ void ThreadData::TallyADeath(const Births& birth,
     base::AutoLock lock(map_lock_);  // Lock as the map may get relocated now.
     death_data = &death_map_[&birth];
   }  // Release lock ASAP.
-  death_data->RecordDeath(queue_duration, run_duration, random_number_);
+  death_data->RecordDeath(queue_duration, run_duration,
+                          stopwatch.AllocatedBytes(),
+                          stopwatch.AllocationCount(), random_number_);
 
   if (!kTrackParentChildLinks)
     return;
@@ -870,8 +915,14 @@ void ThreadData::ShutdownSingleThreadedCleanup(bool leak) {
 //------------------------------------------------------------------------------
 TaskStopwatch::TaskStopwatch()
     : wallclock_duration_ms_(0),
+      start_alloc_bytes_(0),
+      start_alloc_count_(0),
+      alloc_bytes_(0),
+      alloc_count_(0),
       current_thread_data_(NULL),
       excluded_duration_ms_(0),
+      excluded_alloc_bytes_(0),
+      excluded_alloc_count_(0),
       parent_(NULL) {
 #if DCHECK_IS_ON()
   state_ = CREATED;
@@ -893,6 +944,7 @@ void TaskStopwatch::Start() {
 #endif
 
   start_time_ = ThreadData::Now();
+  GetAllocationCounts(&start_alloc_bytes_, &start_alloc_count_);
 
   current_thread_data_ = ThreadData::Get();
   if (!current_thread_data_)
@@ -911,6 +963,9 @@ void TaskStopwatch::Start() {
 
 void TaskStopwatch::Stop() {
   const TrackedTime end_time = ThreadData::Now();
+  uint32 end_alloc_bytes;
+  uint32 end_alloc_count;
+  GetAllocationCounts(&end_alloc_bytes, &end_alloc_count);
 #if DCHECK_IS_ON()
   DCHECK(state_ == RUNNING);
   state_ = STOPPED;
@@ -920,6 +975,9 @@ void TaskStopwatch::Stop() {
   if (!start_time_.is_null() && !end_time.is_null()) {
     wallclock_duration_ms_ = (end_time - start_time_).InMilliseconds();
   }
+  // The counts wrap, so subtract them unsigned.
+  alloc_bytes_ = static_cast<int32>(end_alloc_bytes - start_alloc_bytes_);
+  alloc_count_ = static_cast<int32>(end_alloc_count - start_alloc_count_);
 
   if (!current_thread_data_)
     return;
@@ -935,6 +993,8 @@ void TaskStopwatch::Stop() {
   parent_->child_ = NULL;
 #endif
   parent_->excluded_duration_ms_ += wallclock_duration_ms_;
+  parent_->excluded_alloc_bytes_ += alloc_bytes_;
+  parent_->excluded_alloc_count_ += alloc_count_;
   parent_ = NULL;
 }
 
@@ -954,6 +1014,22 @@ int32 TaskStopwatch::RunDurationMs() const {
   return wallclock_duration_ms_ - excluded_duration_ms_;
 }
 
+int32 TaskStopwatch::AllocatedBytes() const {
+#if DCHECK_IS_ON()
+  DCHECK(state_ == STOPPED);
+#endif
+
+  return alloc_bytes_ - excluded_alloc_bytes_;
+}
+
+int32 TaskStopwatch::AllocationCount() const {
+#if DCHECK_IS_ON()
+  DCHECK(state_ == STOPPED);
+#endif
+
+  return alloc_count_ - excluded_alloc_count_;
+}
+
 ThreadData* TaskStopwatch::GetThreadData() const {
 #if DCHECK_IS_ON()
   DCHECK(state_ != CREATED);
@@ -270,9 +270,12 @@ class BASE_EXPORT DeathData {
   explicit DeathData(int count);
 
   // Update stats for a task destruction (death) that had a Run() time of
-  // |duration|, and has had a queueing delay of |queue_duration|.
+  // |duration|, and has had a queueing delay of |queue_duration|. While it ran,
+  // the task allocated |alloc_bytes| bytes of heap in |alloc_count| calls.
   void RecordDeath(const int32 queue_duration,
                    const int32 run_duration,
+                   const int32 alloc_bytes,
+                   const int32 alloc_count,
                    const uint32 random_number);
 
   // Metrics accessors, used only for serialization and in tests.
@@ -283,6 +286,9 @@ class BASE_EXPORT DeathData {
   int32 queue_duration_sum() const;
   int32 queue_duration_max() const;
   int32 queue_duration_sample() const;
+  int64 alloc_bytes_sum() const;
+  int32 alloc_bytes_max() const;
+  int64 alloc_count_sum() const;
 
   // Reset the max values to zero.
   void ResetMax();
@@ -306,6 +312,12 @@ class BASE_EXPORT DeathData {
   // and rarely updated.
   int32 run_duration_sample_;
   int32 queue_duration_sample_;
+  // Heap allocation tallies. They stay zero unless the allocator provides
+  // per-thread counts (see base/allocator/allocator_extension.h). The sums
+  // are 64 bit as busy tasks allocate more than 2GB over a session.
+  int64 alloc_bytes_sum_;
+  int32 alloc_bytes_max_;
+  int64 alloc_count_sum_;
 };
 
 //------------------------------------------------------------------------------
@@ -323,6 +335,9 @@ struct BASE_EXPORT DeathDataSnapshot {
   int32 queue_duration_sum;
   int32 queue_duration_max;
   int32 queue_duration_sample;
+  int64 alloc_bytes_sum;
+  int32 alloc_bytes_max;
+  int64 alloc_count_sum;
 };
 
 //------------------------------------------------------------------------------
@@ -727,6 +742,12 @@ class BASE_EXPORT TaskStopwatch {
   // this thread during that period.
   int32 RunDurationMs() const;
 
+  // Heap bytes allocated and number of allocations made by the task, with the
+  // same exclusion of nested stopwatches as RunDurationMs(). Both are zero
+  // unless the allocator provides per-thread counts.
+  int32 AllocatedBytes() const;
+  int32 AllocationCount() const;
+
   // Returns tracking info for the current thread.
   ThreadData* GetThreadData() const;
 
@@ -737,6 +758,13 @@ class BASE_EXPORT TaskStopwatch {
   // Wallclock duration of the task.
   int32 wallclock_duration_ms_;
 
+  // Per-thread allocator counts when the stopwatch was started, and what was
+  // allocated between starting and stopping it.
+  uint32 start_alloc_bytes_;
+  uint32 start_alloc_count_;
+  int32 alloc_bytes_;
+  int32 alloc_count_;
+
   // Tracking info for the current thread.
   ThreadData* current_thread_data_;
 
@@ -744,6 +772,11 @@ class BASE_EXPORT TaskStopwatch {
   // this one.
   int32 excluded_duration_ms_;
 
+  // Sum of allocations of all stopwatches that were directly nested in this
+  // one.
+  int32 excluded_alloc_bytes_;
+  int32 excluded_alloc_count_;
+
   // Stopwatch which was running on our thread when this stopwatch was started.
   // That preexisting stopwatch must be adjusted to the exclude the wallclock
   // duration of this stopwatch.
@@ -8,6 +8,7 @@
 
 #include <stddef.h>
 
+#include "base/allocator/allocator_extension_thunks.h"
 #include "base/memory/scoped_ptr.h"
 #include "base/process/process_handle.h"
 #include "base/time/time.h"
@@ -100,16 +101,38 @@ class TrackedObjectsTest : public testing::Test {
   // Sets time that will be returned by ThreadData::Now().
   static void SetTestTime(unsigned int test_time) { test_time_ = test_time; }
 
+  // Sets the per-thread allocator counts that the stopwatches read.
+  static void SetTestAllocationCounts(unsigned int alloc_bytes,
+                                      unsigned int alloc_count) {
+    test_alloc_bytes_ = alloc_bytes;
+    test_alloc_count_ = alloc_count;
+  }
+
+  static bool GetTestAllocationCounts(unsigned int* alloc_bytes,
+                                      unsigned int* alloc_count) {
+    *alloc_bytes = test_alloc_bytes_;
+    *alloc_count = test_alloc_count_;
+    return true;
+  }
+
  private:
   // Returns test time in milliseconds.
   static unsigned int GetTestTime() { return test_time_; }
 
   // Test time in milliseconds.
   static unsigned int test_time_;
+
+  // Test allocator counts.
+  static unsigned int test_alloc_bytes_;
+  static unsigned int test_alloc_count_;
 };
 
 // static
 unsigned int TrackedObjectsTest::test_time_;
+// static
+unsigned int TrackedObjectsTest::test_alloc_bytes_;
+// static
+unsigned int TrackedObjectsTest::test_alloc_count_;
 
 TEST_F(TrackedObjectsTest, TaskStopwatchNoStartStop) {
   if (!ThreadData::InitializeAndSetTrackingStatus(
@@ -280,20 +303,25 @@ TEST_F(TrackedObjectsTest, DeathDataTest) {
 
   int32 run_ms = 42;
   int32 queue_ms = 8;
+  int32 alloc_bytes = 512;
+  int32 alloc_count = 3;
 
   const int kUnrandomInt = 0;  // Fake random int that ensure we sample data.
-  data->RecordDeath(queue_ms, run_ms, kUnrandomInt);
+  data->RecordDeath(queue_ms, run_ms, alloc_bytes, alloc_count, kUnrandomInt);
   EXPECT_EQ(data->run_duration_sum(), run_ms);
   EXPECT_EQ(data->run_duration_sample(), run_ms);
   EXPECT_EQ(data->queue_duration_sum(), queue_ms);
   EXPECT_EQ(data->queue_duration_sample(), queue_ms);
   EXPECT_EQ(data->count(), 1);
 
-  data->RecordDeath(queue_ms, run_ms, kUnrandomInt);
+  data->RecordDeath(queue_ms, run_ms, 0, 0, kUnrandomInt);
   EXPECT_EQ(data->run_duration_sum(), run_ms + run_ms);
   EXPECT_EQ(data->run_duration_sample(), run_ms);
   EXPECT_EQ(data->queue_duration_sum(), queue_ms + queue_ms);
   EXPECT_EQ(data->queue_duration_sample(), queue_ms);
+  EXPECT_EQ(data->alloc_bytes_sum(), alloc_bytes);
+  EXPECT_EQ(data->alloc_bytes_max(), alloc_bytes);
+  EXPECT_EQ(data->alloc_count_sum(), alloc_count);
   EXPECT_EQ(data->count(), 2);
 
   DeathDataSnapshot snapshot(*data);
@@ -304,6 +332,9 @@ TEST_F(TrackedObjectsTest, DeathDataTest) {
   EXPECT_EQ(2 * queue_ms, snapshot.queue_duration_sum);
   EXPECT_EQ(queue_ms, snapshot.queue_duration_max);
   EXPECT_EQ(queue_ms, snapshot.queue_duration_sample);
+  EXPECT_EQ(alloc_bytes, snapshot.alloc_bytes_sum);
+  EXPECT_EQ(alloc_bytes, snapshot.alloc_bytes_max);
+  EXPECT_EQ(alloc_count, snapshot.alloc_count_sum);
 }
 
 TEST_F(TrackedObjectsTest, DeactivatedBirthOnlyToSnapshotWorkerThread) {
@@ -690,6 +721,51 @@ TEST_F(TrackedObjectsTest, TaskWithNestedExclusion) {
                           kMainThreadName, 1, 6, 4);
 }
 
+TEST_F(TrackedObjectsTest, TaskAllocationsWithNestedExclusion) {
+  if (!ThreadData::InitializeAndSetTrackingStatus(
+          ThreadData::PROFILING_CHILDREN_ACTIVE)) {
+    return;
+  }
+  base::allocator::thunks::SetGetThreadAllocationCountsFunction(
+      &TrackedObjectsTest::GetTestAllocationCounts);
+
+  const char kFunction[] = "TaskAllocationsWithNestedExclusion";
+  Location location(kFunction, kFile, kLineNumber, NULL);
+  TallyABirth(location, kMainThreadName);
+
+  base::TrackingInfo pending_task(location, base::TimeTicks());
+
+  // Start near the top of the range, so that the counts wrap while the task
+  // runs.
+  SetTestAllocationCounts(0xFFFFFF00u, 0xFFFFFFFEu);
+  TaskStopwatch task_stopwatch;
+  task_stopwatch.Start();
+  {
+    SetTestAllocationCounts(0xFFFFFF80u, 0xFFFFFFFFu);
+    TaskStopwatch exclusion_stopwatch;
+    exclusion_stopwatch.Start();
+    SetTestAllocationCounts(0x40u, 0x4u);
+    exclusion_stopwatch.Stop();
+    EXPECT_EQ(0xC0, exclusion_stopwatch.AllocatedBytes());
+    EXPECT_EQ(5, exclusion_stopwatch.AllocationCount());
+  }
+  SetTestAllocationCounts(0x100u, 0x6u);
+  task_stopwatch.Stop();
+  EXPECT_EQ(0x140, task_stopwatch.AllocatedBytes());
+  EXPECT_EQ(3, task_stopwatch.AllocationCount());
+
+  ThreadData::TallyRunOnNamedThreadIfTracking(pending_task, task_stopwatch);
+  base::allocator::thunks::SetGetThreadAllocationCountsFunction(NULL);
+
+  ProcessDataSnapshot process_data;
+  ThreadData::Snapshot(false, &process_data);
+  ASSERT_EQ(1u, process_data.tasks.size());
+  EXPECT_EQ(1, process_data.tasks[0].death_data.count);
+  EXPECT_EQ(0x140, process_data.tasks[0].death_data.alloc_bytes_sum);
+  EXPECT_EQ(0x140, process_data.tasks[0].death_data.alloc_bytes_max);
+  EXPECT_EQ(3, process_data.tasks[0].death_data.alloc_count_sum);
+}
+
 TEST_F(TrackedObjectsTest, TaskWith2NestedExclusions) {
   if (!ThreadData::InitializeAndSetTrackingStatus(
           ThreadData::PROFILING_CHILDREN_ACTIVE)) {
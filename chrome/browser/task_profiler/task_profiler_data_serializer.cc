@@ -60,6 +60,12 @@ void DeathDataSnapshotToValue(const DeathDataSnapshot& death_data,
   dictionary->SetInteger("queue_ms", death_data.queue_duration_sum);
   dictionary->SetInteger("queue_ms_max", death_data.queue_duration_max);
   dictionary->SetInteger("queue_ms_sample", death_data.queue_duration_sample);
+  // The allocation sums may not fit in an int.
+  dictionary->SetDouble("alloc_bytes",
+                        static_cast<double>(death_data.alloc_bytes_sum));
+  dictionary->SetInteger("alloc_bytes_max", death_data.alloc_bytes_max);
+  dictionary->SetDouble("alloc_count",
+                        static_cast<double>(death_data.alloc_count_sum));
 }
 
 // Re-serializes the |snapshot| into |dictionary|.
@@ -80,6 +80,9 @@ TEST(TaskProfilerDataSerializerTest, SerializeProcessDataToJson) {
     process_data.tasks.back().death_data.queue_duration_max = 53;
     process_data.tasks.back().death_data.queue_duration_sample = 13;
     process_data.tasks.back().death_data.queue_duration_sum = 79;
+    process_data.tasks.back().death_data.alloc_bytes_sum = 4096;
+    process_data.tasks.back().death_data.alloc_bytes_max = 1024;
+    process_data.tasks.back().death_data.alloc_count_sum = 61;
     process_data.tasks.back().death_thread_name = "WorkerPool/-1340960768";
 
     // Add a second snapshot.
@@ -92,6 +95,9 @@ TEST(TaskProfilerDataSerializerTest, SerializeProcessDataToJson) {
     process_data.tasks.back().death_data.queue_duration_max = 2053;
     process_data.tasks.back().death_data.queue_duration_sample = 2013;
     process_data.tasks.back().death_data.queue_duration_sum = 2079;
+    process_data.tasks.back().death_data.alloc_bytes_sum = 0;
+    process_data.tasks.back().death_data.alloc_bytes_max = 0;
+    process_data.tasks.back().death_data.alloc_count_sum = 0;
     process_data.tasks.back().death_thread_name = "PAC thread #3";
 
     // Add a parent-child pair.
@@ -127,6 +133,9 @@ TEST(TaskProfilerDataSerializerTest, SerializeProcessDataToJson) {
                              "},"
                              "\"birth_thread\":\"CrBrowserMain\","
                              "\"death_data\":{"
+                                "\"alloc_bytes\":4096.0,"
+                                "\"alloc_bytes_max\":1024,"
+                                "\"alloc_count\":61.0,"
                                 "\"count\":37,"
                                 "\"queue_ms\":79,"
                                 "\"queue_ms_max\":53,"
@@ -144,6 +153,9 @@ TEST(TaskProfilerDataSerializerTest, SerializeProcessDataToJson) {
                              "},"
                              "\"birth_thread\":\"Chrome_IOThread\","
                              "\"death_data\":{"
+                                "\"alloc_bytes\":0.0,"
+                                "\"alloc_bytes_max\":0,"
+                                "\"alloc_count\":0.0,"
                                 "\"count\":41,"
                                 "\"queue_ms\":2079,"
                                 "\"queue_ms_max\":2053,"
@@ -481,6 +481,13 @@ class ContentMainRunnerImpl : public ContentMainRunner {
   static void ReleaseFreeMemoryThunk() {
     MallocExtension::instance()->ReleaseFreeMemory();
   }
+
+  static bool GetThreadAllocationCountsThunk(unsigned int* bytes_allocated,
+                                             unsigned int* allocations) {
+    *bytes_allocated = MallocExtension::GetBytesAllocatedOnCurrentThread();
+    *allocations = MallocExtension::GetAllocationsOnCurrentThread();
+    return true;
+  }
 #endif
 
   int Initialize(const ContentMainParams& params) override {
@@ -522,6 +529,8 @@ class ContentMainRunnerImpl : public ContentMainRunner {
         GetAllocatorWasteSizeThunk);
     base::allocator::SetGetStatsFunction(GetStatsThunk);
     base::allocator::SetReleaseFreeMemoryFunction(ReleaseFreeMemoryThunk);
+    base::allocator::SetGetThreadAllocationCountsFunction(
+        GetThreadAllocationCountsThunk);
 
     // Provide optional hook for monitoring allocation quantities on a
     // per-thread basis.  Only set the hook if the environment indicates this
@@ -6,7 +6,9 @@
 
 #include "base/bind.h"
 #include "base/metrics/histogram.h"
+#include "base/metrics/persistent_histogram_allocator.h"
 #include "base/process/process_handle.h"
+#include "base/stl_util.h"
 #include "content/browser/histogram_subscriber.h"
 #include "content/common/child_process_messages.h"
 #include "content/public/browser/browser_child_process_host_iterator.h"
@@ -25,6 +27,7 @@ HistogramController::HistogramController() : subscriber_(NULL) {
 }
 
 HistogramController::~HistogramController() {
+  STLDeleteValues(&persistent_allocators_);
 }
 
 void HistogramController::OnPendingProcesses(int sequence_number,
@@ -105,9 +108,44 @@ void HistogramController::GetHistogramDataFromChildProcesses(
           true));
 }
 
+void HistogramController::RegisterPersistentAllocator(
+    const void* owner,
+    scoped_ptr<base::PersistentHistogramAllocator> allocator) {
+  base::AutoLock lock(persistent_allocators_lock_);
+  DCHECK(!ContainsKey(persistent_allocators_, owner));
+  persistent_allocators_[owner] = allocator.release();
+}
+
+void HistogramController::UnregisterPersistentAllocator(const void* owner) {
+  scoped_ptr<base::PersistentHistogramAllocator> allocator;
+  {
+    base::AutoLock lock(persistent_allocators_lock_);
+    std::map<const void*, base::PersistentHistogramAllocator*>::iterator it =
+        persistent_allocators_.find(owner);
+    if (it == persistent_allocators_.end())
+      return;
+    allocator.reset(it->second);
+    persistent_allocators_.erase(it);
+  }
+  // The child is gone, so nothing else writes to the memory; what it recorded
+  // since the last merge would otherwise be lost.
+  allocator->MergeHistogramDeltasToStatisticsRecorder();
+}
+
+void HistogramController::MergePersistentHistograms() {
+  base::AutoLock lock(persistent_allocators_lock_);
+  for (std::map<const void*, base::PersistentHistogramAllocator*>::iterator
+           it = persistent_allocators_.begin();
+       it != persistent_allocators_.end(); ++it) {
+    it->second->MergeHistogramDeltasToStatisticsRecorder();
+  }
+}
+
 void HistogramController::GetHistogramData(int sequence_number) {
   DCHECK(BrowserThread::CurrentlyOn(BrowserThread::UI));
 
+  MergePersistentHistograms();
+
   int pending_processes = 0;
   for (RenderProcessHost::iterator it(RenderProcessHost::AllHostsIterator());
        !it.IsAtEnd(); it.Advance()) {
@@ -5,10 +5,17 @@
 #ifndef CONTENT_BROWSER_HISTOGRAM_CONTROLLER_H_
 #define CONTENT_BROWSER_HISTOGRAM_CONTROLLER_H_
 
+#include <map>
 #include <string>
 #include <vector>
 
+#include "base/memory/scoped_ptr.h"
 #include "base/memory/singleton.h"
+#include "base/synchronization/lock.h"
+
+namespace base {
+class PersistentHistogramAllocator;
+}
 
 namespace content {
 
@@ -38,9 +45,22 @@ class HistogramController {
   // Safe to call even if caller is not the current subscriber.
   void Unregister(const HistogramSubscriber* subscriber);
 
-  // Contact all processes and get their histogram data.
+  // Contact all processes and get their histogram data. Histograms that
+  // children keep in shared memory are merged synchronously, before any IPC.
   void GetHistogramData(int sequence_number);
 
+  // Takes |allocator|, which holds histograms that the child process behind
+  // |owner| records in shared memory, and merges it into the
+  // StatisticsRecorder on every GetHistogramData(). Can be called on any
+  // thread.
+  void RegisterPersistentAllocator(
+      const void* owner,
+      scoped_ptr<base::PersistentHistogramAllocator> allocator);
+
+  // Merges the allocator registered by |owner| one last time and destroys it.
+  // Can be called on any thread.
+  void UnregisterPersistentAllocator(const void* owner);
+
   // Notify the |subscriber_| that it should expect at least |pending_processes|
   // additional calls to OnHistogramDataCollected().  OnPendingProcess() may be
   // called repeatedly; the last call will have |end| set to true, indicating
@@ -62,8 +82,17 @@ class HistogramController {
   // PPAPI and NACL.
   void GetHistogramDataFromChildProcesses(int sequence_number);
 
+  void MergePersistentHistograms();
+
   HistogramSubscriber* subscriber_;
 
+  // Guards |persistent_allocators_|, which is modified on the IO thread and
+  // merged on the UI thread.
+  base::Lock persistent_allocators_lock_;
+  // Owned allocators, keyed by the registering owner.
+  std::map<const void*, base::PersistentHistogramAllocator*>
+      persistent_allocators_;
+
   DISALLOW_COPY_AND_ASSIGN(HistogramController);
 };
 
@@ -6,6 +6,8 @@
 
 #include "base/command_line.h"
 #include "base/metrics/histogram.h"
+#include "base/metrics/persistent_histogram_allocator.h"
+#include "base/metrics/persistent_memory_allocator.h"
 #include "base/metrics/statistics_recorder.h"
 #include "content/browser/histogram_controller.h"
 #include "content/browser/tcmalloc_internals_request_job.h"
@@ -14,8 +16,22 @@
 
 namespace content {
 
+namespace {
+
+// Size of the shared memory given to each child for its histograms. Once it
+// is full, new histograms in the child fall back to being sent over IPC.
+const uint32 kChildHistogramMemorySize = 1 << 20;  // 1 MiB
+
+}  // namespace
+
 HistogramMessageFilter::HistogramMessageFilter()
-    : BrowserMessageFilter(ChildProcessMsgStart) {}
+    : BrowserMessageFilter(ChildProcessMsgStart),
+      allocated_histogram_memory_(false) {}
+
+void HistogramMessageFilter::OnChannelClosing() {
+  if (allocated_histogram_memory_)
+    HistogramController::GetInstance()->UnregisterPersistentAllocator(this);
+}
 
 bool HistogramMessageFilter::OnMessageReceived(const IPC::Message& message) {
   bool handled = true;
@@ -24,6 +40,8 @@ bool HistogramMessageFilter::OnMessageReceived(const IPC::Message& message) {
                         OnChildHistogramData)
     IPC_MESSAGE_HANDLER(ChildProcessHostMsg_GetBrowserHistogram,
                         OnGetBrowserHistogram)
+    IPC_MESSAGE_HANDLER(ChildProcessHostMsg_SyncAllocateHistogramMemory,
+                        OnAllocateHistogramMemory)
     IPC_MESSAGE_UNHANDLED(handled = false)
   IPC_END_MESSAGE_MAP()
   return handled;
@@ -61,4 +79,32 @@ void HistogramMessageFilter::OnGetBrowserHistogram(
   }
 }
 
+void HistogramMessageFilter::OnAllocateHistogramMemory(
+    base::SharedMemoryHandle* handle,
+    uint32* size) {
+  DCHECK(content::BrowserThread::CurrentlyOn(content::BrowserThread::IO));
+  *handle = base::SharedMemory::NULLHandle();
+  *size = 0;
+  if (allocated_histogram_memory_)
+    return;
+
+  scoped_ptr<base::SharedMemory> memory(new base::SharedMemory());
+  if (!memory->CreateAndMapAnonymous(kChildHistogramMemorySize) ||
+      !memory->ShareToProcess(PeerHandle(), handle)) {
+    *handle = base::SharedMemory::NULLHandle();
+    return;
+  }
+  *size = kChildHistogramMemorySize;
+
+  // The memory is laid out here, before the child maps it, so that the child
+  // never sees it half initialized.
+  scoped_ptr<base::PersistentMemoryAllocator> memory_allocator(
+      new base::SharedPersistentMemoryAllocator(memory.Pass(), 0,
+                                                "RendererHistograms", false));
+  HistogramController::GetInstance()->RegisterPersistentAllocator(
+      this, make_scoped_ptr(new base::PersistentHistogramAllocator(
+                memory_allocator.Pass())));
+  allocated_histogram_memory_ = true;
+}
+
 }  // namespace content
@@ -8,6 +8,7 @@
 #include <string>
 #include <vector>
 
+#include "base/memory/shared_memory.h"
 #include "content/public/browser/browser_message_filter.h"
 #include "content/public/common/process_type.h"
 
@@ -19,6 +20,7 @@ class HistogramMessageFilter : public BrowserMessageFilter {
   HistogramMessageFilter();
 
   // BrowserMessageFilter implementation.
+  void OnChannelClosing() override;
   bool OnMessageReceived(const IPC::Message& message) override;
 
  private:
@@ -29,6 +31,12 @@ class HistogramMessageFilter : public BrowserMessageFilter {
                             const std::vector<std::string>& pickled_histograms);
   void OnGetBrowserHistogram(const std::string& name,
                              std::string* histogram_json);
+  void OnAllocateHistogramMemory(base::SharedMemoryHandle* handle,
+                                 uint32* size);
+
+  // Whether the child has been given shared memory for its histograms, which
+  // is then registered with the HistogramController.
+  bool allocated_histogram_memory_;
 
   DISALLOW_COPY_AND_ASSIGN(HistogramMessageFilter);
 };
@@ -38,6 +38,9 @@ IPC_STRUCT_TRAITS_BEGIN(tracked_objects::DeathDataSnapshot)
   IPC_STRUCT_TRAITS_MEMBER(queue_duration_sum)
   IPC_STRUCT_TRAITS_MEMBER(queue_duration_max)
   IPC_STRUCT_TRAITS_MEMBER(queue_duration_sample)
+  IPC_STRUCT_TRAITS_MEMBER(alloc_bytes_sum)
+  IPC_STRUCT_TRAITS_MEMBER(alloc_bytes_max)
+  IPC_STRUCT_TRAITS_MEMBER(alloc_count_sum)
 IPC_STRUCT_TRAITS_END()
 
 IPC_STRUCT_TRAITS_BEGIN(tracked_objects::TaskSnapshot)
@@ -139,6 +142,13 @@ IPC_SYNC_MESSAGE_CONTROL1_1(ChildProcessHostMsg_GetBrowserHistogram,
                             std::string, /* histogram_name */
                             std::string /* histogram_json */)
 
+// Asks the browser for shared memory to hold the child's histograms, which the
+// browser then reads in place. The handle is invalid if the browser doesn't
+// support this.
+IPC_SYNC_MESSAGE_CONTROL0_2(ChildProcessHostMsg_SyncAllocateHistogramMemory,
+                            base::SharedMemoryHandle,
+                            uint32 /* size */)
+
 // Reply to ChildProcessMsg_DumpHandles when handle table dump is complete.
 IPC_MESSAGE_CONTROL0(ChildProcessHostMsg_DumpHandlesDone)
 
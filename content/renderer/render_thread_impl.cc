@@ -20,6 +20,7 @@
 #include "base/memory/shared_memory.h"
 #include "base/metrics/field_trial.h"
 #include "base/metrics/histogram.h"
+#include "base/metrics/persistent_histogram_allocator.h"
 #include "base/metrics/stats_table.h"
 #include "base/path_service.h"
 #include "base/single_thread_task_runner.h"
@@ -351,6 +352,34 @@ blink::WebGraphicsContext3D::Attributes GetOffscreenAttribs() {
   return attributes;
 }
 
+// Asks the browser for a segment of shared memory and records new histograms
+// there, where the browser reads them directly instead of receiving their
+// deltas over IPC. Histograms created before this, or after the segment
+// fills up, are still sent over IPC.
+void InitializePersistentHistograms(IPC::Sender* sender) {
+  // In single process mode the browser already sees this process's
+  // histograms.
+  if (base::CommandLine::ForCurrentProcess()->HasSwitch(
+          switches::kSingleProcess) ||
+      base::PersistentHistogramAllocator::GetGlobalAllocator()) {
+    return;
+  }
+
+  base::SharedMemoryHandle handle;
+  uint32 size = 0;
+  if (!sender->Send(
+          new ChildProcessHostMsg_SyncAllocateHistogramMemory(&handle, &size)) ||
+      !base::SharedMemory::IsHandleValid(handle)) {
+    return;
+  }
+  scoped_ptr<base::SharedMemory> memory(
+      new base::SharedMemory(handle, false));
+  if (!memory->Map(size))
+    return;
+  base::PersistentHistogramAllocator::CreateGlobalAllocatorOnSharedMemory(
+      memory.Pass(), "RendererHistograms");
+}
+
 }  // namespace
 
 // For measuring memory usage after each task. Behind a command line flag.
@@ -452,6 +481,8 @@ void RenderThreadImpl::Init() {
   // Register this object as the main thread.
   ChildProcess::current()->set_main_thread(this);
 
+  InitializePersistentHistograms(this);
+
   // In single process the single process is all there is.
   suspend_webkit_shared_timer_ = true;
   notify_webkit_of_modal_loop_ = true;
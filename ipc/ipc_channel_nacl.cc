@@ -280,6 +280,8 @@ bool ChannelNacl::ProcessOutgoingMessages() {
     DCHECK(num_fds <= FileDescriptorSet::kMaxDescriptorsPerMessage);
     msg->file_descriptor_set()->PeekDescriptors(fds);
 
+    // The message is sent as a single iovec.
+    msg->Flatten();
     NaClAbiNaClImcMsgIoVec iov = {
       const_cast<void*>(msg->data()), msg->size()
     };
@@ -10,11 +10,8 @@
 #include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/types.h>
-#include <unistd.h>
-
-#if defined(OS_OPENBSD)
 #include <sys/uio.h>
-#endif
+#include <unistd.h>
 
 #if !defined(OS_NACL_NONSFI)
 #include <sys/un.h>
@@ -22,6 +19,7 @@
 
 #include <map>
 #include <string>
+#include <vector>
 
 #include "base/command_line.h"
 #include "base/files/file_path.h"
@@ -164,6 +162,47 @@ bool SocketWriteErrorIsRecoverable() {
 #endif  // OS_MACOSX
 }
 
+// Most messages are written with a single iovec; messages that refer to
+// external data need one per segment. Longer messages are written in several
+// goes.
+const size_t kMaxIOVecsPerWrite = 64;
+
+// Fills |iovs|, which has room for kMaxIOVecsPerWrite entries, with the bytes
+// of |msg| from |offset| on. Sets |*num_iovs| and returns how many bytes they
+// cover. Messages that refer to external data (see
+// Pickle::WriteDataByReference()) are sent from their segments rather than
+// being copied into one buffer first.
+size_t GetIOVecs(const IPC::Message& msg,
+                 size_t offset,
+                 struct iovec* iovs,
+                 size_t* num_iovs) {
+  if (!msg.has_external_data()) {
+    iovs[0].iov_base =
+        const_cast<char*>(static_cast<const char*>(msg.data()) + offset);
+    iovs[0].iov_len = msg.size() - offset;
+    *num_iovs = 1;
+    return iovs[0].iov_len;
+  }
+
+  std::vector<Pickle::Segment> segments;
+  msg.GetSegments(&segments);
+  size_t total = 0;
+  *num_iovs = 0;
+  for (size_t i = 0;
+       i < segments.size() && *num_iovs < kMaxIOVecsPerWrite; ++i) {
+    if (offset >= segments[i].size) {
+      offset -= segments[i].size;
+      continue;
+    }
+    iovs[*num_iovs].iov_base = const_cast<char*>(segments[i].data + offset);
+    iovs[*num_iovs].iov_len = segments[i].size - offset;
+    total += iovs[*num_iovs].iov_len;
+    ++*num_iovs;
+    offset = 0;
+  }
+  return total;
+}
+
 }  // namespace
 
 #if defined(OS_ANDROID)
@@ -419,15 +458,15 @@ bool ChannelPosix::ProcessOutgoingMessages() {
   while (!output_queue_.empty()) {
     Message* msg = output_queue_.front();
 
-    size_t amt_to_write = msg->size() - message_send_bytes_written_;
+    struct iovec iovs[kMaxIOVecsPerWrite];
+    size_t num_iovs = 0;
+    size_t amt_to_write =
+        GetIOVecs(*msg, message_send_bytes_written_, iovs, &num_iovs);
     DCHECK_NE(0U, amt_to_write);
-    const char* out_bytes = reinterpret_cast<const char*>(msg->data()) +
-        message_send_bytes_written_;
 
     struct msghdr msgh = {0};
-    struct iovec iov = {const_cast<char*>(out_bytes), amt_to_write};
-    msgh.msg_iov = &iov;
-    msgh.msg_iovlen = 1;
+    msgh.msg_iov = iovs;
+    msgh.msg_iovlen = num_iovs;
     char buf[CMSG_SPACE(
         sizeof(int) * FileDescriptorSet::kMaxDescriptorsPerMessage)];
 
@@ -475,7 +514,7 @@ bool ChannelPosix::ProcessOutgoingMessages() {
         fd_written = fd_pipe_.get();
         bytes_written =
             HANDLE_EINTR(sendmsg(fd_pipe_.get(), &msgh, MSG_DONTWAIT));
-        msgh.msg_iov = &iov;
+        msgh.msg_iov = iovs;
         msgh.msg_controllen = 0;
         if (bytes_written > 0) {
           CloseFileDescriptors(msg);
@@ -491,8 +530,8 @@ bool ChannelPosix::ProcessOutgoingMessages() {
         DCHECK_EQ(msg->file_descriptor_set()->size(), 1U);
       }
       if (!msgh.msg_controllen) {
-        bytes_written =
-            HANDLE_EINTR(write(pipe_.get(), out_bytes, amt_to_write));
+        bytes_written = HANDLE_EINTR(
+            writev(pipe_.get(), msgh.msg_iov, msgh.msg_iovlen));
       } else
 #endif  // IPC_USES_READWRITE
       {
@@ -540,6 +579,9 @@ bool ChannelPosix::ProcessOutgoingMessages() {
           &write_watcher_,
           this);
       return true;
+    } else if (message_send_bytes_written_ + amt_to_write < msg->size()) {
+      // The message has more segments than fit in one write.
+      message_send_bytes_written_ += amt_to_write;
     } else {
       message_send_bytes_written_ = 0;
 
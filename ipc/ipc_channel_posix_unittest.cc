@@ -14,6 +14,7 @@
 #include "base/basictypes.h"
 #include "base/files/file_path.h"
 #include "base/files/file_util.h"
+#include "base/memory/ref_counted_memory.h"
 #include "base/memory/scoped_ptr.h"
 #include "base/message_loop/message_loop.h"
 #include "base/path_service.h"
@@ -50,6 +51,7 @@ class IPCChannelPosixTestListener : public IPC::Listener {
   bool OnMessageReceived(const IPC::Message& message) override {
     EXPECT_EQ(message.type(), kQuitMessage);
     status_ = MESSAGE_RECEIVED;
+    last_message_.reset(new IPC::Message(message));
     QuitRunLoop();
     return true;
   }
@@ -81,6 +83,7 @@ class IPCChannelPosixTestListener : public IPC::Listener {
   }
 
   STATUS status() { return status_; }
+  const IPC::Message* last_message() { return last_message_.get(); }
 
   void QuitRunLoop() {
     base::MessageLoopForIO* loop = base::MessageLoopForIO::current();
@@ -98,6 +101,7 @@ class IPCChannelPosixTestListener : public IPC::Listener {
   // If |quit_only_on_message_| then the listener will only break out of
   // the run loop when kQuitMessage is received.
   bool quit_only_on_message_;
+  scoped_ptr<IPC::Message> last_message_;
 };
 
 class IPCChannelPosixTest : public base::MultiProcessTest {
@@ -265,6 +269,47 @@ TEST_F(IPCChannelPosixTest, SendHangTest) {
 // If a connection closes right before a Connect() call, we may end up closing
 // the connection without notifying the listener, which can cause hangs in
 // sync_message_filter and others. Make sure the listener is notified.
+// Messages that refer to external data are sent without being flattened.
+TEST_F(IPCChannelPosixTest, SendExternalData) {
+  IPCChannelPosixTestListener out_listener(true);
+  IPCChannelPosixTestListener in_listener(true);
+  IPC::ChannelHandle in_handle("IN");
+  scoped_ptr<IPC::ChannelPosix> in_chan(new IPC::ChannelPosix(
+      in_handle, IPC::Channel::MODE_SERVER, &in_listener));
+  IPC::ChannelHandle out_handle(
+      "OUT", base::FileDescriptor(in_chan->TakeClientFileDescriptor()));
+  scoped_ptr<IPC::ChannelPosix> out_chan(new IPC::ChannelPosix(
+      out_handle, IPC::Channel::MODE_CLIENT, &out_listener));
+  ASSERT_TRUE(in_chan->Connect());
+  ASSERT_TRUE(out_chan->Connect());
+
+  // Larger than the socket buffer, so that it takes several writes.
+  scoped_refptr<base::RefCountedString> data(new base::RefCountedString);
+  for (int i = 0; i < 1 << 20; ++i)
+    data->data().push_back(static_cast<char>(i % 251));
+  IPC::Message* message = new IPC::Message(
+      0, kQuitMessage, IPC::Message::PRIORITY_NORMAL);
+  EXPECT_TRUE(message->WriteInt(1));
+  EXPECT_TRUE(message->WriteDataByReference(data));
+  EXPECT_TRUE(message->WriteInt(2));
+  ASSERT_TRUE(message->has_external_data());
+  ASSERT_TRUE(out_chan->Send(message));
+  SpinRunLoop(TestTimeouts::action_max_timeout());
+  ASSERT_EQ(IPCChannelPosixTestListener::MESSAGE_RECEIVED,
+            in_listener.status());
+
+  PickleIterator iter(*in_listener.last_message());
+  int value;
+  const char* received_data;
+  int received_length;
+  EXPECT_TRUE(iter.ReadInt(&value));
+  EXPECT_EQ(1, value);
+  ASSERT_TRUE(iter.ReadData(&received_data, &received_length));
+  EXPECT_EQ(data->data(), std::string(received_data, received_length));
+  EXPECT_TRUE(iter.ReadInt(&value));
+  EXPECT_EQ(2, value);
+}
+
 TEST_F(IPCChannelPosixTest, AcceptHangTest) {
   IPCChannelPosixTestListener out_listener(true);
   IPCChannelPosixTestListener in_listener(true);
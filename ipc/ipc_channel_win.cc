@@ -393,6 +393,8 @@ bool ChannelWin::ProcessOutgoingMessages(
 
   // Write to pipe...
   Message* m = output_queue_.front();
+  // WriteFile() takes a single buffer.
+  m->Flatten();
   DCHECK(m->size() <= INT_MAX);
   BOOL ok = WriteFile(pipe_.Get(),
                       m->data(),
@@ -49,6 +49,8 @@ bool MessagePipeReader::Send(scoped_ptr<Message> message) {
   result = ChannelMojo::ReadFromFileDescriptorSet(message.get(), &handles);
 #endif
   if (result == MOJO_RESULT_OK) {
+    // MojoWriteMessage() takes a single buffer.
+    message->Flatten();
     result = MojoWriteMessage(handle(),
                               message->data(),
                               static_cast<uint32>(message->size()),
@@ -9,20 +9,31 @@
 namespace net {
 
 IOBuffer::IOBuffer()
-    : data_(NULL) {
+    : data_(NULL),
+      allocation_size_(-1) {
 }
 
-IOBuffer::IOBuffer(int buffer_size) {
+IOBuffer::IOBuffer(int buffer_size)
+    : allocation_size_(-1) {
   CHECK_GE(buffer_size, 0);
-  data_ = new char[buffer_size];
+  if (base::SlabAllocator::FillsSizeClass(buffer_size)) {
+    allocation_size_ = buffer_size;
+    data_ = static_cast<char*>(base::SlabAllocator::Allocate(buffer_size));
+  } else {
+    data_ = new char[buffer_size];
+  }
 }
 
 IOBuffer::IOBuffer(char* data)
-    : data_(data) {
+    : data_(data),
+      allocation_size_(-1) {
 }
 
 IOBuffer::~IOBuffer() {
-  delete[] data_;
+  if (allocation_size_ >= 0)
+    base::SlabAllocator::Free(data_, allocation_size_);
+  else
+    delete[] data_;
   data_ = NULL;
 }
 
@@ -9,6 +9,7 @@
 
 #include "base/memory/ref_counted.h"
 #include "base/memory/scoped_ptr.h"
+#include "base/memory/slab_allocator.h"
 #include "base/pickle.h"
 #include "net/base/net_export.h"
 
@@ -70,7 +71,13 @@ namespace net {
 // and hence the buffer it was reading into must remain alive. Using
 // reference counting we can add a reference to the IOBuffer and make sure
 // it is not destroyed until after the synchronous operation has completed.
-class NET_EXPORT IOBuffer : public base::RefCountedThreadSafe<IOBuffer> {
+//
+// IOBuffers come from base::SlabAllocator, since sockets create and release
+// them for almost every read and write. So do the buffers of IOBuffer(int)
+// whose size fills a size class, such as the usual 4 KB and 32 KB reads;
+// other sizes come from the heap rather than waste the rounding.
+class NET_EXPORT IOBuffer : public base::RefCountedThreadSafe<IOBuffer>,
+                            public base::SlabAllocated<IOBuffer> {
  public:
   IOBuffer();
   explicit IOBuffer(int buffer_size);
@@ -87,6 +94,11 @@ class NET_EXPORT IOBuffer : public base::RefCountedThreadSafe<IOBuffer> {
   virtual ~IOBuffer();
 
   char* data_;
+
+ private:
+  // The size data_ was allocated from base::SlabAllocator with, or -1 if
+  // data_ is owned some other way.
+  int allocation_size_;
 };
 
 // This version stores the size of the buffer so that the creator of the object
@@ -357,6 +357,8 @@ void SimpleIndexFile::SyncLoadFromDisk(const base::FilePath& index_filename,
     simple_util::SimpleCacheDeleteFile(index_filename);
     return;
   }
+  // Deserialize() reads the whole index once, front to back.
+  index_file_map.Advise(base::MemoryMappedFile::ADVICE_SEQUENTIAL);
 
   SimpleIndexFile::Deserialize(
       reinterpret_cast<const char*>(index_file_map.data()),
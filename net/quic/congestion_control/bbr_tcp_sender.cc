@@ -0,0 +1,477 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/quic/congestion_control/bbr_tcp_sender.h"
+
+#include <algorithm>
+
+#include "base/logging.h"
+#include "net/quic/congestion_control/rtt_stats.h"
+#include "net/quic/crypto/crypto_protocol.h"
+#include "net/quic/crypto/quic_random.h"
+
+using std::max;
+using std::min;
+
+namespace net {
+
+namespace {
+const QuicByteCount kMaxSegmentSize = kDefaultTCPMSS;
+// The window PROBE_RTT drains to, and the smallest window otherwise.
+const QuicByteCount kMinimumCongestionWindow = 4 * kMaxSegmentSize;
+// 2/ln(2), the smallest gain that doubles the delivery rate every round trip.
+const float kHighGain = 2.885f;
+const float kDrainGain = 1 / kHighGain;
+// The PROBE_BW pacing gains. One round trip probes for more bandwidth, the
+// next drains the queue that built, and the rest cruise at the estimate.
+const float kPacingGainCycle[] = {1.25f, 0.75f, 1, 1, 1, 1, 1, 1};
+const int kGainCycleLength = arraysize(kPacingGainCycle);
+// Leaves room in the window for delayed and aggregated acks.
+const float kCongestionWindowGain = 2;
+// STARTUP ends when the bandwidth grows by less than this for
+// kRoundTripsWithoutGrowthBeforeExitingStartup round trips.
+const float kStartupGrowthTarget = 1.25f;
+const int kRoundTripsWithoutGrowthBeforeExitingStartup = 3;
+const int64 kMinRttExpirySeconds = 10;
+const int64 kProbeRttTimeMs = 200;
+}  // namespace
+
+BbrTcpSender::SendState::SendState()
+    : sent_time(QuicTime::Zero()),
+      delivered(0),
+      delivered_time(QuicTime::Zero()),
+      first_sent_time(QuicTime::Zero()) {}
+
+BbrTcpSender::SendState::SendState(QuicTime sent_time,
+                                   QuicByteCount delivered,
+                                   QuicTime delivered_time,
+                                   QuicTime first_sent_time)
+    : sent_time(sent_time),
+      delivered(delivered),
+      delivered_time(delivered_time),
+      first_sent_time(first_sent_time) {}
+
+BbrTcpSender::BbrTcpSender(const QuicClock* clock,
+                           const RttStats* rtt_stats,
+                           QuicPacketCount initial_tcp_congestion_window,
+                           QuicPacketCount max_tcp_congestion_window,
+                           QuicConnectionStats* stats)
+    : clock_(clock),
+      rtt_stats_(rtt_stats),
+      stats_(stats),
+      mode_(STARTUP),
+      delivered_(0),
+      delivered_time_(QuicTime::Zero()),
+      first_sent_time_(QuicTime::Zero()),
+      round_trip_count_(0),
+      next_round_delivered_(0),
+      round_start_(false),
+      max_bandwidth_(kBandwidthWindowSize, QuicBandwidth::Zero()),
+      min_rtt_(QuicTime::Delta::Zero()),
+      min_rtt_timestamp_(QuicTime::Zero()),
+      pacing_gain_(kHighGain),
+      congestion_window_gain_(kHighGain),
+      is_at_full_bandwidth_(false),
+      full_bandwidth_(QuicBandwidth::Zero()),
+      rounds_without_bandwidth_gain_(0),
+      cycle_index_(0),
+      cycle_start_(QuicTime::Zero()),
+      probe_rtt_done_time_(QuicTime::Zero()),
+      probe_rtt_round_done_(false),
+      congestion_window_(initial_tcp_congestion_window * kMaxSegmentSize),
+      initial_congestion_window_(initial_tcp_congestion_window *
+                                 kMaxSegmentSize),
+      max_congestion_window_(max_tcp_congestion_window * kMaxSegmentSize),
+      previous_congestion_window_(0) {}
+
+BbrTcpSender::~BbrTcpSender() {}
+
+void BbrTcpSender::SetFromConfig(const QuicConfig& config,
+                                 bool is_server,
+                                 bool /*using_pacing*/) {
+  if (is_server && config.HasReceivedConnectionOptions() &&
+      ContainsQuicTag(config.ReceivedConnectionOptions(), kIW10)) {
+    // Initial window experiment.
+    congestion_window_ = 10 * kMaxSegmentSize;
+  }
+}
+
+bool BbrTcpSender::ResumeConnectionState(
+    const CachedNetworkParameters& cached_network_params) {
+  // If the previous bandwidth estimate is less than an hour old, store in
+  // preparation for doing bandwidth resumption.
+  int64 seconds_since_estimate =
+      clock_->WallNow().ToUNIXSeconds() - cached_network_params.timestamp();
+  if (seconds_since_estimate > kNumSecondsPerHour) {
+    return false;
+  }
+
+  QuicBandwidth bandwidth = QuicBandwidth::FromBytesPerSecond(
+      cached_network_params.bandwidth_estimate_bytes_per_second());
+  QuicTime::Delta rtt_ms =
+      QuicTime::Delta::FromMilliseconds(cached_network_params.min_rtt_ms());
+
+  // Make sure CWND is in appropriate range (in case of bad data).
+  congestion_window_ =
+      max(min(bandwidth.ToBytesPerPeriod(rtt_ms), max_congestion_window_),
+          kMinCongestionWindowForBandwidthResumption * kMaxSegmentSize);
+  return true;
+}
+
+void BbrTcpSender::SetNumEmulatedConnections(int /*num_connections*/) {
+  // The model of the path does not depend on the number of connections.
+}
+
+void BbrTcpSender::OnCongestionEvent(bool rtt_updated,
+                                     QuicByteCount bytes_in_flight,
+                                     const CongestionVector& acked_packets,
+                                     const CongestionVector& lost_packets) {
+  const QuicTime now = clock_->ApproximateNow();
+  QuicByteCount bytes_acked = 0;
+  QuicByteCount bytes_lost = 0;
+  round_start_ = false;
+
+  // Loss does not change the model; the delivery rate samples already account
+  // for it.
+  for (CongestionVector::const_iterator it = lost_packets.begin();
+       it != lost_packets.end(); ++it) {
+    send_states_.erase(it->first);
+    bytes_lost += it->second.bytes_sent;
+  }
+  if (InSlowStart()) {
+    stats_->slowstart_packets_lost += lost_packets.size();
+  }
+  for (CongestionVector::const_iterator it = acked_packets.begin();
+       it != acked_packets.end(); ++it) {
+    OnPacketAcked(it->first, it->second.bytes_sent, now);
+    bytes_acked += it->second.bytes_sent;
+  }
+  if (bytes_acked > 0) {
+    // As soon as a packet is acked, ensure we're no longer in RTO mode.
+    previous_congestion_window_ = 0;
+  }
+
+  const bool min_rtt_expired = rtt_updated && UpdateMinRtt(now);
+  if (round_start_ && !is_at_full_bandwidth_) {
+    CheckFullBandwidthReached();
+  }
+  const QuicByteCount bytes_in_flight_after_event =
+      bytes_in_flight - min(bytes_in_flight, bytes_acked + bytes_lost);
+  UpdateMode(now, bytes_in_flight, bytes_in_flight_after_event, bytes_lost > 0,
+             min_rtt_expired);
+  UpdateCongestionWindow(bytes_acked);
+}
+
+bool BbrTcpSender::OnPacketAcked(QuicPacketSequenceNumber sequence_number,
+                                 QuicByteCount acked_bytes,
+                                 QuicTime ack_time) {
+  delivered_ += acked_bytes;
+  delivered_time_ = ack_time;
+
+  SendStateMap::iterator it = send_states_.find(sequence_number);
+  if (it == send_states_.end()) {
+    // The packet's send state was dropped by an RTO. Its bytes still count
+    // towards |delivered_|, so later samples and round trips stay accurate,
+    // but it yields no sample of its own.
+    return false;
+  }
+  const SendState state = it->second;
+  send_states_.erase(it);
+  first_sent_time_ = state.sent_time;
+
+  // A round trip ends when a packet sent after it started is acked.
+  if (state.delivered >= next_round_delivered_) {
+    next_round_delivered_ = delivered_;
+    ++round_trip_count_;
+    round_start_ = true;
+    max_bandwidth_[round_trip_count_ % kBandwidthWindowSize] =
+        QuicBandwidth::Zero();
+  }
+
+  // The delivery rate can not exceed the rate the packets were sent at, so
+  // the longer of the send and ack intervals filters out ack compression.
+  const QuicTime::Delta send_interval =
+      state.sent_time.Subtract(state.first_sent_time);
+  const QuicTime::Delta ack_interval =
+      ack_time.Subtract(state.delivered_time);
+  const QuicTime::Delta interval =
+      QuicTime::Delta::Max(send_interval, ack_interval);
+  if (interval.IsZero()) {
+    return true;
+  }
+  UpdateMaxBandwidth(QuicBandwidth::FromBytesAndTimeDelta(
+      delivered_ - state.delivered, interval));
+  return true;
+}
+
+void BbrTcpSender::UpdateMaxBandwidth(QuicBandwidth bandwidth) {
+  QuicBandwidth& round_max =
+      max_bandwidth_[round_trip_count_ % kBandwidthWindowSize];
+  round_max = max(round_max, bandwidth);
+}
+
+void BbrTcpSender::CheckFullBandwidthReached() {
+  const QuicBandwidth bandwidth = BandwidthEstimate();
+  if (bandwidth >= full_bandwidth_.Scale(kStartupGrowthTarget)) {
+    full_bandwidth_ = bandwidth;
+    rounds_without_bandwidth_gain_ = 0;
+    return;
+  }
+  if (++rounds_without_bandwidth_gain_ >=
+      kRoundTripsWithoutGrowthBeforeExitingStartup) {
+    is_at_full_bandwidth_ = true;
+  }
+}
+
+bool BbrTcpSender::UpdateMinRtt(QuicTime now) {
+  const QuicTime::Delta sample_rtt = rtt_stats_->latest_rtt();
+  if (sample_rtt.IsZero()) {
+    return false;
+  }
+  const bool expired =
+      !min_rtt_.IsZero() &&
+      now > min_rtt_timestamp_.Add(
+                QuicTime::Delta::FromSeconds(kMinRttExpirySeconds));
+  if (min_rtt_.IsZero() || sample_rtt <= min_rtt_ || expired) {
+    min_rtt_ = sample_rtt;
+    min_rtt_timestamp_ = now;
+  }
+  return expired;
+}
+
+void BbrTcpSender::UpdateMode(QuicTime now,
+                              QuicByteCount prior_in_flight,
+                              QuicByteCount bytes_in_flight,
+                              bool has_losses,
+                              bool min_rtt_expired) {
+  if (mode_ == STARTUP && is_at_full_bandwidth_) {
+    DVLOG(1) << "Leaving STARTUP at bandwidth "
+             << full_bandwidth_.ToKBitsPerSecond() << " kbps";
+    mode_ = DRAIN;
+    pacing_gain_ = kDrainGain;
+    congestion_window_gain_ = kHighGain;
+  }
+  if (mode_ == DRAIN &&
+      bytes_in_flight <= GetTargetCongestionWindow(1)) {
+    EnterProbeBandwidth(now);
+  }
+
+  if (mode_ == PROBE_BW) {
+    bool advance_cycle = now.Subtract(cycle_start_) > GetMinRtt();
+    if (pacing_gain_ > 1) {
+      // Probe until the queue has had a chance to build or packets are lost.
+      advance_cycle = advance_cycle &&
+          (has_losses ||
+           prior_in_flight >= GetTargetCongestionWindow(pacing_gain_));
+    } else if (pacing_gain_ < 1) {
+      // Stop draining once the queue is gone.
+      advance_cycle = advance_cycle ||
+          bytes_in_flight <= GetTargetCongestionWindow(1);
+    }
+    if (advance_cycle) {
+      cycle_index_ = (cycle_index_ + 1) % kGainCycleLength;
+      cycle_start_ = now;
+      pacing_gain_ = kPacingGainCycle[cycle_index_];
+    }
+  }
+
+  if (min_rtt_expired && mode_ != PROBE_RTT) {
+    EnterProbeRtt();
+  }
+  if (mode_ != PROBE_RTT) {
+    return;
+  }
+  if (!probe_rtt_done_time_.IsInitialized()) {
+    // Hold the window at its minimum for a round trip and kProbeRttTimeMs
+    // once the queue has drained.
+    if (bytes_in_flight <= kMinimumCongestionWindow) {
+      probe_rtt_done_time_ =
+          now.Add(QuicTime::Delta::FromMilliseconds(kProbeRttTimeMs));
+      probe_rtt_round_done_ = false;
+      next_round_delivered_ = delivered_;
+    }
+    return;
+  }
+  if (round_start_) {
+    probe_rtt_round_done_ = true;
+  }
+  if (probe_rtt_round_done_ && now >= probe_rtt_done_time_) {
+    min_rtt_timestamp_ = now;
+    if (is_at_full_bandwidth_) {
+      EnterProbeBandwidth(now);
+    } else {
+      mode_ = STARTUP;
+      pacing_gain_ = kHighGain;
+      congestion_window_gain_ = kHighGain;
+    }
+  }
+}
+
+void BbrTcpSender::UpdateCongestionWindow(QuicByteCount bytes_acked) {
+  if (bytes_acked == 0) {
+    return;
+  }
+  const QuicByteCount target_window =
+      GetTargetCongestionWindow(congestion_window_gain_);
+  if (is_at_full_bandwidth_) {
+    congestion_window_ = min(congestion_window_ + bytes_acked, target_window);
+  } else if (congestion_window_ < target_window ||
+             delivered_ < initial_congestion_window_) {
+    // Grow like slow start until the model has a bandwidth estimate.
+    congestion_window_ += bytes_acked;
+  }
+  congestion_window_ = max(congestion_window_, kMinimumCongestionWindow);
+  congestion_window_ = min(congestion_window_, max_congestion_window_);
+}
+
+void BbrTcpSender::EnterProbeBandwidth(QuicTime now) {
+  mode_ = PROBE_BW;
+  congestion_window_gain_ = kCongestionWindowGain;
+  // Start anywhere but the draining phase, so that flows sharing a
+  // bottleneck do not probe in lockstep.
+  cycle_index_ = QuicRandom::GetInstance()->RandUint64() %
+      (kGainCycleLength - 1);
+  if (cycle_index_ >= 1) {
+    ++cycle_index_;
+  }
+  cycle_start_ = now;
+  pacing_gain_ = kPacingGainCycle[cycle_index_];
+}
+
+void BbrTcpSender::EnterProbeRtt() {
+  DVLOG(1) << "Entering PROBE_RTT, min rtt "
+           << min_rtt_.ToMilliseconds() << " ms expired";
+  mode_ = PROBE_RTT;
+  pacing_gain_ = 1;
+  probe_rtt_done_time_ = QuicTime::Zero();
+}
+
+bool BbrTcpSender::OnPacketSent(QuicTime sent_time,
+                                QuicByteCount bytes_in_flight,
+                                QuicPacketSequenceNumber sequence_number,
+                                QuicByteCount /*bytes*/,
+                                HasRetransmittableData is_retransmittable) {
+  // Only data packets count towards bytes in flight.
+  if (is_retransmittable != HAS_RETRANSMITTABLE_DATA) {
+    return false;
+  }
+  if (bytes_in_flight == 0) {
+    // Restarting after quiescence; the idle time is not part of any delivery
+    // interval.
+    delivered_time_ = sent_time;
+    first_sent_time_ = sent_time;
+  }
+  send_states_.insert(std::make_pair(
+      sequence_number,
+      SendState(sent_time, delivered_, delivered_time_, first_sent_time_)));
+  return true;
+}
+
+void BbrTcpSender::OnRetransmissionTimeout(bool packets_retransmitted) {
+  if (!packets_retransmitted) {
+    return;
+  }
+  // The retransmitted packets are no longer in flight, so they may never be
+  // acked or lost. Their delivery rate samples are abandoned rather than kept
+  // forever, though acks of them still count as delivered.
+  send_states_.clear();
+  // Only reduce the window once over multiple retransmissions.
+  if (previous_congestion_window_ != 0) {
+    return;
+  }
+  previous_congestion_window_ = congestion_window_;
+  congestion_window_ = kMinimumCongestionWindow;
+}
+
+void BbrTcpSender::RevertRetransmissionTimeout() {
+  if (previous_congestion_window_ == 0) {
+    LOG(DFATAL) << "No previous congestion window to revert to.";
+    return;
+  }
+  congestion_window_ = previous_congestion_window_;
+  previous_congestion_window_ = 0;
+}
+
+QuicTime::Delta BbrTcpSender::TimeUntilSend(
+    QuicTime /* now */,
+    QuicByteCount bytes_in_flight,
+    HasRetransmittableData has_retransmittable_data) const {
+  if (has_retransmittable_data == NO_RETRANSMITTABLE_DATA) {
+    // For TCP we can always send an ACK immediately.
+    return QuicTime::Delta::Zero();
+  }
+  if (GetCongestionWindow() > bytes_in_flight) {
+    return QuicTime::Delta::Zero();
+  }
+  return QuicTime::Delta::Infinite();
+}
+
+QuicBandwidth BbrTcpSender::PacingRate() const {
+  const QuicBandwidth bandwidth = BandwidthEstimate();
+  if (bandwidth.IsZero()) {
+    // Before the first delivery rate sample, pace the initial window over the
+    // initial RTT.
+    return QuicBandwidth::FromBytesAndTimeDelta(initial_congestion_window_,
+                                                GetMinRtt()).Scale(kHighGain);
+  }
+  return bandwidth.Scale(pacing_gain_);
+}
+
+QuicBandwidth BbrTcpSender::BandwidthEstimate() const {
+  return *std::max_element(max_bandwidth_.begin(), max_bandwidth_.end());
+}
+
+bool BbrTcpSender::HasReliableBandwidthEstimate() const {
+  return is_at_full_bandwidth_;
+}
+
+QuicTime::Delta BbrTcpSender::RetransmissionDelay() const {
+  if (rtt_stats_->smoothed_rtt().IsZero()) {
+    return QuicTime::Delta::Zero();
+  }
+  return rtt_stats_->smoothed_rtt().Add(
+      rtt_stats_->mean_deviation().Multiply(4));
+}
+
+QuicByteCount BbrTcpSender::GetCongestionWindow() const {
+  if (mode_ == PROBE_RTT) {
+    return min(congestion_window_, kMinimumCongestionWindow);
+  }
+  return congestion_window_;
+}
+
+bool BbrTcpSender::InSlowStart() const {
+  return mode_ == STARTUP;
+}
+
+bool BbrTcpSender::InRecovery() const {
+  return false;
+}
+
+QuicByteCount BbrTcpSender::GetSlowStartThreshold() const {
+  return 0;
+}
+
+CongestionControlType BbrTcpSender::GetCongestionControlType() const {
+  return kBBR;
+}
+
+QuicByteCount BbrTcpSender::GetTargetCongestionWindow(float gain) const {
+  const QuicBandwidth bandwidth = BandwidthEstimate();
+  if (bandwidth.IsZero() || min_rtt_.IsZero()) {
+    return initial_congestion_window_;
+  }
+  return max(static_cast<QuicByteCount>(
+                 gain * bandwidth.ToBytesPerPeriod(min_rtt_)),
+             kMinimumCongestionWindow);
+}
+
+QuicTime::Delta BbrTcpSender::GetMinRtt() const {
+  if (!min_rtt_.IsZero()) {
+    return min_rtt_;
+  }
+  return QuicTime::Delta::FromMicroseconds(rtt_stats_->initial_rtt_us());
+}
+
+}  // namespace net
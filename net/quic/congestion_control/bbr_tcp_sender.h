@@ -0,0 +1,205 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// BBR (Bottleneck Bandwidth and RTT) send side congestion algorithm. Instead
+// of reacting to loss, it builds a model of the path from the delivery rate
+// and the minimum RTT, and paces at the estimated bottleneck bandwidth with a
+// congestion window of a small multiple of the bandwidth-delay product.
+
+#ifndef NET_QUIC_CONGESTION_CONTROL_BBR_TCP_SENDER_H_
+#define NET_QUIC_CONGESTION_CONTROL_BBR_TCP_SENDER_H_
+
+#include <map>
+#include <vector>
+
+#include "base/basictypes.h"
+#include "net/base/net_export.h"
+#include "net/quic/congestion_control/send_algorithm_interface.h"
+#include "net/quic/crypto/cached_network_parameters.h"
+#include "net/quic/quic_bandwidth.h"
+#include "net/quic/quic_connection_stats.h"
+#include "net/quic/quic_protocol.h"
+#include "net/quic/quic_time.h"
+
+namespace net {
+
+class RttStats;
+
+namespace test {
+class BbrTcpSenderPeer;
+}  // namespace test
+
+class NET_EXPORT_PRIVATE BbrTcpSender : public SendAlgorithmInterface {
+ public:
+  enum Mode {
+    // Grows the sending rate exponentially until the bandwidth stops growing.
+    STARTUP,
+    // Drains the queue built during STARTUP.
+    DRAIN,
+    // Cycles the pacing gain around 1 to probe for more bandwidth and then
+    // drain the queue the probe built.
+    PROBE_BW,
+    // Shrinks the window to a few packets to measure a new min RTT.
+    PROBE_RTT,
+  };
+
+  BbrTcpSender(const QuicClock* clock,
+               const RttStats* rtt_stats,
+               QuicPacketCount initial_tcp_congestion_window,
+               QuicPacketCount max_tcp_congestion_window,
+               QuicConnectionStats* stats);
+  ~BbrTcpSender() override;
+
+  // Start implementation of SendAlgorithmInterface.
+  void SetFromConfig(const QuicConfig& config,
+                     bool is_server,
+                     bool using_pacing) override;
+  bool ResumeConnectionState(
+      const CachedNetworkParameters& cached_network_params) override;
+  void SetNumEmulatedConnections(int num_connections) override;
+  void OnCongestionEvent(bool rtt_updated,
+                         QuicByteCount bytes_in_flight,
+                         const CongestionVector& acked_packets,
+                         const CongestionVector& lost_packets) override;
+  bool OnPacketSent(QuicTime sent_time,
+                    QuicByteCount bytes_in_flight,
+                    QuicPacketSequenceNumber sequence_number,
+                    QuicByteCount bytes,
+                    HasRetransmittableData is_retransmittable) override;
+  void OnRetransmissionTimeout(bool packets_retransmitted) override;
+  void RevertRetransmissionTimeout() override;
+  QuicTime::Delta TimeUntilSend(
+      QuicTime now,
+      QuicByteCount bytes_in_flight,
+      HasRetransmittableData has_retransmittable_data) const override;
+  QuicBandwidth PacingRate() const override;
+  QuicBandwidth BandwidthEstimate() const override;
+  bool HasReliableBandwidthEstimate() const override;
+  QuicTime::Delta RetransmissionDelay() const override;
+  QuicByteCount GetCongestionWindow() const override;
+  bool InSlowStart() const override;
+  bool InRecovery() const override;
+  QuicByteCount GetSlowStartThreshold() const override;
+  CongestionControlType GetCongestionControlType() const override;
+  // End implementation of SendAlgorithmInterface.
+
+  Mode mode() const { return mode_; }
+
+ private:
+  friend class test::BbrTcpSenderPeer;
+
+  // The state of the connection when a packet was sent, from which its ack
+  // yields a delivery rate sample.
+  struct SendState {
+    SendState();
+    SendState(QuicTime sent_time,
+              QuicByteCount delivered,
+              QuicTime delivered_time,
+              QuicTime first_sent_time);
+
+    QuicTime sent_time;
+    // Bytes acked before the packet was sent.
+    QuicByteCount delivered;
+    // The time |delivered| was reached.
+    QuicTime delivered_time;
+    // The send time of the packet whose ack reached |delivered|.
+    QuicTime first_sent_time;
+  };
+
+  typedef std::map<QuicPacketSequenceNumber, SendState> SendStateMap;
+
+  // Number of round trips the max bandwidth filter spans.
+  static const size_t kBandwidthWindowSize = 10;
+
+  // Updates the delivery counters for an acked packet and records the
+  // delivery rate sample it yields. Returns false if the packet was not
+  // tracked, in which case it is counted as delivered but yields no sample.
+  bool OnPacketAcked(QuicPacketSequenceNumber sequence_number,
+                     QuicByteCount acked_bytes,
+                     QuicTime ack_time);
+
+  // Adds |bandwidth| to the max filter for the current round trip.
+  void UpdateMaxBandwidth(QuicBandwidth bandwidth);
+
+  // Leaves STARTUP once the bandwidth has not grown by a quarter for three
+  // round trips.
+  void CheckFullBandwidthReached();
+
+  // Updates the min RTT from the latest sample. Returns true if the min RTT
+  // had not been updated for kMinRttExpiry, so PROBE_RTT should start.
+  bool UpdateMinRtt(QuicTime now);
+  void UpdateMode(QuicTime now,
+                  QuicByteCount prior_in_flight,
+                  QuicByteCount bytes_in_flight,
+                  bool has_losses,
+                  bool min_rtt_expired);
+  void UpdateCongestionWindow(QuicByteCount bytes_acked);
+
+  void EnterProbeBandwidth(QuicTime now);
+  void EnterProbeRtt();
+
+  // Returns the bandwidth-delay product scaled by |gain|, or the initial
+  // window if there is no bandwidth or RTT estimate yet.
+  QuicByteCount GetTargetCongestionWindow(float gain) const;
+
+  // The min RTT the model uses, falling back on the initial RTT.
+  QuicTime::Delta GetMinRtt() const;
+
+  const QuicClock* clock_;
+  const RttStats* rtt_stats_;
+  QuicConnectionStats* stats_;
+
+  Mode mode_;
+
+  SendStateMap send_states_;
+
+  // Total bytes acked, and the time and the send time of the packet whose ack
+  // last increased it.
+  QuicByteCount delivered_;
+  QuicTime delivered_time_;
+  QuicTime first_sent_time_;
+
+  // Round trips are counted in acks of packets sent after the round started.
+  QuicPacketCount round_trip_count_;
+  QuicByteCount next_round_delivered_;
+  bool round_start_;
+
+  // The max delivery rate of each of the last kBandwidthWindowSize round trips,
+  // indexed by round trip count.
+  std::vector<QuicBandwidth> max_bandwidth_;
+
+  QuicTime::Delta min_rtt_;
+  QuicTime min_rtt_timestamp_;
+
+  float pacing_gain_;
+  float congestion_window_gain_;
+
+  // Full bandwidth detection, which ends STARTUP.
+  bool is_at_full_bandwidth_;
+  QuicBandwidth full_bandwidth_;
+  int rounds_without_bandwidth_gain_;
+
+  // Position in and start of the PROBE_BW gain cycle.
+  int cycle_index_;
+  QuicTime cycle_start_;
+
+  // When PROBE_RTT ends, or Zero() until the window has drained.
+  QuicTime probe_rtt_done_time_;
+  bool probe_rtt_round_done_;
+
+  // Congestion window in bytes. PROBE_RTT caps the window without changing
+  // it, so it is restored when PROBE_RTT ends.
+  QuicByteCount congestion_window_;
+  const QuicByteCount initial_congestion_window_;
+  const QuicByteCount max_congestion_window_;
+  // Congestion window before the last RTO, or 0 if there was none since the
+  // last ack.
+  QuicByteCount previous_congestion_window_;
+
+  DISALLOW_COPY_AND_ASSIGN(BbrTcpSender);
+};
+
+}  // namespace net
+
+#endif  // NET_QUIC_CONGESTION_CONTROL_BBR_TCP_SENDER_H_
@@ -0,0 +1,312 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/quic/congestion_control/bbr_tcp_sender.h"
+
+#include "base/logging.h"
+#include "base/memory/scoped_ptr.h"
+#include "net/quic/congestion_control/pacing_sender.h"
+#include "net/quic/congestion_control/rtt_stats.h"
+#include "net/quic/congestion_control/send_algorithm_simulator.h"
+#include "net/quic/congestion_control/tcp_cubic_sender.h"
+#include "net/quic/test_tools/mock_clock.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+using std::make_pair;
+
+namespace net {
+namespace test {
+
+const QuicPacketCount kInitialCongestionWindowPackets = 10;
+const QuicByteCount kInitialCongestionWindowBytes =
+    kInitialCongestionWindowPackets * kDefaultTCPMSS;
+// Matches the burst QuicSentPacketManager allows when it enables pacing.
+const uint32 kInitialUnpacedBurst = 10;
+
+class BbrTcpSenderPeer : public BbrTcpSender {
+ public:
+  explicit BbrTcpSenderPeer(const QuicClock* clock)
+      : BbrTcpSender(clock, &rtt_stats_, kInitialCongestionWindowPackets,
+                     kMaxTcpCongestionWindow, &stats_) {}
+
+  QuicTime::Delta min_rtt() const { return min_rtt_; }
+  QuicByteCount delivered() const { return delivered_; }
+  QuicPacketCount round_trip_count() const { return round_trip_count_; }
+
+  RttStats rtt_stats_;
+  QuicConnectionStats stats_;
+};
+
+class BbrTcpSenderTest : public ::testing::Test {
+ protected:
+  BbrTcpSenderTest()
+      : rtt_(QuicTime::Delta::FromMilliseconds(60)),
+        sender_(new BbrTcpSenderPeer(&clock_)),
+        sequence_number_(1),
+        acked_sequence_number_(0),
+        bytes_in_flight_(0) {
+    standard_packet_.bytes_sent = kDefaultTCPMSS;
+    clock_.AdvanceTime(QuicTime::Delta::FromMilliseconds(1));
+  }
+
+  int SendAvailableSendWindow() {
+    // Send as long as TimeUntilSend returns Zero.
+    int packets_sent = 0;
+    bool can_send = sender_->TimeUntilSend(
+        clock_.Now(), bytes_in_flight_, HAS_RETRANSMITTABLE_DATA).IsZero();
+    while (can_send) {
+      sender_->OnPacketSent(clock_.Now(), bytes_in_flight_, sequence_number_++,
+                            kDefaultTCPMSS, HAS_RETRANSMITTABLE_DATA);
+      ++packets_sent;
+      bytes_in_flight_ += kDefaultTCPMSS;
+      can_send = sender_->TimeUntilSend(
+          clock_.Now(), bytes_in_flight_, HAS_RETRANSMITTABLE_DATA).IsZero();
+    }
+    return packets_sent;
+  }
+
+  void AckNPackets(int n) {
+    sender_->rtt_stats_.UpdateRtt(rtt_, QuicTime::Delta::Zero(), clock_.Now());
+    SendAlgorithmInterface::CongestionVector acked_packets;
+    SendAlgorithmInterface::CongestionVector lost_packets;
+    for (int i = 0; i < n; ++i) {
+      ++acked_sequence_number_;
+      acked_packets.push_back(
+          make_pair(acked_sequence_number_, standard_packet_));
+    }
+    sender_->OnCongestionEvent(
+        true, bytes_in_flight_, acked_packets, lost_packets);
+    bytes_in_flight_ -= n * kDefaultTCPMSS;
+  }
+
+  void LoseNPackets(int n) {
+    SendAlgorithmInterface::CongestionVector acked_packets;
+    SendAlgorithmInterface::CongestionVector lost_packets;
+    for (int i = 0; i < n; ++i) {
+      ++acked_sequence_number_;
+      lost_packets.push_back(
+          make_pair(acked_sequence_number_, standard_packet_));
+    }
+    sender_->OnCongestionEvent(
+        false, bytes_in_flight_, acked_packets, lost_packets);
+    bytes_in_flight_ -= n * kDefaultTCPMSS;
+  }
+
+  // Sends a window and acks all of it one rtt later.
+  void SendAndAckWindow() {
+    int packets_sent = SendAvailableSendWindow();
+    clock_.AdvanceTime(rtt_);
+    AckNPackets(packets_sent);
+  }
+
+  const QuicTime::Delta rtt_;
+  MockClock clock_;
+  scoped_ptr<BbrTcpSenderPeer> sender_;
+  QuicPacketSequenceNumber sequence_number_;
+  QuicPacketSequenceNumber acked_sequence_number_;
+  QuicByteCount bytes_in_flight_;
+  TransmissionInfo standard_packet_;
+};
+
+TEST_F(BbrTcpSenderTest, StartupDoublesWindowEachRoundTrip) {
+  EXPECT_EQ(kBBR, sender_->GetCongestionControlType());
+  EXPECT_TRUE(sender_->InSlowStart());
+  EXPECT_FALSE(sender_->HasReliableBandwidthEstimate());
+  EXPECT_TRUE(sender_->BandwidthEstimate().IsZero());
+  EXPECT_FALSE(sender_->PacingRate().IsZero());
+
+  EXPECT_EQ(static_cast<int>(kInitialCongestionWindowPackets),
+            SendAvailableSendWindow());
+  clock_.AdvanceTime(rtt_);
+  AckNPackets(kInitialCongestionWindowPackets);
+  EXPECT_EQ(2 * kInitialCongestionWindowBytes,
+            sender_->GetCongestionWindow());
+  EXPECT_EQ(rtt_, sender_->min_rtt());
+  // The window was delivered in one rtt.
+  EXPECT_EQ(QuicBandwidth::FromBytesAndTimeDelta(kInitialCongestionWindowBytes,
+                                                 rtt_),
+            sender_->BandwidthEstimate());
+
+  SendAndAckWindow();
+  EXPECT_EQ(4 * kInitialCongestionWindowBytes,
+            sender_->GetCongestionWindow());
+  EXPECT_EQ(QuicBandwidth::FromBytesAndTimeDelta(
+                2 * kInitialCongestionWindowBytes, rtt_),
+            sender_->BandwidthEstimate());
+  EXPECT_EQ(BbrTcpSender::STARTUP, sender_->mode());
+}
+
+TEST_F(BbrTcpSenderTest, LeavesStartupWhenBandwidthStopsGrowing) {
+  // Deliver the initial window once per rtt, as a bottleneck would.
+  for (int i = 0; i < 5 && sender_->mode() == BbrTcpSender::STARTUP; ++i) {
+    SendAvailableSendWindow();
+    clock_.AdvanceTime(rtt_);
+    AckNPackets(kInitialCongestionWindowPackets);
+    // Lose the rest of the window.
+    LoseNPackets(bytes_in_flight_ / kDefaultTCPMSS);
+  }
+  EXPECT_FALSE(sender_->InSlowStart());
+  EXPECT_TRUE(sender_->HasReliableBandwidthEstimate());
+  EXPECT_EQ(QuicBandwidth::FromBytesAndTimeDelta(kInitialCongestionWindowBytes,
+                                                 rtt_),
+            sender_->BandwidthEstimate());
+  // Nothing is in flight, so DRAIN is already over, and the pacing rate
+  // cycles around the bandwidth estimate.
+  EXPECT_EQ(BbrTcpSender::PROBE_BW, sender_->mode());
+  EXPECT_LE(sender_->BandwidthEstimate().Scale(0.75f), sender_->PacingRate());
+  EXPECT_GE(sender_->BandwidthEstimate().Scale(1.25f), sender_->PacingRate());
+  EXPECT_LE(2 * kInitialCongestionWindowBytes, sender_->GetCongestionWindow());
+}
+
+TEST_F(BbrTcpSenderTest, LossDoesNotReduceWindow) {
+  SendAndAckWindow();
+  QuicByteCount congestion_window = sender_->GetCongestionWindow();
+  SendAvailableSendWindow();
+  LoseNPackets(2);
+  EXPECT_EQ(congestion_window, sender_->GetCongestionWindow());
+  EXPECT_FALSE(sender_->InRecovery());
+  EXPECT_EQ(2u, sender_->stats_.slowstart_packets_lost);
+}
+
+TEST_F(BbrTcpSenderTest, RetransmissionTimeoutAndRevert) {
+  SendAndAckWindow();
+  QuicByteCount congestion_window = sender_->GetCongestionWindow();
+  SendAvailableSendWindow();
+
+  sender_->OnRetransmissionTimeout(true);
+  EXPECT_EQ(4 * kDefaultTCPMSS, sender_->GetCongestionWindow());
+  // A second RTO does not lose the window to revert to.
+  sender_->OnRetransmissionTimeout(true);
+  sender_->RevertRetransmissionTimeout();
+  EXPECT_EQ(congestion_window, sender_->GetCongestionWindow());
+}
+
+TEST_F(BbrTcpSenderTest, AcksAfterRetransmissionTimeoutCountAsDelivered) {
+  SendAndAckWindow();
+  const int packets_sent = SendAvailableSendWindow();
+  sender_->OnRetransmissionTimeout(true);
+  QuicByteCount delivered = sender_->delivered();
+
+  // The packets whose send states the RTO dropped are still delivered.
+  clock_.AdvanceTime(rtt_);
+  AckNPackets(packets_sent);
+  EXPECT_EQ(delivered + packets_sent * kDefaultTCPMSS, sender_->delivered());
+
+  // So a packet sent after those acks starts a new round trip.
+  QuicPacketCount round_trip_count = sender_->round_trip_count();
+  SendAndAckWindow();
+  EXPECT_EQ(round_trip_count + 1, sender_->round_trip_count());
+}
+
+TEST_F(BbrTcpSenderTest, ProbeRttAfterMinRttExpires) {
+  SendAndAckWindow();
+  QuicByteCount congestion_window = sender_->GetCongestionWindow();
+
+  // Acks with a larger rtt do not refresh the min rtt.
+  clock_.AdvanceTime(QuicTime::Delta::FromSeconds(11));
+  SendAvailableSendWindow();
+  clock_.AdvanceTime(rtt_);
+  sender_->rtt_stats_.UpdateRtt(rtt_.Multiply(2), QuicTime::Delta::Zero(),
+                                clock_.Now());
+  SendAlgorithmInterface::CongestionVector acked_packets;
+  SendAlgorithmInterface::CongestionVector lost_packets;
+  acked_packets.push_back(make_pair(++acked_sequence_number_,
+                                    standard_packet_));
+  sender_->OnCongestionEvent(true, bytes_in_flight_, acked_packets,
+                             lost_packets);
+  bytes_in_flight_ -= kDefaultTCPMSS;
+  EXPECT_EQ(BbrTcpSender::PROBE_RTT, sender_->mode());
+  EXPECT_EQ(4 * kDefaultTCPMSS, sender_->GetCongestionWindow());
+
+  // Drain the window, then hold it for a round trip and 200ms.
+  while (bytes_in_flight_ > 0) {
+    AckNPackets(1);
+  }
+  EXPECT_EQ(BbrTcpSender::PROBE_RTT, sender_->mode());
+  clock_.AdvanceTime(QuicTime::Delta::FromMilliseconds(200));
+  SendAndAckWindow();
+  EXPECT_EQ(BbrTcpSender::STARTUP, sender_->mode());
+  EXPECT_LE(congestion_window, sender_->GetCongestionWindow());
+}
+
+// Runs transfers through a simulated bottleneck, to compare BBR with Cubic.
+class BbrTcpSenderSimulationTest : public ::testing::Test {
+ protected:
+  BbrTcpSenderSimulationTest()
+      : bandwidth_(QuicBandwidth::FromKBitsPerSecond(10000)),
+        rtt_(QuicTime::Delta::FromMilliseconds(100)),
+        bbr_(new PacingSender(
+                 new BbrTcpSender(&clock_, &bbr_rtt_stats_,
+                                  kInitialCongestionWindowPackets,
+                                  kMaxTcpCongestionWindow, &stats_),
+                 QuicTime::Delta::FromMilliseconds(1),
+                 kInitialUnpacedBurst)),
+        cubic_(new TcpCubicSender(&clock_, &cubic_rtt_stats_, false,
+                                  kInitialCongestionWindowPackets,
+                                  kMaxTcpCongestionWindow, &stats_)),
+        bbr_sender_(bbr_.get(), &bbr_rtt_stats_),
+        cubic_sender_(cubic_.get(), &cubic_rtt_stats_) {
+    clock_.AdvanceTime(QuicTime::Delta::FromMilliseconds(1));
+  }
+
+  // Transfers |num_bytes| with |sender| over a bottleneck of |bandwidth_| and
+  // |rtt_| that drops |loss_rate| of the packets and queues up to
+  // |buffer_size| bytes.
+  void Transfer(SendAlgorithmSimulator::Sender* sender,
+                QuicByteCount num_bytes,
+                float loss_rate,
+                size_t buffer_size) {
+    SendAlgorithmSimulator simulator(&clock_, bandwidth_, rtt_);
+    simulator.set_forward_loss_rate(loss_rate);
+    simulator.set_buffer_size(buffer_size);
+    simulator.AddTransfer(sender, num_bytes);
+    simulator.TransferBytes();
+    VLOG(1) << (sender == &bbr_sender_ ? "BBR " : "Cubic ")
+            << sender->DebugString();
+  }
+
+  const QuicBandwidth bandwidth_;
+  const QuicTime::Delta rtt_;
+  MockClock clock_;
+  RttStats bbr_rtt_stats_;
+  RttStats cubic_rtt_stats_;
+  QuicConnectionStats stats_;
+  scoped_ptr<SendAlgorithmInterface> bbr_;
+  scoped_ptr<SendAlgorithmInterface> cubic_;
+  SendAlgorithmSimulator::Sender bbr_sender_;
+  SendAlgorithmSimulator::Sender cubic_sender_;
+};
+
+TEST_F(BbrTcpSenderSimulationTest, KeepsThroughputOnLossyPath) {
+  const QuicByteCount kTransferSize = 10 * 1024 * 1024;
+  const QuicByteCount bdp = bandwidth_.ToBytesPerPeriod(rtt_);
+  Transfer(&bbr_sender_, kTransferSize, 0.01f, 2 * bdp);
+  Transfer(&cubic_sender_, kTransferSize, 0.01f, 2 * bdp);
+
+  // BBR keeps most of the link despite 1% random loss, which Cubic mistakes
+  // for congestion.
+  EXPECT_GT(bbr_sender_.last_transfer_bandwidth,
+            bandwidth_.Scale(0.75f));
+  EXPECT_GT(bbr_sender_.last_transfer_bandwidth,
+            cubic_sender_.last_transfer_bandwidth.Scale(2));
+}
+
+TEST_F(BbrTcpSenderSimulationTest, KeepsQueueShortWithDeepBuffer) {
+  const QuicByteCount kTransferSize = 10 * 1024 * 1024;
+  const QuicByteCount bdp = bandwidth_.ToBytesPerPeriod(rtt_);
+  Transfer(&bbr_sender_, kTransferSize, 0, 8 * bdp);
+  Transfer(&cubic_sender_, kTransferSize, 0, 8 * bdp);
+
+  // Both fill the link, but Cubic fills the buffer as well.
+  EXPECT_GT(bbr_sender_.last_transfer_bandwidth,
+            bandwidth_.Scale(0.85f));
+  EXPECT_GT(cubic_sender_.last_transfer_bandwidth,
+            bandwidth_.Scale(0.85f));
+  EXPECT_LT(bbr_sender_.MeanQueueingDelay(), rtt_.Multiply(0.5));
+  EXPECT_LT(bbr_sender_.MeanQueueingDelay(),
+            cubic_sender_.MeanQueueingDelay());
+}
+
+}  // namespace test
+}  // namespace net
@@ -4,6 +4,7 @@
 
 #include "net/quic/congestion_control/send_algorithm_interface.h"
 
+#include "net/quic/congestion_control/bbr_tcp_sender.h"
 #include "net/quic/congestion_control/tcp_cubic_sender.h"
 #include "net/quic/quic_protocol.h"
 
@@ -28,13 +29,8 @@ SendAlgorithmInterface* SendAlgorithmInterface::Create(
                                 initial_congestion_window,
                                 kMaxTcpCongestionWindow, stats);
     case kBBR:
-  // TODO(rtenneti): Enable BbrTcpSender.
-#if 0
       return new BbrTcpSender(clock, rtt_stats, initial_congestion_window,
                               kMaxTcpCongestionWindow, stats);
-#endif
-      LOG(DFATAL) << "BbrTcpSender is not supported.";
-      return nullptr;
   }
   return nullptr;
 }
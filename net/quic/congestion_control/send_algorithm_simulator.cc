@@ -42,6 +42,9 @@ SendAlgorithmSimulator::Sender::Sender(SendAlgorithmInterface* send_algorithm,
       min_cwnd(100000),
       max_cwnd_drop(0),
       last_cwnd(0),
+      max_queueing_delay(QuicTime::Delta::Zero()),
+      total_queueing_delay(QuicTime::Delta::Zero()),
+      num_queueing_delay_samples(0),
       last_transfer_bandwidth(QuicBandwidth::Zero()),
       last_transfer_loss_rate(0) {}
 
@@ -310,6 +313,10 @@ void SendAlgorithmSimulator::HandlePendingAck(Transfer* transfer) {
   QuicTime::Delta measured_rtt =
       largest_observed.ack_time.Subtract(largest_observed.send_time);
   DCHECK_GE(measured_rtt.ToMicroseconds(), rtt_.ToMicroseconds());
+  QuicTime::Delta queueing_delay =
+      measured_rtt.Subtract(rtt_).Subtract(sender->additional_rtt);
+  sender->RecordQueueingDelay(
+      QuicTime::Delta::Max(QuicTime::Delta::Zero(), queueing_delay));
   sender->rtt_stats->UpdateRtt(measured_rtt,
                                QuicTime::Delta::Zero(),
                                clock_->Now());
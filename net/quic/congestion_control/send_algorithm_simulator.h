@@ -43,16 +43,36 @@ class SendAlgorithmSimulator {
       last_cwnd = cwnd;
     }
 
+    // Records the time a packet spent queued at the bottleneck.
+    void RecordQueueingDelay(QuicTime::Delta queueing_delay) {
+      max_queueing_delay =
+          QuicTime::Delta::Max(max_queueing_delay, queueing_delay);
+      total_queueing_delay = total_queueing_delay.Add(queueing_delay);
+      ++num_queueing_delay_samples;
+    }
+
+    QuicTime::Delta MeanQueueingDelay() const {
+      if (num_queueing_delay_samples == 0) {
+        return QuicTime::Delta::Zero();
+      }
+      return QuicTime::Delta::FromMicroseconds(
+          total_queueing_delay.ToMicroseconds() / num_queueing_delay_samples);
+    }
+
     std::string DebugString() {
       return StringPrintf("observed goodput(bytes/s):%" PRId64
                           " loss rate:%f"
                           " cwnd:%" PRIu64
                           " max_cwnd:%" PRIu64 " min_cwnd:%" PRIu64
-                          " max_cwnd_drop:%" PRIu64,
+                          " max_cwnd_drop:%" PRIu64
+                          " mean_queueing_delay(ms):%" PRId64
+                          " max_queueing_delay(ms):%" PRId64,
                           last_transfer_bandwidth.ToBytesPerSecond(),
                           last_transfer_loss_rate,
                           send_algorithm->GetCongestionWindow(),
-                          max_cwnd, min_cwnd, max_cwnd_drop);
+                          max_cwnd, min_cwnd, max_cwnd_drop,
+                          MeanQueueingDelay().ToMilliseconds(),
+                          max_queueing_delay.ToMilliseconds());
     }
 
     SendAlgorithmInterface* send_algorithm;
@@ -72,6 +92,11 @@ class SendAlgorithmSimulator {
     QuicByteCount max_cwnd_drop;
     QuicByteCount last_cwnd;
 
+    // Time acked packets spent queued at the bottleneck, beyond the rtt.
+    QuicTime::Delta max_queueing_delay;
+    QuicTime::Delta total_queueing_delay;
+    uint64 num_queueing_delay_samples;
+
     QuicBandwidth last_transfer_bandwidth;
     float last_transfer_loss_rate;
   };
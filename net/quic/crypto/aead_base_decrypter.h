@@ -50,6 +50,12 @@ class NET_EXPORT_PRIVATE AeadBaseDecrypter : public QuicDecrypter {
   QuicData* DecryptPacket(QuicPacketSequenceNumber sequence_number,
                           base::StringPiece associated_data,
                           base::StringPiece ciphertext) override;
+  bool DecryptPacketInto(QuicPacketSequenceNumber sequence_number,
+                         base::StringPiece associated_data,
+                         base::StringPiece ciphertext,
+                         char* output,
+                         size_t* output_length,
+                         size_t max_output_length) override;
   base::StringPiece GetKey() const override;
   base::StringPiece GetNoncePrefix() const override;
 
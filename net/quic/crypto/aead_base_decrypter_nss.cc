@@ -119,24 +119,35 @@ QuicData* AeadBaseDecrypter::DecryptPacket(
     QuicPacketSequenceNumber sequence_number,
     StringPiece associated_data,
     StringPiece ciphertext) {
-  if (ciphertext.length() < auth_tag_size_) {
+  size_t plaintext_size = ciphertext.length();
+  scoped_ptr<char[]> plaintext(new char[plaintext_size]);
+  if (!DecryptPacketInto(sequence_number, associated_data, ciphertext,
+                         plaintext.get(), &plaintext_size, plaintext_size)) {
     return nullptr;
   }
-  size_t plaintext_size;
-  scoped_ptr<char[]> plaintext(new char[ciphertext.length()]);
+  return new QuicData(plaintext.release(), plaintext_size, true);
+}
+
+bool AeadBaseDecrypter::DecryptPacketInto(
+    QuicPacketSequenceNumber sequence_number,
+    StringPiece associated_data,
+    StringPiece ciphertext,
+    char* output,
+    size_t* output_length,
+    size_t max_output_length) {
+  if (ciphertext.length() < auth_tag_size_ ||
+      ciphertext.length() > max_output_length) {
+    return false;
+  }
 
   uint8 nonce[sizeof(nonce_prefix_) + sizeof(sequence_number)];
   const size_t nonce_size = nonce_prefix_size_ + sizeof(sequence_number);
   DCHECK_LE(nonce_size, sizeof(nonce));
   memcpy(nonce, nonce_prefix_, nonce_prefix_size_);
   memcpy(nonce + nonce_prefix_size_, &sequence_number, sizeof(sequence_number));
-  if (!Decrypt(StringPiece(reinterpret_cast<char*>(nonce), nonce_size),
-               associated_data, ciphertext,
-               reinterpret_cast<uint8*>(plaintext.get()),
-               &plaintext_size)) {
-    return nullptr;
-  }
-  return new QuicData(plaintext.release(), plaintext_size, true);
+  return Decrypt(StringPiece(reinterpret_cast<char*>(nonce), nonce_size),
+                 associated_data, ciphertext,
+                 reinterpret_cast<uint8*>(output), output_length);
 }
 
 StringPiece AeadBaseDecrypter::GetKey() const {
@@ -106,6 +106,26 @@ QuicData* AeadBaseEncrypter::EncryptPacket(
     StringPiece plaintext) {
   size_t ciphertext_size = GetCiphertextSize(plaintext.length());
   scoped_ptr<char[]> ciphertext(new char[ciphertext_size]);
+  if (!EncryptPacketInto(sequence_number, associated_data, plaintext,
+                         ciphertext.get(), &ciphertext_size,
+                         ciphertext_size)) {
+    return nullptr;
+  }
+
+  return new QuicData(ciphertext.release(), ciphertext_size, true);
+}
+
+bool AeadBaseEncrypter::EncryptPacketInto(
+    QuicPacketSequenceNumber sequence_number,
+    StringPiece associated_data,
+    StringPiece plaintext,
+    char* output,
+    size_t* output_length,
+    size_t max_output_length) {
+  size_t ciphertext_size = GetCiphertextSize(plaintext.length());
+  if (max_output_length < ciphertext_size) {
+    return false;
+  }
 
   // TODO(ianswett): Introduce a check to ensure that we don't encrypt with the
   // same sequence number twice.
@@ -116,11 +136,11 @@ QuicData* AeadBaseEncrypter::EncryptPacket(
   memcpy(nonce + nonce_prefix_size_, &sequence_number, sizeof(sequence_number));
   if (!Encrypt(StringPiece(reinterpret_cast<char*>(nonce), nonce_size),
                associated_data, plaintext,
-               reinterpret_cast<unsigned char*>(ciphertext.get()))) {
-    return nullptr;
+               reinterpret_cast<unsigned char*>(output))) {
+    return false;
   }
-
-  return new QuicData(ciphertext.release(), ciphertext_size, true);
+  *output_length = ciphertext_size;
+  return true;
 }
 
 size_t AeadBaseEncrypter::GetKeySize() const { return key_size_; }
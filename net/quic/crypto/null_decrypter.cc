@@ -68,6 +68,20 @@ QuicData* NullDecrypter::DecryptPacket(QuicPacketSequenceNumber /*seq_number*/,
   return new QuicData(plaintext.data(), plaintext.length());
 }
 
+bool NullDecrypter::DecryptPacketInto(
+    QuicPacketSequenceNumber /*sequence_number*/,
+    StringPiece associated_data,
+    StringPiece ciphertext,
+    char* output,
+    size_t* output_length,
+    size_t max_output_length) {
+  if (ciphertext.length() > max_output_length) {
+    return false;
+  }
+  return Decrypt(StringPiece(), associated_data, ciphertext,
+                 reinterpret_cast<unsigned char*>(output), output_length);
+}
+
 StringPiece NullDecrypter::GetKey() const { return StringPiece(); }
 
 StringPiece NullDecrypter::GetNoncePrefix() const { return StringPiece(); }
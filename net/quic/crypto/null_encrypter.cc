@@ -44,6 +44,23 @@ QuicData* NullEncrypter::EncryptPacket(
   return new QuicData(reinterpret_cast<char*>(buffer), len, true);
 }
 
+bool NullEncrypter::EncryptPacketInto(
+    QuicPacketSequenceNumber /*sequence_number*/,
+    StringPiece associated_data,
+    StringPiece plaintext,
+    char* output,
+    size_t* output_length,
+    size_t max_output_length) {
+  const size_t len = plaintext.size() + GetHashLength();
+  if (max_output_length < len) {
+    return false;
+  }
+  Encrypt(StringPiece(), associated_data, plaintext,
+          reinterpret_cast<unsigned char*>(output));
+  *output_length = len;
+  return true;
+}
+
 size_t NullEncrypter::GetKeySize() const { return 0; }
 
 size_t NullEncrypter::GetNoncePrefixSize() const { return 0; }
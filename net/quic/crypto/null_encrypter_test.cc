@@ -33,6 +33,26 @@ TEST_F(NullEncrypterTest, Encrypt) {
       arraysize(expected));
 }
 
+TEST_F(NullEncrypterTest, EncryptPacketInto) {
+  NullEncrypter encrypter;
+  scoped_ptr<QuicData> encrypted(
+      encrypter.EncryptPacket(0, "hello world!", "goodbye!"));
+  ASSERT_TRUE(encrypted.get());
+
+  char buffer[kMaxPacketSize];
+  size_t length = 0;
+  ASSERT_TRUE(encrypter.EncryptPacketInto(0, "hello world!", "goodbye!",
+                                          buffer, &length, arraysize(buffer)));
+  test::CompareCharArraysWithHexError(
+      "encrypted data", buffer, length, encrypted->data(),
+      encrypted->length());
+
+  // The ciphertext does not fit one byte short of its length.
+  EXPECT_FALSE(encrypter.EncryptPacketInto(0, "hello world!", "goodbye!",
+                                           buffer, &length,
+                                           encrypted->length() - 1));
+}
+
 TEST_F(NullEncrypterTest, GetMaxPlaintextSize) {
   NullEncrypter encrypter;
   EXPECT_EQ(1000u, encrypter.GetMaxPlaintextSize(1012));
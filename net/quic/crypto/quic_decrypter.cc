@@ -4,6 +4,9 @@
 
 #include "net/quic/crypto/quic_decrypter.h"
 
+#include <string.h>
+
+#include "base/memory/scoped_ptr.h"
 #include "net/quic/crypto/aes_128_gcm_12_decrypter.h"
 #include "net/quic/crypto/chacha20_poly1305_decrypter.h"
 #include "net/quic/crypto/crypto_protocol.h"
@@ -26,4 +29,21 @@ QuicDecrypter* QuicDecrypter::Create(QuicTag algorithm) {
   }
 }
 
+bool QuicDecrypter::DecryptPacketInto(
+    QuicPacketSequenceNumber sequence_number,
+    base::StringPiece associated_data,
+    base::StringPiece ciphertext,
+    char* output,
+    size_t* output_length,
+    size_t max_output_length) {
+  scoped_ptr<QuicData> out(
+      DecryptPacket(sequence_number, associated_data, ciphertext));
+  if (out.get() == nullptr || out->length() > max_output_length) {
+    return false;
+  }
+  memcpy(output, out->data(), out->length());
+  *output_length = out->length();
+  return true;
+}
+
 }  // namespace net
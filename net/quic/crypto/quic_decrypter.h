@@ -61,6 +61,18 @@ class NET_EXPORT_PRIVATE QuicDecrypter {
                                   base::StringPiece associated_data,
                                   base::StringPiece ciphertext) = 0;
 
+  // Like DecryptPacket(), but writes the plaintext to |output|, which is
+  // |max_output_length| bytes long, rather than to a new QuicData. Sets
+  // |*output_length| to the length of the plaintext. Returns false on error,
+  // including when |output| is shorter than |ciphertext|. The default
+  // implementation calls DecryptPacket() and copies the result.
+  virtual bool DecryptPacketInto(QuicPacketSequenceNumber sequence_number,
+                                 base::StringPiece associated_data,
+                                 base::StringPiece ciphertext,
+                                 char* output,
+                                 size_t* output_length,
+                                 size_t max_output_length);
+
   // For use by unit tests only.
   virtual base::StringPiece GetKey() const = 0;
   virtual base::StringPiece GetNoncePrefix() const = 0;
@@ -57,6 +57,18 @@ class NET_EXPORT_PRIVATE QuicEncrypter {
                                   base::StringPiece associated_data,
                                   base::StringPiece plaintext) = 0;
 
+  // Like EncryptPacket(), but writes the ciphertext to |output|, which is
+  // |max_output_length| bytes long, rather than to a new QuicData. Sets
+  // |*output_length| to the length of the ciphertext. Returns false on error,
+  // including when |output| is too short. The default implementation calls
+  // EncryptPacket() and copies the result.
+  virtual bool EncryptPacketInto(QuicPacketSequenceNumber sequence_number,
+                                 base::StringPiece associated_data,
+                                 base::StringPiece plaintext,
+                                 char* output,
+                                 size_t* output_length,
+                                 size_t max_output_length);
+
   // GetKeySize() and GetNoncePrefixSize() tell the HKDF class how many bytes
   // of key material needs to be derived from the master secret.
   // NOTE: the sizes returned by GetKeySize() and GetNoncePrefixSize() are
@@ -1142,6 +1142,7 @@ const QuicConnectionStats& QuicConnection::GetStats() {
   }
 
   stats_.estimated_bandwidth = sent_packet_manager_.BandwidthEstimate();
+  stats_.decrypt_buffers_allocated = framer_.num_decrypt_buffers_allocated();
   stats_.max_packet_size = packet_generator_.max_packet_length();
   return stats_;
 }
@@ -1406,10 +1407,35 @@ bool QuicConnection::WritePacketInner(QueuedPacket* packet) {
   DCHECK_LE(sequence_number_of_last_sent_packet_, sequence_number);
   sequence_number_of_last_sent_packet_ = sequence_number;
 
-  QuicEncryptedPacket* encrypted = framer_.EncryptPacket(
-      packet->encryption_level,
-      sequence_number,
-      *packet->serialized_packet.packet);
+  // Encrypt into the writer's buffer when it offers one, so that the writer
+  // does not copy the packet, and onto the stack otherwise. Connection close
+  // packets are kept, so they get a buffer of their own, as do packets that
+  // may be larger than kMaxPacketSize.
+  char stack_buffer[kMaxPacketSize];
+  char* buffer = nullptr;
+  if (!IsConnectionClose(*packet) &&
+      !FLAGS_quic_allow_oversized_packets_for_test) {
+    buffer = writer_->GetNextWriteLocation();
+    if (buffer == nullptr) {
+      buffer = stack_buffer;
+    }
+  }
+  QuicEncryptedPacket* encrypted = nullptr;
+  size_t encrypted_length = 0;
+  if (buffer != nullptr) {
+    encrypted_length = framer_.EncryptPacket(
+        packet->encryption_level, sequence_number,
+        *packet->serialized_packet.packet, buffer, kMaxPacketSize);
+  } else {
+    encrypted = framer_.EncryptPacket(packet->encryption_level,
+                                      sequence_number,
+                                      *packet->serialized_packet.packet);
+    ++stats_.encrypt_buffers_allocated;
+  }
+  QuicEncryptedPacket buffered_packet(buffer, encrypted_length);
+  if (encrypted_length != 0) {
+    encrypted = &buffered_packet;
+  }
   if (encrypted == nullptr) {
     LOG(DFATAL) << ENDPOINT << "Failed to encrypt packet number "
                 << sequence_number;
@@ -1419,7 +1445,7 @@ bool QuicConnection::WritePacketInner(QueuedPacket* packet) {
   }
 
   // Connection close packets are eventually owned by TimeWaitListManager.
-  // Others are deleted at the end of this call.
+  // Others are deleted at the end of this call, if they were allocated.
   scoped_ptr<QuicEncryptedPacket> encrypted_deleter;
   if (IsConnectionClose(*packet)) {
     DCHECK(connection_close_packet_.get() == nullptr);
@@ -1430,7 +1456,7 @@ bool QuicConnection::WritePacketInner(QueuedPacket* packet) {
       visitor_->OnWriteBlocked();
       return true;
     }
-  } else {
+  } else if (encrypted != &buffered_packet) {
     encrypted_deleter.reset(encrypted);
   }
 
@@ -317,6 +317,12 @@ class NET_EXPORT_PRIVATE QuicConnection
   // Returns statistics tracked for this connection.
   const QuicConnectionStats& GetStats();
 
+  // Called when a stream copies |bytes| of received data in order to buffer
+  // them, rather than referencing the packet they arrived in.
+  void OnStreamDataCopied(QuicByteCount bytes) {
+    stats_.stream_bytes_copied += bytes;
+  }
+
   // Processes an incoming UDP packet (consisting of a QuicEncryptedPacket) from
   // the peer.  If processing this packet permits a packet to be revived from
   // its FEC group that packet will be revived and processed.
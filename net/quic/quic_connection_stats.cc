@@ -13,10 +13,13 @@ QuicConnectionStats::QuicConnectionStats()
       packets_sent(0),
       stream_bytes_sent(0),
       packets_discarded(0),
+      encrypt_buffers_allocated(0),
       bytes_received(0),
       packets_received(0),
       packets_processed(0),
       stream_bytes_received(0),
+      decrypt_buffers_allocated(0),
+      stream_bytes_copied(0),
       bytes_retransmitted(0),
       packets_retransmitted(0),
       bytes_spuriously_retransmitted(0),
@@ -50,10 +53,13 @@ ostream& operator<<(ostream& os, const QuicConnectionStats& s) {
      << ", packets sent:" << s.packets_sent
      << ", stream bytes sent: " << s.stream_bytes_sent
      << ", packets discarded: " << s.packets_discarded
+     << ", encrypt buffers allocated: " << s.encrypt_buffers_allocated
      << ", bytes received: " << s.bytes_received
      << ", packets received: " << s.packets_received
      << ", packets processed: " << s.packets_processed
      << ", stream bytes received: " << s.stream_bytes_received
+     << ", decrypt buffers allocated: " << s.decrypt_buffers_allocated
+     << ", stream bytes copied: " << s.stream_bytes_copied
      << ", bytes retransmitted: " << s.bytes_retransmitted
      << ", packets retransmitted: " << s.packets_retransmitted
      << ", bytes spuriously retransmitted: " << s.bytes_spuriously_retransmitted
@@ -28,6 +28,9 @@ struct NET_EXPORT_PRIVATE QuicConnectionStats {
   QuicByteCount stream_bytes_sent;
   // Packets serialized and discarded before sending.
   QuicPacketCount packets_discarded;
+  // Packets encrypted into a buffer of their own, rather than into the
+  // writer's buffer or onto the stack.
+  QuicPacketCount encrypt_buffers_allocated;
 
   // These include version negotiation and public reset packets, which do not
   // have sequence numbers or frame data.
@@ -37,6 +40,11 @@ struct NET_EXPORT_PRIVATE QuicConnectionStats {
   // Excludes packets which were not processable.
   QuicPacketCount packets_processed;
   QuicByteCount stream_bytes_received;  // Bytes received in a stream frame.
+  // Buffers allocated to decrypt received packets into.
+  QuicPacketCount decrypt_buffers_allocated;
+  // Stream bytes copied to be buffered, rather than referenced in the packet
+  // they arrived in.
+  QuicByteCount stream_bytes_copied;
 
   QuicByteCount bytes_retransmitted;
   QuicPacketCount packets_retransmitted;
@@ -152,6 +152,7 @@ QuicFramer::QuicFramer(const QuicVersionVector& supported_versions,
       error_(QUIC_NO_ERROR),
       last_sequence_number_(0),
       last_serialized_connection_id_(0),
+      num_decrypt_buffers_allocated_(0),
       supported_versions_(supported_versions),
       decrypter_level_(ENCRYPTION_NONE),
       alternative_decrypter_level_(ENCRYPTION_NONE),
@@ -687,6 +688,8 @@ bool QuicFramer::ProcessRevivedPacket(QuicPacketHeader* header,
     return RaiseError(QUIC_PACKET_TOO_LARGE);
   }
 
+  // Frames of a revived packet point into |payload|, which is not refcounted.
+  decrypted_ = nullptr;
   reader_.reset(new QuicDataReader(payload.data(), payload.length()));
   if (!ProcessFrameData(*header)) {
     DCHECK_NE(QUIC_NO_ERROR, error_);  // ProcessFrameData sets the error.
@@ -1307,6 +1310,7 @@ bool QuicFramer::ProcessStreamFrame(uint8 frame_type,
   if (!frame_data.empty()) {
     frame->data.Append(const_cast<char*>(frame_data.data()), frame_data.size());
   }
+  frame->data_buffer = decrypted_;
 
   return true;
 }
@@ -1682,19 +1686,40 @@ QuicEncryptedPacket* QuicFramer::EncryptPacket(
     const QuicPacket& packet) {
   DCHECK(encrypter_[level].get() != nullptr);
 
-  scoped_ptr<QuicData> out(encrypter_[level]->EncryptPacket(
-      packet_sequence_number, packet.AssociatedData(), packet.Plaintext()));
-  if (out.get() == nullptr) {
-    RaiseError(QUIC_ENCRYPTION_FAILURE);
+  const size_t buffer_len = packet.BeforePlaintext().length() +
+      encrypter_[level]->GetCiphertextSize(packet.Plaintext().length());
+  scoped_ptr<char[]> buffer(new char[buffer_len]);
+  size_t len = EncryptPacket(level, packet_sequence_number, packet,
+                             buffer.get(), buffer_len);
+  if (len == 0) {
     return nullptr;
   }
+  return new QuicEncryptedPacket(buffer.release(), len, true);
+}
+
+size_t QuicFramer::EncryptPacket(
+    EncryptionLevel level,
+    QuicPacketSequenceNumber packet_sequence_number,
+    const QuicPacket& packet,
+    char* buffer,
+    size_t buffer_len) {
+  DCHECK(encrypter_[level].get() != nullptr);
+
   StringPiece header_data = packet.BeforePlaintext();
-  size_t len =  header_data.length() + out->length();
-  char* buffer = new char[len];
-  // TODO(rch): eliminate this buffer copy by passing in a buffer to Encrypt().
+  if (header_data.length() > buffer_len) {
+    RaiseError(QUIC_ENCRYPTION_FAILURE);
+    return 0;
+  }
   memcpy(buffer, header_data.data(), header_data.length());
-  memcpy(buffer + header_data.length(), out->data(), out->length());
-  return new QuicEncryptedPacket(buffer, len, true);
+  size_t output_length = 0;
+  if (!encrypter_[level]->EncryptPacketInto(
+          packet_sequence_number, packet.AssociatedData(), packet.Plaintext(),
+          buffer + header_data.length(), &output_length,
+          buffer_len - header_data.length())) {
+    RaiseError(QUIC_ENCRYPTION_FAILURE);
+    return 0;
+  }
+  return header_data.length() + output_length;
 }
 
 size_t QuicFramer::GetMaxPlaintextSize(size_t ciphertext_size) {
@@ -1721,26 +1746,35 @@ bool QuicFramer::DecryptPayload(const QuicPacketHeader& header,
     return false;
   }
   DCHECK(decrypter_.get() != nullptr);
-  decrypted_.reset(decrypter_->DecryptPacket(
+  // Reuse the last packet's buffer, unless a stream still holds on to some of
+  // its data.
+  if (decrypted_.get() == nullptr || !decrypted_->HasOneRef() ||
+      static_cast<size_t>(decrypted_->size()) < encrypted.length()) {
+    decrypted_ = new IOBufferWithSize(
+        max(static_cast<size_t>(kMaxPacketSize), encrypted.length()));
+    ++num_decrypt_buffers_allocated_;
+  }
+  size_t decrypted_length = 0;
+  bool success = decrypter_->DecryptPacketInto(
       header.packet_sequence_number,
       GetAssociatedDataFromEncryptedPacket(
           packet,
           header.public_header.connection_id_length,
           header.public_header.version_flag,
           header.public_header.sequence_number_length),
-      encrypted));
-  if (decrypted_.get() != nullptr) {
+      encrypted, decrypted_->data(), &decrypted_length, decrypted_->size());
+  if (success) {
     visitor_->OnDecryptedPacket(decrypter_level_);
   } else if (alternative_decrypter_.get() != nullptr) {
-    decrypted_.reset(alternative_decrypter_->DecryptPacket(
+    success = alternative_decrypter_->DecryptPacketInto(
         header.packet_sequence_number,
         GetAssociatedDataFromEncryptedPacket(
             packet,
             header.public_header.connection_id_length,
             header.public_header.version_flag,
             header.public_header.sequence_number_length),
-        encrypted));
-    if (decrypted_.get() != nullptr) {
+        encrypted, decrypted_->data(), &decrypted_length, decrypted_->size());
+    if (success) {
       visitor_->OnDecryptedPacket(alternative_decrypter_level_);
       if (alternative_decrypter_latch_) {
         // Switch to the alternative decrypter and latch so that we cannot
@@ -1758,13 +1792,13 @@ bool QuicFramer::DecryptPayload(const QuicPacketHeader& header,
     }
   }
 
-  if (decrypted_.get() == nullptr) {
+  if (!success) {
     DLOG(WARNING) << "DecryptPacket failed for sequence_number:"
                   << header.packet_sequence_number;
     return false;
   }
 
-  reader_.reset(new QuicDataReader(decrypted_->data(), decrypted_->length()));
+  reader_.reset(new QuicDataReader(decrypted_->data(), decrypted_length));
   return true;
 }
 
@@ -9,8 +9,10 @@
 
 #include "base/basictypes.h"
 #include "base/logging.h"
+#include "base/memory/ref_counted.h"
 #include "base/memory/scoped_ptr.h"
 #include "base/strings/string_piece.h"
+#include "net/base/io_buffer.h"
 #include "net/base/net_export.h"
 #include "net/quic/quic_protocol.h"
 
@@ -356,6 +358,15 @@ class NET_EXPORT_PRIVATE QuicFramer {
                                      QuicPacketSequenceNumber sequence_number,
                                      const QuicPacket& packet);
 
+  // Encrypts |packet| into |buffer|, which is |buffer_len| bytes long, rather
+  // than into a new packet. Returns the length of the encrypted packet, or 0
+  // if it could not be encrypted, including when it does not fit.
+  size_t EncryptPacket(EncryptionLevel level,
+                       QuicPacketSequenceNumber sequence_number,
+                       const QuicPacket& packet,
+                       char* buffer,
+                       size_t buffer_len);
+
   // Returns the maximum length of plaintext that can be encrypted
   // to ciphertext no larger than |ciphertext_size|.
   size_t GetMaxPlaintextSize(size_t ciphertext_size);
@@ -375,6 +386,13 @@ class NET_EXPORT_PRIVATE QuicFramer {
 
   bool is_server() const { return is_server_; }
 
+  // The number of buffers the framer has allocated to decrypt received
+  // packets into. The framer reuses its buffer for the next packet unless
+  // stream frames from the last one are still referenced.
+  QuicPacketCount num_decrypt_buffers_allocated() const {
+    return num_decrypt_buffers_allocated_;
+  }
+
  private:
   friend class test::QuicFramerPeer;
 
@@ -505,8 +523,10 @@ class NET_EXPORT_PRIVATE QuicFramer {
   QuicPacketSequenceNumber last_sequence_number_;
   // Updated by WritePacketHeader.
   QuicConnectionId last_serialized_connection_id_;
-  // Buffer containing decrypted payload data during parsing.
-  scoped_ptr<QuicData> decrypted_;
+  // Buffer containing decrypted payload data during parsing. Stream frames
+  // reference it, so that their data can outlive the parse.
+  scoped_refptr<IOBufferWithSize> decrypted_;
+  QuicPacketCount num_decrypt_buffers_allocated_;
   // Version of the protocol being used.
   QuicVersion quic_version_;
   // This vector contains QUIC versions which we currently support.
@@ -1283,6 +1283,57 @@ TEST_P(QuicFramerTest, StreamFrame) {
   CheckStreamFrameBoundaries(packet, kQuicMaxStreamIdSize, !kIncludeVersion);
 }
 
+TEST_P(QuicFramerTest, StreamFrameReferencesDecryptedPacket) {
+  unsigned char packet[] = {
+    // public flags (8 byte connection_id)
+    0x3C,
+    // connection_id
+    0x10, 0x32, 0x54, 0x76,
+    0x98, 0xBA, 0xDC, 0xFE,
+    // packet sequence number
+    0xBC, 0x9A, 0x78, 0x56,
+    0x34, 0x12,
+    // private flags
+    0x00,
+
+    // frame type (stream frame with fin)
+    0xFF,
+    // stream id
+    0x04, 0x03, 0x02, 0x01,
+    // offset
+    0x54, 0x76, 0x10, 0x32,
+    0xDC, 0xFE, 0x98, 0xBA,
+    // data length
+    0x0c, 0x00,
+    // data
+    'h',  'e',  'l',  'l',
+    'o',  ' ',  'w',  'o',
+    'r',  'l',  'd',  '!',
+  };
+
+  QuicEncryptedPacket encrypted(AsChars(packet), arraysize(packet), false);
+  EXPECT_TRUE(framer_.ProcessPacket(encrypted));
+  ASSERT_EQ(1u, visitor_.stream_frames_.size());
+  IOBuffer* buffer = visitor_.stream_frames_[0]->data_buffer.get();
+  ASSERT_TRUE(buffer != nullptr);
+  EXPECT_EQ(1u, framer_.num_decrypt_buffers_allocated());
+
+  // The visitor holds on to the frame, so the next packet is decrypted into a
+  // new buffer and the frame's data stays valid.
+  EXPECT_TRUE(framer_.ProcessPacket(encrypted));
+  ASSERT_EQ(2u, visitor_.stream_frames_.size());
+  EXPECT_NE(buffer, visitor_.stream_frames_[1]->data_buffer.get());
+  EXPECT_EQ(2u, framer_.num_decrypt_buffers_allocated());
+  CheckStreamFrameData("hello world!", visitor_.stream_frames_[0]);
+
+  // Once the frames are released, the buffer is reused.
+  STLDeleteElements(&visitor_.stream_frames_);
+  EXPECT_TRUE(framer_.ProcessPacket(encrypted));
+  ASSERT_EQ(1u, visitor_.stream_frames_.size());
+  CheckStreamFrameData("hello world!", visitor_.stream_frames_[0]);
+  EXPECT_EQ(2u, framer_.num_decrypt_buffers_allocated());
+}
+
 TEST_P(QuicFramerTest, StreamFrame3ByteStreamId) {
   unsigned char packet[] = {
     // public flags (8 byte connection_id)
@@ -39,6 +39,12 @@ class NET_EXPORT_PRIVATE QuicPacketWriter {
   // Records that the socket has become writable, for example when an EPOLLOUT
   // is received or an asynchronous write completes.
   virtual void SetWritable() = 0;
+
+  // Returns a buffer of at least kMaxPacketSize bytes that the next packet
+  // may be written into, or nullptr if the writer has none. WritePacket()
+  // does not copy a packet that is in this buffer. The buffer is only valid
+  // until the next call to WritePacket(). The default returns nullptr.
+  virtual char* GetNextWriteLocation();
 };
 
 }  // namespace net
@@ -112,6 +112,7 @@ QuicStreamFrame::QuicStreamFrame(const QuicStreamFrame& frame)
       fin(frame.fin),
       offset(frame.offset),
       data(frame.data),
+      data_buffer(frame.data_buffer),
       notifier(frame.notifier) {
 }
 
@@ -125,6 +126,8 @@ QuicStreamFrame::QuicStreamFrame(QuicStreamId stream_id,
       data(data),
       notifier(nullptr) {}
 
+QuicStreamFrame::~QuicStreamFrame() {}
+
 string* QuicStreamFrame::GetDataAsString() const {
   string* data_string = new string();
   data_string->reserve(data.TotalBufferSize());
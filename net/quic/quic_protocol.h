@@ -18,8 +18,10 @@
 #include "base/basictypes.h"
 #include "base/containers/hash_tables.h"
 #include "base/logging.h"
+#include "base/memory/ref_counted.h"
 #include "base/strings/string_piece.h"
 #include "net/base/int128.h"
+#include "net/base/io_buffer.h"
 #include "net/base/ip_endpoint.h"
 #include "net/base/net_export.h"
 #include "net/quic/iovector.h"
@@ -648,6 +650,7 @@ struct NET_EXPORT_PRIVATE QuicStreamFrame {
                   bool fin,
                   QuicStreamOffset offset,
                   IOVector data);
+  ~QuicStreamFrame();
 
   NET_EXPORT_PRIVATE friend std::ostream& operator<<(
       std::ostream& os, const QuicStreamFrame& s);
@@ -660,6 +663,11 @@ struct NET_EXPORT_PRIVATE QuicStreamFrame {
   bool fin;
   QuicStreamOffset offset;  // Location of this data in the stream.
   IOVector data;
+  // The buffer that |data| points into, when the frame was parsed from a
+  // received packet. Holding a reference keeps the data valid after the
+  // framer has moved on to the next packet, so it can be buffered without a
+  // copy. nullptr otherwise.
+  scoped_refptr<IOBuffer> data_buffer;
 
   // If this is set, then when this packet is ACKed the AckNotifier will be
   // informed.
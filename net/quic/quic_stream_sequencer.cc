@@ -11,13 +11,21 @@
 #include "base/metrics/sparse_histogram.h"
 #include "net/quic/reliable_quic_stream.h"
 
+using base::StringPiece;
 using std::make_pair;
 using std::min;
 using std::numeric_limits;
-using std::string;
 
 namespace net {
 
+QuicStreamSequencer::BufferedFrame::BufferedFrame() {}
+
+QuicStreamSequencer::BufferedFrame::BufferedFrame(IOBuffer* buffer,
+                                                  StringPiece data)
+    : buffer(buffer), data(data) {}
+
+QuicStreamSequencer::BufferedFrame::~BufferedFrame() {}
+
 QuicStreamSequencer::QuicStreamSequencer(ReliableQuicStream* quic_stream)
     : stream_(quic_stream),
       num_bytes_consumed_(0),
@@ -25,7 +33,8 @@ QuicStreamSequencer::QuicStreamSequencer(ReliableQuicStream* quic_stream)
       blocked_(false),
       num_bytes_buffered_(0),
       num_frames_received_(0),
-      num_duplicate_frames_received_(0) {
+      num_duplicate_frames_received_(0),
+      num_bytes_copied_(0) {
 }
 
 QuicStreamSequencer::~QuicStreamSequencer() {
@@ -98,14 +107,30 @@ void QuicStreamSequencer::OnStreamFrame(const QuicStreamFrame& frame) {
   for (size_t i = 0; i < data.Size(); ++i) {
     DVLOG(1) << "Buffering stream data at offset " << byte_offset;
     const iovec& iov = data.iovec()[i];
-    buffered_frames_.insert(make_pair(
-        byte_offset, string(static_cast<char*>(iov.iov_base), iov.iov_len)));
+    BufferData(byte_offset, frame.data_buffer.get(),
+               StringPiece(static_cast<char*>(iov.iov_base), iov.iov_len));
     byte_offset += iov.iov_len;
     num_bytes_buffered_ += iov.iov_len;
   }
   return;
 }
 
+void QuicStreamSequencer::BufferData(QuicStreamOffset byte_offset,
+                                     IOBuffer* buffer,
+                                     StringPiece data) {
+  if (buffer == nullptr || data.size() < kMinReferencedFrameSize) {
+    scoped_refptr<IOBuffer> copy(new IOBuffer(data.size()));
+    memcpy(copy->data(), data.data(), data.size());
+    num_bytes_copied_ += data.size();
+    stream_->OnStreamDataCopied(data.size());
+    buffered_frames_.insert(make_pair(
+        byte_offset,
+        BufferedFrame(copy.get(), StringPiece(copy->data(), data.size()))));
+    return;
+  }
+  buffered_frames_.insert(make_pair(byte_offset, BufferedFrame(buffer, data)));
+}
+
 void QuicStreamSequencer::CloseStreamAtOffset(QuicStreamOffset offset) {
   const QuicStreamOffset kMaxOffset = numeric_limits<QuicStreamOffset>::max();
 
@@ -145,9 +170,9 @@ int QuicStreamSequencer::GetReadableRegions(iovec* iov, size_t iov_len) {
     if (it->first != offset) return index;
 
     iov[index].iov_base = static_cast<void*>(
-        const_cast<char*>(it->second.data()));
-    iov[index].iov_len = it->second.size();
-    offset += it->second.size();
+        const_cast<char*>(it->second.data.data()));
+    iov[index].iov_len = it->second.data.size();
+    offset += it->second.data.size();
 
     ++index;
     ++it;
@@ -167,11 +192,11 @@ int QuicStreamSequencer::Readv(const struct iovec* iov, size_t iov_len) {
          it != buffered_frames_.end() &&
          it->first == num_bytes_consumed_) {
     int bytes_to_read = min(iov[iov_index].iov_len - iov_offset,
-                            it->second.size() - frame_offset);
+                            it->second.data.size() - frame_offset);
 
     char* iov_ptr = static_cast<char*>(iov[iov_index].iov_base) + iov_offset;
     memcpy(iov_ptr,
-           it->second.data() + frame_offset, bytes_to_read);
+           it->second.data.data() + frame_offset, bytes_to_read);
     frame_offset += bytes_to_read;
     iov_offset += bytes_to_read;
 
@@ -180,9 +205,9 @@ int QuicStreamSequencer::Readv(const struct iovec* iov, size_t iov_len) {
       iov_offset = 0;
       ++iov_index;
     }
-    if (it->second.size() == frame_offset) {
+    if (it->second.data.size() == frame_offset) {
       // We've copied this whole frame
-      RecordBytesConsumed(it->second.size());
+      RecordBytesConsumed(it->second.data.size());
       buffered_frames_.erase(it);
       it = buffered_frames_.begin();
       frame_offset = 0;
@@ -190,8 +215,10 @@ int QuicStreamSequencer::Readv(const struct iovec* iov, size_t iov_len) {
   }
   // We've finished copying.  If we have a partial frame, update it.
   if (frame_offset != 0) {
-    buffered_frames_.insert(
-        make_pair(it->first + frame_offset, it->second.substr(frame_offset)));
+    buffered_frames_.insert(make_pair(
+        it->first + frame_offset,
+        BufferedFrame(it->second.buffer.get(),
+                      it->second.data.substr(frame_offset))));
     buffered_frames_.erase(buffered_frames_.begin());
     RecordBytesConsumed(frame_offset);
   }
@@ -234,7 +261,7 @@ bool QuicStreamSequencer::FrameOverlapsBufferedData(
   if (next_frame != buffered_frames_.begin()) {
     FrameMap::const_iterator preceeding_frame = --next_frame;
     QuicStreamOffset offset = preceeding_frame->first;
-    uint64 data_length = preceeding_frame->second.length();
+    uint64 data_length = preceeding_frame->second.data.length();
     if ((offset + data_length) > frame.offset) {
       DVLOG(1) << "Preceeding frame overlaps new frame: " << offset << " + "
                << data_length << " > " << frame.offset;
@@ -262,23 +289,23 @@ void QuicStreamSequencer::FlushBufferedFrames() {
   FrameMap::iterator it = buffered_frames_.find(num_bytes_consumed_);
   while (it != buffered_frames_.end()) {
     DVLOG(1) << "Flushing buffered packet at offset " << it->first;
-    string* data = &it->second;
-    size_t bytes_consumed = stream_->ProcessRawData(data->c_str(),
-                                                    data->size());
+    StringPiece data = it->second.data;
+    size_t bytes_consumed = stream_->ProcessRawData(data.data(), data.size());
     RecordBytesConsumed(bytes_consumed);
     if (MaybeCloseStream()) {
       return;
     }
-    if (bytes_consumed > data->size()) {
+    if (bytes_consumed > data.size()) {
       stream_->Reset(QUIC_ERROR_PROCESSING_STREAM);  // Programming error
       return;
-    } else if (bytes_consumed == data->size()) {
+    } else if (bytes_consumed == data.size()) {
       buffered_frames_.erase(it);
       it = buffered_frames_.find(num_bytes_consumed_);
     } else {
-      string new_data = it->second.substr(bytes_consumed);
+      BufferedFrame new_frame(it->second.buffer.get(),
+                              data.substr(bytes_consumed));
       buffered_frames_.erase(it);
-      buffered_frames_.insert(make_pair(num_bytes_consumed_, new_data));
+      buffered_frames_.insert(make_pair(num_bytes_consumed_, new_frame));
       return;
     }
   }
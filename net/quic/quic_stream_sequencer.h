@@ -9,6 +9,9 @@
 #include <string>
 
 #include "base/basictypes.h"
+#include "base/memory/ref_counted.h"
+#include "base/strings/string_piece.h"
+#include "net/base/io_buffer.h"
 #include "net/base/iovec.h"
 #include "net/quic/quic_protocol.h"
 
@@ -26,6 +29,24 @@ class ReliableQuicStream;
 // TOOD(alyssar) add some checks for overflow attempts [1, 256,] [2, 256]
 class NET_EXPORT_PRIVATE QuicStreamSequencer {
  public:
+  // Data that is buffered until the stream can consume it. |data| points into
+  // |buffer|, which is usually the packet the data arrived in.
+  struct NET_EXPORT_PRIVATE BufferedFrame {
+    BufferedFrame();
+    BufferedFrame(IOBuffer* buffer, base::StringPiece data);
+    ~BufferedFrame();
+
+    scoped_refptr<IOBuffer> buffer;
+    base::StringPiece data;
+  };
+
+  // Maps from stream offset to the data buffered at that offset.
+  typedef std::map<QuicStreamOffset, BufferedFrame> FrameMap;
+
+  // Buffered data shorter than this is copied rather than referenced, so
+  // that a few bytes do not keep a whole packet alive.
+  static const size_t kMinReferencedFrameSize = 256;
+
   explicit QuicStreamSequencer(ReliableQuicStream* quic_stream);
   virtual ~QuicStreamSequencer();
 
@@ -76,6 +97,10 @@ class NET_EXPORT_PRIVATE QuicStreamSequencer {
     return num_duplicate_frames_received_;
   }
 
+  // The number of bytes that were copied to be buffered, rather than
+  // referenced in the packet they arrived in.
+  QuicByteCount num_bytes_copied() const { return num_bytes_copied_; }
+
  private:
   friend class test::QuicStreamSequencerPeer;
 
@@ -90,20 +115,23 @@ class NET_EXPORT_PRIVATE QuicStreamSequencer {
   // num_bytes_consumed_ and num_bytes_buffered_.
   void RecordBytesConsumed(size_t bytes_consumed);
 
+  // Buffers |data|, which arrived at |byte_offset| in |buffer|. |buffer| may
+  // be nullptr, in which case |data| is copied.
+  void BufferData(QuicStreamOffset byte_offset,
+                  IOBuffer* buffer,
+                  base::StringPiece data);
+
   // The stream which owns this sequencer.
   ReliableQuicStream* stream_;
 
   // The last data consumed by the stream.
   QuicStreamOffset num_bytes_consumed_;
 
-  // TODO(alyssar) use something better than strings.
   // TODO(rjshade): In future we may support retransmission of partial stream
   // frames, in which case we will have to allow receipt of overlapping frames.
   // Maybe write new frames into a ring buffer, and keep track of consumed
   // bytes, and gaps.
-  typedef std::map<QuicStreamOffset, std::string> FrameMap;
-
-  // Stores buffered frames (maps from sequence number -> frame data as string).
+  // Stores buffered frames (maps from sequence number -> frame data).
   FrameMap buffered_frames_;
 
   // The offset, if any, we got a stream termination for.  When this many bytes
@@ -123,6 +151,9 @@ class NET_EXPORT_PRIVATE QuicStreamSequencer {
   // Count of the number of duplicate frames received.
   int num_duplicate_frames_received_;
 
+  // Count of the bytes copied in order to buffer them.
+  QuicByteCount num_bytes_copied_;
+
   DISALLOW_COPY_AND_ASSIGN(QuicStreamSequencer);
 };
 
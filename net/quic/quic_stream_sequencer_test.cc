@@ -9,6 +9,7 @@
 
 #include "base/logging.h"
 #include "base/rand_util.h"
+#include "net/base/io_buffer.h"
 #include "net/base/ip_endpoint.h"
 #include "net/quic/quic_utils.h"
 #include "net/quic/reliable_quic_stream.h"
@@ -19,7 +20,6 @@
 #include "testing/gtest/include/gtest/gtest.h"
 
 using base::StringPiece;
-using std::map;
 using std::min;
 using std::pair;
 using std::string;
@@ -40,7 +40,11 @@ class MockStream : public ReliableQuicStream {
   }
 
   MOCK_METHOD0(OnFinRead, void());
-  MOCK_METHOD2(ProcessRawData, uint32(const char* data, uint32 data_len));
+  // Buffered data is not NUL terminated, so it is matched as a string.
+  uint32 ProcessRawData(const char* data, uint32 data_len) override {
+    return ProcessData(string(data, data_len), data_len);
+  }
+  MOCK_METHOD2(ProcessData, uint32(const string& data, uint32 data_len));
   MOCK_METHOD2(CloseConnectionWithDetails, void(QuicErrorCode error,
                                                 const string& details));
   MOCK_METHOD1(Reset, void(QuicRstStreamErrorCode error));
@@ -129,11 +133,11 @@ class QuicStreamSequencerTest : public ::testing::Test {
   MockSession session_;
   testing::StrictMock<MockStream> stream_;
   scoped_ptr<QuicStreamSequencer> sequencer_;
-  map<QuicStreamOffset, string>* buffered_frames_;
+  QuicStreamSequencer::FrameMap* buffered_frames_;
 };
 
 TEST_F(QuicStreamSequencerTest, RejectOldFrame) {
-  EXPECT_CALL(stream_, ProcessRawData(StrEq("abc"), 3)).WillOnce(Return(3));
+  EXPECT_CALL(stream_, ProcessData(StrEq("abc"), 3)).WillOnce(Return(3));
 
   OnFrame(0, "abc");
   EXPECT_EQ(0u, buffered_frames_->size());
@@ -145,7 +149,7 @@ TEST_F(QuicStreamSequencerTest, RejectOldFrame) {
 }
 
 TEST_F(QuicStreamSequencerTest, RejectBufferedFrame) {
-  EXPECT_CALL(stream_, ProcessRawData(StrEq("abc"), 3));
+  EXPECT_CALL(stream_, ProcessData(StrEq("abc"), 3));
 
   OnFrame(0, "abc");
   EXPECT_EQ(1u, buffered_frames_->size());
@@ -157,7 +161,7 @@ TEST_F(QuicStreamSequencerTest, RejectBufferedFrame) {
 }
 
 TEST_F(QuicStreamSequencerTest, FullFrameConsumed) {
-  EXPECT_CALL(stream_, ProcessRawData(StrEq("abc"), 3)).WillOnce(Return(3));
+  EXPECT_CALL(stream_, ProcessData(StrEq("abc"), 3)).WillOnce(Return(3));
 
   OnFrame(0, "abc");
   EXPECT_EQ(0u, buffered_frames_->size());
@@ -171,12 +175,12 @@ TEST_F(QuicStreamSequencerTest, BlockedThenFullFrameConsumed) {
   EXPECT_EQ(1u, buffered_frames_->size());
   EXPECT_EQ(0u, sequencer_->num_bytes_consumed());
 
-  EXPECT_CALL(stream_, ProcessRawData(StrEq("abc"), 3)).WillOnce(Return(3));
+  EXPECT_CALL(stream_, ProcessData(StrEq("abc"), 3)).WillOnce(Return(3));
   sequencer_->FlushBufferedFrames();
   EXPECT_EQ(0u, buffered_frames_->size());
   EXPECT_EQ(3u, sequencer_->num_bytes_consumed());
 
-  EXPECT_CALL(stream_, ProcessRawData(StrEq("def"), 3)).WillOnce(Return(3));
+  EXPECT_CALL(stream_, ProcessData(StrEq("def"), 3)).WillOnce(Return(3));
   EXPECT_CALL(stream_, OnFinRead());
   OnFinFrame(3, "def");
 }
@@ -188,7 +192,7 @@ TEST_F(QuicStreamSequencerTest, BlockedThenFullFrameAndFinConsumed) {
   EXPECT_EQ(1u, buffered_frames_->size());
   EXPECT_EQ(0u, sequencer_->num_bytes_consumed());
 
-  EXPECT_CALL(stream_, ProcessRawData(StrEq("abc"), 3)).WillOnce(Return(3));
+  EXPECT_CALL(stream_, ProcessData(StrEq("abc"), 3)).WillOnce(Return(3));
   EXPECT_CALL(stream_, OnFinRead());
   sequencer_->FlushBufferedFrames();
   EXPECT_EQ(0u, buffered_frames_->size());
@@ -211,28 +215,28 @@ TEST_F(QuicStreamSequencerTest, EmptyFinFrame) {
 }
 
 TEST_F(QuicStreamSequencerTest, PartialFrameConsumed) {
-  EXPECT_CALL(stream_, ProcessRawData(StrEq("abc"), 3)).WillOnce(Return(2));
+  EXPECT_CALL(stream_, ProcessData(StrEq("abc"), 3)).WillOnce(Return(2));
 
   OnFrame(0, "abc");
   EXPECT_EQ(1u, buffered_frames_->size());
   EXPECT_EQ(2u, sequencer_->num_bytes_consumed());
-  EXPECT_EQ("c", buffered_frames_->find(2)->second);
+  EXPECT_EQ("c", buffered_frames_->find(2)->second.data);
 }
 
 TEST_F(QuicStreamSequencerTest, NextxFrameNotConsumed) {
-  EXPECT_CALL(stream_, ProcessRawData(StrEq("abc"), 3)).WillOnce(Return(0));
+  EXPECT_CALL(stream_, ProcessData(StrEq("abc"), 3)).WillOnce(Return(0));
 
   OnFrame(0, "abc");
   EXPECT_EQ(1u, buffered_frames_->size());
   EXPECT_EQ(0u, sequencer_->num_bytes_consumed());
-  EXPECT_EQ("abc", buffered_frames_->find(0)->second);
+  EXPECT_EQ("abc", buffered_frames_->find(0)->second.data);
 }
 
 TEST_F(QuicStreamSequencerTest, FutureFrameNotProcessed) {
   OnFrame(3, "abc");
   EXPECT_EQ(1u, buffered_frames_->size());
   EXPECT_EQ(0u, sequencer_->num_bytes_consumed());
-  EXPECT_EQ("abc", buffered_frames_->find(3)->second);
+  EXPECT_EQ("abc", buffered_frames_->find(3)->second.data);
 }
 
 TEST_F(QuicStreamSequencerTest, OutOfOrderFrameProcessed) {
@@ -248,9 +252,9 @@ TEST_F(QuicStreamSequencerTest, OutOfOrderFrameProcessed) {
   EXPECT_EQ(6u, sequencer_->num_bytes_buffered());
 
   InSequence s;
-  EXPECT_CALL(stream_, ProcessRawData(StrEq("abc"), 3)).WillOnce(Return(3));
-  EXPECT_CALL(stream_, ProcessRawData(StrEq("def"), 3)).WillOnce(Return(3));
-  EXPECT_CALL(stream_, ProcessRawData(StrEq("ghi"), 3)).WillOnce(Return(3));
+  EXPECT_CALL(stream_, ProcessData(StrEq("abc"), 3)).WillOnce(Return(3));
+  EXPECT_CALL(stream_, ProcessData(StrEq("def"), 3)).WillOnce(Return(3));
+  EXPECT_CALL(stream_, ProcessData(StrEq("ghi"), 3)).WillOnce(Return(3));
 
   // Ack right away
   OnFrame(0, "abc");
@@ -263,7 +267,7 @@ TEST_F(QuicStreamSequencerTest, OutOfOrderFrameProcessed) {
 TEST_F(QuicStreamSequencerTest, BasicHalfCloseOrdered) {
   InSequence s;
 
-  EXPECT_CALL(stream_, ProcessRawData(StrEq("abc"), 3)).WillOnce(Return(3));
+  EXPECT_CALL(stream_, ProcessData(StrEq("abc"), 3)).WillOnce(Return(3));
   EXPECT_CALL(stream_, OnFinRead());
   OnFinFrame(0, "abc");
 
@@ -274,8 +278,8 @@ TEST_F(QuicStreamSequencerTest, BasicHalfCloseUnorderedWithFlush) {
   OnFinFrame(6, "");
   EXPECT_EQ(6u, QuicStreamSequencerPeer::GetCloseOffset(sequencer_.get()));
   InSequence s;
-  EXPECT_CALL(stream_, ProcessRawData(StrEq("abc"), 3)).WillOnce(Return(3));
-  EXPECT_CALL(stream_, ProcessRawData(StrEq("def"), 3)).WillOnce(Return(3));
+  EXPECT_CALL(stream_, ProcessData(StrEq("abc"), 3)).WillOnce(Return(3));
+  EXPECT_CALL(stream_, ProcessData(StrEq("def"), 3)).WillOnce(Return(3));
   EXPECT_CALL(stream_, OnFinRead());
 
   OnFrame(3, "def");
@@ -286,7 +290,7 @@ TEST_F(QuicStreamSequencerTest, BasicHalfUnordered) {
   OnFinFrame(3, "");
   EXPECT_EQ(3u, QuicStreamSequencerPeer::GetCloseOffset(sequencer_.get()));
   InSequence s;
-  EXPECT_CALL(stream_, ProcessRawData(StrEq("abc"), 3)).WillOnce(Return(3));
+  EXPECT_CALL(stream_, ProcessData(StrEq("abc"), 3)).WillOnce(Return(3));
   EXPECT_CALL(stream_, OnFinRead());
 
   OnFrame(0, "abc");
@@ -300,7 +304,7 @@ TEST_F(QuicStreamSequencerTest, TerminateWithReadv) {
 
   EXPECT_FALSE(sequencer_->IsClosed());
 
-  EXPECT_CALL(stream_, ProcessRawData(StrEq("abc"), 3)).WillOnce(Return(0));
+  EXPECT_CALL(stream_, ProcessData(StrEq("abc"), 3)).WillOnce(Return(0));
   OnFrame(0, "abc");
 
   iovec iov = {&buffer[0], 3};
@@ -368,7 +372,7 @@ TEST_F(QuicSequencerRandomTest, RandomFramesNoDroppingNoBackup) {
   InSequence s;
   for (size_t i = 0; i < list_.size(); ++i) {
     string* data = &list_[i].second;
-    EXPECT_CALL(stream_, ProcessRawData(StrEq(*data), data->size()))
+    EXPECT_CALL(stream_, ProcessData(StrEq(*data), data->size()))
         .WillOnce(Return(data->size()));
   }
 
@@ -385,7 +389,7 @@ TEST_F(QuicStreamSequencerTest, FrameOverlapsBufferedData) {
   // Ensure that FrameOverlapsBufferedData returns appropriate responses when
   // there is existing data buffered.
 
-  map<QuicStreamOffset, string>* buffered_frames =
+  QuicStreamSequencer::FrameMap* buffered_frames =
       QuicStreamSequencerPeer::GetBufferedFrames(sequencer_.get());
 
   const int kBufferedOffset = 10;
@@ -399,8 +403,12 @@ TEST_F(QuicStreamSequencerTest, FrameOverlapsBufferedData) {
       QuicStreamFrame(1, false, kBufferedOffset - 1, data)));
 
   // Add a buffered frame.
-  buffered_frames->insert(
-      make_pair(kBufferedOffset, string(kBufferedDataLength, '.')));
+  scoped_refptr<StringIOBuffer> buffer(
+      new StringIOBuffer(string(kBufferedDataLength, '.')));
+  buffered_frames->insert(std::make_pair(
+      kBufferedOffset,
+      QuicStreamSequencer::BufferedFrame(
+          buffer.get(), StringPiece(buffer->data(), buffer->size()))));
 
   // New byte range partially overlaps with buffered frame, start offset
   // preceeding buffered frame.
@@ -441,6 +449,47 @@ TEST_F(QuicStreamSequencerTest, DontAcceptOverlappingFrames) {
   sequencer_->OnStreamFrame(frame2);
 }
 
+TEST_F(QuicStreamSequencerTest, BufferedFrameReferencesPacket) {
+  string payload(QuicStreamSequencer::kMinReferencedFrameSize, 'x');
+  scoped_refptr<StringIOBuffer> packet(new StringIOBuffer(payload));
+  {
+    QuicStreamFrame frame(1, false, 3, IOVector());
+    frame.data.Append(packet->data(), packet->size());
+    frame.data_buffer = packet;
+    sequencer_->OnStreamFrame(frame);
+  }
+  EXPECT_EQ(1u, buffered_frames_->size());
+  EXPECT_EQ(packet.get(), buffered_frames_->find(3)->second.buffer.get());
+  EXPECT_EQ(packet->data(), buffered_frames_->find(3)->second.data.data());
+  EXPECT_EQ(0u, sequencer_->num_bytes_copied());
+
+  InSequence s;
+  EXPECT_CALL(stream_, ProcessData(StrEq("abc"), 3)).WillOnce(Return(3));
+  EXPECT_CALL(stream_, ProcessData(StrEq(payload), payload.size()))
+      .WillOnce(Return(payload.size()));
+  OnFrame(0, "abc");
+  EXPECT_EQ(0u, buffered_frames_->size());
+  EXPECT_TRUE(packet->HasOneRef());
+}
+
+TEST_F(QuicStreamSequencerTest, BufferedFrameCopiedWhenSmall) {
+  scoped_refptr<StringIOBuffer> packet(new StringIOBuffer("def"));
+  {
+    QuicStreamFrame frame(1, false, 3, IOVector());
+    frame.data.Append(packet->data(), packet->size());
+    frame.data_buffer = packet;
+    sequencer_->OnStreamFrame(frame);
+  }
+  EXPECT_TRUE(packet->HasOneRef());
+  EXPECT_EQ(3u, sequencer_->num_bytes_copied());
+
+  // Frames which do not reference a packet are copied too.
+  OnFrame(6, "ghi");
+  EXPECT_EQ(6u, sequencer_->num_bytes_copied());
+  EXPECT_EQ("def", buffered_frames_->find(3)->second.data);
+  EXPECT_EQ("ghi", buffered_frames_->find(6)->second.data);
+}
+
 }  // namespace
 }  // namespace test
 }  // namespace net
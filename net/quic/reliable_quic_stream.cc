@@ -238,6 +238,10 @@ void ReliableQuicStream::CloseConnectionWithDetails(QuicErrorCode error,
   session()->connection()->SendConnectionCloseWithDetails(error, details);
 }
 
+void ReliableQuicStream::OnStreamDataCopied(QuicByteCount bytes) {
+  session()->connection()->OnStreamDataCopied(bytes);
+}
+
 QuicVersion ReliableQuicStream::version() const {
   return session()->connection()->version();
 }
@@ -111,6 +111,9 @@ class NET_EXPORT_PRIVATE ReliableQuicStream {
   // If our receive window has dropped below the threshold, then send a
   // WINDOW_UPDATE frame.
   void AddBytesConsumed(QuicByteCount bytes);
+  // Called by the stream sequencer when it copies received bytes in order to
+  // buffer them.
+  void OnStreamDataCopied(QuicByteCount bytes);
 
   // Updates the flow controller's send window offset and calls OnCanWrite if
   // it was blocked before.
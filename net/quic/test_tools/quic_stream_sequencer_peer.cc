@@ -4,16 +4,11 @@
 
 #include "net/quic/test_tools/quic_stream_sequencer_peer.h"
 
-#include "net/quic/quic_stream_sequencer.h"
-
-using std::map;
-using std::string;
-
 namespace net {
 namespace test {
 
 // static
-map<QuicStreamOffset, string>* QuicStreamSequencerPeer::GetBufferedFrames(
+QuicStreamSequencer::FrameMap* QuicStreamSequencerPeer::GetBufferedFrames(
     QuicStreamSequencer* sequencer) {
   return &(sequencer->buffered_frames_);
 }
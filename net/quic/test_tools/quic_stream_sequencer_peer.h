@@ -7,16 +7,15 @@
 
 #include "base/basictypes.h"
 #include "net/quic/quic_protocol.h"
+#include "net/quic/quic_stream_sequencer.h"
 
 namespace net {
 
-class QuicStreamSequencer;
-
 namespace test {
 
 class QuicStreamSequencerPeer {
  public:
-  static std::map<QuicStreamOffset, std::string>* GetBufferedFrames(
+  static QuicStreamSequencer::FrameMap* GetBufferedFrames(
       QuicStreamSequencer* sequencer);
 
   static QuicStreamOffset GetCloseOffset(QuicStreamSequencer* sequencer);
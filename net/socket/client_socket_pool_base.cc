@@ -39,6 +39,11 @@ const int kCleanupInterval = 10;  // DO NOT INCREASE THIS TIMEOUT.
 // after a certain timeout has passed without receiving an ACK.
 bool g_connect_backup_jobs_enabled = true;
 
+// How late a connect job may time out. Connect timeouts are long and rarely
+// fire, so the timers of all connect jobs share a timer wheel, which makes
+// restarting them cheap.
+const int kConnectJobTimeoutSlackMs = 20;
+
 }  // namespace
 
 ConnectJob::ConnectJob(const std::string& group_name,
@@ -54,6 +59,8 @@ ConnectJob::ConnectJob(const std::string& group_name,
       idle_(true) {
   DCHECK(!group_name.empty());
   DCHECK(delegate);
+  timer_.SetSlack(
+      base::TimeDelta::FromMilliseconds(kConnectJobTimeoutSlackMs));
   net_log.BeginEvent(NetLog::TYPE_SOCKET_POOL_CONNECT_JOB,
                      NetLog::StringCallback("group_name", &group_name_));
 }
@@ -0,0 +1,118 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/socket/tcp_socket.h"
+
+#include <string.h>
+
+#include "base/memory/ref_counted.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/memory/slab_allocator.h"
+#include "base/time/time.h"
+#include "net/base/io_buffer.h"
+#include "net/base/ip_endpoint.h"
+#include "net/base/net_errors.h"
+#include "net/base/net_util.h"
+#include "net/base/test_completion_callback.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_test.h"
+
+#if defined(USE_TCMALLOC)
+#include "third_party/tcmalloc/chromium/src/gperftools/malloc_extension.h"
+#endif
+
+namespace net {
+
+namespace {
+
+const int kIterations = 20000;
+const int kMessageSize = 1024;
+
+// Writes and reads back kMessageSize bytes over a loopback connection
+// kIterations times, with fresh IOBuffers and callbacks each time, and reports
+// how many allocations SlabAllocator served. When built with tcmalloc it also
+// reports how many allocations the thread made from the heap, whatever made
+// them.
+TEST(TCPSocketPerfTest, LoopbackReadWrite) {
+  IPAddressNumber loopback;
+  ASSERT_TRUE(ParseIPLiteralToNumber("127.0.0.1", &loopback));
+  TCPSocket listen_socket(NULL, NetLog::Source());
+  ASSERT_EQ(OK, listen_socket.Open(ADDRESS_FAMILY_IPV4));
+  ASSERT_EQ(OK, listen_socket.Bind(IPEndPoint(loopback, 0)));
+  ASSERT_EQ(OK, listen_socket.Listen(1));
+  IPEndPoint local_address;
+  ASSERT_EQ(OK, listen_socket.GetLocalAddress(&local_address));
+
+  TestCompletionCallback connect_callback;
+  TCPSocket client_socket(NULL, NetLog::Source());
+  ASSERT_EQ(OK, client_socket.Open(ADDRESS_FAMILY_IPV4));
+  int result =
+      client_socket.Connect(local_address, connect_callback.callback());
+
+  TestCompletionCallback accept_callback;
+  scoped_ptr<TCPSocket> server_socket;
+  IPEndPoint accepted_address;
+  ASSERT_EQ(OK, accept_callback.GetResult(listen_socket.Accept(
+      &server_socket, &accepted_address, accept_callback.callback())));
+  ASSERT_EQ(OK, connect_callback.GetResult(result));
+
+  base::SlabAllocator::Stats before;
+  base::SlabAllocator::GetThreadStats(&before);
+#if defined(USE_TCMALLOC)
+  unsigned int heap_allocations_before =
+      MallocExtension::GetAllocationsOnCurrentThread();
+#endif
+  base::TimeTicks start = base::TimeTicks::Now();
+  for (int i = 0; i < kIterations; ++i) {
+    scoped_refptr<IOBuffer> write_buffer(new IOBuffer(kMessageSize));
+    memset(write_buffer->data(), i, kMessageSize);
+    scoped_refptr<DrainableIOBuffer> drainable(
+        new DrainableIOBuffer(write_buffer.get(), kMessageSize));
+    while (drainable->BytesRemaining() > 0) {
+      TestCompletionCallback write_callback;
+      int rv = write_callback.GetResult(server_socket->Write(
+          drainable.get(), drainable->BytesRemaining(),
+          write_callback.callback()));
+      ASSERT_GT(rv, 0);
+      drainable->DidConsume(rv);
+    }
+
+    int bytes_read = 0;
+    while (bytes_read < kMessageSize) {
+      scoped_refptr<IOBuffer> read_buffer(new IOBuffer(kMessageSize));
+      TestCompletionCallback read_callback;
+      int rv = read_callback.GetResult(client_socket.Read(
+          read_buffer.get(), kMessageSize - bytes_read,
+          read_callback.callback()));
+      ASSERT_GT(rv, 0);
+      bytes_read += rv;
+    }
+  }
+  base::TimeDelta elapsed = base::TimeTicks::Now() - start;
+#if defined(USE_TCMALLOC)
+  unsigned int heap_allocations =
+      MallocExtension::GetAllocationsOnCurrentThread() -
+      heap_allocations_before;
+#endif
+  base::SlabAllocator::Stats after;
+  base::SlabAllocator::GetThreadStats(&after);
+
+  perf_test::PrintResult(
+      "loopback_read_write", "", "time_per_iteration",
+      elapsed.InMillisecondsF() * 1000 / kIterations, "us", true);
+  perf_test::PrintResult(
+      "loopback_read_write", "", "pooled_allocations_per_iteration",
+      static_cast<double>(after.allocations - before.allocations) /
+          kIterations,
+      "count", true);
+#if defined(USE_TCMALLOC)
+  perf_test::PrintResult(
+      "loopback_read_write", "", "heap_allocations_per_iteration",
+      static_cast<double>(heap_allocations) / kIterations, "count", true);
+#endif
+}
+
+}  // namespace
+
+}  // namespace net
@@ -22,6 +22,7 @@ const char kCookieKey[] = "cookie";
 
 HpackDecoder::HpackDecoder(const HpackHuffmanTable& table)
     : max_string_literal_size_(kDefaultMaxStringLiteralSize),
+      decoded_block_built_(false),
       regular_header_seen_(false),
       huffman_table_(table) {}
 
@@ -30,7 +31,8 @@ HpackDecoder::~HpackDecoder() {}
 bool HpackDecoder::HandleControlFrameHeadersData(SpdyStreamId id,
                                                  const char* headers_data,
                                                  size_t headers_data_length) {
-  decoded_block_.clear();
+  decoded_header_block_.Clear();
+  decoded_block_built_ = false;
 
   size_t new_size = headers_block_buffer_.size() + headers_data_length;
   if (new_size > kMaxDecodeBufferSize) {
@@ -56,16 +58,38 @@ bool HpackDecoder::HandleControlFrameHeadersComplete(SpdyStreamId id) {
 
   // Emit the Cookie header, if any crumbles were encountered.
   if (!cookie_value_.empty()) {
-    decoded_block_[kCookieKey] = cookie_value_;
+    decoded_header_block_.AddHeader(kCookieKey, cookie_value_);
+    decoded_block_built_ = false;
     cookie_value_.clear();
   }
   return true;
 }
 
-bool HpackDecoder::HandleHeaderRepresentation(StringPiece name,
-                                              StringPiece value) {
+const std::map<string, string>& HpackDecoder::decoded_block() {
   typedef std::pair<std::map<string, string>::iterator, bool> InsertResult;
 
+  if (decoded_block_built_) {
+    return decoded_block_;
+  }
+  decoded_block_.clear();
+  const HpackHeaderBlock::HeaderFields& fields = decoded_header_block_.fields();
+  for (HpackHeaderBlock::HeaderFields::const_iterator it = fields.begin();
+       it != fields.end(); ++it) {
+    InsertResult result = decoded_block_.insert(
+        std::make_pair(it->first.as_string(), it->second.as_string()));
+    if (!result.second) {
+      result.first->second.push_back('\0');
+      result.first->second.insert(result.first->second.end(),
+                                  it->second.begin(),
+                                  it->second.end());
+    }
+  }
+  decoded_block_built_ = true;
+  return decoded_block_;
+}
+
+bool HpackDecoder::HandleHeaderRepresentation(StringPiece name,
+                                              StringPiece value) {
   // Fail if pseudo-header follows regular header.
   if (name.size() > 0) {
     if (name[0] == kPseudoHeaderPrefix) {
@@ -83,14 +107,8 @@ bool HpackDecoder::HandleHeaderRepresentation(StringPiece name,
       cookie_value_.insert(cookie_value_.end(), value.begin(), value.end());
     }
   } else {
-    InsertResult result = decoded_block_.insert(
-        std::make_pair(name.as_string(), value.as_string()));
-    if (!result.second) {
-      result.first->second.push_back('\0');
-      result.first->second.insert(result.first->second.end(),
-                                  value.begin(),
-                                  value.end());
-    }
+    decoded_header_block_.AddHeader(name, value);
+    decoded_block_built_ = false;
   }
   return true;
 }
@@ -177,13 +195,10 @@ bool HpackDecoder::DecodeNextName(
   const HpackEntry* entry = header_table_.GetByIndex(index_or_zero);
   if (entry == NULL) {
     return false;
-  } else if (entry->IsStatic()) {
-    *next_name = entry->name();
-  } else {
-    // |entry| could be evicted as part of this insertion. Preemptively copy.
-    key_buffer_.assign(entry->name());
-    *next_name = key_buffer_;
   }
+  // |entry| could be evicted as part of this insertion, which HpackHeaderTable
+  // handles without a copy.
+  *next_name = entry->name();
   return true;
 }
 
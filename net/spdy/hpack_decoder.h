@@ -13,6 +13,7 @@
 #include "base/macros.h"
 #include "base/strings/string_piece.h"
 #include "net/base/net_export.h"
+#include "net/spdy/hpack_header_block.h"
 #include "net/spdy/hpack_header_table.h"
 #include "net/spdy/hpack_input_stream.h"
 #include "net/spdy/spdy_protocol.h"
@@ -55,27 +56,31 @@ class NET_EXPORT_PRIVATE HpackDecoder {
   // TODO(jgraettinger): A future version of this method will simply deliver
   // the Cookie header (which has been incrementally reconstructed) and notify
   // the visitor that the block is finished. For now, this method decodes the
-  // complete buffered block, and stores results to |decoded_block_|.
+  // complete buffered block, and stores results to |decoded_header_block_|.
   bool HandleControlFrameHeadersComplete(SpdyStreamId stream_id);
 
-  // Accessor for the most recently decoded headers block. Valid until the next
-  // call to HandleControlFrameHeadersData().
+  // Accessor for the fields of the most recently decoded headers block, in
+  // decoding order, with all Cookie crumbs joined into a last field. Valid
+  // until the next call to HandleControlFrameHeadersData().
+  const HpackHeaderBlock& decoded_header_block() const {
+    return decoded_header_block_;
+  }
+
+  // Returns decoded_header_block() as a map, built on the first call for each
+  // block. Multiple values of a header other than Cookie are joined and
+  // delimited by '\0', as per section 8.1.3.3 of the HTTP2 draft
+  // specification. Note that this may be too accomodating, as the sender's
+  // HTTP2 layer should have already joined and delimited these values.
   // TODO(jgraettinger): This was added to facilitate re-encoding the block in
   // SPDY3 format for delivery to the SpdyFramer visitor, and will be removed
   // with the migration to SpdyHeadersHandlerInterface.
-  const std::map<std::string, std::string>& decoded_block() {
-    return decoded_block_;
-  }
+  const std::map<std::string, std::string>& decoded_block();
 
  private:
-  // Adds the header representation to |decoded_block_|, applying the
-  // following rules, as per sections 8.1.3.3 & 8.1.3.4 of the HTTP2 draft
-  // specification:
-  //  - Multiple values of the Cookie header are joined, delmited by '; '.
-  //    This reconstruction is required to properly handle Cookie crumbling.
-  //  - Multiple values of other headers are joined and delimited by '\0'.
-  //    Note that this may be too accomodating, as the sender's HTTP2 layer
-  //    should have already joined and delimited these values.
+  // Adds the header representation to |decoded_header_block_|. Multiple
+  // values of the Cookie header are instead joined, delmited by '; ', as per
+  // section 8.1.3.4 of the HTTP2 draft specification. This reconstruction is
+  // required to properly handle Cookie crumbling.
   //
   // Returns false if a pseudo-header field follows a regular header one, which
   // MUST be treated as malformed, as per sections 8.1.2.1. of the HTTP2 draft
@@ -96,7 +101,12 @@ class NET_EXPORT_PRIVATE HpackDecoder {
   // processed headers block. Both will be removed with the switch to
   // SpdyHeadersHandlerInterface.
   std::string headers_block_buffer_;
+  HpackHeaderBlock decoded_header_block_;
+
+  // |decoded_header_block_| as returned by decoded_block(), and whether it
+  // has been built since |decoded_header_block_| last changed.
   std::map<std::string, std::string> decoded_block_;
+  bool decoded_block_built_;
 
   // Flag to keep track of having seen a regular header field.
   bool regular_header_seen_;
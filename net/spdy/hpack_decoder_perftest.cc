@@ -0,0 +1,237 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <string.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "base/basictypes.h"
+#include "base/time/time.h"
+#include "net/spdy/fuzzing/hpack_fuzz_util.h"
+#include "net/spdy/hpack_constants.h"
+#include "net/spdy/hpack_decoder.h"
+#include "net/spdy/hpack_encoder.h"
+#include "net/spdy/hpack_huffman_table.h"
+#include "net/spdy/hpack_output_stream.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_test.h"
+
+namespace net {
+namespace test {
+namespace {
+
+using std::map;
+using std::string;
+
+typedef std::vector<map<string, string> > HeaderSets;
+
+const size_t kNumGeneratedHeaderSets = 500;
+
+struct CorpusField {
+  const char* name;
+  const char* value;
+};
+
+// Request and response header sets of a page load, in the order a client
+// connection sees them. Sets are terminated by a NULL name.
+const CorpusField kPageLoadCorpus[] = {
+  {":method", "GET"}, {":scheme", "https"},
+  {":authority", "www.example.com"}, {":path", "/"},
+  {"accept", "text/html,application/xhtml+xml,application/xml;q=0.9,"
+             "image/webp,*/*;q=0.8"},
+  {"accept-encoding", "gzip, deflate, sdch"},
+  {"accept-language", "en-US,en;q=0.8"},
+  {"cookie", "PREF=ID=1111111111111111:FF=0:TM=1420070400:LM=1420070400"},
+  {"cookie", "NID=67=aQvQmT0Xpqb8GGm3yW2aS5kU3xI9QZ4hQ2JfK5X8sN0wA1rE"},
+  {"user-agent", "Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 "
+                 "(KHTML, like Gecko) Chrome/41.0.2272.76 Safari/537.36"},
+  {NULL, NULL},
+  {":status", "200"}, {"cache-control", "private, max-age=0"},
+  {"content-encoding", "gzip"}, {"content-type", "text/html; charset=UTF-8"},
+  {"date", "Thu, 05 Mar 2015 18:24:41 GMT"},
+  {"expires", "-1"}, {"server", "gws"},
+  {"set-cookie", "NID=67=fGlS4uKb3o_ZeW5wX9y8r2s7t1u0v6w4x3y2z1A; "
+                 "expires=Fri, 04-Sep-2015 18:24:41 GMT; path=/; "
+                 "domain=.example.com; HttpOnly"},
+  {"x-frame-options", "SAMEORIGIN"}, {"x-xss-protection", "1; mode=block"},
+  {NULL, NULL},
+  {":method", "GET"}, {":scheme", "https"},
+  {":authority", "www.example.com"}, {":path", "/images/logo.png"},
+  {"accept", "image/webp,*/*;q=0.8"},
+  {"accept-encoding", "gzip, deflate, sdch"},
+  {"accept-language", "en-US,en;q=0.8"},
+  {"cookie", "PREF=ID=1111111111111111:FF=0:TM=1420070400:LM=1420070400"},
+  {"cookie", "NID=67=fGlS4uKb3o_ZeW5wX9y8r2s7t1u0v6w4x3y2z1A"},
+  {"referer", "https://www.example.com/"},
+  {"user-agent", "Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 "
+                 "(KHTML, like Gecko) Chrome/41.0.2272.76 Safari/537.36"},
+  {NULL, NULL},
+  {":status", "200"}, {"accept-ranges", "bytes"},
+  {"cache-control", "private, max-age=31536000"},
+  {"content-length", "13504"}, {"content-type", "image/png"},
+  {"date", "Thu, 05 Mar 2015 18:24:41 GMT"},
+  {"expires", "Thu, 05 Mar 2015 18:24:41 GMT"},
+  {"last-modified", "Tue, 16 Dec 2014 23:55:13 GMT"}, {"server", "sffe"},
+  {NULL, NULL},
+  {":method", "GET"}, {":scheme", "https"},
+  {":authority", "www.example.com"},
+  {":path", "/xjs/_/js/k=xjs.s.en_US.8pN2GkhnZB0.O/m=sx,c,sb,cdos,cr,elog,"
+            "jsa,r,hsm,qsm,j,p,d,csi/am=AAAAJAE/rt=j/d=1/t=zcms"},
+  {"accept", "*/*"}, {"accept-encoding", "gzip, deflate, sdch"},
+  {"accept-language", "en-US,en;q=0.8"},
+  {"cookie", "PREF=ID=1111111111111111:FF=0:TM=1420070400:LM=1420070400"},
+  {"cookie", "NID=67=fGlS4uKb3o_ZeW5wX9y8r2s7t1u0v6w4x3y2z1A"},
+  {"referer", "https://www.example.com/"},
+  {"user-agent", "Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 "
+                 "(KHTML, like Gecko) Chrome/41.0.2272.76 Safari/537.36"},
+  {NULL, NULL},
+  {":status", "200"}, {"cache-control", "public, max-age=31536000"},
+  {"content-encoding", "gzip"},
+  {"content-type", "text/javascript; charset=UTF-8"},
+  {"date", "Wed, 04 Mar 2015 12:45:01 GMT"},
+  {"expires", "Thu, 03 Mar 2016 12:45:01 GMT"},
+  {"last-modified", "Tue, 03 Mar 2015 21:04:48 GMT"}, {"server", "sffe"},
+  {"vary", "Accept-Encoding"}, {"x-content-type-options", "nosniff"},
+  {NULL, NULL},
+  {":method", "POST"}, {":scheme", "https"},
+  {":authority", "www.example.com"},
+  {":path", "/gen_204?atyp=i&ct=slh&cad=&ei=Y5_4VNrGH8r1oATz8YG4Cw&v=2&"
+            "s=1&pv=0.8713458487484604&me=1:1425579896734,V,0,0,1280,"
+            "702:0,B,702:0,N,1,Y5_4VNrGH8r1oATz8YG4Cw:0,R,1,1,0,0,1280,702"
+            ":1086,x:26,e,U&zx=1425579897847"},
+  {"accept", "*/*"}, {"accept-encoding", "gzip, deflate"},
+  {"accept-language", "en-US,en;q=0.8"}, {"content-length", "0"},
+  {"cookie", "PREF=ID=1111111111111111:FF=0:TM=1420070400:LM=1420070400"},
+  {"cookie", "NID=67=fGlS4uKb3o_ZeW5wX9y8r2s7t1u0v6w4x3y2z1A"},
+  {"origin", "https://www.example.com"},
+  {"referer", "https://www.example.com/"},
+  {"user-agent", "Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 "
+                 "(KHTML, like Gecko) Chrome/41.0.2272.76 Safari/537.36"},
+  {NULL, NULL},
+  {":status", "204"}, {"content-length", "0"},
+  {"content-type", "text/html; charset=UTF-8"},
+  {"date", "Thu, 05 Mar 2015 18:24:57 GMT"}, {"server", "gws"},
+  {"x-frame-options", "SAMEORIGIN"}, {"x-xss-protection", "1; mode=block"},
+  {NULL, NULL},
+};
+
+// Returns the header sets of kPageLoadCorpus. Cookie crumbs are joined into
+// one value, which the encoder crumbles again.
+HeaderSets PageLoadHeaderSets() {
+  HeaderSets header_sets(1);
+  for (size_t i = 0; i != arraysize(kPageLoadCorpus); ++i) {
+    const CorpusField& field = kPageLoadCorpus[i];
+    if (field.name == NULL) {
+      if (i + 1 != arraysize(kPageLoadCorpus)) {
+        header_sets.push_back(map<string, string>());
+      }
+      continue;
+    }
+    string* value = &header_sets.back()[field.name];
+    if (!value->empty()) {
+      value->append("; ");
+    }
+    value->append(field.value);
+  }
+  return header_sets;
+}
+
+// Returns header sets from the HPACK fuzzer's generator, whose names and
+// values are mostly random bytes.
+HeaderSets GeneratedHeaderSets() {
+  HpackFuzzUtil::GeneratorContext context;
+  HpackFuzzUtil::InitializeGeneratorContext(&context);
+  HeaderSets header_sets;
+  for (size_t i = 0; i != kNumGeneratedHeaderSets; ++i) {
+    header_sets.push_back(HpackFuzzUtil::NextGeneratedHeaderSet(&context));
+  }
+  return header_sets;
+}
+
+// Encodes |header_sets| in order with a single encoder, as one connection
+// would, and reports the rate at which HpackDecoder decodes them in
+// |num_passes| passes, each with a new decoder.
+void RunDecoderBenchmark(const HeaderSets& header_sets,
+                         int num_passes,
+                         const string& trace) {
+  HpackEncoder encoder(ObtainHpackHuffmanTable());
+  std::vector<string> blocks(header_sets.size());
+  size_t encoded_size = 0;
+  size_t header_count = 0;
+  for (size_t i = 0; i != header_sets.size(); ++i) {
+    ASSERT_TRUE(encoder.EncodeHeaderSet(header_sets[i], &blocks[i]));
+    encoded_size += blocks[i].size();
+    header_count += header_sets[i].size();
+  }
+
+  base::TimeTicks start = base::TimeTicks::Now();
+  for (int pass = 0; pass != num_passes; ++pass) {
+    HpackDecoder decoder(ObtainHpackHuffmanTable());
+    for (size_t i = 0; i != blocks.size(); ++i) {
+      ASSERT_TRUE(decoder.HandleControlFrameHeadersData(
+          1, blocks[i].data(), blocks[i].size()));
+      ASSERT_TRUE(decoder.HandleControlFrameHeadersComplete(1));
+    }
+  }
+  base::TimeDelta elapsed = base::TimeTicks::Now() - start;
+
+  perf_test::PrintResult(
+      "hpack_decode_throughput", "", trace,
+      num_passes * encoded_size / elapsed.InSecondsF() / (1024 * 1024),
+      "MB/s", true);
+  perf_test::PrintResult(
+      "hpack_decode_headers_per_second", "", trace,
+      num_passes * header_count / elapsed.InSecondsF(), "headers/s", true);
+}
+
+TEST(HpackDecoderPerfTest, PageLoadCorpus) {
+  RunDecoderBenchmark(PageLoadHeaderSets(), 5000, "page_load");
+}
+
+TEST(HpackDecoderPerfTest, GeneratedCorpus) {
+  RunDecoderBenchmark(GeneratedHeaderSets(), 200, "generated");
+}
+
+// Reports the rate at which HpackHuffmanTable decodes the names and values
+// of kPageLoadCorpus.
+TEST(HpackDecoderPerfTest, HuffmanDecode) {
+  const HpackHuffmanTable& table = ObtainHpackHuffmanTable();
+  std::vector<string> encoded;
+  size_t decoded_size = 0;
+  for (size_t i = 0; i != arraysize(kPageLoadCorpus); ++i) {
+    const CorpusField& field = kPageLoadCorpus[i];
+    if (field.name == NULL) {
+      continue;
+    }
+    const char* strings[] = {field.name, field.value};
+    for (size_t j = 0; j != arraysize(strings); ++j) {
+      HpackOutputStream output_stream;
+      table.EncodeString(strings[j], &output_stream);
+      encoded.push_back(string());
+      output_stream.TakeString(&encoded.back());
+      decoded_size += strlen(strings[j]);
+    }
+  }
+
+  string decoded;
+  base::TimeTicks start = base::TimeTicks::Now();
+  const int kNumPasses = 5000;
+  for (int pass = 0; pass != kNumPasses; ++pass) {
+    for (size_t i = 0; i != encoded.size(); ++i) {
+      ASSERT_TRUE(table.DecodeString(encoded[i], kuint32max, &decoded));
+    }
+  }
+  base::TimeDelta elapsed = base::TimeTicks::Now() - start;
+
+  perf_test::PrintResult(
+      "hpack_huffman_decode_throughput", "", "page_load",
+      kNumPasses * decoded_size / elapsed.InSecondsF() / (1024 * 1024),
+      "MB/s", true);
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace net
@@ -45,7 +45,7 @@ class HpackDecoderPeer {
     return decoder_->cookie_value_;
   }
   const std::map<string, string>& decoded_block() const {
-    return decoder_->decoded_block_;
+    return decoder_->decoded_block();
   }
   const string& headers_block_buffer() const {
     return decoder_->headers_block_buffer_;
@@ -170,6 +170,24 @@ TEST_F(HpackDecoderTest, HandleHeaderRepresentation) {
       Pair("passed-through", string("foo\0baz", 7))));
 }
 
+TEST_F(HpackDecoderTest, DecodedHeaderBlockKeepsDecodingOrder) {
+  // Static table entries #2 and #5, then "foo: bar" and "foo: baz" literals
+  // without indexing.
+  EXPECT_TRUE(DecodeHeaderBlock(StringPiece(
+      "\x82\x85" "\x00\x03" "foo" "\x03" "bar" "\x00\x03" "foo" "\x03" "baz",
+      20)));
+
+  EXPECT_THAT(decoder_.decoded_header_block().fields(), ElementsAre(
+      Pair(":method", "GET"),
+      Pair(":path", "/index.html"),
+      Pair("foo", "bar"),
+      Pair("foo", "baz")));
+  EXPECT_THAT(decoded_block(), ElementsAre(
+      Pair(":method", "GET"),
+      Pair(":path", "/index.html"),
+      Pair("foo", string("bar\0baz", 7))));
+}
+
 // Decoding an encoded name with a valid string literal should work.
 TEST_F(HpackDecoderTest, DecodeNextNameLiteral) {
   HpackInputStream input_stream(kLiteralBound, StringPiece("\x00\x04name", 6));
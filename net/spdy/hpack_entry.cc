@@ -18,15 +18,15 @@ HpackEntry::HpackEntry(StringPiece name,
                        StringPiece value,
                        bool is_static,
                        size_t insertion_index)
-    : name_(name.data(), name.size()),
-      value_(value.data(), value.size()),
+    : name_(name),
+      value_(value),
       insertion_index_(insertion_index),
       type_(is_static ? STATIC : DYNAMIC) {
 }
 
 HpackEntry::HpackEntry(StringPiece name, StringPiece value)
-    : name_(name.data(), name.size()),
-      value_(value.data(), value.size()),
+    : name_(name),
+      value_(value),
       insertion_index_(0),
       type_(LOOKUP) {
 }
@@ -47,8 +47,8 @@ size_t HpackEntry::Size() const {
 }
 
 std::string HpackEntry::GetDebugString() const {
-  return "{ name: \"" + name_ +
-      "\", value: \"" + value_ +
+  return "{ name: \"" + name_.as_string() +
+      "\", value: \"" + value_.as_string() +
       "\", " + (IsStatic() ? "static" : "dynamic") + " }";
 }
 
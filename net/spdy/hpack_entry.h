@@ -20,7 +20,10 @@
 namespace net {
 
 // A structure for an entry in the static table (3.3.1)
-// and the header table (3.3.2).
+// and the header table (3.3.2). An HpackEntry does not own its name and
+// value, which must outlive it: dynamic entries reference storage owned by
+// their HpackHeaderTable, static entries the static table data, and lookup
+// entries the query.
 class NET_EXPORT_PRIVATE HpackEntry {
  public:
   // The constant amount added to name().size() and value().size() to
@@ -50,8 +53,8 @@ class NET_EXPORT_PRIVATE HpackEntry {
 
   ~HpackEntry();
 
-  const std::string& name() const { return name_; }
-  const std::string& value() const { return value_; }
+  base::StringPiece name() const { return name_; }
+  base::StringPiece value() const { return value_; }
 
   // Returns whether this entry is a member of the static (as opposed to
   // dynamic) table.
@@ -76,9 +79,8 @@ class NET_EXPORT_PRIVATE HpackEntry {
     STATIC,
   };
 
-  // TODO(jgraettinger): Reduce copies, possibly via SpdyPinnableBufferPiece.
-  std::string name_;
-  std::string value_;
+  base::StringPiece name_;
+  base::StringPiece value_;
 
   // The entry's index in the total set of entries ever inserted into the header
   // table.
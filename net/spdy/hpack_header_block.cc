@@ -0,0 +1,66 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/spdy/hpack_header_block.h"
+
+#include <algorithm>
+
+#include "base/logging.h"
+
+namespace net {
+
+using base::StringPiece;
+
+namespace {
+
+// Size of the first arena buffer. Later buffers double in size.
+const size_t kInitialBufferSize = 1024;
+
+}  // namespace
+
+HpackHeaderBlock::HpackHeaderBlock() : bytes_used_(0), buffer_used_(0) {}
+
+HpackHeaderBlock::~HpackHeaderBlock() {}
+
+void HpackHeaderBlock::AddHeader(StringPiece name, StringPiece value) {
+  const size_t size = name.size() + value.size();
+  char* data = Allocate(size);
+  std::copy(name.begin(), name.end(), data);
+  std::copy(value.begin(), value.end(), data + name.size());
+  fields_.push_back(HeaderField(StringPiece(data, name.size()),
+                                StringPiece(data + name.size(), value.size())));
+  bytes_used_ += size;
+}
+
+void HpackHeaderBlock::Clear() {
+  fields_.clear();
+  bytes_used_ = 0;
+  buffer_used_ = 0;
+  if (buffers_.size() > 1) {
+    size_t total_size = 0;
+    for (size_t i = 0; i != buffers_.size(); ++i) {
+      total_size += buffers_[i]->size();
+    }
+    buffers_.clear();
+    buffers_.push_back(new std::vector<char>(total_size));
+  }
+}
+
+char* HpackHeaderBlock::Allocate(size_t size) {
+  if (size == 0) {
+    return NULL;
+  }
+  if (buffers_.empty() || buffer_used_ + size > buffers_.back()->size()) {
+    size_t buffer_size = buffers_.empty() ? kInitialBufferSize
+                                          : 2 * buffers_.back()->size();
+    buffers_.push_back(new std::vector<char>(std::max(buffer_size, size)));
+    buffer_used_ = 0;
+  }
+  char* data = &(*buffers_.back())[buffer_used_];
+  buffer_used_ += size;
+  DCHECK_LE(buffer_used_, buffers_.back()->size());
+  return data;
+}
+
+}  // namespace net
@@ -0,0 +1,70 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef NET_SPDY_HPACK_HEADER_BLOCK_H_
+#define NET_SPDY_HPACK_HEADER_BLOCK_H_
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include "base/basictypes.h"
+#include "base/macros.h"
+#include "base/memory/scoped_vector.h"
+#include "base/strings/string_piece.h"
+#include "net/base/net_export.h"
+
+namespace net {
+
+namespace test {
+class HpackHeaderBlockPeer;
+}  // namespace test
+
+// An HpackHeaderBlock holds the header fields of a decoded header block, in
+// the order they were decoded. Each field's name and value are copied next to
+// each other into an arena, and are exposed as StringPiece views into it
+// which remain valid until Clear().
+class NET_EXPORT_PRIVATE HpackHeaderBlock {
+ public:
+  friend class test::HpackHeaderBlockPeer;
+
+  typedef std::pair<base::StringPiece, base::StringPiece> HeaderField;
+  typedef std::vector<HeaderField> HeaderFields;
+
+  HpackHeaderBlock();
+  ~HpackHeaderBlock();
+
+  // Copies |name| and |value| into the arena, and appends a field viewing
+  // the copies.
+  void AddHeader(base::StringPiece name, base::StringPiece value);
+
+  // Removes all fields. Arena memory is kept for the next block, coalesced
+  // into a single buffer if the last block did not fit in one.
+  void Clear();
+
+  const HeaderFields& fields() const { return fields_; }
+  bool empty() const { return fields_.empty(); }
+
+  // Total size of the names and values of the fields.
+  size_t bytes_used() const { return bytes_used_; }
+
+ private:
+  // Returns |size| bytes of arena storage, allocating a new buffer if the
+  // current one lacks room.
+  char* Allocate(size_t size);
+
+  HeaderFields fields_;
+  size_t bytes_used_;
+
+  // Arena buffers. Only the last one is being filled, up to |buffer_used_|.
+  // Buffers are never resized, so views into them remain valid.
+  ScopedVector<std::vector<char> > buffers_;
+  size_t buffer_used_;
+
+  DISALLOW_COPY_AND_ASSIGN(HpackHeaderBlock);
+};
+
+}  // namespace net
+
+#endif  // NET_SPDY_HPACK_HEADER_BLOCK_H_
@@ -0,0 +1,124 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/spdy/hpack_header_block.h"
+
+#include <string>
+
+#include "base/strings/string_number_conversions.h"
+#include "testing/gmock/include/gmock/gmock.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace net {
+
+using base::StringPiece;
+using std::string;
+
+namespace test {
+
+class HpackHeaderBlockPeer {
+ public:
+  explicit HpackHeaderBlockPeer(const HpackHeaderBlock& block)
+      : block_(block) {}
+
+  size_t buffer_count() const { return block_.buffers_.size(); }
+  size_t buffer_size(size_t i) const { return block_.buffers_[i]->size(); }
+
+ private:
+  const HpackHeaderBlock& block_;
+};
+
+namespace {
+
+using testing::ElementsAre;
+using testing::Pair;
+
+class HpackHeaderBlockTest : public ::testing::Test {
+ protected:
+  HpackHeaderBlockTest() : peer_(block_) {}
+
+  HpackHeaderBlock block_;
+  HpackHeaderBlockPeer peer_;
+};
+
+TEST_F(HpackHeaderBlockTest, AddHeaderCopiesInOrder) {
+  string name = "name";
+  string value = "value";
+  block_.AddHeader(name, value);
+  block_.AddHeader("empty", "");
+  block_.AddHeader("name", "another value");
+
+  // The block holds copies.
+  name = "xxxx";
+  value = "xxxxx";
+  EXPECT_THAT(block_.fields(), ElementsAre(
+      Pair("name", "value"),
+      Pair("empty", ""),
+      Pair("name", "another value")));
+  EXPECT_EQ(31u, block_.bytes_used());
+  EXPECT_FALSE(block_.empty());
+}
+
+TEST_F(HpackHeaderBlockTest, NamesAndValuesAreContiguous) {
+  block_.AddHeader("name1", "value1");
+  block_.AddHeader("name2", "value2");
+
+  const HpackHeaderBlock::HeaderFields& fields = block_.fields();
+  EXPECT_EQ(fields[0].first.data() + 5, fields[0].second.data());
+  EXPECT_EQ(fields[0].second.data() + 6, fields[1].first.data());
+  EXPECT_EQ(fields[1].first.data() + 5, fields[1].second.data());
+  EXPECT_EQ(1u, peer_.buffer_count());
+}
+
+TEST_F(HpackHeaderBlockTest, ViewsSurviveArenaGrowth) {
+  for (int i = 0; i != 1000; ++i) {
+    block_.AddHeader("name-" + base::IntToString(i),
+                     string(i % 64, 'v'));
+  }
+  EXPECT_LT(1u, peer_.buffer_count());
+
+  ASSERT_EQ(1000u, block_.fields().size());
+  for (int i = 0; i != 1000; ++i) {
+    EXPECT_EQ("name-" + base::IntToString(i), block_.fields()[i].first);
+    EXPECT_EQ(string(i % 64, 'v'), block_.fields()[i].second);
+  }
+}
+
+TEST_F(HpackHeaderBlockTest, LargeHeaderGetsItsOwnBuffer) {
+  const string value(10 * 1024, 'v');
+  block_.AddHeader("name", value);
+  EXPECT_EQ(1u, peer_.buffer_count());
+  EXPECT_EQ(value, block_.fields()[0].second);
+}
+
+TEST_F(HpackHeaderBlockTest, ClearCoalescesBuffers) {
+  for (int i = 0; i != 1000; ++i) {
+    block_.AddHeader("name", "value");
+  }
+  size_t buffer_count = peer_.buffer_count();
+  EXPECT_LT(1u, buffer_count);
+  size_t total_size = 0;
+  for (size_t i = 0; i != buffer_count; ++i) {
+    total_size += peer_.buffer_size(i);
+  }
+
+  block_.Clear();
+  EXPECT_TRUE(block_.empty());
+  EXPECT_EQ(0u, block_.bytes_used());
+  EXPECT_EQ(1u, peer_.buffer_count());
+  EXPECT_EQ(total_size, peer_.buffer_size(0));
+
+  // The same block now fits in the single buffer.
+  for (int i = 0; i != 1000; ++i) {
+    block_.AddHeader("name", "value");
+  }
+  EXPECT_EQ(1u, peer_.buffer_count());
+  EXPECT_EQ(1000u, block_.fields().size());
+}
+
+}  // namespace
+
+}  // namespace test
+
+}  // namespace net
@@ -4,7 +4,10 @@
 
 #include "net/spdy/hpack_header_table.h"
 
+#include <string.h>
+
 #include <algorithm>
+#include <string>
 
 #include "base/logging.h"
 #include "net/spdy/hpack_constants.h"
@@ -35,6 +38,9 @@ bool HpackHeaderTable::EntryComparator::operator() (
 HpackHeaderTable::HpackHeaderTable()
     : static_entries_(ObtainHpackStaticTable().GetStaticEntries()),
       static_index_(ObtainHpackStaticTable().GetStaticIndex()),
+      dynamic_storage_capacity_(0),
+      dynamic_storage_begin_(0),
+      dynamic_storage_end_(0),
       settings_size_bound_(kDefaultHeaderTableSizeSetting),
       size_(0),
       max_size_(kDefaultHeaderTableSizeSetting),
@@ -159,11 +165,53 @@ void HpackHeaderTable::Evict(size_t count) {
     HpackEntry* entry = &dynamic_entries_.back();
 
     size_ -= entry->Size();
+    // The entry's data stays in place until storage is reclaimed.
+    dynamic_storage_begin_ += entry->name().size() + entry->value().size();
     CHECK_EQ(1u, dynamic_index_.erase(entry));
     dynamic_entries_.pop_back();
   }
 }
 
+void HpackHeaderTable::ReclaimStorage(size_t data_size) {
+  const size_t live_size = dynamic_storage_end_ - dynamic_storage_begin_;
+  // Data of entries in the table never exceeds |max_size_|, so holding twice
+  // that bounds reclamation to once per |max_size_| bytes of insertions.
+  size_t capacity = std::max(dynamic_storage_capacity_, 2 * max_size_);
+  capacity = std::max(capacity, live_size + data_size);
+
+  char* storage = dynamic_storage_.get();
+  if (capacity != dynamic_storage_capacity_) {
+    storage = new char[capacity];
+  }
+  if (live_size != 0) {
+    memmove(storage, dynamic_storage_.get() + dynamic_storage_begin_,
+            live_size);
+  }
+  // Entries are ordered newest first, while their data is laid out oldest
+  // first.
+  size_t offset = live_size;
+  for (EntryTable::iterator it = dynamic_entries_.begin();
+       it != dynamic_entries_.end(); ++it) {
+    const size_t name_size = it->name().size();
+    const size_t value_size = it->value().size();
+    offset -= name_size + value_size;
+    // Rewriting the entry in place preserves its |dynamic_index_| ordering,
+    // which depends only on its contents and insertion index.
+    *it = HpackEntry(StringPiece(storage + offset, name_size),
+                     StringPiece(storage + offset + name_size, value_size),
+                     false,  // is_static
+                     it->InsertionIndex());
+  }
+  DCHECK_EQ(0u, offset);
+
+  if (storage != dynamic_storage_.get()) {
+    dynamic_storage_.reset(storage);
+    dynamic_storage_capacity_ = capacity;
+  }
+  dynamic_storage_begin_ = 0;
+  dynamic_storage_end_ = live_size;
+}
+
 const HpackEntry* HpackHeaderTable::TryAddEntry(StringPiece name,
                                                 StringPiece value) {
   Evict(EvictionCountForEntry(name, value));
@@ -175,8 +223,30 @@ const HpackEntry* HpackHeaderTable::TryAddEntry(StringPiece name,
     DCHECK_EQ(0u, size_);
     return NULL;
   }
-  dynamic_entries_.push_front(HpackEntry(name,
-                                         value,
+  const size_t data_size = name.size() + value.size();
+  std::string name_copy, value_copy;
+  if (dynamic_storage_end_ + data_size > dynamic_storage_capacity_) {
+    // Reclamation moves entry data, which |name| and |value| may reference.
+    const char* storage_begin = dynamic_storage_.get();
+    const char* storage_end = storage_begin + dynamic_storage_capacity_;
+    if (name.data() >= storage_begin && name.data() < storage_end) {
+      name.CopyToString(&name_copy);
+      name = name_copy;
+    }
+    if (value.data() >= storage_begin && value.data() < storage_end) {
+      value.CopyToString(&value_copy);
+      value = value_copy;
+    }
+    ReclaimStorage(data_size);
+  }
+  char* data = dynamic_storage_.get() + dynamic_storage_end_;
+  std::copy(name.begin(), name.end(), data);
+  std::copy(value.begin(), value.end(), data + name.size());
+  dynamic_storage_end_ += data_size;
+
+  dynamic_entries_.push_front(HpackEntry(StringPiece(data, name.size()),
+                                         StringPiece(data + name.size(),
+                                                     value.size()),
                                          false,  // is_static
                                          total_insertions_));
   CHECK(dynamic_index_.insert(&dynamic_entries_.front()).second);
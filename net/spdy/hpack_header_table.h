@@ -11,6 +11,7 @@
 
 #include "base/basictypes.h"
 #include "base/macros.h"
+#include "base/memory/scoped_ptr.h"
 #include "net/base/net_export.h"
 #include "net/spdy/hpack_entry.h"
 
@@ -88,7 +89,8 @@ class NET_EXPORT_PRIVATE HpackHeaderTable {
                    EntryTable::iterator* end_out);
 
   // Adds an entry for the representation, evicting entries as needed. |name|
-  // and |value| must not be owned by an entry which could be evicted. The
+  // and |value| are copied into storage owned by the table, and may reference
+  // the name or value of any entry, including one which is evicted. The
   // added HpackEntry is returned, or NULL is returned if all entries were
   // evicted and the empty table is of insufficent size for the representation.
   const HpackEntry* TryAddEntry(StringPiece name, StringPiece value);
@@ -105,6 +107,11 @@ class NET_EXPORT_PRIVATE HpackHeaderTable {
   // Evicts |count| oldest entries from the table.
   void Evict(size_t count);
 
+  // Makes room for |data_size| bytes past the end of |dynamic_storage_|,
+  // by moving the data of live entries to its start and growing it as
+  // needed. Entries are updated to reference the moved data.
+  void ReclaimStorage(size_t data_size);
+
   // |static_entries_| and |static_index_| are owned by HpackStaticTable
   // singleton.
   const EntryTable& static_entries_;
@@ -113,6 +120,15 @@ class NET_EXPORT_PRIVATE HpackHeaderTable {
   const OrderedEntrySet& static_index_;
   OrderedEntrySet dynamic_index_;
 
+  // Names and values of |dynamic_entries_|, which are laid out from oldest
+  // to newest with each name followed by its value. The data of live entries
+  // spans [|dynamic_storage_begin_|, |dynamic_storage_end_|). Eviction only
+  // advances the beginning; the space is reclaimed when the storage fills.
+  scoped_ptr<char[]> dynamic_storage_;
+  size_t dynamic_storage_capacity_;
+  size_t dynamic_storage_begin_;
+  size_t dynamic_storage_end_;
+
   // Last acknowledged value for SETTINGS_HEADER_TABLE_SIZE.
   size_t settings_size_bound_;
 
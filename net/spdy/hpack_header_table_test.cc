@@ -5,12 +5,14 @@
 #include "net/spdy/hpack_header_table.h"
 
 #include <algorithm>
+#include <deque>
 #include <set>
 #include <string>
 #include <vector>
 
 #include "base/basictypes.h"
 #include "base/macros.h"
+#include "base/strings/string_number_conversions.h"
 #include "net/spdy/hpack_constants.h"
 #include "net/spdy/hpack_entry.h"
 #include "testing/gtest/include/gtest/gtest.h"
@@ -62,6 +64,8 @@ class HpackHeaderTablePeer {
     return table_->Evict(count);
   }
 
+  // Adds an entry which references |name| and |value| rather than table
+  // storage. It must not be evicted.
   void AddDynamicEntry(StringPiece name, StringPiece value) {
     table_->dynamic_entries_.push_back(
         HpackEntry(name, value, false, table_->total_insertions_++));
@@ -81,11 +85,16 @@ class HpackHeaderTableTest : public ::testing::Test {
 
   HpackHeaderTableTest() : table_(), peer_(&table_) {}
 
-  // Returns an entry whose Size() is equal to the given one.
-  static HpackEntry MakeEntryOfSize(uint32 size) {
+  // Returns an entry whose Size() is equal to the given one. Its name and
+  // value are held by |entry_storage_|.
+  HpackEntry MakeEntryOfSize(uint32 size) {
     EXPECT_GE(size, HpackEntry::kSizeOverhead);
-    string name((size - HpackEntry::kSizeOverhead) / 2, 'n');
-    string value(size - HpackEntry::kSizeOverhead - name.size(), 'v');
+    entry_storage_.push_back(
+        string((size - HpackEntry::kSizeOverhead) / 2, 'n'));
+    const string& name = entry_storage_.back();
+    entry_storage_.push_back(
+        string(size - HpackEntry::kSizeOverhead - name.size(), 'v'));
+    const string& value = entry_storage_.back();
     HpackEntry entry(name, value);
     EXPECT_EQ(size, entry.Size());
     return entry;
@@ -93,7 +102,7 @@ class HpackHeaderTableTest : public ::testing::Test {
 
   // Returns a vector of entries whose total size is equal to the given
   // one.
-  static HpackEntryVector MakeEntriesOfTotalSize(uint32 total_size) {
+  HpackEntryVector MakeEntriesOfTotalSize(uint32 total_size) {
     EXPECT_GE(total_size, HpackEntry::kSizeOverhead);
     uint32 entry_size = HpackEntry::kSizeOverhead;
     uint32 remaining_size = total_size;
@@ -131,11 +140,14 @@ class HpackHeaderTableTest : public ::testing::Test {
     }
   }
 
-  HpackEntry DynamicEntry(string name, string value) {
+  HpackEntry DynamicEntry(StringPiece name, StringPiece value) {
     peer_.AddDynamicEntry(name, value);
     return peer_.dynamic_entries().back();
   }
 
+  // Backs the names and values of entries made by MakeEntryOfSize().
+  std::deque<string> entry_storage_;
+
   HpackHeaderTable table_;
   test::HpackHeaderTablePeer peer_;
 };
@@ -408,6 +420,49 @@ TEST_F(HpackHeaderTableTest, TryAddTooLargeEntry) {
   EXPECT_EQ(0u, peer_.dynamic_entries().size());
 }
 
+// Entries keep their names and values as the storage they reference is
+// reclaimed and grown.
+TEST_F(HpackHeaderTableTest, TryAddEntryReclaimsStorage) {
+  for (int i = 0; i != 1000; ++i) {
+    if (i == 500) {
+      table_.SetSettingsHeaderTableSize(2 * kDefaultHeaderTableSizeSetting);
+      table_.SetMaxSize(2 * kDefaultHeaderTableSizeSetting);
+    }
+    EXPECT_TRUE(table_.TryAddEntry("name-" + base::IntToString(i),
+                                   string(i % 97, 'v')));
+
+    for (size_t j = 0; j != peer_.dynamic_entries_count(); ++j) {
+      // Static table has 61 entries, dynamic entries follow those.
+      const HpackEntry* entry = table_.GetByIndex(62 + j);
+      EXPECT_EQ("name-" + base::IntToString(i - j), entry->name());
+      EXPECT_EQ(string((i - j) % 97, 'v'), entry->value());
+    }
+  }
+}
+
+// An entry may be added with the name and value of an entry which its
+// insertion evicts.
+TEST_F(HpackHeaderTableTest, TryAddEntryFromEvictedEntry) {
+  // Three entries fit in the table, and the storage holds the data of eight
+  // before the ninth reclaims it.
+  const string value(1000 - 6, 'v');
+  for (int i = 0; i != 8; ++i) {
+    EXPECT_TRUE(table_.TryAddEntry("name-" + base::IntToString(i), value));
+  }
+  EXPECT_EQ(3u, peer_.dynamic_entries_count());
+  const HpackEntry* oldest_entry = table_.GetByIndex(61 + 3);
+  EXPECT_EQ("name-5", oldest_entry->name());
+  EXPECT_EQ(1u, peer_.EvictionCountForEntry(oldest_entry->name(),
+                                            oldest_entry->value()));
+
+  const HpackEntry* entry = table_.TryAddEntry(oldest_entry->name(),
+                                               oldest_entry->value());
+  EXPECT_EQ("name-5", entry->name());
+  EXPECT_EQ(value, entry->value());
+  EXPECT_EQ(3u, peer_.dynamic_entries_count());
+  EXPECT_EQ("name-6", table_.GetByIndex(61 + 3)->name());
+}
+
 TEST_F(HpackHeaderTableTest, ComparatorNameOrdering) {
   HpackEntry entry1("header", "value");
   HpackEntry entry2("HEADER", "value");
@@ -5,11 +5,9 @@
 #include "net/spdy/hpack_huffman_table.h"
 
 #include <algorithm>
-#include <cmath>
 
 #include "base/logging.h"
 #include "base/numerics/safe_conversions.h"
-#include "net/spdy/hpack_input_stream.h"
 #include "net/spdy/hpack_output_stream.h"
 
 namespace net {
@@ -19,10 +17,10 @@ using std::string;
 
 namespace {
 
-// How many bits to index in the root decode table.
-const uint8 kDecodeTableRootBits = 9;
-// Maximum number of bits to index in successive decode tables.
-const uint8 kDecodeTableBranchBits = 6;
+// Children of a code tree node are internal nodes (which are never the root,
+// so zero marks an absent child) or symbols tagged with kLeafFlag.
+const uint32 kNoChild = 0;
+const uint32 kLeafFlag = 1u << 31;
 
 bool SymbolLengthAndIdCompare(const HpackHuffmanSymbol& a,
                               const HpackHuffmanSymbol& b) {
@@ -38,16 +36,17 @@ bool SymbolIdCompare(const HpackHuffmanSymbol& a,
 
 }  // namespace
 
-HpackHuffmanTable::DecodeEntry::DecodeEntry()
-  : next_table_index(0), length(0), symbol_id(0) {
+HpackHuffmanTable::DecodeTransition::DecodeTransition()
+  : next_state(0), symbol_count(0), failed(false), symbols_offset(0) {
 }
-HpackHuffmanTable::DecodeEntry::DecodeEntry(uint8 next_table_index,
-                                            uint8 length,
-                                            uint16 symbol_id)
-  : next_table_index(next_table_index), length(length), symbol_id(symbol_id) {
-}
-size_t HpackHuffmanTable::DecodeTable::size() const {
-  return size_t(1) << indexed_length;
+HpackHuffmanTable::DecodeTransition::DecodeTransition(uint16 next_state,
+                                                      uint8 symbol_count,
+                                                      bool failed,
+                                                      uint32 symbols_offset)
+  : next_state(next_state),
+    symbol_count(symbol_count),
+    failed(failed),
+    symbols_offset(symbols_offset) {
 }
 
 HpackHuffmanTable::HpackHuffmanTable() {}
@@ -97,7 +96,7 @@ bool HpackHuffmanTable::Initialize(const HpackHuffmanSymbol* input_symbols,
   }
   pad_bits_ = static_cast<uint8>(symbols.back().code >> 24);
 
-  BuildDecodeTables(symbols);
+  BuildDecodeStates(symbols);
   // Order on symbol ID ascending.
   std::sort(symbols.begin(), symbols.end(), SymbolIdCompare);
   BuildEncodeTable(symbols);
@@ -113,106 +112,63 @@ void HpackHuffmanTable::BuildEncodeTable(const std::vector<Symbol>& symbols) {
   }
 }
 
-void HpackHuffmanTable::BuildDecodeTables(const std::vector<Symbol>& symbols) {
-  AddDecodeTable(0, kDecodeTableRootBits);
-  // We wish to maximize the flatness of the DecodeTable hierarchy (subject to
-  // the |kDecodeTableBranchBits| constraint), and to minimize the size of
-  // child tables. To achieve this, we iterate in order of descending code
-  // length. This ensures that child tables are visited with their longest
-  // entry first, and that the child can therefore be minimally sized to hold
-  // that entry without fear of introducing unneccesary branches later.
-  for (std::vector<Symbol>::const_reverse_iterator it = symbols.rbegin();
-       it != symbols.rend(); ++it) {
-    uint8 table_index = 0;
-    while (true) {
-      const DecodeTable table = decode_tables_[table_index];
-
-      // Mask and shift the portion of the code being indexed into low bits.
-      uint32 index = (it->code << table.prefix_length);
-      index = index >> (32 - table.indexed_length);
-
-      CHECK_LT(index, table.size());
-      DecodeEntry entry = Entry(table, index);
-
-      uint8 total_indexed = table.prefix_length + table.indexed_length;
-      if (total_indexed >= it->length) {
-        // We're writing a terminal entry.
-        entry.length = it->length;
-        entry.symbol_id = it->id;
-        entry.next_table_index = table_index;
-        SetEntry(table, index, entry);
-        break;
-      }
-
-      if (entry.length == 0) {
-        // First visit to this placeholder. We need to create a new table.
-        CHECK_EQ(entry.next_table_index, 0);
-        entry.length = it->length;
-        entry.next_table_index = AddDecodeTable(
-            total_indexed,  // Becomes the new table prefix.
-            std::min<uint8>(kDecodeTableBranchBits,
-                            entry.length - total_indexed));
-        SetEntry(table, index, entry);
+void HpackHuffmanTable::BuildDecodeStates(const std::vector<Symbol>& symbols) {
+  // Build the code tree, having two children for each internal node.
+  std::vector<uint32> children(2, kNoChild);
+  state_depths_.push_back(0);
+  for (size_t i = 0; i != symbols.size(); i++) {
+    const Symbol& symbol = symbols[i];
+    uint32 node = 0;
+    for (uint8 depth = 0; depth != symbol.length; depth++) {
+      uint32* child = &children[2 * node + ((symbol.code >> (31 - depth)) & 1)];
+      // Codes are canonical, and therefore prefix-free.
+      CHECK_EQ(0u, *child & kLeafFlag);
+      if (depth + 1 == symbol.length) {
+        CHECK_EQ(kNoChild, *child);
+        *child = kLeafFlag | symbol.id;
+      } else {
+        node = *child;
+        if (node == kNoChild) {
+          node = static_cast<uint32>(state_depths_.size());
+          *child = node;
+          state_depths_.push_back(depth + 1);
+          // Invalidates |child|.
+          children.resize(children.size() + 2, kNoChild);
+        }
       }
-      CHECK_NE(entry.next_table_index, table_index);
-      table_index = entry.next_table_index;
     }
   }
-  // Fill shorter table entries into the additional entry spots they map to.
-  for (size_t i = 0; i != decode_tables_.size(); i++) {
-    const DecodeTable& table = decode_tables_[i];
-    uint8 total_indexed = table.prefix_length + table.indexed_length;
-
-    size_t j = 0;
-    while (j != table.size()) {
-      const DecodeEntry& entry = Entry(table, j);
-      if (entry.length != 0 && entry.length < total_indexed) {
-        // The difference between entry & table bit counts tells us how
-        // many additional entries map to this one.
-        size_t fill_count = 1 << (total_indexed - entry.length);
-        CHECK_LE(j + fill_count, table.size());
-
-        for (size_t k = 1; k != fill_count; k++) {
-          CHECK_EQ(Entry(table, j + k).length, 0);
-          SetEntry(table, j + k, entry);
+  CHECK_LE(state_depths_.size(), 1u + kuint16max);
+
+  // Walk the tree from every state for every nibble, recording the symbols
+  // completed along the way.
+  for (uint32 state = 0; state != state_depths_.size(); state++) {
+    for (uint8 nibble = 0; nibble != 16; nibble++) {
+      uint32 node = state;
+      uint32 symbols_offset = static_cast<uint32>(decode_symbols_.size());
+      bool failed = false;
+      for (int bit = 3; bit >= 0; bit--) {
+        uint32 child = children[2 * node + ((nibble >> bit) & 1)];
+        if (child == kNoChild) {
+          failed = true;
+          break;
+        }
+        if (child & kLeafFlag) {
+          decode_symbols_.push_back(static_cast<uint16>(child & ~kLeafFlag));
+          node = 0;
+        } else {
+          node = child;
         }
-        j += fill_count;
-      } else {
-        j++;
       }
+      decode_transitions_.push_back(DecodeTransition(
+          static_cast<uint16>(node),
+          static_cast<uint8>(decode_symbols_.size() - symbols_offset),
+          failed,
+          symbols_offset));
     }
   }
 }
 
-uint8 HpackHuffmanTable::AddDecodeTable(uint8 prefix, uint8 indexed) {
-  CHECK_LT(decode_tables_.size(), 255u);
-  {
-    DecodeTable table;
-    table.prefix_length = prefix;
-    table.indexed_length = indexed;
-    table.entries_offset = decode_entries_.size();
-    decode_tables_.push_back(table);
-  }
-  decode_entries_.resize(decode_entries_.size() + (size_t(1) << indexed));
-  return static_cast<uint8>(decode_tables_.size() - 1);
-}
-
-const HpackHuffmanTable::DecodeEntry& HpackHuffmanTable::Entry(
-    const DecodeTable& table,
-    uint32 index) const {
-  DCHECK_LT(index, table.size());
-  DCHECK_LT(table.entries_offset + index, decode_entries_.size());
-  return decode_entries_[table.entries_offset + index];
-}
-
-void HpackHuffmanTable::SetEntry(const DecodeTable& table,
-                                 uint32 index,
-                                 const DecodeEntry& entry) {
-  CHECK_LT(index, table.size());
-  CHECK_LT(table.entries_offset + index, decode_entries_.size());
-  decode_entries_[table.entries_offset + index] = entry;
-}
-
 bool HpackHuffmanTable::IsInitialized() const {
   return !code_by_id_.empty();
 }
@@ -264,62 +220,43 @@ size_t HpackHuffmanTable::EncodedSize(StringPiece in) const {
   return bit_count / 8;
 }
 
-bool HpackHuffmanTable::DecodeString(HpackInputStream* in,
+bool HpackHuffmanTable::DecodeString(StringPiece in,
                                      size_t out_capacity,
                                      string* out) const {
-  // Number of decode iterations required for a 32-bit code.
-  const int kDecodeIterations = static_cast<int>(
-      std::ceil((32.f - kDecodeTableRootBits) / kDecodeTableBranchBits));
-
   out->clear();
 
-  // Current input, stored in the high |bits_available| bits of |bits|.
-  uint32 bits = 0;
-  size_t bits_available = 0;
-  bool peeked_success = in->PeekBits(&bits_available, &bits);
-
-  while (true) {
-    const DecodeTable* table = &decode_tables_[0];
-    uint32 index = bits >> (32 - kDecodeTableRootBits);
-
-    for (int i = 0; i != kDecodeIterations; i++) {
-      DCHECK_LT(index, table->size());
-      DCHECK_LT(Entry(*table, index).next_table_index, decode_tables_.size());
-
-      table = &decode_tables_[Entry(*table, index).next_table_index];
-      // Mask and shift the portion of the code being indexed into low bits.
-      index = (bits << table->prefix_length) >> (32 - table->indexed_length);
+  uint16 state = 0;
+  for (size_t i = 0; i != in.size(); i++) {
+    uint8 byte = static_cast<uint8>(in[i]);
+    if (!DecodeNibble(byte >> 4, out_capacity, &state, out) ||
+        !DecodeNibble(byte & 0xf, out_capacity, &state, out)) {
+      return false;
     }
-    const DecodeEntry& entry = Entry(*table, index);
+  }
+  // Bits of an incomplete trailing code are padding, which must not fill a
+  // whole byte.
+  return state_depths_[state] < 8;
+}
 
-    if (entry.length > bits_available) {
-      if (!peeked_success) {
-        // Unable to read enough input for a match. If only a portion of
-        // the last byte remains, this is a successful EOF condition.
-        in->ConsumeByteRemainder();
-        return !in->HasMoreData();
-      }
-    } else if (entry.length == 0) {
-      // The input is an invalid prefix, larger than any prefix in the table.
+bool HpackHuffmanTable::DecodeNibble(uint8 nibble,
+                                     size_t out_capacity,
+                                     uint16* state,
+                                     string* out) const {
+  const DecodeTransition& transition =
+      decode_transitions_[(static_cast<size_t>(*state) << 4) | nibble];
+  for (uint8 i = 0; i != transition.symbol_count; i++) {
+    if (out->size() == out_capacity) {
+      // This code would cause us to overflow |out_capacity|.
       return false;
-    } else {
-      if (out->size() == out_capacity) {
-        // This code would cause us to overflow |out_capacity|.
-        return false;
-      }
-      if (entry.symbol_id < 256) {
-        // Assume symbols >= 256 are used for padding.
-        out->push_back(static_cast<char>(entry.symbol_id));
-      }
-
-      in->ConsumeBits(entry.length);
-      bits = bits << entry.length;
-      bits_available -= entry.length;
     }
-    peeked_success = in->PeekBits(&bits_available, &bits);
+    uint16 symbol_id = decode_symbols_[transition.symbols_offset + i];
+    if (symbol_id < 256) {
+      // Assume symbols >= 256 are used for padding.
+      out->push_back(static_cast<char>(symbol_id));
+    }
   }
-  NOTREACHED();
-  return false;
+  *state = transition.next_state;
+  return !transition.failed;
 }
 
 }  // namespace net
@@ -20,7 +20,6 @@ namespace test {
 class HpackHuffmanTablePeer;
 }  // namespace test
 
-class HpackInputStream;
 class HpackOutputStream;
 
 // HpackHuffmanTable encodes and decodes string literals using a constructed
@@ -32,33 +31,27 @@ class NET_EXPORT_PRIVATE HpackHuffmanTable {
 
   typedef HpackHuffmanSymbol Symbol;
 
-  // DecodeTables are multilevel indexes on code prefixes. Each table indexes
-  // a portion of the prefix mapped to DecodeEntry, which in turn either
-  // captures a terminal symbol, or points to the next DecodeTable to consult
-  // with successive portions of the prefix.
-  struct NET_EXPORT_PRIVATE DecodeEntry {
-    DecodeEntry();
-    DecodeEntry(uint8 next_table_index, uint8 length, uint16 symbol_id);
-
-    // The next table to consult. If this is a terminal,
-    // |next_table_index| will be self-referential.
-    uint8 next_table_index;
-    // Bit-length of terminal code, if this is a terminal. Length of the
-    // longest code having this prefix, if non-terminal.
-    uint8 length;
-    // Set only for terminal entries.
-    uint16 symbol_id;
-  };
-  struct NET_EXPORT_PRIVATE DecodeTable {
-    // Number of bits indexed by the chain leading to this table.
-    uint8 prefix_length;
-    // Number of additional prefix bits this table indexes.
-    uint8 indexed_length;
-    // Entries are represented as a length |size()| slice into
-    // |decode_entries_| beginning at |entries_offset|.
-    size_t entries_offset;
-    // Returns |1 << indexed_length|.
-    size_t size() const;
+  // Input is decoded a nibble at a time by a state machine. Its states are
+  // the internal nodes of the code tree, i.e. the prefixes of codes which have
+  // been read but not yet completed, with state 0 being the empty prefix. A
+  // DecodeTransition describes the effect of one nibble in one state.
+  struct NET_EXPORT_PRIVATE DecodeTransition {
+    DecodeTransition();
+    DecodeTransition(uint16 next_state,
+                     uint8 symbol_count,
+                     bool failed,
+                     uint32 symbols_offset);
+
+    // State reached once the nibble is consumed.
+    uint16 next_state;
+    // Number of symbols the nibble completes. They are represented as a
+    // length |symbol_count| slice into |decode_symbols_| beginning at
+    // |symbols_offset|.
+    uint8 symbol_count;
+    // Whether the nibble leads to a code prefix which is not in the table.
+    // Symbols completed before the invalid bit are still emitted.
+    bool failed;
+    uint32 symbols_offset;
   };
 
   HpackHuffmanTable();
@@ -81,33 +74,34 @@ class NET_EXPORT_PRIVATE HpackHuffmanTable {
   // Returns the encoded size of the input string.
   size_t EncodedSize(base::StringPiece in) const;
 
-  // Decodes symbols from |in| into |out|. It is the caller's responsibility
-  // to ensure |out| has a reserved a sufficient buffer to hold decoded output.
-  // DecodeString() halts when |in| runs out of input, in which case true is
-  // returned. It also halts (returning false) if an invalid Huffman code
-  // prefix is read, or if |out_capacity| would otherwise be overflowed.
-  bool DecodeString(HpackInputStream* in,
+  // Decodes symbols from |in| into |out|, replacing its contents. Returns
+  // true if all of |in| is decoded, and the bits following the last complete
+  // code are fewer than eight. Halts, returning false, if an invalid Huffman
+  // code prefix is read, or if |out_capacity| would otherwise be overflowed.
+  bool DecodeString(base::StringPiece in,
                     size_t out_capacity,
                     std::string* out) const;
 
  private:
   // Expects symbols ordered on length & ID ascending.
-  void BuildDecodeTables(const std::vector<Symbol>& symbols);
+  void BuildDecodeStates(const std::vector<Symbol>& symbols);
 
   // Expects symbols ordered on ID ascending.
   void BuildEncodeTable(const std::vector<Symbol>& symbols);
 
-  // Adds a new DecodeTable with the argument prefix & indexed length.
-  // Returns the new table index.
-  uint8 AddDecodeTable(uint8 prefix, uint8 indexed);
-
-  const DecodeEntry& Entry(const DecodeTable& table, uint32 index) const;
-
-  void SetEntry(const DecodeTable& table, uint32 index,
-                const DecodeEntry& entry);
+  // Applies the transition of |nibble| from |*state|, appending completed
+  // symbols to |out|. Returns false if the input is invalid or overflows
+  // |out_capacity|.
+  bool DecodeNibble(uint8 nibble,
+                    size_t out_capacity,
+                    uint16* state,
+                    std::string* out) const;
 
-  std::vector<DecodeTable> decode_tables_;
-  std::vector<DecodeEntry> decode_entries_;
+  // Transitions of state |i| on nibble |j| are at index |(i << 4) | j|.
+  std::vector<DecodeTransition> decode_transitions_;
+  std::vector<uint16> decode_symbols_;
+  // The number of code bits each state has consumed.
+  std::vector<uint8> state_depths_;
 
   // Symbol code and code length, in ascending symbol ID order.
   // Codes are stored in the most-significant bits of the word.
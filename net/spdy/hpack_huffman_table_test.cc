@@ -9,7 +9,6 @@
 
 #include "base/logging.h"
 #include "net/spdy/hpack_constants.h"
-#include "net/spdy/hpack_input_stream.h"
 #include "net/spdy/hpack_output_stream.h"
 #include "net/spdy/spdy_test_utils.h"
 #include "testing/gmock/include/gmock/gmock.h"
@@ -20,14 +19,12 @@ using net::test::a2b_hex;
 using std::string;
 using testing::ElementsAre;
 using testing::ElementsAreArray;
-using testing::Pointwise;
 
 namespace net {
 
 namespace test {
 
-typedef HpackHuffmanTable::DecodeEntry DecodeEntry;
-typedef HpackHuffmanTable::DecodeTable DecodeTable;
+typedef HpackHuffmanTable::DecodeTransition DecodeTransition;
 
 class HpackHuffmanTablePeer {
  public:
@@ -40,8 +37,8 @@ class HpackHuffmanTablePeer {
   const std::vector<uint8>& length_by_id() const {
     return table_.length_by_id_;
   }
-  const std::vector<DecodeTable>& decode_tables() const {
-    return table_.decode_tables_;
+  const std::vector<uint8>& state_depths() const {
+    return table_.state_depths_;
   }
   char pad_bits() const {
     // Cast to match signed-ness of bits8().
@@ -50,36 +47,18 @@ class HpackHuffmanTablePeer {
   uint16 failed_symbol_id() const {
     return table_.failed_symbol_id_;
   }
-  std::vector<DecodeEntry> decode_entries(const DecodeTable& decode_table) {
-    std::vector<DecodeEntry>::const_iterator begin =
-        table_.decode_entries_.begin() + decode_table.entries_offset;
-    return std::vector<DecodeEntry>(begin, begin + decode_table.size());
+  const DecodeTransition& transition(uint16 state, uint8 nibble) const {
+    return table_.decode_transitions_[(state << 4) | nibble];
   }
-  void DumpDecodeTable(const DecodeTable& table) {
-    std::vector<DecodeEntry> entries = decode_entries(table);
-    LOG(INFO) << "Table size " << (1 << table.indexed_length)
-              << " prefix " << unsigned(table.prefix_length)
-              << " indexed " << unsigned(table.indexed_length);
-    size_t i = 0;
-    while (i != table.size()) {
-      const DecodeEntry& entry = entries[i];
-      LOG(INFO) << i << ":"
-                << " next_table " << unsigned(entry.next_table_index)
-                << " length " << unsigned(entry.length)
-                << " symbol " << unsigned(entry.symbol_id);
-      size_t j = 1;
-      for (; (i + j) != table.size(); j++) {
-        const DecodeEntry& next = entries[i + j];
-        if (next.next_table_index != entry.next_table_index ||
-            next.length != entry.length ||
-            next.symbol_id != entry.symbol_id)
-          break;
-      }
-      if (j > 1) {
-        LOG(INFO) << "  (repeats " << j << " times)";
-      }
-      i += j;
+  // Returns the symbols completed by a transition, which must all be < 256.
+  string transition_symbols(uint16 state, uint8 nibble) const {
+    const DecodeTransition& decode_transition = transition(state, nibble);
+    string symbols;
+    for (uint8 i = 0; i != decode_transition.symbol_count; ++i) {
+      symbols.push_back(static_cast<char>(
+          table_.decode_symbols_[decode_transition.symbols_offset + i]));
     }
+    return symbols;
   }
 
  private:
@@ -109,14 +88,6 @@ class HpackHuffmanTableTest : public ::testing::Test {
   HpackHuffmanTablePeer peer_;
 };
 
-MATCHER(DecodeEntryEq, "") {
-  const DecodeEntry& lhs = std::tr1::get<0>(arg);
-  const DecodeEntry& rhs = std::tr1::get<1>(arg);
-  return lhs.next_table_index == rhs.next_table_index &&
-      lhs.length == rhs.length &&
-      lhs.symbol_id == rhs.symbol_id;
-}
-
 uint32 bits32(const string& bitstring) {
   return std::bitset<32>(bitstring).to_ulong();
 }
@@ -245,22 +216,30 @@ TEST_F(HpackHuffmanTableTest, ValidateInternalsWithSmallCode) {
     EXPECT_EQ(code[i].length, peer_.length_by_id()[i]);
   }
 
-  EXPECT_EQ(1u, peer_.decode_tables().size());
-  {
-    std::vector<DecodeEntry> expected;
-    expected.resize(128, DecodeEntry(0, 2, 2));  // Fills 128.
-    expected.resize(192, DecodeEntry(0, 3, 3));  // Fills 64.
-    expected.resize(224, DecodeEntry(0, 4, 0));  // Fills 32.
-    expected.resize(256, DecodeEntry(0, 4, 1));  // Fills 32.
-    expected.resize(272, DecodeEntry(0, 5, 4));  // Fills 16.
-    expected.resize(288, DecodeEntry(0, 5, 5));  // Fills 16.
-    expected.resize(304, DecodeEntry(0, 5, 7));  // Fills 16.
-    expected.resize(306, DecodeEntry(0, 8, 6));  // Fills 2.
-    expected.resize(512, DecodeEntry());  // Remainder is empty.
-
-    EXPECT_THAT(peer_.decode_entries(peer_.decode_tables()[0]),
-                Pointwise(DecodeEntryEq(), expected));
-  }
+  // States are the code prefixes "", "0", "01", "011", "1", "10", "100",
+  // "1000", "1001", "10011", "100110" and "1001100".
+  const uint8 kExpectedDepths[] = {0, 1, 2, 3, 1, 2, 3, 4, 4, 5, 6, 7};
+  EXPECT_THAT(peer_.state_depths(), ElementsAreArray(kExpectedDepths));
+
+  // (2) 00 (2) 00.
+  EXPECT_EQ("\x02\x02", peer_.transition_symbols(0, 0x0));
+  EXPECT_EQ(0, peer_.transition(0, 0x0).next_state);
+  EXPECT_FALSE(peer_.transition(0, 0x0).failed);
+  // (3) 010, then a prefix 0.
+  EXPECT_EQ("\x03", peer_.transition_symbols(0, 0x4));
+  EXPECT_EQ(1, peer_.transition(0, 0x4).next_state);
+  // Only a prefix 1001.
+  EXPECT_EQ("", peer_.transition_symbols(0, 0x9));
+  EXPECT_EQ(8, peer_.transition(0, 0x9).next_state);
+  // (6) completes from the 1001 prefix with 1000.
+  EXPECT_EQ("\x06", peer_.transition_symbols(8, 0x8));
+  EXPECT_EQ(0, peer_.transition(8, 0x8).next_state);
+  // 101 is not a code prefix.
+  EXPECT_EQ("", peer_.transition_symbols(0, 0xa));
+  EXPECT_TRUE(peer_.transition(0, 0xa).failed);
+  // Nor is 10011001.
+  EXPECT_TRUE(peer_.transition(11, 0x8).failed);
+
   EXPECT_EQ(bits8("10011000"), peer_.pad_bits());
 
   char input_storage[] = {2, 3, 2, 7, 4};
@@ -276,12 +255,11 @@ TEST_F(HpackHuffmanTableTest, ValidateInternalsWithSmallCode) {
   EXPECT_EQ(expect, buffer_in);
 
   string buffer_out;
-  HpackInputStream input_stream(kuint32max, buffer_in);
-  EXPECT_TRUE(table_.DecodeString(&input_stream, input.size(),  &buffer_out));
+  EXPECT_TRUE(table_.DecodeString(buffer_in, input.size(),  &buffer_out));
   EXPECT_EQ(buffer_out, input);
 }
 
-TEST_F(HpackHuffmanTableTest, ValidateMultiLevelDecodeTables) {
+TEST_F(HpackHuffmanTableTest, ValidateDecodeStatesWithLongCodes) {
   HpackHuffmanSymbol code[] = {
     {bits32("00000000000000000000000000000000"), 6, 0},
     {bits32("00000100000000000000000000000000"), 6, 1},
@@ -291,34 +269,21 @@ TEST_F(HpackHuffmanTableTest, ValidateMultiLevelDecodeTables) {
   };
   EXPECT_TRUE(table_.Initialize(code, arraysize(code)));
 
-  EXPECT_EQ(2u, peer_.decode_tables().size());
-  {
-    std::vector<DecodeEntry> expected;
-    expected.resize(8, DecodeEntry(0, 6, 0));  // Fills 8.
-    expected.resize(16, DecodeEntry(0, 6, 1));  // Fills 8.
-    expected.resize(17, DecodeEntry(1, 12, 0));  // Pointer. Fills 1.
-    expected.resize(512, DecodeEntry());  // Remainder is empty.
-
-    const DecodeTable& decode_table = peer_.decode_tables()[0];
-    EXPECT_EQ(decode_table.prefix_length, 0);
-    EXPECT_EQ(decode_table.indexed_length, 9);
-    EXPECT_THAT(peer_.decode_entries(decode_table),
-                Pointwise(DecodeEntryEq(), expected));
-  }
-  {
-    std::vector<DecodeEntry> expected;
-    expected.resize(2, DecodeEntry(1, 11, 2));  // Fills 2.
-    expected.resize(4, DecodeEntry(1, 11, 3));  // Fills 2.
-    expected.resize(5, DecodeEntry(1, 12, 4));  // Fills 1.
-    expected.resize(8, DecodeEntry());  // Remainder is empty.
-
-    const DecodeTable& decode_table = peer_.decode_tables()[1];
-    EXPECT_EQ(decode_table.prefix_length, 9);
-    EXPECT_EQ(decode_table.indexed_length, 3);
-    EXPECT_THAT(peer_.decode_entries(decode_table),
-                Pointwise(DecodeEntryEq(), expected));
-  }
+  // One state for each proper prefix of a code: six for the prefixes of
+  // 00000, and eight more for those extending 00001.
+  EXPECT_EQ(14u, peer_.state_depths().size());
+  EXPECT_EQ(11, peer_.state_depths().back());
   EXPECT_EQ(bits8("00001000"), peer_.pad_bits());
+
+  // Codes spanning three nibbles decode across transitions.
+  char input_storage[] = {4, 2, 3, 0, 4, 1};
+  StringPiece input(input_storage, arraysize(input_storage));
+  string buffer_in = EncodeString(input);
+  EXPECT_EQ(8u, buffer_in.size());
+
+  string buffer_out;
+  EXPECT_TRUE(table_.DecodeString(buffer_in, input.size(), &buffer_out));
+  EXPECT_EQ(input, buffer_out);
 }
 
 TEST_F(HpackHuffmanTableTest, DecodeWithBadInput) {
@@ -341,8 +306,7 @@ TEST_F(HpackHuffmanTableTest, DecodeWithBadInput) {
     char input_storage[] = {bits8("00010001"), bits8("00110100")};
     StringPiece input(input_storage, arraysize(input_storage));
 
-    HpackInputStream input_stream(kuint32max, input);
-    EXPECT_TRUE(table_.DecodeString(&input_stream, capacity, &buffer));
+    EXPECT_TRUE(table_.DecodeString(input, capacity, &buffer));
     EXPECT_EQ(buffer, "\x02\x03\x02\x06");
   }
   {
@@ -351,8 +315,7 @@ TEST_F(HpackHuffmanTableTest, DecodeWithBadInput) {
     char input_storage[] = {bits8("00010001"), bits8("01000111")};
     StringPiece input(input_storage, arraysize(input_storage));
 
-    HpackInputStream input_stream(kuint32max, input);
-    EXPECT_FALSE(table_.DecodeString(&input_stream, capacity, &buffer));
+    EXPECT_FALSE(table_.DecodeString(input, capacity, &buffer));
     EXPECT_EQ(buffer, "\x02\x03\x02");
   }
   {
@@ -360,8 +323,7 @@ TEST_F(HpackHuffmanTableTest, DecodeWithBadInput) {
     std::vector<char> input_storage(1 + capacity / 4, '\0');
     StringPiece input(&input_storage[0], input_storage.size());
 
-    HpackInputStream input_stream(kuint32max, input);
-    EXPECT_FALSE(table_.DecodeString(&input_stream, capacity, &buffer));
+    EXPECT_FALSE(table_.DecodeString(input, capacity, &buffer));
 
     std::vector<char> expected(capacity, '\x02');
     EXPECT_THAT(buffer, ElementsAreArray(expected));
@@ -373,8 +335,7 @@ TEST_F(HpackHuffmanTableTest, DecodeWithBadInput) {
     char input_storage[] = {bits8("10011010"), bits8("01110000")};
     StringPiece input(input_storage, arraysize(input_storage));
 
-    HpackInputStream input_stream(kuint32max, input);
-    EXPECT_FALSE(table_.DecodeString(&input_stream, capacity, &buffer));
+    EXPECT_FALSE(table_.DecodeString(input, capacity, &buffer));
     EXPECT_EQ(buffer, "\x06");
   }
 }
@@ -398,9 +359,7 @@ TEST_F(HpackHuffmanTableTest, SpecRequestExamples) {
   for (size_t i = 0; i != arraysize(test_table); i += 2) {
     const string& encodedFixture(test_table[i]);
     const string& decodedFixture(test_table[i+1]);
-    HpackInputStream input_stream(kuint32max, encodedFixture);
-
-    EXPECT_TRUE(table_.DecodeString(&input_stream, decodedFixture.size(),
+    EXPECT_TRUE(table_.DecodeString(encodedFixture, decodedFixture.size(),
                                     &buffer));
     EXPECT_EQ(decodedFixture, buffer);
     buffer = EncodeString(decodedFixture);
@@ -433,9 +392,7 @@ TEST_F(HpackHuffmanTableTest, SpecResponseExamples) {
   for (size_t i = 0; i != arraysize(test_table); i += 2) {
     const string& encodedFixture(test_table[i]);
     const string& decodedFixture(test_table[i+1]);
-    HpackInputStream input_stream(kuint32max, encodedFixture);
-
-    EXPECT_TRUE(table_.DecodeString(&input_stream, decodedFixture.size(),
+    EXPECT_TRUE(table_.DecodeString(encodedFixture, decodedFixture.size(),
                                     &buffer));
     EXPECT_EQ(decodedFixture, buffer);
     buffer = EncodeString(decodedFixture);
@@ -455,8 +412,7 @@ TEST_F(HpackHuffmanTableTest, RoundTripIndvidualSymbols) {
     string buffer_in = EncodeString(input);
     string buffer_out;
 
-    HpackInputStream input_stream(kuint32max, buffer_in);
-    EXPECT_TRUE(table_.DecodeString(&input_stream, input.size(), &buffer_out));
+    EXPECT_TRUE(table_.DecodeString(buffer_in, input.size(), &buffer_out));
     EXPECT_EQ(input, buffer_out);
   }
 }
@@ -476,8 +432,7 @@ TEST_F(HpackHuffmanTableTest, RoundTripSymbolSequence) {
   string buffer_in = EncodeString(input);
   string buffer_out;
 
-  HpackInputStream input_stream(kuint32max, buffer_in);
-  EXPECT_TRUE(table_.DecodeString(&input_stream, input.size(), &buffer_out));
+  EXPECT_TRUE(table_.DecodeString(buffer_in, input.size(), &buffer_out));
   EXPECT_EQ(input, buffer_out);
 }
 
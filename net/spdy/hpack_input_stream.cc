@@ -119,13 +119,11 @@ bool HpackInputStream::DecodeNextHuffmanString(const HpackHuffmanTable& table,
   if (encoded_size > buffer_.size())
     return false;
 
-  HpackInputStream bounded_reader(
-      max_string_literal_size_,
-      StringPiece(buffer_.data(), encoded_size));
+  StringPiece encoded(buffer_.data(), encoded_size);
   buffer_.remove_prefix(encoded_size);
 
   // HpackHuffmanTable will not decode beyond |max_string_literal_size_|.
-  return table.DecodeString(&bounded_reader, max_string_literal_size_, str);
+  return table.DecodeString(encoded, max_string_literal_size_, str);
 }
 
 bool HpackInputStream::PeekBits(size_t* peeked_count, uint32* out) {
@@ -31,6 +31,7 @@
 #include "net/quic/test_tools/reliable_quic_stream_peer.h"
 #include "net/test/gtest_util.h"
 #include "net/tools/epoll_server/epoll_server.h"
+#include "net/tools/quic/quic_batch_packet_writer.h"
 #include "net/tools/quic/quic_epoll_connection_helper.h"
 #include "net/tools/quic/quic_in_memory_cache.h"
 #include "net/tools/quic/quic_packet_writer_wrapper.h"
@@ -114,9 +115,7 @@ struct TestParams {
 vector<TestParams> GetTestParams() {
   vector<TestParams> params;
   QuicVersionVector all_supported_versions = QuicSupportedVersions();
-  // TODO(rtenneti): Add kTBBR after BBR code is checked in.
-  // QuicTag congestion_control_tags[] = {kRENO, kTBBR, kQBIC};
-  QuicTag congestion_control_tags[] = {kRENO, kQBIC};
+  QuicTag congestion_control_tags[] = {kRENO, kTBBR, kQBIC};
   for (size_t congestion_control_index = 0;
        congestion_control_index < arraysize(congestion_control_tags);
        congestion_control_index++) {
@@ -582,6 +581,47 @@ TEST_P(EndToEndTest, LargePostNoPacketLoss1sRTT) {
   VerifyCleanConnection(false);
 }
 
+TEST_P(EndToEndTest, LargePostAvoidsBufferAllocationsAndCopies) {
+  ASSERT_TRUE(Initialize());
+
+  client_->client()->WaitForCryptoHandshakeConfirmed();
+
+  // 100 KB body.
+  string body;
+  GenerateBody(&body, 100 * 1024);
+
+  HTTPMessage request(HttpConstants::HTTP_1_1,
+                      HttpConstants::POST, "/foo");
+  request.AddBody(body, true);
+
+  EXPECT_EQ(kFooResponseBody, client_->SendCustomSynchronousRequest(request));
+
+  // Packets are encrypted in place, into the writer's buffer or the stack.
+  QuicConnectionStats client_stats =
+      client_->client()->session()->connection()->GetStats();
+  EXPECT_EQ(0u, client_stats.encrypt_buffers_allocated);
+
+  server_thread_->Pause();
+  QuicDispatcher* dispatcher =
+      QuicServerPeer::GetDispatcher(server_thread_->server());
+  ASSERT_EQ(1u, dispatcher->session_map().size());
+  QuicSession* session = dispatcher->session_map().begin()->second;
+  QuicConnectionStats server_stats = session->connection()->GetStats();
+  EXPECT_EQ(0u, server_stats.encrypt_buffers_allocated);
+  // The decryption buffer is reused once the stream frames release it, and
+  // in order stream data is handed to the stream without being buffered.
+  EXPECT_GT(server_stats.packets_processed,
+            4 * server_stats.decrypt_buffers_allocated);
+  EXPECT_LT(server_stats.stream_bytes_copied, body.length() / 10);
+  QuicBatchPacketWriter* batch_writer =
+      QuicServerPeer::GetBatchWriter(server_thread_->server());
+  if (batch_writer != nullptr) {
+    EXPECT_LT(batch_writer->num_packets_copied(),
+              batch_writer->num_packets_written());
+  }
+  server_thread_->Resume();
+}
+
 TEST_P(EndToEndTest, LargePostWithPacketLoss) {
   // Connect with lower fake packet loss than we'd like to test.  Until
   // b/10126687 is fixed, losing handshake packets is pretty brutal.
@@ -0,0 +1,141 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/tools/quic/quic_batch_packet_writer.h"
+
+#include <errno.h>
+#include <netinet/in.h>
+#include <string.h>
+
+#include "base/logging.h"
+#include "net/tools/quic/quic_socket_utils.h"
+
+namespace net {
+namespace tools {
+
+QuicBatchPacketWriter::QuicBatchPacketWriter(int fd)
+    : QuicDefaultPacketWriter(fd),
+      sendmmsg_supported_(true),
+      packets_(new BufferedPacket[kMaxBufferedPackets]),
+      mmsg_hdrs_(new mmsghdr[kMaxBufferedPackets]),
+      first_unsent_(0),
+      num_buffered_(0),
+      num_write_calls_(0),
+      num_packets_written_(0),
+      num_packets_copied_(0) {
+  memset(mmsg_hdrs_.get(), 0, kMaxBufferedPackets * sizeof(mmsghdr));
+  for (int i = 0; i < kMaxBufferedPackets; ++i) {
+    packets_[i].iov.iov_base = packets_[i].buffer;
+    msghdr* hdr = &mmsg_hdrs_[i].msg_hdr;
+    hdr->msg_name = &packets_[i].raw_address;
+    hdr->msg_iov = &packets_[i].iov;
+    hdr->msg_iovlen = 1;
+  }
+}
+
+QuicBatchPacketWriter::~QuicBatchPacketWriter() {
+  if (HasBufferedPackets()) {
+    DVLOG(1) << "Dropping " << num_buffered_ - first_unsent_
+             << " unsent packets.";
+  }
+}
+
+WriteResult QuicBatchPacketWriter::WritePacket(
+    const char* buffer,
+    size_t buf_len,
+    const IPAddressNumber& self_address,
+    const IPEndPoint& peer_address) {
+  DCHECK(!IsWriteBlocked());
+  if (buf_len > kMaxPacketSize) {
+    // Keep the packets in order.
+    if (!Flush())
+      return WriteResult(WRITE_STATUS_BLOCKED, EAGAIN);
+    ++num_write_calls_;
+    WriteResult result = QuicDefaultPacketWriter::WritePacket(
+        buffer, buf_len, self_address, peer_address);
+    if (result.status == WRITE_STATUS_OK)
+      ++num_packets_written_;
+    return result;
+  }
+  if (num_buffered_ == kMaxBufferedPackets && !Flush())
+    return WriteResult(WRITE_STATUS_BLOCKED, EAGAIN);
+  DCHECK_LT(num_buffered_, kMaxBufferedPackets);
+
+  BufferedPacket* packet = &packets_[num_buffered_];
+  msghdr* hdr = &mmsg_hdrs_[num_buffered_].msg_hdr;
+  socklen_t address_len = sizeof(packet->raw_address);
+  CHECK(peer_address.ToSockAddr(
+      reinterpret_cast<sockaddr*>(&packet->raw_address), &address_len));
+  hdr->msg_namelen = address_len;
+
+  if (buffer != packet->buffer) {
+    memcpy(packet->buffer, buffer, buf_len);
+    ++num_packets_copied_;
+  }
+  packet->iov.iov_len = buf_len;
+
+  if (self_address.empty()) {
+    hdr->msg_control = nullptr;
+    hdr->msg_controllen = 0;
+  } else {
+    hdr->msg_control = packet->cbuf;
+    hdr->msg_controllen = kSpaceForIp;
+    cmsghdr* cmsg = CMSG_FIRSTHDR(hdr);
+    QuicSocketUtils::SetIpInfoInCmsg(self_address, cmsg);
+    hdr->msg_controllen = cmsg->cmsg_len;
+  }
+  ++num_buffered_;
+
+  return WriteResult(WRITE_STATUS_OK, buf_len);
+}
+
+void QuicBatchPacketWriter::SetWritable() {
+  QuicDefaultPacketWriter::SetWritable();
+  Flush();
+}
+
+char* QuicBatchPacketWriter::GetNextWriteLocation() {
+  if (IsWriteBlocked() || num_buffered_ == kMaxBufferedPackets)
+    return nullptr;
+  return packets_[num_buffered_].buffer;
+}
+
+bool QuicBatchPacketWriter::Flush() {
+  while (HasBufferedPackets()) {
+    int packets_sent = SendBufferedPackets();
+    ++num_write_calls_;
+    if (packets_sent > 0) {
+      first_unsent_ += packets_sent;
+      num_packets_written_ += packets_sent;
+      continue;
+    }
+    if (errno == EINTR)
+      continue;
+    if (errno == EAGAIN || errno == EWOULDBLOCK) {
+      set_write_blocked(true);
+      return false;
+    }
+    // The kernel rejected the first packet. Drop it; QUIC recovers from the
+    // loss like any other.
+    DVLOG(1) << "Dropping packet: " << strerror(errno);
+    ++first_unsent_;
+  }
+  first_unsent_ = 0;
+  num_buffered_ = 0;
+  return true;
+}
+
+int QuicBatchPacketWriter::SendBufferedPackets() {
+  if (sendmmsg_supported_) {
+    int rc = sendmmsg(fd(), &mmsg_hdrs_[first_unsent_],
+                      num_buffered_ - first_unsent_, 0);
+    if (rc >= 0 || errno != ENOSYS)
+      return rc;
+    sendmmsg_supported_ = false;
+  }
+  return sendmsg(fd(), &mmsg_hdrs_[first_unsent_].msg_hdr, 0) < 0 ? -1 : 1;
+}
+
+}  // namespace tools
+}  // namespace net
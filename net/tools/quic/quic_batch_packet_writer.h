@@ -0,0 +1,98 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef NET_TOOLS_QUIC_QUIC_BATCH_PACKET_WRITER_H_
+#define NET_TOOLS_QUIC_QUIC_BATCH_PACKET_WRITER_H_
+
+#include <sys/socket.h>
+
+#include "base/basictypes.h"
+#include "base/memory/scoped_ptr.h"
+#include "net/base/ip_endpoint.h"
+#include "net/quic/quic_protocol.h"
+#include "net/tools/quic/quic_default_packet_writer.h"
+#include "net/tools/quic/quic_socket_utils.h"
+
+namespace net {
+namespace tools {
+
+// A packet writer that holds packets back and sends them with one sendmmsg()
+// call when Flush() is called. QuicServer flushes at the end of each epoll
+// iteration, so the packets that its connections write while handling one
+// round of events leave in a single system call.
+//
+// A packet that is held back is reported as written. If a flush finds the
+// socket full, the packets that did not fit stay held back and the writer is
+// write blocked until SetWritable() flushes them.
+//
+// GetNextWriteLocation() hands out the buffer the next packet will be held
+// in, so that a connection can encrypt its packet there and spare the copy.
+class QuicBatchPacketWriter : public QuicDefaultPacketWriter {
+ public:
+  // The most packets that are held back. A write that finds them all in use
+  // flushes first.
+  static const int kMaxBufferedPackets = 32;
+
+  explicit QuicBatchPacketWriter(int fd);
+  ~QuicBatchPacketWriter() override;
+
+  // QuicPacketWriter
+  WriteResult WritePacket(const char* buffer,
+                          size_t buf_len,
+                          const IPAddressNumber& self_address,
+                          const IPEndPoint& peer_address) override;
+  void SetWritable() override;
+  char* GetNextWriteLocation() override;
+
+  // Sends the packets that are held back. A packet that the socket rejects
+  // with an error is dropped, as the network might have dropped it. Returns
+  // false, and leaves the writer write blocked, if the socket filled up
+  // before every packet was sent.
+  bool Flush();
+
+  bool HasBufferedPackets() const { return first_unsent_ < num_buffered_; }
+
+  // The number of write system calls made by the writer, and the number of
+  // packets they sent.
+  uint64 num_write_calls() const { return num_write_calls_; }
+  uint64 num_packets_written() const { return num_packets_written_; }
+
+  // The number of packets that were copied in, rather than written in place
+  // through GetNextWriteLocation().
+  uint64 num_packets_copied() const { return num_packets_copied_; }
+
+ private:
+  // A packet that is held back, pointed to by its entry in |mmsg_hdrs_|.
+  struct BufferedPacket {
+    iovec iov;
+    sockaddr_storage raw_address;
+    // The packet's source address, if it has one.
+    char cbuf[kSpaceForIp];
+    char buffer[kMaxPacketSize];
+  };
+
+  // Sends the packets from |first_unsent_| on with one system call. Returns
+  // the number of packets sent, or -1 and sets errno.
+  int SendBufferedPackets();
+
+  bool sendmmsg_supported_;
+
+  scoped_ptr<BufferedPacket[]> packets_;
+  scoped_ptr<mmsghdr[]> mmsg_hdrs_;
+
+  // The packets in [first_unsent_, num_buffered_) are waiting to be sent.
+  int first_unsent_;
+  int num_buffered_;
+
+  uint64 num_write_calls_;
+  uint64 num_packets_written_;
+  uint64 num_packets_copied_;
+
+  DISALLOW_COPY_AND_ASSIGN(QuicBatchPacketWriter);
+};
+
+}  // namespace tools
+}  // namespace net
+
+#endif  // NET_TOOLS_QUIC_QUIC_BATCH_PACKET_WRITER_H_
@@ -0,0 +1,133 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/tools/quic/quic_batch_packet_writer.h"
+
+#include <errno.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include "net/base/net_util.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace net {
+namespace tools {
+namespace test {
+namespace {
+
+// Returns a non-blocking UDP socket bound to an ephemeral loopback port, and
+// sets |address| to its address.
+int CreateLoopbackSocket(IPEndPoint* address) {
+  IPAddressNumber ip;
+  CHECK(ParseIPLiteralToNumber("127.0.0.1", &ip));
+  int fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, IPPROTO_UDP);
+  CHECK_GE(fd, 0);
+
+  SockaddrStorage bind_address;
+  CHECK(IPEndPoint(ip, 0).ToSockAddr(bind_address.addr,
+                                     &bind_address.addr_len));
+  CHECK_EQ(0, bind(fd, bind_address.addr, bind_address.addr_len));
+  SockaddrStorage bound_address;
+  CHECK_EQ(0, getsockname(fd, bound_address.addr, &bound_address.addr_len));
+  CHECK(address->FromSockAddr(bound_address.addr, bound_address.addr_len));
+  return fd;
+}
+
+class QuicBatchPacketWriterTest : public ::testing::Test {
+ protected:
+  QuicBatchPacketWriterTest() {
+    writer_fd_ = CreateLoopbackSocket(&writer_address_);
+    reader_fd_ = CreateLoopbackSocket(&reader_address_);
+  }
+
+  ~QuicBatchPacketWriterTest() override {
+    close(writer_fd_);
+    close(reader_fd_);
+  }
+
+  WriteResult WritePacket(QuicBatchPacketWriter* writer, size_t length) {
+    std::string packet(length, static_cast<char>(length));
+    return writer->WritePacket(packet.data(), packet.length(),
+                               IPAddressNumber(), reader_address_);
+  }
+
+  // Reads everything that has arrived, and returns the packet lengths.
+  std::vector<size_t> ReadPackets() {
+    std::vector<size_t> lengths;
+    char buffer[2 * kMaxPacketSize];
+    ssize_t length;
+    while ((length = recv(reader_fd_, buffer, sizeof(buffer), 0)) >= 0)
+      lengths.push_back(length);
+    EXPECT_TRUE(errno == EAGAIN || errno == EWOULDBLOCK);
+    return lengths;
+  }
+
+  int writer_fd_;
+  int reader_fd_;
+  IPEndPoint writer_address_;
+  IPEndPoint reader_address_;
+};
+
+TEST_F(QuicBatchPacketWriterTest, HoldsPacketsUntilFlush) {
+  QuicBatchPacketWriter writer(writer_fd_);
+  for (size_t length = 10; length <= 30; length += 10) {
+    WriteResult result = WritePacket(&writer, length);
+    EXPECT_EQ(WRITE_STATUS_OK, result.status);
+    EXPECT_EQ(static_cast<int>(length), result.bytes_written);
+  }
+  EXPECT_TRUE(writer.HasBufferedPackets());
+  EXPECT_TRUE(ReadPackets().empty());
+  EXPECT_EQ(0u, writer.num_write_calls());
+
+  EXPECT_TRUE(writer.Flush());
+  EXPECT_FALSE(writer.HasBufferedPackets());
+  EXPECT_FALSE(writer.IsWriteBlocked());
+  std::vector<size_t> lengths = ReadPackets();
+  ASSERT_EQ(3u, lengths.size());
+  EXPECT_EQ(10u, lengths[0]);
+  EXPECT_EQ(20u, lengths[1]);
+  EXPECT_EQ(30u, lengths[2]);
+  EXPECT_EQ(1u, writer.num_write_calls());
+  EXPECT_EQ(3u, writer.num_packets_written());
+
+  // Nothing is left to send.
+  EXPECT_TRUE(writer.Flush());
+  EXPECT_EQ(1u, writer.num_write_calls());
+}
+
+TEST_F(QuicBatchPacketWriterTest, FlushesWhenFull) {
+  QuicBatchPacketWriter writer(writer_fd_);
+  const int kNumPackets = QuicBatchPacketWriter::kMaxBufferedPackets + 1;
+  for (int i = 0; i < kNumPackets; ++i)
+    EXPECT_EQ(WRITE_STATUS_OK, WritePacket(&writer, 100).status);
+  EXPECT_EQ(1u, writer.num_write_calls());
+  EXPECT_EQ(static_cast<size_t>(QuicBatchPacketWriter::kMaxBufferedPackets),
+            ReadPackets().size());
+
+  EXPECT_TRUE(writer.Flush());
+  EXPECT_EQ(2u, writer.num_write_calls());
+  EXPECT_EQ(static_cast<uint64>(kNumPackets), writer.num_packets_written());
+  EXPECT_EQ(1u, ReadPackets().size());
+}
+
+TEST_F(QuicBatchPacketWriterTest, WritesOversizedPacketsInOrder) {
+  QuicBatchPacketWriter writer(writer_fd_);
+  EXPECT_EQ(WRITE_STATUS_OK, WritePacket(&writer, 100).status);
+  EXPECT_EQ(WRITE_STATUS_OK, WritePacket(&writer, kMaxPacketSize + 1).status);
+  EXPECT_FALSE(writer.HasBufferedPackets());
+
+  std::vector<size_t> lengths = ReadPackets();
+  ASSERT_EQ(2u, lengths.size());
+  EXPECT_EQ(100u, lengths[0]);
+  EXPECT_EQ(kMaxPacketSize + 1, lengths[1]);
+  EXPECT_EQ(2u, writer.num_write_calls());
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace tools
+}  // namespace net
@@ -191,8 +191,12 @@ QuicDispatcher::~QuicDispatcher() {
 }
 
 void QuicDispatcher::Initialize(int fd) {
+  InitializeWithWriter(CreateWriter(fd));
+}
+
+void QuicDispatcher::InitializeWithWriter(QuicPacketWriter* writer) {
   DCHECK(writer_ == nullptr);
-  writer_.reset(CreateWriter(fd));
+  writer_.reset(writer);
   time_wait_list_manager_.reset(CreateQuicTimeWaitListManager());
 }
 
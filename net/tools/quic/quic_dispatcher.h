@@ -87,6 +87,10 @@ class QuicDispatcher : public QuicServerSessionVisitor,
 
   virtual void Initialize(int fd);
 
+  // Like Initialize(), but writes with |writer| rather than one made by
+  // CreateWriter(). Takes ownership of |writer|.
+  void InitializeWithWriter(QuicPacketWriter* writer);
+
   // Process the incoming packet by creating a new session, passing it to
   // an existing session, or passing it to the TimeWaitListManager.
   void ProcessPacket(const IPEndPoint& server_address,
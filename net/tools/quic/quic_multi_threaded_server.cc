@@ -0,0 +1,372 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/tools/quic/quic_multi_threaded_server.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/filter.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "base/logging.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/posix/eintr_wrapper.h"
+#include "base/synchronization/lock.h"
+#include "base/synchronization/waitable_event.h"
+#include "base/threading/simple_thread.h"
+#include "net/tools/epoll_server/epoll_server.h"
+#include "net/tools/quic/quic_dispatcher.h"
+#include "net/tools/quic/quic_server.h"
+
+#ifndef SO_ATTACH_REUSEPORT_CBPF
+#define SO_ATTACH_REUSEPORT_CBPF 51
+#endif
+
+namespace net {
+namespace tools {
+
+namespace {
+
+// The most packets that wait in a thread's inbox. Any more are dropped, as
+// the network might have dropped them.
+const size_t kMaxInboxPackets = 1024;
+
+// A packet that one thread read for a connection that another owns.
+struct HandedOffPacket {
+  HandedOffPacket(const IPEndPoint& server_address,
+                  const IPEndPoint& client_address,
+                  QuicEncryptedPacket* packet)
+      : server_address(server_address),
+        client_address(client_address),
+        packet(packet) {}
+
+  IPEndPoint server_address;
+  IPEndPoint client_address;
+  scoped_ptr<QuicEncryptedPacket> packet;
+};
+
+}  // namespace
+
+// The packets that other threads have handed over to a thread. They are
+// queued from any thread, and a pipe wakes the owner's EpollServer to
+// process them.
+class QuicMultiThreadedServer::PacketInbox : public EpollCallbackInterface {
+ public:
+  PacketInbox() : processor_(nullptr) {
+    int fds[2];
+    CHECK_EQ(0, pipe2(fds, O_NONBLOCK | O_CLOEXEC));
+    read_fd_ = fds[0];
+    write_fd_ = fds[1];
+  }
+
+  ~PacketInbox() override {
+    close(read_fd_);
+    close(write_fd_);
+  }
+
+  int read_fd() const { return read_fd_; }
+
+  void set_processor(ProcessPacketInterface* processor) {
+    processor_ = processor;
+  }
+
+  // Called on the thread that read the packet.
+  void Push(const IPEndPoint& server_address,
+            const IPEndPoint& client_address,
+            const QuicEncryptedPacket& packet) {
+    scoped_ptr<HandedOffPacket> handed_off(
+        new HandedOffPacket(server_address, client_address, packet.Clone()));
+    bool was_empty;
+    {
+      base::AutoLock lock(lock_);
+      if (packets_.size() >= kMaxInboxPackets)
+        return;
+      was_empty = packets_.empty();
+      packets_.push_back(handed_off.release());
+    }
+    // Only the first packet needs a wakeup: the owner takes the whole queue
+    // after it drains the pipe. If the pipe is full, a wakeup is pending.
+    if (was_empty) {
+      char wakeup = 0;
+      ignore_result(HANDLE_EINTR(write(write_fd_, &wakeup, 1)));
+    }
+  }
+
+  // EpollCallbackInterface, called on the owning thread.
+  void OnRegistration(EpollServer* eps, int fd, int event_mask) override {}
+  void OnModification(int fd, int event_mask) override {}
+  void OnEvent(int fd, EpollEvent* event) override {
+    char buffer[64];
+    while (HANDLE_EINTR(read(read_fd_, buffer, sizeof(buffer))) > 0) {
+    }
+
+    ScopedVector<HandedOffPacket> packets;
+    {
+      base::AutoLock lock(lock_);
+      packets.swap(packets_);
+    }
+    for (size_t i = 0; i < packets.size(); ++i) {
+      processor_->ProcessPacket(packets[i]->server_address,
+                                packets[i]->client_address,
+                                *packets[i]->packet);
+    }
+  }
+  void OnUnregistration(int fd, bool replaced) override {}
+  void OnShutdown(EpollServer* eps, int fd) override {}
+
+ private:
+  int read_fd_;
+  int write_fd_;
+  ProcessPacketInterface* processor_;
+
+  // Protects |packets_|.
+  base::Lock lock_;
+  ScopedVector<HandedOffPacket> packets_;
+
+  DISALLOW_COPY_AND_ASSIGN(PacketInbox);
+};
+
+// A dispatcher that hands the packets of connections owned by other threads
+// over to them.
+class QuicMultiThreadedServer::SteeringDispatcher : public QuicDispatcher {
+ public:
+  SteeringDispatcher(const QuicConfig& config,
+                     const QuicCryptoServerConfig& crypto_config,
+                     const QuicVersionVector& supported_versions,
+                     EpollServer* epoll_server,
+                     QuicMultiThreadedServer* server,
+                     int thread)
+      : QuicDispatcher(config,
+                       crypto_config,
+                       supported_versions,
+                       new QuicDispatcher::DefaultPacketWriterFactory(),
+                       epoll_server),
+        server_(server),
+        thread_(thread) {}
+
+  void ProcessPacket(const IPEndPoint& server_address,
+                     const IPEndPoint& client_address,
+                     const QuicEncryptedPacket& packet) override {
+    int owner = GetThreadForPacket(packet, server_->num_threads());
+    if (owner >= 0 && owner != thread_) {
+      server_->HandOffPacket(owner, server_address, client_address, packet);
+      return;
+    }
+    QuicDispatcher::ProcessPacket(server_address, client_address, packet);
+  }
+
+ private:
+  QuicMultiThreadedServer* server_;
+  const int thread_;
+
+  DISALLOW_COPY_AND_ASSIGN(SteeringDispatcher);
+};
+
+// The QuicServer of one thread.
+class QuicMultiThreadedServer::WorkerServer : public QuicServer {
+ public:
+  WorkerServer(const QuicConfig& config,
+               const QuicVersionVector& supported_versions,
+               QuicMultiThreadedServer* server,
+               int thread)
+      : QuicServer(config, supported_versions),
+        server_(server),
+        thread_(thread),
+        inbox_registered_(false) {
+    set_reuse_port(true);
+  }
+
+  ~WorkerServer() override {
+    // The inbox goes before the EpollServer, which would otherwise tell it
+    // about the shutdown.
+    if (inbox_registered_)
+      epoll_server()->UnregisterFD(inbox_.read_fd());
+  }
+
+  using QuicServer::fd;
+
+  // Listens on |address|, and starts taking packets from other threads.
+  bool ListenAndRegisterInbox(const IPEndPoint& address) {
+    if (!Listen(address))
+      return false;
+    epoll_server()->RegisterFD(inbox_.read_fd(), &inbox_, EPOLLIN);
+    inbox_registered_ = true;
+    return true;
+  }
+
+  PacketInbox* inbox() { return &inbox_; }
+
+  void Wake() { epoll_server()->Wake(); }
+
+ protected:
+  QuicDispatcher* CreateQuicDispatcher() override {
+    SteeringDispatcher* dispatcher =
+        new SteeringDispatcher(config(), crypto_config(), supported_versions(),
+                               epoll_server(), server_, thread_);
+    inbox_.set_processor(dispatcher);
+    return dispatcher;
+  }
+
+ private:
+  QuicMultiThreadedServer* server_;
+  const int thread_;
+  PacketInbox inbox_;
+  bool inbox_registered_;
+
+  DISALLOW_COPY_AND_ASSIGN(WorkerServer);
+};
+
+// A thread that runs a WorkerServer until it is told to quit.
+class QuicMultiThreadedServer::Worker : public base::SimpleThread {
+ public:
+  Worker(const QuicConfig& config,
+         const QuicVersionVector& supported_versions,
+         QuicMultiThreadedServer* server,
+         int thread)
+      : base::SimpleThread("QuicServerWorker"),
+        server_(new WorkerServer(config, supported_versions, server, thread)),
+        quit_(true, false) {}
+
+  ~Worker() override {}
+
+  WorkerServer* server() { return server_.get(); }
+
+  void Run() override {
+    while (!quit_.IsSignaled())
+      server_->WaitForEvents();
+    server_->Shutdown();
+  }
+
+  void Quit() {
+    quit_.Signal();
+    server_->Wake();
+  }
+
+ private:
+  scoped_ptr<WorkerServer> server_;
+  base::WaitableEvent quit_;
+
+  DISALLOW_COPY_AND_ASSIGN(Worker);
+};
+
+QuicMultiThreadedServer::QuicMultiThreadedServer(
+    const QuicConfig& config,
+    const QuicVersionVector& supported_versions,
+    int num_threads)
+    : config_(config),
+      supported_versions_(supported_versions),
+      num_threads_(num_threads),
+      port_(0),
+      kernel_steering_(false),
+      started_(false) {
+  DCHECK_GT(num_threads, 0);
+}
+
+QuicMultiThreadedServer::~QuicMultiThreadedServer() {
+  Shutdown();
+}
+
+bool QuicMultiThreadedServer::Listen(const IPEndPoint& address) {
+  DCHECK(workers_.empty());
+  IPEndPoint listen_address = address;
+  for (int i = 0; i < num_threads_; ++i) {
+    Worker* worker = new Worker(config_, supported_versions_, this, i);
+    workers_.push_back(worker);
+    // The kernel numbers the sockets of an SO_REUSEPORT group in the order
+    // they are bound, which is the order the steering program relies on.
+    if (!worker->server()->ListenAndRegisterInbox(listen_address))
+      return false;
+    if (i == 0) {
+      port_ = worker->server()->port();
+      listen_address = IPEndPoint(address.address(), port_);
+      if (num_threads_ > 1)
+        kernel_steering_ = AttachSteeringProgram(worker->server()->fd());
+    }
+  }
+  return true;
+}
+
+void QuicMultiThreadedServer::Start() {
+  DCHECK(!started_);
+  DCHECK_EQ(static_cast<size_t>(num_threads_), workers_.size());
+  for (size_t i = 0; i < workers_.size(); ++i)
+    workers_[i]->Start();
+  started_ = true;
+}
+
+void QuicMultiThreadedServer::Shutdown() {
+  if (!started_)
+    return;
+  for (size_t i = 0; i < workers_.size(); ++i)
+    workers_[i]->Quit();
+  for (size_t i = 0; i < workers_.size(); ++i)
+    workers_[i]->Join();
+  started_ = false;
+}
+
+// static
+int QuicMultiThreadedServer::GetThreadForPacket(
+    const QuicEncryptedPacket& packet,
+    int num_threads) {
+  if (num_threads == 1)
+    return 0;
+  const uint8* data = reinterpret_cast<const uint8*>(packet.data());
+  if (packet.length() < kPublicFlagsSize + sizeof(uint32) ||
+      (data[0] & PACKET_PUBLIC_FLAGS_8BYTE_CONNECTION_ID) !=
+          PACKET_PUBLIC_FLAGS_8BYTE_CONNECTION_ID) {
+    return -1;
+  }
+  // The first four bytes of the connection ID, read in network byte order as
+  // the BPF program reads them.
+  uint32 key = static_cast<uint32>(data[1]) << 24 |
+               static_cast<uint32>(data[2]) << 16 |
+               static_cast<uint32>(data[3]) << 8 |
+               static_cast<uint32>(data[4]);
+  return key % num_threads;
+}
+
+bool QuicMultiThreadedServer::AttachSteeringProgram(int fd) {
+  // The program sees the UDP payload, and returns the index of the socket in
+  // the group. An index past the end makes the kernel fall back to hashing
+  // the addresses.
+  sock_filter code[] = {
+    // A = public flags
+    BPF_STMT(BPF_LD | BPF_B | BPF_ABS, 0),
+    BPF_STMT(BPF_ALU | BPF_AND | BPF_K,
+             PACKET_PUBLIC_FLAGS_8BYTE_CONNECTION_ID),
+    BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K,
+             PACKET_PUBLIC_FLAGS_8BYTE_CONNECTION_ID, 1, 0),
+    BPF_STMT(BPF_RET | BPF_K, 0xffffffff),
+    // A = the first four bytes of the connection ID % number of threads
+    BPF_STMT(BPF_LD | BPF_W | BPF_ABS, kPublicFlagsSize),
+    BPF_STMT(BPF_ALU | BPF_MOD | BPF_K, static_cast<uint32>(num_threads_)),
+    BPF_STMT(BPF_RET | BPF_A, 0),
+  };
+  sock_fprog program;
+  program.len = arraysize(code);
+  program.filter = code;
+  if (setsockopt(fd, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &program,
+                 sizeof(program)) < 0) {
+    DVLOG(1) << "Kernel steering by connection ID not supported: "
+             << strerror(errno);
+    return false;
+  }
+  return true;
+}
+
+void QuicMultiThreadedServer::HandOffPacket(
+    int thread,
+    const IPEndPoint& server_address,
+    const IPEndPoint& client_address,
+    const QuicEncryptedPacket& packet) {
+  DCHECK_LT(static_cast<size_t>(thread), workers_.size());
+  workers_[thread]->server()->inbox()->Push(server_address, client_address,
+                                            packet);
+}
+
+}  // namespace tools
+}  // namespace net
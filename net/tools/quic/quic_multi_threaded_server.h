@@ -0,0 +1,96 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// A QUIC server that spreads its connections over several threads.
+
+#ifndef NET_TOOLS_QUIC_QUIC_MULTI_THREADED_SERVER_H_
+#define NET_TOOLS_QUIC_QUIC_MULTI_THREADED_SERVER_H_
+
+#include <vector>
+
+#include "base/basictypes.h"
+#include "base/memory/scoped_vector.h"
+#include "net/base/ip_endpoint.h"
+#include "net/quic/quic_config.h"
+#include "net/quic/quic_protocol.h"
+
+namespace net {
+namespace tools {
+
+// Runs a QUIC endpoint on several threads, one per core. Each thread owns a
+// QuicServer, with its own socket, EpollServer, QuicDispatcher and
+// QuicTimeWaitListManager, and the sockets share one address through
+// SO_REUSEPORT.
+//
+// The kernel spreads the packets over the sockets by their source address,
+// so a client whose address changes would land on a thread that does not
+// know its connection. Each connection is therefore owned by the thread that
+// GetThreadForPacket() picks from its connection ID. Where the kernel can run
+// a BPF program on the SO_REUSEPORT group, the program picks the same socket;
+// otherwise, a thread that reads a packet for a connection it does not own
+// hands the packet over to the owner.
+class QuicMultiThreadedServer {
+ public:
+  QuicMultiThreadedServer(const QuicConfig& config,
+                          const QuicVersionVector& supported_versions,
+                          int num_threads);
+  ~QuicMultiThreadedServer();
+
+  // Opens one socket per thread on |address|. If the port is 0, the kernel
+  // picks one for the first socket and the others share it.
+  bool Listen(const IPEndPoint& address);
+
+  // Starts the threads, which handle packets until Shutdown().
+  void Start();
+
+  // Stops the threads, closing their connections.
+  void Shutdown();
+
+  int port() const { return port_; }
+  int num_threads() const { return num_threads_; }
+
+  // True if the kernel steers packets to their owners, so that threads only
+  // hand over packets that arrived before the program was attached.
+  bool kernel_steering() const { return kernel_steering_; }
+
+  // Returns the thread that owns the connection |packet| belongs to, or -1
+  // if the packet does not carry a full connection ID, in which case the
+  // thread that reads it handles it.
+  static int GetThreadForPacket(const QuicEncryptedPacket& packet,
+                                int num_threads);
+
+ private:
+  class PacketInbox;
+  class SteeringDispatcher;
+  class Worker;
+  class WorkerServer;
+
+  // Attaches a BPF program that mirrors GetThreadForPacket() to the
+  // SO_REUSEPORT group of |fd|. Returns false if the kernel cannot.
+  bool AttachSteeringProgram(int fd);
+
+  // Queues |packet| for |thread|, which owns its connection. Called from the
+  // thread that read it.
+  void HandOffPacket(int thread,
+                     const IPEndPoint& server_address,
+                     const IPEndPoint& client_address,
+                     const QuicEncryptedPacket& packet);
+
+  const QuicConfig config_;
+  const QuicVersionVector supported_versions_;
+  const int num_threads_;
+
+  int port_;
+  bool kernel_steering_;
+  bool started_;
+
+  ScopedVector<Worker> workers_;
+
+  DISALLOW_COPY_AND_ASSIGN(QuicMultiThreadedServer);
+};
+
+}  // namespace tools
+}  // namespace net
+
+#endif  // NET_TOOLS_QUIC_QUIC_MULTI_THREADED_SERVER_H_
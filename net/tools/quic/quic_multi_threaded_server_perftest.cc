@@ -0,0 +1,127 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <string>
+
+#include "base/basictypes.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/threading/simple_thread.h"
+#include "base/time/time.h"
+#include "net/base/ip_endpoint.h"
+#include "net/base/net_util.h"
+#include "net/quic/test_tools/quic_test_utils.h"
+#include "net/tools/quic/quic_in_memory_cache.h"
+#include "net/tools/quic/quic_multi_threaded_server.h"
+#include "net/tools/quic/test_tools/quic_in_memory_cache_peer.h"
+#include "net/tools/quic/test_tools/quic_test_client.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_test.h"
+
+namespace net {
+namespace tools {
+namespace test {
+namespace {
+
+const char kLoadUrl[] = "https://www.google.com/load";
+const char kLoadPath[] = "/load";
+const int kResponseSize = 16 * 1024;
+const int kNumClients = 16;
+const int kNumRequestsPerClient = 25;
+
+// Downloads the load response kNumRequestsPerClient times, with a QuicClient
+// of its own.
+class LoadClient : public base::DelegateSimpleThread::Delegate {
+ public:
+  explicit LoadClient(const IPEndPoint& server_address)
+      : server_address_(server_address), num_responses_(0) {}
+
+  void Run() override {
+    QuicTestClient client(server_address_, "example.com", false,
+                          QuicSupportedVersions());
+    client.Connect();
+    for (int i = 0; i < kNumRequestsPerClient; ++i) {
+      if (client.SendSynchronousRequest(kLoadPath).size() ==
+          static_cast<size_t>(kResponseSize)) {
+        ++num_responses_;
+      }
+    }
+  }
+
+  int num_responses() const { return num_responses_; }
+
+ private:
+  const IPEndPoint server_address_;
+  int num_responses_;
+
+  DISALLOW_COPY_AND_ASSIGN(LoadClient);
+};
+
+// Loads a QuicMultiThreadedServer with kNumClients concurrent QuicClients, and
+// reports its throughput. The parameter is the number of server threads.
+class QuicMultiThreadedServerPerfTest : public ::testing::TestWithParam<int> {
+ protected:
+  QuicMultiThreadedServerPerfTest() {
+    QuicInMemoryCachePeer::ResetForTests();
+    std::string body;
+    net::test::GenerateBody(&body, kResponseSize);
+    QuicInMemoryCache::GetInstance()->AddSimpleResponse(
+        "GET", kLoadUrl, "HTTP/1.1", "200", "OK", body);
+  }
+
+  ~QuicMultiThreadedServerPerfTest() override {
+    QuicInMemoryCachePeer::ResetForTests();
+  }
+};
+
+TEST_P(QuicMultiThreadedServerPerfTest, Throughput) {
+  const int num_threads = GetParam();
+  IPAddressNumber ip;
+  CHECK(ParseIPLiteralToNumber("127.0.0.1", &ip));
+
+  QuicMultiThreadedServer server(QuicConfig(), QuicSupportedVersions(),
+                                 num_threads);
+  ASSERT_TRUE(server.Listen(IPEndPoint(ip, 0)));
+  IPEndPoint server_address(ip, server.port());
+  server.Start();
+
+  scoped_ptr<LoadClient> clients[kNumClients];
+  scoped_ptr<base::DelegateSimpleThread> client_threads[kNumClients];
+  base::TimeTicks start = base::TimeTicks::Now();
+  for (int i = 0; i < kNumClients; ++i) {
+    clients[i].reset(new LoadClient(server_address));
+    client_threads[i].reset(
+        new base::DelegateSimpleThread(clients[i].get(), "LoadClient"));
+    client_threads[i]->Start();
+  }
+  int num_responses = 0;
+  for (int i = 0; i < kNumClients; ++i) {
+    client_threads[i]->Join();
+    num_responses += clients[i]->num_responses();
+  }
+  base::TimeDelta elapsed = base::TimeTicks::Now() - start;
+  server.Shutdown();
+
+  EXPECT_EQ(kNumClients * kNumRequestsPerClient, num_responses);
+  const std::string trace = base::IntToString(num_threads) + "_threads";
+  perf_test::PrintResult("quic_server_requests_per_second", "", trace,
+                         num_responses / elapsed.InSecondsF(), "requests/s",
+                         true);
+  perf_test::PrintResult(
+      "quic_server_throughput", "", trace,
+      num_responses * kResponseSize / elapsed.InSecondsF() / (1024 * 1024),
+      "MB/s", true);
+  perf_test::PrintResult("quic_server_kernel_steering", "", trace,
+                         static_cast<size_t>(server.kernel_steering()), "bool",
+                         false);
+}
+
+INSTANTIATE_TEST_CASE_P(QuicMultiThreadedServerPerfTests,
+                        QuicMultiThreadedServerPerfTest,
+                        ::testing::Values(1, 2, 4, 8));
+
+}  // namespace
+}  // namespace test
+}  // namespace tools
+}  // namespace net
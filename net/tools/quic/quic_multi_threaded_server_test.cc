@@ -0,0 +1,153 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/tools/quic/quic_multi_threaded_server.h"
+
+#include <string.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+
+#include <string>
+
+#include "base/memory/scoped_ptr.h"
+#include "net/base/net_util.h"
+#include "net/quic/test_tools/quic_connection_peer.h"
+#include "net/tools/epoll_server/epoll_server.h"
+#include "net/tools/quic/quic_in_memory_cache.h"
+#include "net/tools/quic/test_tools/quic_client_peer.h"
+#include "net/tools/quic/test_tools/quic_in_memory_cache_peer.h"
+#include "net/tools/quic/test_tools/quic_test_client.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+using net::test::QuicConnectionPeer;
+
+namespace net {
+namespace tools {
+namespace test {
+namespace {
+
+const char kFooResponseBody[] = "Artichoke hearts make me happy.";
+const int kNumThreads = 4;
+
+// Returns a packet whose public header carries an 8 byte connection ID that
+// starts with |first_bytes|.
+QuicEncryptedPacket* MakePacket(uint32 first_bytes) {
+  char* data = new char[13];
+  data[0] = PACKET_PUBLIC_FLAGS_8BYTE_CONNECTION_ID;
+  data[1] = static_cast<char>(first_bytes >> 24);
+  data[2] = static_cast<char>(first_bytes >> 16);
+  data[3] = static_cast<char>(first_bytes >> 8);
+  data[4] = static_cast<char>(first_bytes);
+  memset(data + 5, 0, 8);
+  return new QuicEncryptedPacket(data, 13, true);
+}
+
+TEST(QuicMultiThreadedServerSteeringTest, SteersByConnectionId) {
+  for (uint32 key = 0; key < 16; ++key) {
+    scoped_ptr<QuicEncryptedPacket> packet(MakePacket(key));
+    EXPECT_EQ(static_cast<int>(key % kNumThreads),
+              QuicMultiThreadedServer::GetThreadForPacket(*packet,
+                                                          kNumThreads));
+  }
+  scoped_ptr<QuicEncryptedPacket> packet(MakePacket(0xffffffff));
+  EXPECT_EQ(3, QuicMultiThreadedServer::GetThreadForPacket(*packet, 4));
+  EXPECT_EQ(0, QuicMultiThreadedServer::GetThreadForPacket(*packet, 1));
+}
+
+TEST(QuicMultiThreadedServerSteeringTest, LeavesOtherPacketsWhereTheyAre) {
+  // No connection ID.
+  char public_reset[] = { PACKET_PUBLIC_FLAGS_RST, 0, 0, 0, 0, 0 };
+  QuicEncryptedPacket no_connection_id(public_reset, arraysize(public_reset));
+  EXPECT_EQ(-1, QuicMultiThreadedServer::GetThreadForPacket(no_connection_id,
+                                                            kNumThreads));
+
+  // Too short to carry a connection ID.
+  char truncated[] = { PACKET_PUBLIC_FLAGS_8BYTE_CONNECTION_ID, 1, 2 };
+  QuicEncryptedPacket too_short(truncated, arraysize(truncated));
+  EXPECT_EQ(-1, QuicMultiThreadedServer::GetThreadForPacket(too_short,
+                                                            kNumThreads));
+}
+
+class QuicMultiThreadedServerTest : public ::testing::Test {
+ protected:
+  QuicMultiThreadedServerTest()
+      : server_(QuicConfig(), QuicSupportedVersions(), kNumThreads) {
+    QuicInMemoryCachePeer::ResetForTests();
+    QuicInMemoryCache::GetInstance()->AddSimpleResponse(
+        "GET", "https://www.google.com/foo", "HTTP/1.1", "200", "OK",
+        kFooResponseBody);
+
+    IPAddressNumber ip;
+    CHECK(ParseIPLiteralToNumber("127.0.0.1", &ip));
+    CHECK(server_.Listen(IPEndPoint(ip, 0)));
+    server_address_ = IPEndPoint(ip, server_.port());
+    server_.Start();
+  }
+
+  ~QuicMultiThreadedServerTest() override {
+    server_.Shutdown();
+    QuicInMemoryCachePeer::ResetForTests();
+  }
+
+  QuicTestClient* CreateClient() {
+    QuicTestClient* client = new QuicTestClient(
+        server_address_, "example.com", false, QuicSupportedVersions());
+    client->Connect();
+    return client;
+  }
+
+  // Moves |client| to a new ephemeral port, as a NAT rebinding would, which
+  // is likely to land it on another thread's socket.
+  void MigrateClientPort(QuicTestClient* client) {
+    EpollServer* eps = client->epoll_server();
+    int old_fd = client->client()->fd();
+    eps->UnregisterFD(old_fd);
+    QuicClientPeer::CreateUDPSocket(client->client());
+    close(old_fd);
+    client->client()->CreateQuicPacketWriter();
+
+    int new_port = client->client()->client_address().port();
+    QuicClientPeer::SetClientPort(client->client(), new_port);
+    QuicConnectionPeer::SetSelfAddress(
+        client->client()->session()->connection(),
+        IPEndPoint(
+            client->client()->session()->connection()->self_address().address(),
+            new_port));
+    eps->RegisterFD(client->client()->fd(), client->client(),
+                    EPOLLIN | EPOLLOUT | EPOLLET);
+  }
+
+  QuicMultiThreadedServer server_;
+  IPEndPoint server_address_;
+};
+
+TEST_F(QuicMultiThreadedServerTest, ServesClients) {
+  const int kNumClients = 2 * kNumThreads;
+  scoped_ptr<QuicTestClient> clients[kNumClients];
+  for (int i = 0; i < kNumClients; ++i) {
+    clients[i].reset(CreateClient());
+    EXPECT_EQ(kFooResponseBody, clients[i]->SendSynchronousRequest("/foo"));
+  }
+  for (int i = 0; i < kNumClients; ++i) {
+    EXPECT_EQ(kFooResponseBody, clients[i]->SendSynchronousRequest("/foo"));
+    EXPECT_EQ(200u, clients[i]->response_headers()->parsed_response_code());
+  }
+}
+
+TEST_F(QuicMultiThreadedServerTest, ConnectionSurvivesClientPortChanges) {
+  scoped_ptr<QuicTestClient> client(CreateClient());
+  EXPECT_EQ(kFooResponseBody, client->SendSynchronousRequest("/foo"));
+
+  for (int i = 0; i < 2 * kNumThreads; ++i) {
+    MigrateClientPort(client.get());
+    EXPECT_EQ(kFooResponseBody, client->SendSynchronousRequest("/foo"));
+    EXPECT_EQ(200u, client->response_headers()->parsed_response_code());
+    EXPECT_EQ(QUIC_NO_ERROR, client->connection_error());
+  }
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace tools
+}  // namespace net
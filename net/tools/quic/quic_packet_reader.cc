@@ -0,0 +1,125 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/tools/quic/quic_packet_reader.h"
+
+#include <errno.h>
+#include <string.h>
+
+#include "base/logging.h"
+#include "net/base/ip_endpoint.h"
+#include "net/tools/quic/quic_dispatcher.h"
+
+namespace net {
+namespace tools {
+
+QuicPacketReader::QuicPacketReader()
+    : recvmmsg_supported_(true),
+      num_read_calls_(0),
+      num_packets_read_(0) {
+  memset(mmsg_hdrs_, 0, sizeof(mmsg_hdrs_));
+  for (int i = 0; i < kNumPacketsPerReadMmsgCall; ++i) {
+    packets_[i].iov.iov_base = packets_[i].buf;
+    packets_[i].iov.iov_len = sizeof(packets_[i].buf);
+
+    msghdr* hdr = &mmsg_hdrs_[i].msg_hdr;
+    hdr->msg_name = &packets_[i].raw_address;
+    hdr->msg_iov = &packets_[i].iov;
+    hdr->msg_iovlen = 1;
+    hdr->msg_control = packets_[i].cbuf;
+  }
+}
+
+QuicPacketReader::~QuicPacketReader() {
+}
+
+void QuicPacketReader::InitializeHeaders() {
+  // recvmmsg() overwrites the lengths with what it read.
+  for (int i = 0; i < kNumPacketsPerReadMmsgCall; ++i) {
+    msghdr* hdr = &mmsg_hdrs_[i].msg_hdr;
+    hdr->msg_namelen = sizeof(sockaddr_storage);
+    hdr->msg_controllen = kSpaceForOverflowAndIp;
+    hdr->msg_flags = 0;
+  }
+}
+
+bool QuicPacketReader::ReadAndDispatchPackets(
+    int fd,
+    int port,
+    ProcessPacketInterface* processor,
+    QuicPacketCount* packets_dropped) {
+  if (!recvmmsg_supported_)
+    return ReadAndDispatchSinglePacket(fd, port, processor, packets_dropped);
+
+  InitializeHeaders();
+  int packets_read =
+      recvmmsg(fd, mmsg_hdrs_, kNumPacketsPerReadMmsgCall, 0, nullptr);
+  ++num_read_calls_;
+  if (packets_read <= 0) {
+    if (packets_read < 0 && errno == ENOSYS) {
+      recvmmsg_supported_ = false;
+      return ReadAndDispatchSinglePacket(fd, port, processor, packets_dropped);
+    }
+    if (packets_read < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+      LOG(ERROR) << "Error reading " << strerror(errno);
+    }
+    return false;
+  }
+  num_packets_read_ += packets_read;
+
+  for (int i = 0; i < packets_read; ++i) {
+    msghdr* hdr = &mmsg_hdrs_[i].msg_hdr;
+    IPEndPoint client_address;
+    if (!client_address.FromSockAddr(
+            reinterpret_cast<const sockaddr*>(&packets_[i].raw_address),
+            hdr->msg_namelen)) {
+      DVLOG(1) << "Unable to get peer address of packet " << i;
+      continue;
+    }
+    IPAddressNumber server_ip = QuicSocketUtils::GetAddressFromMsghdr(hdr);
+    if (server_ip.empty())
+      continue;
+    if (packets_dropped != nullptr)
+      QuicSocketUtils::GetOverflowFromMsghdr(hdr, packets_dropped);
+
+    QuicEncryptedPacket packet(packets_[i].buf, mmsg_hdrs_[i].msg_len, false);
+    IPEndPoint server_address(server_ip, port);
+    processor->ProcessPacket(server_address, client_address, packet);
+  }
+
+  // The socket is edge triggered, so a short batch means that it has been
+  // drained, and a packet that arrives later raises a new event.
+  return packets_read == kNumPacketsPerReadMmsgCall;
+}
+
+bool QuicPacketReader::ReadAndDispatchSinglePacket(
+    int fd,
+    int port,
+    ProcessPacketInterface* processor,
+    QuicPacketCount* packets_dropped) {
+  char* buf = packets_[0].buf;
+
+  IPEndPoint client_address;
+  IPAddressNumber server_ip;
+  int bytes_read =
+      QuicSocketUtils::ReadPacket(fd, buf, sizeof(packets_[0].buf),
+                                  packets_dropped,
+                                  &server_ip, &client_address);
+  ++num_read_calls_;
+
+  if (bytes_read < 0) {
+    return false;  // We failed to read.
+  }
+  ++num_packets_read_;
+
+  QuicEncryptedPacket packet(buf, bytes_read, false);
+
+  IPEndPoint server_address(server_ip, port);
+  processor->ProcessPacket(server_address, client_address, packet);
+
+  return true;
+}
+
+}  // namespace tools
+}  // namespace net
@@ -0,0 +1,89 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// Reads packets off a UDP socket for the QUIC server.
+
+#ifndef NET_TOOLS_QUIC_QUIC_PACKET_READER_H_
+#define NET_TOOLS_QUIC_QUIC_PACKET_READER_H_
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include "base/basictypes.h"
+#include "net/quic/quic_protocol.h"
+#include "net/tools/quic/quic_socket_utils.h"
+
+namespace net {
+namespace tools {
+
+class ProcessPacketInterface;
+
+// The most packets read by one recvmmsg() call.
+const int kNumPacketsPerReadMmsgCall = 16;
+
+// Reads packets from a socket and hands them to a ProcessPacketInterface.
+// ReadAndDispatchPackets() reads up to kNumPacketsPerReadMmsgCall packets with
+// a single recvmmsg() call, into buffers that are allocated once with the
+// reader, and falls back to one recvmsg() per packet if the kernel does not
+// have recvmmsg().
+class QuicPacketReader {
+ public:
+  QuicPacketReader();
+  virtual ~QuicPacketReader();
+
+  // Reads a batch of packets from |fd| and passes them to |processor|.
+  // Returns true if the batch was full, so more packets may be waiting, and
+  // false if the socket has been drained or the read failed.
+  // If |packets_dropped| is non-null, the socket is configured to track
+  // dropped packets, and some packets are read, it will be set to the number
+  // of dropped packets.
+  virtual bool ReadAndDispatchPackets(int fd,
+                                      int port,
+                                      ProcessPacketInterface* processor,
+                                      QuicPacketCount* packets_dropped);
+
+  // Reads a packet from the given fd, and then passes it off to
+  // |processor|.  Returns true if a packet is read, false otherwise.
+  // |packets_dropped| is as for ReadAndDispatchPackets().
+  bool ReadAndDispatchSinglePacket(int fd,
+                                   int port,
+                                   ProcessPacketInterface* processor,
+                                   QuicPacketCount* packets_dropped);
+
+  // The number of read system calls made by the reader, and the number of
+  // packets they returned.
+  uint64 num_read_calls() const { return num_read_calls_; }
+  uint64 num_packets_read() const { return num_packets_read_; }
+
+ private:
+  // The buffers that one packet is read into. They are pointed to by the
+  // packet's entry in |mmsg_hdrs_|.
+  struct PacketData {
+    iovec iov;
+    sockaddr_storage raw_address;
+    // The packet's destination address, and the socket's drop counter.
+    char cbuf[kSpaceForOverflowAndIp];
+    // Allocate some extra space so we can send an error if the client goes
+    // over the limit.
+    char buf[2 * kMaxPacketSize];
+  };
+
+  // Sets up |mmsg_hdrs_| for the next recvmmsg() call.
+  void InitializeHeaders();
+
+  bool recvmmsg_supported_;
+
+  PacketData packets_[kNumPacketsPerReadMmsgCall];
+  mmsghdr mmsg_hdrs_[kNumPacketsPerReadMmsgCall];
+
+  uint64 num_read_calls_;
+  uint64 num_packets_read_;
+
+  DISALLOW_COPY_AND_ASSIGN(QuicPacketReader);
+};
+
+}  // namespace tools
+}  // namespace net
+
+#endif  // NET_TOOLS_QUIC_QUIC_PACKET_READER_H_
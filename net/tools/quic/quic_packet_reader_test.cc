@@ -0,0 +1,127 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/tools/quic/quic_packet_reader.h"
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "net/base/net_util.h"
+#include "net/tools/quic/quic_dispatcher.h"
+#include "net/tools/quic/quic_socket_utils.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace net {
+namespace tools {
+namespace test {
+namespace {
+
+// Counts the packets it is given, and checks that they all came from
+// |client_address|.
+class CountingProcessor : public ProcessPacketInterface {
+ public:
+  explicit CountingProcessor(const IPEndPoint& client_address)
+      : client_address_(client_address), packets_(0) {}
+
+  void ProcessPacket(const IPEndPoint& server_address,
+                     const IPEndPoint& client_address,
+                     const QuicEncryptedPacket& packet) override {
+    EXPECT_EQ(client_address_, client_address);
+    EXPECT_EQ(100u, packet.length());
+    ++packets_;
+  }
+
+  int packets() const { return packets_; }
+
+ private:
+  const IPEndPoint client_address_;
+  int packets_;
+
+  DISALLOW_COPY_AND_ASSIGN(CountingProcessor);
+};
+
+// Returns a non-blocking UDP socket bound to an ephemeral loopback port, and
+// sets |address| to its address.
+int CreateLoopbackSocket(IPEndPoint* address) {
+  IPAddressNumber ip;
+  CHECK(ParseIPLiteralToNumber("127.0.0.1", &ip));
+  int fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, IPPROTO_UDP);
+  CHECK_GE(fd, 0);
+  CHECK_EQ(0, QuicSocketUtils::SetGetAddressInfo(fd, AF_INET));
+
+  SockaddrStorage bind_address;
+  CHECK(IPEndPoint(ip, 0).ToSockAddr(bind_address.addr,
+                                     &bind_address.addr_len));
+  CHECK_EQ(0, bind(fd, bind_address.addr, bind_address.addr_len));
+  SockaddrStorage bound_address;
+  CHECK_EQ(0, getsockname(fd, bound_address.addr, &bound_address.addr_len));
+  CHECK(address->FromSockAddr(bound_address.addr, bound_address.addr_len));
+  return fd;
+}
+
+class QuicPacketReaderTest : public ::testing::Test {
+ protected:
+  QuicPacketReaderTest() {
+    server_fd_ = CreateLoopbackSocket(&server_address_);
+    client_fd_ = CreateLoopbackSocket(&client_address_);
+  }
+
+  ~QuicPacketReaderTest() override {
+    close(server_fd_);
+    close(client_fd_);
+  }
+
+  void SendPackets(int count) {
+    char packet[100] = {};
+    for (int i = 0; i < count; ++i) {
+      WriteResult result = QuicSocketUtils::WritePacket(
+          client_fd_, packet, sizeof(packet), IPAddressNumber(),
+          server_address_);
+      ASSERT_EQ(WRITE_STATUS_OK, result.status);
+    }
+  }
+
+  int server_fd_;
+  int client_fd_;
+  IPEndPoint server_address_;
+  IPEndPoint client_address_;
+};
+
+TEST_F(QuicPacketReaderTest, ReadsABatchPerCall) {
+  const int kNumPackets = kNumPacketsPerReadMmsgCall + 4;
+  SendPackets(kNumPackets);
+
+  QuicPacketReader reader;
+  CountingProcessor processor(client_address_);
+  // A full batch may be followed by more packets.
+  EXPECT_TRUE(reader.ReadAndDispatchPackets(
+      server_fd_, server_address_.port(), &processor, nullptr));
+  EXPECT_EQ(kNumPacketsPerReadMmsgCall, processor.packets());
+  EXPECT_FALSE(reader.ReadAndDispatchPackets(
+      server_fd_, server_address_.port(), &processor, nullptr));
+  EXPECT_EQ(kNumPackets, processor.packets());
+
+  EXPECT_EQ(2u, reader.num_read_calls());
+  EXPECT_EQ(static_cast<uint64>(kNumPackets), reader.num_packets_read());
+}
+
+TEST_F(QuicPacketReaderTest, ReadsSinglePackets) {
+  SendPackets(2);
+
+  QuicPacketReader reader;
+  CountingProcessor processor(client_address_);
+  while (reader.ReadAndDispatchSinglePacket(
+      server_fd_, server_address_.port(), &processor, nullptr)) {
+  }
+  EXPECT_EQ(2, processor.packets());
+
+  // The last call finds the socket empty.
+  EXPECT_EQ(3u, reader.num_read_calls());
+  EXPECT_EQ(2u, reader.num_packets_read());
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace tools
+}  // namespace net
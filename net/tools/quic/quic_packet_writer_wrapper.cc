@@ -36,6 +36,10 @@ void QuicPacketWriterWrapper::SetWritable() {
   writer_->SetWritable();
 }
 
+char* QuicPacketWriterWrapper::GetNextWriteLocation() {
+  return writer_->GetNextWriteLocation();
+}
+
 void QuicPacketWriterWrapper::set_writer(QuicPacketWriter* writer) {
   writer_.reset(writer);
 }
@@ -30,6 +30,7 @@ class QuicPacketWriterWrapper : public net::QuicPacketWriter {
   bool IsWriteBlockedDataBuffered() const override;
   bool IsWriteBlocked() const override;
   void SetWritable() override;
+  char* GetNextWriteLocation() override;
 
   // Takes ownership of |writer|.
   void set_writer(QuicPacketWriter* writer);
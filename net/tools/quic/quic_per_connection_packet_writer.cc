@@ -41,6 +41,10 @@ void QuicPerConnectionPacketWriter::SetWritable() {
   shared_writer_->SetWritable();
 }
 
+char* QuicPerConnectionPacketWriter::GetNextWriteLocation() {
+  return shared_writer_->GetNextWriteLocation();
+}
+
 }  // namespace tools
 
 }  // namespace net
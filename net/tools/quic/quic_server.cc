@@ -19,16 +19,20 @@
 #include "net/quic/quic_crypto_stream.h"
 #include "net/quic/quic_data_reader.h"
 #include "net/quic/quic_protocol.h"
+#include "net/tools/quic/quic_batch_packet_writer.h"
 #include "net/tools/quic/quic_dispatcher.h"
 #include "net/tools/quic/quic_in_memory_cache.h"
+#include "net/tools/quic/quic_packet_reader.h"
 #include "net/tools/quic/quic_socket_utils.h"
 
-#define MMSG_MORE 0
-
 #ifndef SO_RXQ_OVFL
 #define SO_RXQ_OVFL 40
 #endif
 
+#ifndef SO_REUSEPORT
+#define SO_REUSEPORT 15
+#endif
+
 namespace net {
 namespace tools {
 
@@ -44,7 +48,10 @@ QuicServer::QuicServer()
       fd_(-1),
       packets_dropped_(0),
       overflow_supported_(false),
-      use_recvmmsg_(false),
+      reuse_port_(false),
+      use_recvmmsg_(true),
+      use_sendmmsg_(true),
+      batch_writer_(nullptr),
       crypto_config_(kSourceAddressTokenSecret, QuicRandom::GetInstance()),
       supported_versions_(QuicSupportedVersions()) {
   Initialize();
@@ -56,7 +63,10 @@ QuicServer::QuicServer(const QuicConfig& config,
       fd_(-1),
       packets_dropped_(0),
       overflow_supported_(false),
-      use_recvmmsg_(false),
+      reuse_port_(false),
+      use_recvmmsg_(true),
+      use_sendmmsg_(true),
+      batch_writer_(nullptr),
       config_(config),
       crypto_config_(kSourceAddressTokenSecret, QuicRandom::GetInstance()),
       supported_versions_(supported_versions) {
@@ -64,9 +74,7 @@ QuicServer::QuicServer(const QuicConfig& config,
 }
 
 void QuicServer::Initialize() {
-#if MMSG_MORE
-  use_recvmmsg_ = true;
-#endif
+  packet_reader_.reset(new QuicPacketReader());
 
   // If an initial flow control window has not explicitly been set, then use a
   // sensible value for a server: 1 MB for session, 64 KB for each stream.
@@ -139,6 +147,16 @@ bool QuicServer::Listen(const IPEndPoint& address) {
     return false;
   }
 
+  if (reuse_port_) {
+    int reuse_port = 1;
+    rc = setsockopt(
+        fd_, SOL_SOCKET, SO_REUSEPORT, &reuse_port, sizeof(reuse_port));
+    if (rc < 0) {
+      LOG(ERROR) << "SO_REUSEPORT not supported: " << strerror(errno);
+      return false;
+    }
+  }
+
   sockaddr_storage raw_addr;
   socklen_t raw_addr_len = sizeof(raw_addr);
   CHECK(address.ToSockAddr(reinterpret_cast<sockaddr*>(&raw_addr),
@@ -166,7 +184,12 @@ bool QuicServer::Listen(const IPEndPoint& address) {
 
   epoll_server_.RegisterFD(fd_, this, kEpollFlags);
   dispatcher_.reset(CreateQuicDispatcher());
-  dispatcher_->Initialize(fd_);
+  if (use_sendmmsg_) {
+    batch_writer_ = new QuicBatchPacketWriter(fd_);
+    dispatcher_->InitializeWithWriter(batch_writer_);
+  } else {
+    dispatcher_->Initialize(fd_);
+  }
 
   return true;
 }
@@ -182,12 +205,20 @@ QuicDispatcher* QuicServer::CreateQuicDispatcher() {
 
 void QuicServer::WaitForEvents() {
   epoll_server_.WaitForEventsAndExecuteCallbacks();
+  FlushWrites();
+}
+
+void QuicServer::FlushWrites() {
+  // If the socket is full, the rest is sent from OnEvent() once it drains.
+  if (batch_writer_ != nullptr && !batch_writer_->IsWriteBlocked())
+    batch_writer_->Flush();
 }
 
 void QuicServer::Shutdown() {
   // Before we shut down the epoll server, give all active sessions a chance to
   // notify clients that they're closing.
   dispatcher_->Shutdown();
+  FlushWrites();
 
   close(fd_);
   fd_ = -1;
@@ -199,11 +230,17 @@ void QuicServer::OnEvent(int fd, EpollEvent* event) {
 
   if (event->in_events & EPOLLIN) {
     DVLOG(1) << "EPOLLIN";
-    bool read = true;
-    while (read) {
-        read = ReadAndDispatchSinglePacket(
-            fd_, port_, dispatcher_.get(),
-            overflow_supported_ ? &packets_dropped_ : nullptr);
+    QuicPacketCount* packets_dropped =
+        overflow_supported_ ? &packets_dropped_ : nullptr;
+    bool more_to_read = true;
+    while (more_to_read) {
+      if (use_recvmmsg_) {
+        more_to_read = packet_reader_->ReadAndDispatchPackets(
+            fd_, port_, dispatcher_.get(), packets_dropped);
+      } else {
+        more_to_read = packet_reader_->ReadAndDispatchSinglePacket(
+            fd_, port_, dispatcher_.get(), packets_dropped);
+      }
     }
   }
   if (event->in_events & EPOLLOUT) {
@@ -216,33 +253,5 @@ void QuicServer::OnEvent(int fd, EpollEvent* event) {
   }
 }
 
-/* static */
-bool QuicServer::ReadAndDispatchSinglePacket(int fd,
-                                             int port,
-                                             ProcessPacketInterface* processor,
-                                             QuicPacketCount* packets_dropped) {
-  // Allocate some extra space so we can send an error if the client goes over
-  // the limit.
-  char buf[2 * kMaxPacketSize];
-
-  IPEndPoint client_address;
-  IPAddressNumber server_ip;
-  int bytes_read =
-      QuicSocketUtils::ReadPacket(fd, buf, arraysize(buf),
-                                  packets_dropped,
-                                  &server_ip, &client_address);
-
-  if (bytes_read < 0) {
-    return false;  // We failed to read.
-  }
-
-  QuicEncryptedPacket packet(buf, bytes_read, false);
-
-  IPEndPoint server_address(server_ip, port);
-  processor->ProcessPacket(server_address, client_address, packet);
-
-  return true;
-}
-
 }  // namespace tools
 }  // namespace net
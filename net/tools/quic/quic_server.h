@@ -24,8 +24,9 @@ namespace test {
 class QuicServerPeer;
 }  // namespace test
 
-class ProcessPacketInterface;
+class QuicBatchPacketWriter;
 class QuicDispatcher;
+class QuicPacketReader;
 
 class QuicServer : public EpollCallbackInterface {
  public:
@@ -38,7 +39,8 @@ class QuicServer : public EpollCallbackInterface {
   // Start listening on the specified address.
   bool Listen(const IPEndPoint& address);
 
-  // Wait up to 50ms, and handle any events which occur.
+  // Wait up to 50ms, and handle any events which occur. The packets written
+  // while handling them are sent before returning.
   void WaitForEvents();
 
   // Server deletion is imminent.  Start cleaning up the epoll server.
@@ -50,16 +52,6 @@ class QuicServer : public EpollCallbackInterface {
   void OnEvent(int fd, EpollEvent* event) override;
   void OnUnregistration(int fd, bool replaced) override {}
 
-  // Reads a packet from the given fd, and then passes it off to
-  // the QuicDispatcher.  Returns true if a packet is read, false
-  // otherwise.
-  // If packets_dropped is non-null, the socket is configured to track
-  // dropped packets, and some packets are read, it will be set to the number of
-  // dropped packets.
-  static bool ReadAndDispatchSinglePacket(int fd, int port,
-                                          ProcessPacketInterface* processor,
-                                          QuicPacketCount* packets_dropped);
-
   void OnShutdown(EpollServer* eps, int fd) override {}
 
   void SetStrikeRegisterNoStartupPeriod() {
@@ -72,6 +64,10 @@ class QuicServer : public EpollCallbackInterface {
     crypto_config_.SetProofSource(source);
   }
 
+  // If set before Listen(), the socket is opened with SO_REUSEPORT, so that
+  // several servers can listen on the same address.
+  void set_reuse_port(bool reuse_port) { reuse_port_ = reuse_port; }
+
   bool overflow_supported() { return overflow_supported_; }
 
   QuicPacketCount packets_dropped() { return packets_dropped_; }
@@ -89,6 +85,7 @@ class QuicServer : public EpollCallbackInterface {
     return supported_versions_;
   }
   EpollServer* epoll_server() { return &epoll_server_; }
+  int fd() const { return fd_; }
 
  private:
   friend class net::tools::test::QuicServerPeer;
@@ -96,6 +93,9 @@ class QuicServer : public EpollCallbackInterface {
   // Initialize the internal state of the server.
   void Initialize();
 
+  // Sends the packets that the batch writer is holding back.
+  void FlushWrites();
+
   // Accepts data from the framer and demuxes clients to sessions.
   scoped_ptr<QuicDispatcher> dispatcher_;
   // Frames incoming packets and hands them to the dispatcher.
@@ -116,9 +116,23 @@ class QuicServer : public EpollCallbackInterface {
   // because the socket would otherwise overflow.
   bool overflow_supported_;
 
+  // If true, the socket is opened with SO_REUSEPORT.
+  bool reuse_port_;
+
   // If true, use recvmmsg for reading.
   bool use_recvmmsg_;
 
+  // If true, hold written packets back and send them with sendmmsg at the end
+  // of each epoll iteration.
+  bool use_sendmmsg_;
+
+  // Reads packets off |fd_|, in batches if |use_recvmmsg_| is true.
+  scoped_ptr<QuicPacketReader> packet_reader_;
+
+  // The dispatcher's writer if |use_sendmmsg_| is true, and null otherwise.
+  // Owned by |dispatcher_|.
+  QuicBatchPacketWriter* batch_writer_;
+
   // config_ contains non-crypto parameters that are negotiated in the crypto
   // handshake.
   QuicConfig config_;
@@ -0,0 +1,144 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <string>
+
+#include "base/basictypes.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/threading/simple_thread.h"
+#include "base/time/time.h"
+#include "net/base/ip_endpoint.h"
+#include "net/base/net_util.h"
+#include "net/quic/quic_protocol.h"
+#include "net/quic/test_tools/quic_test_utils.h"
+#include "net/tools/quic/quic_batch_packet_writer.h"
+#include "net/tools/quic/quic_in_memory_cache.h"
+#include "net/tools/quic/quic_packet_reader.h"
+#include "net/tools/quic/quic_server.h"
+#include "net/tools/quic/test_tools/quic_in_memory_cache_peer.h"
+#include "net/tools/quic/test_tools/quic_server_peer.h"
+#include "net/tools/quic/test_tools/quic_test_client.h"
+#include "net/tools/quic/test_tools/server_thread.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_test.h"
+
+namespace net {
+namespace tools {
+namespace test {
+namespace {
+
+const char kServerHostname[] = "example.com";
+const char kLoadUrl[] = "https://www.google.com/load";
+const char kLoadPath[] = "/load";
+const int kResponseSize = 64 * 1024;
+const int kNumClients = 8;
+const int kNumRequestsPerClient = 20;
+
+// Downloads the load response kNumRequestsPerClient times, with a QuicClient
+// of its own.
+class LoadClient : public base::DelegateSimpleThread::Delegate {
+ public:
+  explicit LoadClient(const IPEndPoint& server_address)
+      : server_address_(server_address), num_responses_(0) {}
+
+  void Run() override {
+    QuicTestClient client(server_address_, kServerHostname, false,
+                          QuicSupportedVersions());
+    client.Connect();
+    for (int i = 0; i < kNumRequestsPerClient; ++i) {
+      if (client.SendSynchronousRequest(kLoadPath).size() ==
+          static_cast<size_t>(kResponseSize)) {
+        ++num_responses_;
+      }
+    }
+  }
+
+  int num_responses() const { return num_responses_; }
+
+ private:
+  const IPEndPoint server_address_;
+  int num_responses_;
+
+  DISALLOW_COPY_AND_ASSIGN(LoadClient);
+};
+
+// Loads a QuicServer with kNumClients concurrent QuicClients, and reports the
+// server's system calls per packet and packets per second. The parameter is
+// whether the server batches its reads and writes.
+class QuicServerPerfTest : public ::testing::TestWithParam<bool> {
+ protected:
+  QuicServerPerfTest() {
+    QuicInMemoryCachePeer::ResetForTests();
+    std::string body;
+    net::test::GenerateBody(&body, kResponseSize);
+    QuicInMemoryCache::GetInstance()->AddSimpleResponse(
+        "GET", kLoadUrl, "HTTP/1.1", "200", "OK", body);
+  }
+
+  ~QuicServerPerfTest() override { QuicInMemoryCachePeer::ResetForTests(); }
+};
+
+TEST_P(QuicServerPerfTest, Load) {
+  const bool batched = GetParam();
+  IPAddressNumber ip;
+  CHECK(ParseIPLiteralToNumber("127.0.0.1", &ip));
+
+  QuicServer* server = new QuicServer();
+  if (!batched) {
+    QuicServerPeer::DisableRecvmmsg(server);
+    QuicServerPeer::DisableSendmmsg(server);
+  }
+  ServerThread server_thread(server, IPEndPoint(ip, 0), false);
+  server_thread.Initialize();
+  IPEndPoint server_address(ip, server_thread.GetPort());
+  server_thread.Start();
+
+  scoped_ptr<LoadClient> clients[kNumClients];
+  scoped_ptr<base::DelegateSimpleThread> client_threads[kNumClients];
+  base::TimeTicks start = base::TimeTicks::Now();
+  for (int i = 0; i < kNumClients; ++i) {
+    clients[i].reset(new LoadClient(server_address));
+    client_threads[i].reset(
+        new base::DelegateSimpleThread(clients[i].get(), "LoadClient"));
+    client_threads[i]->Start();
+  }
+  for (int i = 0; i < kNumClients; ++i)
+    client_threads[i]->Join();
+  base::TimeDelta elapsed = base::TimeTicks::Now() - start;
+
+  server_thread.Quit();
+  server_thread.Join();
+
+  for (int i = 0; i < kNumClients; ++i)
+    EXPECT_EQ(kNumRequestsPerClient, clients[i]->num_responses());
+
+  QuicPacketReader* reader = QuicServerPeer::GetPacketReader(server);
+  QuicBatchPacketWriter* writer = QuicServerPeer::GetBatchWriter(server);
+  uint64 packets_read = reader->num_packets_read();
+  ASSERT_GT(packets_read, 0u);
+  const std::string trace = batched ? "batched" : "unbatched";
+  perf_test::PrintResult(
+      "quic_server_read_syscalls_per_packet", "", trace,
+      static_cast<double>(reader->num_read_calls()) / packets_read,
+      "syscalls/packet", true);
+  if (writer != nullptr && writer->num_packets_written() > 0) {
+    perf_test::PrintResult(
+        "quic_server_write_syscalls_per_packet", "", trace,
+        static_cast<double>(writer->num_write_calls()) /
+            writer->num_packets_written(),
+        "syscalls/packet", true);
+  }
+  perf_test::PrintResult(
+      "quic_server_packets_read_per_second", "", trace,
+      packets_read / elapsed.InSecondsF(), "packets/s", true);
+}
+
+INSTANTIATE_TEST_CASE_P(QuicServerPerfTests,
+                        QuicServerPerfTest,
+                        ::testing::Bool());
+
+}  // namespace
+}  // namespace test
+}  // namespace tools
+}  // namespace net
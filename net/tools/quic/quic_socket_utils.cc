@@ -103,8 +103,6 @@ int QuicSocketUtils::ReadPacket(int fd, char* buffer, size_t buf_len,
                                 IPAddressNumber* self_address,
                                 IPEndPoint* peer_address) {
   DCHECK(peer_address != nullptr);
-  const int kSpaceForOverflowAndIp =
-      CMSG_SPACE(sizeof(int)) + CMSG_SPACE(sizeof(in6_pktinfo));
   char cbuf[kSpaceForOverflowAndIp];
   memset(cbuf, 0, arraysize(cbuf));
 
@@ -196,11 +194,6 @@ WriteResult QuicSocketUtils::WritePacket(int fd,
   hdr.msg_iovlen = 1;
   hdr.msg_flags = 0;
 
-  const int kSpaceForIpv4 = CMSG_SPACE(sizeof(in_pktinfo));
-  const int kSpaceForIpv6 = CMSG_SPACE(sizeof(in6_pktinfo));
-  // kSpaceForIp should be big enough to hold both IPv4 and IPv6 packet info.
-  const int kSpaceForIp =
-      (kSpaceForIpv4 < kSpaceForIpv6) ? kSpaceForIpv6 : kSpaceForIpv4;
   char cbuf[kSpaceForIp];
   if (self_address.empty()) {
     hdr.msg_control = 0;
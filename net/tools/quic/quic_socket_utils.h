@@ -7,6 +7,7 @@
 #ifndef NET_TOOLS_QUIC_QUIC_SOCKET_UTILS_H_
 #define NET_TOOLS_QUIC_QUIC_SOCKET_UTILS_H_
 
+#include <netinet/in.h>
 #include <stddef.h>
 #include <sys/socket.h>
 #include <string>
@@ -19,6 +20,17 @@
 namespace net {
 namespace tools {
 
+// The space ReadPacket() needs for the control messages that carry the
+// socket's drop counter and the packet's destination address.
+const int kSpaceForOverflowAndIp =
+    CMSG_SPACE(sizeof(int)) + CMSG_SPACE(sizeof(in6_pktinfo));
+
+// The space WritePacket() needs for the control message that carries either
+// an IPv4 or an IPv6 source address.
+const int kSpaceForIp =
+    CMSG_SPACE(sizeof(in_pktinfo)) > CMSG_SPACE(sizeof(in6_pktinfo)) ?
+        CMSG_SPACE(sizeof(in_pktinfo)) : CMSG_SPACE(sizeof(in6_pktinfo));
+
 class QuicSocketUtils {
  public:
   // If the msghdr contains IP_PKTINFO or IPV6_PKTINFO, this will return the
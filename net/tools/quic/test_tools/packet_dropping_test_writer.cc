@@ -147,6 +147,15 @@ void PacketDroppingTestWriter::SetWritable() {
   QuicPacketWriterWrapper::SetWritable();
 }
 
+char* PacketDroppingTestWriter::GetNextWriteLocation() {
+  base::AutoLock locked(config_mutex_);
+  if (!delayed_packets_.empty() || !fake_packet_delay_.IsZero() ||
+      !fake_bandwidth_.IsZero()) {
+    return nullptr;
+  }
+  return QuicPacketWriterWrapper::GetNextWriteLocation();
+}
+
 QuicTime PacketDroppingTestWriter::ReleaseNextPacket() {
   if (delayed_packets_.empty()) {
     return QuicTime::Zero();
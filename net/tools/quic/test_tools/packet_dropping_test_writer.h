@@ -55,6 +55,11 @@ class PacketDroppingTestWriter : public QuicPacketWriterWrapper {
 
   void SetWritable() override;
 
+  // Passes the wrapped writer's buffer on only while packets are not
+  // delayed, as WritePacket() releases delayed packets to the wrapped writer
+  // before the packet in hand, which would overwrite it.
+  char* GetNextWriteLocation() override;
+
   // Writes out any packet which should have been sent by now
   // to the contained writer and returns the time
   // for the next delayed packet to be written.
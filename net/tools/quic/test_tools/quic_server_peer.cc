@@ -5,6 +5,7 @@
 #include "net/tools/quic/test_tools/quic_server_peer.h"
 
 #include "net/tools/quic/quic_dispatcher.h"
+#include "net/tools/quic/quic_packet_reader.h"
 #include "net/tools/quic/quic_server.h"
 
 namespace net {
@@ -24,10 +25,23 @@ void QuicServerPeer::DisableRecvmmsg(QuicServer* server) {
 }
 
 // static
+void QuicServerPeer::DisableSendmmsg(QuicServer* server) {
+  DCHECK(server->dispatcher_ == nullptr);
+  server->use_sendmmsg_ = false;
+}
+
 QuicDispatcher* QuicServerPeer::GetDispatcher(QuicServer* server) {
   return server->dispatcher_.get();
 }
 
+QuicPacketReader* QuicServerPeer::GetPacketReader(QuicServer* server) {
+  return server->packet_reader_.get();
+}
+
+QuicBatchPacketWriter* QuicServerPeer::GetBatchWriter(QuicServer* server) {
+  return server->batch_writer_;
+}
+
 }  // namespace test
 }  // namespace tools
 }  // namespace net
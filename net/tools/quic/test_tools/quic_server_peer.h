@@ -11,7 +11,9 @@ namespace net {
 
 namespace tools {
 
+class QuicBatchPacketWriter;
 class QuicDispatcher;
+class QuicPacketReader;
 class QuicServer;
 
 namespace test {
@@ -20,7 +22,12 @@ class QuicServerPeer {
  public:
   static bool SetSmallSocket(QuicServer* server);
   static void DisableRecvmmsg(QuicServer* server);
+  // Must be called before the server listens.
+  static void DisableSendmmsg(QuicServer* server);
   static QuicDispatcher* GetDispatcher(QuicServer* server);
+  static QuicPacketReader* GetPacketReader(QuicServer* server);
+  // Returns null if sendmmsg is disabled.
+  static QuicBatchPacketWriter* GetBatchWriter(QuicServer* server);
 
  private:
   DISALLOW_COPY_AND_ASSIGN(QuicServerPeer);
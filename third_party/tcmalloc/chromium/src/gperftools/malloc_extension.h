@@ -314,6 +314,11 @@ class PERFTOOLS_DLL_DECL MallocExtension {
   // heap-profiler is enabled without the tcmalloc memory allocator.
   static unsigned int GetBytesAllocatedOnCurrentThread();
 
+  // On the current thread, return the number of allocations made, modulo
+  // 2^32.  This function is added in Chromium for profiling.
+  // Currently only implemented in tcmalloc. Returns 0 if tcmalloc is not used.
+  static unsigned int GetAllocationsOnCurrentThread();
+
   // Returns detailed information about malloc's freelists. For each list,
   // return a FreeListInfo:
   struct FreeListInfo {
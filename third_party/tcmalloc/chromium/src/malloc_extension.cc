@@ -237,6 +237,15 @@ unsigned int MallocExtension::GetBytesAllocatedOnCurrentThread() {
 #endif
 }
 
+unsigned int MallocExtension::GetAllocationsOnCurrentThread() {
+  // This function is added in Chromium for profiling.
+#ifdef USE_TCMALLOC
+  return tcmalloc::ThreadCache::GetAllocationsOnCurrentThread();
+#else
+  return 0;
+#endif
+}
+
 // -----------------------------------------------------------------------
 // Heap sampling support
 // -----------------------------------------------------------------------
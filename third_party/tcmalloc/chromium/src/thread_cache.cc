@@ -117,6 +117,7 @@ bool kernel_supports_tls = false;      // be conservative
 void ThreadCache::Init(pthread_t tid) {
   size_ = 0;
   total_bytes_allocated_ = 0;
+  total_allocations_ = 0;
 
   max_size_ = 0;
   IncreaseCacheLimitLocked();
@@ -318,6 +319,11 @@ unsigned int ThreadCache::GetBytesAllocatedOnCurrentThread() {
   return ThreadCache::GetThreadHeap()->GetTotalBytesAllocated();
 }
 
+// static
+unsigned int ThreadCache::GetAllocationsOnCurrentThread() {
+  return ThreadCache::GetThreadHeap()->GetTotalAllocations();
+}
+
 void ThreadCache::InitModule() {
   SpinLockHolder h(Static::pageheap_lock());
   if (!phinited) {
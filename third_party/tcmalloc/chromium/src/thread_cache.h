@@ -95,8 +95,11 @@ class ThreadCache {
   // should be sampled
   bool SampleAllocation(size_t k);
 
-  // Record additional bytes allocated.
-  void AddToByteAllocatedTotal(size_t k) { total_bytes_allocated_ += k; }
+  // Record an allocation of |k| additional bytes.
+  void AddToByteAllocatedTotal(size_t k) {
+    total_bytes_allocated_ += k;
+    ++total_allocations_;
+  }
 
   // Return the total number of bytes allocated from this heap.  The value will
   // wrap when there is an overflow, and so only the differences between two
@@ -106,6 +109,13 @@ class ThreadCache {
   // On the current thread, return GetTotalBytesAllocated().
   static uint32 GetBytesAllocatedOnCurrentThread();
 
+  // Return the number of allocations made from this heap.  Like
+  // GetTotalBytesAllocated(), the value wraps modulo 2^32.
+  uint32 GetTotalAllocations() const;
+
+  // On the current thread, return GetTotalAllocations().
+  static uint32 GetAllocationsOnCurrentThread();
+
   static void         InitModule();
   static void         InitTSD();
   static ThreadCache* GetThreadHeap();
@@ -318,6 +328,7 @@ class ThreadCache {
   // currently used for Chromium profiling, where tallies are kept of the amount
   // of memory allocated during the running of each task on each thread.
   uint32        total_bytes_allocated_;  // Total, modulo 2^32.
+  uint32        total_allocations_;      // Count, modulo 2^32.
 
   // We sample allocations, biased by the size of the allocation
   Sampler       sampler_;               // A sampler
@@ -359,6 +370,10 @@ inline uint32 ThreadCache::GetTotalBytesAllocated() const {
   return total_bytes_allocated_;
 }
 
+inline uint32 ThreadCache::GetTotalAllocations() const {
+  return total_allocations_;
+}
+
 inline void* ThreadCache::Allocate(size_t size, size_t cl) {
   ASSERT(size <= kMaxSize);
   ASSERT(size == Static::sizemap()->ByteSizeForClass(cl));